@@ -0,0 +1,127 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+
+// --- Lock-free Snapshot ---
+// Single-writer, multi-reader exchange of a small POD value between tasks.
+// The writer alternates between two slots and only then publishes the slot index,
+// so a reader never waits on a writer that was preempted mid-copy (important when
+// both run on the same core with different priorities). A reader only retries if
+// the writer completed two publishes while it was copying.
+template <typename T>
+class Snapshot {
+public:
+  Snapshot() : _latest(0) {
+    _slots[0].sequence.store(0, std::memory_order_relaxed);
+    _slots[1].sequence.store(0, std::memory_order_relaxed);
+  }
+
+  explicit Snapshot(const T& initialValue) : Snapshot() {
+    _slots[0].value = initialValue;
+    _slots[1].value = initialValue;
+  }
+
+  // Only ever call from the owning (writer) task.
+  void publish(const T& value) {
+    uint32_t next = _latest.load(std::memory_order_relaxed) ^ 1u;
+    Slot& slot = _slots[next];
+    uint32_t seq = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(seq + 1, std::memory_order_relaxed); // Odd: write in progress
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.value = value;
+    slot.sequence.store(seq + 2, std::memory_order_release); // Even: slot consistent
+    _latest.store(next, std::memory_order_release);
+  }
+
+  // Safe from any task on any core.
+  T read() const {
+    for (;;) {
+      const Slot& slot = _slots[_latest.load(std::memory_order_acquire)];
+      uint32_t before = slot.sequence.load(std::memory_order_acquire);
+      if (before & 1u) {
+        continue; // Writer wrapped onto this slot, re-read the latest index
+      }
+      T copy = slot.value;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) == before) {
+        return copy;
+      }
+    }
+  }
+
+private:
+  struct Slot {
+    std::atomic<uint32_t> sequence;
+    T value;
+  };
+  Slot _slots[2];
+  std::atomic<uint32_t> _latest;
+};
+
+// --- Lock-free Status Mailbox ---
+// Multi-writer "latest message wins" text slot (OLED status line). Every writer claims
+// its own ring slot with a ticket, so concurrent writers from different tasks never
+// overwrite each other mid-copy; readers pick the newest fully published ticket.
+template <size_t TextSize, size_t SlotCount = 4>
+class StatusMailbox {
+public:
+  StatusMailbox() : _nextTicket(0), _published(0) {
+    for (size_t i = 0; i < SlotCount; i++) {
+      _slots[i].sequence.store(0, std::memory_order_relaxed);
+      _slots[i].text[0] = '\0';
+    }
+  }
+
+  void post(const char* message) {
+    uint32_t ticket = _nextTicket.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = _slots[ticket % SlotCount];
+    slot.sequence.store(ticket * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    strncpy(slot.text, message, TextSize - 1);
+    slot.text[TextSize - 1] = '\0';
+    slot.sequence.store(ticket * 2 + 2, std::memory_order_release);
+
+    // Advance the published ticket monotonically (a slower writer must not roll it back)
+    uint32_t published = _published.load(std::memory_order_relaxed);
+    while (published < ticket + 1 &&
+           !_published.compare_exchange_weak(published, ticket + 1, std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+    }
+  }
+
+  // Copies the newest message into out (TextSize bytes). Returns false if nothing was posted yet.
+  bool read(char* out) const {
+    for (;;) {
+      uint32_t published = _published.load(std::memory_order_acquire);
+      if (published == 0) {
+        out[0] = '\0';
+        return false;
+      }
+      uint32_t ticket = published - 1;
+      const Slot& slot = _slots[ticket % SlotCount];
+      uint32_t before = slot.sequence.load(std::memory_order_acquire);
+      if (before != ticket * 2 + 2) {
+        continue; // Slot already reused by a newer ticket
+      }
+      memcpy(out, slot.text, TextSize);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) == before) {
+        return true;
+      }
+    }
+  }
+
+private:
+  struct Slot {
+    std::atomic<uint32_t> sequence;
+    char text[TextSize];
+  };
+  Slot _slots[SlotCount];
+  std::atomic<uint32_t> _nextTicket;
+  std::atomic<uint32_t> _published;
+};
+
+#endif // SNAPSHOT_H
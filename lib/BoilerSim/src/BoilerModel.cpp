@@ -0,0 +1,43 @@
+#include "BoilerModel.h"
+
+namespace {
+const double WATER_HEAT_CAPACITY_J_PER_ML_K = 4.186;
+}
+
+// Defaults give ~0.5 C/s at the sensor with the heater on, matching the firmware's
+// 2 s/C burst estimate, and ~6 C of droop over a 25 s shot at 2 ml/s.
+BoilerModelParams::BoilerModelParams()
+    : heaterPowerW(1100.0),
+      elementHeatCapacityJPerK(250.0),
+      blockHeatCapacityJPerK(1900.0),
+      elementToBlockWPerK(45.0),
+      blockToAmbientWPerK(0.45),
+      sensorTimeConstantS(6.0),
+      ambientTempC(22.0),
+      inletWaterTempC(22.0) {}
+
+BoilerModel::BoilerModel(const BoilerModelParams& params)
+    : _params(params),
+      _elementTempC(params.ambientTempC),
+      _blockTempC(params.ambientTempC),
+      _sensorTempC(params.ambientTempC),
+      _relayOn(false),
+      _machinePowered(true),
+      _waterFlowMlPerS(0.0) {}
+
+void BoilerModel::reset(double tempC) {
+  _elementTempC = tempC;
+  _blockTempC = tempC;
+  _sensorTempC = tempC;
+}
+
+void BoilerModel::step(double dtSeconds) {
+  double heaterW = isHeating() ? _params.heaterPowerW : 0.0;
+  double elementToBlockW = _params.elementToBlockWPerK * (_elementTempC - _blockTempC);
+  double lossW = _params.blockToAmbientWPerK * (_blockTempC - _params.ambientTempC);
+  double waterW = _waterFlowMlPerS * WATER_HEAT_CAPACITY_J_PER_ML_K * (_blockTempC - _params.inletWaterTempC);
+
+  _elementTempC += (heaterW - elementToBlockW) / _params.elementHeatCapacityJPerK * dtSeconds;
+  _blockTempC += (elementToBlockW - lossW - waterW) / _params.blockHeatCapacityJPerK * dtSeconds;
+  _sensorTempC += (_blockTempC - _sensorTempC) / _params.sensorTimeConstantS * dtSeconds;
+}
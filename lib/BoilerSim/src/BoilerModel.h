@@ -0,0 +1,50 @@
+#ifndef BOILER_MODEL_H
+#define BOILER_MODEL_H
+
+// --- Thermoblock Plant Model ---
+// Lumped two-node model of the ECP/Stilosa thermoblock: the heater element heats the
+// block through a finite conductance, the block loses heat to ambient and to the water
+// drawn during a shot, and the externally clamped thermocouple sees the block through
+// a first-order lag. The element/sensor lags reproduce the overshoot seen on the machine.
+struct BoilerModelParams {
+  BoilerModelParams();
+
+  double heaterPowerW;              // Element power when the relay and machine are both on
+  double elementHeatCapacityJPerK;  // Heater element + sheath
+  double blockHeatCapacityJPerK;    // Aluminium block + contained water
+  double elementToBlockWPerK;       // Conductance element -> block
+  double blockToAmbientWPerK;       // Losses to ambient
+  double sensorTimeConstantS;       // Thermocouple ring lug lag
+  double ambientTempC;
+  double inletWaterTempC;           // Tank water temperature
+};
+
+class BoilerModel {
+public:
+  explicit BoilerModel(const BoilerModelParams& params = BoilerModelParams());
+
+  void reset(double tempC); // All nodes at tempC
+
+  void setHeaterRelay(bool on) { _relayOn = on; }
+  void setMachinePowered(bool powered) { _machinePowered = powered; } // Main switch: no power = no heat
+  void setWaterFlowMlPerS(double flow) { _waterFlowMlPerS = flow; }   // > 0 while pulling a shot
+
+  void step(double dtSeconds); // Integrate forward (use dt <= 0.05 s)
+
+  double elementTempC() const { return _elementTempC; }
+  double blockTempC() const { return _blockTempC; }
+  double sensorTempC() const { return _sensorTempC; } // What the thermocouple sees
+  bool isHeating() const { return _relayOn && _machinePowered; }
+  const BoilerModelParams& params() const { return _params; }
+
+private:
+  BoilerModelParams _params;
+  double _elementTempC;
+  double _blockTempC;
+  double _sensorTempC;
+  bool _relayOn;
+  bool _machinePowered;
+  double _waterFlowMlPerS;
+};
+
+#endif // BOILER_MODEL_H
@@ -0,0 +1,78 @@
+#include "HydraulicModel.h"
+
+#include <math.h>
+
+namespace {
+const double MAINS_HZ = 50.0;
+const double PI = 3.14159265358979323846;
+}
+
+// Defaults: an Ulka-style pump (15 bar dead head, 8 ml/s free flow) reaching about 10.5
+// bar at full power on a puck that passes 2 ml/s at 9 bar, as on the stock machine.
+HydraulicModelParams::HydraulicModelParams()
+    : deadHeadBar(15.0),
+      freeFlowMlPerS(8.0),
+      minPowerPercent(30.0),
+      strokeTimeConstantS(0.06),
+      headspaceMl(6.0),
+      complianceMlPerBar(0.6),
+      puckResistanceBarSPerMl(4.5),
+      puckErosionMl(40.0),
+      puckErodibleFraction(0.3),
+      opvBar(11.0),
+      opvMlPerSPerBar(2.0),
+      rippleBar(0.4) {}
+
+HydraulicModel::HydraulicModel(const HydraulicModelParams& params) : _params(params) {
+  reset();
+}
+
+void HydraulicModel::reset() {
+  _pumpRunning = false;
+  _powerPercent = 100.0;
+  _stroke = 0.0;
+  _storedMl = 0.0;
+  _cupVolumeMl = 0.0;
+  _puckScale = 1.0;
+  _timeS = 0.0;
+}
+
+double HydraulicModel::puckResistance() const {
+  double erodible = _params.puckErodibleFraction * pow(0.5, _cupVolumeMl / _params.puckErosionMl);
+  return _params.puckResistanceBarSPerMl * _puckScale * (1.0 - _params.puckErodibleFraction + erodible);
+}
+
+double HydraulicModel::pressureBar() const {
+  double filled = _storedMl - _params.headspaceMl;
+  return filled > 0.0 ? filled / _params.complianceMlPerBar : 0.0;
+}
+
+double HydraulicModel::sensorPressureBar() const {
+  double ripple = _params.rippleBar * _stroke * sin(2.0 * PI * MAINS_HZ * _timeS);
+  double bar = pressureBar() + ripple;
+  return bar > 0.0 ? bar : 0.0;
+}
+
+double HydraulicModel::puckFlowMlPerS() const {
+  return pressureBar() / puckResistance();
+}
+
+void HydraulicModel::step(double dtSeconds) {
+  double targetStroke = 0.0;
+  if (_pumpRunning && _powerPercent > _params.minPowerPercent) {
+    targetStroke = (_powerPercent - _params.minPowerPercent) / (100.0 - _params.minPowerPercent);
+    if (targetStroke > 1.0) targetStroke = 1.0;
+  }
+  _stroke += (targetStroke - _stroke) * dtSeconds / (_params.strokeTimeConstantS + dtSeconds);
+
+  double bar = pressureBar();
+  double pumpFlow = _params.freeFlowMlPerS * (_stroke - bar / _params.deadHeadBar);
+  if (pumpFlow < 0.0) pumpFlow = 0.0; // Check valve
+  double puckFlow = puckFlowMlPerS();
+  double opvFlow = bar > _params.opvBar ? (bar - _params.opvBar) * _params.opvMlPerSPerBar : 0.0;
+
+  _storedMl += (pumpFlow - puckFlow - opvFlow) * dtSeconds;
+  if (_storedMl < 0.0) _storedMl = 0.0;
+  _cupVolumeMl += puckFlow * dtSeconds;
+  _timeS += dtSeconds;
+}
@@ -0,0 +1,60 @@
+#ifndef HYDRAULIC_MODEL_H
+#define HYDRAULIC_MODEL_H
+
+// --- Pump and Puck Hydraulic Model ---
+// Vibratory pump behind a phase-angle dimmer pushing water through the thermoblock into the
+// portafilter. The pump's flow falls linearly with pressure (free flow at 0 bar, none at
+// its dead-head pressure), both scaled by the stroke the dimmer power allows; below
+// minPowerPercent it does not move water, and the stroke follows the power with a short lag.
+// The headspace above the puck fills first, then the pressure rises with the compliance of
+// the remaining air and hoses. The puck is a flow resistance that erodes as water goes
+// through it, and the over-pressure valve opens above its setting. The 50 Hz pump ripple is
+// on the pressure reading.
+struct HydraulicModelParams {
+  HydraulicModelParams();
+
+  double deadHeadBar;            // Pump pressure at zero flow, full stroke
+  double freeFlowMlPerS;         // Pump flow at 0 bar, full stroke
+  double minPowerPercent;        // Dimmer power where the pump starts to move water
+  double strokeTimeConstantS;    // Pump response to a power change
+  double headspaceMl;            // Filled before the pressure builds
+  double complianceMlPerBar;     // Volume stored per bar once filled
+  double puckResistanceBarSPerMl; // Fresh puck: bar per ml/s of flow
+  double puckErosionMl;          // Resistance halves its erodible part per this much water
+  double puckErodibleFraction;   // Share of the resistance that erodes away
+  double opvBar;                 // Over-pressure valve opens above this
+  double opvMlPerSPerBar;
+  double rippleBar;              // 50 Hz pump ripple amplitude at full stroke
+};
+
+class HydraulicModel {
+public:
+  explicit HydraulicModel(const HydraulicModelParams& params = HydraulicModelParams());
+
+  void reset(); // Empty headspace, fresh puck, pump stopped
+  void setPumpRunning(bool running) { _pumpRunning = running; } // Brew switch
+  void setPowerPercent(double percent) { _powerPercent = percent; } // Dimmer
+  void scalePuckResistance(double factor) { _puckScale *= factor; } // Coarser grind, channeling
+
+  void step(double dtSeconds); // Integrate forward (use dt <= 0.001 s for the ripple)
+
+  double pressureBar() const;         // Without the ripple
+  double sensorPressureBar() const;   // What the transducer sees (with the ripple)
+  double puckFlowMlPerS() const;
+  double cupVolumeMl() const { return _cupVolumeMl; }
+  const HydraulicModelParams& params() const { return _params; }
+
+private:
+  double puckResistance() const;
+
+  HydraulicModelParams _params;
+  bool _pumpRunning;
+  double _powerPercent;
+  double _stroke;     // 0..1
+  double _storedMl;   // Water in headspace and compliance
+  double _cupVolumeMl;
+  double _puckScale;
+  double _timeS;
+};
+
+#endif // HYDRAULIC_MODEL_H
@@ -0,0 +1,91 @@
+#ifndef SIM_PLATFORM_H
+#define SIM_PLATFORM_H
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "BoilerModel.h"
+#include "ControlPlatform.h"
+
+// --- Simulated Platform ---
+// Virtual-time implementations of the control core's hardware interfaces.
+
+class SimClock : public Clock {
+public:
+  SimClock() : _nowMs(0) {}
+  unsigned long millis() override { return _nowMs; }
+  unsigned long now() const { return _nowMs; }
+  void advance(unsigned long ms) { _nowMs += ms; }
+
+private:
+  unsigned long _nowMs;
+};
+
+// MAX6675-like reading of the model's sensor node: Gaussian noise and 0.25 C quantization.
+class SimThermocouple : public TemperatureSensor {
+public:
+  SimThermocouple(const BoilerModel& model, double noiseStdDevC = 0.15)
+      : _model(model), _noiseStdDevC(noiseStdDevC), _failed(false) {}
+
+  double readCelsius() override {
+    if (_failed) {
+      return NAN;
+    }
+    double reading = _model.sensorTempC() + gaussian() * _noiseStdDevC;
+    return floor(reading * 4.0 + 0.5) / 4.0;
+  }
+
+  void setFailed(bool failed) { _failed = failed; } // Simulates an open thermocouple
+
+private:
+  double gaussian() {
+    // Box-Muller, deterministic through rand() so runs are reproducible with srand()
+    double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+  }
+
+  const BoilerModel& _model;
+  double _noiseStdDevC;
+  bool _failed;
+};
+
+class SimRelay : public Relay {
+public:
+  explicit SimRelay(BoilerModel& model) : _model(model), _on(false), _toggles(0) {}
+
+  void set(bool on) override {
+    if (on != _on) {
+      _toggles++;
+    }
+    _on = on;
+    _model.setHeaterRelay(on);
+  }
+
+  bool isOn() const { return _on; }
+  unsigned long toggles() const { return _toggles; }
+
+private:
+  BoilerModel& _model;
+  bool _on;
+  unsigned long _toggles;
+};
+
+class SimEvents : public ControlEvents {
+public:
+  SimEvents(const SimClock& clock, bool verbose) : _clock(clock), _verbose(verbose) {}
+
+  void log(const char* message) override {
+    if (_verbose) {
+      printf("[%9.1fs] %s\n", _clock.now() / 1000.0, message);
+    }
+  }
+  void status(const char* message) override { (void)message; }
+
+private:
+  const SimClock& _clock;
+  bool _verbose;
+};
+
+#endif // SIM_PLATFORM_H
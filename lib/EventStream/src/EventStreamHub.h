@@ -0,0 +1,150 @@
+#ifndef EVENT_STREAM_HUB_H
+#define EVENT_STREAM_HUB_H
+
+#include <stddef.h>
+#include <string.h>
+
+// --- Server-Sent Events Hub ---
+// Fans frames out to up to MAX_CLIENTS long-lived connections without ever blocking the
+// caller. Each client owns one frame-sized outbound slot: a frame that the socket does not
+// take completely stays in the slot and is finished by later publish()/service() calls.
+// While a client's slot is still busy, new frames are skipped for that client only
+// (back-pressure), so a slow viewer sees a lower rate of current frames instead of a
+// growing backlog, and never delays the others. A client that makes no progress for
+// stallTimeoutMs is disconnected.
+//
+// Transport is a small value type (copyable, default-constructible) with
+//   int send(const char* data, size_t length); // Bytes taken, 0 if it would block, -1 if closed
+//   void close();
+template <typename Transport, size_t MAX_CLIENTS, size_t FRAME_CAPACITY>
+class EventStreamHub {
+public:
+  struct ClientStats {
+    bool active;
+    unsigned long framesSent;
+    unsigned long framesSkipped; // Not sent because the previous frame was still pending
+  };
+
+  explicit EventStreamHub(unsigned long stallTimeoutMs) : _stallTimeoutMs(stallTimeoutMs), _disconnects(0) {
+    for (size_t i = 0; i < MAX_CLIENTS; i++) _clients[i].active = false;
+  }
+
+  // Takes over a new connection and queues `greeting` (the HTTP response header) as its
+  // first frame. False if all slots are taken or the greeting does not fit; the caller
+  // keeps ownership of the transport then.
+  bool accept(const Transport& transport, const char* greeting, size_t length, unsigned long nowMs) {
+    if (length > FRAME_CAPACITY) return false;
+    for (size_t i = 0; i < MAX_CLIENTS; i++) {
+      Client& client = _clients[i];
+      if (client.active) continue;
+      client.transport = transport;
+      client.active = true;
+      client.pendingLength = 0;
+      client.pendingOffset = 0;
+      client.framesSent = 0;
+      client.framesSkipped = 0;
+      client.lastProgressMs = nowMs;
+      queue(client, greeting, length);
+      flush(client, nowMs);
+      return true;
+    }
+    return false;
+  }
+
+  // Offers one complete event (e.g. "data: {...}\n\n") to every client. Frames longer than
+  // FRAME_CAPACITY are dropped for everyone.
+  void publish(const char* frame, size_t length, unsigned long nowMs) {
+    if (length > FRAME_CAPACITY) return;
+    for (size_t i = 0; i < MAX_CLIENTS; i++) {
+      Client& client = _clients[i];
+      if (!client.active) continue;
+      flush(client, nowMs);
+      if (!client.active) continue;
+      if (client.pendingOffset < client.pendingLength) {
+        client.framesSkipped++;
+        continue;
+      }
+      queue(client, frame, length);
+      flush(client, nowMs);
+    }
+  }
+
+  // Continues partial frames and drops stalled or closed clients. Call often (every loop).
+  void service(unsigned long nowMs) {
+    for (size_t i = 0; i < MAX_CLIENTS; i++) {
+      if (_clients[i].active) flush(_clients[i], nowMs);
+    }
+  }
+
+  // Closes every connection (network down). Not counted in disconnects().
+  void closeAll() {
+    for (size_t i = 0; i < MAX_CLIENTS; i++) {
+      if (_clients[i].active) release(_clients[i]);
+    }
+  }
+
+  size_t clientCount() const {
+    size_t count = 0;
+    for (size_t i = 0; i < MAX_CLIENTS; i++) count += _clients[i].active ? 1 : 0;
+    return count;
+  }
+  ClientStats stats(size_t slot) const {
+    ClientStats result = {_clients[slot].active, _clients[slot].framesSent, _clients[slot].framesSkipped};
+    return result;
+  }
+  unsigned long disconnects() const { return _disconnects; } // Closed by the peer or stalled
+  static size_t capacity() { return MAX_CLIENTS; }
+
+private:
+  struct Client {
+    Transport transport;
+    bool active;
+    char pending[FRAME_CAPACITY];
+    size_t pendingLength;
+    size_t pendingOffset;
+    unsigned long lastProgressMs;
+    unsigned long framesSent;
+    unsigned long framesSkipped;
+  };
+
+  void queue(Client& client, const char* data, size_t length) {
+    memcpy(client.pending, data, length);
+    client.pendingLength = length;
+    client.pendingOffset = 0;
+  }
+
+  void flush(Client& client, unsigned long nowMs) {
+    while (client.pendingOffset < client.pendingLength) {
+      int sent = client.transport.send(client.pending + client.pendingOffset, client.pendingLength - client.pendingOffset);
+      if (sent < 0) {
+        drop(client);
+        return;
+      }
+      if (sent == 0) {
+        if (nowMs - client.lastProgressMs >= _stallTimeoutMs) drop(client);
+        return;
+      }
+      client.pendingOffset += (size_t)sent;
+      client.lastProgressMs = nowMs;
+      if (client.pendingOffset == client.pendingLength) client.framesSent++;
+    }
+    client.lastProgressMs = nowMs; // Idle with nothing to send is not a stall
+  }
+
+  void drop(Client& client) {
+    release(client);
+    _disconnects++;
+  }
+
+  void release(Client& client) {
+    client.transport.close();
+    client.transport = Transport();
+    client.active = false;
+  }
+
+  unsigned long _stallTimeoutMs;
+  unsigned long _disconnects;
+  Client _clients[MAX_CLIENTS];
+};
+
+#endif // EVENT_STREAM_HUB_H
@@ -0,0 +1,35 @@
+#ifndef CONTROL_PLATFORM_H
+#define CONTROL_PLATFORM_H
+
+// --- Hardware Abstraction for the Control Core ---
+// The control library never calls millis(), digitalWrite() or the MAX6675 driver
+// directly. The firmware passes Arduino-backed implementations, the native build
+// passes simulated ones (see lib/BoilerSim).
+
+class Clock {
+public:
+  virtual ~Clock() {}
+  virtual unsigned long millis() = 0; // Monotonic milliseconds, wraps like Arduino millis()
+};
+
+class TemperatureSensor {
+public:
+  virtual ~TemperatureSensor() {}
+  virtual double readCelsius() = 0; // Raw thermocouple reading, NAN on read failure
+};
+
+class Relay {
+public:
+  virtual ~Relay() {}
+  virtual void set(bool on) = 0; // true = heater powered
+};
+
+// Human-readable output of the controller: serial log lines and the short OLED status.
+class ControlEvents {
+public:
+  virtual ~ControlEvents() {}
+  virtual void log(const char* message) = 0;
+  virtual void status(const char* message) = 0;
+};
+
+#endif // CONTROL_PLATFORM_H
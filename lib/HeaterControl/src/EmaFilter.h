@@ -0,0 +1,42 @@
+#ifndef EMA_FILTER_H
+#define EMA_FILTER_H
+
+#include <math.h>
+
+#include "SensorScalar.h"
+
+// --- EMA (Exponential Moving Average) ---
+// Smaller alpha = more smoothing. Alpha = 2 / (N+1) where N is the SMA equivalent.
+// Computes in Scalar (SensorScalar: float, or Q16.16 with SENSOR_FIXED_POINT).
+template <typename Scalar>
+class BasicEmaFilter {
+public:
+  explicit BasicEmaFilter(float alpha)
+      : _alpha(alpha), _oneMinusAlpha(1.0f - alpha), _value(0), _hasValue(false) {}
+
+  Scalar update(Scalar sample) {
+    if (!_hasValue) { // First valid reading or after a reset
+      _value = sample;
+      _hasValue = true;
+    } else {
+      // EMA_new = alpha * new_value + (1 - alpha) * EMA_old
+      _value = (_alpha * sample) + (_oneMinusAlpha * _value);
+    }
+    return _value;
+  }
+
+  void reset() { _hasValue = false; }
+  bool hasValue() const { return _hasValue; }
+  Scalar current() const { return _value; } // Valid once hasValue()
+  double value() const { return _hasValue ? (double)_value : NAN; } // NAN until the first sample
+
+private:
+  Scalar _alpha;
+  Scalar _oneMinusAlpha;
+  Scalar _value;
+  bool _hasValue;
+};
+
+typedef BasicEmaFilter<SensorScalar> EmaFilter;
+
+#endif // EMA_FILTER_H
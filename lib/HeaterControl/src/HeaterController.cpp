@@ -0,0 +1,865 @@
+#include "HeaterController.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+const char* controlModeName(ControlMode mode) {
+  switch (mode) {
+    case CONTROL_MODE_PID: return "pid";
+    case CONTROL_MODE_MPC: return "mpc";
+    default: return "burst";
+  }
+}
+
+bool parseControlMode(const char* name, ControlMode& mode) {
+  if (strcmp(name, "burst") == 0) mode = CONTROL_MODE_BURST;
+  else if (strcmp(name, "pid") == 0) mode = CONTROL_MODE_PID;
+  else if (strcmp(name, "mpc") == 0) mode = CONTROL_MODE_MPC;
+  else return false;
+  return true;
+}
+
+const char* temperatureEstimatorName(TemperatureEstimator estimator) {
+  return estimator == TEMP_ESTIMATOR_KALMAN ? "kalman" : "ema";
+}
+
+bool parseTemperatureEstimator(const char* name, TemperatureEstimator& estimator) {
+  if (strcmp(name, "ema") == 0) estimator = TEMP_ESTIMATOR_EMA;
+  else if (strcmp(name, "kalman") == 0) estimator = TEMP_ESTIMATOR_KALMAN;
+  else return false;
+  return true;
+}
+
+const char* autoTuneStatusName(AutoTuneStatus status) {
+  switch (status) {
+    case AUTOTUNE_WAITING: return "waiting";
+    case AUTOTUNE_RUNNING: return "running";
+    case AUTOTUNE_DONE: return "done";
+    case AUTOTUNE_FAILED: return "failed";
+    default: return "off";
+  }
+}
+
+HeaterControllerConfig::HeaterControllerConfig()
+    : tempReadIntervalMs(500),
+      standbyReadIntervalMs(2000),
+      temperatureEstimator(TEMP_ESTIMATOR_KALMAN),
+      tempEmaAlpha(0.07f),
+      controlMode(CONTROL_MODE_BURST),
+      heaterSecondsPerDegreeC(2.0f),
+      maxHeaterOnDurationMs(70 * 1000),
+      burstPauseMs(5 * 1000),
+      heatTriggerBelowDesiredC(0.5),
+      controlWindowMs(2000),
+      minRelaySwitchMs(200),
+      regulationEmaAlpha(0.3f),
+      mpcHorizonS(120.0f),
+      autoTuneRelayDuty(0.25f),
+      autoTuneHysteresisC(0.3),
+      autoTuneCycles(6),
+      autoTuneMaxDurationMs(30 * 60 * 1000),
+      autoTuneStartBandC(1.0),
+      autoTuneAbortBandC(5.0),
+      settledTempRiseMaxC(0.3),
+      settledObservationPeriodMs(10 * 1000),
+      earlyCutoffTempC(76.0),
+      earlyCutoffMinBurstMs(30 * 1000),
+      earlyCutoffCooldownMs(60 * 1000),
+      presumedOffTempThresholdC(86.0f),
+      presumedOffDurationMs(3 * 60 * 1000),
+      presumedOffCheckIntervalMs(10000),
+      powerOnRateThresholdCPerS(0.1f),
+      maxConsecutiveHeatingFailures(5),
+      tempDiffThresholdForHeatingFailure(5.0f) {
+  // Gains and model match the seconds-per-degree above: ~0.5 C/s at full power and a
+  // ~12 s from element to smoothed reading. Tuned with the native simulator (--compare).
+  pidGains.kp = 0.12f;
+  pidGains.ki = 0.0005f;
+  pidGains.kd = 2.0f;
+  pidGains.derivativeFilterS = 4.0f;
+  thermalModel.gainC = 2400.0f;
+  thermalModel.timeConstantS = 4800.0f;
+  thermalModel.deadTimeS = 12.0f;
+  thermalModel.ambientC = 22.0f;
+  // MAX6675: ~0.15 C noise plus 0.25 C steps. Process noise tuned with `program estimator`.
+  kalmanTuning.measurementNoiseC = 0.2f;
+  kalmanTuning.temperatureProcessNoise = 0.002f;
+  kalmanTuning.loadProcessNoise = 0.0002f;
+}
+
+HeaterController::HeaterController(Clock& clock, TemperatureSensor& sensor, Relay& relay, ControlEvents& events,
+                                   const TemperatureCalibration& calibration, const HeaterControllerConfig& config)
+    : _clock(clock),
+      _sensor(sensor),
+      _relay(relay),
+      _events(events),
+      _calibration(calibration),
+      _config(config),
+      _health(config.sensorHealth),
+      _degradedSinceMs(0),
+      _ema(config.tempEmaAlpha),
+      _regulationEma(config.regulationEmaAlpha),
+      _kalman(config.thermalModel, config.tempReadIntervalMs / 1000.0f, config.kalmanTuning),
+      _lastTempReadTime(0),
+      _lastValidTempReadTime(0),
+      _lastUpdateTime(0),
+      _heaterOnMsSinceRead(0),
+      _state(IDLE),
+      _desiredTemperatureC(90.0),
+      _isRelayOn(false),
+      _heaterStopTimeMs(0),
+      _burstPauseStartMs(0),
+      _lastCalculatedHeatDurationMs(0),
+      _controlMode(config.controlMode),
+      _pid(config.pidGains, 0.0f, 1.0f),
+      _mpc(config.thermalModel, config.controlWindowMs / 1000.0f, config.mpcHorizonS),
+      _duty(0.0f),
+      _windowStartMs(0),
+      _windowOnTimeMs(0),
+      _dutyCarryMs(0),
+      _relayOnSinceMs(0),
+      _estimator(config.controlWindowMs / 1000.0f, config.thermalModel.ambientC),
+      _autoTuneStatus(AUTOTUNE_OFF),
+      _autoTuneHeating(false),
+      _autoTuneCycleCount(0),
+      _autoTuneStartMs(0),
+      _autoTuneResultPending(false),
+      _hasIdentifiedModel(false),
+      _settlingCheckStartTimeMs(0),
+      _tempAtSettlingCheckStartC(0.0),
+      _inEarlyCutoffCooldown(false),
+      _earlyCutoffCooldownEndTime(0),
+      _machineIsPresumedOff(false),
+      _lowPower(false),
+      _presumedOffEvent(false),
+      _isMonitoringForMachineOff(false),
+      _machineOffMonitorStartTime(0),
+      _lastTempDuringMachineOffMonitoring(100.0f),
+      _lastMachineOffCheckTimestamp(0),
+      _consecutiveFailedHeatingAttempts(0) {}
+
+void HeaterController::begin() {
+  setRelay(false); // Heater OFF
+  _state = IDLE;
+}
+
+void HeaterController::setDesiredTemperature(double desiredTempC) {
+  if (_autoTuneStatus == AUTOTUNE_RUNNING && desiredTempC != _desiredTemperatureC) {
+    cancelAutoTune(); // The experiment is only valid around one set point
+  }
+  _desiredTemperatureC = desiredTempC;
+  if (_consecutiveFailedHeatingAttempts > 0) {
+    logf("User set new temp, consecutive heating failures reset.");
+  }
+  _consecutiveFailedHeatingAttempts = 0; // Reset on user temp change
+  logf("Desired temperature set to: %.1f", _desiredTemperatureC);
+
+  // If user sets a new active temperature while in standby, exit standby.
+  if (_machineIsPresumedOff && desiredTempC >= _config.presumedOffTempThresholdC) {
+    _machineIsPresumedOff = false;
+    _isMonitoringForMachineOff = false; // Ensure this is also reset
+    logf("User set new active temperature. Exiting machine presumed off standby.");
+    statusf("User: Active Temp");
+  }
+  // If user sets a low temperature while monitoring, stop monitoring.
+  if (_isMonitoringForMachineOff && desiredTempC < _config.presumedOffTempThresholdC) {
+    _isMonitoringForMachineOff = false;
+    logf("User set low temperature. Stopped monitoring for presumed machine off.");
+    statusf("User: Low Temp Set");
+  }
+}
+
+void HeaterController::setControlMode(ControlMode mode) {
+  if (mode == _controlMode) {
+    return;
+  }
+  _controlMode = mode;
+  logf("Control mode set to: %s", controlModeName(mode));
+  statusf("Mode: %s", controlModeName(mode));
+
+  // Hand over from a running burst or duty window; the new mode starts from IDLE
+  if (_state == HEATING || _state == REGULATING) {
+    setRelay(false);
+    _state = IDLE;
+  }
+  _duty = 0.0f;
+}
+
+bool HeaterController::takePresumedOffEvent() {
+  bool event = _presumedOffEvent;
+  _presumedOffEvent = false;
+  return event;
+}
+
+void HeaterController::update() {
+  unsigned long currentMillis = _clock.millis();
+  accumulateHeaterTime(currentMillis);
+  readTemperature(currentMillis);
+
+  // Faulted thermocouple: nothing for the state machine to work on
+  if (!_health.isHealthy()) {
+    if (_state != DEGRADED) {
+      enterDegraded(currentMillis);
+    }
+    setRelay(false); // Until the sensor recovers
+    return;
+  }
+  if (_state == DEGRADED) {
+    leaveDegraded();
+  }
+
+  // Only run the state machine if the smoothed temperature is a valid number
+  double smoothedTempC = smoothedTemperature();
+  if (isnan(smoothedTempC)) {
+    return;
+  }
+
+  switch (_state) {
+    case IDLE:
+      runIdle(currentMillis, smoothedTempC);
+      break;
+    case HEATING:
+      runHeating(currentMillis, smoothedTempC);
+      break;
+    case SETTLING:
+      runSettling(currentMillis, smoothedTempC);
+      break;
+    case REGULATING:
+      runRegulating(currentMillis, smoothedTempC);
+      break;
+    case AUTOTUNING:
+      runAutoTune(currentMillis, smoothedTempC);
+      break;
+    case DEGRADED: // Left above
+      break;
+  }
+}
+
+double HeaterController::smoothedTemperature() const {
+  return _config.temperatureEstimator == TEMP_ESTIMATOR_KALMAN ? _kalman.value() : _ema.value();
+}
+
+// PID/MPC input: the Kalman estimate already has little lag, the EMA needs the lighter
+// regulation filter
+double HeaterController::regulationTemperature() const {
+  return _config.temperatureEstimator == TEMP_ESTIMATOR_KALMAN ? _kalman.value() : _regulationEma.value();
+}
+
+// Heater on-time since the previous update(), the Kalman filter's control input. In
+// presumed-off standby the relay is on but the machine has no power, so no heat goes in.
+void HeaterController::accumulateHeaterTime(unsigned long currentMillis) {
+  if (_isRelayOn && !_machineIsPresumedOff) {
+    _heaterOnMsSinceRead += currentMillis - _lastUpdateTime;
+  }
+  _lastUpdateTime = currentMillis;
+}
+
+// A cold, unpowered boiler changes slowly enough for the standby rate; the Kalman filter
+// takes the longer step as it comes, so its dT/dt still catches the machine switching on.
+unsigned long HeaterController::readIntervalMs() const {
+  return _lowPower && _machineIsPresumedOff ? _config.standbyReadIntervalMs : _config.tempReadIntervalMs;
+}
+
+void HeaterController::readTemperature(unsigned long currentMillis) {
+  if (currentMillis - _lastTempReadTime < readIntervalMs()) {
+    return; // Not time to read, keep the last smoothed value
+  }
+  _lastTempReadTime = currentMillis;
+
+  double rawTempC = _sensor.readCelsius();
+  bool wasHealthy = _health.isHealthy();
+  bool heaterOn = _isRelayOn && !_machineIsPresumedOff; // As accumulateHeaterTime()
+  if (!_health.update(currentMillis, rawTempC, heaterOn)) {
+    if (wasHealthy && _health.isHealthy()) { // Rejected, not (yet) a fault; faults log once
+      if (isnan(rawTempC)) {
+        logf("Failed to read from thermocouple sensor!");
+        statusf("Thermo Err");
+      } else {
+        logf("Implausible thermocouple reading %.2fC ignored", rawTempC);
+      }
+    }
+    return; // Estimates keep their last value
+  }
+  if (!wasHealthy) {
+    // Recovered: start over from the new readings, not from where the fault left off
+    _ema.reset();
+    _regulationEma.reset();
+    _kalman.reset();
+  }
+  SensorScalar calibratedTempC = _calibration.apply(SensorScalar(rawTempC));
+  _ema.update(calibratedTempC);
+  _regulationEma.update(calibratedTempC);
+
+  unsigned long elapsedMs = currentMillis - _lastValidTempReadTime;
+  float heaterDuty = elapsedMs > 0 ? (float)_heaterOnMsSinceRead / elapsedMs : 0.0f;
+  if (heaterDuty > 1.0f) heaterDuty = 1.0f;
+  _kalman.update((float)(double)calibratedTempC, heaterDuty, elapsedMs / 1000.0f);
+  _lastValidTempReadTime = currentMillis;
+  _heaterOnMsSinceRead = 0;
+}
+
+void HeaterController::runIdle(unsigned long currentMillis, double smoothedTempC) {
+  // --- Early Cutoff Cooldown Check ---
+  if (_inEarlyCutoffCooldown) {
+    if (currentMillis >= _earlyCutoffCooldownEndTime) {
+      _inEarlyCutoffCooldown = false; // Cooldown finished
+      logf("IDLE: Early cutoff cooldown finished.");
+      statusf("Cooldown Over");
+    } else {
+      return; // Skip heating checks during cooldown
+    }
+  }
+
+  // --- Machine Presumed Off Logic ---
+  if (_machineIsPresumedOff) {
+    setRelay(true); // Keep relay ON in standby
+
+    // Standby feeds the filter no heat, so a rise is heat the model did not expect
+    if (_kalman.rate() > _config.powerOnRateThresholdCPerS) { // e.g. machine turned on
+      _machineIsPresumedOff = false;
+      _isMonitoringForMachineOff = false; // Reset monitoring flag
+      if (_consecutiveFailedHeatingAttempts > 0) {
+        logf("Machine power detected, consecutive heating failures reset.");
+      }
+      _consecutiveFailedHeatingAttempts = 0; // Reset on machine power detection
+      logf("Machine power detected (temp rise rate %.2fC/s). Exiting standby, resuming normal control.",
+           _kalman.rate());
+      statusf("Machine On");
+    }
+    return; // In presumed off mode, skip normal IDLE heating logic
+  }
+
+  // Normal IDLE state operation (not in cooldown, not in presumed off)
+  monitorForMachineOff(currentMillis, smoothedTempC);
+  if (_machineIsPresumedOff) {
+    return;
+  }
+
+  if (autoTuneShouldStart(smoothedTempC)) {
+    startAutoTuneExperiment(currentMillis);
+    return;
+  }
+
+  if (_controlMode != CONTROL_MODE_BURST) {
+    startRegulating(currentMillis, smoothedTempC);
+    runRegulating(currentMillis, smoothedTempC);
+    return;
+  }
+
+  // Allow heating even if monitoring, as long as not yet presumed off.
+  // Check if temperature has dropped enough below desired to start heating.
+  double tempDifferenceToDesired = _desiredTemperatureC - smoothedTempC;
+  if (tempDifferenceToDesired >= _config.heatTriggerBelowDesiredC) {
+    logf("IDLE: Triggering heat. Current T: %.1fC, Desired T: %.1fC.", smoothedTempC, _desiredTemperatureC);
+    statusf("Heating...");
+
+    unsigned long calculatedHeatDurationMs =
+        (unsigned long)(tempDifferenceToDesired * _config.heaterSecondsPerDegreeC * 1000.0f);
+
+    if (calculatedHeatDurationMs > _config.maxHeaterOnDurationMs) {
+      calculatedHeatDurationMs = _config.maxHeaterOnDurationMs;
+      logf("Heater duration capped by MAX_HEATER_ON_DURATION_MS");
+    }
+    if (calculatedHeatDurationMs < 2000 && tempDifferenceToDesired > 0.1) { // Min 2 sec heating if meaningfully below
+      calculatedHeatDurationMs = 2000;
+    }
+
+    if (calculatedHeatDurationMs >= 2000) { // Only heat if duration is meaningful
+      setRelay(true); // Heater ON
+      _relayOnSinceMs = currentMillis;
+      _state = HEATING;
+      _heaterStopTimeMs = currentMillis + calculatedHeatDurationMs;
+      _lastCalculatedHeatDurationMs = calculatedHeatDurationMs; // Store for early cutoff logic
+      logf("Calculated heat duration: %.1fs. State: HEATING", calculatedHeatDurationMs / 1000.0f);
+    }
+  }
+}
+
+void HeaterController::monitorForMachineOff(unsigned long currentMillis, double smoothedTempC) {
+  // Start/Continue Monitoring Condition:
+  // Monitor if current temp is below threshold AND system is trying to maintain a temp at or above threshold
+  if (smoothedTempC < _config.presumedOffTempThresholdC && _desiredTemperatureC >= _config.presumedOffTempThresholdC) {
+    if (!_isMonitoringForMachineOff) { // Start of monitoring
+      _isMonitoringForMachineOff = true;
+      _machineOffMonitorStartTime = currentMillis;
+      _lastTempDuringMachineOffMonitoring = smoothedTempC;
+      _lastMachineOffCheckTimestamp = currentMillis;
+      logf("Temp < THRESHOLD & desired is high. Starting to monitor for presumed machine off.");
+      statusf("Monitoring Power...");
+      _health.resetHeatConfirmation(); // Until a rise shows the element has power
+      // Monitoring restarts after every settled burst, and IDLE starts the next burst in the
+      // same pass, so the failure count has to be acted on here or never
+      if (_consecutiveFailedHeatingAttempts >= _config.maxConsecutiveHeatingFailures) {
+        enterPresumedOff(true);
+      }
+    } else if (currentMillis - _lastMachineOffCheckTimestamp >= _config.presumedOffCheckIntervalMs) {
+      if (smoothedTempC <= _lastTempDuringMachineOffMonitoring) { // Temp is decreasing or stable
+        _lastTempDuringMachineOffMonitoring = smoothedTempC;
+        bool tempLowForDuration = (currentMillis - _machineOffMonitorStartTime >= _config.presumedOffDurationMs);
+        bool maxFailuresReached = (_consecutiveFailedHeatingAttempts >= _config.maxConsecutiveHeatingFailures);
+
+        if (tempLowForDuration || maxFailuresReached) {
+          enterPresumedOff(maxFailuresReached);
+        }
+        // else, still waiting for the presumed off duration to elapse
+      } else { // Temp has increased while monitoring below threshold
+        _isMonitoringForMachineOff = false; // Machine activity detected, stop monitoring
+        logf("Temp increased while monitoring for presumed off. Resetting monitoring.");
+        statusf("Monitoring Halted");
+      }
+      _lastMachineOffCheckTimestamp = currentMillis; // Reset check interval timestamp
+    }
+  } else if (_isMonitoringForMachineOff) {
+    // Condition no longer met (temp rose above threshold, or desired temp was lowered below threshold)
+    _isMonitoringForMachineOff = false;
+    logf("Monitoring condition (temp < THRESHOLD or desired >= THRESHOLD) no longer met. Stopped monitoring.");
+    statusf("Monitoring Stopped");
+  }
+}
+
+void HeaterController::enterPresumedOff(bool maxFailuresReached) {
+  _machineIsPresumedOff = true;
+  _presumedOffEvent = true;            // Signal client for plot reset
+  _isMonitoringForMachineOff = false;  // Stop monitoring once presumed off
+
+  if (maxFailuresReached) {
+    logf("Max heating failures reached. Machine presumed off due to heating issues.");
+    statusf("Err: Heat Fail");
+  } else {
+    logf("Temp consistently low for PRESUMED_OFF_DURATION_MS. Machine presumed off.");
+    statusf("Machine Off. Relay On");
+  }
+
+  // Ensure heater is ON when machine is presumed off
+  setRelay(true);
+  logf("IDLE: Heater activated for presumed machine off state.");
+}
+
+void HeaterController::runHeating(unsigned long currentMillis, double smoothedTempC) {
+  // Early cutoff for long heating cycles if temp reaches the early cutoff temperature
+  if (_lastCalculatedHeatDurationMs > _config.earlyCutoffMinBurstMs && smoothedTempC >= earlyCutoffTemperature()) {
+    startEarlyCutoff(currentMillis, smoothedTempC);
+    return;
+  }
+
+  // A burst extended below the early cutoff temperature can outlast maxHeaterOnDurationMs
+  // (a cold start); it then runs in segments of at most that length with the relay off for
+  // burstPauseMs in between, which keeps every on period inside the safety watchdog's limit
+  if (!_isRelayOn) {
+    if (currentMillis - _burstPauseStartMs < _config.burstPauseMs) {
+      return; // Pausing between segments (the relay is only off in HEATING for a pause)
+    }
+    setRelay(true);
+    _relayOnSinceMs = currentMillis;
+  } else if (currentMillis - _relayOnSinceMs >= _config.maxHeaterOnDurationMs && currentMillis < _heaterStopTimeMs) {
+    setRelay(false);
+    _burstPauseStartMs = currentMillis;
+    _heaterStopTimeMs += _config.burstPauseMs; // The pause is not heating time
+    logf("HEATING: On for MAX_HEATER_ON_DURATION_MS, pausing %.1fs.", _config.burstPauseMs / 1000.0f);
+    statusf("Heating (pause)");
+    return;
+  }
+
+  if (currentMillis < _heaterStopTimeMs) {
+    return; // Burst still running
+  }
+
+  // Timer is up: continue if still below the early cutoff threshold AND below desired temp,
+  // and only once the reading has shown the heat arriving (not a switched-off machine or a
+  // frozen thermocouple, which would otherwise be heated in segments for ever)
+  bool shouldContinueHeating = false;
+  if (smoothedTempC < earlyCutoffTemperature() && _health.heatConfirmed()) {
+    double tempDifferenceToDesired = _desiredTemperatureC - smoothedTempC;
+    // Only continue heating if we are meaningfully below desired temp
+    if (tempDifferenceToDesired > 0.1) {
+      unsigned long remainingHeatDurationMs =
+          (unsigned long)(tempDifferenceToDesired * _config.heaterSecondsPerDegreeC * 1000.0f);
+      if (remainingHeatDurationMs > _config.maxHeaterOnDurationMs) remainingHeatDurationMs = _config.maxHeaterOnDurationMs;
+      if (remainingHeatDurationMs < 1000) { // Min 1 sec more if needed
+        remainingHeatDurationMs = 1000;
+      }
+
+      _heaterStopTimeMs = currentMillis + remainingHeatDurationMs; // Extend heating time
+      _lastCalculatedHeatDurationMs = remainingHeatDurationMs; // Update for next potential early cutoff check
+      shouldContinueHeating = true;
+      logf("HEATING: Timer up, but <EARLY_CUTOFF_TEMP_C & <desired. Continuing for %.1fs more.",
+           remainingHeatDurationMs / 1000.0f);
+      statusf("Heating Cont.");
+    }
+  }
+
+  if (!shouldContinueHeating) {
+    setRelay(false); // Heater OFF
+    // After heating, always go to SETTLING to observe temperature behavior
+    startSettling(currentMillis, smoothedTempC);
+    logf("State: SETTLING. Starting observation.");
+    statusf("Settling...");
+  }
+}
+
+void HeaterController::startRegulating(unsigned long currentMillis, double smoothedTempC) {
+  _state = REGULATING;
+  _pid.reset();
+  _mpc.reset(regulationTemperature());
+  _windowStartMs = currentMillis - _config.controlWindowMs; // First window starts right away
+  _windowOnTimeMs = 0;
+  _dutyCarryMs = 0;
+  logf("IDLE: Closed-loop control (%s). Current T: %.1fC, Desired T: %.1fC. State: REGULATING",
+       controlModeName(_controlMode), smoothedTempC, _desiredTemperatureC);
+  statusf("Regulating (%s)", controlModeName(_controlMode));
+}
+
+float HeaterController::computeDuty() {
+  double regulationTempC = regulationTemperature();
+  if (_controlMode == CONTROL_MODE_MPC) {
+    return _mpc.update(_desiredTemperatureC, regulationTempC);
+  }
+  return _pid.update(_desiredTemperatureC, regulationTempC, _config.controlWindowMs / 1000.0f);
+}
+
+void HeaterController::runRegulating(unsigned long currentMillis, double smoothedTempC) {
+  if (_controlMode == CONTROL_MODE_BURST) { // Mode changed while regulating
+    setRelay(false);
+    _state = IDLE;
+    return;
+  }
+
+  // Same standby detection as IDLE; presumed off is handled there
+  monitorForMachineOff(currentMillis, smoothedTempC);
+  if (_machineIsPresumedOff) {
+    _state = IDLE;
+    return;
+  }
+  if (autoTuneShouldStart(smoothedTempC)) {
+    startAutoTuneExperiment(currentMillis);
+    return;
+  }
+
+  // --- Time-proportional output ---
+  if (windowDue(currentMillis)) {
+    beginWindow(currentMillis, computeDuty());
+  }
+  bool heaterOn = windowHeaterOn(currentMillis);
+
+  // --- Safety envelope (continuous on-time, as for a single burst) ---
+  if (heaterOn) {
+    unsigned long onMs = continuousOnMs(currentMillis, heaterOn);
+    _lastCalculatedHeatDurationMs = onMs;
+    if (onMs > _config.earlyCutoffMinBurstMs && smoothedTempC >= earlyCutoffTemperature()) {
+      startEarlyCutoff(currentMillis, smoothedTempC);
+      return;
+    }
+    if (onMs >= _config.maxHeaterOnDurationMs) {
+      setRelay(false); // Heater OFF
+      logf("Heater duration capped by MAX_HEATER_ON_DURATION_MS");
+      startSettling(currentMillis, smoothedTempC);
+      logf("State: SETTLING. Starting observation.");
+      statusf("Settling...");
+      return;
+    }
+  }
+  setRelay(heaterOn);
+}
+
+void HeaterController::beginWindow(unsigned long currentMillis, float duty) {
+  _windowStartMs = currentMillis;
+  _duty = duty;
+
+  // Pulses shorter than minRelaySwitchMs are dropped (or filled up) and the difference is
+  // carried into the next window, so small duties still average out correctly
+  long windowMs = (long)_config.controlWindowMs;
+  long requestedMs = (long)(_duty * windowMs) + _dutyCarryMs;
+  long onTimeMs = requestedMs;
+  if (onTimeMs < (long)_config.minRelaySwitchMs) onTimeMs = 0;
+  if (onTimeMs > windowMs - (long)_config.minRelaySwitchMs) onTimeMs = windowMs;
+  _dutyCarryMs = requestedMs - onTimeMs;
+  _windowOnTimeMs = (unsigned long)onTimeMs;
+}
+
+unsigned long HeaterController::continuousOnMs(unsigned long currentMillis, bool heaterOn) {
+  if (!heaterOn) {
+    return 0;
+  }
+  if (!_isRelayOn) {
+    _relayOnSinceMs = currentMillis;
+  }
+  return currentMillis - _relayOnSinceMs;
+}
+
+// Delay the smoothing adds to a ramp. The Kalman filter predicts the ramp from the heater
+// input, so it has none to speak of.
+float HeaterController::smoothingLagSeconds() const {
+  if (_config.temperatureEstimator == TEMP_ESTIMATOR_KALMAN) {
+    return 0.0f;
+  }
+  return (_config.tempReadIntervalMs / 1000.0f) * (1.0f - _config.tempEmaAlpha) / _config.tempEmaAlpha;
+}
+
+// Element-to-reading delay seen by the burst logic: model dead time plus the lag of the
+// smoothed temperature it works on
+float HeaterController::burstLagSeconds() const {
+  return _config.thermalModel.deadTimeS + smoothingLagSeconds();
+}
+
+double HeaterController::earlyCutoffTemperature() const {
+  if (!_hasIdentifiedModel) {
+    return _config.earlyCutoffTempC;
+  }
+  // Stop a long burst when the heat still travelling from the element will carry the boiler
+  // to the set point
+  return _desiredTemperatureC - _config.thermalModel.heatingSlopeCPerS() * burstLagSeconds();
+}
+
+unsigned long HeaterController::earlyCutoffCooldownMs() const {
+  if (!_hasIdentifiedModel) {
+    return _config.earlyCutoffCooldownMs;
+  }
+  // The heat in transit has arrived after one lag; SETTLING still confirms the rise stopped
+  unsigned long lagMs = (unsigned long)(burstLagSeconds() * 1000.0f);
+  return lagMs < _config.earlyCutoffCooldownMs ? lagMs : _config.earlyCutoffCooldownMs;
+}
+
+// --- Auto-tune ---
+
+void HeaterController::startAutoTune() {
+  if (_autoTuneStatus == AUTOTUNE_WAITING || _autoTuneStatus == AUTOTUNE_RUNNING) {
+    return;
+  }
+  _autoTuneStatus = AUTOTUNE_WAITING;
+  _autoTuneCycleCount = 0;
+  logf("Auto-tune requested. Starts within %.1fC of the set point.", _config.autoTuneStartBandC);
+  statusf("Autotune: waiting");
+}
+
+void HeaterController::cancelAutoTune() {
+  if (_autoTuneStatus == AUTOTUNE_RUNNING) {
+    setRelay(false);
+    _duty = 0.0f;
+    _state = IDLE;
+  }
+  if (_autoTuneStatus == AUTOTUNE_WAITING || _autoTuneStatus == AUTOTUNE_RUNNING) {
+    _autoTuneStatus = AUTOTUNE_OFF;
+    logf("Auto-tune cancelled.");
+    statusf("Autotune cancelled");
+  }
+}
+
+bool HeaterController::autoTuneShouldStart(double smoothedTempC) const {
+  return _autoTuneStatus == AUTOTUNE_WAITING &&
+         fabs(_desiredTemperatureC - smoothedTempC) <= _config.autoTuneStartBandC;
+}
+
+void HeaterController::startAutoTuneExperiment(unsigned long currentMillis) {
+  _state = AUTOTUNING;
+  _autoTuneStatus = AUTOTUNE_RUNNING;
+  _autoTuneStartMs = currentMillis;
+  _autoTuneHeating = _regulationEma.value() < _desiredTemperatureC;
+  _autoTuneCycleCount = 0;
+  _estimator.reset();
+  setRelay(false);
+  _windowStartMs = currentMillis - _config.controlWindowMs;
+  _windowOnTimeMs = 0;
+  _dutyCarryMs = 0;
+  logf("Auto-tune: relay experiment around %.1fC, duty %.0f%%, %d cycles. State: AUTOTUNING",
+       _desiredTemperatureC, _config.autoTuneRelayDuty * 100.0f, _config.autoTuneCycles);
+  statusf("Autotune 0/%d", _config.autoTuneCycles);
+}
+
+void HeaterController::runAutoTune(unsigned long currentMillis, double smoothedTempC) {
+  // A shot, the machine being switched off or a stuck relay invalidates the experiment
+  if (fabs(smoothedTempC - _desiredTemperatureC) > _config.autoTuneAbortBandC) {
+    logf("Auto-tune: temperature left the set point band (%.1fC). Aborting.", smoothedTempC);
+    finishAutoTune(false);
+    return;
+  }
+  if (currentMillis - _autoTuneStartMs > _config.autoTuneMaxDurationMs) {
+    logf("Auto-tune: no result within the time limit. Aborting.");
+    finishAutoTune(false);
+    return;
+  }
+
+  if (windowDue(currentMillis)) {
+    // One identification sample per window: duty actually applied during the last window
+    float appliedDuty = (float)_windowOnTimeMs / _config.controlWindowMs;
+    double regulationTempC = _regulationEma.value();
+    _estimator.addSample(regulationTempC, appliedDuty);
+
+    // Biased relay with hysteresis around the set point
+    if (_autoTuneHeating && regulationTempC >= _desiredTemperatureC + _config.autoTuneHysteresisC) {
+      _autoTuneHeating = false;
+      _autoTuneCycleCount++;
+      statusf("Autotune %d/%d", _autoTuneCycleCount, _config.autoTuneCycles);
+    } else if (!_autoTuneHeating && regulationTempC <= _desiredTemperatureC - _config.autoTuneHysteresisC) {
+      _autoTuneHeating = true;
+    }
+    if (_autoTuneCycleCount >= _config.autoTuneCycles) {
+      finishAutoTune(true);
+      return;
+    }
+    beginWindow(currentMillis, _autoTuneHeating ? _config.autoTuneRelayDuty : 0.0f);
+  }
+
+  bool heaterOn = windowHeaterOn(currentMillis);
+  if (continuousOnMs(currentMillis, heaterOn) >= _config.maxHeaterOnDurationMs) {
+    logf("Auto-tune: heater on for MAX_HEATER_ON_DURATION_MS. Aborting.");
+    finishAutoTune(false);
+    return;
+  }
+  setRelay(heaterOn);
+}
+
+void HeaterController::finishAutoTune(bool completed) {
+  setRelay(false);
+  _duty = 0.0f;
+  _state = IDLE;
+
+  ThermalModel model = _config.thermalModel;
+  bool identified = completed && _estimator.estimate(model);
+  float slope = identified ? model.heatingSlopeCPerS() : 0.0f;
+  if (identified && slope > 0.05f && slope < 5.0f) {
+    setThermalModel(model);
+    _autoTuneStatus = AUTOTUNE_DONE;
+    _autoTuneResultPending = true;
+    statusf("Autotune done");
+  } else {
+    if (completed) {
+      logf("Auto-tune: model not identifiable from %d samples. Keeping previous settings.",
+           _estimator.sampleCount());
+    }
+    _autoTuneStatus = AUTOTUNE_FAILED;
+    statusf("Autotune failed");
+  }
+}
+
+void HeaterController::setThermalModel(const ThermalModel& model) {
+  // The default PID gains were tuned for the default model; keep the loop gain
+  // (kp * heating slope) the same on a stronger or weaker heater
+  float gainScale = _config.thermalModel.heatingSlopeCPerS() / model.heatingSlopeCPerS();
+  _config.pidGains.kp *= gainScale;
+  _config.pidGains.ki *= gainScale;
+  _config.pidGains.kd *= gainScale;
+  _pid.setGains(_config.pidGains);
+
+  _config.thermalModel = model;
+  _config.heaterSecondsPerDegreeC = 1.0f / model.heatingSlopeCPerS();
+  _mpc.setModel(model);
+  _kalman.setModel(model);
+  _hasIdentifiedModel = true;
+  logf("Thermal model: gain %.0fC, time constant %.0fs, dead time %.0fs (%.2f s/C, early cutoff %.1fC below set).",
+       model.gainC, model.timeConstantS, model.deadTimeS, _config.heaterSecondsPerDegreeC,
+       _desiredTemperatureC - earlyCutoffTemperature());
+}
+
+bool HeaterController::takeAutoTuneResult(ThermalModel& model) {
+  if (!_autoTuneResultPending) {
+    return false;
+  }
+  _autoTuneResultPending = false;
+  model = _config.thermalModel;
+  return true;
+}
+
+void HeaterController::startEarlyCutoff(unsigned long currentMillis, double smoothedTempC) {
+  const char* fromState = (_state == REGULATING) ? "REGULATING" : "HEATING";
+  setRelay(false); // Heater OFF
+  _inEarlyCutoffCooldown = true; // Activate cooldown
+  _earlyCutoffCooldownEndTime = currentMillis + earlyCutoffCooldownMs();
+  startSettling(currentMillis, smoothedTempC);
+  logf("%s: Early cutoff for long heat cycle. Trigger: %.1fC. Current Temp: %.1fC. State: SETTLING.",
+       fromState, earlyCutoffTemperature(), smoothedTempC);
+  statusf("EarlyCutoffSetlng");
+}
+
+void HeaterController::startSettling(unsigned long currentMillis, double smoothedTempC) {
+  _state = SETTLING;
+  _settlingCheckStartTimeMs = currentMillis;
+  _tempAtSettlingCheckStartC = smoothedTempC;
+}
+
+void HeaterController::runSettling(unsigned long currentMillis, double smoothedTempC) {
+  if (currentMillis - _settlingCheckStartTimeMs < _config.settledObservationPeriodMs) {
+    return; // Still in settling period, heater is already off
+  }
+
+  // Observation period ended, check temperature rise
+  double tempRiseDuringObservation = smoothedTempC - _tempAtSettlingCheckStartC;
+  if (tempRiseDuringObservation > _config.settledTempRiseMaxC) {
+    // Temperature still rising too much, restart observation window
+    _settlingCheckStartTimeMs = currentMillis;
+    _tempAtSettlingCheckStartC = smoothedTempC;
+    logf("Temp rise: %.2fC. Not settled. Restarting observation.", tempRiseDuringObservation);
+    statusf("Temp rise.Resettle CHK");
+    return;
+  }
+
+  // Temperature is considered settled
+  _state = IDLE;
+  _isMonitoringForMachineOff = false; // Reset monitoring flag
+  logf("Temp rise: %.2fC. Settled. State: IDLE", tempRiseDuringObservation);
+
+  // Check if heating was successful or if it's a failed attempt
+  if (smoothedTempC < (_desiredTemperatureC - _config.tempDiffThresholdForHeatingFailure)) {
+    _consecutiveFailedHeatingAttempts++;
+    logf("Heating attempt considered failed. Consecutive failures: %d", _consecutiveFailedHeatingAttempts);
+    if (_consecutiveFailedHeatingAttempts >= _config.maxConsecutiveHeatingFailures) {
+      logf("Max heating failures reached. Machine will enter presumed off state.");
+      statusf("Max Heat Fails");
+    } else {
+      statusf("Heat Fail #%d", _consecutiveFailedHeatingAttempts);
+    }
+  } else {
+    if (_consecutiveFailedHeatingAttempts > 0) { // If there were failures, log the reset
+      logf("Heating successful or temp acceptable, consecutive failures reset.");
+    }
+    _consecutiveFailedHeatingAttempts = 0; // Reset on successful/acceptable heating outcome
+    statusf("Idle (Settled)");
+  }
+}
+
+void HeaterController::enterDegraded(unsigned long currentMillis) {
+  SensorFault fault = _health.fault();
+  if (_autoTuneStatus == AUTOTUNE_RUNNING || _autoTuneStatus == AUTOTUNE_WAITING) {
+    cancelAutoTune(); // No valid experiment without the readings
+  }
+  _state = DEGRADED;
+  _degradedSinceMs = currentMillis;
+  _isMonitoringForMachineOff = false;
+  _inEarlyCutoffCooldown = false;
+  _duty = 0.0f;
+  setRelay(false);
+  logf("Thermocouple fault (%s). State: DEGRADED, heater off.", sensorFaultName(fault));
+  statusf("Sensor: %s", sensorFaultName(fault));
+}
+
+void HeaterController::leaveDegraded() {
+  setRelay(false);
+  _duty = 0.0f;
+  _state = IDLE;
+  logf("Thermocouple recovered after %.0fs. State: IDLE", (_clock.millis() - _degradedSinceMs) / 1000.0f);
+  statusf("Sensor OK");
+}
+
+void HeaterController::setRelay(bool on) {
+  _relay.set(on);
+  _isRelayOn = on;
+}
+
+void HeaterController::logf(const char* format, ...) {
+  char message[128];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+  _events.log(message);
+}
+
+void HeaterController::statusf(const char* format, ...) {
+  char message[32];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+  _events.status(message);
+}
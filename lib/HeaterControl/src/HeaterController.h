@@ -0,0 +1,260 @@
+#ifndef HEATER_CONTROLLER_H
+#define HEATER_CONTROLLER_H
+
+#include "ControlPlatform.h"
+#include "EmaFilter.h"
+#include "ModelPredictiveController.h"
+#include "PidController.h"
+#include "SensorHealth.h"
+#include "TemperatureKalmanFilter.h"
+#include "TemperatureCalibration.h"
+#include "ThermalModel.h"
+#include "ThermalModelEstimator.h"
+
+// How the heater output is decided while regulating.
+enum ControlMode {
+  CONTROL_MODE_BURST, // Open-loop burst of (error * seconds-per-degree), then a settling window
+  CONTROL_MODE_PID,   // Discrete PID, time-proportional relay window
+  CONTROL_MODE_MPC    // Model predictive (FOPDT with dead time), time-proportional relay window
+};
+
+const char* controlModeName(ControlMode mode);
+bool parseControlMode(const char* name, ControlMode& mode); // "burst", "pid" or "mpc"
+
+// Where the smoothed temperature the state machine works on comes from.
+enum TemperatureEstimator {
+  TEMP_ESTIMATOR_EMA,   // Exponential moving average of the readings (original firmware)
+  TEMP_ESTIMATOR_KALMAN // Two-state Kalman filter with the heater as input (TemperatureKalmanFilter)
+};
+
+const char* temperatureEstimatorName(TemperatureEstimator estimator);
+bool parseTemperatureEstimator(const char* name, TemperatureEstimator& estimator); // "ema" or "kalman"
+
+enum AutoTuneStatus {
+  AUTOTUNE_OFF,
+  AUTOTUNE_WAITING, // Requested, starts once the boiler is near the set point
+  AUTOTUNE_RUNNING, // Relay experiment in progress
+  AUTOTUNE_DONE,    // Model identified and applied
+  AUTOTUNE_FAILED   // Aborted or not identifiable, previous model kept
+};
+
+const char* autoTuneStatusName(AutoTuneStatus status);
+
+// --- Temperature Control Parameters ---
+// Defaults are the tuned values of the original firmware.
+struct HeaterControllerConfig {
+  HeaterControllerConfig();
+
+  // Temperature reading and smoothing
+  unsigned long tempReadIntervalMs;  // Thermocouple read period
+  unsigned long standbyReadIntervalMs; // Read period in low-power standby (setLowPower())
+  TemperatureEstimator temperatureEstimator; // Source of smoothedTemperature()
+  float tempEmaAlpha;                // Smoothing factor for EMA (smaller = more smoothing)
+  KalmanTuning kalmanTuning;         // Kalman noise parameters, the model is thermalModel
+
+  // Thermocouple faults
+  SensorHealthConfig sensorHealth;   // Fault detection and recovery on the raw readings
+
+  // Controller selection
+  ControlMode controlMode;
+
+  // Heating bursts (CONTROL_MODE_BURST)
+  float heaterSecondsPerDegreeC;     // Approx seconds of heating to raise temp by 1 degree C
+  unsigned long maxHeaterOnDurationMs; // Max heater on time for safety
+  unsigned long burstPauseMs;         // Relay off between the segments of a burst extended past the max
+  double heatTriggerBelowDesiredC;   // IDLE starts heating when this far below desired
+
+  // Closed-loop modes (CONTROL_MODE_PID / CONTROL_MODE_MPC)
+  unsigned long controlWindowMs;     // Time-proportional relay window, duty is recomputed every window
+  unsigned long minRelaySwitchMs;    // Shorter on/off pulses inside a window are dropped
+  float regulationEmaAlpha;          // Lighter smoothing for PID/MPC input (less lag than tempEmaAlpha)
+  PidGains pidGains;
+  ThermalModel thermalModel;         // Boiler model used by the MPC
+  float mpcHorizonS;                 // MPC prediction horizon
+
+  // Auto-tune: relay experiment around the set point, FOPDT model fitted online
+  float autoTuneRelayDuty;           // Heater duty while below the set point (biased relay)
+  double autoTuneHysteresisC;        // Relay switches at set point +/- this
+  int autoTuneCycles;                // Relay cycles to record
+  unsigned long autoTuneMaxDurationMs; // Abort if the experiment takes longer
+  double autoTuneStartBandC;         // Experiment starts once within this of the set point
+  double autoTuneAbortBandC;         // Abort when the temperature leaves set point +/- this (shot, power off)
+
+  // Dynamic settling
+  double settledTempRiseMaxC;        // Max allowed temperature rise during observation to be considered settled
+  unsigned long settledObservationPeriodMs; // Observation window
+  double earlyCutoffTempC;           // Temperature threshold for early cutoff in HEATING state
+  unsigned long earlyCutoffMinBurstMs; // Only bursts longer than this are cut off early
+  unsigned long earlyCutoffCooldownMs; // Mandatory off time after an early cutoff
+
+  // Machine presumed off detection
+  float presumedOffTempThresholdC;   // Temperature below which monitoring for presumed off starts
+  unsigned long presumedOffDurationMs; // Duration for temp to be below threshold AND stable/decreasing
+  unsigned long presumedOffCheckIntervalMs; // Check interval during monitoring
+  float powerOnRateThresholdCPerS;   // Estimated rise rate that signals the machine was switched on
+
+  // Heating failure accounting
+  int maxConsecutiveHeatingFailures;
+  float tempDiffThresholdForHeatingFailure; // Degrees C below desired to count as failure
+};
+
+enum HeaterState { IDLE, HEATING, SETTLING, REGULATING, AUTOTUNING, DEGRADED }; // REGULATING: PID/MPC duty windows
+
+// --- Heater Controller ---
+// The IDLE/HEATING/SETTLING state machine with early cutoff cooldown and presumed-off
+// standby detection. Call update() periodically (the firmware uses a 100 ms control task);
+// it reads the sensor every tempReadIntervalMs and drives the relay (every
+// standbyReadIntervalMs while presumed off with setLowPower()).
+// A burst that is extended while below the early cutoff temperature (a cold start) turns
+// the relay off for burstPauseMs after every maxHeaterOnDurationMs of on-time.
+// The state machine works on an EMA of the readings or on a Kalman estimate that knows the
+// heater input (temperatureEstimator). The Kalman filter always runs: its dT/dt is what
+// detects the machine being switched back on during presumed-off standby.
+// In PID/MPC mode IDLE hands over to REGULATING, which drives the relay with a duty cycle
+// inside the same safety envelope: a continuous on-time above maxHeaterOnDurationMs, or
+// above earlyCutoffMinBurstMs once earlyCutoffTempC is reached, ends in SETTLING (and the
+// early cutoff cooldown) exactly like a long burst does.
+// Auto-tune identifies a first-order-plus-dead-time model of the boiler. Once a model is
+// set (auto-tune or setThermalModel() with persisted values) it replaces the hand-picked
+// seconds-per-degree, early cutoff temperature, PID gains and MPC model.
+// Every reading passes SensorHealth first. While the thermocouple is faulted the state
+// machine is suspended in DEGRADED with the relay off; once the sensor has recovered, the temperature estimate restarts from the new readings and the
+// controller goes back to IDLE.
+class HeaterController {
+public:
+  HeaterController(Clock& clock, TemperatureSensor& sensor, Relay& relay, ControlEvents& events,
+                   const TemperatureCalibration& calibration,
+                   const HeaterControllerConfig& config = HeaterControllerConfig());
+
+  void begin(); // Heater OFF, state IDLE
+  void update();
+
+  // User set point change (web UI). Also resets the failure count and leaves/stops the
+  // presumed-off standby as appropriate.
+  void setDesiredTemperature(double desiredTempC);
+  void setControlMode(ControlMode mode);
+  // Low-power standby: slower thermocouple reads while presumed off. The power-on
+  // detection keeps running on them; leaving presumed off restores the normal rate.
+  void setLowPower(bool lowPower) { _lowPower = lowPower; }
+
+  void startAutoTune();
+  void cancelAutoTune();
+  void setThermalModel(const ThermalModel& model);
+  // True once after auto-tune identified a new model (to persist it).
+  bool takeAutoTuneResult(ThermalModel& model);
+
+  double smoothedTemperature() const; // NAN until the first valid reading (holds while degraded)
+  const SensorHealth& sensorHealth() const { return _health; }
+  double temperatureRate() const { return _kalman.rate(); } // C/s from the Kalman filter, NAN until the first reading
+  TemperatureEstimator temperatureEstimator() const { return _config.temperatureEstimator; }
+  double desiredTemperature() const { return _desiredTemperatureC; }
+  bool isRelayOn() const { return _isRelayOn; }
+  HeaterState state() const { return _state; }
+  ControlMode controlMode() const { return _controlMode; }
+  float duty() const { return _duty; } // Current window duty (PID/MPC), 0..1
+  AutoTuneStatus autoTuneStatus() const { return _autoTuneStatus; }
+  int autoTuneCycleCount() const { return _autoTuneCycleCount; }
+  bool hasIdentifiedModel() const { return _hasIdentifiedModel; }
+  const ThermalModel& thermalModel() const { return _config.thermalModel; }
+  double earlyCutoffTemperature() const;
+  unsigned long earlyCutoffCooldownMs() const;
+  bool isPresumedOff() const { return _machineIsPresumedOff; }
+  unsigned long readIntervalMs() const; // Current thermocouple read period
+  bool isMonitoringForMachineOff() const { return _isMonitoringForMachineOff; }
+  bool inEarlyCutoffCooldown() const { return _inEarlyCutoffCooldown; }
+  int consecutiveFailedHeatingAttempts() const { return _consecutiveFailedHeatingAttempts; }
+  unsigned long lastCalculatedHeatDurationMs() const { return _lastCalculatedHeatDurationMs; }
+  const HeaterControllerConfig& config() const { return _config; }
+
+  // True once after the controller entered presumed-off standby (web client plot reset).
+  bool takePresumedOffEvent();
+
+private:
+  void accumulateHeaterTime(unsigned long currentMillis);
+  void readTemperature(unsigned long currentMillis);
+  double regulationTemperature() const;
+  void runIdle(unsigned long currentMillis, double smoothedTempC);
+  void runHeating(unsigned long currentMillis, double smoothedTempC);
+  void runSettling(unsigned long currentMillis, double smoothedTempC);
+  void monitorForMachineOff(unsigned long currentMillis, double smoothedTempC);
+  void enterPresumedOff(bool maxFailuresReached);
+  void runRegulating(unsigned long currentMillis, double smoothedTempC);
+  void startRegulating(unsigned long currentMillis, double smoothedTempC);
+  float computeDuty();
+  float smoothingLagSeconds() const;
+  float burstLagSeconds() const;
+  void beginWindow(unsigned long currentMillis, float duty);
+  bool windowDue(unsigned long currentMillis) const { return currentMillis - _windowStartMs >= _config.controlWindowMs; }
+  bool windowHeaterOn(unsigned long currentMillis) const { return currentMillis - _windowStartMs < _windowOnTimeMs; }
+  unsigned long continuousOnMs(unsigned long currentMillis, bool heaterOn);
+  bool autoTuneShouldStart(double smoothedTempC) const;
+  void startAutoTuneExperiment(unsigned long currentMillis);
+  void runAutoTune(unsigned long currentMillis, double smoothedTempC);
+  void enterDegraded(unsigned long currentMillis);
+  void leaveDegraded();
+  void finishAutoTune(bool completed);
+  void startEarlyCutoff(unsigned long currentMillis, double smoothedTempC);
+  void startSettling(unsigned long currentMillis, double smoothedTempC);
+  void setRelay(bool on);
+  void logf(const char* format, ...);
+  void statusf(const char* format, ...);
+
+  Clock& _clock;
+  TemperatureSensor& _sensor;
+  Relay& _relay;
+  ControlEvents& _events;
+  const TemperatureCalibration& _calibration;
+  HeaterControllerConfig _config;
+
+  SensorHealth _health;
+  unsigned long _degradedSinceMs;
+  EmaFilter _ema;
+  EmaFilter _regulationEma;
+  TemperatureKalmanFilter _kalman;
+  unsigned long _lastTempReadTime;
+  unsigned long _lastValidTempReadTime;
+  unsigned long _lastUpdateTime;
+  unsigned long _heaterOnMsSinceRead;           // Kalman input: heat delivered since the last valid reading
+
+  HeaterState _state;
+  double _desiredTemperatureC;
+  bool _isRelayOn;
+  unsigned long _heaterStopTimeMs;              // When the heater should turn off (HEATING)
+  unsigned long _burstPauseStartMs;             // Relay off for a pause inside a long burst (HEATING)
+  unsigned long _lastCalculatedHeatDurationMs;  // Last burst length, for early cutoff logic
+
+  ControlMode _controlMode;
+  PidController _pid;
+  ModelPredictiveController _mpc;
+  float _duty;
+  unsigned long _windowStartMs;
+  unsigned long _windowOnTimeMs;                // Relay on time at the start of the current window
+  long _dutyCarryMs;                            // On time dropped by minRelaySwitchMs, owed to later windows
+  unsigned long _relayOnSinceMs;                // Start of the current continuous on period
+
+  ThermalModelEstimator _estimator;
+  AutoTuneStatus _autoTuneStatus;
+  bool _autoTuneHeating;                        // Relay experiment: heating half-cycle
+  int _autoTuneCycleCount;
+  unsigned long _autoTuneStartMs;
+  bool _autoTuneResultPending;
+  bool _hasIdentifiedModel;
+
+  unsigned long _settlingCheckStartTimeMs;      // Start of the current settling observation
+  double _tempAtSettlingCheckStartC;
+
+  bool _inEarlyCutoffCooldown;                  // IDLE is in the mandatory off period
+  unsigned long _earlyCutoffCooldownEndTime;
+
+  bool _machineIsPresumedOff;                   // System believes the main machine power is off
+  bool _lowPower;                               // setLowPower()
+  bool _presumedOffEvent;
+  bool _isMonitoringForMachineOff;              // Actively checking the presumed off duration
+  unsigned long _machineOffMonitorStartTime;
+  float _lastTempDuringMachineOffMonitoring;
+  unsigned long _lastMachineOffCheckTimestamp;
+
+  int _consecutiveFailedHeatingAttempts;
+};
+
+#endif // HEATER_CONTROLLER_H
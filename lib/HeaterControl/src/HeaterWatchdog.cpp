@@ -0,0 +1,159 @@
+#include "HeaterWatchdog.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+const char* watchdogTripName(WatchdogTrip trip) {
+  switch (trip) {
+    case WATCHDOG_ON_TIME: return "on_time";
+    case WATCHDOG_OVER_TEMPERATURE: return "over_temperature";
+    case WATCHDOG_SENSOR_STALE: return "sensor_stale";
+    default: return "ok";
+  }
+}
+
+// Limits the controller never reaches on its own: the relay is on for 70 s at most, the boiler
+// regulates around 90-95 C and the thermocouple is read every 500 ms.
+HeaterWatchdogConfig::HeaterWatchdogConfig()
+    : maxOnTimeMs(90 * 1000),
+      maxTemperatureC(150.0f),
+      temperatureHysteresisC(20.0f),
+      sensorStaleMs(5000),
+      standbyCeilingC(110.0f) {}
+
+HeaterWatchdog::HeaterWatchdog(Clock& clock, Relay& relay, ControlEvents& events, const HeaterWatchdogConfig& config)
+    : _clock(clock),
+      _relay(relay),
+      _events(events),
+      _config(config),
+      _requested(false),
+      _standby(false),
+      _readingC(NAN),
+      _readingMs(0),
+      _trip(WATCHDOG_OK),
+      _lastTrip(WATCHDOG_OK),
+      _onSinceMs(0) {
+  for (int i = 0; i < WATCHDOG_TRIP_COUNT; i++) {
+    _tripCounts[i].store(0);
+  }
+}
+
+void HeaterWatchdog::begin() {
+  unsigned long now = _clock.millis();
+  _requested.store(false);
+  _readingMs.store(now);
+  _onSinceMs = now;
+  _relay.set(false);
+}
+
+void HeaterWatchdog::requestRelay(bool on) {
+  _requested.store(on);
+  // A trip that lands between the check and the write is undone by the next tick()
+  _relay.set(on && _trip.load() == WATCHDOG_OK);
+}
+
+void HeaterWatchdog::reportReading(double tempC) {
+  if (isnan(tempC)) {
+    return;
+  }
+  _readingC.store((float)tempC);
+  _readingMs.store(_clock.millis());
+}
+
+void HeaterWatchdog::setStandby(bool presumedOff) {
+  _standby.store(presumedOff);
+}
+
+void HeaterWatchdog::tick() {
+  // The reading's stamp is loaded before the clock is read, so it is never later than `now`
+  // and the unsigned age cannot underflow into "stale". The firmware pins the watchdog task
+  // to the control task's core at a higher priority, so no reportReading() lands between
+  // these loads and the checks below either.
+  unsigned long readingMs = _readingMs.load();
+  float readingC = _readingC.load();
+  bool requested = _requested.load();
+  unsigned long now = _clock.millis();
+  bool fresh = now - readingMs < _config.sensorStaleMs;
+
+  // Continuous on-time of the request; standby only counts above the ceiling
+  bool standbyCool = _standby.load() && fresh && readingC < _config.standbyCeilingC;
+  if (!requested || standbyCool) {
+    _onSinceMs = now;
+  }
+
+  WatchdogTrip cause = check(now, requested, readingC, fresh);
+  WatchdogTrip current = trip();
+  if (current == WATCHDOG_OK) {
+    if (cause != WATCHDOG_OK) {
+      engage(cause, now, readingC);
+    }
+  } else if (cause == WATCHDOG_OK) {
+    // On-time only ends with the request (a standby that cooled below the ceiling would
+    // otherwise cycle the element); over-temperature with hysteresis
+    bool released = true;
+    if (current == WATCHDOG_ON_TIME) {
+      released = !requested;
+    } else if (current == WATCHDOG_OVER_TEMPERATURE) {
+      released = readingC < _config.maxTemperatureC - _config.temperatureHysteresisC;
+    }
+    if (released) {
+      _trip.store(WATCHDOG_OK);
+      logf("SAFETY: %s cleared, relay follows the controller again", watchdogTripName(current));
+      _relay.set(requested);
+      return;
+    }
+  }
+  if (trip() != WATCHDOG_OK) {
+    _relay.set(false); // Every tick: wins over a racing requestRelay()
+  }
+}
+
+WatchdogTrip HeaterWatchdog::check(unsigned long now, bool requested, float readingC, bool fresh) {
+  if (fresh && readingC >= _config.maxTemperatureC) {
+    return WATCHDOG_OVER_TEMPERATURE;
+  }
+  if (!fresh) {
+    return WATCHDOG_SENSOR_STALE;
+  }
+  if (requested && now - _onSinceMs >= _config.maxOnTimeMs) {
+    return WATCHDOG_ON_TIME;
+  }
+  return WATCHDOG_OK;
+}
+
+void HeaterWatchdog::engage(WatchdogTrip cause, unsigned long now, float readingC) {
+  _trip.store(cause);
+  _relay.set(false);
+  _lastTrip.store(cause);
+  _tripCounts[cause].fetch_add(1);
+  logf("SAFETY: relay forced off (%s): reading %.1fC %.1fs ago, requested on for %.1fs", watchdogTripName(cause),
+       readingC, (now - _readingMs.load()) / 1000.0f, _requested.load() ? (now - _onSinceMs) / 1000.0f : 0.0f);
+  if (cause == WATCHDOG_OVER_TEMPERATURE) _events.status("SAFETY: Over Temp");
+  else if (cause == WATCHDOG_SENSOR_STALE) _events.status("SAFETY: No Sensor");
+  else _events.status("SAFETY: On Time");
+}
+
+uint32_t HeaterWatchdog::tripCount(WatchdogTrip reason) const {
+  if (reason <= WATCHDOG_OK || reason >= WATCHDOG_TRIP_COUNT) {
+    return 0;
+  }
+  return _tripCounts[reason].load();
+}
+
+uint32_t HeaterWatchdog::totalTrips() const {
+  uint32_t total = 0;
+  for (int i = WATCHDOG_OK + 1; i < WATCHDOG_TRIP_COUNT; i++) {
+    total += _tripCounts[i].load();
+  }
+  return total;
+}
+
+void HeaterWatchdog::logf(const char* format, ...) {
+  char message[128];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+  _events.log(message);
+}
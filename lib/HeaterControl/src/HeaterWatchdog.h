@@ -0,0 +1,114 @@
+#ifndef HEATER_WATCHDOG_H
+#define HEATER_WATCHDOG_H
+
+#include <atomic>
+#include <stdint.h>
+
+#include "ControlPlatform.h"
+
+enum WatchdogTrip {
+  WATCHDOG_OK,
+  WATCHDOG_ON_TIME,          // Relay requested on for longer than maxOnTimeMs
+  WATCHDOG_OVER_TEMPERATURE, // Reading at or above maxTemperatureC
+  WATCHDOG_SENSOR_STALE,     // No valid reading for sensorStaleMs
+  WATCHDOG_TRIP_COUNT
+};
+
+const char* watchdogTripName(WatchdogTrip trip); // "ok", "on_time", "over_temperature", "sensor_stale"
+
+struct HeaterWatchdogConfig {
+  HeaterWatchdogConfig();
+
+  unsigned long maxOnTimeMs;     // Continuous relay request, above the controller's own cap
+  float maxTemperatureC;         // Raw thermocouple reading (before calibration)
+  float temperatureHysteresisC;  // Over-temperature releases this far below maxTemperatureC
+  unsigned long sensorStaleMs;   // Longest gap between valid readings
+  float standbyCeilingC;         // Raw reading above which standby on-time counts
+};
+
+// --- Heater Safety Watchdog ---
+// A supervisor between the heater controller and the relay pin, ticked from its own task
+// so it keeps working when the control task stalls or its state machine misbehaves. The
+// controller's relay requests and thermocouple readings pass through it (InterlockedRelay,
+// WatchedSensor); tick() forces the relay off, whatever the controller asks for, while:
+//
+//   - a reading is at or above maxTemperatureC
+//   - no valid reading arrived for sensorStaleMs (open thermocouple, stalled control task)
+//   - the relay has been requested on for maxOnTimeMs without a break
+//
+// Presumed-off standby holds the relay on for as long as the machine stays switched off,
+// with the main switch doing the interlocking. There the on-time only counts while the
+// reading is at or above standbyCeilingC: a boiler that heats up in standby means the
+// machine is powered and the power-on detection missed it.
+// A trip latches until its cause is gone (over-temperature: with hysteresis; on-time: the
+// request went off), then the relay follows the controller's request again. Every trip is
+// logged and counted per reason.
+// requestRelay(), reportReading() and setStandby() come from the control task, tick()
+// from the watchdog task, the getters from anywhere: the shared state is atomic.
+class HeaterWatchdog {
+public:
+  HeaterWatchdog(Clock& clock, Relay& relay, ControlEvents& events,
+                 const HeaterWatchdogConfig& config = HeaterWatchdogConfig());
+
+  void begin(); // Relay off; the staleness timeout starts now
+
+  void requestRelay(bool on);       // Passed through unless tripped
+  void reportReading(double tempC); // Raw reading, NAN on read failure (does not refresh)
+  void setStandby(bool presumedOff);
+
+  void tick();
+
+  WatchdogTrip trip() const { return (WatchdogTrip)_trip.load(); } // WATCHDOG_OK unless latched
+  WatchdogTrip lastTrip() const { return (WatchdogTrip)_lastTrip.load(); }
+  uint32_t tripCount(WatchdogTrip reason) const;
+  uint32_t totalTrips() const;
+  bool relayRequested() const { return _requested.load(); }
+  const HeaterWatchdogConfig& config() const { return _config; }
+
+private:
+  WatchdogTrip check(unsigned long now, bool requested, float readingC, bool fresh);
+  void engage(WatchdogTrip cause, unsigned long now, float readingC);
+  void logf(const char* format, ...);
+
+  Clock& _clock;
+  Relay& _relay;
+  ControlEvents& _events;
+  HeaterWatchdogConfig _config;
+
+  std::atomic<bool> _requested;
+  std::atomic<bool> _standby;
+  std::atomic<float> _readingC;       // Latest valid reading
+  std::atomic<unsigned long> _readingMs;
+  std::atomic<int> _trip;
+  std::atomic<int> _lastTrip;
+  std::atomic<uint32_t> _tripCounts[WATCHDOG_TRIP_COUNT];
+
+  unsigned long _onSinceMs; // Watchdog task only
+};
+
+// Relay handed to the controller: requests go through the watchdog.
+class InterlockedRelay : public Relay {
+public:
+  explicit InterlockedRelay(HeaterWatchdog& watchdog) : _watchdog(watchdog) {}
+  void set(bool on) override { _watchdog.requestRelay(on); }
+
+private:
+  HeaterWatchdog& _watchdog;
+};
+
+// Sensor handed to the controller: every reading is reported to the watchdog on the way.
+class WatchedSensor : public TemperatureSensor {
+public:
+  WatchedSensor(HeaterWatchdog& watchdog, TemperatureSensor& sensor) : _watchdog(watchdog), _sensor(sensor) {}
+  double readCelsius() override {
+    double tempC = _sensor.readCelsius();
+    _watchdog.reportReading(tempC);
+    return tempC;
+  }
+
+private:
+  HeaterWatchdog& _watchdog;
+  TemperatureSensor& _sensor;
+};
+
+#endif // HEATER_WATCHDOG_H
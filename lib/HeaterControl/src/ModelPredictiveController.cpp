@@ -0,0 +1,117 @@
+#include "ModelPredictiveController.h"
+
+#include <math.h>
+
+namespace {
+const float OVERSHOOT_WEIGHT = 4.0f;   // Overshoot costs this much more than undershoot
+const float MOVE_WEIGHT = 0.5f;        // Penalty on duty changes between windows
+const float STATE_GAIN = 0.5f;         // Share of the measurement mismatch folded into the model state
+const float LOAD_GAIN = 0.01f;         // Duty per degree C of mismatch added to the load estimate each window
+}
+
+ModelPredictiveController::ModelPredictiveController(const ThermalModel& model, float stepSeconds,
+                                                     float horizonSeconds)
+    : _model(model),
+      _stepSeconds(stepSeconds),
+      _horizonSteps((int)(horizonSeconds / stepSeconds)),
+      _deadTimeSteps(0),
+      _modelTempC(NAN),
+      _loadDuty(0.0f),
+      _pastDutyIndex(0),
+      _lastDuty(0.0f),
+      _predictedPeakC(NAN),
+      _initialized(false) {
+  setModel(model);
+}
+
+void ModelPredictiveController::setModel(const ThermalModel& model) {
+  _model = model;
+  _deadTimeSteps = (int)(model.deadTimeS / _stepSeconds + 0.5f);
+  if (_deadTimeSteps >= MAX_DEAD_TIME_STEPS) _deadTimeSteps = MAX_DEAD_TIME_STEPS - 1;
+  _initialized = false;
+}
+
+void ModelPredictiveController::reset(float measuredC) {
+  _modelTempC = measuredC;
+  _loadDuty = 0.0f;
+  for (int i = 0; i < MAX_DEAD_TIME_STEPS; i++) _pastDuty[i] = 0.0f;
+  _pastDutyIndex = 0;
+  _lastDuty = 0.0f;
+  _initialized = true;
+}
+
+float ModelPredictiveController::stepModel(float tempC, float duty) const {
+  float derivative = (_model.gainC * (duty - _loadDuty) - (tempC - _model.ambientC)) / _model.timeConstantS;
+  return tempC + derivative * _stepSeconds;
+}
+
+// Cost of applying `duty` for one dead time and the holding duty after that, starting
+// after the queued dead-time inputs. Re-deciding every window (receding horizon) turns this
+// into "dose the missing heat now, then hold", which avoids the sluggishness of a single
+// constant duty over a long horizon.
+float ModelPredictiveController::simulate(float startC, float duty, float setpointC, float& peakC) const {
+  float holdDuty = _model.holdingDuty(setpointC) + _loadDuty;
+  if (holdDuty < 0.0f) holdDuty = 0.0f;
+  if (holdDuty > 1.0f) holdDuty = 1.0f;
+  int blockSteps = _deadTimeSteps > 0 ? _deadTimeSteps : 1;
+
+  float tempC = startC;
+  float cost = 0.0f;
+  peakC = tempC;
+  for (int step = 0; step < _horizonSteps; step++) {
+    float appliedDuty = (step < _deadTimeSteps + blockSteps) ? duty : holdDuty;
+    if (step < _deadTimeSteps) {
+      // Inputs decided in earlier windows reach the sensor first
+      int index = (_pastDutyIndex + step) % _deadTimeSteps;
+      appliedDuty = _pastDuty[index];
+    }
+    tempC = stepModel(tempC, appliedDuty);
+    if (tempC > peakC) peakC = tempC;
+    float error = tempC - setpointC;
+    cost += (error > 0 ? OVERSHOOT_WEIGHT : 1.0f) * error * error;
+  }
+  return cost;
+}
+
+float ModelPredictiveController::update(float setpointC, float measuredC) {
+  if (!_initialized) {
+    reset(measuredC);
+  }
+
+  // _modelTempC was advanced to "now" at the end of the previous window. Correct it towards
+  // the measurement and integrate the remaining mismatch as an unmeasured load (water draw,
+  // model error) so the steady state has no offset.
+  float mismatchC = measuredC - _modelTempC;
+  _modelTempC += STATE_GAIN * mismatchC;
+  _loadDuty -= LOAD_GAIN * mismatchC;
+  if (_loadDuty > 1.0f) _loadDuty = 1.0f;
+  if (_loadDuty < -1.0f) _loadDuty = -1.0f;
+
+  float bestDuty = 0.0f;
+  float bestCost = INFINITY;
+  float bestPeakC = measuredC;
+  for (int candidate = 0; candidate < DUTY_CANDIDATES; candidate++) {
+    float duty = (float)candidate / (DUTY_CANDIDATES - 1);
+    float peakC;
+    float move = duty - _lastDuty;
+    float cost = simulate(_modelTempC, duty, setpointC, peakC) + MOVE_WEIGHT * _horizonSteps * move * move;
+    if (cost < bestCost) {
+      bestCost = cost;
+      bestDuty = duty;
+      bestPeakC = peakC;
+    }
+  }
+  _predictedPeakC = bestPeakC;
+  _lastDuty = bestDuty;
+
+  // Advance the model over this window with the input leaving the dead time, then queue
+  // the new decision; it reaches the boiler after the dead time
+  if (_deadTimeSteps > 0) {
+    _modelTempC = stepModel(_modelTempC, _pastDuty[_pastDutyIndex]);
+    _pastDuty[_pastDutyIndex] = bestDuty;
+    _pastDutyIndex = (_pastDutyIndex + 1) % _deadTimeSteps;
+  } else {
+    _modelTempC = stepModel(_modelTempC, bestDuty);
+  }
+  return bestDuty;
+}
@@ -0,0 +1,44 @@
+#ifndef MODEL_PREDICTIVE_CONTROLLER_H
+#define MODEL_PREDICTIVE_CONTROLLER_H
+
+#include "ThermalModel.h"
+
+// --- Small Model Predictive Controller ---
+// Every control window it predicts the boiler temperature over a fixed horizon with the
+// FOPDT model, including the heat already "in the pipe" from past windows (dead time), and
+// picks the constant duty that minimises squared tracking error plus an extra penalty on
+// overshoot. A simple observer pulls the model state towards each measurement and
+// integrates what is left as an unmeasured load (a shot drawing water, model error).
+class ModelPredictiveController {
+public:
+  static const int MAX_DEAD_TIME_STEPS = 32;
+  static const int DUTY_CANDIDATES = 21; // 0%, 5%, ... 100%
+
+  ModelPredictiveController(const ThermalModel& model, float stepSeconds, float horizonSeconds);
+
+  void setModel(const ThermalModel& model);
+  void reset(float measuredC); // Align the model state with a measurement, clear input history
+
+  // Computes the duty for the next window from the latest measurement.
+  float update(float setpointC, float measuredC);
+
+  float predictedPeakC() const { return _predictedPeakC; }
+
+private:
+  float simulate(float startC, float duty, float setpointC, float& peakC) const;
+  float stepModel(float tempC, float duty) const;
+
+  ThermalModel _model;
+  float _stepSeconds;
+  int _horizonSteps;
+  int _deadTimeSteps;
+  float _modelTempC;   // Model state aligned with the (lagging) sensor
+  float _loadDuty;     // Estimated heat loss not in the model, as a duty
+  float _pastDuty[MAX_DEAD_TIME_STEPS]; // Ring of applied duties still inside the dead time
+  int _pastDutyIndex;  // Oldest queued duty
+  float _lastDuty;
+  float _predictedPeakC;
+  bool _initialized;
+};
+
+#endif // MODEL_PREDICTIVE_CONTROLLER_H
@@ -0,0 +1,82 @@
+#ifndef PID_CONTROLLER_H
+#define PID_CONTROLLER_H
+
+#include <math.h>
+
+// --- Discrete PID ---
+// Parallel form with derivative on measurement (no kick on set point changes), a
+// first-order filter on the derivative, and conditional-integration anti-windup: the
+// integral only accumulates while the output is not saturated in the error's direction,
+// and is clamped so that P + I alone can never exceed the output range.
+struct PidGains {
+  float kp; // Output per degree C of error
+  float ki; // Output per degree C * second
+  float kd; // Output per degree C / second (applied to the measurement)
+  float derivativeFilterS; // Derivative low-pass time constant
+};
+
+class PidController {
+public:
+  PidController(const PidGains& gains, float outputMin, float outputMax)
+      : _gains(gains), _outputMin(outputMin), _outputMax(outputMax) {
+    reset();
+  }
+
+  void reset() {
+    _integral = 0.0f;
+    _lastMeasurement = NAN;
+    _filteredDerivative = 0.0f;
+  }
+
+  void setGains(const PidGains& gains) { _gains = gains; }
+  const PidGains& gains() const { return _gains; }
+
+  // One step with a sample period of dtSeconds. Returns the clamped output.
+  float update(float setpoint, float measurement, float dtSeconds) {
+    float error = setpoint - measurement;
+
+    // Derivative on measurement, filtered
+    float derivative = 0.0f;
+    if (!isnan(_lastMeasurement) && dtSeconds > 0) {
+      float rawDerivative = (measurement - _lastMeasurement) / dtSeconds;
+      float alpha = dtSeconds / (_gains.derivativeFilterS + dtSeconds);
+      _filteredDerivative += alpha * (rawDerivative - _filteredDerivative);
+      derivative = _filteredDerivative;
+    }
+    _lastMeasurement = measurement;
+
+    float proportional = _gains.kp * error;
+    float unclamped = proportional + _integral - _gains.kd * derivative;
+
+    // Conditional integration: do not push further into saturation
+    bool saturatedHigh = unclamped >= _outputMax && error > 0;
+    bool saturatedLow = unclamped <= _outputMin && error < 0;
+    if (!saturatedHigh && !saturatedLow) {
+      _integral += _gains.ki * error * dtSeconds;
+    }
+    // Clamp the integral so P + I stays inside the output range
+    float integralMax = _outputMax - proportional;
+    float integralMin = _outputMin - proportional;
+    if (integralMax < 0) integralMax = 0;
+    if (integralMin > 0) integralMin = 0;
+    if (_integral > integralMax) _integral = integralMax;
+    if (_integral < integralMin) _integral = integralMin;
+
+    float output = proportional + _integral - _gains.kd * derivative;
+    if (output > _outputMax) output = _outputMax;
+    if (output < _outputMin) output = _outputMin;
+    return output;
+  }
+
+  float integral() const { return _integral; }
+
+private:
+  PidGains _gains;
+  float _outputMin;
+  float _outputMax;
+  float _integral;
+  float _lastMeasurement;
+  float _filteredDerivative;
+};
+
+#endif // PID_CONTROLLER_H
@@ -0,0 +1,213 @@
+#include "SensorHealth.h"
+
+#include <math.h>
+
+const char* sensorFaultName(SensorFault fault) {
+  switch (fault) {
+    case SENSOR_OPEN: return "open";
+    case SENSOR_STUCK: return "stuck";
+    case SENSOR_IMPLAUSIBLE: return "implausible";
+    case SENSOR_RATE: return "rate";
+    default: return "ok";
+  }
+}
+
+// Read every 500 ms. The thermoblock moves well under 1 C/s even with the heater on or
+// during a shot, and 45 s of heater on-time lifts it by 20 C or more (2 C within seconds of
+// the relay switching on; the reading's noise stays well inside that). A single spike too
+// small for the jump check breaks the rate once; a drifting sensor keeps breaking it.
+SensorHealthConfig::SensorHealthConfig()
+    : openReadCount(3),
+      minPlausibleC(1.0f),
+      maxPlausibleC(300.0f),
+      maxJumpC(15.0f),
+      implausibleReadCount(3),
+      maxRateCPerS(4.0f),
+      rateWindowMs(2000),
+      rateReadCount(3),
+      stuckBandC(0.25f),
+      stuckHeatingMs(45 * 1000),
+      heatConfirmRiseC(2.0f),
+      stuckRetryMs(5 * 60 * 1000),
+      recoveryReadings(10) {}
+
+SensorHealth::SensorHealth(const SensorHealthConfig& config)
+    : _config(config),
+      _fault(SENSOR_OK),
+      _lastFault(SENSOR_OK),
+      _failedReads(0),
+      _rejectedReads(0),
+      _started(false),
+      _lastUpdateMs(0),
+      _consecutiveFailed(0),
+      _consecutiveRejected(0),
+      _consecutiveRateViolations(0),
+      _goodReadings(0),
+      _lastGoodC(NAN),
+      _lastRawC(NAN),
+      _rateRefC(NAN),
+      _rateRefMs(0),
+      _stuckRefC(NAN),
+      _stuckHeatingMs(0),
+      _stuckValueC(NAN),
+      _stuckSinceMs(0),
+      _stuckRetries(0),
+      _heatConfirmed(false),
+      _heatBaseC(NAN) {
+  for (int i = 0; i < SENSOR_FAULT_COUNT; i++) {
+    _faultCounts[i] = 0;
+  }
+}
+
+bool SensorHealth::update(unsigned long nowMs, double rawC, bool heaterOn) {
+  unsigned long dtMs = _started ? nowMs - _lastUpdateMs : 0;
+  _started = true;
+  _lastUpdateMs = nowMs;
+
+  if (isnan(rawC)) {
+    _failedReads++;
+    _goodReadings = 0;
+    if (++_consecutiveFailed >= _config.openReadCount) {
+      raise(SENSOR_OPEN);
+    }
+    return false;
+  }
+  _consecutiveFailed = 0;
+
+  float readingC = (float)rawC;
+  float referenceC = isHealthy() ? _lastGoodC : _lastRawC;
+  _lastRawC = readingC;
+  bool inRange = readingC >= _config.minPlausibleC && readingC <= _config.maxPlausibleC;
+  bool jump = !isnan(referenceC) && fabsf(readingC - referenceC) > _config.maxJumpC;
+  if (!inRange || jump) {
+    return reject(SENSOR_IMPLAUSIBLE, ++_consecutiveRejected >= _config.implausibleReadCount);
+  }
+  _consecutiveRejected = 0;
+
+  if (!checkRate(nowMs, readingC)) {
+    return reject(SENSOR_RATE, ++_consecutiveRateViolations >= _config.rateReadCount);
+  }
+  _consecutiveRateViolations = 0;
+  if (!checkStuck(dtMs, readingC, heaterOn)) {
+    if (_fault != SENSOR_STUCK) {
+      _stuckSinceMs = nowMs;
+    }
+    raise(SENSOR_STUCK);
+    return false;
+  }
+
+  bool moved = fabsf(readingC - _stuckValueC) > 2.0f * _config.stuckBandC;
+  if (!isHealthy()) {
+    // A stuck reading has to move before it counts as good again, unless nothing could move
+    // it (no heat) for the retry time
+    if (_fault == SENSOR_STUCK && !moved && (heaterOn || !stuckRetryDue(nowMs))) {
+      _goodReadings = 0;
+      return false;
+    }
+    if (++_goodReadings < _config.recoveryReadings) {
+      return false;
+    }
+    if (_fault == SENSOR_STUCK) {
+      _stuckRetries = moved ? 0 : _stuckRetries + 1;
+    }
+    _fault = SENSOR_OK;
+    _goodReadings = 0;
+  } else if (_stuckRetries > 0 && moved) {
+    _stuckRetries = 0; // Retried sensor is alive
+  }
+  _lastGoodC = readingC;
+  return true;
+}
+
+void SensorHealth::resetHeatConfirmation() {
+  _heatConfirmed = false;
+  _heatBaseC = NAN;
+  _stuckHeatingMs = 0;
+}
+
+uint32_t SensorHealth::faultCount(SensorFault fault) const {
+  if (fault <= SENSOR_OK || fault >= SENSOR_FAULT_COUNT) {
+    return 0;
+  }
+  return _faultCounts[fault];
+}
+
+uint32_t SensorHealth::totalFaults() const {
+  uint32_t total = 0;
+  for (int i = SENSOR_OK + 1; i < SENSOR_FAULT_COUNT; i++) {
+    total += _faultCounts[i];
+  }
+  return total;
+}
+
+bool SensorHealth::reject(SensorFault fault, bool persistent) {
+  _rejectedReads++;
+  _goodReadings = 0;
+  if (persistent) {
+    raise(fault);
+  }
+  return false;
+}
+
+void SensorHealth::raise(SensorFault fault) {
+  if (_fault != fault) {
+    _faultCounts[fault]++;
+  }
+  _fault = fault;
+  _lastFault = fault;
+  _goodReadings = 0;
+}
+
+// Rate over the window, not per read: the 0.25 C steps and the noise would need a much
+// wider limit on a single 500 ms interval. While healthy a violating reading does not become
+// the reference, so the reading after a spike is measured against the one before it, and
+// every read is checked until one passes. While faulted the reference follows the readings,
+// like the jump check: a sensor that comes back at another temperature is judged from there.
+bool SensorHealth::checkRate(unsigned long nowMs, double rawC) {
+  if (isnan(_rateRefC)) {
+    _rateRefC = (float)rawC;
+    _rateRefMs = nowMs;
+    return true;
+  }
+  unsigned long elapsedMs = nowMs - _rateRefMs;
+  if (elapsedMs < _config.rateWindowMs) {
+    return true;
+  }
+  float rateCPerS = ((float)rawC - _rateRefC) * 1000.0f / elapsedMs;
+  bool withinRate = fabsf(rateCPerS) <= _config.maxRateCPerS;
+  if (withinRate || !isHealthy()) {
+    _rateRefC = (float)rawC;
+    _rateRefMs = nowMs;
+  }
+  return withinRate;
+}
+
+bool SensorHealth::checkStuck(unsigned long dtMs, double rawC, bool heaterOn) {
+  if (!_heatConfirmed) {
+    if (isnan(_heatBaseC) || rawC < _heatBaseC) {
+      _heatBaseC = (float)rawC;
+    } else if (rawC - _heatBaseC >= _config.heatConfirmRiseC) {
+      _heatConfirmed = true;
+    }
+  }
+  if (isnan(_stuckRefC) || fabsf((float)rawC - _stuckRefC) > _config.stuckBandC) {
+    _stuckRefC = (float)rawC;
+    _stuckHeatingMs = 0;
+    return true;
+  }
+  // A retried stuck reading gets no benefit of the doubt
+  if (heaterOn && (_heatConfirmed || _stuckRetries > 0)) {
+    _stuckHeatingMs += dtMs;
+  }
+  if (_stuckHeatingMs < _config.stuckHeatingMs) {
+    return true;
+  }
+  _stuckValueC = (float)rawC;
+  _stuckHeatingMs = 0; // Counts again from the fault (a retry, heat in the degraded mode)
+  return false;
+}
+
+bool SensorHealth::stuckRetryDue(unsigned long nowMs) const {
+  int doublings = _stuckRetries < 4 ? _stuckRetries : 4;
+  return nowMs - _stuckSinceMs >= (_config.stuckRetryMs << doublings);
+}
@@ -0,0 +1,113 @@
+#ifndef SENSOR_HEALTH_H
+#define SENSOR_HEALTH_H
+
+#include <stdint.h>
+
+enum SensorFault {
+  SENSOR_OK,
+  SENSOR_OPEN,        // Consecutive failed reads (open thermocouple, MAX6675 fault bit)
+  SENSOR_STUCK,       // Reading frozen while the heater runs
+  SENSOR_IMPLAUSIBLE, // Consecutive readings out of range or jumping
+  SENSOR_RATE,        // Sustained rise or fall faster than the boiler can change
+  SENSOR_FAULT_COUNT
+};
+
+const char* sensorFaultName(SensorFault fault); // "ok", "open", "stuck", "implausible", "rate"
+
+struct SensorHealthConfig {
+  SensorHealthConfig();
+
+  int openReadCount;             // Failed reads in a row for SENSOR_OPEN
+  float minPlausibleC;           // Raw range; the MAX6675 reads 0 on a bad SPI transfer
+  float maxPlausibleC;
+  float maxJumpC;                // Between consecutive reads
+  int implausibleReadCount;      // Rejected readings in a row for SENSOR_IMPLAUSIBLE
+  float maxRateCPerS;            // Over rateWindowMs, either direction
+  unsigned long rateWindowMs;
+  int rateReadCount;             // Rate violations in a row for SENSOR_RATE
+  float stuckBandC;              // Readings within this of each other count as unchanged
+  unsigned long stuckHeatingMs;  // Heater on-time with unchanged readings for SENSOR_STUCK
+  float heatConfirmRiseC;        // Rise that shows the element has power (stuck time counts from then)
+  unsigned long stuckRetryMs;    // Unchanged STUCK reading without heat: retried after this, doubling
+  int recoveryReadings;          // Good readings in a row to clear a fault
+};
+
+// --- Thermocouple Health ---
+// Judges every raw reading before the controller uses it. Single bad readings (a failed
+// read, a spike) are rejected and counted; the sensor only becomes faulted when they
+// persist, or when the readings behave in a way the boiler cannot:
+//
+//   open         openReadCount failed reads in a row
+//   implausible  implausibleReadCount readings in a row out of range or more than
+//                maxJumpC from the last good one
+//   rate         rateReadCount readings in a row moved faster than maxRateCPerS from the
+//                last reading that passed, at least rateWindowMs before
+//   stuck        the reading stayed within stuckBandC for stuckHeatingMs of heater on-time
+//
+// Heater on-time only counts once the element is known to have power: a relay that is on
+// while the machine is switched off looks exactly like a frozen reading. Power is unknown
+// from the start and again after resetHeatConfirmation(), until the reading has risen by
+// heatConfirmRiseC above its lowest value since.
+// A faulted sensor passes no readings on until recoveryReadings in a row are good again
+// (in range, consistent with each other, a stuck reading must have moved), so a loose
+// connection does not flip the controller in and out of its degraded mode. A stuck
+// reading that cannot move because no heat goes in (relay off, boiler at room temperature)
+// is retried after stuckRetryMs, doubling with every retry that gets stuck again; until it
+// has moved, heater on-time counts at once, without waiting for the rise. While faulted
+// the jump check follows the readings themselves: a sensor that comes back at another
+// temperature than it left is accepted once it is consistent.
+class SensorHealth {
+public:
+  explicit SensorHealth(const SensorHealthConfig& config = SensorHealthConfig());
+
+  // One read: the raw reading (NAN on a failed read) and whether the heater was delivering
+  // heat since the previous read. True if the reading may be used.
+  bool update(unsigned long nowMs, double rawC, bool heaterOn);
+  // The machine may have been switched off (controller monitoring for it): stuck time waits
+  // for a rise again.
+  void resetHeatConfirmation();
+  bool heatConfirmed() const { return _heatConfirmed; } // Reading rose since the last reset
+
+  bool isHealthy() const { return _fault == SENSOR_OK; }
+  SensorFault fault() const { return _fault; }
+  SensorFault lastFault() const { return _lastFault; } // Most recent fault, SENSOR_OK if none yet
+  uint32_t faultCount(SensorFault fault) const;        // Times the sensor entered each fault
+  uint32_t totalFaults() const;
+  uint32_t failedReads() const { return _failedReads; }
+  uint32_t rejectedReads() const { return _rejectedReads; } // Out of range, jumps, rate
+  const SensorHealthConfig& config() const { return _config; }
+
+private:
+  bool reject(SensorFault fault, bool persistent);
+  void raise(SensorFault fault);
+  bool checkRate(unsigned long nowMs, double rawC);
+  bool checkStuck(unsigned long dtMs, double rawC, bool heaterOn);
+  bool stuckRetryDue(unsigned long nowMs) const;
+
+  SensorHealthConfig _config;
+  SensorFault _fault;
+  SensorFault _lastFault;
+  uint32_t _faultCounts[SENSOR_FAULT_COUNT];
+  uint32_t _failedReads;
+  uint32_t _rejectedReads;
+
+  bool _started;
+  unsigned long _lastUpdateMs;
+  int _consecutiveFailed;
+  int _consecutiveRejected;
+  int _consecutiveRateViolations;
+  int _goodReadings;       // In a row, while faulted
+  float _lastGoodC;        // Jump reference while healthy
+  float _lastRawC;         // Jump reference while faulted
+  float _rateRefC;         // Last reading that passed the rate check
+  unsigned long _rateRefMs;
+  float _stuckRefC;        // Start of the current unchanged run
+  unsigned long _stuckHeatingMs;
+  float _stuckValueC;      // Reading SENSOR_STUCK was raised at
+  unsigned long _stuckSinceMs;
+  int _stuckRetries;       // Recovered without moving, since the reading last moved
+  bool _heatConfirmed;
+  float _heatBaseC;        // Lowest reading since the last reset (heat confirmation)
+};
+
+#endif // SENSOR_HEALTH_H
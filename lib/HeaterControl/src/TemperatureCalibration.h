@@ -0,0 +1,71 @@
+#ifndef TEMPERATURE_CALIBRATION_H
+#define TEMPERATURE_CALIBRATION_H
+
+#include "CalibrationCurve.h"
+#include "CalibrationTable.h"
+#include "SensorScalar.h"
+
+// --- Temperature Calibration ---
+// Maps raw thermocouple readings to actual temperatures through an N-point CalibrationCurve
+// (piecewise-linear or polynomial). The curve is fitted and sampled into a 1 C lookup table
+// over 0..256 C raw when it is loaded, so apply() costs the same for any curve and never
+// divides (SensorScalar: float, or Q16.16 with SENSOR_FIXED_POINT). Readings above the
+// table extend its last segment.
+template <typename Scalar>
+class BasicTemperatureCalibration {
+public:
+  static const int TABLE_SEGMENTS = 256; // 0..256 C raw
+  static const int TABLE_STEP_LOG2 = 0;  // 1 C per segment
+
+  // Piecewise-linear through the points. Ensure rawTempsC is sorted.
+  BasicTemperatureCalibration(const double* rawTempsC, const double* actualTempsC, int pointsCount)
+      : _valid(false) {
+    CalibrationCurve curve;
+    curve.fit = CALIBRATION_PIECEWISE;
+    curve.degree = 1;
+    curve.pointCount = pointsCount < CalibrationCurve::MAX_POINTS ? pointsCount : CalibrationCurve::MAX_POINTS;
+    for (int i = 0; i < curve.pointCount; i++) {
+      curve.points[i].raw = (float)rawTempsC[i];
+      curve.points[i].actual = (float)actualTempsC[i];
+    }
+    load(curve);
+  }
+
+  explicit BasicTemperatureCalibration(const CalibrationCurve& curve) : _valid(false) { load(curve); }
+
+  // Replaces the calibration. False if the curve is rejected (see CalibrationFunction);
+  // the previous calibration then stays in place.
+  bool load(const CalibrationCurve& curve) {
+    CalibrationFunction function;
+    if (!function.fit(curve)) {
+      return false;
+    }
+    _table.build(function, 0.0, TABLE_STEP_LOG2);
+    _valid = true;
+    return true;
+  }
+
+  /**
+   * Calculates calibrated temperature from the calibration table.
+   *
+   * @param rawTempC The raw temperature reading from the thermocouple.
+   * @return The calibrated temperature, or rawTempC if no curve was ever loaded.
+   */
+  Scalar apply(Scalar rawTempC) const {
+    if (!_valid) {
+      return rawTempC;
+    }
+    return _table.apply(rawTempC);
+  }
+
+  // False until a usable curve was loaded (apply() then returns raw readings).
+  bool isValid() const { return _valid; }
+
+private:
+  bool _valid;
+  BasicCalibrationTable<Scalar, TABLE_SEGMENTS> _table;
+};
+
+typedef BasicTemperatureCalibration<SensorScalar> TemperatureCalibration;
+
+#endif // TEMPERATURE_CALIBRATION_H
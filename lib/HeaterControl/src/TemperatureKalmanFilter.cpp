@@ -0,0 +1,90 @@
+#include "TemperatureKalmanFilter.h"
+
+#include <math.h>
+
+namespace {
+const float INITIAL_LOAD_STD_DEV = 0.05f; // C/s, the first reading says nothing about the rate
+// Element and thermocouple lags spread the heat over time instead of delaying it as one
+// block: half of the model dead time is a pure delay, the other half a first-order lag
+const float INPUT_DELAY_SHARE = 0.5f;
+}
+
+TemperatureKalmanFilter::TemperatureKalmanFilter(const ThermalModel& model, float stepSeconds,
+                                                 const KalmanTuning& tuning)
+    : _model(model), _stepSeconds(stepSeconds), _tuning(tuning), _deadTimeSteps(0) {
+  setModel(model);
+  reset();
+}
+
+void TemperatureKalmanFilter::setModel(const ThermalModel& model) {
+  _model = model;
+  int steps = (int)(model.deadTimeS * INPUT_DELAY_SHARE / _stepSeconds + 0.5f);
+  if (steps >= MAX_DEAD_TIME_STEPS) steps = MAX_DEAD_TIME_STEPS - 1;
+  if (steps != _deadTimeSteps) {
+    // The queued duties were spaced for the old dead time
+    for (int i = 0; i < MAX_DEAD_TIME_STEPS; i++) _pastDuty[i] = 0.0f;
+    _pastDutyIndex = 0;
+    _deadTimeSteps = steps;
+  }
+}
+
+void TemperatureKalmanFilter::reset() {
+  for (int i = 0; i < MAX_DEAD_TIME_STEPS; i++) _pastDuty[i] = 0.0f;
+  _pastDutyIndex = 0;
+  _inputDuty = 0.0f;
+  _tempC = 0.0f;
+  _loadRate = 0.0f;
+  _hasValue = false;
+}
+
+float TemperatureKalmanFilter::modelRate(float tempC) const {
+  return _model.heatingSlopeCPerS() * _inputDuty - (tempC - _model.ambientC) / _model.timeConstantS;
+}
+
+void TemperatureKalmanFilter::update(float measuredC, float heaterDuty, float dtSeconds) {
+  // Heat delivered now reaches the thermocouple, on average, one dead time later
+  float duty = heaterDuty;
+  if (_deadTimeSteps > 0) {
+    duty = _pastDuty[_pastDutyIndex];
+    _pastDuty[_pastDutyIndex] = heaterDuty;
+    _pastDutyIndex = (_pastDutyIndex + 1) % _deadTimeSteps;
+  }
+  float lagS = _model.deadTimeS * (1.0f - INPUT_DELAY_SHARE);
+  float lagAlpha = lagS > 0 ? 1.0f - expf(-dtSeconds / lagS) : 1.0f;
+
+  float measurementVariance = _tuning.measurementNoiseC * _tuning.measurementNoiseC;
+  if (!_hasValue) { // First valid reading or after a reset: assume steady state
+    _inputDuty = 0.0f;
+    _tempC = measuredC;
+    _loadRate = -modelRate(measuredC);
+    _p[0][0] = measurementVariance;
+    _p[0][1] = 0.0f;
+    _p[1][0] = 0.0f;
+    _p[1][1] = INITIAL_LOAD_STD_DEV * INITIAL_LOAD_STD_DEV;
+    _hasValue = true;
+    return;
+  }
+  float dt = dtSeconds;
+
+  // --- Predict ---
+  // F = [[1 - dt / tau, dt], [0, 1]], Q = diag(q_temp, q_load) * dt
+  _inputDuty += lagAlpha * (duty - _inputDuty);
+  _tempC += dt * (modelRate(_tempC) + _loadRate);
+  float a = 1.0f - dt / _model.timeConstantS;
+  float p00 = a * a * _p[0][0] + 2.0f * a * dt * _p[0][1] + dt * dt * _p[1][1] +
+              _tuning.temperatureProcessNoise * dt;
+  float p01 = a * _p[0][1] + dt * _p[1][1];
+  float p11 = _p[1][1] + _tuning.loadProcessNoise * dt;
+
+  // --- Correct with the reading (H = [1, 0]) ---
+  float innovation = measuredC - _tempC;
+  float innovationVariance = p00 + measurementVariance;
+  float tempGain = p00 / innovationVariance;
+  float loadGain = p01 / innovationVariance;
+  _tempC += tempGain * innovation;
+  _loadRate += loadGain * innovation;
+  _p[0][0] = (1.0f - tempGain) * p00;
+  _p[0][1] = (1.0f - tempGain) * p01;
+  _p[1][0] = _p[0][1];
+  _p[1][1] = p11 - loadGain * p01;
+}
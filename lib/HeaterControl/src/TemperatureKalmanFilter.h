@@ -0,0 +1,59 @@
+#ifndef TEMPERATURE_KALMAN_FILTER_H
+#define TEMPERATURE_KALMAN_FILTER_H
+
+#include <math.h>
+
+#include "ThermalModel.h"
+
+// --- Two-State Kalman Temperature Estimator ---
+// State: the thermocouple temperature and an unmodelled rate (heat drawn by a shot, no
+// mains power, model error). The heater duty is the control input: it enters the FOPDT
+// model through half the dead time as a delay and half as a first-order lag (element and
+// thermocouple lag), so the estimate follows a heating ramp without the lag an EMA adds,
+// and the unmodelled rate only has to absorb what the model does not explain.
+//   T[k+1] = T[k] + dt * (slope * lagged(duty)[k - dead / 2] - (T[k] - ambient) / tau + load[k])
+//   load[k+1] = load[k]
+// rate() is the full dT/dt (model part plus load). Noise parameters are per second, so
+// the filter works with whatever read interval it is called at.
+struct KalmanTuning {
+  float measurementNoiseC;     // Thermocouple noise standard deviation (incl. 0.25 C steps)
+  float temperatureProcessNoise; // Model error on the temperature, C^2 per second
+  float loadProcessNoise;      // Random walk of the unmodelled rate, (C/s)^2 per second
+};
+
+class TemperatureKalmanFilter {
+public:
+  static const int MAX_DEAD_TIME_STEPS = 64;
+
+  TemperatureKalmanFilter(const ThermalModel& model, float stepSeconds, const KalmanTuning& tuning);
+
+  void setModel(const ThermalModel& model); // Keeps the state, re-sizes the dead time
+  void reset();                             // Next update() starts from its measurement
+
+  // One read: measuredC (calibrated), heaterDuty (0..1) delivered since the previous read,
+  // dtSeconds since the previous read. A failed read is skipped by the caller; its time
+  // is folded into the next dtSeconds.
+  void update(float measuredC, float heaterDuty, float dtSeconds);
+
+  bool hasValue() const { return _hasValue; }
+  double value() const { return _hasValue ? (double)_tempC : NAN; }   // NAN until the first sample
+  double rate() const { return _hasValue ? (double)modelRate(_tempC) + _loadRate : NAN; } // C/s
+  double loadRate() const { return _hasValue ? (double)_loadRate : NAN; }
+
+private:
+  float modelRate(float tempC) const;
+
+  ThermalModel _model;
+  float _stepSeconds;
+  KalmanTuning _tuning;
+  int _deadTimeSteps;
+  float _pastDuty[MAX_DEAD_TIME_STEPS]; // Ring of delivered duties still inside the dead time
+  int _pastDutyIndex;                   // Oldest queued duty (the one reaching the sensor next)
+  float _inputDuty;                     // Lagged duty reaching the sensor during the last interval
+  float _tempC;
+  float _loadRate;
+  float _p[2][2]; // Covariance of (temperature, load rate)
+  bool _hasValue;
+};
+
+#endif // TEMPERATURE_KALMAN_FILTER_H
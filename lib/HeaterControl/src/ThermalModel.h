@@ -0,0 +1,19 @@
+#ifndef THERMAL_MODEL_H
+#define THERMAL_MODEL_H
+
+// --- First-Order-Plus-Dead-Time Thermal Model ---
+// dT/dt = (gainC * duty(t - deadTimeS) - (T - ambientC)) / timeConstantS
+// gainC is the steady-state rise above ambient at 100% heater duty. For a thermoblock
+// gainC / timeConstantS is the initial heating slope (1 / seconds-per-degree).
+struct ThermalModel {
+  float gainC;
+  float timeConstantS;
+  float deadTimeS;
+  float ambientC;
+
+  float heatingSlopeCPerS() const { return gainC / timeConstantS; }
+  // Steady-state duty that holds tempC (0..1, may exceed 1 if unreachable)
+  float holdingDuty(float tempC) const { return (tempC - ambientC) / gainC; }
+};
+
+#endif // THERMAL_MODEL_H
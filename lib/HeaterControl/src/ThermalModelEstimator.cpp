@@ -0,0 +1,105 @@
+#include "ThermalModelEstimator.h"
+
+#include <math.h>
+
+namespace {
+const double INITIAL_COVARIANCE = 1000.0;
+const int HISTORY_SIZE = ThermalModelEstimator::MAX_DELAY_STEPS + 1;
+const int MIN_SAMPLES_FOR_ESTIMATE = 60;
+const float LAG_TIME_CONSTANTS_S[ThermalModelEstimator::LAG_CANDIDATES] = {0.0f, 4.0f, 8.0f, 16.0f};
+}
+
+ThermalModelEstimator::ThermalModelEstimator(float sampleSeconds, float ambientC)
+    : _sampleSeconds(sampleSeconds), _ambientC(ambientC) {
+  reset();
+}
+
+void ThermalModelEstimator::reset() {
+  for (int lag = 0; lag < LAG_CANDIDATES; lag++) {
+    for (int d = 0; d < HISTORY_SIZE; d++) {
+      Candidate& candidate = _candidates[lag][d];
+      candidate.theta[0] = 0.0;
+      candidate.theta[1] = 0.0;
+      candidate.p[0][0] = INITIAL_COVARIANCE;
+      candidate.p[0][1] = 0.0;
+      candidate.p[1][0] = 0.0;
+      candidate.p[1][1] = INITIAL_COVARIANCE;
+      candidate.squaredErrorSum = 0.0;
+      _laggedDuty[lag][d] = 0.0f;
+    }
+  }
+  _newest = 0;
+  _lastTempC = NAN;
+  _samples = 0;
+}
+
+void ThermalModelEstimator::addSample(float tempC, float duty) {
+  int previous = _newest;
+  _newest = (_newest + HISTORY_SIZE - 1) % HISTORY_SIZE;
+  for (int lag = 0; lag < LAG_CANDIDATES; lag++) {
+    float alpha = _sampleSeconds / (LAG_TIME_CONSTANTS_S[lag] + _sampleSeconds);
+    float last = _laggedDuty[lag][previous];
+    _laggedDuty[lag][_newest] = last + alpha * (duty - last);
+  }
+
+  if (isnan(_lastTempC)) {
+    _lastTempC = tempC;
+    return;
+  }
+  double y = tempC - _lastTempC;
+  double phi0 = _lastTempC - _ambientC;
+  _lastTempC = tempC;
+  _samples++;
+
+  for (int lag = 0; lag < LAG_CANDIDATES; lag++) {
+    for (int d = 0; d < HISTORY_SIZE; d++) {
+      Candidate& c = _candidates[lag][d];
+      double phi1 = _laggedDuty[lag][(_newest + d) % HISTORY_SIZE];
+
+      double error = y - (c.theta[0] * phi0 + c.theta[1] * phi1);
+      if (_samples > WARMUP_SAMPLES) {
+        c.squaredErrorSum += error * error;
+      }
+
+      // K = P phi / (1 + phi' P phi), theta += K e, P -= K phi' P
+      double pPhi0 = c.p[0][0] * phi0 + c.p[0][1] * phi1;
+      double pPhi1 = c.p[1][0] * phi0 + c.p[1][1] * phi1;
+      double denominator = 1.0 + phi0 * pPhi0 + phi1 * pPhi1;
+      double k0 = pPhi0 / denominator;
+      double k1 = pPhi1 / denominator;
+      c.theta[0] += k0 * error;
+      c.theta[1] += k1 * error;
+      c.p[0][0] -= k0 * pPhi0;
+      c.p[0][1] -= k0 * pPhi1;
+      c.p[1][1] -= k1 * pPhi1;
+      c.p[1][0] = c.p[0][1]; // Keep P symmetric against rounding
+    }
+  }
+}
+
+bool ThermalModelEstimator::estimate(ThermalModel& model) const {
+  if (_samples < MIN_SAMPLES_FOR_ESTIMATE) {
+    return false;
+  }
+  int bestLag = 0;
+  int bestDelay = 0;
+  for (int lag = 0; lag < LAG_CANDIDATES; lag++) {
+    for (int d = 0; d < HISTORY_SIZE; d++) {
+      if (_candidates[lag][d].squaredErrorSum < _candidates[bestLag][bestDelay].squaredErrorSum) {
+        bestLag = lag;
+        bestDelay = d;
+      }
+    }
+  }
+
+  double a = _candidates[bestLag][bestDelay].theta[0];
+  double b = _candidates[bestLag][bestDelay].theta[1];
+  if (!(a < 0.0 && a > -0.5 && b > 0.0)) {
+    return false; // Not a stable, heating plant
+  }
+  model.timeConstantS = (float)(-_sampleSeconds / log(1.0 + a));
+  model.gainC = (float)(b / -a);
+  model.deadTimeS = bestDelay * _sampleSeconds + LAG_TIME_CONSTANTS_S[bestLag];
+  model.ambientC = _ambientC;
+  return true;
+}
@@ -0,0 +1,48 @@
+#ifndef THERMAL_MODEL_ESTIMATOR_H
+#define THERMAL_MODEL_ESTIMATOR_H
+
+#include "ThermalModel.h"
+
+// --- Online FOPDT Identification (recursive least squares) ---
+// Fits the sampled model
+//   T[k+1] - T[k] = a * (T[k] - ambient) + b * lagged(duty)[k - d]
+// where lagged() is a first-order filter (element and sensor lag). One two-parameter RLS
+// estimator runs per (dead time, lag) candidate; the candidate with the smallest a-priori
+// prediction error wins and its lag is folded into the reported dead time. Only the known
+// duty enters the regressors, so thermocouple noise does not bias the estimates.
+// Feed it one sample per control window while the heater is excited (relay experiment).
+class ThermalModelEstimator {
+public:
+  static const int MAX_DELAY_STEPS = 8;
+  static const int LAG_CANDIDATES = 4;
+  static const int WARMUP_SAMPLES = 10; // Residuals ignored while the estimates converge
+
+  ThermalModelEstimator(float sampleSeconds, float ambientC);
+
+  void reset();
+  // tempC at the end of the interval; duty applied (0..1) during that interval.
+  void addSample(float tempC, float duty);
+  int sampleCount() const { return _samples; }
+
+  // Converts the best candidate into a continuous-time model. False if not identifiable
+  // (too few samples, wrong signs).
+  bool estimate(ThermalModel& model) const;
+
+private:
+  struct Candidate {
+    double theta[2]; // a, b
+    double p[2][2];  // Covariance
+    double squaredErrorSum;
+  };
+
+  float _sampleSeconds;
+  float _ambientC;
+  Candidate _candidates[LAG_CANDIDATES][MAX_DELAY_STEPS + 1];
+  // _laggedDuty[lag][(_newest + d) % N] = filtered duty d samples ago
+  float _laggedDuty[LAG_CANDIDATES][MAX_DELAY_STEPS + 1];
+  int _newest;
+  float _lastTempC;
+  int _samples;
+};
+
+#endif // THERMAL_MODEL_ESTIMATOR_H
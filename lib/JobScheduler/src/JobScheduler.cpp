@@ -0,0 +1,72 @@
+#include "JobScheduler.h"
+
+#include <string.h>
+
+JobScheduler::JobScheduler(uint32_t (*microsClock)()) : _microsClock(microsClock), _count(0) {}
+
+uint8_t JobScheduler::add(const char* name, uint32_t periodMs, JobFunction function) {
+  if (_count == MAX_JOBS || periodMs == 0) return INVALID_JOB;
+  Job& job = _jobs[_count];
+  job.name = name;
+  job.function = function;
+  job.periodMs = periodMs;
+  job.deadlineMs = 0;
+  job.started = false;
+  memset(&job.stats, 0, sizeof(job.stats));
+  return (uint8_t)_count++;
+}
+
+void JobScheduler::setPeriod(uint8_t job, uint32_t periodMs) {
+  if (job >= _count || periodMs == 0) return;
+  Job& entry = _jobs[job];
+  if (entry.started) entry.deadlineMs = entry.deadlineMs - entry.periodMs + periodMs;
+  entry.periodMs = periodMs;
+}
+
+void JobScheduler::runDue(uint32_t nowMs) {
+  uint32_t passStartUs = _microsClock();
+  for (size_t i = 0; i < _count; i++) {
+    Job& job = _jobs[i];
+    // Jobs earlier in this pass took time; later ones see the time they actually start at
+    uint32_t startUs = _microsClock();
+    uint32_t elapsedMs = (startUs - passStartUs) / 1000;
+    nowMs += elapsedMs;
+    passStartUs += elapsedMs * 1000; // Keep the remainder for the next job
+    if (!job.started) {
+      job.started = true;
+      job.deadlineMs = nowMs;
+    }
+    int32_t lateMs = (int32_t)(nowMs - job.deadlineMs); // Wrap-safe
+    if (lateMs < 0) continue;
+
+    job.function(nowMs);
+    uint32_t runtimeUs = _microsClock() - startUs;
+
+    JobStats& stats = job.stats;
+    stats.runs++;
+    stats.totalLatenessMs += (uint32_t)lateMs;
+    if ((uint32_t)lateMs > stats.maxLatenessMs) stats.maxLatenessMs = (uint32_t)lateMs;
+    stats.totalRuntimeUs += runtimeUs;
+    if (runtimeUs > stats.maxRuntimeUs) stats.maxRuntimeUs = runtimeUs;
+
+    // Next slot on the grid; periods that already passed are skipped, not caught up
+    uint32_t missed = (uint32_t)lateMs / job.periodMs;
+    stats.skipped += missed;
+    job.deadlineMs += (missed + 1) * job.periodMs;
+  }
+}
+
+uint32_t JobScheduler::msUntilNext(uint32_t nowMs) const {
+  uint32_t wait = UINT32_MAX;
+  for (size_t i = 0; i < _count; i++) {
+    if (!_jobs[i].started) return 0;
+    int32_t untilMs = (int32_t)(_jobs[i].deadlineMs - nowMs);
+    if (untilMs <= 0) return 0;
+    if ((uint32_t)untilMs < wait) wait = (uint32_t)untilMs;
+  }
+  return wait;
+}
+
+void JobScheduler::resetStats() {
+  for (size_t i = 0; i < _count; i++) memset(&_jobs[i].stats, 0, sizeof(_jobs[i].stats));
+}
@@ -0,0 +1,67 @@
+#ifndef JOB_SCHEDULER_H
+#define JOB_SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-job statistics. Lateness is how long after its deadline a job started (ms, the
+// scheduler clock), runtime how long it ran (us, the clock given to the scheduler).
+struct JobStats {
+  uint32_t runs;
+  uint32_t skipped;       // Periods dropped because the job was more than a period late
+  uint32_t maxLatenessMs;
+  uint64_t totalLatenessMs;
+  uint32_t maxRuntimeUs;
+  uint64_t totalRuntimeUs;
+};
+
+typedef void (*JobFunction)(uint32_t nowMs);
+
+// --- Cooperative Job Scheduler ---
+// Runs periodic jobs of one task from a fixed table (no allocation): the task calls
+// runDue() and then sleeps msUntilNext() instead of polling every job's
+// `now - last >= interval` on a short fixed delay. Jobs run in registration order when due,
+// on a fixed-rate grid (deadline += period, so they do not drift); a job that falls more
+// than a period behind skips the missed periods instead of running back to back.
+// Single task only: add jobs before the first runDue().
+class JobScheduler {
+public:
+  static const size_t MAX_JOBS = 12;
+  static const uint8_t INVALID_JOB = 0xFF;
+
+  // microsClock times the jobs (micros() on the device, a virtual clock on the host).
+  explicit JobScheduler(uint32_t (*microsClock)());
+
+  // First run at the next runDue(). Returns INVALID_JOB when the table is full.
+  uint8_t add(const char* name, uint32_t periodMs, JobFunction function);
+
+  // Applies from the last deadline: shortening a period can make the job due at once.
+  void setPeriod(uint8_t job, uint32_t periodMs);
+
+  // Runs every job whose deadline has passed, once.
+  void runDue(uint32_t nowMs);
+  // 0 if a job is due.
+  uint32_t msUntilNext(uint32_t nowMs) const;
+
+  size_t jobCount() const { return _count; }
+  const char* name(uint8_t job) const { return _jobs[job].name; }
+  uint32_t period(uint8_t job) const { return _jobs[job].periodMs; }
+  const JobStats& stats(uint8_t job) const { return _jobs[job].stats; }
+  void resetStats();
+
+private:
+  struct Job {
+    const char* name;
+    JobFunction function;
+    uint32_t periodMs;
+    uint32_t deadlineMs;
+    bool started; // Deadline set by the first runDue()
+    JobStats stats;
+  };
+
+  uint32_t (*_microsClock)();
+  Job _jobs[MAX_JOBS];
+  size_t _count;
+};
+
+#endif // JOB_SCHEDULER_H
@@ -0,0 +1,153 @@
+#include "JsonWriter.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace {
+const unsigned long long POWERS_OF_TEN[JsonWriter::MAX_DECIMALS + 1] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+const char HEX_DIGITS[] = "0123456789abcdef";
+}
+
+JsonWriter::JsonWriter(char* buffer, size_t capacity, JsonSink& sink)
+    : _buffer(buffer), _capacity(capacity), _length(0), _flushed(0), _sink(sink), _depth(0), _hasElements(0) {}
+
+void JsonWriter::beginObject() {
+  separator();
+  open('{');
+}
+
+void JsonWriter::endObject() { close('}'); }
+
+void JsonWriter::beginArray() {
+  separator();
+  open('[');
+}
+
+void JsonWriter::endArray() { close(']'); }
+
+size_t JsonWriter::finish() {
+  _sink.write(_buffer, _length, true);
+  _flushed += _length;
+  _length = 0;
+  return _flushed;
+}
+
+void JsonWriter::open(char bracket) {
+  put(bracket);
+  if (_depth < MAX_DEPTH) {
+    _depth++;
+    _hasElements &= ~(1u << _depth);
+  }
+}
+
+void JsonWriter::close(char bracket) {
+  put(bracket);
+  if (_depth > 0) _depth--;
+}
+
+void JsonWriter::separator() {
+  uint32_t bit = 1u << _depth;
+  if (_hasElements & bit) put(',');
+  _hasElements |= bit;
+}
+
+void JsonWriter::writeKey(const char* key, size_t length) {
+  separator();
+  put('"');
+  put(key, length);
+  put("\":", 2);
+}
+
+void JsonWriter::writeDecimal(double value, int decimals) {
+  if (isnan(value) || isinf(value)) {
+    put("null", 4);
+    return;
+  }
+  if (decimals < 0) decimals = 0;
+  if (decimals > MAX_DECIMALS) decimals = MAX_DECIMALS;
+  unsigned long long scale = POWERS_OF_TEN[decimals];
+  double scaled = fabs(value) * (double)scale + 0.5;
+  if (scaled >= 9.0e18) { // Beyond 64-bit fixed point: not a sensor value, keep it valid JSON
+    put("null", 4);
+    return;
+  }
+  unsigned long long units = (unsigned long long)scaled;
+  if (value < 0 && units != 0) put('-');
+  writeDigits(units / scale, 1);
+  if (decimals > 0) {
+    put('.');
+    writeDigits(units % scale, decimals);
+  }
+}
+
+void JsonWriter::writeInteger(long long value) {
+  if (value < 0) {
+    put('-');
+    writeDigits(0ULL - (unsigned long long)value, 1);
+  } else {
+    writeDigits((unsigned long long)value, 1);
+  }
+}
+
+void JsonWriter::writeUnsigned(unsigned long long value) { writeDigits(value, 1); }
+
+void JsonWriter::writeBool(bool value) {
+  if (value) put("true", 4);
+  else put("false", 5);
+}
+
+void JsonWriter::writeString(const char* value) {
+  if (!value) {
+    put("null", 4);
+    return;
+  }
+  put('"');
+  for (const char* p = value; *p; p++) {
+    unsigned char c = (unsigned char)*p;
+    if (c == '"' || c == '\\') {
+      put('\\');
+      put((char)c);
+    } else if (c < 0x20) {
+      put("\\u00", 4);
+      put(HEX_DIGITS[c >> 4]);
+      put(HEX_DIGITS[c & 0x0F]);
+    } else {
+      put((char)c);
+    }
+  }
+  put('"');
+}
+
+void JsonWriter::writeDigits(unsigned long long value, int minDigits) {
+  char digits[20];
+  int count = 0;
+  do {
+    digits[count++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value != 0 && count < (int)sizeof(digits));
+  while (count < minDigits && count < (int)sizeof(digits)) digits[count++] = '0';
+  while (count > 0) put(digits[--count]);
+}
+
+void JsonWriter::put(char c) {
+  if (_length == _capacity) flush();
+  _buffer[_length++] = c;
+}
+
+void JsonWriter::put(const char* data, size_t length) {
+  while (length > 0) {
+    if (_length == _capacity) flush();
+    size_t chunk = _capacity - _length;
+    if (chunk > length) chunk = length;
+    memcpy(_buffer + _length, data, chunk);
+    _length += chunk;
+    data += chunk;
+    length -= chunk;
+  }
+}
+
+void JsonWriter::flush() {
+  _sink.write(_buffer, _length, false);
+  _flushed += _length;
+  _length = 0;
+}
@@ -0,0 +1,91 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Destination of a JsonWriter. Receives the text in buffer-sized pieces; `final` marks the
+// last piece (possibly empty), so a sink can send a short response in one go.
+class JsonSink {
+public:
+  virtual ~JsonSink() {}
+  virtual void write(const char* data, size_t length, bool final) = 0;
+};
+
+// --- Streaming JSON Writer ---
+// Serializes straight into a caller-provided buffer and hands it to the sink whenever it
+// fills up: no heap allocation, no String temporaries, output of any length in constant
+// memory. Commas are inserted automatically. Keys are string literals whose length is known
+// at compile time; they are written as-is (no escaping), so keep them plain ASCII.
+// Numbers are formatted with integer arithmetic (no printf); NaN and infinity become null.
+//
+//   JsonWriter json(buffer, sizeof(buffer), sink);
+//   json.beginObject();
+//   json.field("temperature", 93.4, 1);
+//   json.beginArray("history");
+//   json.value(12.5, 1);
+//   json.endArray();
+//   json.endObject();
+//   json.finish();
+class JsonWriter {
+public:
+  static const int MAX_DEPTH = 8;
+  static const int MAX_DECIMALS = 6;
+
+  JsonWriter(char* buffer, size_t capacity, JsonSink& sink);
+
+  void beginObject();
+  void endObject();
+  void beginArray();
+  void endArray();
+
+  template <size_t N> void beginObject(const char (&key)[N]) { writeKey(key, N - 1); open('{'); }
+  template <size_t N> void beginArray(const char (&key)[N]) { writeKey(key, N - 1); open('['); }
+
+  // Object members
+  template <size_t N> void field(const char (&key)[N], double value, int decimals) { writeKey(key, N - 1); writeDecimal(value, decimals); }
+  template <size_t N> void field(const char (&key)[N], int value) { writeKey(key, N - 1); writeInteger(value); }
+  template <size_t N> void field(const char (&key)[N], long value) { writeKey(key, N - 1); writeInteger(value); }
+  template <size_t N> void field(const char (&key)[N], unsigned value) { writeKey(key, N - 1); writeUnsigned(value); }
+  template <size_t N> void field(const char (&key)[N], unsigned long value) { writeKey(key, N - 1); writeUnsigned(value); }
+  template <size_t N> void field(const char (&key)[N], bool value) { writeKey(key, N - 1); writeBool(value); }
+  template <size_t N> void field(const char (&key)[N], const char* value) { writeKey(key, N - 1); writeString(value); }
+
+  // Array elements
+  void value(double value, int decimals) { separator(); writeDecimal(value, decimals); }
+  void value(int value) { separator(); writeInteger(value); }
+  void value(long value) { separator(); writeInteger(value); }
+  void value(unsigned value) { separator(); writeUnsigned(value); }
+  void value(unsigned long value) { separator(); writeUnsigned(value); }
+  void value(bool value) { separator(); writeBool(value); }
+  void value(const char* value) { separator(); writeString(value); }
+
+  // Hands the rest of the buffer to the sink (final piece). Returns the total length.
+  size_t finish();
+  size_t bytesWritten() const { return _flushed + _length; }
+
+private:
+  void open(char bracket);
+  void close(char bracket);
+  void separator();
+  void writeKey(const char* key, size_t length);
+  void writeDecimal(double value, int decimals);
+  void writeInteger(long long value);
+  void writeUnsigned(unsigned long long value);
+  void writeBool(bool value);
+  void writeString(const char* value);
+  void writeDigits(unsigned long long value, int minDigits);
+  void put(char c);
+  void put(const char* data, size_t length);
+  void flush();
+
+  char* _buffer;
+  size_t _capacity;
+  size_t _length;
+  size_t _flushed;
+  JsonSink& _sink;
+  int _depth;
+  uint32_t _hasElements; // Bit per nesting level: a comma is due before the next element
+};
+
+#endif // JSON_WRITER_H
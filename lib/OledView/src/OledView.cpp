@@ -0,0 +1,227 @@
+#include "OledView.h"
+
+#include <string.h>
+
+namespace {
+const int16_t CELL_WIDTH = 6;  // Classic 5x7 font plus one column of spacing
+const int16_t CELL_HEIGHT = 8;
+const int16_t PAGE_HEIGHT = 8;
+}
+
+OledView::OledView(OledCanvas& canvas, int16_t physicalWidth, int16_t physicalHeight, uint8_t rotation,
+                   unsigned long frameIntervalMs, size_t maxBytesPerFrame)
+    : _canvas(canvas), _physicalWidth(physicalWidth), _physicalHeight(physicalHeight), _rotation(rotation & 3),
+      _frameIntervalMs(frameIntervalMs), _maxBytesPerFrame(maxBytesPerFrame), _fieldCount(0), _nextField(0),
+      _fullRedraw(true), _neverRendered(true), _lastFrameMs(0), _frames(0), _bytesSent(0) {}
+
+int OledView::addField(const OledFieldLayout& layout) {
+  if (_fieldCount >= MAX_FIELDS) {
+    return -1;
+  }
+  Field& field = _fields[_fieldCount];
+  field.layout = layout;
+  field.shown[0] = '\0';
+  field.text[0] = '\0';
+  field.dirtyX0 = 0;
+  field.dirtyX1 = 0;
+  _fullRedraw = true; // Layout changed
+  return _fieldCount++;
+}
+
+void OledView::setText(int field, const char* text) {
+  if (field < 0 || field >= _fieldCount) {
+    return;
+  }
+  Field& target = _fields[field];
+  if (strncmp(target.text, text, MAX_TEXT - 1) == 0) {
+    return;
+  }
+  strncpy(target.text, text, MAX_TEXT - 1);
+  target.text[MAX_TEXT - 1] = '\0';
+  markChanges(target);
+}
+
+bool OledView::dirty() const {
+  if (_fullRedraw) return true;
+  for (int i = 0; i < _fieldCount; i++) {
+    if (_fields[i].dirtyX0 < _fields[i].dirtyX1) return true;
+  }
+  return false;
+}
+
+int OledView::cellCount(const Field& field, const char* text) {
+  return (int)strlen(text) + (field.layout.unit ? (int)strlen(field.layout.unit) : 0);
+}
+
+// Cell `index` of text + unit as it would be drawn; false if it does not fit the field.
+bool OledView::cellAt(const Field& field, const char* text, int index, Cell& cell) {
+  int textLength = (int)strlen(text);
+  if (index < textLength) {
+    cell.c = text[index];
+    cell.size = field.layout.textSize;
+    cell.x = (int16_t)(index * CELL_WIDTH * field.layout.textSize);
+  } else {
+    cell.c = field.layout.unit[index - textLength];
+    cell.size = 1;
+    cell.x = (int16_t)(textLength * CELL_WIDTH * field.layout.textSize + (index - textLength) * CELL_WIDTH);
+  }
+  return cell.x + CELL_WIDTH * cell.size <= field.layout.width && CELL_HEIGHT * cell.size <= field.layout.height;
+}
+
+// Widens the field's dirty span by every cell that differs between shown and text.
+void OledView::markChanges(Field& field) {
+  int count = cellCount(field, field.shown);
+  int newCount = cellCount(field, field.text);
+  if (newCount > count) count = newCount;
+  for (int i = 0; i < count; i++) {
+    Cell before = {0, 0, 0};
+    Cell after = {0, 0, 0};
+    bool hadBefore = i < cellCount(field, field.shown) && cellAt(field, field.shown, i, before);
+    bool hasAfter = i < newCount && cellAt(field, field.text, i, after);
+    if (hadBefore == hasAfter && (!hadBefore || (before.c == after.c && before.size == after.size && before.x == after.x))) {
+      continue;
+    }
+    const Cell* cells[2] = {hadBefore ? &before : nullptr, hasAfter ? &after : nullptr};
+    for (int k = 0; k < 2; k++) {
+      if (!cells[k]) continue;
+      int16_t x0 = cells[k]->x;
+      int16_t x1 = (int16_t)(cells[k]->x + CELL_WIDTH * cells[k]->size);
+      if (field.dirtyX0 >= field.dirtyX1) {
+        field.dirtyX0 = x0;
+        field.dirtyX1 = x1;
+      } else {
+        if (x0 < field.dirtyX0) field.dirtyX0 = x0;
+        if (x1 > field.dirtyX1) field.dirtyX1 = x1;
+      }
+    }
+  }
+}
+
+// Bytes of the page-aligned panel window behind a logical rectangle.
+size_t OledView::spanBytes(const Field& field, int16_t x0, int16_t x1) const {
+  int16_t width = x1 - x0;
+  int16_t height = field.layout.height;
+  bool swapped = _rotation & 1;
+  int16_t columns = swapped ? height : width;
+  int16_t rows = swapped ? width : height;
+  int16_t rowStart;
+  switch (_rotation) {
+    case 0: rowStart = field.layout.y; break;
+    case 1: rowStart = field.layout.x + x0; break;
+    case 2: rowStart = _physicalHeight - field.layout.y - height; break;
+    default: rowStart = _physicalHeight - (field.layout.x + x0) - width; break;
+  }
+  int16_t pages = (rowStart + rows - 1) / PAGE_HEIGHT - rowStart / PAGE_HEIGHT + 1;
+  return (size_t)columns * pages;
+}
+
+// Clears the span, redraws every cell that touches it, sends the covered window.
+size_t OledView::drawSpan(Field& field, int16_t x0, int16_t x1) {
+  const OledFieldLayout& layout = field.layout;
+  _canvas.fillRect(layout.x + x0, layout.y, x1 - x0, layout.height, false);
+  int16_t drawn0 = x0;
+  int16_t drawn1 = x1;
+  int count = cellCount(field, field.text);
+  for (int i = 0; i < count; i++) {
+    Cell cell;
+    if (!cellAt(field, field.text, i, cell)) continue;
+    int16_t cellEnd = (int16_t)(cell.x + CELL_WIDTH * cell.size);
+    if (cellEnd <= x0 || cell.x >= x1) continue;
+    _canvas.drawChar(layout.x + cell.x, layout.y, cell.c, cell.size);
+    if (cell.x < drawn0) drawn0 = cell.x;
+    if (cellEnd > drawn1) drawn1 = cellEnd;
+  }
+  return flushLogical(layout.x + drawn0, layout.y, drawn1 - drawn0, layout.height);
+}
+
+// Maps a logical rectangle to panel columns/pages (inverse of Adafruit_GFX's rotation).
+size_t OledView::flushLogical(int16_t x, int16_t y, int16_t width, int16_t height) {
+  int16_t column0, column1, row0, row1;
+  switch (_rotation) {
+    case 0:
+      column0 = x;
+      column1 = x + width - 1;
+      row0 = y;
+      row1 = y + height - 1;
+      break;
+    case 1:
+      column0 = _physicalWidth - y - height;
+      column1 = _physicalWidth - y - 1;
+      row0 = x;
+      row1 = x + width - 1;
+      break;
+    case 2:
+      column0 = _physicalWidth - x - width;
+      column1 = _physicalWidth - x - 1;
+      row0 = _physicalHeight - y - height;
+      row1 = _physicalHeight - y - 1;
+      break;
+    default:
+      column0 = y;
+      column1 = y + height - 1;
+      row0 = _physicalHeight - x - width;
+      row1 = _physicalHeight - x - 1;
+      break;
+  }
+  if (column0 < 0) column0 = 0;
+  if (row0 < 0) row0 = 0;
+  if (column1 >= _physicalWidth) column1 = _physicalWidth - 1;
+  if (row1 >= _physicalHeight) row1 = _physicalHeight - 1;
+  if (column0 > column1 || row0 > row1) {
+    return 0;
+  }
+  return _canvas.flushWindow((uint8_t)column0, (uint8_t)column1, (uint8_t)(row0 / PAGE_HEIGHT), (uint8_t)(row1 / PAGE_HEIGHT));
+}
+
+size_t OledView::renderAll() {
+  bool swapped = _rotation & 1;
+  _canvas.fillRect(0, 0, swapped ? _physicalHeight : _physicalWidth, swapped ? _physicalWidth : _physicalHeight, false);
+  for (int i = 0; i < _fieldCount; i++) {
+    Field& field = _fields[i];
+    int count = cellCount(field, field.text);
+    for (int c = 0; c < count; c++) {
+      Cell cell;
+      if (cellAt(field, field.text, c, cell)) _canvas.drawChar(field.layout.x + cell.x, field.layout.y, cell.c, cell.size);
+    }
+    memcpy(field.shown, field.text, MAX_TEXT);
+    field.dirtyX0 = field.dirtyX1 = 0;
+  }
+  _fullRedraw = false;
+  return _canvas.flushWindow(0, (uint8_t)(_physicalWidth - 1), 0, (uint8_t)(_physicalHeight / PAGE_HEIGHT - 1));
+}
+
+size_t OledView::render(unsigned long nowMs) {
+  if (!frameDue(nowMs)) {
+    return 0;
+  }
+  _lastFrameMs = nowMs;
+  _neverRendered = false;
+
+  size_t bytes = 0;
+  if (_fullRedraw) {
+    bytes = renderAll(); // Exceeds the budget once, after start-up or invalidate()
+  } else {
+    size_t budgetUsed = 0;
+    int first = _nextField;
+    for (int n = 0; n < _fieldCount; n++) {
+      int index = (first + n) % _fieldCount;
+      Field& field = _fields[index];
+      if (field.dirtyX0 >= field.dirtyX1) continue;
+      size_t cost = spanBytes(field, field.dirtyX0, field.dirtyX1);
+      if (budgetUsed > 0 && budgetUsed + cost > _maxBytesPerFrame) {
+        _nextField = index; // Out of budget: this field goes first next frame
+        break;
+      }
+      budgetUsed += cost;
+      bytes += drawSpan(field, field.dirtyX0, field.dirtyX1);
+      memcpy(field.shown, field.text, MAX_TEXT);
+      field.dirtyX0 = field.dirtyX1 = 0;
+      _nextField = (index + 1) % _fieldCount;
+    }
+  }
+  if (bytes > 0) {
+    _frames++;
+    _bytesSent += bytes;
+  }
+  return bytes;
+}
@@ -0,0 +1,98 @@
+#ifndef OLED_VIEW_H
+#define OLED_VIEW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Drawing and transfer primitives of a page-organized monochrome panel (SSD1306): the
+// firmware maps them onto Adafruit_SSD1306 and Wire, the simulator onto a fake panel.
+// Coordinates of fillRect()/drawChar() are logical (after rotation), flushWindow() takes
+// physical panel columns and 8-pixel pages, inclusive.
+class OledCanvas {
+public:
+  virtual ~OledCanvas() {}
+  virtual void fillRect(int16_t x, int16_t y, int16_t width, int16_t height, bool on) = 0;
+  virtual void drawChar(int16_t x, int16_t y, char c, uint8_t size) = 0; // 6x8 cell per size unit
+  virtual size_t flushWindow(uint8_t column0, uint8_t column1, uint8_t page0, uint8_t page1) = 0; // Bytes on the bus
+};
+
+// Placement of one text field in logical coordinates. The text is drawn at textSize and
+// followed by `unit` at size 1, top aligned (like print() with a size change in between).
+// Characters that do not fit the width are cut off, nothing wraps.
+struct OledFieldLayout {
+  int16_t x;
+  int16_t y;
+  int16_t width;
+  int16_t height;
+  uint8_t textSize;
+  const char* unit; // Static string or nullptr
+};
+
+// --- Retained-Mode OLED View ---
+// Keeps the text shown in every field and, per frame, redraws and transfers only what
+// changed: the span of glyph cells that differ from what is on the panel, widened to whole
+// 8-pixel pages. A temperature going from 93.4 to 93.5 costs one glyph column band instead
+// of the 1 KB framebuffer. Frames are rate-capped (frameIntervalMs) and byte-capped
+// (maxBytesPerFrame): fields that do not fit the budget keep their dirty span and are
+// served first in the next frame, so one call never blocks the caller for long.
+class OledView {
+public:
+  static const int MAX_FIELDS = 10;
+  static const size_t MAX_TEXT = 16; // Including the terminator
+
+  // physicalWidth/Height: panel size before rotation; rotation as Adafruit_GFX::setRotation().
+  OledView(OledCanvas& canvas, int16_t physicalWidth, int16_t physicalHeight, uint8_t rotation,
+           unsigned long frameIntervalMs, size_t maxBytesPerFrame);
+
+  int addField(const OledFieldLayout& layout); // Field id, -1 when full
+  void setText(int field, const char* text);   // Marks the changed glyphs dirty
+
+  bool frameDue(unsigned long nowMs) const { return _neverRendered || nowMs - _lastFrameMs >= _frameIntervalMs; }
+  // Draws and flushes dirty regions within the byte budget. Returns the bytes sent.
+  size_t render(unsigned long nowMs);
+  // The panel was drawn directly (OTA screen): clear and resend everything next frame.
+  void invalidate() { _fullRedraw = true; }
+
+  bool dirty() const;
+  unsigned long frames() const { return _frames; }
+  unsigned long long bytesSent() const { return _bytesSent; }
+
+private:
+  struct Cell {
+    char c;
+    uint8_t size;
+    int16_t x; // Offset from the field's x
+  };
+  struct Field {
+    OledFieldLayout layout;
+    char shown[MAX_TEXT]; // On the panel
+    char text[MAX_TEXT];  // Wanted
+    int16_t dirtyX0;      // Dirty span, offsets from layout.x (dirtyX0 >= dirtyX1: clean)
+    int16_t dirtyX1;
+  };
+
+  static int cellCount(const Field& field, const char* text);
+  static bool cellAt(const Field& field, const char* text, int index, Cell& cell);
+  void markChanges(Field& field);
+  size_t spanBytes(const Field& field, int16_t x0, int16_t x1) const;
+  size_t drawSpan(Field& field, int16_t x0, int16_t x1);
+  size_t flushLogical(int16_t x, int16_t y, int16_t width, int16_t height);
+  size_t renderAll();
+
+  OledCanvas& _canvas;
+  int16_t _physicalWidth;
+  int16_t _physicalHeight;
+  uint8_t _rotation;
+  unsigned long _frameIntervalMs;
+  size_t _maxBytesPerFrame;
+  Field _fields[MAX_FIELDS];
+  int _fieldCount;
+  int _nextField; // Round-robin start, so deferred fields go first
+  bool _fullRedraw;
+  bool _neverRendered;
+  unsigned long _lastFrameMs;
+  unsigned long _frames;
+  unsigned long long _bytesSent;
+};
+
+#endif // OLED_VIEW_H
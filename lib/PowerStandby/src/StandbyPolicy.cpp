@@ -0,0 +1,34 @@
+#include "StandbyPolicy.h"
+
+// An open page renews the hold all the time (stream frames, or /data every 2 s without a
+// stream); once it is closed, low power returns a minute later.
+StandbyPolicyConfig::StandbyPolicyConfig() : wakeHoldMs(60 * 1000) {}
+
+StandbyPolicy::StandbyPolicy(const StandbyPolicyConfig& config)
+    : _config(config), _lowPower(false), _woken(false), _wakeMs(0), _entries(0), _webWakes(0) {}
+
+bool StandbyPolicy::update(unsigned long nowMs, bool presumedOff) {
+  bool lowPower = presumedOff && !isHeld(nowMs);
+  if (lowPower && !_lowPower.load()) {
+    _entries.fetch_add(1);
+  }
+  _lowPower.store(lowPower);
+  return lowPower;
+}
+
+void StandbyPolicy::wake(unsigned long nowMs) {
+  _wakeMs.store(nowMs);
+  _woken.store(true);
+  if (_lowPower.exchange(false)) { // The other tasks go back to full rate before the next update()
+    _webWakes.fetch_add(1);
+  }
+}
+
+bool StandbyPolicy::isHeld(unsigned long nowMs) const {
+  if (!_woken.load()) {
+    return false;
+  }
+  // Signed: the network task's wake() may carry a slightly newer millis() than nowMs
+  long sinceWakeMs = (long)(nowMs - _wakeMs.load());
+  return sinceWakeMs < (long)_config.wakeHoldMs;
+}
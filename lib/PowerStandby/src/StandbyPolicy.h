@@ -0,0 +1,49 @@
+#ifndef STANDBY_POLICY_H
+#define STANDBY_POLICY_H
+
+#include <atomic>
+#include <stdint.h>
+
+struct StandbyPolicyConfig {
+  StandbyPolicyConfig();
+
+  unsigned long wakeHoldMs; // Full rate kept this long after the last web request
+};
+
+// --- Low-Power Standby ---
+// Decides when the firmware runs at its low-power level: while the machine is presumed off
+// and nobody is using the web UI. The tasks read isLowPower() and stretch their periods,
+// the network task also lowers the CPU clock, lets the WiFi modem sleep longer and dims
+// the OLED. Two things end it:
+//
+//   - the heater controller's power-on detection (Kalman dT/dt, still running on the
+//     slower thermocouple reads) clears presumed off, seen by the next update()
+//   - a web request (page, /data, a live telemetry stream) calls wake(): full rate at once,
+//     and for wakeHoldMs after the last one, so an open page sees live values
+//
+// update() comes from the control task, wake() from the network task, the getters from
+// anywhere: the shared state is atomic.
+class StandbyPolicy {
+public:
+  explicit StandbyPolicy(const StandbyPolicyConfig& config = StandbyPolicyConfig());
+
+  bool update(unsigned long nowMs, bool presumedOff); // True while low power applies
+  void wake(unsigned long nowMs);
+
+  bool isLowPower() const { return _lowPower.load(); }
+  uint32_t entries() const { return _entries.load(); }   // Times low power was entered
+  uint32_t webWakes() const { return _webWakes.load(); } // Times a web request ended it
+  const StandbyPolicyConfig& config() const { return _config; }
+
+private:
+  bool isHeld(unsigned long nowMs) const;
+
+  StandbyPolicyConfig _config;
+  std::atomic<bool> _lowPower;
+  std::atomic<bool> _woken;            // wake() was called at least once
+  std::atomic<unsigned long> _wakeMs;  // Last wake()
+  std::atomic<uint32_t> _entries;
+  std::atomic<uint32_t> _webWakes;
+};
+
+#endif // STANDBY_POLICY_H
@@ -0,0 +1,41 @@
+#include "PressureDecimator.h"
+
+PressureDecimator::PressureDecimator(uint32_t inputRateHz, uint16_t factor)
+    : _inputRateHz(inputRateHz), _factor(factor < 3 ? 3 : factor) {
+  reset();
+}
+
+void PressureDecimator::reset() {
+  _nextIndex = 0;
+  startBlock();
+}
+
+void PressureDecimator::startBlock() {
+  _blockStartIndex = _nextIndex;
+  _blockCount = 0;
+  _blockSum = 0;
+  _blockMin = 0xFFFF;
+  _blockMax = 0;
+}
+
+bool PressureDecimator::push(uint16_t raw, DecimatedSample& out) {
+  _nextIndex++;
+  _blockSum += raw;
+  if (raw < _blockMin) _blockMin = raw;
+  if (raw > _blockMax) _blockMax = raw;
+  if (++_blockCount < _factor) {
+    return false;
+  }
+
+  out.sampleIndex = _blockStartIndex;
+  out.adcValue = scalarRatio<SensorScalar>(_blockSum - _blockMin - _blockMax, _factor - 2);
+  out.minRaw = _blockMin;
+  out.maxRaw = _blockMax;
+  startBlock();
+  return true;
+}
+
+void PressureDecimator::skip(uint32_t samples) {
+  _nextIndex += samples;
+  startBlock();
+}
@@ -0,0 +1,57 @@
+#ifndef PRESSURE_DECIMATOR_H
+#define PRESSURE_DECIMATOR_H
+
+#include <stdint.h>
+
+#include "SensorScalar.h"
+
+// One decimated pressure value. sampleIndex counts raw samples since capture start, so the
+// timestamp comes from the sample clock, not from when the consuming task happened to run.
+struct DecimatedSample {
+  uint64_t sampleIndex;  // Index of the first raw sample of the block
+  SensorScalar adcValue; // Trimmed block mean, raw ADC counts
+  uint16_t minRaw;       // Extremes of the block (discarded from the mean)
+  uint16_t maxRaw;
+};
+
+// --- Pressure Decimator ---
+// Consumer stage of the continuous pressure capture: reduces fixed-rate raw ADC samples to
+// one value per block of `factor` samples. The lowest and highest sample of every block are
+// discarded (spike rejection, like the former sort-and-trim of 7 polled reads) and the rest
+// averaged, tracked with a running sum/min/max so no block storage or sorting is needed.
+// A block length of exactly one mains period also cancels the vibratory pump ripple.
+class PressureDecimator {
+public:
+  PressureDecimator(uint32_t inputRateHz, uint16_t factor); // factor >= 3
+
+  void reset(); // Next sample is index 0
+
+  // Feeds one raw sample. True when it completed a block; `out` then holds the result.
+  bool push(uint16_t raw, DecimatedSample& out);
+
+  // Raw samples lost upstream (DMA overrun): drops the partial block and advances the sample
+  // clock so later timestamps stay exact.
+  void skip(uint32_t samples);
+
+  uint32_t inputRateHz() const { return _inputRateHz; }
+  uint16_t factor() const { return _factor; }
+  float outputRateHz() const { return (float)_inputRateHz / _factor; }
+  uint64_t samplesConsumed() const { return _nextIndex; }
+
+  // Time of raw sample `index` relative to capture start.
+  uint32_t sampleTimeMs(uint64_t index) const { return (uint32_t)(index * 1000u / _inputRateHz); }
+
+private:
+  void startBlock();
+
+  uint32_t _inputRateHz;
+  uint16_t _factor;
+  uint64_t _nextIndex;
+  uint64_t _blockStartIndex;
+  uint16_t _blockCount;
+  uint32_t _blockSum;
+  uint16_t _blockMin;
+  uint16_t _blockMax;
+};
+
+#endif // PRESSURE_DECIMATOR_H
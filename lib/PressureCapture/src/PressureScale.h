@@ -0,0 +1,55 @@
+#ifndef PRESSURE_SCALE_H
+#define PRESSURE_SCALE_H
+
+#include "CalibrationCurve.h"
+#include "CalibrationTable.h"
+#include "SensorScalar.h"
+
+// --- ADC Counts to Bar ---
+// Transducer curve from volts to bar (a CalibrationCurve: two points for a linear sensor,
+// more for a measured one), read through an ADC with adcMaxValue counts at adcMaxVoltage.
+// The curve is converted to counts and sampled into a lookup table over 0..4096 counts in
+// 16-count segments when it is loaded, so toBar() is one table step in Scalar with no divide.
+// Q16.16 intermediates stay small: the table position is counts / 16, at most 256.
+template <typename Scalar>
+class BasicPressureScale {
+public:
+  static const int TABLE_SEGMENTS = 256; // 0..4096 counts
+  static const int TABLE_STEP_LOG2 = 4;  // 16 counts per segment
+
+  // Linear transducer: voltsAtZeroBar at 0 bar, voltsAtMaxBar at maxBar.
+  BasicPressureScale(double voltsAtZeroBar, double voltsAtMaxBar, double maxBar, double adcMaxVoltage,
+                     double adcMaxValue)
+      : _voltsPerCount(adcMaxVoltage / adcMaxValue) {
+    load(linearCalibration(voltsAtZeroBar, 0.0, voltsAtMaxBar, maxBar));
+  }
+
+  BasicPressureScale(const CalibrationCurve& voltsToBar, double adcMaxVoltage, double adcMaxValue)
+      : _voltsPerCount(adcMaxVoltage / adcMaxValue) {
+    load(voltsToBar);
+  }
+
+  // Replaces the transducer curve. False if it is rejected; the previous one is kept.
+  bool load(const CalibrationCurve& voltsToBar) {
+    CalibrationFunction function;
+    if (!function.fit(voltsToBar)) {
+      return false;
+    }
+    _table.build(function, 0.0, TABLE_STEP_LOG2, _voltsPerCount);
+    return true;
+  }
+
+  // Pressure for an ADC reading, clamped to 0 below the zero-bar voltage.
+  Scalar toBar(Scalar adcCounts) const {
+    Scalar bar = _table.apply(adcCounts);
+    return bar < Scalar(0) ? Scalar(0) : bar;
+  }
+
+private:
+  double _voltsPerCount;
+  BasicCalibrationTable<Scalar, TABLE_SEGMENTS> _table;
+};
+
+typedef BasicPressureScale<SensorScalar> PressureScale;
+
+#endif // PRESSURE_SCALE_H
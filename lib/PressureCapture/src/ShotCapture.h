@@ -0,0 +1,164 @@
+#ifndef SHOT_CAPTURE_H
+#define SHOT_CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A completed capture. Samples are evenly spaced; sample i was taken
+// (i - preTriggerCount) * samplePeriodMs after the trigger.
+struct ShotCaptureTrace {
+  const int16_t* centibar;  // Pressure in 0.01 bar
+  uint32_t count;
+  uint32_t preTriggerCount; // Samples before the trigger (fewer than configured right after boot)
+  uint32_t triggerTimeMs;   // Time of the trigger sample (device millis)
+  uint32_t samplePeriodMs;
+  uint32_t heldSamples;     // Gaps in the input (capture overruns) filled with the previous value
+  bool truncated;           // The buffer filled up before stop()
+  uint32_t generation;      // 1 for the first capture, 0: none yet
+};
+
+// --- Shot Capture ---
+// Records every decimated pressure value of a shot at the sensing rate, including a
+// pre-trigger window, into a buffer sized at compile time (no allocation, no flash).
+// The caller decides when a shot starts and ends: trigger() makes the newest pushed sample
+// the shot start, stop() completes the capture.
+//
+// Two banks of CAPACITY samples: one records while the other holds the last completed
+// capture for download. Between shots the first PRE_TRIGGER + 1 slots of the recording
+// bank are a ring of the most recent samples; trigger() rotates it into order in place. The
+// completed bank stays untouched until the next capture completes, so a reader that finds
+// the generation unchanged after reading has read a consistent trace.
+template <size_t CAPACITY, size_t PRE_TRIGGER>
+class ShotCapture {
+  static_assert(PRE_TRIGGER + 1 < CAPACITY, "pre-trigger window must leave room for the shot");
+
+public:
+  static const size_t BYTES = 2 * CAPACITY * sizeof(int16_t);
+
+  explicit ShotCapture(uint32_t samplePeriodMs)
+      : _samplePeriodMs(samplePeriodMs), _bank(0), _recording(false), _count(0), _ringNext(0), _preTriggerCount(0),
+        _hasLast(false), _lastTimeMs(0), _lastValue(0), _triggerTimeMs(0), _heldSamples(0), _truncated(false),
+        _generation(0) {
+    _completed.centibar = _banks[1];
+    _completed.count = 0;
+    _completed.preTriggerCount = 0;
+    _completed.triggerTimeMs = 0;
+    _completed.samplePeriodMs = samplePeriodMs;
+    _completed.heldSamples = 0;
+    _completed.truncated = false;
+    _completed.generation = 0;
+  }
+
+  // Feeds one value at the sensing rate. Missing periods since the previous value are
+  // filled with that value so sample times stay implicit.
+  void push(uint32_t timeMs, float pressureBar) {
+    int16_t value = toCentibar(pressureBar);
+    if (_hasLast) {
+      uint32_t missing = (timeMs - _lastTimeMs) / _samplePeriodMs;
+      missing = missing > 0 ? missing - 1 : 0;
+      if (missing > CAPACITY) missing = CAPACITY;
+      for (uint32_t i = 0; i < missing; i++) {
+        store(_lastValue);
+        if (_recording) _heldSamples++;
+      }
+    }
+    store(value);
+    _hasLast = true;
+    _lastTimeMs = timeMs;
+    _lastValue = value;
+  }
+
+  // The newest pushed sample starts the shot.
+  void trigger() {
+    if (_recording || _count == 0) return;
+    if (_count == PRE_TRIGGER_RING) {
+      // Rotate the ring so the oldest pre-trigger sample comes first
+      int16_t* bank = _banks[_bank];
+      reverse(bank, 0, _ringNext);
+      reverse(bank, _ringNext, PRE_TRIGGER_RING);
+      reverse(bank, 0, PRE_TRIGGER_RING);
+    }
+    // The trigger sample is the newest ring entry, now at index count - 1
+    _preTriggerCount = _count - 1;
+    _triggerTimeMs = _lastTimeMs;
+    _heldSamples = 0;
+    _truncated = false;
+    _recording = true;
+  }
+
+  // Completes the capture (no-op while not recording).
+  void stop() {
+    if (!_recording) return;
+    complete();
+  }
+
+  bool recording() const { return _recording; }
+  uint32_t samplePeriodMs() const { return _samplePeriodMs; }
+  const ShotCaptureTrace& completed() const { return _completed; }
+
+private:
+  static int16_t toCentibar(float bar) {
+    if (!(bar > -300.0f)) return 0; // NaN (and nonsense) as 0
+    if (bar > 300.0f) return 30000;
+    float scaled = bar * 100.0f;
+    return (int16_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+  }
+
+  static void reverse(int16_t* data, size_t from, size_t to) {
+    while (from + 1 < to) {
+      int16_t value = data[from];
+      data[from++] = data[--to];
+      data[to] = value;
+    }
+  }
+
+  void store(int16_t value) {
+    int16_t* bank = _banks[_bank];
+    if (!_recording) {
+      bank[_ringNext] = value;
+      _ringNext = (_ringNext + 1) % PRE_TRIGGER_RING;
+      if (_count < PRE_TRIGGER_RING) _count++;
+      return;
+    }
+    bank[_count++] = value;
+    if (_count == CAPACITY) {
+      _truncated = true;
+      complete();
+    }
+  }
+
+  void complete() {
+    _completed.centibar = _banks[_bank];
+    _completed.count = (uint32_t)_count;
+    _completed.preTriggerCount = (uint32_t)_preTriggerCount;
+    _completed.triggerTimeMs = _triggerTimeMs;
+    _completed.heldSamples = _heldSamples;
+    _completed.truncated = _truncated;
+    _completed.generation = ++_generation;
+    _bank ^= 1;
+    _recording = false;
+    _count = 0;
+    _ringNext = 0;
+  }
+
+  // The ring holds the pre-trigger window plus the trigger sample itself
+  static const size_t PRE_TRIGGER_RING = PRE_TRIGGER + 1;
+
+  int16_t _banks[2][CAPACITY];
+  uint32_t _samplePeriodMs;
+  size_t _bank; // Recording bank
+  bool _recording;
+  size_t _count; // Recording: samples in the bank; idle: ring entries
+  size_t _ringNext;
+  size_t _preTriggerCount;
+  bool _hasLast;
+  uint32_t _lastTimeMs;
+  int16_t _lastValue;
+  uint32_t _triggerTimeMs;
+  uint32_t _heldSamples;
+  bool _truncated;
+  uint32_t _generation;
+  ShotCaptureTrace _completed;
+};
+
+#endif // SHOT_CAPTURE_H
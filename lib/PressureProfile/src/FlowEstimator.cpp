@@ -0,0 +1,150 @@
+#include "FlowEstimator.h"
+
+#include <math.h>
+
+namespace {
+const float MIN_CALIBRATION_ML = 5.0f;       // Pump curve volume needed for flowScaleFor()
+const float MIN_RESISTANCE_FLOW_MLPS = 0.3f; // Slower flows say little about the puck
+const float MIN_RESISTANCE = 0.5f;           // bar per ml/s, clamps single-step estimates
+const float MAX_RESISTANCE = 50.0f;
+}
+
+// Defaults: the Ulka-style pump and hoses of the hydraulic model (lib/BoilerSim), which
+// `program flow` checks the estimate against. Calibrate to the machine with flowScale.
+FlowEstimatorConfig::FlowEstimatorConfig()
+    : freeFlowMlPerS(8.0f),
+      deadHeadBar(15.0f),
+      minPowerPercent(30.0f),
+      strokeTimeConstantS(0.06f),
+      complianceMlPerBar(0.6f),
+      opvBar(11.0f),
+      opvMlPerSPerBar(2.0f),
+      slopeTimeConstantS(0.15f),
+      resistanceTimeConstantS(1.0f),
+      pumpOffHoldoffS(2.0f) {}
+
+float flowScaleFor(const FlowShotTotals& totals, float measuredMl) {
+  if (!(totals.pumpCurveMl >= MIN_CALIBRATION_ML) || !(measuredMl > 0.0f)) {
+    return NAN;
+  }
+  return (measuredMl + totals.retainedMl) / totals.pumpCurveMl;
+}
+
+FlowEstimator::FlowEstimator(const FlowEstimatorConfig& config)
+    : _config(config),
+      _flowScale(1.0f),
+      _targetVolumeMl(0.0f),
+      _running(false),
+      _hasPressure(false),
+      _pressureBar(0.0f),
+      _startPressureBar(0.0f),
+      _stroke(0.0f),
+      _slopeBarPerS(0.0f),
+      _resistance(NAN),
+      _shotSeconds(0.0f),
+      _pumpRunning(false),
+      _flowMlPerS(0.0f),
+      _pumpCurveMl(0.0),
+      _opvMl(0.0),
+      _retainedMl(0.0f),
+      _volumeMl(0.0f) {}
+
+void FlowEstimator::setFlowScale(float scale) {
+  if (!(scale >= FLOW_SCALE_MIN)) scale = FLOW_SCALE_MIN; // Also NaN
+  if (scale > FLOW_SCALE_MAX) scale = FLOW_SCALE_MAX;
+  _flowScale = scale;
+}
+
+void FlowEstimator::start() {
+  _running = true;
+  _startPressureBar = _pressureBar;
+  _resistance = NAN;
+  _shotSeconds = 0.0f;
+  _pumpRunning = true;
+  _flowMlPerS = 0.0f;
+  _pumpCurveMl = 0.0;
+  _opvMl = 0.0;
+  _retainedMl = 0.0f;
+  _volumeMl = 0.0f;
+}
+
+void FlowEstimator::stop() {
+  _running = false;
+}
+
+void FlowEstimator::update(float dtSeconds, float powerPercent, float pressureBar) {
+  if (isnan(pressureBar) || !(dtSeconds >= 0.0f)) {
+    return;
+  }
+  float targetStroke = 0.0f;
+  if (powerPercent > _config.minPowerPercent) {
+    targetStroke = (powerPercent - _config.minPowerPercent) / (100.0f - _config.minPowerPercent);
+    if (targetStroke > 1.0f) targetStroke = 1.0f;
+  }
+  _stroke += (targetStroke - _stroke) * dtSeconds / (_config.strokeTimeConstantS + dtSeconds);
+  if (_hasPressure && dtSeconds > 0.0f) {
+    float slope = (pressureBar - _pressureBar) / dtSeconds;
+    _slopeBarPerS += (slope - _slopeBarPerS) * dtSeconds / (_config.slopeTimeConstantS + dtSeconds);
+  }
+  _pressureBar = pressureBar;
+  _hasPressure = true;
+  if (!_running) {
+    return;
+  }
+  _shotSeconds += dtSeconds;
+
+  float pumpCurve = _config.freeFlowMlPerS * (_stroke - pressureBar / _config.deadHeadBar);
+  if (pumpCurve < 0.0f) pumpCurve = 0.0f; // Check valve
+  float opv = pressureBar > _config.opvBar ? (pressureBar - _config.opvBar) * _config.opvMlPerSPerBar : 0.0f;
+  float stored = _config.complianceMlPerBar * _slopeBarPerS; // Into the compliance
+  float runningFlow = _flowScale * pumpCurve - opv - stored;
+  float stoppedFlow = -stored;
+
+  // Pump running or stopped: whichever puck resistance is closer to the tracked one
+  _pumpRunning = true;
+  if (_shotSeconds > _config.pumpOffHoldoffS && !isnan(_resistance) && pressureBar > 0.0f && stoppedFlow > 0.0f) {
+    float stoppedMismatch = fabsf(logf(pressureBar / stoppedFlow / _resistance));
+    float runningMismatch = runningFlow > 0.0f ? fabsf(logf(pressureBar / runningFlow / _resistance)) : INFINITY;
+    _pumpRunning = runningMismatch <= stoppedMismatch;
+  }
+
+  if (_pumpRunning) {
+    _pumpCurveMl += pumpCurve * dtSeconds;
+    _opvMl += opv * dtSeconds;
+    if (runningFlow > MIN_RESISTANCE_FLOW_MLPS && pressureBar > 0.0f) {
+      float resistance = pressureBar / runningFlow;
+      if (resistance < MIN_RESISTANCE) resistance = MIN_RESISTANCE;
+      if (resistance > MAX_RESISTANCE) resistance = MAX_RESISTANCE;
+      if (isnan(_resistance)) _resistance = resistance;
+      else _resistance += (resistance - _resistance) * dtSeconds / (_config.resistanceTimeConstantS + dtSeconds);
+    }
+  }
+  float flow = _pumpRunning ? runningFlow : stoppedFlow;
+  _flowMlPerS = flow > 0.0f ? flow : 0.0f;
+
+  // Closed-form balance; the reading never goes back (noise on the pressure term)
+  _retainedMl = (float)_opvMl + _config.complianceMlPerBar * (pressureBar - _startPressureBar);
+  float volume = (float)(_flowScale * _pumpCurveMl) - _retainedMl;
+  if (volume > _volumeMl) _volumeMl = volume;
+}
+
+float FlowEstimator::flowMlPerS() const {
+  return _running ? _flowMlPerS : NAN;
+}
+
+float FlowEstimator::expectedFinalMl() const {
+  float stored = _config.complianceMlPerBar * (_pressureBar > 0.0f ? _pressureBar : 0.0f);
+  return _volumeMl + stored;
+}
+
+bool FlowEstimator::targetReached() const {
+  return _running && _targetVolumeMl > 0.0f && expectedFinalMl() >= _targetVolumeMl;
+}
+
+FlowShotTotals FlowEstimator::totals() const {
+  FlowShotTotals totals;
+  totals.volumeMl = _volumeMl;
+  totals.pumpCurveMl = (float)_pumpCurveMl;
+  totals.retainedMl = _retainedMl;
+  return totals;
+}
@@ -0,0 +1,102 @@
+#ifndef FLOW_ESTIMATOR_H
+#define FLOW_ESTIMATOR_H
+
+#include <stdint.h>
+
+// --- Flow and Yield Estimation ---
+// There is no flow meter: the flow through the puck is estimated from the pump's curve at
+// the dimmer power and the measured pressure, minus what goes into the compliance of the
+// hoses and the headspace air while the pressure rises (and plus what comes back out as it
+// falls) and what the over-pressure valve returns to the tank:
+//
+//   flow = flowScale * pumpCurve(stroke, pressure) - opv(pressure) - compliance * dP/dt
+//
+// The pump curve is linear in pressure (free flow at 0 bar, none at the dead head), scaled
+// by the stroke the dimmer power allows, which follows the power with a short lag. The
+// volume of a shot integrates the same balance in closed form (the compliance term is the
+// pressure change since the shot start), so it carries no derivative noise; only the flow
+// reading uses a smoothed dP/dt.
+// The brew switch is not wired to the controller, so the pump is assumed running unless
+// the pressure falls the way a puck drains the stored water alone: from pumpOffHoldoffS
+// into the shot, each step is attributed to the pump running or stopped by which of the
+// two implies a puck resistance closer to the one tracked so far.
+// Runs once per decimated pressure block on the smoothed pressure, like PumpController.
+struct FlowEstimatorConfig {
+  FlowEstimatorConfig();
+
+  float freeFlowMlPerS;         // Pump flow at 0 bar, full stroke
+  float deadHeadBar;            // Pump pressure at zero flow, full stroke
+  float minPowerPercent;        // Below this the vibratory pump moves no water
+  float strokeTimeConstantS;    // Pump response to a power change
+  float complianceMlPerBar;     // Water stored per bar of pressure (hoses, headspace air)
+  float opvBar;                 // Over-pressure valve opens above this
+  float opvMlPerSPerBar;
+  float slopeTimeConstantS;     // Smoothing of dP/dt for the flow reading
+  float resistanceTimeConstantS; // Tracking of the puck resistance
+  float pumpOffHoldoffS;        // Pump assumed running this long after the shot start
+};
+
+// Water balance of the current or last shot: volumeMl = flowScale * pumpCurveMl - retainedMl
+struct FlowShotTotals {
+  float volumeMl;     // Through the puck since the shot start
+  float pumpCurveMl;  // Pump curve integrated while the pump ran, before flowScale
+  float retainedMl;   // Returned by the over-pressure valve plus stored by the pressure rise
+};
+
+// Accepted flowScale range (the pump curve is off by more than this: check the config)
+const float FLOW_SCALE_MIN = 0.5f;
+const float FLOW_SCALE_MAX = 2.0f;
+
+// flowScale that makes the shot's volume match a weighed yield (1 g = 1 ml). NAN if the
+// shot moved too little water to tell.
+float flowScaleFor(const FlowShotTotals& totals, float measuredMl);
+
+class FlowEstimator {
+public:
+  explicit FlowEstimator(const FlowEstimatorConfig& config = FlowEstimatorConfig());
+
+  // Pump calibration from a weighed shot, clamped to FLOW_SCALE_MIN..FLOW_SCALE_MAX (default 1).
+  void setFlowScale(float scale);
+  float flowScale() const { return _flowScale; }
+  // Volumetric stop: targetReached() once the shot plus the water still stored above the
+  // puck reaches this. 0: off.
+  void setTargetVolume(float ml) { _targetVolumeMl = ml > 0.0f ? ml : 0.0f; }
+  float targetVolumeMl() const { return _targetVolumeMl; }
+
+  void start(); // Shot timer started: volume from 0 at the current pressure
+  void stop();  // Shot timer stopped: volume and totals hold until the next start
+
+  // One step: seconds since the previous step, the dimmer power during it and the smoothed
+  // pressure at its end. Runs between shots too (the stroke and dP/dt keep up).
+  void update(float dtSeconds, float powerPercent, float pressureBar);
+
+  bool isRunning() const { return _running; }
+  float flowMlPerS() const;      // Through the puck, NAN outside a shot
+  float volumeMl() const { return _volumeMl; } // Current or last shot
+  float expectedFinalMl() const; // Volume plus the stored water the puck will still pass
+  bool targetReached() const;
+  bool pumpRunning() const { return _pumpRunning; } // Attribution of the last step
+  FlowShotTotals totals() const;
+  const FlowEstimatorConfig& config() const { return _config; }
+
+private:
+  FlowEstimatorConfig _config;
+  float _flowScale;
+  float _targetVolumeMl;
+  bool _running;
+  bool _hasPressure;
+  float _pressureBar;    // Latest step
+  float _startPressureBar;
+  float _stroke;         // 0..1
+  float _slopeBarPerS;   // Smoothed dP/dt
+  float _resistance;     // Puck, bar per ml/s; NAN until the first estimate of the shot
+  float _shotSeconds;
+  bool _pumpRunning;
+  float _flowMlPerS;
+  double _pumpCurveMl;
+  double _opvMl;
+  float _retainedMl;     // Over-pressure valve plus compliance since the start
+  float _volumeMl;
+};
+
+#endif // FLOW_ESTIMATOR_H
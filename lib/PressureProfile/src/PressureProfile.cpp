@@ -0,0 +1,67 @@
+#include "PressureProfile.h"
+
+const char* profilePhaseName(ProfilePhase phase) {
+  switch (phase) {
+    case PROFILE_PREINFUSION: return "preinfusion";
+    case PROFILE_RAMP: return "ramp";
+    case PROFILE_HOLD: return "hold";
+    case PROFILE_DECLINE: return "decline";
+    case PROFILE_END: return "end";
+  }
+  return "unknown";
+}
+
+PressureProfile defaultPressureProfile() {
+  PressureProfile profile;
+  profile.preinfusionBar = 3.0f;
+  profile.preinfusionS = 8.0f;
+  profile.rampS = 4.0f;
+  profile.holdBar = 9.0f;
+  profile.holdS = 14.0f;
+  profile.declineS = 10.0f;
+  profile.endBar = 6.0f;
+  return profile;
+}
+
+namespace {
+bool pressureInRange(float bar) { return bar >= PROFILE_MIN_BAR && bar <= PROFILE_MAX_BAR; }
+bool durationInRange(float seconds) { return seconds >= 0.0f && seconds <= PROFILE_MAX_PHASE_S; }
+}
+
+const char* checkPressureProfile(const PressureProfile& profile) {
+  if (!pressureInRange(profile.preinfusionBar) || !pressureInRange(profile.holdBar) ||
+      !pressureInRange(profile.endBar)) {
+    return "pressures must be 2 to 12 bar";
+  }
+  if (!durationInRange(profile.preinfusionS) || !durationInRange(profile.rampS) ||
+      !durationInRange(profile.holdS) || !durationInRange(profile.declineS)) {
+    return "durations must be 0 to 120 s";
+  }
+  return nullptr;
+}
+
+ProfilePhase profilePhaseAt(const PressureProfile& profile, float seconds) {
+  if (seconds < profile.preinfusionS) return PROFILE_PREINFUSION;
+  seconds -= profile.preinfusionS;
+  if (seconds < profile.rampS) return PROFILE_RAMP;
+  seconds -= profile.rampS;
+  if (seconds < profile.holdS) return PROFILE_HOLD;
+  seconds -= profile.holdS;
+  if (seconds < profile.declineS) return PROFILE_DECLINE;
+  return PROFILE_END;
+}
+
+float profileTargetBar(const PressureProfile& profile, float seconds) {
+  if (seconds < profile.preinfusionS) return profile.preinfusionBar;
+  seconds -= profile.preinfusionS;
+  if (seconds < profile.rampS) {
+    return profile.preinfusionBar + (profile.holdBar - profile.preinfusionBar) * seconds / profile.rampS;
+  }
+  seconds -= profile.rampS;
+  if (seconds < profile.holdS) return profile.holdBar;
+  seconds -= profile.holdS;
+  if (seconds < profile.declineS) {
+    return profile.holdBar + (profile.endBar - profile.holdBar) * seconds / profile.declineS;
+  }
+  return profile.endBar;
+}
@@ -0,0 +1,43 @@
+#ifndef PRESSURE_PROFILE_H
+#define PRESSURE_PROFILE_H
+
+// --- Shot Pressure Profile ---
+// Target pressure over a shot, timed from the shot timer start: pre-infusion at a constant
+// pressure, a linear ramp to the hold pressure, the hold, then a linear decline to the end
+// pressure, which is kept until the shot stops. A phase with zero duration is skipped.
+// Plain struct: stored in NVS as one blob.
+struct PressureProfile {
+  float preinfusionBar;
+  float preinfusionS;
+  float rampS;
+  float holdBar;
+  float holdS;
+  float declineS;
+  float endBar;
+};
+
+enum ProfilePhase {
+  PROFILE_PREINFUSION,
+  PROFILE_RAMP,
+  PROFILE_HOLD,
+  PROFILE_DECLINE,
+  PROFILE_END
+};
+
+const char* profilePhaseName(ProfilePhase phase);
+
+// Targets must stay above the shot timer's 1.7 bar stop threshold, or the shot would end
+// mid-profile; the top is below the usual over-pressure valve setting.
+const float PROFILE_MIN_BAR = 2.0f;
+const float PROFILE_MAX_BAR = 12.0f;
+const float PROFILE_MAX_PHASE_S = 120.0f;
+
+PressureProfile defaultPressureProfile(); // 3 bar for 8 s, 4 s ramp, 9 bar for 14 s, 10 s decline to 6 bar
+
+// nullptr if the profile is usable, otherwise why not (for the HTTP reply).
+const char* checkPressureProfile(const PressureProfile& profile);
+
+ProfilePhase profilePhaseAt(const PressureProfile& profile, float seconds);
+float profileTargetBar(const PressureProfile& profile, float seconds);
+
+#endif // PRESSURE_PROFILE_H
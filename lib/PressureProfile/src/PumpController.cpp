@@ -0,0 +1,102 @@
+#include "PumpController.h"
+
+#include <math.h>
+
+// Defaults tuned with `program profile` on the hydraulic model (lib/BoilerSim): a
+// vibratory pump of 15 bar and 8 ml/s free flow into a puck passing 2 ml/s at 9 bar. The
+// gains are a quarter of where they stop improving the tracking there, as a margin for
+// the delays the model leaves out.
+PumpControllerConfig::PumpControllerConfig()
+    : idlePowerPercent(100.0f),
+      minPowerPercent(30.0f),
+      maxPowerPercent(100.0f),
+      feedforwardPercentPerBar(6.5f),
+      kp(12.0f),
+      ki(30.0f) {}
+
+PumpController::PumpController(const PumpControllerConfig& config)
+    : _config(config),
+      _profile(defaultPressureProfile()),
+      _enabled(false),
+      _active(false),
+      _integral(0.0f),
+      _power(config.idlePowerPercent),
+      _lastShotSeconds(0.0f),
+      _lastTargetBar(NAN),
+      _squaredErrorSum(0.0),
+      _maxOvershootBar(0.0f),
+      _samples(0) {}
+
+void PumpController::setEnabled(bool enabled) {
+  _enabled = enabled;
+  if (!enabled) {
+    stop();
+  }
+}
+
+void PumpController::start() {
+  if (!_enabled) {
+    return;
+  }
+  _active = true;
+  _integral = 0.0f;
+  _lastShotSeconds = 0.0f;
+  _lastTargetBar = profileTargetBar(_profile, 0.0f);
+  _squaredErrorSum = 0.0;
+  _maxOvershootBar = 0.0f;
+  _samples = 0;
+}
+
+void PumpController::stop() {
+  _active = false;
+  _power = _config.idlePowerPercent;
+}
+
+float PumpController::clampPower(float power) const {
+  if (power > _config.maxPowerPercent) return _config.maxPowerPercent;
+  if (power < _config.minPowerPercent) return _config.minPowerPercent;
+  return power;
+}
+
+float PumpController::update(float shotSeconds, float pressureBar) {
+  if (!_active) {
+    return _power;
+  }
+  float dtSeconds = shotSeconds - _lastShotSeconds;
+  _lastShotSeconds = shotSeconds;
+  if (isnan(pressureBar)) {
+    return _power; // Keep the last output until the sensor reads again
+  }
+
+  _lastTargetBar = profileTargetBar(_profile, shotSeconds);
+  float trackingError = pressureBar - _lastTargetBar;
+  _squaredErrorSum += (double)trackingError * trackingError;
+  if (trackingError > _maxOvershootBar) _maxOvershootBar = trackingError;
+  _samples++;
+
+  float error = -trackingError;
+  float feedforward = _config.minPowerPercent + _config.feedforwardPercentPerBar * _lastTargetBar;
+  float unclamped = feedforward + _config.kp * error + _integral;
+
+  // Conditional integration: do not push further into saturation
+  bool saturatedHigh = unclamped >= _config.maxPowerPercent && error > 0;
+  bool saturatedLow = unclamped <= _config.minPowerPercent && error < 0;
+  if (!saturatedHigh && !saturatedLow && dtSeconds > 0) {
+    _integral += _config.ki * error * dtSeconds;
+  }
+
+  _power = clampPower(feedforward + _config.kp * error + _integral);
+  return _power;
+}
+
+float PumpController::targetBar() const {
+  return _active ? _lastTargetBar : NAN;
+}
+
+ProfileTracking PumpController::tracking() const {
+  ProfileTracking tracking;
+  tracking.rmsErrorBar = _samples > 0 ? (float)sqrt(_squaredErrorSum / _samples) : NAN;
+  tracking.maxOvershootBar = _maxOvershootBar;
+  tracking.samples = _samples;
+  return tracking;
+}
@@ -0,0 +1,73 @@
+#ifndef PUMP_CONTROLLER_H
+#define PUMP_CONTROLLER_H
+
+#include <stdint.h>
+
+#include "PressureProfile.h"
+
+// --- Closed-Loop Pump Pressure Control ---
+// Follows a PressureProfile during a shot by setting the pump's AC dimmer power (phase
+// angle, percent). Runs once per decimated pressure block (50 Hz) on the smoothed pressure:
+// a feedforward from the target pressure (the power that holds it on a typical puck) plus a
+// PI correction for the actual puck, with the integral frozen while the output is saturated
+// in the error's direction.
+// Outside a profiled shot the output is idlePowerPercent: with the default of 100 the pump
+// behaves as without the dimmer, so hot water and a disabled profile are unaffected.
+struct PumpControllerConfig {
+  PumpControllerConfig();
+
+  float idlePowerPercent;        // Before the shot timer starts, after it stops, profile off
+  float minPowerPercent;         // Below this the vibratory pump moves no water
+  float maxPowerPercent;
+  float feedforwardPercentPerBar; // Power above minPowerPercent per bar of target
+  float kp;                       // Percent per bar of error
+  float ki;                       // Percent per bar * second
+};
+
+// Tracking of the current (or last) profiled shot
+struct ProfileTracking {
+  float rmsErrorBar;
+  float maxOvershootBar; // Largest pressure above target
+  uint32_t samples;
+};
+
+class PumpController {
+public:
+  explicit PumpController(const PumpControllerConfig& config = PumpControllerConfig());
+
+  void setProfile(const PressureProfile& profile) { _profile = profile; }
+  const PressureProfile& profile() const { return _profile; }
+  void setEnabled(bool enabled); // Takes effect at the next shot start
+  bool isEnabled() const { return _enabled; }
+
+  void start(); // Shot timer started: follow the profile from time 0 (if enabled)
+  void stop();  // Shot timer stopped: back to idle power
+
+  // One control step: seconds since the shot timer started and the smoothed pressure.
+  // Returns the dimmer power in percent.
+  float update(float shotSeconds, float pressureBar);
+
+  bool isActive() const { return _active; }
+  float power() const { return _power; }
+  float targetBar() const; // NAN when not active
+  ProfilePhase phase() const { return profilePhaseAt(_profile, _lastShotSeconds); }
+  ProfileTracking tracking() const;
+  const PumpControllerConfig& config() const { return _config; }
+
+private:
+  float clampPower(float power) const;
+
+  PumpControllerConfig _config;
+  PressureProfile _profile;
+  bool _enabled;
+  bool _active;
+  float _integral;
+  float _power;
+  float _lastShotSeconds;
+  float _lastTargetBar;
+  double _squaredErrorSum;
+  float _maxOvershootBar;
+  uint32_t _samples;
+};
+
+#endif // PUMP_CONTROLLER_H
@@ -0,0 +1,195 @@
+#include "CalibrationCurve.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+const int RISING_CHECK_STEPS = 256; // Samples across the calibrated range
+}
+
+const char* calibrationFitName(CalibrationFit fit) {
+  return fit == CALIBRATION_POLYNOMIAL ? "polynomial" : "piecewise";
+}
+
+bool parseCalibrationFit(const char* name, CalibrationFit& fit) {
+  if (strcmp(name, "piecewise") == 0) fit = CALIBRATION_PIECEWISE;
+  else if (strcmp(name, "polynomial") == 0) fit = CALIBRATION_POLYNOMIAL;
+  else return false;
+  return true;
+}
+
+CalibrationCurve linearCalibration(double raw0, double actual0, double raw1, double actual1) {
+  CalibrationCurve curve;
+  curve.fit = CALIBRATION_PIECEWISE;
+  curve.degree = 1;
+  curve.pointCount = 2;
+  curve.points[0].raw = (float)raw0;
+  curve.points[0].actual = (float)actual0;
+  curve.points[1].raw = (float)raw1;
+  curve.points[1].actual = (float)actual1;
+  return curve;
+}
+
+bool parseCalibrationPoints(const char* text, CalibrationCurve& curve) {
+  CalibrationPoint points[CalibrationCurve::MAX_POINTS];
+  int count = 0;
+  const char* p = text;
+  while (*p) {
+    if (count == CalibrationCurve::MAX_POINTS) return false;
+    char* end;
+    double raw = strtod(p, &end);
+    if (end == p || *end != ':') return false;
+    p = end + 1;
+    double actual = strtod(p, &end);
+    if (end == p || isnan(raw) || isnan(actual)) return false;
+    p = end;
+    if (*p == ',' || *p == ';') p++;
+    else if (*p) return false;
+
+    // Insertion sort by raw value, repeated raw values are an error
+    int i = count;
+    while (i > 0 && points[i - 1].raw > (float)raw) {
+      points[i] = points[i - 1];
+      i--;
+    }
+    if (i > 0 && points[i - 1].raw == (float)raw) return false;
+    points[i].raw = (float)raw;
+    points[i].actual = (float)actual;
+    count++;
+  }
+  if (count == 0) return false;
+  memcpy(curve.points, points, sizeof(points[0]) * count);
+  curve.pointCount = count;
+  return true;
+}
+
+CalibrationFunction::CalibrationFunction()
+    : _centre(0.0), _scale(1.0), _maxResidual(0.0), _error("not fitted"), _valid(false) {
+  memset(&_curve, 0, sizeof(_curve));
+  memset(_coefficients, 0, sizeof(_coefficients));
+}
+
+bool CalibrationFunction::fit(const CalibrationCurve& curve) {
+  _valid = false;
+  _curve = curve;
+  if (curve.pointCount < 2 || curve.pointCount > CalibrationCurve::MAX_POINTS) {
+    _error = "need 2 to 16 points";
+    return false;
+  }
+  for (int i = 1; i < curve.pointCount; i++) {
+    if (!(curve.points[i].raw > curve.points[i - 1].raw)) {
+      _error = "raw values must be distinct and sorted";
+      return false;
+    }
+  }
+  if (curve.fit == CALIBRATION_POLYNOMIAL) {
+    if (curve.degree < 1 || curve.degree > CalibrationCurve::MAX_DEGREE) {
+      _error = "degree must be 1 to 3";
+      return false;
+    }
+    if (curve.pointCount < curve.degree + 1) {
+      _error = "polynomial needs degree + 1 points";
+      return false;
+    }
+    if (!fitPolynomial()) {
+      return false;
+    }
+  }
+  _valid = true; // evaluate() works from here on
+  if (!checkRising()) {
+    _valid = false;
+    return false;
+  }
+
+  _maxResidual = 0.0;
+  for (int i = 0; i < curve.pointCount; i++) {
+    double residual = fabs(evaluate(curve.points[i].raw) - curve.points[i].actual);
+    if (residual > _maxResidual) _maxResidual = residual;
+  }
+  _error = nullptr;
+  return true;
+}
+
+// Normal equations in u = (raw - centre) / scale (u in -1..1 keeps them well conditioned),
+// solved by Gaussian elimination with partial pivoting.
+bool CalibrationFunction::fitPolynomial() {
+  const int n = _curve.degree + 1;
+  double first = _curve.points[0].raw;
+  double last = _curve.points[_curve.pointCount - 1].raw;
+  _centre = (first + last) / 2.0;
+  _scale = (last - first) / 2.0;
+
+  double a[CalibrationCurve::MAX_DEGREE + 1][CalibrationCurve::MAX_DEGREE + 2];
+  memset(a, 0, sizeof(a));
+  for (int k = 0; k < _curve.pointCount; k++) {
+    double u = (_curve.points[k].raw - _centre) / _scale;
+    double powers[2 * CalibrationCurve::MAX_DEGREE + 1];
+    powers[0] = 1.0;
+    for (int i = 1; i < 2 * n - 1; i++) powers[i] = powers[i - 1] * u;
+    for (int row = 0; row < n; row++) {
+      for (int col = 0; col < n; col++) a[row][col] += powers[row + col];
+      a[row][n] += powers[row] * _curve.points[k].actual;
+    }
+  }
+
+  for (int col = 0; col < n; col++) {
+    int pivot = col;
+    for (int row = col + 1; row < n; row++) {
+      if (fabs(a[row][col]) > fabs(a[pivot][col])) pivot = row;
+    }
+    if (fabs(a[pivot][col]) < 1e-12) {
+      _error = "points do not determine the polynomial";
+      return false;
+    }
+    for (int i = 0; i <= n; i++) {
+      double swap = a[col][i];
+      a[col][i] = a[pivot][i];
+      a[pivot][i] = swap;
+    }
+    for (int row = col + 1; row < n; row++) {
+      double factor = a[row][col] / a[col][col];
+      for (int i = col; i <= n; i++) a[row][i] -= factor * a[col][i];
+    }
+  }
+  for (int row = n - 1; row >= 0; row--) {
+    double sum = a[row][n];
+    for (int i = row + 1; i < n; i++) sum -= a[row][i] * _coefficients[i];
+    _coefficients[row] = sum / a[row][row];
+  }
+  for (int i = n; i <= CalibrationCurve::MAX_DEGREE; i++) _coefficients[i] = 0.0;
+  return true;
+}
+
+bool CalibrationFunction::checkRising() {
+  double first = _curve.points[0].raw;
+  double last = _curve.points[_curve.pointCount - 1].raw;
+  double previous = evaluate(first);
+  for (int step = 1; step <= RISING_CHECK_STEPS; step++) {
+    double value = evaluate(first + (last - first) * step / RISING_CHECK_STEPS);
+    if (!(value > previous)) {
+      _error = "curve must rise across the calibrated range";
+      return false;
+    }
+    previous = value;
+  }
+  return true;
+}
+
+double CalibrationFunction::evaluate(double raw) const {
+  if (!_valid) {
+    return raw; // Uncalibrated
+  }
+  if (_curve.fit == CALIBRATION_POLYNOMIAL) {
+    double u = (raw - _centre) / _scale;
+    double value = 0.0;
+    for (int i = _curve.degree; i >= 0; i--) value = value * u + _coefficients[i];
+    return value;
+  }
+  // Segment containing raw; the end segments extend past the first and last point
+  int segment = 0;
+  while (segment < _curve.pointCount - 2 && raw > _curve.points[segment + 1].raw) segment++;
+  const CalibrationPoint& p0 = _curve.points[segment];
+  const CalibrationPoint& p1 = _curve.points[segment + 1];
+  return p0.actual + (raw - p0.raw) * ((double)p1.actual - p0.actual) / ((double)p1.raw - p0.raw);
+}
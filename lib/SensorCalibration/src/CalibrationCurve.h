@@ -0,0 +1,69 @@
+#ifndef CALIBRATION_CURVE_H
+#define CALIBRATION_CURVE_H
+
+#include <stddef.h>
+
+// --- N-Point Sensor Calibration ---
+// A calibration is a list of (raw, actual) reference points and how to fit them:
+// piecewise-linear through every point (extrapolated with the end segments) or a
+// least-squares polynomial. The fit runs in double when a curve is loaded (setup, HTTP
+// upload); CalibrationTable then samples it into a lookup table, so the per-sample path
+// never sees the points. Plain struct: stored in NVS as one blob.
+enum CalibrationFit {
+  CALIBRATION_PIECEWISE,  // Straight lines between the points
+  CALIBRATION_POLYNOMIAL  // Least-squares polynomial of the given degree
+};
+
+const char* calibrationFitName(CalibrationFit fit);
+bool parseCalibrationFit(const char* name, CalibrationFit& fit); // "piecewise" or "polynomial"
+
+struct CalibrationPoint {
+  float raw;
+  float actual;
+};
+
+struct CalibrationCurve {
+  static const int MAX_POINTS = 16;
+  static const int MAX_DEGREE = 3;
+
+  CalibrationFit fit;
+  int degree;      // CALIBRATION_POLYNOMIAL only, 1..MAX_DEGREE
+  int pointCount;
+  CalibrationPoint points[MAX_POINTS];
+};
+
+// Two-point straight line (the former fixed calibrations).
+CalibrationCurve linearCalibration(double raw0, double actual0, double raw1, double actual1);
+
+// "raw:actual,raw:actual,..." into curve.points, sorted by raw. False (curve unchanged) on
+// a syntax error, more than MAX_POINTS points or a repeated raw value.
+bool parseCalibrationPoints(const char* text, CalibrationCurve& curve);
+
+// --- Fitted Curve ---
+// The evaluated form of a CalibrationCurve. fit() checks the curve: at least two points
+// (degree + 1 for a polynomial), distinct raw values, and rising across the calibrated
+// range (a fit that turns back would map two raw readings to one temperature). error()
+// says why a fit was rejected.
+class CalibrationFunction {
+public:
+  CalibrationFunction();
+
+  bool fit(const CalibrationCurve& curve);
+  double evaluate(double raw) const;
+  double maxResidual() const { return _maxResidual; } // Largest |fit - actual| at the points
+  const char* error() const { return _error; }
+
+private:
+  bool fitPolynomial();
+  bool checkRising();
+
+  CalibrationCurve _curve;
+  double _coefficients[CalibrationCurve::MAX_DEGREE + 1]; // In the centred, scaled variable
+  double _centre;
+  double _scale;
+  double _maxResidual;
+  const char* _error;
+  bool _valid;
+};
+
+#endif // CALIBRATION_CURVE_H
@@ -0,0 +1,58 @@
+#ifndef CALIBRATION_TABLE_H
+#define CALIBRATION_TABLE_H
+
+#include <math.h>
+
+#include "CalibrationCurve.h"
+#include "SensorScalar.h"
+
+// --- Calibration Lookup Table ---
+// A fitted calibration sampled at SEGMENTS + 1 evenly spaced inputs from inputMin, with a
+// power-of-two spacing, and stored as per-segment base and slope. apply() then costs the
+// same for any number of points or polynomial degree: a subtract, a multiply by the exact
+// inverse spacing, an integer conversion, and one multiply-add, with no divide. Q16.16 handles it exactly
+// (SensorScalar: float, or Q16.16 with SENSOR_FIXED_POINT). Inputs outside the table
+// extend the first or last segment. Between samples the table is linear, so a piecewise
+// curve is exact wherever its breakpoints fall on the grid; elsewhere the error is bounded
+// by the change of slope across one segment.
+template <typename Scalar, int SEGMENTS>
+class BasicCalibrationTable {
+public:
+  BasicCalibrationTable() : _inputMin(0), _inverseStep(1) {
+    for (int i = 0; i < SEGMENTS; i++) {
+      _base[i] = Scalar(i);
+      _slope[i] = Scalar(1);
+    }
+  }
+
+  // Samples function at inputMin + i * 2^stepLog2 (table input units); rawPerInput converts
+  // those to the curve's raw units (e.g. ADC counts to volts).
+  void build(const CalibrationFunction& function, double inputMin, int stepLog2, double rawPerInput = 1.0) {
+    double step = ldexp(1.0, stepLog2);
+    _inputMin = Scalar(inputMin);
+    _inverseStep = Scalar(1.0 / step);
+    double previous = function.evaluate(inputMin * rawPerInput);
+    for (int i = 0; i < SEGMENTS; i++) {
+      double next = function.evaluate((inputMin + (i + 1) * step) * rawPerInput);
+      _base[i] = Scalar(previous);
+      _slope[i] = Scalar(next - previous);
+      previous = next;
+    }
+  }
+
+  Scalar apply(Scalar input) const {
+    Scalar position = (input - _inputMin) * _inverseStep;
+    int index = scalarIndex(position);
+    if (index < 0) index = 0;
+    if (index > SEGMENTS - 1) index = SEGMENTS - 1;
+    return _base[index] + (position - Scalar(index)) * _slope[index];
+  }
+
+private:
+  Scalar _inputMin;
+  Scalar _inverseStep;
+  Scalar _base[SEGMENTS];  // Value at the start of each segment
+  Scalar _slope[SEGMENTS]; // Change across the segment
+};
+
+#endif // CALIBRATION_TABLE_H
@@ -0,0 +1,59 @@
+#include "ShotRecorder.h"
+
+#include <math.h>
+
+#include "TelemetryFrame.h"
+
+ShotRecorder::ShotRecorder(unsigned long sampleIntervalMs)
+    : _sampleIntervalMs(sampleIntervalMs), _recording(false), _startMs(0), _lastSampleMs(0), _count(0) {}
+
+void ShotRecorder::start(unsigned long nowMs) {
+  _recording = true;
+  _startMs = nowMs;
+  _count = 0;
+}
+
+void ShotRecorder::update(unsigned long nowMs, float temperatureC, float pressureBar, float flowMlPerS, float volumeMl) {
+  if (!_recording || _count == MAX_SAMPLES) return;
+  if (_count > 0 && nowMs - _lastSampleMs < _sampleIntervalMs) return;
+  _lastSampleMs = nowMs;
+  _timeMs[_count] = (uint32_t)(nowMs - _startMs);
+  _temperatureC[_count] = temperatureC;
+  _pressureBar[_count] = pressureBar;
+  _flowMlPerS[_count] = flowMlPerS;
+  _volumeMl[_count] = volumeMl;
+  _count++;
+}
+
+float ShotRecorder::startTemperatureC() const {
+  for (size_t i = 0; i < _count; i++) {
+    if (!isnan(_temperatureC[i])) return _temperatureC[i];
+  }
+  return NAN;
+}
+
+size_t ShotRecorder::encode(uint8_t* buffer, size_t capacity) const {
+  for (size_t stride = 1; stride <= _count || stride == 1; stride++) {
+    size_t length = encodeEvery(stride, buffer, capacity);
+    if (length > 0) return length;
+  }
+  return 0;
+}
+
+size_t ShotRecorder::encodeEvery(size_t stride, uint8_t* buffer, size_t capacity) const {
+  uint32_t points = (uint32_t)((_count + stride - 1) / stride);
+  TelemetryFrameEncoder frame(buffer, capacity, 0, 4);
+  frame.beginSeries(TelemetryFrame::SERIES_TEMPERATURE, TEMPERATURE_DECIMALS, points);
+  for (size_t i = 0; i < _count; i += stride) frame.time(_timeMs[i]);
+  for (size_t i = 0; i < _count; i += stride) frame.value(_temperatureC[i]);
+  frame.beginSeries(TelemetryFrame::SERIES_PRESSURE, PRESSURE_DECIMALS, points);
+  for (size_t i = 0; i < _count; i += stride) frame.time(_timeMs[i]);
+  for (size_t i = 0; i < _count; i += stride) frame.value(_pressureBar[i]);
+  frame.beginSeries(TelemetryFrame::SERIES_FLOW, FLOW_DECIMALS, points);
+  for (size_t i = 0; i < _count; i += stride) frame.time(_timeMs[i]);
+  for (size_t i = 0; i < _count; i += stride) frame.value(_flowMlPerS[i]);
+  frame.beginSeries(TelemetryFrame::SERIES_VOLUME, VOLUME_DECIMALS, points);
+  for (size_t i = 0; i < _count; i += stride) frame.time(_timeMs[i]);
+  for (size_t i = 0; i < _count; i += stride) frame.value(_volumeMl[i]);
+  return frame.overflow() ? 0 : frame.length();
+}
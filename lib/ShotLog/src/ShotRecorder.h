@@ -0,0 +1,50 @@
+#ifndef SHOT_RECORDER_H
+#define SHOT_RECORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// --- Shot Recorder ---
+// Collects the temperature, pressure, flow and volume trace of the running shot at a fixed
+// interval and encodes it as a TelemetryFrame (times relative to the shot start) for the ShotStore.
+// Samples beyond MAX_SAMPLES are dropped; a trace that does not fit the record is thinned
+// (every 2nd, 3rd ... sample) until it does, so long shots only lose resolution.
+class ShotRecorder {
+public:
+  static const size_t MAX_SAMPLES = 480; // 2 minutes at 4 Hz
+  static const uint8_t TEMPERATURE_DECIMALS = 1;
+  static const uint8_t PRESSURE_DECIMALS = 2;
+  static const uint8_t FLOW_DECIMALS = 1;
+  static const uint8_t VOLUME_DECIMALS = 1;
+
+  explicit ShotRecorder(unsigned long sampleIntervalMs);
+
+  void start(unsigned long nowMs);
+  // Records a sample when the interval has passed since the last one.
+  void update(unsigned long nowMs, float temperatureC, float pressureBar, float flowMlPerS, float volumeMl);
+  void reset() { _recording = false; }
+
+  bool recording() const { return _recording; }
+  unsigned long startMs() const { return _startMs; }
+  size_t sampleCount() const { return _count; }
+  float startTemperatureC() const; // NAN if no sample had a temperature
+
+  // Returns the frame length, 0 if not even a thinned trace fits `capacity`.
+  size_t encode(uint8_t* buffer, size_t capacity) const;
+
+private:
+  size_t encodeEvery(size_t stride, uint8_t* buffer, size_t capacity) const;
+
+  unsigned long _sampleIntervalMs;
+  bool _recording;
+  unsigned long _startMs;
+  unsigned long _lastSampleMs;
+  size_t _count;
+  uint32_t _timeMs[MAX_SAMPLES]; // Since the shot start
+  float _temperatureC[MAX_SAMPLES];
+  float _pressureBar[MAX_SAMPLES];
+  float _flowMlPerS[MAX_SAMPLES];
+  float _volumeMl[MAX_SAMPLES];
+};
+
+#endif // SHOT_RECORDER_H
@@ -0,0 +1,374 @@
+#include "ShotStore.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace {
+const uint8_t SEGMENT_VERSION = 1;
+const uint8_t RECORD_SHOT = 1;
+const uint8_t RECORD_DELETE = 2;
+
+void put16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+void put32(uint8_t* p, uint32_t v) {
+  put16(p, (uint16_t)v);
+  put16(p + 2, (uint16_t)(v >> 16));
+}
+
+uint16_t get16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+uint32_t get32(const uint8_t* p) { return get16(p) | ((uint32_t)get16(p + 2) << 16); }
+
+// CRC-32 (IEEE, reflected), bitwise: records are written a few times per session.
+uint32_t crc32(const uint8_t* data, size_t length) {
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+  }
+  return ~crc;
+}
+
+bool validRecordHeader(const uint8_t* p) { return p[0] == 'S' && p[1] == 'R' && p[3] == 0; }
+
+int32_t toCenti(float value, int32_t low, int32_t high) {
+  if (isnan(value)) return 0;
+  float scaled = roundf(value * 100.0f);
+  return scaled < low ? low : (scaled > high ? high : (int32_t)scaled);
+}
+} // namespace
+
+ShotStoreConfig::ShotStoreConfig()
+    : segmentBytes(32768), maxSegments(32), flushThresholdBytes(ShotStore::WRITE_BUFFER_BYTES * 3 / 4),
+      flushIdleMs(10UL * 60UL * 1000UL) {}
+
+ShotStore::ShotStore(ShotSegmentStorage& storage, const ShotStoreConfig& config)
+    : _storage(storage), _config(config), _indexCount(0), _segmentCount(0), _lastSequence(0), _activeSize(0),
+      _activeSealed(false), _nextId(1), _pendingLength(0), _lastAddMs(0), _storedBytes(0), _bytesWritten(0),
+      _writeCount(0), _writeErrors(0), _damagedRecords(0) {
+  if (_config.maxSegments > MAX_SEGMENTS) _config.maxSegments = MAX_SEGMENTS;
+  if (_config.maxSegments < 1) _config.maxSegments = 1;
+}
+
+size_t ShotStore::begin() {
+  _indexCount = 0;
+  _segmentCount = 0;
+  _lastSequence = 0;
+  _activeSize = 0;
+  _activeSealed = false;
+  _nextId = 1;
+  _pendingLength = 0;
+  _storedBytes = 0;
+  _bytesWritten = 0;
+  _writeCount = 0;
+  _writeErrors = 0;
+  _damagedRecords = 0;
+
+  uint32_t found[MAX_SEGMENTS];
+  size_t foundCount = _storage.listSegments(found, MAX_SEGMENTS);
+  for (size_t i = 1; i < foundCount; i++) { // Insertion sort, a few dozen entries
+    uint32_t sequence = found[i];
+    size_t j = i;
+    for (; j > 0 && found[j - 1] > sequence; j--) found[j] = found[j - 1];
+    found[j] = sequence;
+  }
+  for (size_t i = 0; i < foundCount; i++) {
+    _segments[_segmentCount++] = found[i];
+    _lastSequence = found[i];
+    scanSegment(found[i], i + 1 == foundCount);
+  }
+  while (_segmentCount > _config.maxSegments && dropOldestSegment()) {
+  }
+  reclaimSegments();
+  return _indexCount;
+}
+
+// Replays one segment through the write buffer, a window at a time.
+void ShotStore::scanSegment(uint32_t sequence, bool last) {
+  long size = _storage.segmentSize(sequence);
+  if (size < 0) size = 0;
+  _storedBytes += (unsigned long)size;
+  uint32_t end = (uint32_t)size;
+  uint32_t offset = 0;
+  bool damaged = true;
+
+  if (end >= SEGMENT_HEADER_SIZE && _storage.read(sequence, 0, _pending, SEGMENT_HEADER_SIZE) && _pending[0] == 'S' &&
+      _pending[1] == 'S' && _pending[2] == 'G' && _pending[3] == SEGMENT_VERSION) {
+    uint32_t firstId = get32(_pending + 8);
+    if (firstId > _nextId) _nextId = firstId;
+    offset = SEGMENT_HEADER_SIZE;
+    damaged = false;
+  }
+
+  while (!damaged && offset < end) {
+    uint32_t window = end - offset < WRITE_BUFFER_BYTES ? end - offset : (uint32_t)WRITE_BUFFER_BYTES;
+    if (!_storage.read(sequence, offset, _pending, window)) {
+      damaged = true;
+      break;
+    }
+    uint32_t position = 0;
+    while (position < window) {
+      if (window - position < RECORD_HEADER_SIZE) {
+        damaged = offset + window == end; // Torn header at the end, else refill
+        break;
+      }
+      const uint8_t* header = _pending + position;
+      uint32_t payloadLength = get32(header + 4);
+      if (!validRecordHeader(header) || payloadLength > MAX_RECORD_BYTES - RECORD_HEADER_SIZE) {
+        damaged = true;
+        break;
+      }
+      if (window - position < RECORD_HEADER_SIZE + payloadLength) {
+        damaged = offset + window == end; // Torn payload at the end, else refill
+        break;
+      }
+      const uint8_t* payload = header + RECORD_HEADER_SIZE;
+      if (crc32(payload, payloadLength) != get32(header + 12)) {
+        damaged = true;
+        break;
+      }
+      applyRecord(sequence, offset + position, header[2], get32(header + 8), payload, payloadLength);
+      position += RECORD_HEADER_SIZE + payloadLength;
+    }
+    offset += position;
+  }
+
+  if (damaged) _damagedRecords++;
+  if (last) {
+    _activeSize = end;
+    _activeSealed = damaged;
+  }
+}
+
+void ShotStore::applyRecord(uint32_t sequence, uint32_t offset, uint8_t type, uint32_t id, const uint8_t* payload,
+                            uint32_t payloadLength) {
+  if (id >= _nextId) _nextId = id + 1;
+  if (type == RECORD_DELETE) {
+    int index = indexOf(id);
+    if (index >= 0) eraseIndex((size_t)index);
+    return;
+  }
+  if (type != RECORD_SHOT || payloadLength < SHOT_HEADER_SIZE) return; // Unknown record types are skipped
+  if (_indexCount > 0 && id <= _index[_indexCount - 1].id) return;
+  if (_indexCount == MAX_SHOTS) eraseIndex(0);
+
+  IndexEntry& entry = _index[_indexCount++];
+  entry.id = id;
+  entry.startTime = get32(payload);
+  entry.durationMs = get32(payload + 4);
+  entry.maxPressureCentibar = get16(payload + 8);
+  entry.startTempCenti = (int16_t)get16(payload + 10);
+  entry.segment = sequence;
+  entry.offset = offset;
+  entry.recordBytes = RECORD_HEADER_SIZE + payloadLength;
+}
+
+bool ShotStore::add(ShotSummary& summary, const uint8_t* trace, unsigned long nowMs) {
+  if (summary.traceBytes > MAX_TRACE_BYTES) return false;
+  if (_indexCount == MAX_SHOTS && !dropOldestSegment()) return false;
+  size_t recordBytes = RECORD_HEADER_SIZE + SHOT_HEADER_SIZE + summary.traceBytes;
+  if (!reserve(recordBytes)) return false;
+
+  IndexEntry& entry = _index[_indexCount];
+  entry.id = _nextId++;
+  entry.startTime = summary.startTime;
+  entry.durationMs = summary.durationMs;
+  entry.maxPressureCentibar = (uint16_t)toCenti(summary.maxPressureBar, 0, 65535);
+  entry.startTempCenti = (int16_t)toCenti(summary.startTempC, -32768, 32767);
+  entry.segment = _segments[_segmentCount - 1];
+  entry.offset = _activeSize + (uint32_t)_pendingLength;
+  entry.recordBytes = (uint32_t)recordBytes;
+
+  uint8_t header[SHOT_HEADER_SIZE];
+  put32(header, entry.startTime);
+  put32(header + 4, entry.durationMs);
+  put16(header + 8, entry.maxPressureCentibar);
+  put16(header + 10, (uint16_t)entry.startTempCenti);
+  putRecord(RECORD_SHOT, entry.id, header, sizeof(header), trace, summary.traceBytes);
+
+  _indexCount++;
+  _lastAddMs = nowMs;
+  summary.id = entry.id;
+  return true;
+}
+
+bool ShotStore::remove(uint32_t id) {
+  if (indexOf(id) < 0 || !reserve(RECORD_HEADER_SIZE)) return false;
+  putRecord(RECORD_DELETE, id, nullptr, 0, nullptr, 0);
+  int index = indexOf(id); // reserve() may have dropped segments
+  if (index >= 0) eraseIndex((size_t)index);
+  reclaimSegments();
+  return true;
+}
+
+void ShotStore::service(unsigned long nowMs) {
+  if (_pendingLength == 0) return;
+  if (_pendingLength >= _config.flushThresholdBytes || nowMs - _lastAddMs >= _config.flushIdleMs) {
+    flush();
+  }
+}
+
+bool ShotStore::flush() {
+  if (_pendingLength == 0) return true;
+  uint32_t active = _segments[_segmentCount - 1];
+  if (_storage.append(active, _pending, _pendingLength)) {
+    _activeSize += (uint32_t)_pendingLength;
+    _storedBytes += _pendingLength;
+    _bytesWritten += _pendingLength;
+    _writeCount++;
+    _pendingLength = 0;
+    return true;
+  }
+
+  // Part of the batch may have landed: take the size from storage, never append behind it
+  // again, and forget the shots that were only pending.
+  _writeErrors++;
+  long size = _storage.segmentSize(active);
+  if (size > (long)_activeSize) {
+    _storedBytes += (unsigned long)size - _activeSize;
+  }
+  while (_indexCount > 0 && _index[_indexCount - 1].segment == active && _index[_indexCount - 1].offset >= _activeSize) {
+    _indexCount--;
+  }
+  _activeSealed = true;
+  _pendingLength = 0;
+  return false;
+}
+
+bool ShotStore::summaryAt(size_t index, ShotSummary& summary) const {
+  if (index >= _indexCount) return false;
+  toSummary(_index[index], summary);
+  return true;
+}
+
+bool ShotStore::find(uint32_t id, ShotSummary& summary) const {
+  int index = indexOf(id);
+  if (index < 0) return false;
+  toSummary(_index[index], summary);
+  return true;
+}
+
+size_t ShotStore::readTrace(uint32_t id, uint8_t* buffer, size_t capacity) {
+  int index = indexOf(id);
+  if (index < 0) return 0;
+  const IndexEntry& entry = _index[index];
+  if (entry.recordBytes > capacity) return 0;
+  if (entry.segment == _segments[_segmentCount - 1] && entry.offset >= _activeSize) {
+    memcpy(buffer, _pending + (entry.offset - _activeSize), entry.recordBytes);
+  } else if (!_storage.read(entry.segment, entry.offset, buffer, entry.recordBytes)) {
+    return 0;
+  }
+  uint32_t payloadLength = entry.recordBytes - RECORD_HEADER_SIZE;
+  if (!validRecordHeader(buffer) || buffer[2] != RECORD_SHOT || get32(buffer + 4) != payloadLength ||
+      get32(buffer + 8) != id || crc32(buffer + RECORD_HEADER_SIZE, payloadLength) != get32(buffer + 12)) {
+    return 0;
+  }
+  size_t traceBytes = payloadLength - SHOT_HEADER_SIZE;
+  memmove(buffer, buffer + RECORD_HEADER_SIZE + SHOT_HEADER_SIZE, traceBytes);
+  return traceBytes;
+}
+
+// Makes room for one record in the active segment and the write buffer.
+bool ShotStore::reserve(size_t recordBytes) {
+  if (_segmentCount == 0 || _activeSealed || _activeSize + _pendingLength + recordBytes > _config.segmentBytes) {
+    if (!rollSegment()) return false;
+  }
+  if (_pendingLength + recordBytes > WRITE_BUFFER_BYTES && !flush()) {
+    return false;
+  }
+  return true;
+}
+
+bool ShotStore::rollSegment() {
+  if (_segmentCount > 0) flush(); // On failure the pending records are gone, the new segment is clean
+  while (_segmentCount >= _config.maxSegments) {
+    if (!dropOldestSegment()) return false;
+  }
+  _lastSequence++;
+  _segments[_segmentCount++] = _lastSequence;
+  _activeSize = 0;
+  _activeSealed = false;
+
+  uint8_t* header = _pending;
+  header[0] = 'S';
+  header[1] = 'S';
+  header[2] = 'G';
+  header[3] = SEGMENT_VERSION;
+  put32(header + 4, _lastSequence);
+  put32(header + 8, _nextId);
+  put32(header + 12, 0);
+  _pendingLength = SEGMENT_HEADER_SIZE;
+  return true;
+}
+
+bool ShotStore::dropOldestSegment() {
+  if (_segmentCount == 0 || (_segmentCount == 1 && _pendingLength > 0)) return false;
+  uint32_t oldest = _segments[0];
+  long size = _storage.segmentSize(oldest);
+  _storage.remove(oldest);
+  if (size > 0) _storedBytes -= (unsigned long)size;
+
+  size_t dropped = 0;
+  while (dropped < _indexCount && _index[dropped].segment == oldest) dropped++; // Id order is segment order
+  memmove(_index, _index + dropped, (_indexCount - dropped) * sizeof(IndexEntry));
+  _indexCount -= dropped;
+  memmove(_segments, _segments + 1, (_segmentCount - 1) * sizeof(uint32_t));
+  _segmentCount--;
+  if (_segmentCount == 0) {
+    _activeSize = 0;
+    _activeSealed = false;
+  }
+  return true;
+}
+
+// Only the oldest segment may go: a newer one can hold the tombstones that keep shots in
+// older segments deleted.
+void ShotStore::reclaimSegments() {
+  while (_segmentCount > 1 && (_indexCount == 0 || _index[0].segment != _segments[0])) {
+    dropOldestSegment();
+  }
+}
+
+void ShotStore::putRecord(uint8_t type, uint32_t id, const uint8_t* summary, size_t summaryLength, const uint8_t* trace,
+                          size_t traceLength) {
+  uint8_t* header = _pending + _pendingLength;
+  uint8_t* payload = header + RECORD_HEADER_SIZE;
+  if (summaryLength > 0) memcpy(payload, summary, summaryLength);
+  if (traceLength > 0) memcpy(payload + summaryLength, trace, traceLength);
+  uint32_t payloadLength = (uint32_t)(summaryLength + traceLength);
+  header[0] = 'S';
+  header[1] = 'R';
+  header[2] = type;
+  header[3] = 0;
+  put32(header + 4, payloadLength);
+  put32(header + 8, id);
+  put32(header + 12, crc32(payload, payloadLength));
+  _pendingLength += RECORD_HEADER_SIZE + payloadLength;
+}
+
+int ShotStore::indexOf(uint32_t id) const {
+  size_t low = 0;
+  size_t high = _indexCount;
+  while (low < high) {
+    size_t middle = (low + high) / 2;
+    if (_index[middle].id < id) low = middle + 1;
+    else high = middle;
+  }
+  return low < _indexCount && _index[low].id == id ? (int)low : -1;
+}
+
+void ShotStore::eraseIndex(size_t index) {
+  memmove(_index + index, _index + index + 1, (_indexCount - index - 1) * sizeof(IndexEntry));
+  _indexCount--;
+}
+
+void ShotStore::toSummary(const IndexEntry& entry, ShotSummary& summary) {
+  summary.id = entry.id;
+  summary.startTime = entry.startTime;
+  summary.durationMs = entry.durationMs;
+  summary.maxPressureBar = entry.maxPressureCentibar / 100.0f;
+  summary.startTempC = entry.startTempCenti / 100.0f;
+  summary.traceBytes = entry.recordBytes - RECORD_HEADER_SIZE - SHOT_HEADER_SIZE;
+}
@@ -0,0 +1,139 @@
+#ifndef SHOT_STORE_H
+#define SHOT_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Segment files of the shot log, provided by the platform (LittleFS on the ESP32, a
+// file-backed flash image in the simulator). A segment is named by its sequence number and
+// only ever grows by append() or disappears by remove().
+class ShotSegmentStorage {
+public:
+  virtual ~ShotSegmentStorage() {}
+  virtual size_t listSegments(uint32_t* sequences, size_t capacity) = 0; // Existing segments, any order
+  virtual long segmentSize(uint32_t sequence) = 0;                        // -1 if missing
+  virtual bool read(uint32_t sequence, uint32_t offset, uint8_t* data, size_t length) = 0;
+  virtual bool append(uint32_t sequence, const uint8_t* data, size_t length) = 0; // Creates a missing segment
+  virtual bool remove(uint32_t sequence) = 0;
+};
+
+struct ShotStoreConfig {
+  ShotStoreConfig();
+
+  uint32_t segmentBytes;        // A new segment is started when a record would not fit
+  size_t maxSegments;           // Oldest segment (and its shots) dropped beyond this, <= MAX_SEGMENTS
+  size_t flushThresholdBytes;   // Write once this much is pending (most of a flash block)...
+  unsigned long flushIdleMs;    // ...or when nothing was added for this long
+};
+
+// One shot as listed. Pressure and temperature are kept in 0.01 units in the index.
+struct ShotSummary {
+  uint32_t id;          // Assigned by add(), increasing
+  uint32_t startTime;   // Unix time (s) of the shot start, 0 if the clock was not set
+  uint32_t durationMs;
+  float maxPressureBar;
+  float startTempC;
+  uint32_t traceBytes;  // Size of the TelemetryFrame trace
+};
+
+// --- Shot Store ---
+// Append-only log of shot records (summary plus TelemetryFrame trace) in segment files:
+//
+//   segment  'S' 'S' 'G' version:u8  sequence:u32  firstId:u32  reserved:u32
+//   record   'S' 'R' type:u8 0:u8  payloadLength:u32  id:u32  crc32(payload):u32  payload
+//   shot     startTime:u32  durationMs:u32  maxPressure:u16 (0.01 bar)  startTemp:i16 (0.01 C)  trace
+//   delete   (no payload) - tombstone for an earlier shot id
+//
+// Little-endian. begin() replays the segments into a RAM index (id order, so lookups by id
+// are binary searches and time filters scan 28-byte entries, not flash). Records are
+// batched in a one-block write buffer and written when it fills or the store has been idle
+// for flushIdleMs, so a session of shots costs one flash write instead of one per shot;
+// pending shots are listed and served from RAM meanwhile. Space is reclaimed a whole
+// segment at a time: the oldest segment goes once it holds no live shot, or when the store
+// exceeds maxSegments. Replay stops at the first damaged record of a segment (torn write)
+// and never appends behind it. Not thread-safe; one task owns the store.
+class ShotStore {
+public:
+  static const size_t MAX_SHOTS = 1024;
+  static const size_t MAX_SEGMENTS = 64;
+  static const size_t WRITE_BUFFER_BYTES = 4096;
+  static const size_t SEGMENT_HEADER_SIZE = 16;
+  static const size_t RECORD_HEADER_SIZE = 16;
+  static const size_t SHOT_HEADER_SIZE = 12;
+  static const size_t MAX_RECORD_BYTES = WRITE_BUFFER_BYTES - SEGMENT_HEADER_SIZE;
+  static const size_t MAX_TRACE_BYTES = MAX_RECORD_BYTES - RECORD_HEADER_SIZE - SHOT_HEADER_SIZE;
+
+  ShotStore(ShotSegmentStorage& storage, const ShotStoreConfig& config = ShotStoreConfig());
+
+  // Rebuilds the index from storage. Returns the number of shots found.
+  size_t begin();
+
+  // Appends a shot; summary.id is set on success. traceBytes <= MAX_TRACE_BYTES.
+  bool add(ShotSummary& summary, const uint8_t* trace, unsigned long nowMs);
+  bool remove(uint32_t id);
+  // Writes pending records when the batching rules say so. Call periodically, not during a shot.
+  void service(unsigned long nowMs);
+  bool flush(); // Writes pending records now (before a reboot or power-down)
+
+  size_t count() const { return _indexCount; }
+  bool summaryAt(size_t index, ShotSummary& summary) const; // Oldest first
+  bool find(uint32_t id, ShotSummary& summary) const;
+  // Copies the trace of a shot into buffer (capacity >= MAX_RECORD_BYTES; the record is
+  // read whole to check its CRC). Returns the trace length, 0 if missing or damaged.
+  size_t readTrace(uint32_t id, uint8_t* buffer, size_t capacity);
+
+  size_t segmentCount() const { return _segmentCount; }
+  unsigned long storedBytes() const { return _storedBytes; } // On flash, all segments
+  size_t pendingBytes() const { return _pendingLength; }
+  unsigned long bytesWritten() const { return _bytesWritten; } // Since begin()
+  unsigned long writeCount() const { return _writeCount; }
+  unsigned long writeErrors() const { return _writeErrors; }
+  unsigned long damagedRecords() const { return _damagedRecords; } // Found by begin()
+
+private:
+  struct IndexEntry {
+    uint32_t id;
+    uint32_t startTime;
+    uint32_t durationMs;
+    uint16_t maxPressureCentibar;
+    int16_t startTempCenti;
+    uint32_t segment;
+    uint32_t offset;      // Record start within the segment
+    uint32_t recordBytes;
+  };
+
+  void scanSegment(uint32_t sequence, bool last);
+  void applyRecord(uint32_t sequence, uint32_t offset, uint8_t type, uint32_t id, const uint8_t* payload, uint32_t payloadLength);
+  bool reserve(size_t recordBytes);
+  bool rollSegment();
+  bool dropOldestSegment();
+  void reclaimSegments();
+  void putRecord(uint8_t type, uint32_t id, const uint8_t* summary, size_t summaryLength, const uint8_t* trace, size_t traceLength);
+  int indexOf(uint32_t id) const;
+  void eraseIndex(size_t index);
+  static void toSummary(const IndexEntry& entry, ShotSummary& summary);
+
+  ShotSegmentStorage& _storage;
+  ShotStoreConfig _config;
+
+  IndexEntry _index[MAX_SHOTS];
+  size_t _indexCount;
+  uint32_t _segments[MAX_SEGMENTS]; // Ascending, the last one is the active segment
+  size_t _segmentCount;
+  uint32_t _lastSequence;
+  uint32_t _activeSize;             // Bytes of the active segment on flash
+  bool _activeSealed;               // Damaged tail or failed write: start a new segment
+  uint32_t _nextId;
+
+  uint8_t _pending[WRITE_BUFFER_BYTES]; // Also the replay window in begin()
+  size_t _pendingLength;
+  unsigned long _lastAddMs;
+
+  unsigned long _storedBytes;
+  unsigned long _bytesWritten;
+  unsigned long _writeCount;
+  unsigned long _writeErrors;
+  unsigned long _damagedRecords;
+};
+
+#endif // SHOT_STORE_H
@@ -0,0 +1,76 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+
+// --- Fixed-Point Number ---
+// Signed 32-bit value with FRAC_BITS fractional bits (Fixed<16> = Q16.16: range +/-32768,
+// resolution 1.5e-5). Products and quotients go through 64-bit intermediates and round to
+// nearest, so + - * / and comparisons are plain integer instructions on the ESP32 instead
+// of software-emulated double math. Integers convert implicitly; floating point only
+// explicitly, so every soft-float conversion is visible at the call site.
+template <int FRAC_BITS>
+class Fixed {
+public:
+  static const int32_t ONE = (int32_t)1 << FRAC_BITS;
+
+  Fixed() : _raw(0) {}
+  Fixed(int value) : _raw((int32_t)value * ONE) {}
+  Fixed(long value) : _raw((int32_t)value * ONE) {}
+  Fixed(unsigned value) : _raw((int32_t)value * ONE) {}
+  Fixed(unsigned long value) : _raw((int32_t)value * ONE) {}
+  explicit Fixed(float value) : _raw(roundToRaw((double)value * ONE)) {}
+  explicit Fixed(double value) : _raw(roundToRaw(value * ONE)) {}
+
+  static Fixed fromRaw(int32_t raw) {
+    Fixed f;
+    f._raw = raw;
+    return f;
+  }
+  // numerator / denominator without an intermediate that could overflow the integer part.
+  static Fixed fromRatio(int64_t numerator, int64_t denominator) {
+    return fromRaw((int32_t)roundedDivide(numerator * ONE, denominator));
+  }
+
+  int32_t raw() const { return _raw; }
+  explicit operator float() const { return (float)_raw / ONE; }
+  explicit operator double() const { return (double)_raw / ONE; }
+
+  Fixed operator-() const { return fromRaw(-_raw); }
+  Fixed operator+(Fixed other) const { return fromRaw(_raw + other._raw); }
+  Fixed operator-(Fixed other) const { return fromRaw(_raw - other._raw); }
+  Fixed operator*(Fixed other) const {
+    int64_t product = (int64_t)_raw * other._raw;
+    return fromRaw((int32_t)((product + (ONE >> 1)) >> FRAC_BITS));
+  }
+  Fixed operator/(Fixed other) const {
+    return fromRaw((int32_t)roundedDivide((int64_t)_raw * ONE, other._raw));
+  }
+  Fixed& operator+=(Fixed other) { _raw += other._raw; return *this; }
+  Fixed& operator-=(Fixed other) { _raw -= other._raw; return *this; }
+  Fixed& operator*=(Fixed other) { return *this = *this * other; }
+  Fixed& operator/=(Fixed other) { return *this = *this / other; }
+
+  bool operator<(Fixed other) const { return _raw < other._raw; }
+  bool operator>(Fixed other) const { return _raw > other._raw; }
+  bool operator<=(Fixed other) const { return _raw <= other._raw; }
+  bool operator>=(Fixed other) const { return _raw >= other._raw; }
+  bool operator==(Fixed other) const { return _raw == other._raw; }
+  bool operator!=(Fixed other) const { return _raw != other._raw; }
+
+private:
+  static int32_t roundToRaw(double scaled) { return (int32_t)(scaled < 0 ? scaled - 0.5 : scaled + 0.5); }
+  static int64_t roundedDivide(int64_t numerator, int64_t denominator) {
+    if (denominator < 0) {
+      numerator = -numerator;
+      denominator = -denominator;
+    }
+    return (numerator < 0 ? numerator - denominator / 2 : numerator + denominator / 2) / denominator;
+  }
+
+  int32_t _raw;
+};
+
+typedef Fixed<16> Q16_16;
+
+#endif // FIXED_POINT_H
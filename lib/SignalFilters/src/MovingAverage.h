@@ -0,0 +1,58 @@
+#ifndef MOVING_AVERAGE_H
+#define MOVING_AVERAGE_H
+
+#include <stddef.h>
+
+// --- Moving Average (SMA) ---
+// Mean of the last N samples from a running sum, O(1) per sample. Before the window is full
+// the mean covers the samples seen so far. Sum is the accumulator type (use a wider integer
+// for integer samples, double for float to keep the running sum from drifting).
+template <typename T, size_t N, typename Sum = double>
+class MovingAverage {
+public:
+  MovingAverage() { reset(); }
+
+  void reset() {
+    _next = 0;
+    _count = 0;
+    _sum = 0;
+  }
+
+  // Adds a sample and returns the new mean.
+  Sum update(T sample) {
+    if (_count == N) {
+      _sum -= _window[_next];
+    } else {
+      _count++;
+    }
+    _window[_next] = sample;
+    _sum += sample;
+    _next = (_next + 1) % N;
+    return mean();
+  }
+
+  Sum mean() const { return _count ? _sum / (Sum)_count : 0; }
+  bool full() const { return _count == N; }
+  size_t count() const { return _count; }
+  static size_t capacity() { return N; }
+
+  // Window extremes (scan of at most N samples; call only when count() > 0).
+  T minimum() const {
+    T value = _window[0];
+    for (size_t i = 1; i < _count; i++) if (_window[i] < value) value = _window[i];
+    return value;
+  }
+  T maximum() const {
+    T value = _window[0];
+    for (size_t i = 1; i < _count; i++) if (_window[i] > value) value = _window[i];
+    return value;
+  }
+
+private:
+  T _window[N];
+  size_t _next;
+  size_t _count;
+  Sum _sum;
+};
+
+#endif // MOVING_AVERAGE_H
@@ -0,0 +1,41 @@
+#ifndef SENSOR_SCALAR_H
+#define SENSOR_SCALAR_H
+
+#include <stdint.h>
+
+#include "FixedPoint.h"
+
+// --- Sensor Pipeline Number Type ---
+// The thermocouple calibration and EMAs and the pressure conversion, smoothing and
+// max-pressure stability check compute in SensorScalar. Build with -DSENSOR_FIXED_POINT
+// (platformio.ini build_flags) for Q16.16 integer math; the default is single-precision
+// float, which the ESP32 FPU handles in hardware (double would be emulated in software).
+//   SensorAccumulator: running sums (SMA); exact and drift-free in fixed point.
+#ifdef SENSOR_FIXED_POINT
+typedef Q16_16 SensorScalar;
+typedef Q16_16 SensorAccumulator;
+#else
+typedef float SensorScalar;
+typedef double SensorAccumulator;
+#endif
+
+// numerator / denominator in the given type (integer averages without overflow).
+template <typename Scalar>
+inline Scalar scalarRatio(int64_t numerator, int64_t denominator) {
+  return (Scalar)numerator / (Scalar)denominator;
+}
+template <>
+inline Q16_16 scalarRatio<Q16_16>(int64_t numerator, int64_t denominator) {
+  return Q16_16::fromRatio(numerator, denominator);
+}
+
+// Whole part of a non-negative table position (float truncates, Q16.16 shifts; neither
+// needs floor()). Negative positions round differently per type, callers clamp them to 0.
+inline int scalarIndex(float value) { return (int)value; }
+inline int scalarIndex(double value) { return (int)value; }
+template <int FRAC_BITS>
+inline int scalarIndex(Fixed<FRAC_BITS> value) {
+  return value.raw() >> FRAC_BITS;
+}
+
+#endif // SENSOR_SCALAR_H
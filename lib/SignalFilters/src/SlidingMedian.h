@@ -0,0 +1,113 @@
+#ifndef SLIDING_MEDIAN_H
+#define SLIDING_MEDIAN_H
+
+#include <stddef.h>
+
+// --- Sliding Median ---
+// Running median of the last N samples in O(log N) per sample (Mediator: a max-heap of the
+// lower half and a min-heap of the upper half sharing the median at their root). The heaps
+// hold indexes into a circular buffer, so the oldest sample is replaced in place rather than
+// searched for. Before the window is full the median covers the samples seen so far; with
+// an even count it is the mean of the two middle samples.
+template <typename T, size_t N>
+class SlidingMedian {
+public:
+  SlidingMedian() { reset(); }
+
+  void reset() {
+    _next = 0;
+    _count = 0;
+    // Initial heap fill pattern: median, max, min, max, min, ...
+    for (int i = (int)N - 1; i >= 0; i--) {
+      _pos[i] = ((i + 1) / 2) * ((i & 1) ? -1 : 1);
+      heap(_pos[i]) = i;
+    }
+  }
+
+  // Adds a sample (replacing the oldest once full) and returns the new median.
+  T update(T sample) {
+    bool isNew = _count < (int)N;
+    int p = _pos[_next];
+    T old = _data[_next];
+    _data[_next] = sample;
+    _next = (_next + 1) % N;
+    if (isNew) _count++;
+
+    if (p > 0) { // Sample sits in the min-heap
+      if (!isNew && old < sample) minSortDown(p * 2);
+      else if (minSortUp(p)) maxSortDown(-1);
+    } else if (p < 0) { // Sample sits in the max-heap
+      if (!isNew && sample < old) maxSortDown(p * 2);
+      else if (maxSortUp(p)) minSortDown(1);
+    } else { // Sample replaced the median
+      if (maxCount()) maxSortDown(-1);
+      if (minCount()) minSortDown(1);
+    }
+    return median();
+  }
+
+  T median() const {
+    if (_count == 0) return T();
+    T value = _data[heap(0)];
+    if ((_count & 1) == 0) value = (value + _data[heap(-1)]) / 2;
+    return value;
+  }
+
+  bool full() const { return _count == (int)N; }
+  size_t count() const { return _count; }
+
+private:
+  // Heap positions run from -(N/2) (max-heap) through 0 (median) to (N-1)/2 (min-heap).
+  int& heap(int position) { return _heap[position + (int)(N / 2)]; }
+  int heap(int position) const { return _heap[position + (int)(N / 2)]; }
+  // Heap sizes for the current count, capped at the full-window sizes (also lets the
+  // compiler see that heap positions stay in range).
+  int minCount() const { int c = (_count - 1) / 2; return c < (int)(N - 1) / 2 ? c : (int)(N - 1) / 2; }
+  int maxCount() const { int c = _count / 2; return c < (int)(N / 2) ? c : (int)(N / 2); }
+
+  bool less(int i, int j) const { return _data[heap(i)] < _data[heap(j)]; }
+  void exchange(int i, int j) {
+    int t = heap(i);
+    heap(i) = heap(j);
+    heap(j) = t;
+    _pos[heap(i)] = i;
+    _pos[heap(j)] = j;
+  }
+  // Swaps i and j if heap(i) < heap(j); true if swapped.
+  bool compareExchange(int i, int j) {
+    if (!less(i, j)) return false;
+    exchange(i, j);
+    return true;
+  }
+
+  // Restore the heap property from child position i down (i = +/-1 includes the median).
+  void minSortDown(int i) {
+    for (; i <= minCount(); i *= 2) {
+      if (i > 1 && i < minCount() && less(i + 1, i)) ++i;
+      if (!compareExchange(i, i / 2)) break;
+    }
+  }
+  void maxSortDown(int i) {
+    for (; i >= -maxCount(); i *= 2) {
+      if (i < -1 && i > -maxCount() && less(i, i - 1)) --i;
+      if (!compareExchange(i / 2, i)) break;
+    }
+  }
+  // True if the sample moved up to the median.
+  bool minSortUp(int i) {
+    while (i > 0 && compareExchange(i, i / 2)) i /= 2;
+    return i == 0;
+  }
+  bool maxSortUp(int i) {
+    while (i < 0 && compareExchange(i / 2, i)) i /= 2;
+    return i == 0;
+  }
+
+  T _data[N];   // Circular buffer of samples
+  int _pos[N];  // Heap position of each sample
+  int _heap[N]; // Sample index at each heap position
+  size_t _next;
+  int _count;
+};
+
+#endif // SLIDING_MEDIAN_H
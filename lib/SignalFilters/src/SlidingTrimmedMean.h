@@ -0,0 +1,80 @@
+#ifndef SLIDING_TRIMMED_MEAN_H
+#define SLIDING_TRIMMED_MEAN_H
+
+#include <stddef.h>
+
+// --- Sliding Trimmed Mean ---
+// Mean of the last N samples without the TRIM lowest and TRIM highest. The window is kept
+// sorted incrementally: the outgoing sample is replaced by the incoming one and moved into
+// place, one shift pass over at most N entries instead of a full sort. Before the window is
+// full the same trim applies to the samples seen so far (plain mean while count <= 2*TRIM).
+template <typename T, size_t N, size_t TRIM, typename Sum = double>
+class SlidingTrimmedMean {
+  static_assert(N > 2 * TRIM, "SlidingTrimmedMean: nothing left after trimming");
+
+public:
+  SlidingTrimmedMean() { reset(); }
+
+  void reset() {
+    _next = 0;
+    _count = 0;
+  }
+
+  // Adds a sample and returns the new trimmed mean.
+  Sum update(T sample) {
+    size_t slot;
+    if (_count == N) {
+      slot = find(_ring[_next]); // Reuse the outgoing sample's slot
+    } else {
+      slot = _count++;
+      _sorted[slot] = sample;
+    }
+    _ring[_next] = sample;
+    _next = (_next + 1) % N;
+
+    // Move the new sample from `slot` to its sorted position.
+    while (slot > 0 && sample < _sorted[slot - 1]) {
+      _sorted[slot] = _sorted[slot - 1];
+      slot--;
+    }
+    while (slot + 1 < _count && _sorted[slot + 1] < sample) {
+      _sorted[slot] = _sorted[slot + 1];
+      slot++;
+    }
+    _sorted[slot] = sample;
+    return mean();
+  }
+
+  Sum mean() const {
+    if (_count == 0) return 0;
+    size_t trim = _count > 2 * TRIM ? TRIM : 0;
+    Sum sum = 0;
+    for (size_t i = trim; i < _count - trim; i++) sum += _sorted[i];
+    return sum / (Sum)(_count - 2 * trim);
+  }
+
+  // Sorted window, lowest first (count() entries).
+  const T* sorted() const { return _sorted; }
+  bool full() const { return _count == N; }
+  size_t count() const { return _count; }
+
+private:
+  // Binary search for a sample known to be in the window.
+  size_t find(T value) const {
+    size_t low = 0;
+    size_t high = _count - 1;
+    while (low < high) {
+      size_t mid = (low + high) / 2;
+      if (_sorted[mid] < value) low = mid + 1;
+      else high = mid;
+    }
+    return low;
+  }
+
+  T _ring[N];   // Samples in arrival order
+  T _sorted[N]; // Same samples, ascending
+  size_t _next;
+  size_t _count;
+};
+
+#endif // SLIDING_TRIMMED_MEAN_H
@@ -0,0 +1,109 @@
+#ifndef SORTING_NETWORK_H
+#define SORTING_NETWORK_H
+
+#include <stddef.h>
+
+// --- Sorting Networks ---
+// Fixed compare-exchange sequences for small, compile-time sized arrays: no calls, no
+// callbacks and a data-independent instruction count (Bose-Nelson networks, 2..8 elements).
+// Larger sizes fall back to an insertion sort.
+//   int readings[7]; ... sortSmall(readings); int mean = trimmedMean<1>(readings);
+
+template <typename T>
+inline void compareExchange(T* v, size_t i, size_t j) {
+  T a = v[i];
+  T b = v[j];
+  v[i] = b < a ? b : a;
+  v[j] = b < a ? a : b;
+}
+
+template <size_t N>
+struct SortingNetwork {
+  template <typename T>
+  static void sort(T* v) {
+    for (size_t i = 1; i < N; i++) {
+      T value = v[i];
+      size_t j = i;
+      for (; j > 0 && value < v[j - 1]; j--) v[j] = v[j - 1];
+      v[j] = value;
+    }
+  }
+};
+
+template <> struct SortingNetwork<0> { template <typename T> static void sort(T*) {} };
+template <> struct SortingNetwork<1> { template <typename T> static void sort(T*) {} };
+
+template <> struct SortingNetwork<2> {
+  template <typename T> static void sort(T* v) { compareExchange(v, 0, 1); }
+};
+
+template <> struct SortingNetwork<3> {
+  template <typename T> static void sort(T* v) {
+    compareExchange(v, 1, 2); compareExchange(v, 0, 2); compareExchange(v, 0, 1);
+  }
+};
+
+template <> struct SortingNetwork<4> {
+  template <typename T> static void sort(T* v) {
+    compareExchange(v, 0, 1); compareExchange(v, 2, 3); compareExchange(v, 0, 2);
+    compareExchange(v, 1, 3); compareExchange(v, 1, 2);
+  }
+};
+
+template <> struct SortingNetwork<5> {
+  template <typename T> static void sort(T* v) {
+    compareExchange(v, 0, 1); compareExchange(v, 3, 4); compareExchange(v, 2, 4);
+    compareExchange(v, 2, 3); compareExchange(v, 1, 4); compareExchange(v, 0, 3);
+    compareExchange(v, 0, 2); compareExchange(v, 1, 3); compareExchange(v, 1, 2);
+  }
+};
+
+template <> struct SortingNetwork<6> {
+  template <typename T> static void sort(T* v) {
+    compareExchange(v, 1, 2); compareExchange(v, 0, 2); compareExchange(v, 0, 1);
+    compareExchange(v, 4, 5); compareExchange(v, 3, 5); compareExchange(v, 3, 4);
+    compareExchange(v, 0, 3); compareExchange(v, 1, 4); compareExchange(v, 2, 5);
+    compareExchange(v, 2, 4); compareExchange(v, 1, 3); compareExchange(v, 2, 3);
+  }
+};
+
+template <> struct SortingNetwork<7> {
+  template <typename T> static void sort(T* v) {
+    compareExchange(v, 1, 2); compareExchange(v, 0, 2); compareExchange(v, 0, 1);
+    compareExchange(v, 3, 4); compareExchange(v, 5, 6); compareExchange(v, 3, 5);
+    compareExchange(v, 4, 6); compareExchange(v, 4, 5); compareExchange(v, 0, 4);
+    compareExchange(v, 0, 3); compareExchange(v, 1, 5); compareExchange(v, 2, 6);
+    compareExchange(v, 2, 5); compareExchange(v, 1, 3); compareExchange(v, 2, 4);
+    compareExchange(v, 2, 3);
+  }
+};
+
+template <> struct SortingNetwork<8> {
+  template <typename T> static void sort(T* v) {
+    compareExchange(v, 0, 1); compareExchange(v, 2, 3); compareExchange(v, 0, 2);
+    compareExchange(v, 1, 3); compareExchange(v, 1, 2); compareExchange(v, 4, 5);
+    compareExchange(v, 6, 7); compareExchange(v, 4, 6); compareExchange(v, 5, 7);
+    compareExchange(v, 5, 6); compareExchange(v, 0, 4); compareExchange(v, 1, 5);
+    compareExchange(v, 1, 4); compareExchange(v, 2, 6); compareExchange(v, 3, 7);
+    compareExchange(v, 3, 6); compareExchange(v, 2, 4); compareExchange(v, 3, 5);
+    compareExchange(v, 3, 4);
+  }
+};
+
+template <typename T, size_t N>
+inline void sortSmall(T (&values)[N]) {
+  SortingNetwork<N>::sort(values);
+}
+
+// Mean of `values` without the TRIM lowest and TRIM highest (sorts in place). Integer types
+// divide like integers, so the result matches a qsort-and-average over the same readings.
+template <size_t TRIM, typename T, size_t N>
+inline T trimmedMean(T (&values)[N]) {
+  static_assert(N > 2 * TRIM, "trimmedMean: nothing left after trimming");
+  sortSmall(values);
+  T sum = 0;
+  for (size_t i = TRIM; i < N - TRIM; i++) sum += values[i];
+  return sum / (T)(N - 2 * TRIM);
+}
+
+#endif // SORTING_NETWORK_H
@@ -0,0 +1,160 @@
+#include "StageMetrics.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+const uint32_t StageMetrics::BUCKET_BOUNDS_US[StageStats::BUCKETS - 1] = {4, 16, 64, 256, 1024, 4096, 16384, 65536, 262144};
+
+StageMetrics::StageMetrics(uint32_t (*cycleClock)()) : _cycleClock(cycleClock), _cyclesPerUs(1), _count(0) {
+  _resetGeneration.store(0, std::memory_order_relaxed);
+  begin(1);
+}
+
+void StageMetrics::begin(uint32_t cyclesPerUs) {
+  _cyclesPerUs.store(cyclesPerUs > 0 ? cyclesPerUs : 1, std::memory_order_relaxed);
+}
+
+void StageMetrics::changeClock(uint32_t cyclesPerUs) {
+  begin(cyclesPerUs);
+  requestReset();
+}
+
+uint8_t StageMetrics::add(const char* name, bool loop) {
+  if (_count == MAX_STAGES) return INVALID_STAGE;
+  Stage& stage = _stages[_count];
+  stage.name = name;
+  stage.loop = loop;
+  stage.sequence.store(0, std::memory_order_relaxed);
+  stage.resetSeen = _resetGeneration.load(std::memory_order_relaxed);
+  stage.started = false;
+  stage.lastStartCycles = 0;
+  memset(&stage.stats, 0, sizeof(stage.stats));
+  return (uint8_t)_count++;
+}
+
+void StageMetrics::record(uint8_t index, uint32_t startCycles) {
+  uint32_t elapsed = _cycleClock() - startCycles; // Wrap-safe
+  if (index >= _count) return;
+  Stage& stage = _stages[index];
+  uint32_t generation = _resetGeneration.load(std::memory_order_relaxed);
+
+  uint32_t seq = stage.sequence.load(std::memory_order_relaxed);
+  stage.sequence.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  StageStats& stats = stage.stats;
+  if (stage.resetSeen != generation) {
+    memset(&stats, 0, sizeof(stats));
+    stage.resetSeen = generation;
+    stage.started = false;
+  }
+  stats.count++;
+  stats.totalCycles += elapsed;
+  if (elapsed > stats.maxCycles) stats.maxCycles = elapsed;
+  uint64_t cyclesPerUs = _cyclesPerUs.load(std::memory_order_relaxed); // changeClock() may run on another task
+  size_t bucket = 0;
+  while (bucket < StageStats::BUCKETS - 1 && elapsed > BUCKET_BOUNDS_US[bucket] * cyclesPerUs) bucket++;
+  stats.buckets[bucket]++;
+  if (stage.loop) {
+    if (stage.started && startCycles - stage.lastStartCycles > stats.maxIntervalCycles) {
+      stats.maxIntervalCycles = startCycles - stage.lastStartCycles;
+    }
+    stage.started = true;
+    stage.lastStartCycles = startCycles;
+  }
+
+  stage.sequence.store(seq + 2, std::memory_order_release);
+}
+
+bool StageMetrics::read(uint8_t index, StageStats& out) const {
+  if (index >= _count) return false;
+  const Stage& stage = _stages[index];
+  for (;;) {
+    uint32_t before = stage.sequence.load(std::memory_order_acquire);
+    if (before & 1u) continue; // Owner mid-update (a few hundred cycles)
+    out = stage.stats;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (stage.sequence.load(std::memory_order_relaxed) == before) break;
+  }
+  // Not recorded since a reset request: reads as cleared already
+  if (stage.resetSeen != _resetGeneration.load(std::memory_order_relaxed)) memset(&out, 0, sizeof(out));
+  return true;
+}
+
+uint32_t StageMetrics::quantileBoundUs(const StageStats& stats, double q) const {
+  if (stats.count == 0) return 0;
+  double target = q * stats.count;
+  uint32_t cumulative = 0;
+  for (size_t i = 0; i < StageStats::BUCKETS - 1; i++) {
+    cumulative += stats.buckets[i];
+    if (cumulative >= target) return BUCKET_BOUNDS_US[i];
+  }
+  return UINT32_MAX;
+}
+
+namespace {
+
+void writeLine(MetricsSink& sink, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+void writeLine(MetricsSink& sink, const char* format, ...) {
+  char line[160];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+  if (length < 0) return;
+  sink.write(line, (size_t)length < sizeof(line) ? (size_t)length : sizeof(line) - 1);
+}
+
+void writeHeader(MetricsSink& sink, const char* prefix, const char* name, const char* type, const char* help) {
+  writeLine(sink, "# HELP %s%s %s\n", prefix, name, help);
+  writeLine(sink, "# TYPE %s%s %s\n", prefix, name, type);
+}
+
+} // namespace
+
+void StageMetrics::writePrometheus(MetricsSink& sink, const char* prefix) const {
+  // Each stage is read once, so its buckets, sum and count agree
+  writeHeader(sink, prefix, "stage_duration_seconds", "histogram", "Run time of each instrumented stage.");
+  for (size_t i = 0; i < _count; i++) {
+    StageStats stats;
+    read((uint8_t)i, stats);
+    uint32_t cumulative = 0;
+    for (size_t b = 0; b < StageStats::BUCKETS - 1; b++) {
+      cumulative += stats.buckets[b];
+      writeLine(sink, "%sstage_duration_seconds_bucket{stage=\"%s\",le=\"%g\"} %lu\n", prefix, _stages[i].name,
+                BUCKET_BOUNDS_US[b] / 1e6, (unsigned long)cumulative);
+    }
+    writeLine(sink, "%sstage_duration_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %lu\n", prefix, _stages[i].name,
+              (unsigned long)stats.count);
+    writeLine(sink, "%sstage_duration_seconds_sum{stage=\"%s\"} %.6f\n", prefix, _stages[i].name,
+              toMicros(stats.totalCycles) / 1e6);
+    writeLine(sink, "%sstage_duration_seconds_count{stage=\"%s\"} %lu\n", prefix, _stages[i].name,
+              (unsigned long)stats.count);
+  }
+
+  writeHeader(sink, prefix, "stage_duration_max_seconds", "gauge", "Longest run of each stage since the last reset.");
+  for (size_t i = 0; i < _count; i++) {
+    StageStats stats;
+    read((uint8_t)i, stats);
+    writeLine(sink, "%sstage_duration_max_seconds{stage=\"%s\"} %.6f\n", prefix, _stages[i].name,
+              toMicros(stats.maxCycles) / 1e6);
+  }
+
+  writeHeader(sink, prefix, "loop_interval_max_seconds", "gauge",
+              "Longest time between two passes of a task loop since the last reset.");
+  for (size_t i = 0; i < _count; i++) {
+    if (!_stages[i].loop) continue;
+    StageStats stats;
+    read((uint8_t)i, stats);
+    writeLine(sink, "%sloop_interval_max_seconds{stage=\"%s\"} %.6f\n", prefix, _stages[i].name,
+              toMicros(stats.maxIntervalCycles) / 1e6);
+  }
+}
+
+void writePrometheusMetric(MetricsSink& sink, const char* prefix, const char* name, const char* type,
+                           const char* help, double value) {
+  writeHeader(sink, prefix, name, type, help);
+  writeLine(sink, "%s%s %.17g\n", prefix, name, value);
+}
@@ -0,0 +1,117 @@
+#ifndef STAGE_METRICS_H
+#define STAGE_METRICS_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Destination of the metrics text (Prometheus exposition or the serial summary), one line
+// at a time.
+class MetricsSink {
+public:
+  virtual ~MetricsSink() {}
+  virtual void write(const char* data, size_t length) = 0;
+};
+
+// Per-stage counters in cycles of the clock given to StageMetrics. Histogram buckets are
+// not cumulative; the last one holds everything above the largest bound.
+struct StageStats {
+  static const size_t BUCKETS = 10;
+  uint32_t count;
+  uint64_t totalCycles;
+  uint32_t maxCycles;
+  uint32_t maxIntervalCycles; // Loop stages: longest time from one start to the next
+  uint32_t buckets[BUCKETS];
+};
+
+// --- Stage Metrics ---
+// Cycle counts and a duration histogram per instrumented stage of the firmware's tasks,
+// from a fixed table (no allocation). Stages are added in setup() before the tasks start;
+// each one is then recorded by a single task (its owner) and can be read from any task:
+// a per-stage sequence counter lets a reader retry instead of seeing a half-updated stage.
+// Loop stages (one per task pass) also keep the longest interval between two starts, the
+// task's worst-case latency. Durations include anything that preempted the stage on its
+// core. Intervals longer than the cycle counter's wrap (~17 s at 240 MHz) are not meaningful.
+//
+//   StageTimer timer(stageMetrics, STAGE_HTTP);  // Recorded when timer goes out of scope
+//   server.handleClient();
+class StageMetrics {
+public:
+  static const size_t MAX_STAGES = 16;
+  static const uint8_t INVALID_STAGE = 0xFF;
+  // Upper bounds of the histogram buckets (us); the last bucket is +Inf
+  static const uint32_t BUCKET_BOUNDS_US[StageStats::BUCKETS - 1];
+
+  // cycleClock: CPU cycle counter on the device, a stub on the host.
+  explicit StageMetrics(uint32_t (*cycleClock)());
+
+  // Cycles per microsecond of cycleClock (the CPU clock in MHz). Before any record().
+  void begin(uint32_t cyclesPerUs);
+  // Any task, after the CPU clock (and so cycleClock's rate) changed. Statistics in cycles
+  // of two clocks can't be combined, so every stage restarts as after requestReset(); a run
+  // in flight during the change is counted at the new rate.
+  void changeClock(uint32_t cyclesPerUs);
+  // Returns INVALID_STAGE when the table is full.
+  uint8_t add(const char* name, bool loop = false);
+
+  uint32_t start() const { return _cycleClock(); }
+  // Owning task only.
+  void record(uint8_t stage, uint32_t startCycles);
+
+  // Any task. False for an unknown stage.
+  bool read(uint8_t stage, StageStats& out) const;
+  // Any task: each stage clears itself at its next record().
+  void requestReset() { _resetGeneration.fetch_add(1, std::memory_order_relaxed); }
+
+  size_t stageCount() const { return _count; }
+  const char* name(uint8_t stage) const { return _stages[stage].name; }
+  bool isLoop(uint8_t stage) const { return _stages[stage].loop; }
+  uint32_t cyclesPerUs() const { return _cyclesPerUs.load(std::memory_order_relaxed); }
+
+  double toMicros(uint64_t cycles) const { return (double)cycles / cyclesPerUs(); }
+  // Upper bound (us) of the bucket holding the q-quantile, UINT32_MAX in the +Inf bucket,
+  // 0 without samples.
+  uint32_t quantileBoundUs(const StageStats& stats, double q) const;
+
+  // Prometheus text format: <prefix>stage_duration_seconds (histogram), <prefix>
+  // stage_duration_max_seconds and <prefix>loop_interval_max_seconds, labelled by stage.
+  void writePrometheus(MetricsSink& sink, const char* prefix) const;
+
+private:
+  struct Stage {
+    const char* name;
+    bool loop;
+    std::atomic<uint32_t> sequence; // Odd while the owner updates
+    uint32_t resetSeen;
+    bool started; // lastStartCycles valid (loop stages)
+    uint32_t lastStartCycles;
+    StageStats stats;
+  };
+
+  uint32_t (*_cycleClock)();
+  std::atomic<uint32_t> _cyclesPerUs;
+  Stage _stages[MAX_STAGES];
+  size_t _count;
+  std::atomic<uint32_t> _resetGeneration;
+};
+
+// Records the enclosing scope as one run of a stage.
+class StageTimer {
+public:
+  StageTimer(StageMetrics& metrics, uint8_t stage) : _metrics(metrics), _stage(stage), _start(metrics.start()) {}
+  ~StageTimer() { _metrics.record(_stage, _start); }
+
+private:
+  StageTimer(const StageTimer&);
+  StageTimer& operator=(const StageTimer&);
+
+  StageMetrics& _metrics;
+  uint8_t _stage;
+  uint32_t _start;
+};
+
+// One untyped-label sample with its HELP and TYPE lines, e.g. the free heap as a gauge.
+void writePrometheusMetric(MetricsSink& sink, const char* prefix, const char* name, const char* type,
+                           const char* help, double value);
+
+#endif // STAGE_METRICS_H
@@ -0,0 +1,134 @@
+#include "TelemetryFrame.h"
+
+#include <math.h>
+
+namespace {
+const float SCALES[TelemetryFrame::MAX_DECIMALS + 1] = {1.0f, 10.0f, 100.0f, 1000.0f, 10000.0f};
+
+float scaleFor(uint8_t decimals) {
+  return SCALES[decimals > TelemetryFrame::MAX_DECIMALS ? TelemetryFrame::MAX_DECIMALS : decimals];
+}
+}
+
+// --- Encoder ---
+TelemetryFrameEncoder::TelemetryFrameEncoder(uint8_t* buffer, size_t capacity, uint32_t baseTimeMs, uint8_t seriesCount)
+    : _buffer(buffer), _capacity(capacity), _length(0), _overflow(false), _baseTimeMs(baseTimeMs), _scale(1.0f),
+      _firstTime(true), _firstValue(true), _previousTime(0), _previousValue(0) {
+  putByte(TelemetryFrame::MAGIC_0);
+  putByte(TelemetryFrame::MAGIC_1);
+  putByte(TelemetryFrame::VERSION);
+  putByte(0); // Flags, none defined yet
+  for (int shift = 0; shift < 32; shift += 8) {
+    putByte((uint8_t)(baseTimeMs >> shift));
+  }
+  putByte(seriesCount);
+}
+
+void TelemetryFrameEncoder::beginSeries(uint8_t id, uint8_t decimals, uint32_t count) {
+  if (decimals > TelemetryFrame::MAX_DECIMALS) decimals = TelemetryFrame::MAX_DECIMALS;
+  putByte(id);
+  putByte(decimals);
+  putVarint(count);
+  _scale = scaleFor(decimals);
+  _firstTime = true;
+  _firstValue = true;
+}
+
+void TelemetryFrameEncoder::time(uint32_t timeMs) {
+  // Unsigned differences wrap like millis() does; as int32 they are the signed distance.
+  putSigned((int32_t)(timeMs - (_firstTime ? _baseTimeMs : _previousTime)));
+  _previousTime = timeMs;
+  _firstTime = false;
+}
+
+void TelemetryFrameEncoder::value(float value) {
+  int32_t quantized = isnan(value) ? 0 : (int32_t)lroundf(value * _scale);
+  putSigned(_firstValue ? quantized : (int32_t)((uint32_t)quantized - (uint32_t)_previousValue));
+  _previousValue = quantized;
+  _firstValue = false;
+}
+
+void TelemetryFrameEncoder::putByte(uint8_t byte) {
+  if (_length >= _capacity) {
+    _overflow = true;
+    return;
+  }
+  _buffer[_length++] = byte;
+}
+
+void TelemetryFrameEncoder::putVarint(uint32_t value) {
+  while (value >= 0x80) {
+    putByte((uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  putByte((uint8_t)value);
+}
+
+// --- Decoder ---
+TelemetryFrameDecoder::TelemetryFrameDecoder(const uint8_t* data, size_t length)
+    : _data(data), _length(length), _position(0), _valid(false), _baseTimeMs(0), _seriesCount(0), _scale(1.0f),
+      _firstTime(true), _firstValue(true), _previousTime(0), _previousValue(0) {
+  if (length < TelemetryFrame::HEADER_SIZE || data[0] != TelemetryFrame::MAGIC_0 || data[1] != TelemetryFrame::MAGIC_1 ||
+      data[2] != TelemetryFrame::VERSION) {
+    return;
+  }
+  for (int i = 0; i < 4; i++) {
+    _baseTimeMs |= (uint32_t)data[4 + i] << (8 * i);
+  }
+  _seriesCount = data[8];
+  _position = TelemetryFrame::HEADER_SIZE;
+  _valid = true;
+}
+
+bool TelemetryFrameDecoder::nextSeries(Series& series) {
+  if (!_valid || !getByte(series.id) || !getByte(series.decimals) || !getVarint(series.count)) {
+    return false;
+  }
+  _scale = scaleFor(series.decimals);
+  _firstTime = true;
+  _firstValue = true;
+  return true;
+}
+
+bool TelemetryFrameDecoder::time(uint32_t& timeMs) {
+  int32_t delta;
+  if (!getSigned(delta)) return false;
+  timeMs = (_firstTime ? _baseTimeMs : _previousTime) + (uint32_t)delta;
+  _previousTime = timeMs;
+  _firstTime = false;
+  return true;
+}
+
+bool TelemetryFrameDecoder::value(float& value) {
+  int32_t delta;
+  if (!getSigned(delta)) return false;
+  int32_t quantized = _firstValue ? delta : (int32_t)((uint32_t)_previousValue + (uint32_t)delta);
+  value = quantized / _scale;
+  _previousValue = quantized;
+  _firstValue = false;
+  return true;
+}
+
+bool TelemetryFrameDecoder::getByte(uint8_t& byte) {
+  if (_position >= _length) return false;
+  byte = _data[_position++];
+  return true;
+}
+
+bool TelemetryFrameDecoder::getVarint(uint32_t& value) {
+  value = 0;
+  for (size_t i = 0; i < TelemetryFrame::MAX_VARINT_SIZE; i++) {
+    uint8_t byte;
+    if (!getByte(byte)) return false;
+    value |= (uint32_t)(byte & 0x7F) << (7 * i);
+    if (!(byte & 0x80)) return true;
+  }
+  return false; // Longer than a 32-bit varint
+}
+
+bool TelemetryFrameDecoder::getSigned(int32_t& value) {
+  uint32_t raw;
+  if (!getVarint(raw)) return false;
+  value = (int32_t)((raw >> 1) ^ (0u - (raw & 1)));
+  return true;
+}
@@ -0,0 +1,126 @@
+#ifndef TELEMETRY_FRAME_H
+#define TELEMETRY_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// --- Binary Telemetry Frame (version 1) ---
+// Compact encoding of time series (the /history rings) for the web page and tools.
+// Little-endian, no padding:
+//
+//   header   'D' 'T'  version:u8  flags:u8 (0)  baseTimeMs:u32  seriesCount:u8
+//   series   id:u8  decimals:u8  count:varint
+//            times:  count x zigzag varint, first relative to baseTimeMs, then the delta
+//                    to the previous time (ms)
+//            values: count x zigzag varint, first the value in units of 10^-decimals,
+//                    then the delta to the previous quantized value
+//
+// varint: 7 bits per byte, least significant group first, high bit set on all but the last
+// byte (as in protobuf). zigzag: 0, -1, 1, -2 ... -> 0, 1, 2, 3 ... so small negative deltas
+// stay short. A history sample at 1 s spacing with a slowly changing value costs 3 bytes
+// (2 time, 1 value) instead of ~28 as JSON text. Readers must reject other versions.
+namespace TelemetryFrame {
+const uint8_t MAGIC_0 = 'D';
+const uint8_t MAGIC_1 = 'T';
+const uint8_t VERSION = 1;
+const size_t HEADER_SIZE = 9;
+const size_t MAX_VARINT_SIZE = 5; // 32-bit values
+const int MAX_DECIMALS = 4;
+
+// Series ids
+const uint8_t SERIES_TEMPERATURE = 1; // Degrees C
+const uint8_t SERIES_PRESSURE = 2;    // Bar
+// Bucket extremes of the tiered history (/history.bin?span=), same times as the means above
+const uint8_t SERIES_TEMPERATURE_MIN = 3;
+const uint8_t SERIES_TEMPERATURE_MAX = 4;
+const uint8_t SERIES_PRESSURE_MIN = 5;
+const uint8_t SERIES_PRESSURE_MAX = 6;
+// Shot traces (/shot.bin): estimated flow through the puck (ml/s) and volume since the start (ml)
+const uint8_t SERIES_FLOW = 7;
+const uint8_t SERIES_VOLUME = 8;
+
+// Upper bound of the encoded size, for sizing buffers.
+constexpr size_t maxEncodedSize(size_t seriesCount, size_t totalPoints) {
+  return HEADER_SIZE + seriesCount * (2 + MAX_VARINT_SIZE) + totalPoints * 2 * MAX_VARINT_SIZE;
+}
+} // namespace TelemetryFrame
+
+// Writes one frame into a caller-provided buffer (no allocation). Per series: beginSeries()
+// with the point count, then exactly `count` time() calls, then `count` value() calls, in
+// time order. Running out of buffer sets overflow(); the frame is unusable then.
+//
+//   TelemetryFrameEncoder frame(buffer, sizeof(buffer), millis(), 2);
+//   frame.beginSeries(TelemetryFrame::SERIES_TEMPERATURE, 1, count);
+//   for (...) frame.time(history[i].time_ms);
+//   for (...) frame.value(history[i].value);
+//   ...
+//   if (!frame.overflow()) send(buffer, frame.length());
+class TelemetryFrameEncoder {
+public:
+  TelemetryFrameEncoder(uint8_t* buffer, size_t capacity, uint32_t baseTimeMs, uint8_t seriesCount);
+
+  void beginSeries(uint8_t id, uint8_t decimals, uint32_t count);
+  void time(uint32_t timeMs);
+  void value(float value); // Rounded to the series' decimals; NaN is encoded as 0
+
+  size_t length() const { return _length; }
+  bool overflow() const { return _overflow; }
+
+private:
+  void putByte(uint8_t byte);
+  void putVarint(uint32_t value);
+  void putSigned(int32_t value) { putVarint(((uint32_t)value << 1) ^ (uint32_t)(value >> 31)); }
+
+  uint8_t* _buffer;
+  size_t _capacity;
+  size_t _length;
+  bool _overflow;
+  uint32_t _baseTimeMs;
+  float _scale;
+  bool _firstTime;
+  bool _firstValue;
+  uint32_t _previousTime;
+  int32_t _previousValue;
+};
+
+// Reads a frame produced by TelemetryFrameEncoder. Mirrors the encoder call order:
+// nextSeries(), then count time() reads, then count value() reads. Every call returns false
+// on malformed or truncated input.
+class TelemetryFrameDecoder {
+public:
+  struct Series {
+    uint8_t id;
+    uint8_t decimals;
+    uint32_t count;
+  };
+
+  TelemetryFrameDecoder(const uint8_t* data, size_t length);
+
+  bool valid() const { return _valid; } // Header parsed, version supported
+  uint32_t baseTimeMs() const { return _baseTimeMs; }
+  uint8_t seriesCount() const { return _seriesCount; }
+
+  bool nextSeries(Series& series);
+  bool time(uint32_t& timeMs);
+  bool value(float& value);
+  bool atEnd() const { return _position == _length; }
+
+private:
+  bool getByte(uint8_t& byte);
+  bool getVarint(uint32_t& value);
+  bool getSigned(int32_t& value);
+
+  const uint8_t* _data;
+  size_t _length;
+  size_t _position;
+  bool _valid;
+  uint32_t _baseTimeMs;
+  uint8_t _seriesCount;
+  float _scale;
+  bool _firstTime;
+  bool _firstValue;
+  uint32_t _previousTime;
+  int32_t _previousValue;
+};
+
+#endif // TELEMETRY_FRAME_H
@@ -0,0 +1,125 @@
+#include "TieredHistory.h"
+
+#include <math.h>
+
+namespace {
+
+// Spread in steps, rounded up so the stored band contains the real one. The small
+// tolerance keeps exact multiples (after float rounding) from gaining a step.
+uint8_t spreadSteps(float distance, float step) {
+  float steps = distance / step;
+  if (!(steps > 0.0f)) return 0;
+  if (steps >= 255.0f) return 255;
+  return (uint8_t)ceilf(steps - 1e-3f);
+}
+
+} // namespace
+
+HistoryTier::HistoryTier()
+    : _bucketMs(1000), _buckets(nullptr), _capacity(0), _head(0), _count(0), _scale(1.0f), _spreadStep(1.0f),
+      _openStartMs(0), _openSamples(0), _openSum(0.0f), _openMin(0.0f), _openMax(0.0f) {}
+
+void HistoryTier::begin(uint32_t bucketMs, HistoryBucket* buckets, size_t capacity, float scale, float spreadStep) {
+  _bucketMs = bucketMs;
+  _buckets = buckets;
+  _capacity = capacity;
+  _scale = scale;
+  _spreadStep = spreadStep;
+  clear();
+}
+
+void HistoryTier::clear() {
+  _head = 0;
+  _count = 0;
+  _openSamples = 0;
+}
+
+void HistoryTier::add(uint32_t timeMs, float value) {
+  uint32_t bucketStartMs = timeMs - timeMs % _bucketMs;
+  if (_openSamples > 0) {
+    int32_t elapsedMs = (int32_t)(bucketStartMs - _openStartMs); // Wrap-safe
+    if (elapsedMs < (int32_t)_bucketMs) {
+      // Same bucket (or a sample from the past, which is folded into the open one)
+      _openSum += value;
+      if (value < _openMin) _openMin = value;
+      if (value > _openMax) _openMax = value;
+      _openSamples++;
+      return;
+    }
+    closeOpenBucket();
+    // Buckets nobody sampled in between stay in the ring as empty
+    uint32_t missing = (uint32_t)elapsedMs / _bucketMs - 1;
+    if (missing > _capacity) missing = (uint32_t)_capacity;
+    HistoryBucket empty = {HistoryBucket::EMPTY, 0, 0};
+    for (uint32_t i = 0; i < missing; i++) pushBucket(empty);
+  }
+  _openStartMs = bucketStartMs;
+  _openSamples = 1;
+  _openSum = value;
+  _openMin = value;
+  _openMax = value;
+}
+
+void HistoryTier::closeOpenBucket() {
+  float mean = _openSum / (float)_openSamples;
+  float quantized = roundf(mean * _scale);
+  if (quantized < -32767.0f) quantized = -32767.0f;
+  if (quantized > 32767.0f) quantized = 32767.0f;
+
+  HistoryBucket bucket;
+  bucket.mean = (int16_t)quantized;
+  float storedMean = quantized / _scale;
+  bucket.below = spreadSteps(storedMean - _openMin, _spreadStep);
+  bucket.above = spreadSteps(_openMax - storedMean, _spreadStep);
+  pushBucket(bucket);
+  _openSamples = 0;
+}
+
+void HistoryTier::pushBucket(const HistoryBucket& bucket) {
+  if (_capacity == 0) return;
+  _buckets[_head] = bucket;
+  _head = (_head + 1) % _capacity;
+  if (_count < _capacity) _count++;
+}
+
+bool HistoryTier::point(size_t index, HistoryPoint& point) const {
+  if (index >= size()) return false;
+  if (index == _count) {
+    point.timeMs = _openStartMs;
+    point.mean = _openSum / (float)_openSamples;
+    point.min = _openMin;
+    point.max = _openMax;
+    return true;
+  }
+
+  const HistoryBucket& bucket = _buckets[(_head + _capacity - _count + index) % _capacity];
+  if (bucket.mean == HistoryBucket::EMPTY) return false;
+  // Closed buckets are contiguous and end where the open one starts
+  point.timeMs = _openStartMs - (uint32_t)(_count - index) * _bucketMs;
+  point.mean = bucket.mean / _scale;
+  point.min = point.mean - bucket.below * _spreadStep;
+  point.max = point.mean + bucket.above * _spreadStep;
+  return true;
+}
+
+TieredHistory::TieredHistory(float scale, float spreadStep) {
+  _tiers[0].begin(1000, _buckets, SECOND_BUCKETS, scale, spreadStep);
+  _tiers[1].begin(10000, _buckets + SECOND_BUCKETS, TEN_SECOND_BUCKETS, scale, spreadStep);
+  _tiers[2].begin(60000, _buckets + SECOND_BUCKETS + TEN_SECOND_BUCKETS, MINUTE_BUCKETS, scale, spreadStep);
+}
+
+void TieredHistory::add(uint32_t timeMs, float value) {
+  if (isnan(value)) return;
+  for (size_t i = 0; i < TIER_COUNT; i++) _tiers[i].add(timeMs, value);
+}
+
+void TieredHistory::clear() {
+  for (size_t i = 0; i < TIER_COUNT; i++) _tiers[i].clear();
+}
+
+const HistoryTier& TieredHistory::tierFor(uint32_t spanMs) const {
+  for (size_t i = 0; i < TIER_COUNT; i++) {
+    if (_tiers[i].spanMs() >= spanMs) return _tiers[i];
+  }
+  return _tiers[TIER_COUNT - 1];
+}
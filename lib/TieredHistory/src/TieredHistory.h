@@ -0,0 +1,92 @@
+#ifndef TIERED_HISTORY_H
+#define TIERED_HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// --- Tiered History ---
+// Multi-resolution history of one signal for the web charts: every sample updates three
+// fixed-size rings of min/max/mean buckets (1 s, 10 s and 1 min wide), so a long time
+// range is served at a coarse resolution without keeping the raw samples.
+//
+// A closed bucket takes 4 bytes: the mean as int16 in units of 1/scale, and the distances
+// from the mean down to the minimum and up to the maximum in units of spreadStep, rounded
+// outwards (the stored band always contains the real one; spreads saturate at 255 steps).
+// Bucket boundaries are multiples of the bucket width in device time, buckets without
+// samples (gaps, paused plots) are kept as empty so the rings stay contiguous in time.
+// The newest bucket is still open and read from its exact running values.
+
+struct HistoryBucket {
+  static const int16_t EMPTY = -32768;
+
+  int16_t mean;  // Units of 1/scale, EMPTY if no sample fell into the bucket
+  uint8_t below; // mean - min, units of spreadStep
+  uint8_t above; // max - mean, units of spreadStep
+};
+
+struct HistoryPoint {
+  uint32_t timeMs; // Bucket start (device millis)
+  float mean;
+  float min;
+  float max;
+};
+
+// One resolution: a ring of closed buckets on caller-provided storage plus the open bucket.
+class HistoryTier {
+public:
+  HistoryTier();
+
+  void begin(uint32_t bucketMs, HistoryBucket* buckets, size_t capacity, float scale, float spreadStep);
+  void add(uint32_t timeMs, float value);
+  void clear();
+
+  uint32_t bucketMs() const { return _bucketMs; }
+  uint32_t spanMs() const { return _bucketMs * (uint32_t)_capacity; }
+  // Closed buckets plus the open one, oldest first.
+  size_t size() const { return _count + (_openSamples > 0 ? 1 : 0); }
+  // False for empty buckets.
+  bool point(size_t index, HistoryPoint& point) const;
+
+private:
+  void closeOpenBucket();
+  void pushBucket(const HistoryBucket& bucket);
+
+  uint32_t _bucketMs;
+  HistoryBucket* _buckets;
+  size_t _capacity;
+  size_t _head; // Next write position
+  size_t _count;
+  float _scale;
+  float _spreadStep;
+  uint32_t _openStartMs;
+  uint32_t _openSamples;
+  float _openSum;
+  float _openMin;
+  float _openMax;
+};
+
+class TieredHistory {
+public:
+  static const size_t TIER_COUNT = 3;
+  static const size_t SECOND_BUCKETS = 60;     // 1 s x 60 = 1 minute
+  static const size_t TEN_SECOND_BUCKETS = 30; // 10 s x 30 = 5 minutes
+  static const size_t MINUTE_BUCKETS = 90;     // 1 min x 90 = 90 minutes
+  static const size_t TOTAL_BUCKETS = SECOND_BUCKETS + TEN_SECOND_BUCKETS + MINUTE_BUCKETS;
+
+  // scale: mean resolution (10 -> 0.1 units), spreadStep: min/max resolution in units.
+  TieredHistory(float scale, float spreadStep);
+
+  void add(uint32_t timeMs, float value); // NaN samples are ignored
+  void clear();
+
+  const HistoryTier& tier(size_t index) const { return _tiers[index]; }
+  // The finest tier that covers spanMs (the coarsest one if none does).
+  const HistoryTier& tierFor(uint32_t spanMs) const;
+  uint32_t maxSpanMs() const { return _tiers[TIER_COUNT - 1].spanMs(); }
+
+private:
+  HistoryTier _tiers[TIER_COUNT];
+  HistoryBucket _buckets[TOTAL_BUCKETS];
+};
+
+#endif // TIERED_HISTORY_H
@@ -0,0 +1,143 @@
+#include "JsonPath.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+const size_t MAX_KEY_LENGTH = 32;    // Longer keys never match (but are skipped correctly)
+const size_t MAX_NUMBER_LENGTH = 32;
+
+class JsonScanner {
+public:
+  JsonScanner(const char* json, size_t length) : _json(json), _length(length), _position(0) {}
+
+  // Object at the current position; path[level] is looked for among its keys.
+  bool findInObject(const char* const* path, int pathLength, int level, double& value) {
+    if (!consume('{')) return false;
+    skipWhitespace();
+    if (consume('}')) return false;
+    for (;;) {
+      char key[MAX_KEY_LENGTH + 1];
+      bool keyFits;
+      if (!readString(key, sizeof(key), keyFits)) return false;
+      skipWhitespace();
+      if (!consume(':')) return false;
+      skipWhitespace();
+      if (keyFits && strcmp(key, path[level]) == 0) {
+        if (level == pathLength - 1) return readNumber(value);
+        if (peek() == '{') return findInObject(path, pathLength, level + 1, value);
+        return false; // Path leads into a non-object
+      }
+      if (!skipValue(level + 1)) return false;
+      skipWhitespace();
+      if (consume(',')) {
+        skipWhitespace();
+        continue;
+      }
+      return false; // '}' (path not found) or malformed
+    }
+  }
+
+  void skipWhitespace() {
+    while (_position < _length && (_json[_position] == ' ' || _json[_position] == '\t' || _json[_position] == '\n' || _json[_position] == '\r')) {
+      _position++;
+    }
+  }
+  char peek() const { return _position < _length ? _json[_position] : '\0'; }
+
+private:
+  bool consume(char c) {
+    if (peek() != c) return false;
+    _position++;
+    return true;
+  }
+
+  // Copies a string's raw content (escapes are kept as-is, keys on the path are plain ASCII).
+  bool readString(char* out, size_t capacity, bool& fits) {
+    if (!consume('"')) return false;
+    size_t n = 0;
+    fits = true;
+    while (_position < _length) {
+      char c = _json[_position++];
+      if (c == '"') {
+        out[n < capacity ? n : capacity - 1] = '\0';
+        return true;
+      }
+      if (c == '\\') {
+        if (_position >= _length) return false;
+        fits = false; // Escaped keys are not matched
+        _position++;
+        continue;
+      }
+      if (n + 1 < capacity) out[n++] = c;
+      else fits = false;
+    }
+    return false;
+  }
+
+  bool readNumber(double& value) {
+    char text[MAX_NUMBER_LENGTH + 1];
+    size_t n = 0;
+    while (_position < _length && n < MAX_NUMBER_LENGTH && strchr("+-0123456789.eE", _json[_position])) {
+      text[n++] = _json[_position++];
+    }
+    text[n] = '\0';
+    if (n == 0) return false;
+    char* end;
+    value = strtod(text, &end);
+    return *end == '\0';
+  }
+
+  bool skipValue(int depth) {
+    if (depth > JSON_PATH_MAX_DEPTH) return false;
+    char c = peek();
+    if (c == '"') {
+      char ignored[1];
+      bool fits;
+      return readString(ignored, sizeof(ignored), fits);
+    }
+    if (c == '{' || c == '[') {
+      char close = c == '{' ? '}' : ']';
+      _position++;
+      skipWhitespace();
+      if (consume(close)) return true;
+      for (;;) {
+        if (c == '{') {
+          char ignored[1];
+          bool fits;
+          if (!readString(ignored, sizeof(ignored), fits)) return false;
+          skipWhitespace();
+          if (!consume(':')) return false;
+          skipWhitespace();
+        }
+        if (!skipValue(depth + 1)) return false;
+        skipWhitespace();
+        if (consume(close)) return true;
+        if (!consume(',')) return false;
+        skipWhitespace();
+      }
+    }
+    // Number or literal
+    size_t start = _position;
+    while (_position < _length && strchr("+-0123456789.eEtruefalsn", _json[_position])) {
+      _position++;
+    }
+    return _position > start;
+  }
+
+  const char* _json;
+  size_t _length;
+  size_t _position;
+};
+
+} // namespace
+
+bool findJsonNumber(const char* json, size_t length, const char* const* path, int pathLength, double& value) {
+  if (pathLength < 1 || pathLength > JSON_PATH_MAX_DEPTH) {
+    return false;
+  }
+  JsonScanner scanner(json, length);
+  scanner.skipWhitespace();
+  return scanner.peek() == '{' && scanner.findInObject(path, pathLength, 0, value);
+}
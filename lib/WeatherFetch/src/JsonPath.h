@@ -0,0 +1,16 @@
+#ifndef JSON_PATH_H
+#define JSON_PATH_H
+
+#include <stddef.h>
+
+// --- Filtered JSON Lookup ---
+// Finds the number at a key path (e.g. {"main", "temp"}) in a JSON text in one pass,
+// without building a document: everything off the path is skipped, nothing is allocated.
+// Keys are matched per nesting level, so {"weather":[{"main":"Clouds"}]} does not satisfy
+// "main". False if the path is missing, is not a number, or the text is malformed up to
+// that point. Nesting deeper than MAX_DEPTH is rejected.
+const int JSON_PATH_MAX_DEPTH = 16;
+
+bool findJsonNumber(const char* json, size_t length, const char* const* path, int pathLength, double& value);
+
+#endif // JSON_PATH_H
@@ -0,0 +1,54 @@
+#include "WeatherFetcher.h"
+
+#include <string.h>
+
+#include "JsonPath.h"
+
+WeatherFetcherConfig::WeatherFetcherConfig()
+    : refreshIntervalMs(15UL * 60UL * 1000UL), requestTimeoutMs(5000), initialBackoffMs(30000),
+      maxBackoffMs(15UL * 60UL * 1000UL), staleAfterMs(60UL * 60UL * 1000UL) {}
+
+WeatherFetcher::WeatherFetcher(HttpGetter& http, const WeatherFetcherConfig& config)
+    : _http(http), _config(config), _attempted(false), _nextAttemptMs(0), _backoffMs(config.initialBackoffMs),
+      _consecutiveFailures(0), _lastStatus(0) {
+  _url[0] = '\0';
+  _reading.valid = false;
+  _reading.temperatureC = 0.0f;
+  _reading.fetchedAtMs = 0;
+}
+
+void WeatherFetcher::setUrl(const char* url) {
+  strncpy(_url, url, sizeof(_url) - 1);
+  _url[sizeof(_url) - 1] = '\0';
+  _attempted = false;
+}
+
+bool WeatherFetcher::update(unsigned long nowMs) {
+  if (!due(nowMs) || _url[0] == '\0') {
+    return false;
+  }
+  _attempted = true;
+
+  size_t length = 0;
+  int status = _http.get(_url, _body, sizeof(_body), length, _config.requestTimeoutMs);
+  _lastStatus = status;
+  static const char* const TEMPERATURE_PATH[] = {"main", "temp"};
+  double temperatureC;
+  if (status == 200 && findJsonNumber(_body, length, TEMPERATURE_PATH, 2, temperatureC)) {
+    _reading.valid = true;
+    _reading.temperatureC = (float)temperatureC;
+    _reading.fetchedAtMs = nowMs;
+    _consecutiveFailures = 0;
+    _backoffMs = _config.initialBackoffMs;
+    _nextAttemptMs = nowMs + _config.refreshIntervalMs;
+    return true;
+  }
+
+  if (status == 200) {
+    _lastStatus = 0; // Body without main.temp
+  }
+  _consecutiveFailures++;
+  _nextAttemptMs = nowMs + _backoffMs;
+  _backoffMs = _backoffMs * 2 > _config.maxBackoffMs ? _config.maxBackoffMs : _backoffMs * 2;
+  return true;
+}
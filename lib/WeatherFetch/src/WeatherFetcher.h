@@ -0,0 +1,70 @@
+#ifndef WEATHER_FETCHER_H
+#define WEATHER_FETCHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Blocking HTTP GET with a deadline, provided by the platform (HTTPClient on the ESP32,
+// POSIX sockets in the simulator). Writes at most capacity - 1 body bytes plus a
+// terminator. Returns the HTTP status, or a negative value when no response arrived.
+class HttpGetter {
+public:
+  virtual ~HttpGetter() {}
+  virtual int get(const char* url, char* body, size_t capacity, size_t& length, uint32_t timeoutMs) = 0;
+};
+
+struct WeatherFetcherConfig {
+  WeatherFetcherConfig();
+
+  unsigned long refreshIntervalMs; // Between successful fetches
+  uint32_t requestTimeoutMs;       // Whole request, connect to last body byte
+  unsigned long initialBackoffMs;  // First retry after a failure, doubled per failure
+  unsigned long maxBackoffMs;
+  unsigned long staleAfterMs;      // Cached reading older than this is reported as stale
+};
+
+// Last good reading. fetchedAtMs is the time of the successful request.
+struct WeatherReading {
+  bool valid; // False until the first successful fetch
+  float temperatureC;
+  unsigned long fetchedAtMs;
+};
+
+// --- Weather Fetcher ---
+// Schedules the weather request, keeps the last good temperature and backs off
+// exponentially while requests fail (timeout, HTTP error, unparsable body): a failure never
+// clears the cached value, it only ages until stale(). Only main.temp is extracted from the
+// response (findJsonNumber), into a fixed body buffer. update() blocks for at most one
+// request timeout, so run it from a task of its own, never from the control path.
+class WeatherFetcher {
+public:
+  static const size_t BODY_CAPACITY = 1024; // OpenWeatherMap current weather is ~500 bytes
+
+  WeatherFetcher(HttpGetter& http, const WeatherFetcherConfig& config = WeatherFetcherConfig());
+
+  void setUrl(const char* url); // Copied; a new URL is fetched at the next update()
+
+  bool due(unsigned long nowMs) const { return !_attempted || (long)(nowMs - _nextAttemptMs) >= 0; }
+  // Fetches if due. True if a request was made.
+  bool update(unsigned long nowMs);
+
+  WeatherReading reading() const { return _reading; }
+  bool stale(unsigned long nowMs) const { return !_reading.valid || nowMs - _reading.fetchedAtMs > _config.staleAfterMs; }
+  int consecutiveFailures() const { return _consecutiveFailures; }
+  unsigned long nextAttemptMs() const { return _nextAttemptMs; }
+  int lastStatus() const { return _lastStatus; } // HTTP status, negative: transport error, 0: parse error
+
+private:
+  HttpGetter& _http;
+  WeatherFetcherConfig _config;
+  char _url[256];
+  char _body[BODY_CAPACITY];
+  WeatherReading _reading;
+  bool _attempted;
+  unsigned long _nextAttemptMs;
+  unsigned long _backoffMs;
+  int _consecutiveFailures;
+  int _lastStatus;
+};
+
+#endif // WEATHER_FETCHER_H
@@ -1,7 +1,5 @@
 #include <Arduino.h>
 #include <MAX6675.h>
-#include <stdlib.h> // For qsort
-#include <algorithm> // For std::sort (or use qsort)
 #include <WiFi.h>
 #include <ESPmDNS.h>
 #include <WiFiUdp.h>
@@ -10,6 +8,34 @@
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
 #include <WebServer.h> // For Web Server
+#include <Preferences.h> // NVS storage for the identified thermal model and the sensor calibrations
+#include <driver/i2s.h> // Continuous pressure capture: I2S clocks ADC1, DMA fills the buffers
+#include <driver/adc.h>
+#include <atomic>
+#include "Snapshot.h" // Lock-free task-to-task data exchange
+#include <HeaterController.h> // Hardware-independent heater control core (lib/HeaterControl)
+#include <HeaterWatchdog.h> // Relay interlock on its own task
+#include <PressureDecimator.h> // Decimating consumer of the pressure capture (lib/PressureCapture)
+#include <PressureScale.h>
+#include <CalibrationCurve.h> // N-point sensor calibration curves (lib/SensorCalibration)
+#include <ShotCapture.h> // 50 Hz shot pressure capture with pre-trigger (lib/PressureCapture)
+#include <PumpController.h> // Closed-loop shot pressure profiles (lib/PressureProfile)
+#include <FlowEstimator.h> // Flow and shot volume from pump power and pressure
+#include <RBDdimmer.h> // Pump phase-angle control through the AC dimmer module
+#include <MovingAverage.h> // Compile-time sized pressure filters (lib/SignalFilters)
+#include <JsonWriter.h> // Allocation-free streaming JSON for the web handlers (lib/JsonStream)
+#include <EventStreamHub.h> // Server-Sent Events fan-out with per-client back-pressure (lib/EventStream)
+#include <lwip/sockets.h> // Non-blocking send() for the event stream
+#include <TelemetryFrame.h> // Compact binary history frames (lib/TelemetryFrame)
+#include <TieredHistory.h> // Min/max/mean history at three resolutions (lib/TieredHistory)
+#include <OledView.h> // Retained-mode OLED fields, dirty regions only (lib/OledView)
+#include <LittleFS.h> // Shot log partition
+#include <ShotStore.h> // Append-only shot log with a RAM index (lib/ShotLog)
+#include <ShotRecorder.h>
+#include <JobScheduler.h> // Periodic jobs of the network task (lib/JobScheduler)
+#include <StageMetrics.h> // Per-stage cycle counters and histograms (lib/StageMetrics)
+#include <StandbyPolicy.h> // Low-power standby while the machine is presumed off (lib/PowerStandby)
+#include <time.h> // Clock from the SNTP client built into the ESP32 core (configTime)
 
 // --- LED_BUILTIN Definition ---
 #ifndef LED_BUILTIN
@@ -20,9 +46,8 @@
 #define ENABLE_DATETIME_WEATHER_FEATURE // Comment this line out to disable Date/Time/Weather feature
 
 #ifdef ENABLE_DATETIME_WEATHER_FEATURE
-#include <NTPClient.h> // Added for NTP
 #include <HTTPClient.h> // Added for Weather API
-#include <ArduinoJson.h> // Added for parsing Weather JSON
+#include <WeatherFetcher.h> // Cached weather with timeouts and backoff, filtered JSON (lib/WeatherFetch)
 #endif
 
 // WiFi credentials
@@ -56,16 +81,80 @@ MAX6675 thermocouple(thermoSCK, thermoCS, thermoSO);
 const int pressureSensorPin = 35; // Using GPIO35 (ADC1_CH7), an ADC1 pin suitable for use with Wi-Fi.
                                 // GPIO4 is an ADC2 pin and may not work reliably when Wi-Fi is active.
 
-// --- Pressure Sensor ADC Processing Setup ---
-const int PRESSURE_RAW_SAMPLES_COUNT = 7; // Number of raw ADC samples to take ( reverted to older commit value)
-const int PRESSURE_SAMPLES_TO_DISCARD_EACH_END = 1; // Discard 1 lowest and 1 highest (reverted to older commit value)
-int pressureAdcSampleReadings[PRESSURE_RAW_SAMPLES_COUNT];
+const adc1_channel_t PRESSURE_ADC_CHANNEL = ADC1_CHANNEL_7; // Same pin, as seen by the I2S ADC driver
+
+// --- Continuous Pressure Capture (I2S ADC DMA) ---
+// The I2S peripheral clocks ADC1 at a fixed rate and DMA fills a ring of buffers in the
+// background, so the sensing task never waits on a conversion. It drains whatever is ready
+// each period and decimates it: every 40-sample block (20 ms, one mains period of pump ripple)
+// becomes one value with the lowest and highest sample dropped. Timestamps come from the
+// sample count, not from when the task ran.
+const i2s_port_t PRESSURE_I2S_PORT = I2S_NUM_0; // Only I2S0 can be driven by the built-in ADC
+const uint32_t PRESSURE_SAMPLE_RATE_HZ = 2000;
+const uint16_t PRESSURE_DECIMATION_FACTOR = 40; // 2000 Hz / 40 = 50 Hz, the sensing task rate
+const int PRESSURE_DMA_BUFFER_COUNT = 4;
+const int PRESSURE_DMA_BUFFER_SAMPLES = 250; // 4 x 125 ms of headroom before the DMA overruns
+const int PRESSURE_I2S_EVENT_QUEUE_LENGTH = 4;
+const uint16_t PRESSURE_I2S_DATA_MASK = 0x0FFF; // Upper 4 bits of each sample carry the channel number
+PressureDecimator pressureDecimator(PRESSURE_SAMPLE_RATE_HZ, PRESSURE_DECIMATION_FACTOR);
+QueueHandle_t pressureI2sEventQueue = NULL;
+uint16_t pressureDrainBuffer[PRESSURE_DMA_BUFFER_SAMPLES];
+bool pressureCaptureRunning = false;
+unsigned long pressureCaptureStartMs = 0; // millis() at sample index 0
+uint32_t pressureDmaOverruns = 0;
+float latestPressureBar = NAN; // Newest decimated pressure (sensing task)
+
+MovingAverage<SensorScalar, 5, SensorAccumulator> pressureAdcSmoothing; // SMA over 5 decimated values (100 ms)
+
+// --- Pump Dimmer (pressure profiling, owned by the sensing task) ---
+// AC dimmer module between the brew switch and the pump. While a profiled shot runs, the
+// pump controller sets its phase angle once per decimated pressure block (50 Hz) from the
+// smoothed pressure; the profile starts and stops with the shot timer. Otherwise the dimmer
+// passes full power, as if it was not fitted. Profiles: POST /profile.
+const int PUMP_DIMMER_PIN = 25;     // Dimmer gate input
+const int PUMP_ZERO_CROSS_PIN = 26; // Dimmer zero-cross output
+dimmerLamp pumpDimmer(PUMP_DIMMER_PIN, PUMP_ZERO_CROSS_PIN);
+PumpController pumpController;
+int pumpDimmerPower = -1; // Last power written to the dimmer, percent
+
+// Dimmer power in whole percent; the dimmer is only written when that changes. 0 switches
+// the output off (volumetric stop) instead of firing late in each half-wave.
+void setPumpPower(float percent) {
+  int power = (int)lroundf(percent);
+  if (power == pumpDimmerPower) return;
+  if (power <= 0) {
+    pumpDimmer.setState(OFF);
+  } else {
+    if (pumpDimmerPower <= 0) pumpDimmer.setState(ON);
+    pumpDimmer.setPower(power);
+  }
+  pumpDimmerPower = power;
+}
 
-const int PRESSURE_SMOOTHING_SAMPLES = 5; // Number of stable ADC values to average for final smoothing (reverted to older commit value)
-double pressureAdcSmoothingBuffer[PRESSURE_SMOOTHING_SAMPLES];
-int currentPressureAdcSmoothingIndex = 0;
-double totalPressureAdcSmoothingSum = 0;
-int numPressureAdcValuesStored = 0;
+// --- Flow Estimate & Volumetric Stop (owned by the sensing task) ---
+// No flow meter: the flow through the puck comes from the pump curve at the dimmer power
+// and the smoothed pressure (FlowEstimator), once per decimated block, and its volume is
+// integrated over the shot timer. With a target volume set, the dimmer cuts the pump once
+// the shot plus the water still stored above the puck reaches it. The brew switch is not
+// wired to the controller, so the pump stays off until the timer has stopped and
+// VOLUMETRIC_STOP_HOLD_MS have passed: turn the switch off meanwhile. Settings and the
+// pump calibration from a weighed shot: POST /flow.
+const unsigned long VOLUMETRIC_STOP_HOLD_MS = 10000;
+FlowEstimator flowEstimator;
+unsigned long lastFlowSampleMs = 0;
+bool volumetricStopActive = false;
+unsigned long volumetricStopMs = 0;
+
+// --- High-rate Shot Capture (owned by the sensing task) ---
+// Every decimated pressure value of the last shot, before the 100 ms SMA so the
+// pre-infusion ramp keeps its shape, plus a pre-trigger window before the 2 bar shot timer
+// start. Stops with the shot timer (the 1.7 bar pause). Download: GET /capture.csv.
+// Fixed budget: two banks of SHOT_CAPTURE_SAMPLES int16 values (16 KB), see ShotCapture.
+const uint32_t SHOT_CAPTURE_PERIOD_MS = 1000u * PRESSURE_DECIMATION_FACTOR / PRESSURE_SAMPLE_RATE_HZ; // 20 ms
+const size_t SHOT_CAPTURE_SAMPLES = 4000;            // 80 s per capture, pre-trigger included
+const uint32_t SHOT_CAPTURE_PRE_TRIGGER_MS = 2000;
+const size_t SHOT_CAPTURE_PRE_TRIGGER_SAMPLES = SHOT_CAPTURE_PRE_TRIGGER_MS / SHOT_CAPTURE_PERIOD_MS;
+ShotCapture<SHOT_CAPTURE_SAMPLES, SHOT_CAPTURE_PRE_TRIGGER_SAMPLES> shotCapture(SHOT_CAPTURE_PERIOD_MS);
 
 // Pressure Calibration Constants
 const float VOLTS_AT_0_BAR = 0.34f; // New calibration: 0.34V at 0 bar
@@ -73,116 +162,108 @@ const float VOLTS_AT_16_BAR = 4.34f; // New calibration: 4.34V at 16 bar
 const float PRESSURE_MAX_BAR = 16.0f; // Max pressure (reverted to older commit value)
 const float ESP32_ADC_MAX_VOLTAGE = 3.3f; // ESP32 ADC reference voltage
 const float ESP32_ADC_MAX_VALUE = 4095.0f; // ESP32 12-bit ADC max value
+// Transducer curve, volts to bar: two points for the linear default, POST /calibration for more
+const CalibrationCurve DEFAULT_PRESSURE_CURVE = linearCalibration(VOLTS_AT_0_BAR, 0.0, VOLTS_AT_16_BAR, PRESSURE_MAX_BAR);
+PressureScale pressureScale(DEFAULT_PRESSURE_CURVE, ESP32_ADC_MAX_VOLTAGE, ESP32_ADC_MAX_VALUE); // Sensing task
 
 
 // --- Temperature Calibration Setup ---
-// Add more points for better accuracy. Ensure raw_temps_c is sorted if using more than 2 points
-// and updating the getCalibratedTemperature function accordingly.
-const int CALIBRATION_POINTS_COUNT = 2;
-// Raw temperatures from the thermocouple (e.g., {reading1, reading2})
-double raw_temps_c[CALIBRATION_POINTS_COUNT] = {99.0, 115.0}; // {99.0C raw, 115.0C raw}
-// Corresponding actual temperatures (e.g., {actual_for_reading1, actual_for_reading2})
-double actual_temps_c[CALIBRATION_POINTS_COUNT] = {85.0, 97.8}; // {85.0C actual, 97.8C actual}
-
-/**
- * Calculates calibrated temperature using linear interpolation/extrapolation
- * based on the defined calibration points.
- *
- * @param rawTempC The raw temperature reading from the thermocouple.
- * @return The calibrated temperature.
- */
-double getCalibratedTemperature(double rawTempC) {
-  if (CALIBRATION_POINTS_COUNT < 2) {
-    // Not enough points for linear interpolation, return raw temperature
-    Serial.println(F("Calibration requires at least 2 points. Returning raw temperature."));
-    return rawTempC;
-  }
-
-  // Using the two defined points for linear interpolation/extrapolation
-  // (x1, y1) = (raw_temps_c[0], actual_temps_c[0])
-  // (x2, y2) = (raw_temps_c[1], actual_temps_c[1])
-  // Formula: y = y1 + (x - x1) * (y2 - y1) / (x2 - x1)
-  // where x is rawTempC and y is the calibrated temperature.
-
-  double x1 = raw_temps_c[0];
-  double y1 = actual_temps_c[0];
-  double x2 = raw_temps_c[1];
-  double y2 = actual_temps_c[1];
-
-  // Check to prevent division by zero if calibration points are identical for raw readings
-  if (x2 - x1 == 0) {
-    Serial.println(F("Calibration error: Raw temperature points are identical. Returning raw temperature."));
-    return rawTempC; // Or return y1, as actual temps might also be the same or it's an error state
-  }
-
-  double calibratedTemp = y1 + (rawTempC - x1) * (y2 - y1) / (x2 - x1);
-  return calibratedTemp;
-}
-
-// --- Temperature Smoothing Setup ---
-// EMA (Exponential Moving Average) for temperature
-const float TEMP_EMA_ALPHA = 0.07f; // Smoothing factor for EMA (smaller = more smoothing, e.g., 0.1-0.3)
-                                   // Alpha = 2 / (N+1) where N is SMA equivalent. N=19 -> Alpha approx 0.1
-double smoothedTempC_EMA = NAN;    // Stores the current EMA smoothed temperature, persists across readings
-
-// Variables for non-blocking temperature reading
-unsigned long lastTempReadTime = 0;
-const long tempReadInterval = 500; // Read temperature every 100 milliseconds (1 second)
+// Default two-point line: 99.0C raw reads 85.0C actual, 115.0C raw reads 97.8C actual.
+// POST /calibration uploads up to 16 points (piecewise or polynomial), kept in NVS.
+const CalibrationCurve DEFAULT_TEMPERATURE_CURVE = linearCalibration(99.0, 85.0, 115.0, 97.8);
+TemperatureCalibration temperatureCalibration(DEFAULT_TEMPERATURE_CURVE); // Control task
+
+// --- OLED Frame Budget (network task) ---
+// Only changed glyphs are redrawn and sent, so frames can be frequent (the shot timer ticks
+// smoothly) while each one holds the I2C bus for a few ms at most.
+const unsigned long OLED_FRAME_INTERVAL_MS = 100;
+const size_t OLED_MAX_BYTES_PER_FRAME = 384; // ~9 ms at 400 kHz; more waits for the next frame
+const uint8_t OLED_I2C_ADDRESS = 0x3C;
+const uint32_t OLED_I2C_CLOCK_HZ = 400000;
+const size_t OLED_I2C_CHUNK_BYTES = 64; // Data bytes per I2C transaction (Wire buffer is 128)
+
+// --- Stage Metrics (GET /metrics, serial summary) ---
+// Run time of the main stages of every task in CPU cycles, with a duration histogram per
+// stage; the task loops also record their longest pass-to-pass interval. Each stage
+// is recorded by one task only. Every task is pinned to a core, so the per-core cycle
+// counter is consistent within a stage.
+enum MetricStage {
+  STAGE_CONTROL_LOOP,   // runControlCycle()
+  STAGE_SENSING_LOOP,   // runSensingCycle()
+  STAGE_NETWORK_LOOP,   // One pass of the network jobs
+  STAGE_WATCHDOG_LOOP,  // heaterWatchdog.tick()
+  STAGE_THERMOCOUPLE,   // MAX6675 read (inside the heater update)
+  STAGE_HEATER_UPDATE,  // Heater state machine, thermocouple read included
+  STAGE_PRESSURE_DRAIN, // I2S DMA drain and decimation
+  STAGE_PRESSURE_BLOCK, // Per 20 ms block: smoothing, shot timer, capture
+  STAGE_WIFI,           // handleWiFiConnection()
+  STAGE_OTA,
+  STAGE_HTTP,           // server.handleClient(), every handler included
+  STAGE_TELEMETRY,      // Event stream accept and send
+  STAGE_HISTORY,        // History sampling
+  STAGE_SHOT_LOG,
+  STAGE_OLED,           // OLED redraw
+  STAGE_COUNT
+};
+const char* const METRIC_STAGE_NAMES[STAGE_COUNT] = {
+    "control_loop", "sensing_loop", "network_loop", "watchdog_loop", "thermocouple_read", "heater_update", "pressure_drain",
+    "pressure_block", "wifi", "ota", "http", "telemetry_stream", "history", "shot_log", "oled"};
+const MetricStage LAST_LOOP_STAGE = STAGE_WATCHDOG_LOOP;
+const char* const METRICS_PREFIX = "espresso_";
+// Summary on Serial every interval, 0 = off. About 1 KB per summary, which holds up the
+// network task for ~80 ms at 115200 baud (and shows up in network_loop's interval).
+const uint32_t METRICS_SERIAL_INTERVAL_MS = 0;
+uint32_t metricsCycleClock() { return ESP.getCycleCount(); }
+StageMetrics stageMetrics(metricsCycleClock);
 
 // --- Relay Control Setup ---
 const int RELAY_PIN = 14; // Corrected RELAY_PIN back to 14
-bool isRelayOn = false;
-unsigned long heaterStopTimeMs = 0; // Timestamp for when the heater should turn off (during HEATING state)
 
-// --- Temperature Control Parameters & States ---
-enum HeaterState { IDLE, HEATING, SETTLING };
-HeaterState currentHeaterState = IDLE;
+// --- Heater Control Core (lib/HeaterControl) ---
+// Temperature smoothing, the IDLE/HEATING/SETTLING state machine, early cutoff cooldown and
+// presumed-off detection live in the HeaterControl library; tuning constants are the defaults
+// of HeaterControllerConfig. These adapters bind it to the hardware.
+void updateOledStatus(const String& newMessage);
 
-volatile double desiredTemperatureC = 90.0; // Target temperature, no longer const
-const float HEATER_SECONDS_PER_DEGREE_C = 2.0f ; // Approx 2 seconds of heating raises temp by 1 degree C
-const unsigned long MAX_HEATER_ON_DURATION_MS = 70 * 1000; // Max 30 seconds heater on time for safety
+class ArduinoClock : public Clock {
+public:
+  unsigned long millis() override { return ::millis(); }
+};
+
+class Max6675Sensor : public TemperatureSensor {
+public:
+  double readCelsius() override {
+    StageTimer timer(stageMetrics, STAGE_THERMOCOUPLE);
+    return thermocouple.readCelsius();
+  }
+};
 
-// Dynamic Settling Parameters
-const double SETTLED_TEMP_RISE_MAX_C = 0.3; // Max allowed temperature rise during observation to be considered settled
-const unsigned long SETTLED_OBSERVATION_PERIOD_MS = 10 * 1000; // 10 seconds observation window
-const double EARLY_CUTOFF_TEMP_C = 76.0; // Temperature threshold for early cutoff in HEATING state
-unsigned long settlingCheckStartTimeMs = 0; // Timestamp when the current settling observation period started
-double tempAtSettlingCheckStartC = 0.0; // Temperature at the start of the current settling observation
+class RelayPin : public Relay {
+public:
+  void set(bool on) override { digitalWrite(RELAY_PIN, on ? LOW : HIGH); } // Relay is Active LOW
+};
 
-// The lower threshold for heating is now dynamically calculated as desiredTemperatureC - 1.0.
+class SerialControlEvents : public ControlEvents {
+public:
+  void log(const char* message) override { Serial.println(message); }
+  void status(const char* message) override { updateOledStatus(message); }
+};
 
-// Variable to store the last calculated heating duration when entering HEATING state
-unsigned long lastCalculatedHeatDurationMs = 0;
+ArduinoClock arduinoClock;
+Max6675Sensor thermocoupleSensor;
+RelayPin relayPin;
+SerialControlEvents controlEvents;
+// The controller reaches the relay and the thermocouple through the safety watchdog, which
+// forces the relay off on its own task (limits in HeaterWatchdogConfig).
+HeaterWatchdog heaterWatchdog(arduinoClock, relayPin, controlEvents);
+InterlockedRelay interlockedRelay(heaterWatchdog);
+WatchedSensor watchedThermocouple(heaterWatchdog, thermocoupleSensor);
+HeaterController heaterController(arduinoClock, watchedThermocouple, interlockedRelay, controlEvents, temperatureCalibration);
 
-// --- Cooldown after Early Cutoff ---
-bool enteredIdleAfterEarlyCutoff = false; // Flag set in HEATING on early cutoff
-bool inEarlyCutoffCooldown = false;       // True if IDLE is currently in the mandatory off period
-unsigned long earlyCutoffCooldownEndTime = 0; // Timestamp for when the cooldown ends
-const unsigned long EARLY_CUTOFF_COOLDOWN_DURATION_MS = 60 * 1000; // 1 minute mandatory off time
+std::atomic<bool> web_early_cutoff_signal(false); // Signal for client plot reset
+uint32_t earlyCutoffEventCount = 0; // Events taken from web_early_cutoff_signal (network task)
 
 // --- LED Control Setup ---
-// --- Machine Presumed Off Detection & Standby Logic ---
-// New Configuration Parameters
-const float PRESUMED_OFF_TEMP_THRESHOLD_C = 86.0f; // Temperature below which monitoring for presumed off starts
-volatile bool web_early_cutoff_signal = false; // Signal for client plot reset
-const unsigned long PRESUMED_OFF_DURATION_MS = 3 * 60 * 1000; // 3 minutes: duration for temp to be below threshold AND stable/decreasing to be presumed off
-// PRESUMED_OFF_CHECK_INTERVAL_MS is retained from original, just moved its declaration up for clarity
-const unsigned long PRESUMED_OFF_CHECK_INTERVAL_MS = 10000; // Check every 10 seconds during monitoring
-
-// Consolidated and Renamed State Variables
-bool machineIsPresumedOff = false;       // True if the system believes the main machine power is off
-unsigned long machineOffMonitorStartTime = 0; // Timestamp when temp first dropped < PRESUMED_OFF_TEMP_THRESHOLD_C while monitoring
-bool isMonitoringForMachineOff = false;  // True if actively checking the PRESUMED_OFF_DURATION_MS condition
-float lastTempDuringMachineOffMonitoring = 100.0f; // Stores temp from previous check during monitoring, init high
-unsigned long lastMachineOffCheckTimestamp = 0; // Timestamp for the PRESUMED_OFF_CHECK_INTERVAL_MS check
-
-int consecutiveFailedHeatingAttempts = 0;
-const int MAX_CONSECUTIVE_HEATING_FAILURES = 5;
-const float TEMP_DIFF_THRESHOLD_FOR_HEATING_FAILURE = 5.0; // Degrees C below desired to count as failure
-// Variables for detecting machine power-on (temperature rise rate)
-float previousTempForRateCheck = 0.0;
-unsigned long lastRateCheckTime = 0;
-const unsigned long RATE_CHECK_INTERVAL_MS = 5000; // Check rate every 5 seconds
 // const int BUILTIN_LED_PIN = 2; // Using LED_BUILTIN, but if not defined for your board, uncomment and set this.
 unsigned long lastBlinkTimeLed = 0;
 const long blinkIntervalRapid = 150; // milliseconds for rapid blink
@@ -191,72 +272,226 @@ const long blinkIntervalVeryRapid = 50;     // milliseconds for very rapid blink
 
 // --- Status LED on GPIO27 ---
 const int STATUS_LED_PIN = 27;
-unsigned long lastStatusLedToggleTime = 0;
 const long statusLedToggleInterval = 5000; // 5 seconds
 
-#ifdef ENABLE_DATETIME_WEATHER_FEATURE
-// --- NTP Client Setup ---
+// --- NTP Setup ---
+// configTime() starts the lwIP SNTP client, which syncs in the background (hourly); reading
+// the clock is a local time() call and never waits on the network. Used for the OLED clock
+// and the shot log timestamps.
 const char* ntpServer = "pool.ntp.org";
 const long gmtOffset_sec = -14400; // Replace with your GMT offset in seconds (e.g., for GMT+1, use 3600)
-const int daylightOffset_sec = 3600; // Replace with your daylight offset in seconds if applicable
-
-WiFiUDP ntpUDP;
-NTPClient timeClient(ntpUDP, ntpServer, gmtOffset_sec, daylightOffset_sec);
+const int daylightOffset_sec = 0; // Added on top of gmtOffset_sec (-14400 is already daylight time here)
+const time_t MIN_VALID_EPOCH = 1600000000; // Clock not set before the first sync
 
+#ifdef ENABLE_DATETIME_WEATHER_FEATURE
 // --- Weather Setup ---
 String openWeatherMapApiKey = "YOUR_OPEN_WEATHER_API_KEY";
 String city = "Montreal,Canada";
 String units = "metric"; // or "imperial"
 String weatherApiUrlBase = "http://api.openweathermap.org/data/2.5/weather?q=";
 
-unsigned long lastWeatherReadTime = 0;
-const long weatherReadInterval = 15 * 60 * 1000; // 15 minutes in milliseconds
-float currentWeatherDataTemp = NAN; // Store current weather temperature
-String currentTimeStr = "--:--";
-String currentDateStr = "--/--";
-String currentDayOfWeekStr = "---";
+// The weather task owns the fetcher (requests block up to the timeout); everyone else reads
+// the cached reading from weatherSnapshot. Refresh 15 min, timeout 5 s, backoff 30 s doubling
+// to 15 min, stale after 1 h: WeatherFetcherConfig defaults.
+const uint32_t WEATHER_TASK_POLL_MS = 1000;
 #endif
 
 // --- Web Server Setup ---
 WebServer server(80);
-volatile double web_smoothedTempC = NAN;
-volatile float web_pressureBar = NAN; // Reverted to web_pressureBar
-volatile bool web_isRelayOn = false;
-volatile double web_desiredTempC = 90.0; // To send current desired temp to UI
-String oledStatusMessage = "System Booting..."; // For displaying status on OLED
 
-// --- Shot Timer & History ---
-struct DataPoint {
-  unsigned long time_ms;
-  float value;
+// --- Live Telemetry Stream (Server-Sent Events) ---
+// The page subscribes with EventSource to http://<device>:81/ and gets a sensor frame every
+// TELEMETRY_FRAME_INTERVAL_MS; /data polling stays as the fallback. The stream has its own
+// listener because WebServer serves one request at a time and closes each connection.
+const uint16_t TELEMETRY_STREAM_PORT = 81;
+const unsigned long TELEMETRY_FRAME_INTERVAL_MS = 50; // 20 Hz, enough to follow a shot
+const size_t TELEMETRY_MAX_CLIENTS = 4;
+const size_t TELEMETRY_FRAME_CAPACITY = 512;
+const unsigned long TELEMETRY_STALL_TIMEOUT_MS = 5000; // Drop a viewer whose socket accepts nothing for this long
+WiFiServer telemetryServer(TELEMETRY_STREAM_PORT);
+
+// --- Task Layout ---
+// Core 1 (APP_CPU): control task (temperature, heater state machine, relay) at a fixed period,
+//                   sensing task (pressure ADC, shot timer, max pressure) at a fixed period,
+//                   watchdog task (relay interlock) above both, so neither can starve it.
+// Core 0 (PRO_CPU): network task (WiFi, OTA, web server, history, OLED, LEDs) and the
+//                   weather task (HTTP fetch with timeout). A large /history response can
+//                   only stall the network task, a slow weather request only the weather task.
+const BaseType_t CONTROL_TASK_CORE = 1;
+const BaseType_t SENSING_TASK_CORE = 1;
+const BaseType_t NETWORK_TASK_CORE = 0;
+const BaseType_t WATCHDOG_TASK_CORE = 1;
+const UBaseType_t WATCHDOG_TASK_PRIORITY = 6; // Highest of ours: a few microseconds per tick
+const UBaseType_t CONTROL_TASK_PRIORITY = 5; // Preempts sensing
+const UBaseType_t SENSING_TASK_PRIORITY = 4;
+const UBaseType_t NETWORK_TASK_PRIORITY = 1;
+const uint32_t CONTROL_TASK_STACK_SIZE = 4096;
+const uint32_t SENSING_TASK_STACK_SIZE = 4096;
+const uint32_t NETWORK_TASK_STACK_SIZE = 8192;
+const uint32_t WATCHDOG_TASK_STACK_SIZE = 3072; // Trip log line formatting
+const uint32_t CONTROL_TASK_PERIOD_MS = 100; // Heater decisions are evaluated every 100 ms
+const uint32_t SENSING_TASK_PERIOD_MS = 20;  // Pressure pipeline runs at 50 Hz
+const uint32_t WATCHDOG_TASK_PERIOD_MS = 50; // Worst case a tripped relay stays on this long
+TaskHandle_t controlTaskHandle = NULL;
+TaskHandle_t sensingTaskHandle = NULL;
+TaskHandle_t networkTaskHandle = NULL;
+TaskHandle_t watchdogTaskHandle = NULL;
+void controlTask(void* parameter);
+void sensingTask(void* parameter);
+void networkTask(void* parameter);
+void watchdogTask(void* parameter);
+
+// --- Low-Power Standby ---
+// While the machine is presumed off and nobody uses the web UI (StandbyPolicy), the tasks
+// and the polling jobs run at their standby periods, the thermocouple is read every 2 s,
+// the CPU drops to 80 MHz, the WiFi modem sleeps through more beacons and the OLED is
+// dimmed. The power-on detection or a web request brings everything back to full rate.
+// The task loop counts in GET /metrics show the wake-ups; `program standby` compares them.
+const uint32_t CONTROL_TASK_STANDBY_PERIOD_MS = 500;  // Reads are 2 s apart
+const uint32_t SENSING_TASK_STANDBY_PERIOD_MS = 200;  // Inside the DMA's 500 ms of headroom
+const uint32_t WATCHDOG_TASK_STANDBY_PERIOD_MS = 250; // The readings it checks are 2 s apart
+const uint32_t FULL_CPU_MHZ = 240;
+const uint32_t STANDBY_CPU_MHZ = 80; // Lowest clock the WiFi driver supports
+StandbyPolicy standbyPolicy;
+void wakeFromStandby();
+
+// --- Network Task Jobs ---
+// The network task's periodic work runs as JobScheduler jobs (see networkTask()): it
+// sleeps until the next deadline instead of polling on a 2 ms delay, and each job's runtime
+// and lateness is recorded (GET /jobs). In low-power standby the polling jobs stretch
+// their periods.
+const uint32_t WEB_JOB_MS = 5;               // WiFi state, OTA, web server, telemetry stream
+const uint32_t WEB_JOB_STANDBY_MS = 100;     // A request waits this long, then wakes everything
+const uint32_t COMMAND_JOB_MS = 100;         // Requests from the other tasks (NVS writes)
+const uint32_t SHOT_LOG_JOB_MS = 50;         // Shot start/end detection; the trace has its own interval
+const uint32_t LED_JOB_MS = 50;              // Fastest blink pattern (blinkIntervalVeryRapid)
+const uint32_t LED_JOB_STANDBY_MS = 500;     // The LED is off
+const uint32_t OLED_JOB_STANDBY_MS = 1000;   // Clock seconds still tick
+const uint32_t STANDBY_JOB_MS = 1000;
+uint32_t schedulerMicros() { return (uint32_t)micros(); }
+JobScheduler networkJobs(schedulerMicros); // Owned by the network task
+uint8_t webJobId, ledJobId, oledJobId;      // Periods switched by the standby job
+bool networkStandby = false;                 // Low-power level applied (network task)
+#ifdef ENABLE_DATETIME_WEATHER_FEATURE
+// Weather task, core 0 next to the network task: a DNS or HTTP stall only delays the next
+// weather reading.
+const BaseType_t WEATHER_TASK_CORE = 0;
+const UBaseType_t WEATHER_TASK_PRIORITY = 1; // Same as network, time-sliced while it waits on sockets
+const uint32_t WEATHER_TASK_STACK_SIZE = 6144;
+TaskHandle_t weatherTaskHandle = NULL;
+void weatherTask(void* parameter);
+#endif
+bool beginPressureCapture();
+
+// --- Shared Snapshots (replace the former volatile web_* globals) ---
+// Each snapshot has exactly one writer task; every other task only reads it.
+struct ControlSnapshot {
+  double smoothedTempC;
+  double tempRateCPerS; // Kalman dT/dt
+  double desiredTempC;
+  bool isRelayOn;
+  HeaterState heaterState;
+  ControlMode controlMode;
+  float heaterDuty; // PID/MPC window duty, 0..1
+  AutoTuneStatus autoTuneStatus;
+  int autoTuneCycleCount;
+  bool machineIsPresumedOff;
+  bool isTempPlotPaused;
+  SensorFault sensorFault;     // SENSOR_OK unless the controller is DEGRADED
+  uint32_t sensorFaultCounts[SENSOR_FAULT_COUNT];
+  uint32_t sensorFailedReads;
+  uint32_t sensorRejectedReads;
 };
-const int HISTORY_SIZE = 90; // 90 seconds of data, 1 sample/sec
-DataPoint tempHistory[HISTORY_SIZE];
-DataPoint pressureHistory[HISTORY_SIZE];
-int tempHistoryIndex = 0;
-int pressureHistoryIndex = 0;
-int tempHistoryCount = 0;
-int pressureHistoryCount = 0;
-unsigned long lastHistorySampleTime = 0;
-const long historySampleInterval = 1000; // 1 second
-
-// --- Shot Timer Variables ---
-volatile bool isShotRunning = false;
-volatile unsigned long shotStartTime_ms = 0;
-volatile unsigned long web_shotDuration_ms = 0; // Duration to be sent to the web UI
+Snapshot<ControlSnapshot> controlSnapshot({NAN, NAN, 90.0, false, IDLE, CONTROL_MODE_BURST, 0.0f, AUTOTUNE_OFF, 0, false, false,
+                                           SENSOR_OK, {0}, 0, 0}); // Written by control task
+
+struct ThermalModelSnapshot {
+  ThermalModel model;
+  bool identified; // False: hand-tuned defaults are in use
+};
+Snapshot<ThermalModelSnapshot> thermalModelSnapshot; // Written by control task (and setup before tasks start)
+
+Snapshot<CalibrationCurve> temperatureCurveSnapshot; // Written by network task (and setup before tasks start)
+Snapshot<CalibrationCurve> pressureCurveSnapshot;    // Written by network task (and setup before tasks start)
+
+struct PressureSnapshot {
+  float pressureBar;
+  float maxObservedPressure;
+  bool isShotRunning;
+  unsigned long shotDuration_ms;
+  float flowMlPerS;         // Estimated, NAN outside a shot
+  float shotVolumeMl;       // Current or last shot
+  FlowShotTotals flowTotals; // Water balance of that shot (pump calibration)
+  bool volumetricStop;      // Pump held off at the target volume
+  bool isPressurePlotPaused;
+  uint32_t captureOverruns; // DMA buffers lost because the sensing task fell behind
+  float pumpPowerPercent;
+  float targetPressureBar;  // NAN unless a profiled shot is running
+  ProfilePhase profilePhase;
+  ProfileTracking profileTracking; // Current or last profiled shot
+};
+Snapshot<PressureSnapshot> pressureSnapshot({NAN, 0.0f, false, 0, NAN, 0.0f, {0.0f, 0.0f, 0.0f}, false, false, 0, 100.0f, NAN,
+                                             PROFILE_PREINFUSION, {NAN, 0.0f, 0}}); // Written by sensing task
+
+struct PressureProfileSettings {
+  PressureProfile profile;
+  bool enabled;
+};
+Snapshot<PressureProfileSettings> pressureProfileSnapshot; // Written by network task (and setup before tasks start)
+
+struct FlowSettings {
+  float targetVolumeMl; // Volumetric stop, 0: off
+  float flowScale;      // Pump curve calibration
+};
+Snapshot<FlowSettings> flowSettingsSnapshot; // Written by network task (and setup before tasks start)
+Snapshot<ShotCaptureTrace> shotCaptureSnapshot; // Last completed capture (generation 0: none), sensing task
+
+// --- Cross-task Commands ---
+// Requests raised by one task and consumed (exchange(false)) by the owning task.
+std::atomic<bool> desiredTempChangeRequested(false); // Web -> control
+std::atomic<float> requestedDesiredTempC(90.0f);
+std::atomic<bool> controlModeChangeRequested(false); // Web -> control
+std::atomic<int> requestedControlMode(CONTROL_MODE_BURST);
+std::atomic<bool> autoTuneStartRequested(false);     // Web -> control
+std::atomic<bool> autoTuneCancelRequested(false);    // Web -> control
+std::atomic<bool> thermalModelSaveRequested(false);  // Control -> network (NVS writes stay off core 1)
+std::atomic<bool> historyClearRequested(false);      // Control/sensing -> network (history owner)
+std::atomic<bool> maxPressureResetRequested(false);  // Control/network -> sensing (max pressure owner)
+std::atomic<bool> temperatureCurveChangeRequested(false); // Web -> control (temperatureCurveSnapshot)
+std::atomic<bool> pressureCurveChangeRequested(false);    // Web -> sensing (pressureCurveSnapshot)
+std::atomic<bool> pressureProfileChangeRequested(false);  // Web -> sensing (pressureProfileSnapshot)
+std::atomic<bool> flowSettingsChangeRequested(false);     // Web -> sensing (flowSettingsSnapshot)
+
+#ifdef ENABLE_DATETIME_WEATHER_FEATURE
+Snapshot<WeatherReading> weatherSnapshot({false, 0.0f, 0}); // Written by weather task
+#endif
+
+const size_t OLED_STATUS_MAX_LEN = 32;
+StatusMailbox<OLED_STATUS_MAX_LEN> oledStatusMailbox; // Any task may post, OLED reads the newest
+
+// --- Shot Timer & History ---
+// Tiered min/max/mean history (lib/TieredHistory): 1 s, 10 s and 1 min buckets covering
+// 1, 5 and 90 minutes, in 4 bytes per bucket - the same 1440 bytes the former two rings of
+// 90 one-second points used. Fed every 100 ms so even the 1 s buckets carry real extremes.
+TieredHistory tempHistory(10.0f, 0.1f);      // 0.1 C means, 0.1 C extremes (up to 25.5 C apart)
+TieredHistory pressureHistory(100.0f, 0.05f); // 0.01 bar means, 0.05 bar extremes (up to 12.75 bar)
+const long historySampleInterval = 100; // 10 Hz
+// History is owned by the network task; other tasks request a clear via historyClearRequested.
+
+// --- Shot Timer Variables (owned by the sensing task) ---
+bool isShotRunning = false;
+unsigned long shotStartTime_ms = 0;
+unsigned long web_shotDuration_ms = 0; // Duration to be sent to the web UI
 
 // --- Server-side Plot Pause State ---
-volatile bool web_isTempPlotPaused = false;
-volatile bool web_isPressurePlotPaused = false;
+bool web_isTempPlotPaused = false;     // Owned by the control task
+bool web_isPressurePlotPaused = false; // Owned by the sensing task
 float lastPressureForPauseCheck_server = 0.0f;
 
-// --- Max Pressure Tracking ---
-volatile float maxObservedPressure = 0.0f; // Stores the maximum stable pressure observed
-const int PRESSURE_STABILITY_SAMPLES_FOR_MAX = 5; // Number of samples to check for stability for max pressure
-float pressureMaxStabilityBuffer[PRESSURE_STABILITY_SAMPLES_FOR_MAX];
-int pressureMaxStabilityIndex = 0;
-int pressureMaxStabilityCount = 0;
-const float PRESSURE_STABILITY_THRESHOLD_FOR_MAX = 0.2f; // Max deviation in bar for considering pressure stable for max update
+// --- Max Pressure Tracking (owned by the sensing task) ---
+float maxObservedPressure = 0.0f; // Stores the maximum stable pressure observed
+MovingAverage<SensorScalar, 5, SensorAccumulator> pressureMaxStabilityWindow; // Samples checked for stability before a max update
+const SensorScalar PRESSURE_STABILITY_THRESHOLD_FOR_MAX(0.2f); // Max deviation in bar for considering pressure stable for max update
 const float PRESSURE_RESUME_THRESHOLD_BAR = 2.0f; // Hysteresis: pressure must rise to this value to resume plotting
 // --- End Max Pressure Tracking ---
 
@@ -311,17 +546,36 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
                     <label for="tempSlider" class="block mb-2 text-lg text-gray-400">Set Desired Temp: <span id="desiredTempDisplay" class="font-bold text-cyan-400">--</span>&deg;C</label>
                     <input type="range" id="tempSlider" min="70" max="100" value="90" step="0.5" class="w-full h-3 bg-gray-700 rounded-lg appearance-none cursor-pointer accent-cyan-500">
                 </div>
+
+                <div class="flex justify-between items-center mb-6 bg-gray-700 p-3 rounded-lg">
+                    <label for="controllerMode" class="text-md text-gray-300">Controller:</label>
+                    <select id="controllerMode" class="bg-gray-800 text-cyan-400 font-bold rounded p-1">
+                        <option value="burst">Burst</option>
+                        <option value="pid">PID</option>
+                        <option value="mpc">MPC</option>
+                    </select>
+                </div>
                 
                 <div class="flex justify-between items-center mb-6 bg-gray-700 p-3 rounded-lg">
                     <p class="text-md text-gray-300">Max Pressure:</p>
                     <p class="text-xl font-bold"><span id="maxPress">--</span> bar</p>
                 </div>
 
+                <div class="flex justify-between items-center mb-6 bg-gray-700 p-3 rounded-lg">
+                    <p class="text-md text-gray-300">Auto-tune: <span id="autotuneStatus" class="font-bold">--</span></p>
+                    <button id="autotuneButton" class="bg-cyan-600 hover:bg-cyan-700 text-white font-bold py-1 px-3 rounded">Start</button>
+                </div>
+
                 <div class="flex justify-between items-center mb-6 bg-gray-700 p-3 rounded-lg">
                     <p class="text-md text-gray-300">Heater Status:</p>
                     <p class="text-xl font-bold"><span id="relay">--</span></p>
                 </div>
 
+                <div class="flex justify-between items-center mb-6 bg-gray-700 p-3 rounded-lg">
+                    <p class="text-md text-gray-300">Thermocouple:</p>
+                    <p class="text-md font-bold"><span id="sensorHealth">--</span></p>
+                </div>
+
                 
                 <div class="grid grid-cols-1 gap-4 mb-6">
                     <div>
@@ -335,6 +589,7 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
                     <div>
                         <p class="text-lg text-gray-400">Shot Time</p>
                         <p class="text-5xl font-mono font-bold"><span id="shotTime">--.-</span><span class="text-3xl">s</span></p>
+                        <a href="/capture.csv" class="text-sm text-cyan-400 hover:underline">Download last shot (50 Hz CSV)</a>
                     </div>
                 </div>
 
@@ -346,6 +601,14 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
 
             <!-- Right Column: Charts -->
             <div class="md:col-span-2 bg-gray-800 p-6 rounded-lg shadow-lg">
+                <div class="flex justify-end items-center mb-2">
+                    <label for="plotRange" class="text-md text-gray-300 mr-2">Range:</label>
+                    <select id="plotRange" class="bg-gray-700 text-cyan-400 font-bold rounded p-1">
+                        <option value="60000">1 min (live)</option>
+                        <option value="300000">5 min</option>
+                        <option value="5400000">90 min</option>
+                    </select>
+                </div>
                 <div class="relative mb-6">
                     <h3 class="text-xl font-semibold mb-2">Temperature (&deg;C)</h3>
                     <div id="tempChart"></div>
@@ -372,6 +635,18 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
         let isTempPlotPaused = false;
         let isPressurePlotPaused = false;
         const PLOT_MAX_DURATION_MS = 60000; // 60 seconds
+        // Longer ranges are served from the coarser history tiers (min/max/mean buckets) and
+        // refreshed periodically instead of appending live points.
+        const HISTORY_REFRESH_MS = 10000;
+        let plotRangeMs = PLOT_MAX_DURATION_MS;
+        let tempBand = { min: [], max: [] };
+        let pressureBand = { min: [], max: [] };
+        const STREAM_PORT = 81; // Server-Sent Events, see TELEMETRY_STREAM_PORT
+        const POLL_INTERVAL_MS = 2000; // /data polling while the stream is not connected
+        const CHART_REDRAW_MS = 250;
+        let streamConnected = false;
+        let chartRedrawPending = false;
+        let lastEarlyCutoffCount = null;
 
         function createChart(elementId, title, color) {
             const options = {
@@ -399,7 +674,9 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
                     zoom: { enabled: false },
                     background: 'transparent'
                 },
-                stroke: { curve: 'smooth', width: 2, colors: [color] },
+                colors: [color, color, color],
+                stroke: { curve: 'smooth', width: [2, 1, 1], dashArray: [0, 3, 3] },
+                legend: { show: false },
                 grid: {
                     borderColor: '#4a5568',
                     row: { colors: ['transparent', 'transparent'], opacity: 0.5 },
@@ -409,6 +686,7 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
                     range: PLOT_MAX_DURATION_MS,
                     labels: {
                         style: { colors: '#9ca3af' },
+                        datetimeUTC: false,
                         format: 'mm:ss'
                     }
                 },
@@ -458,19 +736,66 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
             });
         }
 
+        const controllerModeSelect = document.getElementById('controllerMode');
+        controllerModeSelect.addEventListener('change', function() {
+            fetch('/setcontroller', {
+                method: 'POST',
+                headers: { 'Content-Type': 'application/x-www-form-urlencoded' },
+                body: 'mode=' + this.value
+            }).then(response => {
+                if (!response.ok) console.error('Error setting controller mode:', response.statusText);
+                updateSensorData();
+            }).catch(error => console.error('Error sending controller mode:', error));
+        });
+
+        let autotuneActive = false;
+        document.getElementById('autotuneButton').addEventListener('click', function() {
+            fetch('/autotune', {
+                method: 'POST',
+                headers: { 'Content-Type': 'application/x-www-form-urlencoded' },
+                body: 'action=' + (autotuneActive ? 'cancel' : 'start')
+            }).then(response => {
+                if (!response.ok) console.error('Error sending auto-tune request:', response.statusText);
+                updateSensorData();
+            }).catch(error => console.error('Error sending auto-tune request:', error));
+        });
+
+        function isLivePlot() {
+            return plotRangeMs <= PLOT_MAX_DURATION_MS;
+        }
+
+        // Mean line, plus the bucket minimum and maximum (dashed) on the longer ranges.
+        function chartSeries(title, data, band) {
+            if (isLivePlot()) return [{ name: title, data: data }];
+            return [{ name: title, data: data }, { name: 'Min', data: band.min }, { name: 'Max', data: band.max }];
+        }
+
+        function redrawCharts() {
+            if (tempChart && !isTempPlotPaused) tempChart.updateSeries(chartSeries('Temperature', tempData, tempBand));
+            if (pressureChart && !isPressurePlotPaused) pressureChart.updateSeries(chartSeries('Pressure', pressureData, pressureBand));
+        }
+
         function updatePlots(currentTemp, currentPressure) {
+            if (!isLivePlot()) return; // Refreshed from /history.bin
             const currentTime = Date.now();
 
             if (!isTempPlotPaused) {
                 tempData.push({ x: currentTime, y: currentTemp });
-                tempData = tempData.filter(p => currentTime - p.x <= PLOT_MAX_DURATION_MS + 2000);
-                if (tempChart) tempChart.updateSeries([{ data: tempData }]);
+                while (tempData.length && currentTime - tempData[0].x > PLOT_MAX_DURATION_MS + 2000) tempData.shift();
             }
 
             if (!isPressurePlotPaused) {
                 pressureData.push({ x: currentTime, y: currentPressure });
-                pressureData = pressureData.filter(p => currentTime - p.x <= PLOT_MAX_DURATION_MS + 2000);
-                if (pressureChart) pressureChart.updateSeries([{ data: pressureData }]);
+                while (pressureData.length && currentTime - pressureData[0].x > PLOT_MAX_DURATION_MS + 2000) pressureData.shift();
+            }
+
+            // Frames arrive at up to 20 Hz on the stream; redraw at most every CHART_REDRAW_MS
+            if (!chartRedrawPending) {
+                chartRedrawPending = true;
+                setTimeout(() => {
+                    chartRedrawPending = false;
+                    redrawCharts();
+                }, streamConnected ? CHART_REDRAW_MS : 0);
             }
         }
 
@@ -478,6 +803,8 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
             console.log("Plots reset.");
             tempData = [];
             pressureData = [];
+            tempBand = { min: [], max: [] };
+            pressureBand = { min: [], max: [] };
             isTempPlotPaused = false;
             isPressurePlotPaused = false;
             document.getElementById('tempChartPaused').classList.add('hidden');
@@ -490,50 +817,101 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
         function updateSensorData() {
             fetch('/data')
                 .then(response => response.json())
-                .then(data => {
-                    document.getElementById('temp').innerText = data.temperature.toFixed(1);
-                    document.getElementById('press').innerText = data.pressure.toFixed(1);
-                    document.getElementById('maxPress').innerText = data.max_observed_pressure.toFixed(1);
-
-                    let shotTimeDisplay = document.getElementById('shotTime');
-                    const newShotTimeText = data.shot_duration > 0 ? (data.shot_duration / 1000.0).toFixed(1) : '--.-';
-                    if (shotTimeDisplay.innerText !== newShotTimeText) {
-                        shotTimeDisplay.innerText = newShotTimeText;
-                    }
+                .then(applySensorData)
+                .catch(error => console.error('Error fetching data:', error));
+        }
 
-                    let relaySpan = document.getElementById('relay');
-                    relaySpan.innerText = data.relay_status;
-                    relaySpan.className = (data.relay_status === 'ON') ? 'text-green-400' : 'text-red-500';
+        // Shared by /data responses and stream frames (same field names). Frames carry
+        // early_cutoff_count instead of the one-shot early_cutoff_event flag.
+        function applySensorData(data) {
+            document.getElementById('temp').innerText = data.temperature.toFixed(1);
+            document.getElementById('press').innerText = data.pressure.toFixed(1);
+            document.getElementById('maxPress').innerText = data.max_observed_pressure.toFixed(1);
+
+            let shotTimeDisplay = document.getElementById('shotTime');
+            const newShotTimeText = data.shot_duration > 0 ? (data.shot_duration / 1000.0).toFixed(1) : '--.-';
+            if (shotTimeDisplay.innerText !== newShotTimeText) {
+                shotTimeDisplay.innerText = newShotTimeText;
+            }
 
-                    if (!sliderBeingDragged) {
-                        desiredTempDisplay.innerText = data.desired_temp.toFixed(1);
-                        desiredTempSlider.value = data.desired_temp.toFixed(1);
-                    }
+            let relaySpan = document.getElementById('relay');
+            relaySpan.innerText = data.relay_status;
+            relaySpan.className = (data.relay_status === 'ON') ? 'text-green-400' : 'text-red-500';
+            if (data.controller_mode !== 'burst') {
+                relaySpan.innerText += ' (' + Math.round(data.heater_duty * 100) + '%)';
+            }
+            if (data.safety && data.safety !== 'ok') {
+                relaySpan.innerText += ' SAFETY: ' + data.safety.replace('_', ' ');
+            }
 
-                    const wasTempPaused = isTempPlotPaused;
-                    isTempPlotPaused = data.is_temp_plot_paused;
-                    document.getElementById('tempChartPaused').classList.toggle('hidden', !isTempPlotPaused);
-                    if (wasTempPaused && !isTempPlotPaused) {
-                        console.log("Temp plot resumed on server. Resetting client plot.");
-                        resetPlots();
-                    }
+            autotuneActive = (data.autotune_status === 'waiting' || data.autotune_status === 'running');
+            document.getElementById('autotuneStatus').innerText = data.autotune_status;
+            let sensorSpan = document.getElementById('sensorHealth');
+            sensorSpan.innerText = data.sensor_health + ' (' + data.sensor_faults + ' faults)';
+            sensorSpan.className = (data.sensor_health === 'ok') ? 'text-green-400' : 'text-red-500';
+            document.getElementById('autotuneButton').innerText = autotuneActive ? 'Cancel' : 'Start';
 
-                    const wasPressurePaused = isPressurePlotPaused;
-                    isPressurePlotPaused = data.is_pressure_plot_paused;
-                    document.getElementById('pressureChartPaused').classList.toggle('hidden', !isPressurePlotPaused);
-                    if (wasPressurePaused && !isPressurePlotPaused) {
-                        console.log("Pressure plot resumed on server. Resetting client plot.");
-                        resetPlots();
-                    }
+            if (document.activeElement !== controllerModeSelect) {
+                controllerModeSelect.value = data.controller_mode;
+            }
 
-                    if (data.early_cutoff_event) {
-                        console.log("Early cutoff event received from server. Resetting plots.");
-                        resetPlots();
-                    }
-                    
-                    updatePlots(data.temperature, data.pressure);
-                })
-                .catch(error => console.error('Error fetching data:', error));
+            if (!sliderBeingDragged) {
+                desiredTempDisplay.innerText = data.desired_temp.toFixed(1);
+                desiredTempSlider.value = data.desired_temp.toFixed(1);
+            }
+
+            const wasTempPaused = isTempPlotPaused;
+            isTempPlotPaused = data.is_temp_plot_paused;
+            document.getElementById('tempChartPaused').classList.toggle('hidden', !isTempPlotPaused);
+            if (wasTempPaused && !isTempPlotPaused) {
+                console.log("Temp plot resumed on server. Resetting client plot.");
+                resetPlots();
+            }
+
+            const wasPressurePaused = isPressurePlotPaused;
+            isPressurePlotPaused = data.is_pressure_plot_paused;
+            document.getElementById('pressureChartPaused').classList.toggle('hidden', !isPressurePlotPaused);
+            if (wasPressurePaused && !isPressurePlotPaused) {
+                console.log("Pressure plot resumed on server. Resetting client plot.");
+                resetPlots();
+            }
+
+            let earlyCutoff = data.early_cutoff_event === true;
+            if (data.early_cutoff_count !== undefined) {
+                earlyCutoff = lastEarlyCutoffCount !== null && data.early_cutoff_count !== lastEarlyCutoffCount;
+                lastEarlyCutoffCount = data.early_cutoff_count;
+            }
+            if (earlyCutoff) {
+                console.log("Early cutoff event received from server. Resetting plots.");
+                resetPlots();
+            }
+            
+            updatePlots(data.temperature, data.pressure);
+        }
+
+        function setChartAnimations(enabled) {
+            const options = { chart: { animations: { enabled: enabled } } };
+            if (tempChart) tempChart.updateOptions(options, false, false);
+            if (pressureChart) pressureChart.updateOptions(options, false, false);
+        }
+
+        // Live frames over Server-Sent Events; EventSource reconnects by itself and the
+        // 2 s poll covers the gaps (and browsers or networks where port 81 is unreachable).
+        function connectStream() {
+            if (!window.EventSource) return;
+            const source = new EventSource('http://' + location.hostname + ':' + STREAM_PORT + '/');
+            source.onopen = () => {
+                streamConnected = true;
+                setChartAnimations(false);
+                console.log("Telemetry stream connected.");
+            };
+            source.onmessage = (event) => applySensorData(JSON.parse(event.data));
+            source.onerror = () => {
+                if (streamConnected) console.log("Telemetry stream lost, polling until it is back.");
+                streamConnected = false;
+                lastEarlyCutoffCount = null;
+                setChartAnimations(true);
+            };
         }
 
         document.getElementById('resetMaxPressureBtn').addEventListener('click', function() {
@@ -549,112 +927,859 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
                 .catch(error => console.error('Error sending reset max pressure request:', error));
         });
 
+        // Decodes a TelemetryFrame (lib/TelemetryFrame/src/TelemetryFrame.h, version 1) into
+        // { baseTimeMs, series: { id: [{ time, value }] } }. Times are device millis.
+        function decodeTelemetryFrame(buffer) {
+            const bytes = new Uint8Array(buffer);
+            let pos = 0;
+            const byte = () => {
+                if (pos >= bytes.length) throw new Error('Truncated telemetry frame');
+                return bytes[pos++];
+            };
+            const varint = () => {
+                let result = 0;
+                for (let shift = 0; shift < 35; shift += 7) {
+                    const b = byte();
+                    result += (b & 0x7f) * Math.pow(2, shift);
+                    if (!(b & 0x80)) return result;
+                }
+                throw new Error('Bad varint');
+            };
+            const zigzag = () => {
+                const n = varint();
+                return (n % 2) ? -(n + 1) / 2 : n / 2;
+            };
+            if (byte() !== 0x44 || byte() !== 0x54 || byte() !== 1) throw new Error('Not a version 1 telemetry frame');
+            byte(); // Flags
+            const baseTimeMs = new DataView(buffer, 4, 4).getUint32(0, true);
+            pos = 8;
+            const seriesCount = byte();
+            const series = {};
+            for (let s = 0; s < seriesCount; s++) {
+                const id = byte();
+                const scale = Math.pow(10, byte());
+                const count = varint();
+                const points = [];
+                let time = baseTimeMs;
+                for (let i = 0; i < count; i++) {
+                    time += zigzag();
+                    points.push({ time: time });
+                }
+                let quantized = 0;
+                for (let i = 0; i < count; i++) {
+                    quantized = (i === 0) ? zigzag() : quantized + zigzag();
+                    points[i].value = quantized / scale;
+                }
+                series[id] = points;
+            }
+            return { baseTimeMs: baseTimeMs, series: series };
+        }
+
+        const SERIES_TEMPERATURE = 1;
+        const SERIES_PRESSURE = 2;
+
+        const SERIES_TEMPERATURE_MIN = 3;
+        const SERIES_TEMPERATURE_MAX = 4;
+        const SERIES_PRESSURE_MIN = 5;
+        const SERIES_PRESSURE_MAX = 6;
+
         function fetchHistory() {
-            fetch('/history')
-                .then(response => response.json())
-                .then(data => {
+            fetch('/history.bin?span=' + plotRangeMs)
+                .then(response => response.arrayBuffer())
+                .then(buffer => {
+                    const frame = decodeTelemetryFrame(buffer);
                     const now = Date.now();
-                    tempData = data.temp_history.map(p => ({ x: now + p.time, y: p.value }));
-                    pressureData = data.pressure_history.map(p => ({ x: now + p.time, y: p.value }));
+                    const toPlot = p => ({ x: now + (p.time - frame.baseTimeMs), y: p.value });
+                    const series = id => (frame.series[id] || []).map(toPlot);
+                    tempData = series(SERIES_TEMPERATURE);
+                    pressureData = series(SERIES_PRESSURE);
+                    tempBand = { min: series(SERIES_TEMPERATURE_MIN), max: series(SERIES_TEMPERATURE_MAX) };
+                    pressureBand = { min: series(SERIES_PRESSURE_MIN), max: series(SERIES_PRESSURE_MAX) };
                     console.log("Fetched and processed historical data.");
-                    if (tempChart) tempChart.updateSeries([{ data: tempData }]);
-                    if (pressureChart) pressureChart.updateSeries([{ data: pressureData }]);
+                    redrawCharts();
                 })
                 .catch(error => console.error('Error fetching history:', error));
         }
 
+        document.getElementById('plotRange').addEventListener('change', function() {
+            plotRangeMs = parseInt(this.value);
+            const options = { xaxis: { range: plotRangeMs, labels: { format: isLivePlot() ? 'mm:ss' : 'HH:mm' } } };
+            if (tempChart) tempChart.updateOptions(options, false, false);
+            if (pressureChart) pressureChart.updateOptions(options, false, false);
+            fetchHistory();
+        });
+
         window.onload = function() {
             tempChart = createChart('tempChart', 'Temperature', '#f97316');
             pressureChart = createChart('pressureChart', 'Pressure', '#3b82f6');
             updateSensorData();
             fetchHistory();
+            connectStream();
         };
 
-        setInterval(updateSensorData, 2000);
+        setInterval(() => { if (!streamConnected) updateSensorData(); }, POLL_INTERVAL_MS);
+        setInterval(() => { if (!isLivePlot()) fetchHistory(); }, HISTORY_REFRESH_MS);
     </script>
 </body>
 </html>
 )rawliteral";
 
-// Function to update the status message on the OLED
+// Function to update the status message on the OLED (safe from any task)
 void updateOledStatus(const String& newMessage) {
-  oledStatusMessage = newMessage; // Allow full message, will be handled during display
+  oledStatusMailbox.post(newMessage.c_str()); // Truncated to the mailbox size, display trims further
 }
 
 void handleRoot() {
+  wakeFromStandby();
   server.send(200, "text/html", HTML_PAGE);
 }
 
+// --- Streaming JSON Responses ---
+// JSON handlers serialize with JsonWriter into one static buffer (handlers only run on the
+// network task). A response that fits the buffer goes out in one piece with a known length;
+// longer ones are streamed as HTTP chunks while they are being written.
+const size_t JSON_RESPONSE_BUFFER_SIZE = 1024;
+char jsonResponseBuffer[JSON_RESPONSE_BUFFER_SIZE];
+
+class WebServerJsonSink : public JsonSink {
+public:
+  WebServerJsonSink() : _streaming(false) {}
+
+  void write(const char* data, size_t length, bool final) override {
+    if (final && !_streaming) {
+      server.send_P(200, "application/json", data, length);
+      return;
+    }
+    if (!_streaming) {
+      server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+      server.send(200, "application/json", "");
+      _streaming = true;
+    }
+    if (length > 0) server.sendContent(data, length);
+    if (final) server.sendContent("", 0); // Terminating chunk
+  }
+
+private:
+  bool _streaming;
+};
+
+uint32_t totalSensorFaults(const ControlSnapshot& control) {
+  uint32_t total = 0;
+  for (int i = SENSOR_OK + 1; i < SENSOR_FAULT_COUNT; i++) {
+    total += control.sensorFaultCounts[i];
+  }
+  return total;
+}
+
+// Counts a pending early cutoff signal. The telemetry stream and /data both report from the
+// count, so neither consumes the event for the other.
+uint32_t pollEarlyCutoffEvents() {
+  if (web_early_cutoff_signal.exchange(false)) {
+    earlyCutoffEventCount++;
+  }
+  return earlyCutoffEventCount;
+}
+
 void handleData() {
-  String json = "{";
-  json += "\"temperature\":" + String(web_smoothedTempC, 1) + ",";
-  json += "\"pressure\":" + String(web_pressureBar, 1) + ",";
-  json += "\"max_observed_pressure\":" + String(maxObservedPressure, 1) + ",";
-  json += "\"relay_status\":\"" + String(web_isRelayOn ? "ON" : "OFF") + "\",";
-  json += "\"desired_temp\":" + String(web_desiredTempC, 1) + ",";
-  json += "\"shot_duration\":" + String(web_shotDuration_ms) + ",";
-  json += "\"presumed_off_threshold\":" + String(PRESUMED_OFF_TEMP_THRESHOLD_C, 1) + ",";
-  json += "\"is_temp_plot_paused\":" + String(web_isTempPlotPaused ? "true" : "false") + ",";
-  json += "\"is_pressure_plot_paused\":" + String(web_isPressurePlotPaused ? "true" : "false") + ",";
-  json += "\"early_cutoff_event\":" + String(web_early_cutoff_signal ? "true" : "false");
-  json += "}";
-  if (web_early_cutoff_signal) {
-    web_early_cutoff_signal = false; // Reset signal after sending
-  }
-  server.send(200, "application/json", json);
+  wakeFromStandby(); // The page polls /data while it has no stream
+  static uint32_t reportedEarlyCutoffEvents = 0;
+  ControlSnapshot control = controlSnapshot.read();
+  PressureSnapshot pressure = pressureSnapshot.read();
+  uint32_t earlyCutoffEvents = pollEarlyCutoffEvents();
+  bool earlyCutoffEvent = earlyCutoffEvents != reportedEarlyCutoffEvents; // Reported once
+  reportedEarlyCutoffEvents = earlyCutoffEvents;
+
+  WebServerJsonSink sink;
+  JsonWriter json(jsonResponseBuffer, sizeof(jsonResponseBuffer), sink);
+  json.beginObject();
+  json.field("temperature", control.smoothedTempC, 1);
+  json.field("temperature_rate", control.tempRateCPerS, 3);
+  json.field("pressure", pressure.pressureBar, 1);
+  json.field("max_observed_pressure", pressure.maxObservedPressure, 1);
+  json.field("relay_status", control.isRelayOn ? "ON" : "OFF");
+  json.field("desired_temp", control.desiredTempC, 1);
+  json.field("controller_mode", controlModeName(control.controlMode));
+  json.field("heater_duty", control.heaterDuty, 2);
+  json.field("safety", watchdogTripName(heaterWatchdog.trip()));
+  json.field("safety_trips", (unsigned long)heaterWatchdog.totalTrips());
+  json.field("sensor_health", sensorFaultName(control.sensorFault));
+  json.field("sensor_faults", (unsigned long)totalSensorFaults(control));
+  json.field("sensor_failed_reads", (unsigned long)control.sensorFailedReads);
+  json.field("sensor_rejected_reads", (unsigned long)control.sensorRejectedReads);
+  json.field("autotune_status", autoTuneStatusName(control.autoTuneStatus));
+  json.field("shot_duration", pressure.shotDuration_ms);
+  json.field("flow", pressure.flowMlPerS, 1);
+  json.field("shot_volume", pressure.shotVolumeMl, 1);
+  json.field("target_pressure", pressure.targetPressureBar, 1);
+  json.field("pump_power", pressure.pumpPowerPercent, 0);
+  json.field("pressure_capture_overruns", (unsigned long)pressure.captureOverruns);
+  json.field("presumed_off_threshold", heaterController.config().presumedOffTempThresholdC, 1);
+  json.field("is_temp_plot_paused", control.isTempPlotPaused);
+  json.field("is_pressure_plot_paused", pressure.isPressurePlotPaused);
+  json.field("early_cutoff_event", earlyCutoffEvent);
+  json.endObject();
+  json.finish();
 }
 
 void handleNotFound() {
   server.send(404, "text/plain", "Not found");
 }
 
+// --- Telemetry Stream ---
+// Socket wrapper for EventStreamHub: sends without blocking, 0 when the TCP send buffer is
+// full (the hub then skips frames for this viewer until it catches up).
+class WiFiClientTransport {
+public:
+  WiFiClientTransport() {}
+  explicit WiFiClientTransport(const WiFiClient& client) : _client(client) {}
+
+  int send(const char* data, size_t length) {
+    int sent = ::send(_client.fd(), data, length, MSG_DONTWAIT);
+    if (sent >= 0) return sent;
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+  }
+  void close() { _client.stop(); }
+
+private:
+  WiFiClient _client;
+};
+
+// Collects a JsonWriter result that has to fit its buffer in one piece.
+class FrameJsonSink : public JsonSink {
+public:
+  FrameJsonSink() : _length(0), _overflow(false) {}
+
+  void write(const char* data, size_t length, bool final) override {
+    (void)data; // Always the writer's own buffer
+    if (!final) _overflow = true;
+    _length = length;
+  }
+  size_t length() const { return _overflow ? 0 : _length; }
+
+private:
+  size_t _length;
+  bool _overflow;
+};
+
+const char TELEMETRY_STREAM_HEADER[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n"
+    "Access-Control-Allow-Origin: *\r\n" // The page is served from port 80
+    "\r\n"
+    "retry: 2000\n\n";
+const char TELEMETRY_STREAM_BUSY[] = "HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\n\r\n";
+
+EventStreamHub<WiFiClientTransport, TELEMETRY_MAX_CLIENTS, TELEMETRY_FRAME_CAPACITY> telemetryHub(TELEMETRY_STALL_TIMEOUT_MS);
+char telemetryFrame[TELEMETRY_FRAME_CAPACITY];
+unsigned long lastTelemetryFrameTime = 0;
+
+void acceptTelemetryClients(unsigned long currentMillis) {
+  WiFiClient client = telemetryServer.available();
+  if (!client) {
+    return;
+  }
+  client.setNoDelay(true); // Frames are small, send them right away
+  // The request itself is not parsed: every connection on this port gets the stream.
+  if (!telemetryHub.accept(WiFiClientTransport(client), TELEMETRY_STREAM_HEADER, sizeof(TELEMETRY_STREAM_HEADER) - 1, currentMillis)) {
+    client.write((const uint8_t*)TELEMETRY_STREAM_BUSY, sizeof(TELEMETRY_STREAM_BUSY) - 1);
+    client.stop();
+    Serial.println(F("Telemetry stream full, viewer refused."));
+  }
+}
+
+// One SSE event with the /data fields (plus the frame time "t" for latency measurements).
+// The early cutoff is sent as a running count: a viewer that skipped the frame with the
+// change still sees it in the next one.
+void publishTelemetryFrame(const ControlSnapshot& control, const PressureSnapshot& pressure, unsigned long currentMillis) {
+  static const char PREFIX[] = "data: ";
+  const size_t prefixLength = sizeof(PREFIX) - 1;
+  memcpy(telemetryFrame, PREFIX, prefixLength);
+
+  FrameJsonSink sink;
+  JsonWriter json(telemetryFrame + prefixLength, sizeof(telemetryFrame) - prefixLength - 2, sink);
+  json.beginObject();
+  json.field("t", currentMillis);
+  json.field("temperature", control.smoothedTempC, 1);
+  json.field("temperature_rate", control.tempRateCPerS, 3);
+  json.field("pressure", pressure.pressureBar, 2);
+  json.field("max_observed_pressure", pressure.maxObservedPressure, 1);
+  json.field("relay_status", control.isRelayOn ? "ON" : "OFF");
+  json.field("desired_temp", control.desiredTempC, 1);
+  json.field("controller_mode", controlModeName(control.controlMode));
+  json.field("heater_duty", control.heaterDuty, 2);
+  json.field("safety", watchdogTripName(heaterWatchdog.trip()));
+  json.field("safety_trips", (unsigned long)heaterWatchdog.totalTrips());
+  json.field("sensor_health", sensorFaultName(control.sensorFault));
+  json.field("sensor_faults", (unsigned long)totalSensorFaults(control));
+  json.field("autotune_status", autoTuneStatusName(control.autoTuneStatus));
+  json.field("shot_duration", pressure.shotDuration_ms);
+  json.field("flow", pressure.flowMlPerS, 2);
+  json.field("shot_volume", pressure.shotVolumeMl, 1);
+  json.field("target_pressure", pressure.targetPressureBar, 2);
+  json.field("pump_power", pressure.pumpPowerPercent, 0);
+  json.field("is_temp_plot_paused", control.isTempPlotPaused);
+  json.field("is_pressure_plot_paused", pressure.isPressurePlotPaused);
+  json.field("early_cutoff_count", (unsigned long)pollEarlyCutoffEvents());
+  json.endObject();
+  json.finish();
+
+  size_t length = sink.length();
+  if (length == 0) {
+    return; // Does not fit TELEMETRY_FRAME_CAPACITY
+  }
+  length += prefixLength;
+  telemetryFrame[length++] = '\n';
+  telemetryFrame[length++] = '\n';
+  telemetryHub.publish(telemetryFrame, length, currentMillis);
+}
+
+// Runs every network loop: new viewers, pending partial frames, and a frame when due.
+void serviceTelemetryStream(const ControlSnapshot& control, const PressureSnapshot& pressure, unsigned long currentMillis) {
+  acceptTelemetryClients(currentMillis);
+  telemetryHub.service(currentMillis);
+  if (telemetryHub.clientCount() > 0 && currentMillis - lastTelemetryFrameTime >= TELEMETRY_FRAME_INTERVAL_MS) {
+    lastTelemetryFrameTime = currentMillis;
+    publishTelemetryFrame(control, pressure, currentMillis);
+  }
+}
+
 // --- End Web Server Setup ---
 
+void clearHistory() {
+  tempHistory.clear();
+  pressureHistory.clear();
+}
+
 // --- Handler to Reset Max Pressure ---
 void handleResetMaxPressure() {
-  maxObservedPressure = 0.0f;
-  pressureMaxStabilityCount = 0;
-  pressureMaxStabilityIndex = 0;
-  
-  // Clear history data
-  tempHistoryCount = 0;
-  tempHistoryIndex = 0;
-  pressureHistoryCount = 0;
-  pressureHistoryIndex = 0;
+  maxPressureResetRequested = true; // Applied by the sensing task on its next cycle
+
+  // Clear history data (history is owned by the network task, which runs this handler)
+  clearHistory();
 
   Serial.println("Max observed pressure and history reset via WebUI.");
   server.send(200, "text/plain", "Max pressure and history reset.");
   updateOledStatus("Max/Hist Reset"); // Update OLED status
 }
 
+// Requested time range of /history and /history.bin: ?span=<ms> back from now, served from
+// the finest tier that covers it. Default: the 1 s tier.
+uint32_t historySpanArg() {
+  if (!server.hasArg("span")) return tempHistory.tier(0).spanMs();
+  uint32_t spanMs = strtoul(server.arg("span").c_str(), NULL, 10);
+  return spanMs > 0 ? spanMs : tempHistory.tier(0).spanMs();
+}
+
+// Points carry their bucket start time: include the bucket the range begins in.
+unsigned long historySince(unsigned long now_ms, uint32_t spanMs, const HistoryTier& tier) {
+  return now_ms - spanMs - tier.bucketMs();
+}
+
+// Writes the buckets of one tier newer than sinceMs, oldest first, with times as negative
+// offsets from now_ms.
+void writeHistory(JsonWriter& json, const HistoryTier& tier, unsigned long sinceMs, unsigned long now_ms) {
+  HistoryPoint point;
+  for (size_t i = 0; i < tier.size(); i++) {
+    if (!tier.point(i, point) || (long)(point.timeMs - sinceMs) <= 0) continue; // Wrap-safe "newer than"
+    json.beginObject();
+    json.field("time", (long)point.timeMs - (long)now_ms);
+    json.field("value", point.mean, 1);
+    json.field("min", point.min, 1);
+    json.field("max", point.max, 1);
+    json.endObject();
+  }
+}
+
 void handleHistory() {
-  String json = "{\"temp_history\":[";
+  wakeFromStandby();
+  unsigned long now_ms = millis();
+  uint32_t spanMs = historySpanArg();
+  const HistoryTier& tempTier = tempHistory.tierFor(spanMs);
+  const HistoryTier& pressureTier = pressureHistory.tierFor(spanMs);
+
+  WebServerJsonSink sink;
+  JsonWriter json(jsonResponseBuffer, sizeof(jsonResponseBuffer), sink);
+  json.beginObject();
+  json.field("resolution_ms", (unsigned long)tempTier.bucketMs());
+  json.beginArray("temp_history");
+  writeHistory(json, tempTier, historySince(now_ms, spanMs, tempTier), now_ms);
+  json.endArray();
+  json.beginArray("pressure_history");
+  writeHistory(json, pressureTier, historySince(now_ms, spanMs, pressureTier), now_ms);
+  json.endArray();
+  json.endObject();
+  json.finish();
+}
+
+// --- Binary History (/history.bin) ---
+// Same buckets as /history in the TelemetryFrame format (about 3 bytes per point instead of
+// ~28). Times are sent relative to the frame's base time (millis() when it was built).
+// Series: temperature and pressure means (ids 1, 2), then their bucket minimum and maximum
+// (ids 3-6). The bucket width is in the X-History-Resolution header (ms).
+// Optional ?span=<ms> (default 1 minute) and ?since=<device ms>: only points newer than
+// that, for incremental updates.
+const uint8_t HISTORY_TEMPERATURE_DECIMALS = 1;
+const uint8_t HISTORY_PRESSURE_DECIMALS = 2;
+const size_t HISTORY_MAX_TIER_POINTS = TieredHistory::MINUTE_BUCKETS + 1; // Closed + open bucket
+uint8_t historyFrameBuffer[TelemetryFrame::maxEncodedSize(6, 6 * HISTORY_MAX_TIER_POINTS)];
+
+enum HistoryField { HISTORY_MEAN, HISTORY_MIN, HISTORY_MAX };
+
+// Writes one field of the buckets of a tier newer than sinceMs, oldest first.
+void writeHistorySeries(TelemetryFrameEncoder& frame, uint8_t id, uint8_t decimals, const HistoryTier& tier,
+                        HistoryField field, unsigned long sinceMs) {
+  HistoryPoint point;
+  uint32_t count = 0;
+  for (size_t i = 0; i < tier.size(); i++) {
+    if (tier.point(i, point) && (long)(point.timeMs - sinceMs) > 0) count++; // Wrap-safe "newer than"
+  }
+  frame.beginSeries(id, decimals, count);
+  for (size_t i = 0; i < tier.size(); i++) {
+    if (tier.point(i, point) && (long)(point.timeMs - sinceMs) > 0) frame.time(point.timeMs);
+  }
+  for (size_t i = 0; i < tier.size(); i++) {
+    if (!tier.point(i, point) || (long)(point.timeMs - sinceMs) <= 0) continue;
+    frame.value(field == HISTORY_MEAN ? point.mean : (field == HISTORY_MIN ? point.min : point.max));
+  }
+}
+
+void handleHistoryBinary() {
+  wakeFromStandby();
   unsigned long now_ms = millis();
+  uint32_t spanMs = historySpanArg();
+  const HistoryTier& tempTier = tempHistory.tierFor(spanMs);
+  const HistoryTier& pressureTier = pressureHistory.tierFor(spanMs);
+  unsigned long sinceMs = historySince(now_ms, spanMs, tempTier);
+  if (server.hasArg("since")) {
+    sinceMs = strtoul(server.arg("since").c_str(), NULL, 10);
+  }
+
+  TelemetryFrameEncoder frame(historyFrameBuffer, sizeof(historyFrameBuffer), now_ms, 6);
+  writeHistorySeries(frame, TelemetryFrame::SERIES_TEMPERATURE, HISTORY_TEMPERATURE_DECIMALS, tempTier, HISTORY_MEAN, sinceMs);
+  writeHistorySeries(frame, TelemetryFrame::SERIES_PRESSURE, HISTORY_PRESSURE_DECIMALS, pressureTier, HISTORY_MEAN, sinceMs);
+  writeHistorySeries(frame, TelemetryFrame::SERIES_TEMPERATURE_MIN, HISTORY_TEMPERATURE_DECIMALS, tempTier, HISTORY_MIN, sinceMs);
+  writeHistorySeries(frame, TelemetryFrame::SERIES_TEMPERATURE_MAX, HISTORY_TEMPERATURE_DECIMALS, tempTier, HISTORY_MAX, sinceMs);
+  writeHistorySeries(frame, TelemetryFrame::SERIES_PRESSURE_MIN, HISTORY_PRESSURE_DECIMALS, pressureTier, HISTORY_MIN, sinceMs);
+  writeHistorySeries(frame, TelemetryFrame::SERIES_PRESSURE_MAX, HISTORY_PRESSURE_DECIMALS, pressureTier, HISTORY_MAX, sinceMs);
+  if (frame.overflow()) {
+    server.send(500, "text/plain", "History frame overflow.");
+    return;
+  }
+  server.sendHeader("X-History-Resolution", String(tempTier.bucketMs()));
+  server.send_P(200, "application/octet-stream", (const char*)historyFrameBuffer, frame.length());
+}
+
+// --- Shot Log ---
+// Every shot of at least SHOT_MIN_DURATION_MS is stored on LittleFS with its trace
+// (lib/ShotLog). The network task owns the store: it samples the snapshots while a shot
+// runs, adds the record when it ends and writes to flash only between shots (batched, see
+// ShotStore). Clock time comes from SNTP; shots before the first sync are stored with 0.
+//   GET  /shots?since=&until=&limit=  summaries, newest first (since/until: Unix time)
+//   GET  /shot.bin?id=N               trace as a TelemetryFrame (times from the shot start)
+//   POST /shots/delete?id=N
+const unsigned long SHOT_TRACE_INTERVAL_MS = 250;
+const unsigned long SHOT_MIN_DURATION_MS = 5000; // Shorter pressure blips (pump priming) are not logged
+const int SHOT_LIST_DEFAULT_LIMIT = 50;
+const char SHOT_DIRECTORY[] = "/shots";
+
+// One file per segment, /shots/<sequence as 8 hex digits>.seg. LittleFS commits an append
+// when the file is closed, so a power cut loses the batch, not the file.
+class LittleFsShotStorage : public ShotSegmentStorage {
+public:
+  size_t listSegments(uint32_t* sequences, size_t capacity) override {
+    size_t count = 0;
+    File directory = LittleFS.open(SHOT_DIRECTORY);
+    if (!directory || !directory.isDirectory()) return 0;
+    for (File file = directory.openNextFile(); file && count < capacity; file = directory.openNextFile()) {
+      char* end;
+      unsigned long sequence = strtoul(file.name(), &end, 16);
+      if (strcmp(end, ".seg") == 0) sequences[count++] = (uint32_t)sequence;
+    }
+    return count;
+  }
+
+  long segmentSize(uint32_t sequence) override {
+    char path[32];
+    segmentPath(sequence, path, sizeof(path));
+    if (!LittleFS.exists(path)) return -1;
+    File file = LittleFS.open(path, "r");
+    return file ? (long)file.size() : -1;
+  }
+
+  bool read(uint32_t sequence, uint32_t offset, uint8_t* data, size_t length) override {
+    char path[32];
+    segmentPath(sequence, path, sizeof(path));
+    File file = LittleFS.open(path, "r");
+    return file && file.seek(offset) && file.read(data, length) == length;
+  }
+
+  bool append(uint32_t sequence, const uint8_t* data, size_t length) override {
+    char path[32];
+    segmentPath(sequence, path, sizeof(path));
+    File file = LittleFS.open(path, "a");
+    return file && file.write(data, length) == length;
+  }
+
+  bool remove(uint32_t sequence) override {
+    char path[32];
+    segmentPath(sequence, path, sizeof(path));
+    return LittleFS.remove(path);
+  }
+
+private:
+  static void segmentPath(uint32_t sequence, char* path, size_t capacity) {
+    snprintf(path, capacity, "%s/%08lx.seg", SHOT_DIRECTORY, (unsigned long)sequence);
+  }
+};
+
+LittleFsShotStorage shotStorage;
+ShotStore shotStore(shotStorage);
+ShotRecorder shotRecorder(SHOT_TRACE_INTERVAL_MS);
+bool shotStoreReady = false;
+uint32_t shotStartTime = 0; // Unix time of the recorded shot, 0 if the clock was not set
+uint8_t shotRecordBuffer[ShotStore::MAX_RECORD_BYTES]; // Trace encoding and /shot.bin reads
+
+void setupShotStore() {
+  if (!LittleFS.begin(true)) { // Formats an unformatted partition
+    Serial.println(F("LittleFS mount failed, shot log disabled"));
+    return;
+  }
+  if (!LittleFS.exists(SHOT_DIRECTORY)) {
+    LittleFS.mkdir(SHOT_DIRECTORY);
+  }
+  size_t shots = shotStore.begin();
+  shotStoreReady = true;
+  Serial.printf("Shot log: %u shots, %lu bytes in %u segments", (unsigned)shots, shotStore.storedBytes(),
+                (unsigned)shotStore.segmentCount());
+  if (shotStore.damagedRecords() > 0) {
+    Serial.printf(", %lu damaged tails skipped", shotStore.damagedRecords());
+  }
+  Serial.println();
+}
+
+// Runs every network loop: trace while a shot runs, record when it ends, flash writes
+// (and the power-off flush) only in between.
+void recordShots(const ControlSnapshot& control, const PressureSnapshot& pressure, unsigned long currentMillis) {
+  if (!shotStoreReady) return;
+  if (pressure.isShotRunning) {
+    if (!shotRecorder.recording()) {
+      shotRecorder.start(currentMillis);
+      time_t now = time(NULL);
+      shotStartTime = now >= MIN_VALID_EPOCH ? (uint32_t)now : 0;
+    }
+    shotRecorder.update(currentMillis, (float)control.smoothedTempC, pressure.pressureBar, pressure.flowMlPerS,
+                        pressure.shotVolumeMl);
+    return;
+  }
+
+  if (shotRecorder.recording()) {
+    shotRecorder.reset();
+    if (pressure.shotDuration_ms < SHOT_MIN_DURATION_MS) return;
+    ShotSummary summary;
+    summary.startTime = shotStartTime;
+    summary.durationMs = pressure.shotDuration_ms;
+    summary.maxPressureBar = pressure.maxObservedPressure;
+    summary.startTempC = shotRecorder.startTemperatureC();
+    summary.traceBytes = shotRecorder.encode(shotRecordBuffer, ShotStore::MAX_TRACE_BYTES);
+    if (shotStore.add(summary, shotRecordBuffer, currentMillis)) {
+      Serial.printf("Shot %lu logged: %.1f s, %u samples, %lu trace bytes\n", (unsigned long)summary.id,
+                    summary.durationMs / 1000.0, (unsigned)shotRecorder.sampleCount(), (unsigned long)summary.traceBytes);
+    } else {
+      Serial.println(F("Shot log: record not stored"));
+    }
+    return;
+  }
+
+  if (control.machineIsPresumedOff) {
+    shotStore.flush(); // Machine switched off: the ESP32 may be next
+  } else {
+    shotStore.service(currentMillis);
+  }
+}
+
+void handleShots() {
+  if (!shotStoreReady) {
+    server.send(503, "text/plain", "Shot log unavailable.");
+    return;
+  }
+  unsigned long since = server.hasArg("since") ? strtoul(server.arg("since").c_str(), NULL, 10) : 0;
+  unsigned long until = server.hasArg("until") ? strtoul(server.arg("until").c_str(), NULL, 10) : 0xFFFFFFFFUL;
+  int limit = server.hasArg("limit") ? atoi(server.arg("limit").c_str()) : SHOT_LIST_DEFAULT_LIMIT;
+
+  WebServerJsonSink sink;
+  JsonWriter json(jsonResponseBuffer, sizeof(jsonResponseBuffer), sink);
+  json.beginObject();
+  json.field("count", (unsigned long)shotStore.count());
+  json.field("stored_bytes", shotStore.storedBytes());
+  json.field("pending_bytes", (unsigned long)shotStore.pendingBytes());
+  json.beginArray("shots");
+  for (size_t i = shotStore.count(); i > 0 && limit > 0; i--) {
+    ShotSummary summary;
+    shotStore.summaryAt(i - 1, summary);
+    if (summary.startTime < since || summary.startTime > until) continue;
+    json.beginObject();
+    json.field("id", (unsigned long)summary.id);
+    json.field("time", (unsigned long)summary.startTime);
+    json.field("duration_ms", (unsigned long)summary.durationMs);
+    json.field("max_pressure", summary.maxPressureBar, 2);
+    json.field("start_temp", summary.startTempC, 1);
+    json.field("trace_bytes", (unsigned long)summary.traceBytes);
+    json.endObject();
+    limit--;
+  }
+  json.endArray();
+  json.endObject();
+  json.finish();
+}
 
-  // Add temperature history, from oldest to newest
-  for (int i = 0; i < tempHistoryCount; i++) {
-    int index = (tempHistoryIndex - tempHistoryCount + i + HISTORY_SIZE) % HISTORY_SIZE;
-    // Send time as a negative offset from the current time
-    long time_offset = (long)tempHistory[index].time_ms - (long)now_ms;
-    json += "{\"time\":" + String(time_offset) + ",\"value\":" + String(tempHistory[index].value, 1) + "}";
-    if (i < tempHistoryCount - 1) {
-      json += ",";
+void handleShotTrace() {
+  uint32_t id = strtoul(server.arg("id").c_str(), NULL, 10);
+  size_t length = shotStoreReady ? shotStore.readTrace(id, shotRecordBuffer, sizeof(shotRecordBuffer)) : 0;
+  if (length == 0) {
+    server.send(404, "text/plain", "No such shot.");
+    return;
+  }
+  server.send_P(200, "application/octet-stream", (const char*)shotRecordBuffer, length);
+}
+
+// --- Shot Capture Download (/capture.csv) ---
+// The last completed 50 Hz capture as CSV: time relative to the shot timer start (negative
+// in the pre-trigger window) and pressure. Written in chunks straight from the capture bank;
+// if a newer capture completed meanwhile the bank may have been reused, which is noted at
+// the end of the file.
+const char CAPTURE_OVERWRITTEN_NOTE[] = "# overwritten by a newer shot during download\n";
+const size_t CAPTURE_LINE_MAX = 24; // "-2147483648,-327.68\n" and its terminator
+
+// Bytes snprintf() stored in a buffer of `room` bytes: its return value is the length it
+// wanted to write, which is more than it wrote when the output was cut short.
+size_t snprintfStored(int written, size_t room) {
+  if (written < 0 || room == 0) return 0;
+  return (size_t)written < room ? (size_t)written : room - 1;
+}
+
+void handleShotCapture() {
+  ShotCaptureTrace trace = shotCaptureSnapshot.read();
+  if (trace.generation == 0) {
+    server.send(404, "text/plain", "No shot captured yet.");
+    return;
+  }
+  server.sendHeader("Content-Disposition", "attachment; filename=\"shot-capture.csv\"");
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "text/csv", "");
+
+  char chunk[512];
+  int written = snprintf(chunk, sizeof(chunk),
+                         "# capture %lu: %lu ms per sample, %lu before the trigger, %lu held, truncated: %s\n"
+                         "time_ms,pressure_bar\n",
+                         (unsigned long)trace.generation, (unsigned long)trace.samplePeriodMs,
+                         (unsigned long)trace.preTriggerCount, (unsigned long)trace.heldSamples,
+                         trace.truncated ? "yes" : "no");
+  size_t length = snprintfStored(written, sizeof(chunk));
+  for (uint32_t i = 0; i < trace.count; i++) {
+    if (sizeof(chunk) - length < CAPTURE_LINE_MAX) {
+      server.sendContent(chunk, length);
+      length = 0;
+    }
+    long timeMs = ((long)i - (long)trace.preTriggerCount) * (long)trace.samplePeriodMs;
+    size_t room = sizeof(chunk) - length;
+    written = snprintf(chunk + length, room, "%ld,%.2f\n", timeMs, trace.centibar[i] / 100.0f);
+    length += snprintfStored(written, room);
+  }
+  server.sendContent(chunk, length);
+  if (shotCaptureSnapshot.read().generation != trace.generation) {
+    server.sendContent(CAPTURE_OVERWRITTEN_NOTE, sizeof(CAPTURE_OVERWRITTEN_NOTE) - 1);
+  }
+  server.sendContent("", 0); // Terminating chunk
+}
+
+// --- Network Job Statistics (/jobs) ---
+// Per job of the network task: period, runs, skipped periods, lateness (ms) and runtime
+// (us) since boot or the last ?reset=1.
+void handleJobs() {
+  WebServerJsonSink sink;
+  JsonWriter json(jsonResponseBuffer, sizeof(jsonResponseBuffer), sink);
+  json.beginObject();
+  json.field("standby", networkStandby);
+  json.field("cpu_mhz", (unsigned long)getCpuFrequencyMhz());
+  json.field("standby_entries", (unsigned long)standbyPolicy.entries());
+  json.field("standby_web_wakes", (unsigned long)standbyPolicy.webWakes());
+  json.beginArray("jobs");
+  for (size_t i = 0; i < networkJobs.jobCount(); i++) {
+    const JobStats& stats = networkJobs.stats((uint8_t)i);
+    json.beginObject();
+    json.field("name", networkJobs.name((uint8_t)i));
+    json.field("period_ms", (unsigned long)networkJobs.period((uint8_t)i));
+    json.field("runs", (unsigned long)stats.runs);
+    json.field("skipped", (unsigned long)stats.skipped);
+    json.field("late_max_ms", (unsigned long)stats.maxLatenessMs);
+    json.field("late_mean_ms", stats.runs ? (double)stats.totalLatenessMs / stats.runs : 0.0, 2);
+    json.field("run_max_us", (unsigned long)stats.maxRuntimeUs);
+    json.field("run_mean_us", stats.runs ? (double)stats.totalRuntimeUs / stats.runs : 0.0, 1);
+    json.endObject();
+  }
+  json.endArray();
+  json.endObject();
+  json.finish();
+  if (server.arg("reset") == "1") networkJobs.resetStats(); // Handlers run inside the web job
+}
+
+// --- Metrics (/metrics) ---
+// Collects the metrics text in a chunk and sends it whenever it fills up (chunked response).
+class WebServerMetricsSink : public MetricsSink {
+public:
+  WebServerMetricsSink() : _length(0) {
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/plain; version=0.0.4", "");
+  }
+
+  void write(const char* data, size_t length) override {
+    if (_length + length > sizeof(_chunk)) flush();
+    memcpy(_chunk + _length, data, length);
+    _length += length;
+  }
+
+  void finish() {
+    flush();
+    server.sendContent("", 0); // Terminating chunk
+  }
+
+private:
+  void flush() {
+    if (_length > 0) server.sendContent(_chunk, _length);
+    _length = 0;
+  }
+
+  char _chunk[512];
+  size_t _length;
+};
+
+// One sample per network job, labelled by job name.
+void writeJobMetric(MetricsSink& sink, const char* name, const char* type, const char* help, bool lateness) {
+  char line[128];
+  int length = snprintf(line, sizeof(line), "# HELP %s%s %s\n# TYPE %s%s %s\n", METRICS_PREFIX, name, help,
+                        METRICS_PREFIX, name, type);
+  sink.write(line, length);
+  for (size_t i = 0; i < networkJobs.jobCount(); i++) {
+    const JobStats& stats = networkJobs.stats((uint8_t)i);
+    if (lateness) {
+      length = snprintf(line, sizeof(line), "%s%s{job=\"%s\"} %.3f\n", METRICS_PREFIX, name, networkJobs.name((uint8_t)i),
+                        stats.maxLatenessMs / 1000.0);
+    } else {
+      length = snprintf(line, sizeof(line), "%s%s{job=\"%s\"} %lu\n", METRICS_PREFIX, name, networkJobs.name((uint8_t)i),
+                        (unsigned long)stats.skipped);
     }
+    sink.write(line, length);
+  }
+}
+
+// Thermocouple faults since boot, labelled by fault, and the readings rejected on the way.
+void writeSensorHealthMetrics(MetricsSink& sink) {
+  ControlSnapshot control = controlSnapshot.read();
+  char line[160];
+  int length = snprintf(line, sizeof(line),
+                        "# HELP %sthermocouple_faults_total Thermocouple faults that put the heater in degraded mode.\n# TYPE %sthermocouple_faults_total counter\n",
+                        METRICS_PREFIX, METRICS_PREFIX);
+  sink.write(line, length);
+  for (int i = SENSOR_OK + 1; i < SENSOR_FAULT_COUNT; i++) {
+    length = snprintf(line, sizeof(line), "%sthermocouple_faults_total{fault=\"%s\"} %lu\n", METRICS_PREFIX,
+                      sensorFaultName((SensorFault)i), (unsigned long)control.sensorFaultCounts[i]);
+    sink.write(line, length);
   }
-  json += "],\"pressure_history\":[";
+  writePrometheusMetric(sink, METRICS_PREFIX, "thermocouple_failed_reads_total", "counter",
+                        "Thermocouple reads that returned no value.", control.sensorFailedReads);
+  writePrometheusMetric(sink, METRICS_PREFIX, "thermocouple_rejected_reads_total", "counter",
+                        "Thermocouple readings ignored as out of range, jumps or too fast.", control.sensorRejectedReads);
+}
+
+// Safety watchdog trips since boot, labelled by reason.
+void writeWatchdogMetric(MetricsSink& sink) {
+  char line[160];
+  int length = snprintf(line, sizeof(line),
+                        "# HELP %swatchdog_trips_total Relay forced off by the safety watchdog.\n# TYPE %swatchdog_trips_total counter\n",
+                        METRICS_PREFIX, METRICS_PREFIX);
+  sink.write(line, length);
+  for (int i = WATCHDOG_OK + 1; i < WATCHDOG_TRIP_COUNT; i++) {
+    WatchdogTrip reason = (WatchdogTrip)i;
+    length = snprintf(line, sizeof(line), "%swatchdog_trips_total{reason=\"%s\"} %lu\n", METRICS_PREFIX,
+                      watchdogTripName(reason), (unsigned long)heaterWatchdog.tripCount(reason));
+    sink.write(line, length);
+  }
+}
 
-  // Add pressure history, from oldest to newest
-  for (int i = 0; i < pressureHistoryCount; i++) {
-    int index = (pressureHistoryIndex - pressureHistoryCount + i + HISTORY_SIZE) % HISTORY_SIZE;
-    long time_offset = (long)pressureHistory[index].time_ms - (long)now_ms;
-    json += "{\"time\":" + String(time_offset) + ",\"value\":" + String(pressureHistory[index].value, 1) + "}";
-    if (i < pressureHistoryCount - 1) {
-      json += ",";
+// Prometheus text format: stage histograms and maxima, task loop intervals (loop rates are
+// the rate of the *_loop stage counts), heap, capture overruns, watchdog trips, thermocouple
+// faults and network job lateness.
+// ?reset=1 clears the stage statistics after this response.
+void handleMetrics() {
+  WebServerMetricsSink sink;
+  stageMetrics.writePrometheus(sink, METRICS_PREFIX);
+  writePrometheusMetric(sink, METRICS_PREFIX, "uptime_seconds", "counter", "Time since boot.", millis() / 1000.0);
+  writePrometheusMetric(sink, METRICS_PREFIX, "heap_free_bytes", "gauge", "Free heap.", ESP.getFreeHeap());
+  writePrometheusMetric(sink, METRICS_PREFIX, "heap_min_free_bytes", "gauge", "Lowest free heap since boot.",
+                        ESP.getMinFreeHeap());
+  writePrometheusMetric(sink, METRICS_PREFIX, "heap_largest_free_block_bytes", "gauge",
+                        "Largest allocatable heap block.", ESP.getMaxAllocHeap());
+  writePrometheusMetric(sink, METRICS_PREFIX, "pressure_capture_overruns_total", "counter",
+                        "Pressure DMA buffers lost because the sensing task fell behind.",
+                        pressureSnapshot.read().captureOverruns);
+  writeWatchdogMetric(sink);
+  writeSensorHealthMetrics(sink);
+  writeJobMetric(sink, "job_late_max_seconds", "gauge", "Latest start of each network job after its deadline.", true);
+  writeJobMetric(sink, "job_skipped_total", "counter", "Periods a network job missed.", false);
+  sink.finish();
+  if (server.arg("reset") == "1") stageMetrics.requestReset();
+}
+
+// Compact summary on Serial: loop rates and worst intervals, heap, then one line per stage
+// with the mean, max and the 99th percentile bucket bound.
+void metricsSerialJob(uint32_t nowMs) {
+  static uint32_t lastLoopCounts[STAGE_COUNT];
+  static uint32_t lastMs = 0;
+  static bool started = false;
+  float seconds = (nowMs - lastMs) / 1000.0f;
+  lastMs = nowMs;
+  if (!started) { // First run at boot: only take the loop counts
+    started = true;
+    for (int i = 0; i <= LAST_LOOP_STAGE; i++) {
+      StageStats stats;
+      stageMetrics.read((uint8_t)i, stats);
+      lastLoopCounts[i] = stats.count;
     }
+    return;
+  }
+
+  Serial.print("Metrics:");
+  for (int i = 0; i <= LAST_LOOP_STAGE; i++) {
+    StageStats stats;
+    stageMetrics.read((uint8_t)i, stats);
+    uint32_t loops = stats.count >= lastLoopCounts[i] ? stats.count - lastLoopCounts[i] : stats.count; // Reset
+    lastLoopCounts[i] = stats.count;
+    Serial.printf(" %s %.1f Hz (max %.1f ms),", METRIC_STAGE_NAMES[i], loops / seconds,
+                  stageMetrics.toMicros(stats.maxIntervalCycles) / 1000.0);
   }
-  json += "]}";
+  Serial.printf(" heap %lu free, %lu largest, %lu min\n", (unsigned long)ESP.getFreeHeap(),
+                (unsigned long)ESP.getMaxAllocHeap(), (unsigned long)ESP.getMinFreeHeap());
+  for (int i = 0; i < STAGE_COUNT; i++) {
+    StageStats stats;
+    stageMetrics.read((uint8_t)i, stats);
+    if (stats.count == 0) continue;
+    uint32_t p99 = stageMetrics.quantileBoundUs(stats, 0.99);
+    Serial.printf("  %-17s n=%lu mean=%.0fus max=%.0fus p99", METRIC_STAGE_NAMES[i], (unsigned long)stats.count,
+                  stageMetrics.toMicros(stats.totalCycles) / stats.count, stageMetrics.toMicros(stats.maxCycles));
+    if (p99 == UINT32_MAX) Serial.println(">262ms");
+    else Serial.printf("<=%luus\n", (unsigned long)p99);
+  }
+}
 
-  server.send(200, "application/json", json);
+void handleShotDelete() {
+  uint32_t id = strtoul(server.arg("id").c_str(), NULL, 10);
+  if (!shotStoreReady || !shotStore.remove(id)) {
+    server.send(404, "text/plain", "No such shot.");
+    return;
+  }
+  server.send(200, "text/plain", "Shot deleted.");
 }
 
 
@@ -666,63 +1791,83 @@ void handleHistory() {
 // SCL -> GPIO22
 Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, -1);
 
-// Comparison function for qsort
-int compareIntegers(const void *a, const void *b) {
-  return (*(int*)a - *(int*)b);
-}
+// --- OLED View ---
+// OledView draws through Adafruit_GFX into the display buffer and sends only the touched
+// window (columns x pages) instead of display()'s full 1 KB frame.
+class Ssd1306Canvas : public OledCanvas {
+public:
+  explicit Ssd1306Canvas(Adafruit_SSD1306& display) : _display(display) {}
 
-// Function to get a stable ADC reading by sampling, sorting, and averaging
-int getStableAdcValue() {
-  if (PRESSURE_RAW_SAMPLES_COUNT < (2 * PRESSURE_SAMPLES_TO_DISCARD_EACH_END + 1)) {
-    // Not enough samples to discard and average, return a single reading
-    return analogRead(pressureSensorPin);
+  void fillRect(int16_t x, int16_t y, int16_t width, int16_t height, bool on) override {
+    _display.fillRect(x, y, width, height, on ? SSD1306_WHITE : SSD1306_BLACK);
   }
 
-  for (int i = 0; i < PRESSURE_RAW_SAMPLES_COUNT; i++) {
-    pressureAdcSampleReadings[i] = analogRead(pressureSensorPin);
+  void drawChar(int16_t x, int16_t y, char c, uint8_t size) override {
+    _display.drawChar(x, y, c, SSD1306_WHITE, SSD1306_BLACK, size);
   }
 
-  qsort(pressureAdcSampleReadings, PRESSURE_RAW_SAMPLES_COUNT, sizeof(int), compareIntegers);
-  // std::sort(pressureAdcSampleReadings, pressureAdcSampleReadings + PRESSURE_RAW_SAMPLES_COUNT); // Alternative using algorithm header
-
-  long sum = 0;
-  int samplesToAverage = 0;
-  for (int i = PRESSURE_SAMPLES_TO_DISCARD_EACH_END; i < PRESSURE_RAW_SAMPLES_COUNT - PRESSURE_SAMPLES_TO_DISCARD_EACH_END; i++) {
-    sum += pressureAdcSampleReadings[i];
-    samplesToAverage++;
+  size_t flushWindow(uint8_t column0, uint8_t column1, uint8_t page0, uint8_t page1) override {
+    Wire.setClock(OLED_I2C_CLOCK_HZ); // Adafruit_SSD1306 drops the clock to 100 kHz after its own transfers
+    Wire.beginTransmission(OLED_I2C_ADDRESS);
+    Wire.write((uint8_t)0x00); // Command stream
+    Wire.write((uint8_t)SSD1306_PAGEADDR);
+    Wire.write(page0);
+    Wire.write(page1);
+    Wire.write((uint8_t)SSD1306_COLUMNADDR);
+    Wire.write(column0);
+    Wire.write(column1);
+    Wire.endTransmission();
+    size_t busBytes = 8;
+
+    // Horizontal addressing: the controller walks the window column by column, page by page
+    const uint8_t* buffer = _display.getBuffer();
+    size_t columns = column1 - column0 + 1;
+    for (uint8_t page = page0; page <= page1; page++) {
+      const uint8_t* data = buffer + (size_t)page * SCREEN_WIDTH + column0;
+      for (size_t sent = 0; sent < columns; sent += OLED_I2C_CHUNK_BYTES) {
+        size_t chunk = columns - sent < OLED_I2C_CHUNK_BYTES ? columns - sent : OLED_I2C_CHUNK_BYTES;
+        Wire.beginTransmission(OLED_I2C_ADDRESS);
+        Wire.write((uint8_t)0x40); // Data stream
+        Wire.write(data + sent, chunk);
+        Wire.endTransmission();
+        busBytes += 2 + chunk;
+      }
+    }
+    return busBytes;
   }
 
-  if (samplesToAverage == 0) return analogRead(pressureSensorPin); // Fallback
-  return sum / samplesToAverage;
+private:
+  Adafruit_SSD1306& _display;
+};
+
+Ssd1306Canvas oledCanvas(display);
+OledView oledView(oledCanvas, SCREEN_WIDTH, SCREEN_HEIGHT, 3, OLED_FRAME_INTERVAL_MS, OLED_MAX_BYTES_PER_FRAME);
+int oledTemperatureField, oledSetPointField, oledPressureField, oledMaxPressureField;
+int oledShotTimeField, oledStatusField, oledClockField, oledWeatherField;
+
+// Field layout in rotated coordinates (64 x 128): the former line-by-line layout, with
+// the clock and the outside temperature on their own lines instead of wrapping.
+void setupOledView() {
+  const int16_t width = SCREEN_HEIGHT; // Rotated
+  oledTemperatureField = oledView.addField({0, 0, width, 16, 2, "C"});
+  oledSetPointField = oledView.addField({0, 22, width, 8, 1, nullptr});
+  oledPressureField = oledView.addField({0, 36, width, 16, 2, "bar"});
+  oledMaxPressureField = oledView.addField({0, 58, width, 8, 1, nullptr});
+  oledShotTimeField = oledView.addField({0, 72, width, 16, 2, "s"});
+  oledStatusField = oledView.addField({0, 94, width, 8, 1, nullptr});
+  oledClockField = oledView.addField({0, 106, width, 8, 1, nullptr});
+  oledWeatherField = oledView.addField({0, 114, width, 8, 1, nullptr});
 }
+
 void handleSetTemp() {
   if (server.hasArg("temp")) {
     String tempStr = server.arg("temp");
     double newTemp = tempStr.toDouble();
     // Add validation for temperature range, e.g., 70 to 100 C
     if (newTemp >= 70.0 && newTemp <= 100.0) {
-      desiredTemperatureC = newTemp;
-      web_desiredTempC = newTemp; // Update for /data endpoint
-      if (consecutiveFailedHeatingAttempts > 0) {
-        Serial.println("User set new temp, consecutive heating failures reset.");
-      }
-      consecutiveFailedHeatingAttempts = 0; // Reset on user temp change
-      Serial.print("Desired temperature set to: ");
-      Serial.println(desiredTemperatureC, 1);
-
-      // If user sets a new active temperature while in standby, exit standby.
-      if (machineIsPresumedOff && newTemp >= PRESUMED_OFF_TEMP_THRESHOLD_C) {
-        machineIsPresumedOff = false;
-        isMonitoringForMachineOff = false; // Ensure this is also reset
-        Serial.println("User set new active temperature. Exiting machine presumed off standby.");
-        updateOledStatus("User: Active Temp");
-      }
-      // If user sets a low temperature while monitoring, stop monitoring.
-      if (isMonitoringForMachineOff && newTemp < PRESUMED_OFF_TEMP_THRESHOLD_C) {
-        isMonitoringForMachineOff = false;
-        Serial.println("User set low temperature. Stopped monitoring for presumed machine off.");
-        updateOledStatus("User: Low Temp Set");
-      }
+      // Hand the new set point to the control task, which owns desiredTemperatureC
+      requestedDesiredTempC = (float)newTemp;
+      desiredTempChangeRequested = true;
       server.send(200, "text/plain", "OK");
     } else {
       Serial.println("Invalid temperature value received.");
@@ -733,19 +1878,444 @@ void handleSetTemp() {
   }
 }
 
-void handleWiFiConnection() {
-  unsigned long currentMillis = millis();
+void handleSetController() {
+  ControlMode mode;
+  if (!server.hasArg("mode")) {
+    server.send(400, "text/plain", "Missing mode parameter.");
+  } else if (!parseControlMode(server.arg("mode").c_str(), mode)) {
+    Serial.println("Invalid controller mode received.");
+    server.send(400, "text/plain", "Invalid mode. Must be burst, pid or mpc.");
+  } else {
+    requestedControlMode = mode; // Applied by the control task
+    controlModeChangeRequested = true;
+    server.send(200, "text/plain", "OK");
+  }
+}
 
-  switch (currentWiFiState) {
-    case WIFI_DISCONNECTED:
-      // Try to connect only if WIFI_RETRY_DELAY_MS has passed since last attempt
-      if (currentMillis - wifiLastRetryTime >= WIFI_RETRY_DELAY_MS) {
-        Serial.println(F("Attempting WiFi connection..."));
-        updateOledStatus("WiFi Connecting...");
-        WiFi.mode(WIFI_STA); // Ensure STA mode
-        WiFi.begin(ssid, password);
-        wifiConnectStartTime = currentMillis;
-        currentWiFiState = WIFI_CONNECTING;
+// --- Thermal Model Persistence (NVS) ---
+const char* THERMAL_MODEL_NAMESPACE = "thermal";
+
+void loadThermalModel() {
+  Preferences preferences;
+  ThermalModelSnapshot thermal;
+  thermal.model = heaterController.thermalModel();
+  thermal.identified = false;
+  if (preferences.begin(THERMAL_MODEL_NAMESPACE, true)) {
+    if (preferences.isKey("gain") && preferences.isKey("tau") && preferences.isKey("dead")) {
+      thermal.model.gainC = preferences.getFloat("gain");
+      thermal.model.timeConstantS = preferences.getFloat("tau");
+      thermal.model.deadTimeS = preferences.getFloat("dead");
+      thermal.identified = thermal.model.gainC > 0 && thermal.model.timeConstantS > 0;
+    }
+    preferences.end();
+  }
+  if (thermal.identified) {
+    heaterController.setThermalModel(thermal.model); // Tasks are not running yet
+    Serial.println("Loaded auto-tuned thermal model from NVS.");
+  }
+  thermalModelSnapshot.publish(thermal);
+}
+
+void saveThermalModel(const ThermalModel& model) {
+  Preferences preferences;
+  if (!preferences.begin(THERMAL_MODEL_NAMESPACE, false)) {
+    Serial.println("NVS: could not open thermal model namespace.");
+    return;
+  }
+  preferences.putFloat("gain", model.gainC);
+  preferences.putFloat("tau", model.timeConstantS);
+  preferences.putFloat("dead", model.deadTimeS);
+  preferences.end();
+  Serial.println("Auto-tuned thermal model saved to NVS.");
+}
+
+void clearThermalModel() {
+  Preferences preferences;
+  if (preferences.begin(THERMAL_MODEL_NAMESPACE, false)) {
+    preferences.clear();
+    preferences.end();
+  }
+  Serial.println("Thermal model cleared from NVS.");
+  updateOledStatus("Model Reset");
+}
+
+// --- Sensor Calibration (NVS, /calibration) ---
+// Each curve is one blob. A blob of another size (older layout) or one that no longer fits
+// is ignored and the default curve applies.
+const char* CALIBRATION_NAMESPACE = "calibration";
+const char* TEMPERATURE_CURVE_KEY = "temp";
+const char* PRESSURE_CURVE_KEY = "pressure";
+const int DEFAULT_POLYNOMIAL_DEGREE = 2;
+
+bool readCalibrationCurve(Preferences& preferences, const char* key, CalibrationCurve& curve) {
+  CalibrationCurve stored;
+  if (preferences.getBytesLength(key) != sizeof(stored)) return false;
+  if (preferences.getBytes(key, &stored, sizeof(stored)) != sizeof(stored)) return false;
+  CalibrationFunction function;
+  if (!function.fit(stored)) return false;
+  curve = stored;
+  return true;
+}
+
+void loadCalibration() {
+  CalibrationCurve temperatureCurve = DEFAULT_TEMPERATURE_CURVE;
+  CalibrationCurve pressureCurve = DEFAULT_PRESSURE_CURVE;
+  Preferences preferences;
+  if (preferences.begin(CALIBRATION_NAMESPACE, true)) {
+    if (readCalibrationCurve(preferences, TEMPERATURE_CURVE_KEY, temperatureCurve)) {
+      temperatureCalibration.load(temperatureCurve); // Tasks are not running yet
+      Serial.println("Loaded temperature calibration from NVS.");
+    }
+    if (readCalibrationCurve(preferences, PRESSURE_CURVE_KEY, pressureCurve)) {
+      pressureScale.load(pressureCurve);
+      Serial.println("Loaded pressure calibration from NVS.");
+    }
+    preferences.end();
+  }
+  temperatureCurveSnapshot.publish(temperatureCurve);
+  pressureCurveSnapshot.publish(pressureCurve);
+}
+
+void saveCalibrationCurve(const char* key, const CalibrationCurve& curve) {
+  Preferences preferences;
+  if (!preferences.begin(CALIBRATION_NAMESPACE, false)) {
+    Serial.println("NVS: could not open calibration namespace.");
+    return;
+  }
+  preferences.putBytes(key, &curve, sizeof(curve));
+  preferences.end();
+}
+
+void clearCalibrationCurve(const char* key) {
+  Preferences preferences;
+  if (preferences.begin(CALIBRATION_NAMESPACE, false)) {
+    preferences.remove(key);
+    preferences.end();
+  }
+}
+
+// POST sensor=temperature|pressure and either points=raw:actual,... (temperature: raw C to
+// actual C; pressure: transducer volts to bar) with optional fit=piecewise|polynomial and
+// degree=1..3, or action=reset for the built-in default. The curve is checked and fitted
+// here; the owning task rebuilds its lookup table on its next cycle.
+void handleSetCalibration() {
+  String sensor = server.hasArg("sensor") ? server.arg("sensor") : String("");
+  bool isTemperature = sensor == "temperature";
+  if (!isTemperature && sensor != "pressure") {
+    server.send(400, "text/plain", "Invalid sensor. Must be temperature or pressure.");
+    return;
+  }
+  const char* key = isTemperature ? TEMPERATURE_CURVE_KEY : PRESSURE_CURVE_KEY;
+
+  CalibrationCurve curve;
+  if (server.hasArg("action") && server.arg("action") == "reset") {
+    curve = isTemperature ? DEFAULT_TEMPERATURE_CURVE : DEFAULT_PRESSURE_CURVE;
+    clearCalibrationCurve(key);
+  } else {
+    curve.fit = CALIBRATION_PIECEWISE;
+    if (server.hasArg("fit") && !parseCalibrationFit(server.arg("fit").c_str(), curve.fit)) {
+      server.send(400, "text/plain", "Invalid fit. Must be piecewise or polynomial.");
+      return;
+    }
+    curve.degree = curve.fit == CALIBRATION_POLYNOMIAL ? DEFAULT_POLYNOMIAL_DEGREE : 1;
+    if (server.hasArg("degree")) {
+      curve.degree = atoi(server.arg("degree").c_str());
+    }
+    if (!server.hasArg("points") || !parseCalibrationPoints(server.arg("points").c_str(), curve)) {
+      server.send(400, "text/plain", "Invalid points. Use raw:actual,raw:actual,... (2 to 16 distinct raw values).");
+      return;
+    }
+    CalibrationFunction function;
+    if (!function.fit(curve)) {
+      server.send(400, "text/plain", String("Curve rejected: ") + function.error());
+      return;
+    }
+    saveCalibrationCurve(key, curve);
+  }
+
+  if (isTemperature) {
+    temperatureCurveSnapshot.publish(curve);
+    temperatureCurveChangeRequested = true; // Applied by the control task
+  } else {
+    pressureCurveSnapshot.publish(curve);
+    pressureCurveChangeRequested = true; // Applied by the sensing task
+  }
+  Serial.print("Calibration updated: ");
+  Serial.println(sensor);
+  server.send(200, "text/plain", "OK");
+}
+
+void writeCalibrationCurve(JsonWriter& json, const CalibrationCurve& curve) {
+  CalibrationFunction function;
+  function.fit(curve); // Published curves were checked when they were set
+  json.field("fit", calibrationFitName(curve.fit));
+  json.field("degree", curve.degree);
+  json.field("max_residual", function.maxResidual(), 3);
+  json.beginArray("points");
+  for (int i = 0; i < curve.pointCount; i++) {
+    json.beginArray();
+    json.value(curve.points[i].raw, 3);
+    json.value(curve.points[i].actual, 3);
+    json.endArray();
+  }
+  json.endArray();
+}
+
+void handleCalibrationStatus() {
+  CalibrationCurve temperatureCurve = temperatureCurveSnapshot.read();
+  CalibrationCurve pressureCurve = pressureCurveSnapshot.read();
+
+  WebServerJsonSink sink;
+  JsonWriter json(jsonResponseBuffer, sizeof(jsonResponseBuffer), sink);
+  json.beginObject();
+  json.beginObject("temperature");
+  writeCalibrationCurve(json, temperatureCurve);
+  json.endObject();
+  json.beginObject("pressure");
+  writeCalibrationCurve(json, pressureCurve);
+  json.endObject();
+  json.endObject();
+  json.finish();
+}
+
+// --- Pressure Profile (NVS, /profile) ---
+const char* PRESSURE_PROFILE_NAMESPACE = "profile";
+
+void loadPressureProfile() {
+  PressureProfileSettings settings;
+  settings.profile = defaultPressureProfile();
+  settings.enabled = false;
+  Preferences preferences;
+  if (preferences.begin(PRESSURE_PROFILE_NAMESPACE, true)) {
+    PressureProfile stored;
+    if (preferences.getBytesLength("profile") == sizeof(stored) &&
+        preferences.getBytes("profile", &stored, sizeof(stored)) == sizeof(stored) &&
+        checkPressureProfile(stored) == nullptr) {
+      settings.profile = stored;
+      settings.enabled = preferences.getBool("enabled", false);
+      Serial.println("Loaded pressure profile from NVS.");
+    }
+    preferences.end();
+  }
+  pumpController.setProfile(settings.profile); // Tasks are not running yet
+  pumpController.setEnabled(settings.enabled);
+  pressureProfileSnapshot.publish(settings);
+}
+
+void savePressureProfile(const PressureProfileSettings& settings) {
+  Preferences preferences;
+  if (!preferences.begin(PRESSURE_PROFILE_NAMESPACE, false)) {
+    Serial.println("NVS: could not open pressure profile namespace.");
+    return;
+  }
+  preferences.putBytes("profile", &settings.profile, sizeof(settings.profile));
+  preferences.putBool("enabled", settings.enabled);
+  preferences.end();
+}
+
+// Replaces value with the named argument if present. False if it is present but not a number.
+bool readFloatArg(const char* name, float& value) {
+  if (!server.hasArg(name)) return true;
+  String text = server.arg(name);
+  char* end;
+  double parsed = strtod(text.c_str(), &end);
+  if (end == text.c_str() || *end != '\0') return false;
+  value = (float)parsed;
+  return true;
+}
+
+// POST any of preinfusion_bar, preinfusion_s, ramp_s, hold_bar, hold_s, decline_s, end_bar
+// (the others keep their values) and enabled=1|0. Takes effect from the next shot.
+void handleSetPressureProfile() {
+  PressureProfileSettings settings = pressureProfileSnapshot.read();
+  PressureProfile& profile = settings.profile;
+  if (!readFloatArg("preinfusion_bar", profile.preinfusionBar) || !readFloatArg("preinfusion_s", profile.preinfusionS) ||
+      !readFloatArg("ramp_s", profile.rampS) || !readFloatArg("hold_bar", profile.holdBar) ||
+      !readFloatArg("hold_s", profile.holdS) || !readFloatArg("decline_s", profile.declineS) ||
+      !readFloatArg("end_bar", profile.endBar)) {
+    server.send(400, "text/plain", "Invalid number in the profile.");
+    return;
+  }
+  if (server.hasArg("enabled")) {
+    settings.enabled = server.arg("enabled") == "1";
+  }
+  const char* problem = checkPressureProfile(profile);
+  if (problem != nullptr) {
+    server.send(400, "text/plain", String("Profile rejected: ") + problem);
+    return;
+  }
+  savePressureProfile(settings);
+  pressureProfileSnapshot.publish(settings);
+  pressureProfileChangeRequested = true; // Applied by the sensing task between shots
+  server.send(200, "text/plain", "OK");
+}
+
+void handlePressureProfileStatus() {
+  PressureProfileSettings settings = pressureProfileSnapshot.read();
+  PressureSnapshot pressure = pressureSnapshot.read();
+  const PressureProfile& profile = settings.profile;
+
+  WebServerJsonSink sink;
+  JsonWriter json(jsonResponseBuffer, sizeof(jsonResponseBuffer), sink);
+  json.beginObject();
+  json.field("enabled", settings.enabled);
+  json.field("active", !isnan(pressure.targetPressureBar));
+  json.field("phase", isnan(pressure.targetPressureBar) ? "idle" : profilePhaseName(pressure.profilePhase));
+  json.field("target_pressure", pressure.targetPressureBar, 2);
+  json.field("pump_power", pressure.pumpPowerPercent, 0);
+  json.beginObject("profile");
+  json.field("preinfusion_bar", profile.preinfusionBar, 1);
+  json.field("preinfusion_s", profile.preinfusionS, 1);
+  json.field("ramp_s", profile.rampS, 1);
+  json.field("hold_bar", profile.holdBar, 1);
+  json.field("hold_s", profile.holdS, 1);
+  json.field("decline_s", profile.declineS, 1);
+  json.field("end_bar", profile.endBar, 1);
+  json.endObject();
+  json.beginObject("tracking"); // Current or last profiled shot
+  json.field("rms_error_bar", pressure.profileTracking.rmsErrorBar, 3);
+  json.field("max_overshoot_bar", pressure.profileTracking.maxOvershootBar, 2);
+  json.field("samples", (unsigned long)pressure.profileTracking.samples);
+  json.endObject();
+  json.endObject();
+  json.finish();
+}
+
+// --- Flow Estimate (NVS, /flow) ---
+const char* FLOW_NAMESPACE = "flow";
+const float FLOW_MAX_TARGET_ML = 200.0f;
+
+void loadFlowSettings() {
+  FlowSettings settings = {0.0f, 1.0f};
+  Preferences preferences;
+  if (preferences.begin(FLOW_NAMESPACE, true)) {
+    settings.targetVolumeMl = preferences.getFloat("target", 0.0f);
+    settings.flowScale = preferences.getFloat("scale", 1.0f);
+    preferences.end();
+  }
+  flowEstimator.setTargetVolume(settings.targetVolumeMl); // Tasks are not running yet
+  flowEstimator.setFlowScale(settings.flowScale);         // Clamps a damaged value
+  settings.targetVolumeMl = flowEstimator.targetVolumeMl();
+  settings.flowScale = flowEstimator.flowScale();
+  flowSettingsSnapshot.publish(settings);
+}
+
+void saveFlowSettings(const FlowSettings& settings) {
+  Preferences preferences;
+  if (!preferences.begin(FLOW_NAMESPACE, false)) {
+    Serial.println("NVS: could not open flow namespace.");
+    return;
+  }
+  preferences.putFloat("target", settings.targetVolumeMl);
+  preferences.putFloat("scale", settings.flowScale);
+  preferences.end();
+}
+
+// POST any of target_ml (volumetric stop, 0: off), scale (pump curve calibration) or
+// measured_ml: the weighed yield of the last shot, from which the scale is recomputed.
+// Takes effect from the next shot.
+void handleSetFlow() {
+  FlowSettings settings = flowSettingsSnapshot.read();
+  PressureSnapshot pressure = pressureSnapshot.read();
+  float measuredMl = NAN;
+  if (!readFloatArg("target_ml", settings.targetVolumeMl) || !readFloatArg("scale", settings.flowScale) ||
+      !readFloatArg("measured_ml", measuredMl)) {
+    server.send(400, "text/plain", "Invalid number.");
+    return;
+  }
+  if (!(settings.targetVolumeMl >= 0.0f && settings.targetVolumeMl <= FLOW_MAX_TARGET_ML)) {
+    server.send(400, "text/plain", "target_ml must be 0 (off) to 200.");
+    return;
+  }
+  if (server.hasArg("measured_ml")) {
+    if (pressure.isShotRunning) {
+      server.send(409, "text/plain", "Shot running, weigh it when it has ended.");
+      return;
+    }
+    settings.flowScale = flowScaleFor(pressure.flowTotals, measuredMl);
+    if (isnan(settings.flowScale)) {
+      server.send(400, "text/plain", "No shot to calibrate against.");
+      return;
+    }
+  }
+  if (!(settings.flowScale >= FLOW_SCALE_MIN && settings.flowScale <= FLOW_SCALE_MAX)) {
+    server.send(400, "text/plain", "Pump scale outside 0.5 to 2, check the yield.");
+    return;
+  }
+  saveFlowSettings(settings);
+  flowSettingsSnapshot.publish(settings);
+  flowSettingsChangeRequested = true; // Applied by the sensing task between shots
+  server.send(200, "text/plain", "OK");
+}
+
+void handleFlowStatus() {
+  FlowSettings settings = flowSettingsSnapshot.read();
+  PressureSnapshot pressure = pressureSnapshot.read();
+
+  WebServerJsonSink sink;
+  JsonWriter json(jsonResponseBuffer, sizeof(jsonResponseBuffer), sink);
+  json.beginObject();
+  json.field("target_ml", settings.targetVolumeMl, 1);
+  json.field("scale", settings.flowScale, 3);
+  json.field("flow", pressure.flowMlPerS, 2);
+  json.field("shot_volume", pressure.shotVolumeMl, 1);
+  json.field("shot_duration", pressure.shotDuration_ms);
+  json.field("volumetric_stop", pressure.volumetricStop);
+  json.endObject();
+  json.finish();
+}
+
+// --- Auto-tune ---
+// POST action=start|cancel|reset. The experiment runs in the control task; reset drops the
+// stored model (the hand-tuned defaults apply again after a restart).
+void handleAutoTune() {
+  String action = server.hasArg("action") ? server.arg("action") : String("");
+  if (action == "start") {
+    autoTuneStartRequested = true;
+    server.send(200, "text/plain", "OK");
+  } else if (action == "cancel") {
+    autoTuneCancelRequested = true;
+    server.send(200, "text/plain", "OK");
+  } else if (action == "reset") {
+    clearThermalModel();
+    server.send(200, "text/plain", "Thermal model cleared. Defaults apply after restart.");
+  } else {
+    server.send(400, "text/plain", "Invalid action. Must be start, cancel or reset.");
+  }
+}
+
+void handleAutoTuneStatus() {
+  ControlSnapshot control = controlSnapshot.read();
+  ThermalModelSnapshot thermal = thermalModelSnapshot.read();
+
+  WebServerJsonSink sink;
+  JsonWriter json(jsonResponseBuffer, sizeof(jsonResponseBuffer), sink);
+  json.beginObject();
+  json.field("status", autoTuneStatusName(control.autoTuneStatus));
+  json.field("cycles", control.autoTuneCycleCount);
+  json.field("cycles_total", heaterController.config().autoTuneCycles);
+  json.field("identified", thermal.identified);
+  json.field("gain_c", thermal.model.gainC, 0);
+  json.field("time_constant_s", thermal.model.timeConstantS, 0);
+  json.field("dead_time_s", thermal.model.deadTimeS, 1);
+  json.field("seconds_per_degree", 1.0f / thermal.model.heatingSlopeCPerS(), 2);
+  json.endObject();
+  json.finish();
+}
+
+void handleWiFiConnection() {
+  unsigned long currentMillis = millis();
+
+  switch (currentWiFiState) {
+    case WIFI_DISCONNECTED:
+      // Try to connect only if WIFI_RETRY_DELAY_MS has passed since last attempt
+      if (currentMillis - wifiLastRetryTime >= WIFI_RETRY_DELAY_MS) {
+        Serial.println(F("Attempting WiFi connection..."));
+        updateOledStatus("WiFi Connecting...");
+        WiFi.mode(WIFI_STA); // Ensure STA mode
+        WiFi.begin(ssid, password);
+        wifiConnectStartTime = currentMillis;
+        currentWiFiState = WIFI_CONNECTING;
         wifiLastRetryTime = currentMillis; // Record time of this attempt
         wifiRetryCount++;
         Serial.print(F("WiFi Retry Attempt: ")); Serial.println(wifiRetryCount);
@@ -768,20 +2338,38 @@ void handleWiFiConnection() {
         // ArduinoOTA.begin(); // Moved to setup
         // Serial.println(F("OTA Ready")); // Moved to setup
 
-        #ifdef ENABLE_DATETIME_WEATHER_FEATURE
-        timeClient.begin();
-        Serial.println(F("NTP Client started."));
-        #endif
+        configTime(gmtOffset_sec, daylightOffset_sec, ntpServer); // Background SNTP, non-blocking
+        Serial.println(F("SNTP started."));
 
         // Initialize Web Server now that WiFi is up
         server.on("/", HTTP_GET, handleRoot);
         server.on("/data", HTTP_GET, handleData);
         server.on("/settemp", HTTP_POST, handleSetTemp);
+        server.on("/setcontroller", HTTP_POST, handleSetController);
+        server.on("/autotune", HTTP_POST, handleAutoTune);
+        server.on("/autotune", HTTP_GET, handleAutoTuneStatus);
+        server.on("/calibration", HTTP_POST, handleSetCalibration);
+        server.on("/calibration", HTTP_GET, handleCalibrationStatus);
+        server.on("/profile", HTTP_POST, handleSetPressureProfile);
+        server.on("/profile", HTTP_GET, handlePressureProfileStatus);
+        server.on("/flow", HTTP_POST, handleSetFlow);
+        server.on("/flow", HTTP_GET, handleFlowStatus);
         server.on("/resetmaxpressure", HTTP_POST, handleResetMaxPressure); // New route
         server.on("/history", HTTP_GET, handleHistory); // New route for historical data
+        server.on("/history.bin", HTTP_GET, handleHistoryBinary); // Same data, binary TelemetryFrame
+        server.on("/shots", HTTP_GET, handleShots); // Shot log (LittleFS)
+        server.on("/shot.bin", HTTP_GET, handleShotTrace);
+        server.on("/shots/delete", HTTP_POST, handleShotDelete);
+        server.on("/capture.csv", HTTP_GET, handleShotCapture); // Last shot at 50 Hz
+        server.on("/jobs", HTTP_GET, handleJobs); // Network task scheduler statistics
+        server.on("/metrics", HTTP_GET, handleMetrics); // Prometheus text: stage timings, heap
         server.onNotFound(handleNotFound);
         server.begin();
         Serial.println(F("HTTP server started"));
+        telemetryServer.begin();
+        telemetryServer.setNoDelay(true);
+        Serial.print(F("Telemetry stream on port "));
+        Serial.println(TELEMETRY_STREAM_PORT);
 
       } else if (currentMillis - wifiConnectStartTime >= WIFI_CONNECT_TIMEOUT_MS) {
         Serial.println(F("WiFi Connection Timeout."));
@@ -793,6 +2381,7 @@ void handleWiFiConnection() {
         if (wifiRetryCount >= MAX_WIFI_RETRIES_BEFORE_REBOOT) {
           Serial.println(F("Max WiFi retries reached. Rebooting..."));
           updateOledStatus("WiFi Fail Reboot");
+          shotStore.flush(); // Pending shot records
           delay(100); // Short delay for serial print
           ESP.restart();
         }
@@ -810,10 +2399,8 @@ void handleWiFiConnection() {
         // Stop services that depend on WiFi
         server.stop();
         Serial.println(F("HTTP server stopped."));
-        #ifdef ENABLE_DATETIME_WEATHER_FEATURE
-        timeClient.end(); // Properly stop NTP client if it has an end method
-        Serial.println(F("NTP Client stopped."));
-        #endif
+        telemetryHub.closeAll();
+        telemetryServer.end();
       }
       break;
   }
@@ -828,6 +2415,11 @@ void setup() {
   Serial.println("Booting");
   updateOledStatus("Booting..."); // Initial OLED status
 
+  stageMetrics.begin(getCpuFrequencyMhz()); // CCOUNT ticks at the CPU clock
+  for (int i = 0; i < STAGE_COUNT; i++) {
+    stageMetrics.add(METRIC_STAGE_NAMES[i], i <= LAST_LOOP_STAGE);
+  }
+
   WiFi.mode(WIFI_STA); // Set WiFi mode early for OTA
   
   // Initialize LED_BUILTIN pin as an output.
@@ -840,9 +2432,14 @@ void setup() {
 
   // Initialize Relay Pin
   pinMode(RELAY_PIN, OUTPUT);
-  digitalWrite(RELAY_PIN, HIGH); // Heater OFF (Relay is likely Active LOW, so HIGH is OFF)
-  isRelayOn = false; // Ensure state matches
-  web_isRelayOn = false;
+  heaterController.begin(); // Heater OFF (Relay is likely Active LOW, so HIGH is OFF)
+  loadThermalModel(); // Auto-tuned model from NVS replaces the hand-tuned constants
+  loadCalibration(); // Uploaded sensor curves from NVS replace the defaults
+  loadPressureProfile();
+  loadFlowSettings();
+  pumpDimmer.begin(NORMAL_MODE, ON);
+  setPumpPower(pumpController.power()); // Full power until a profiled shot starts
+  setupShotStore();
 
   // Initialize OLED display
   Wire.begin(); // SDA 21, SCL 22 for ESP32 (default if not specified)
@@ -860,6 +2457,7 @@ void setup() {
   display.println(F("System Initializing..."));
   display.display();
   delay(500);
+  setupOledView(); // First frame clears the splash and sends the full screen
 
   // Initialize WiFi connection handling
   handleWiFiConnection(); // Initial attempt to connect
@@ -874,6 +2472,7 @@ void setup() {
       else // U_SPIFFS
         type = "filesystem";
       Serial.println("Start updating " + type);
+      shotStore.flush(); // Pending shot records, before the reboot
       updateOledStatus("OTA Update...");
       display.clearDisplay();
       display.setTextSize(1);
@@ -913,6 +2512,7 @@ void setup() {
       display.printf("Error: %u", error);
       display.display();
       delay(2000);
+      oledView.invalidate(); // Back to the normal screen with a full redraw
     });
 
   ArduinoOTA.begin(); // Start OTA
@@ -922,126 +2522,129 @@ void setup() {
   Serial.println(WiFi.localIP());
   updateOledStatus("System Ready");
   digitalWrite(LED_BUILTIN, LOW); // Turn LED off after setup (LOW = OFF as per user feedback)
+
+  pressureCaptureRunning = beginPressureCapture();
+
+  // Start the runtime tasks: watchdog, control and sensing on core 1, networking/UI on core 0.
+  // The watchdog's sensor timeout starts now, not at boot (setup can take seconds on WiFi).
+  heaterWatchdog.begin();
+  xTaskCreatePinnedToCore(watchdogTask, "watchdog", WATCHDOG_TASK_STACK_SIZE, NULL,
+                          WATCHDOG_TASK_PRIORITY, &watchdogTaskHandle, WATCHDOG_TASK_CORE);
+  xTaskCreatePinnedToCore(controlTask, "control", CONTROL_TASK_STACK_SIZE, NULL,
+                          CONTROL_TASK_PRIORITY, &controlTaskHandle, CONTROL_TASK_CORE);
+  xTaskCreatePinnedToCore(sensingTask, "sensing", SENSING_TASK_STACK_SIZE, NULL,
+                          SENSING_TASK_PRIORITY, &sensingTaskHandle, SENSING_TASK_CORE);
+  xTaskCreatePinnedToCore(networkTask, "network", NETWORK_TASK_STACK_SIZE, NULL,
+                          NETWORK_TASK_PRIORITY, &networkTaskHandle, NETWORK_TASK_CORE);
+#ifdef ENABLE_DATETIME_WEATHER_FEATURE
+  xTaskCreatePinnedToCore(weatherTask, "weather", WEATHER_TASK_STACK_SIZE, NULL,
+                          WEATHER_TASK_PRIORITY, &weatherTaskHandle, WEATHER_TASK_CORE);
+#endif
 }
 
 
 #ifdef ENABLE_DATETIME_WEATHER_FEATURE
-void getWeatherData() {
-  if (WiFi.status() == WL_CONNECTED) {
+// HttpGetter on HTTPClient with connect and read timeouts. The body is read into the
+// caller's buffer (no String). DNS lookups have the lwIP timeout, not ours.
+class ArduinoHttpGetter : public HttpGetter {
+public:
+  int get(const char* url, char* body, size_t capacity, size_t& length, uint32_t timeoutMs) override {
+    length = 0;
+    body[0] = '\0';
     HTTPClient http;
-    String serverPath = weatherApiUrlBase + city + "&appid=" + openWeatherMapApiKey + "&units=" + units;
-    
-    http.begin(serverPath.c_str()); //Specify request destination
-    int httpResponseCode = http.GET();
-    
-    if (httpResponseCode > 0) {
-      String payload = http.getString();
-      // Serial.println(payload); // For debugging weather response
-
-      JsonDocument doc; // Use JsonDocument instead of DynamicJsonDocument
-      DeserializationError error = deserializeJson(doc, payload);
-
-      if (error) {
-        Serial.print(F("deserializeJson() failed: "));
-        Serial.println(error.f_str());
-        currentWeatherDataTemp = NAN; // Indicate error
-        return;
+    http.setConnectTimeout(timeoutMs);
+    http.setTimeout(timeoutMs);
+    http.setReuse(false);
+    if (!http.begin(url)) {
+      return -1;
+    }
+    unsigned long start = millis();
+    int status = http.GET();
+    if (status == HTTP_CODE_OK) {
+      WiFiClient* stream = http.getStreamPtr();
+      int expected = http.getSize(); // -1 when the server sends no Content-Length
+      while (length + 1 < capacity && (expected < 0 || (int)length < expected) && millis() - start < timeoutMs) {
+        int available = stream->available();
+        if (available > 0) {
+          size_t room = capacity - 1 - length;
+          length += stream->readBytes(body + length, (size_t)available < room ? (size_t)available : room);
+        } else if (!stream->connected()) {
+          break;
+        } else {
+          delay(10);
+        }
       }
-      
-      JsonObject main = doc["main"];
-      currentWeatherDataTemp = main["temp"]; // مثال: 29.09
-      // Serial.print("Weather Temp: "); Serial.println(currentWeatherDataTemp);
+      body[length] = '\0';
+      if (expected >= 0 && (int)length < expected && length + 1 < capacity) {
+        status = -2; // Body timed out
+      }
+    }
+    http.end();
+    return status;
+  }
+};
 
-    } else {
-      Serial.print("Error on HTTP request: ");
-      Serial.println(httpResponseCode);
-      currentWeatherDataTemp = NAN; // Indicate error
+ArduinoHttpGetter weatherHttp;
+WeatherFetcher weatherFetcher(weatherHttp);
+
+void weatherTask(void* parameter) {
+  String url = weatherApiUrlBase + city + "&appid=" + openWeatherMapApiKey + "&units=" + units; // Once
+  weatherFetcher.setUrl(url.c_str());
+  for (;;) {
+    if (WiFi.status() == WL_CONNECTED && weatherFetcher.update(millis())) {
+      weatherSnapshot.publish(weatherFetcher.reading());
+      if (weatherFetcher.consecutiveFailures() > 0) {
+        Serial.printf("Weather request failed (%d), %d in a row, next try in %lu s\n", weatherFetcher.lastStatus(),
+                      weatherFetcher.consecutiveFailures(), (weatherFetcher.nextAttemptMs() - millis()) / 1000);
+      }
     }
-    http.end(); //Free resources
-  } else {
-    // Serial.println("WiFi not connected, skipping weather update.");
-    currentWeatherDataTemp = NAN; // Indicate no data due to WiFi
+    vTaskDelay(pdMS_TO_TICKS(WEATHER_TASK_POLL_MS));
   }
 }
 #endif
 
 
-void loop() {
-  unsigned long currentMillis = millis();
-
-  // Handle WiFi connection state
-  handleWiFiConnection();
-
-  // Handle OTA updates if WiFi is connected
-  if (currentWiFiState == WIFI_CONNECTED) {
-    ArduinoOTA.handle();
-    server.handleClient(); // Handle web server requests
-
-    #ifdef ENABLE_DATETIME_WEATHER_FEATURE
-    // Update time from NTP
-    timeClient.update();
-    currentTimeStr = timeClient.getFormattedTime(); // HH:MM:SS (Restored seconds)
-    
-    // Date and Day of Week calculation removed as they are no longer displayed
-    // time_t epochTime = timeClient.getEpochTime();
-    // struct tm *ptm = localtime(&epochTime);
-    // char dateBuffer[10];
-    // sprintf(dateBuffer, "%02d/%02d", ptm->tm_mday, ptm->tm_mon + 1);
-    // currentDateStr = String(dateBuffer);
-    //
-    // char dayBuffer[4];
-    // strftime(dayBuffer, sizeof(dayBuffer), "%a", ptm); // Short day name e.g. "Mon"
-    // currentDayOfWeekStr = String(dayBuffer);
-
-    // Get weather data periodically
-    if (currentMillis - lastWeatherReadTime >= weatherReadInterval || isnan(currentWeatherDataTemp) && lastWeatherReadTime == 0) {
-      getWeatherData();
-      lastWeatherReadTime = currentMillis;
-    }
-    #endif
+// --- Control Task Helpers ---
+// One fixed-period pass of the heater control core plus the temperature plot pause logic.
+// The control task owns heaterController; the web side only posts commands.
+void runControlCycle() {
+  // Set point requested through the web UI
+  if (desiredTempChangeRequested.exchange(false)) {
+    heaterController.setDesiredTemperature(requestedDesiredTempC.load());
+  }
+  if (controlModeChangeRequested.exchange(false)) {
+    heaterController.setControlMode((ControlMode)requestedControlMode.load());
+  }
+  if (autoTuneStartRequested.exchange(false)) {
+    heaterController.startAutoTune();
+  }
+  if (autoTuneCancelRequested.exchange(false)) {
+    heaterController.cancelAutoTune();
+  }
+  if (temperatureCurveChangeRequested.exchange(false)) {
+    temperatureCalibration.load(temperatureCurveSnapshot.read()); // Rebuilds the lookup table
   }
 
-
-  // --- Temperature Reading and Smoothing ---
-  double smoothedTempC = NAN; // Default to NAN if no valid reading
-  if (currentMillis - lastTempReadTime >= tempReadInterval) {
-    lastTempReadTime = currentMillis;
-    double rawTempC = thermocouple.readCelsius();
-
-    if (isnan(rawTempC)) { // Check raw temperature for validity
-      Serial.println("Failed to read from thermocouple sensor!");
-      updateOledStatus("Thermo Err");
-      // smoothedTempC_EMA remains as is, or could be set to NAN to indicate error propagation
-    } else {
-      // Get calibrated temperature
-      double calibratedTempC = getCalibratedTemperature(rawTempC);
-
-      // --- EMA Smoothing Logic ---
-      if (isnan(smoothedTempC_EMA)) { // If it's the first valid reading or after an error/reset
-        smoothedTempC_EMA = calibratedTempC;
-      } else {
-        // Apply EMA formula: EMA_new = alpha * new_value + (1 - alpha) * EMA_old
-        smoothedTempC_EMA = (TEMP_EMA_ALPHA * calibratedTempC) + ((1.0f - TEMP_EMA_ALPHA) * smoothedTempC_EMA);
-      }
-      smoothedTempC = smoothedTempC_EMA; // This is the smoothed value to be used by the rest of the system
-      
-      web_smoothedTempC = smoothedTempC; // Update web data
-      web_desiredTempC = desiredTemperatureC; // Ensure web_desiredTempC is kept up-to-date
-      // --- End EMA Smoothing Logic ---
-    }
-  } else {
-    // If not time to read, use the last known smoothed value
-    smoothedTempC = smoothedTempC_EMA;
+  {
+    StageTimer timer(stageMetrics, STAGE_HEATER_UPDATE);
+    heaterController.update();
   }
-  // Ensure web_smoothedTempC is always updated, even if no new reading this cycle
-  // This might be redundant if smoothedTempC is always assigned from smoothedTempC_EMA
-  if (!isnan(smoothedTempC)) {
-      web_smoothedTempC = smoothedTempC;
+  heaterWatchdog.setStandby(heaterController.isPresumedOff());
+  heaterController.setLowPower(standbyPolicy.update(millis(), heaterController.isPresumedOff()));
+  double smoothedTempC = heaterController.smoothedTemperature();
+  if (heaterController.takePresumedOffEvent()) {
+    web_early_cutoff_signal = true; // Signal client for plot reset
+  }
+  ThermalModelSnapshot thermal;
+  if (heaterController.takeAutoTuneResult(thermal.model)) {
+    thermal.identified = true;
+    thermalModelSnapshot.publish(thermal);
+    thermalModelSaveRequested = true; // Persisted by the network task
   }
 
   // --- Server-side Plot Pause Logic (Temperature) ---
   if (!isnan(smoothedTempC)) {
-    if (smoothedTempC < PRESUMED_OFF_TEMP_THRESHOLD_C) {
+    if (smoothedTempC < heaterController.config().presumedOffTempThresholdC) {
       if (!web_isTempPlotPaused) {
         Serial.println("Server: Temperature plot paused.");
         web_isTempPlotPaused = true;
@@ -1050,526 +2653,489 @@ void loop() {
       if (web_isTempPlotPaused) {
         Serial.println("Server: Temperature plot resumed. Clearing history.");
         web_isTempPlotPaused = false;
-        // Clear history so plot restarts cleanly on client
-        tempHistoryCount = 0;
-        tempHistoryIndex = 0;
-        pressureHistoryCount = 0; // Also clear pressure history for consistency
-        pressureHistoryIndex = 0;
-        maxObservedPressure = 0.0f; // And max pressure
+        // Clear history so plot restarts cleanly on client (also pressure history and max pressure)
+        historyClearRequested = true;
+        maxPressureResetRequested = true;
       }
     }
   }
 
-  // --- Built-in LED Blinking Logic ---
-  // LED_BUILTIN: HIGH = ON, LOW = OFF (as per user feedback)
+  // Publish for the network side (web, OLED, LEDs, history)
+  ControlSnapshot snapshot;
+  snapshot.smoothedTempC = smoothedTempC;
+  snapshot.tempRateCPerS = heaterController.temperatureRate();
+  snapshot.desiredTempC = heaterController.desiredTemperature();
+  snapshot.isRelayOn = heaterController.isRelayOn() && heaterWatchdog.trip() == WATCHDOG_OK; // What the pin does
+  snapshot.heaterState = heaterController.state();
+  snapshot.controlMode = heaterController.controlMode();
+  snapshot.heaterDuty = heaterController.duty();
+  snapshot.autoTuneStatus = heaterController.autoTuneStatus();
+  snapshot.autoTuneCycleCount = heaterController.autoTuneCycleCount();
+  snapshot.machineIsPresumedOff = heaterController.isPresumedOff();
+  snapshot.isTempPlotPaused = web_isTempPlotPaused;
+  const SensorHealth& health = heaterController.sensorHealth();
+  snapshot.sensorFault = health.fault();
+  for (int i = 0; i < SENSOR_FAULT_COUNT; i++) {
+    snapshot.sensorFaultCounts[i] = health.faultCount((SensorFault)i);
+  }
+  snapshot.sensorFailedReads = health.failedReads();
+  snapshot.sensorRejectedReads = health.rejectedReads();
+  controlSnapshot.publish(snapshot);
+}
 
-  if (machineIsPresumedOff) {
-    // Machine is presumed off: LED OFF
-    digitalWrite(LED_BUILTIN, LOW); // LED OFF (LOW = OFF)
-  } else if (!isnan(smoothedTempC) && smoothedTempC > 103.0) {
-    // 5. Temperature above 103°C: Very rapid blinking
-    if (currentMillis - lastBlinkTimeLed >= blinkIntervalVeryRapid) {
-      lastBlinkTimeLed = currentMillis;
-      digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN)); // Toggle LED
-    }
-  } else if (currentHeaterState == HEATING && smoothedTempC > 80.0) {
-    // 2. Heating: Fast blinking
-    if (currentMillis - lastBlinkTimeLed >= blinkIntervalRapid) {
-      lastBlinkTimeLed = currentMillis;
-      digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN)); // Toggle LED
+void controlTask(void* parameter) {
+  TickType_t lastWakeTime = xTaskGetTickCount();
+  for (;;) {
+    {
+      StageTimer timer(stageMetrics, STAGE_CONTROL_LOOP);
+      runControlCycle();
     }
-  } else if (!isnan(smoothedTempC) && (smoothedTempC >= desiredTemperatureC - 1.0 && smoothedTempC <= desiredTemperatureC + 1.0)) {
-    // 3. Temperature in +/-1 of set temperature: Steady on
-    digitalWrite(LED_BUILTIN, HIGH); // LED ON (HIGH = ON)
-  } else if (currentHeaterState == SETTLING) {
-    // 4. Temperature not in +/-1 of set temperature and settle check is going on: Slow blinking
-    // This condition is met if the previous "steady on" condition was false.
-    if (currentMillis - lastBlinkTimeLed >= blinkIntervalSlow) {
-      lastBlinkTimeLed = currentMillis;
-      digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN)); // Toggle LED
-    }
-  } else {
-    // 1. Default led state (when not presumed off and no other condition met): light off
-    // This includes IDLE state when not meeting other conditions.
-    digitalWrite(LED_BUILTIN, LOW); // LED OFF (LOW = OFF)
+    uint32_t periodMs = standbyPolicy.isLowPower() ? CONTROL_TASK_STANDBY_PERIOD_MS : CONTROL_TASK_PERIOD_MS;
+    vTaskDelayUntil(&lastWakeTime, pdMS_TO_TICKS(periodMs));
   }
+}
 
-  // --- Status LED on GPIO27 ---
-  if (currentMillis - lastStatusLedToggleTime >= statusLedToggleInterval) {
-    lastStatusLedToggleTime = currentMillis;
-    digitalWrite(STATUS_LED_PIN, !digitalRead(STATUS_LED_PIN)); // Toggle Status LED
+// --- Watchdog Task ---
+void watchdogTask(void* parameter) {
+  TickType_t lastWakeTime = xTaskGetTickCount();
+  for (;;) {
+    {
+      StageTimer timer(stageMetrics, STAGE_WATCHDOG_LOOP);
+      heaterWatchdog.tick();
+    }
+    uint32_t periodMs = standbyPolicy.isLowPower() ? WATCHDOG_TASK_STANDBY_PERIOD_MS : WATCHDOG_TASK_PERIOD_MS;
+    vTaskDelayUntil(&lastWakeTime, pdMS_TO_TICKS(periodMs));
   }
+}
 
+// --- Sensing Task Helpers ---
+// One decimated pressure value through smoothing, shot timer and max pressure tracking.
+void processPressureBlock(const DecimatedSample& block) {
+  StageTimer timer(stageMetrics, STAGE_PRESSURE_BLOCK);
+  unsigned long sampleTimeMs = pressureCaptureStartMs + pressureDecimator.sampleTimeMs(block.sampleIndex);
+  // SMA, then ADC counts to bar (clamped at 0), both in SensorScalar
+  SensorScalar smoothedAdcValue = SensorScalar(pressureAdcSmoothing.update(block.adcValue));
+  SensorScalar pressureBar = pressureScale.toBar(smoothedAdcValue);
+  float currentPressureBar = (float)pressureBar; // Shot timer, plot pause and web
+  shotCapture.push(sampleTimeMs, (float)pressureScale.toBar(block.adcValue));
+
+  // --- Server-side Plot Pause Logic (Pressure) & Shot Timer ---
+  if (!isnan(currentPressureBar)) {
+      // Shot Timer Start
+      if (currentPressureBar >= 2.0f && !isShotRunning && !web_isPressurePlotPaused) {
+          isShotRunning = true;
+          shotStartTime_ms = sampleTimeMs;
+          web_shotDuration_ms = 0;
+          shotCapture.trigger();
+          pumpController.start(); // Profile time 0 (no-op with the profile off)
+          flowEstimator.start();
+          Serial.println("Shot timer started.");
+      }
 
-  // --- Pressure Reading and Smoothing ---
-  // Removed timed interval to align with older commit's behavior (read every loop)
-  // lastPressureReadTime = currentMillis; // Removed
+      // Update shot duration if running
+      if (isShotRunning) {
+          web_shotDuration_ms = sampleTimeMs - shotStartTime_ms;
+      }
 
-  int stableAdcValue = getStableAdcValue(); // This function now handles its own timing/sampling
+      // Plot Pause & Shot Timer Stop
+      if (currentPressureBar < 1.7 && lastPressureForPauseCheck_server >= 1.7) {
+          if (!web_isPressurePlotPaused) {
+              Serial.println("Server: Pressure plot paused.");
+              web_isPressurePlotPaused = true;
+              if (isShotRunning) {
+                  isShotRunning = false; // Stop the timer, final value is already set
+                  shotCapture.stop();
+                  pumpController.stop();
+                  flowEstimator.stop();
+                  Serial.print("Shot timer stopped. Duration: ");
+                  Serial.print(web_shotDuration_ms / 1000.0, 1);
+                  Serial.print("s, volume ");
+                  Serial.print(flowEstimator.volumeMl(), 1);
+                  Serial.println(" ml");
+              }
+          }
+      } else if (currentPressureBar >= PRESSURE_RESUME_THRESHOLD_BAR) {
+          if (web_isPressurePlotPaused) {
+              Serial.println("Server: Pressure plot resumed. Clearing history.");
+              web_isPressurePlotPaused = false;
+              // Clear history so plot restarts cleanly on client
+              historyClearRequested = true;
+              maxObservedPressure = 0.0f;
+              web_shotDuration_ms = 0; // Reset shot timer display
+          }
+      }
+      lastPressureForPauseCheck_server = currentPressureBar;
+  }
 
-  // SMA for ADC readings
-    if (numPressureAdcValuesStored == PRESSURE_SMOOTHING_SAMPLES) {
-      totalPressureAdcSmoothingSum -= pressureAdcSmoothingBuffer[currentPressureAdcSmoothingIndex];
-    }
-    pressureAdcSmoothingBuffer[currentPressureAdcSmoothingIndex] = stableAdcValue;
-    totalPressureAdcSmoothingSum += stableAdcValue;
-    currentPressureAdcSmoothingIndex = (currentPressureAdcSmoothingIndex + 1) % PRESSURE_SMOOTHING_SAMPLES;
-    if (numPressureAdcValuesStored < PRESSURE_SMOOTHING_SAMPLES) {
-      numPressureAdcValuesStored++;
-    }
-    double smoothedAdcValue = totalPressureAdcSmoothingSum / numPressureAdcValuesStored;
-    
-    // Convert ADC value to voltage
-    float voltage = (smoothedAdcValue / ESP32_ADC_MAX_VALUE) * ESP32_ADC_MAX_VOLTAGE;
-    // Convert voltage to pressure (bar)
-    float currentPressureBar = ((voltage - VOLTS_AT_0_BAR) / (VOLTS_AT_16_BAR - VOLTS_AT_0_BAR)) * PRESSURE_MAX_BAR;
-    // Clamp pressure to 0 if calculated as negative
-    if (currentPressureBar < 0) {
-      currentPressureBar = 0.0f;
+  // --- Flow estimate (with the power of the block just ended), then one pump control step ---
+  flowEstimator.update((sampleTimeMs - lastFlowSampleMs) / 1000.0f, (float)pumpDimmerPower, currentPressureBar);
+  lastFlowSampleMs = sampleTimeMs;
+  float pumpPower = pumpController.update(web_shotDuration_ms / 1000.0f, currentPressureBar);
+  if (flowEstimator.targetReached() && !volumetricStopActive) {
+    volumetricStopActive = true;
+    volumetricStopMs = sampleTimeMs;
+    Serial.printf("Volumetric stop at %.1f ml (%.1f ml expected in the cup)\n", flowEstimator.volumeMl(),
+                  flowEstimator.expectedFinalMl());
+  }
+  if (volumetricStopActive) {
+    if (!isShotRunning && sampleTimeMs - volumetricStopMs >= VOLUMETRIC_STOP_HOLD_MS) {
+      volumetricStopActive = false; // Back to the pump controller's (idle) power
+    } else {
+      pumpPower = 0.0f;
     }
-    web_pressureBar = currentPressureBar; // Update web data with the current (smoothed) pressure
-
-    // --- Server-side Plot Pause Logic (Pressure) & Shot Timer ---
-    if (!isnan(currentPressureBar)) {
-        // Shot Timer Start
-        if (currentPressureBar >= 2.0f && !isShotRunning && !web_isPressurePlotPaused) {
-            isShotRunning = true;
-            shotStartTime_ms = millis();
-            web_shotDuration_ms = 0;
-            Serial.println("Shot timer started.");
-        }
-
-        // Update shot duration if running
-        if (isShotRunning) {
-            web_shotDuration_ms = millis() - shotStartTime_ms;
-        }
+  }
+  setPumpPower(pumpPower);
 
-        // Plot Pause & Shot Timer Stop
-        if (currentPressureBar < 1.7 && lastPressureForPauseCheck_server >= 1.7) {
-            if (!web_isPressurePlotPaused) {
-                Serial.println("Server: Pressure plot paused.");
-                web_isPressurePlotPaused = true;
-                if (isShotRunning) {
-                    isShotRunning = false; // Stop the timer, final value is already set
-                    Serial.print("Shot timer stopped. Duration: ");
-                    Serial.print(web_shotDuration_ms / 1000.0, 1);
-                    Serial.println("s");
-                }
-            }
-        } else if (currentPressureBar >= PRESSURE_RESUME_THRESHOLD_BAR) {
-            if (web_isPressurePlotPaused) {
-                Serial.println("Server: Pressure plot resumed. Clearing history.");
-                web_isPressurePlotPaused = false;
-                // Clear history so plot restarts cleanly on client
-                tempHistoryCount = 0;
-                tempHistoryIndex = 0;
-                pressureHistoryCount = 0;
-                pressureHistoryIndex = 0;
-                maxObservedPressure = 0.0f;
-                web_shotDuration_ms = 0; // Reset shot timer display
-            }
-        }
-        lastPressureForPauseCheck_server = currentPressureBar;
-    }
+  // --- Max Pressure Stability Check ---
+  pressureMaxStabilityWindow.update(pressureBar);
+  if (pressureMaxStabilityWindow.full()) {
+    SensorScalar minVal = pressureMaxStabilityWindow.minimum();
+    SensorScalar maxVal = pressureMaxStabilityWindow.maximum();
 
-    // --- Max Pressure Stability Check ---
-    pressureMaxStabilityBuffer[pressureMaxStabilityIndex] = currentPressureBar;
-    pressureMaxStabilityIndex = (pressureMaxStabilityIndex + 1) % PRESSURE_STABILITY_SAMPLES_FOR_MAX;
-    if (pressureMaxStabilityCount < PRESSURE_STABILITY_SAMPLES_FOR_MAX) {
-      pressureMaxStabilityCount++;
+    if ((maxVal - minVal) <= PRESSURE_STABILITY_THRESHOLD_FOR_MAX) {
+      // Pressure is considered stable for max pressure update
+      float stablePressureForMax = (float)pressureMaxStabilityWindow.mean();
+      
+      if (stablePressureForMax > maxObservedPressure) {
+        maxObservedPressure = stablePressureForMax;
+      }
     }
+  }
+  // --- End Max Pressure Stability Check ---
+  latestPressureBar = currentPressureBar;
+}
 
-    if (pressureMaxStabilityCount == PRESSURE_STABILITY_SAMPLES_FOR_MAX) {
-      float minVal = pressureMaxStabilityBuffer[0];
-      float maxVal = pressureMaxStabilityBuffer[0];
-      for (int i = 1; i < PRESSURE_STABILITY_SAMPLES_FOR_MAX; i++) {
-        if (pressureMaxStabilityBuffer[i] < minVal) minVal = pressureMaxStabilityBuffer[i];
-        if (pressureMaxStabilityBuffer[i] > maxVal) maxVal = pressureMaxStabilityBuffer[i];
-      }
+// --- Pressure Capture ---
+bool beginPressureCapture() {
+  i2s_config_t i2sConfig = {};
+  i2sConfig.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN);
+  i2sConfig.sample_rate = PRESSURE_SAMPLE_RATE_HZ;
+  i2sConfig.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+  i2sConfig.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+  i2sConfig.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+  i2sConfig.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
+  i2sConfig.dma_buf_count = PRESSURE_DMA_BUFFER_COUNT;
+  i2sConfig.dma_buf_len = PRESSURE_DMA_BUFFER_SAMPLES;
+  i2sConfig.use_apll = false;
+
+  esp_err_t err = i2s_driver_install(PRESSURE_I2S_PORT, &i2sConfig, PRESSURE_I2S_EVENT_QUEUE_LENGTH, &pressureI2sEventQueue);
+  if (err == ESP_OK) err = i2s_set_adc_mode(ADC_UNIT_1, PRESSURE_ADC_CHANNEL);
+  if (err == ESP_OK) err = adc1_config_channel_atten(PRESSURE_ADC_CHANNEL, ADC_ATTEN_DB_11); // Full 0-3.3 V range, as analogRead()
+  if (err == ESP_OK) err = i2s_adc_enable(PRESSURE_I2S_PORT);
+  if (err != ESP_OK) {
+    Serial.printf("Pressure capture: I2S ADC start failed (%d), pressure unavailable\n", (int)err);
+    return false;
+  }
+  pressureDecimator.reset();
+  pressureCaptureStartMs = millis();
+  Serial.printf("Pressure capture: %lu Hz I2S ADC, decimated to %.0f Hz\n",
+                (unsigned long)PRESSURE_SAMPLE_RATE_HZ, pressureDecimator.outputRateHz());
+  return true;
+}
 
-      if ((maxVal - minVal) <= PRESSURE_STABILITY_THRESHOLD_FOR_MAX) {
-        // Pressure is considered stable for max pressure update
-        float sumStable = 0;
-        for(int i=0; i<PRESSURE_STABILITY_SAMPLES_FOR_MAX; ++i) sumStable += pressureMaxStabilityBuffer[i];
-        float stablePressureForMax = sumStable / PRESSURE_STABILITY_SAMPLES_FOR_MAX;
-        
-        if (stablePressureForMax > maxObservedPressure) {
-          maxObservedPressure = stablePressureForMax;
-        }
-      }
+// Drains every sample the DMA has completed (never waits) through the decimator and hands
+// each finished block to processPressureBlock().
+void drainPressureCapture() {
+  // On a full DMA queue the driver drops the oldest unread buffer, i.e. the one at our read
+  // position, so skipping its samples here keeps the sample clock exact.
+  i2s_event_t event;
+  while (xQueueReceive(pressureI2sEventQueue, &event, 0) == pdTRUE) {
+    if (event.type == I2S_EVENT_RX_Q_OVF) {
+      pressureDmaOverruns++;
+      pressureDecimator.skip(PRESSURE_DMA_BUFFER_SAMPLES);
     }
-    // --- End Max Pressure Stability Check ---
-  // } // Removed closing bracket of the timed interval
-
-  // --- History Sampling ---
-  if (currentMillis - lastHistorySampleTime >= historySampleInterval) {
-    lastHistorySampleTime = currentMillis;
-
-    if (!isnan(smoothedTempC) && !web_isTempPlotPaused) {
-      tempHistory[tempHistoryIndex] = {currentMillis, (float)smoothedTempC};
-      tempHistoryIndex = (tempHistoryIndex + 1) % HISTORY_SIZE;
-      if (tempHistoryCount < HISTORY_SIZE) {
-        tempHistoryCount++;
+  }
+
+  size_t bytesRead;
+  do {
+    bytesRead = 0;
+    i2s_read(PRESSURE_I2S_PORT, pressureDrainBuffer, sizeof(pressureDrainBuffer), &bytesRead, 0);
+    size_t samples = bytesRead / sizeof(pressureDrainBuffer[0]);
+    for (size_t i = 0; i < samples; i++) {
+      DecimatedSample block;
+      if (pressureDecimator.push(pressureDrainBuffer[i] & PRESSURE_I2S_DATA_MASK, block)) {
+        processPressureBlock(block);
       }
     }
+  } while (bytesRead == sizeof(pressureDrainBuffer));
+}
 
-    if (!isnan(web_pressureBar) && !web_isPressurePlotPaused) {
-      pressureHistory[pressureHistoryIndex] = {currentMillis, web_pressureBar};
-      pressureHistoryIndex = (pressureHistoryIndex + 1) % HISTORY_SIZE;
-      if (pressureHistoryCount < HISTORY_SIZE) {
-        pressureHistoryCount++;
-      }
+// One fixed-period pass: drain the capture, then publish the latest values.
+void runSensingCycle() {
+  if (maxPressureResetRequested.exchange(false)) {
+    maxObservedPressure = 0.0f;
+    pressureMaxStabilityWindow.reset();
+  }
+  if (pressureCurveChangeRequested.exchange(false)) {
+    pressureScale.load(pressureCurveSnapshot.read()); // Rebuilds the lookup table
+  }
+  if (!pumpController.isActive() && pressureProfileChangeRequested.exchange(false)) {
+    PressureProfileSettings settings = pressureProfileSnapshot.read(); // Applies from the next shot
+    pumpController.setProfile(settings.profile);
+    pumpController.setEnabled(settings.enabled);
+  }
+  if (!flowEstimator.isRunning() && flowSettingsChangeRequested.exchange(false)) {
+    FlowSettings settings = flowSettingsSnapshot.read(); // Applies from the next shot
+    flowEstimator.setTargetVolume(settings.targetVolumeMl);
+    flowEstimator.setFlowScale(settings.flowScale);
+  }
+
+  if (pressureCaptureRunning) {
+    StageTimer timer(stageMetrics, STAGE_PRESSURE_DRAIN);
+    drainPressureCapture();
+  }
+
+  const ShotCaptureTrace& capture = shotCapture.completed();
+  if (capture.generation != shotCaptureSnapshot.read().generation) {
+    shotCaptureSnapshot.publish(capture);
+  }
+
+  // Publish for the network side (web, OLED, history)
+  PressureSnapshot snapshot;
+  snapshot.pressureBar = latestPressureBar;
+  snapshot.maxObservedPressure = maxObservedPressure;
+  snapshot.isShotRunning = isShotRunning;
+  snapshot.shotDuration_ms = web_shotDuration_ms;
+  snapshot.flowMlPerS = flowEstimator.flowMlPerS();
+  snapshot.shotVolumeMl = flowEstimator.volumeMl();
+  snapshot.flowTotals = flowEstimator.totals();
+  snapshot.volumetricStop = volumetricStopActive;
+  snapshot.isPressurePlotPaused = web_isPressurePlotPaused;
+  snapshot.captureOverruns = pressureDmaOverruns;
+  snapshot.pumpPowerPercent = pumpController.power();
+  snapshot.targetPressureBar = pumpController.targetBar();
+  snapshot.profilePhase = pumpController.phase();
+  snapshot.profileTracking = pumpController.tracking();
+  pressureSnapshot.publish(snapshot);
+}
+
+void sensingTask(void* parameter) {
+  TickType_t lastWakeTime = xTaskGetTickCount();
+  for (;;) {
+    {
+      StageTimer timer(stageMetrics, STAGE_SENSING_LOOP);
+      runSensingCycle();
     }
+    // Standby drains more samples per pass; their timestamps come from the sample count
+    uint32_t periodMs = standbyPolicy.isLowPower() ? SENSING_TASK_STANDBY_PERIOD_MS : SENSING_TASK_PERIOD_MS;
+    vTaskDelayUntil(&lastWakeTime, pdMS_TO_TICKS(periodMs));
   }
+}
 
-  // --- Main Heater Control State Machine ---
-  // Only run if smoothedTempC is a valid number
-  if (!isnan(smoothedTempC)) {
-    switch (currentHeaterState) {
-        case IDLE:
-          // --- Early Cutoff Cooldown Check ---
-          if (inEarlyCutoffCooldown) {
-            if (currentMillis >= earlyCutoffCooldownEndTime) {
-              inEarlyCutoffCooldown = false; // Cooldown finished
-              Serial.println("IDLE: Early cutoff cooldown finished.");
-              updateOledStatus("Cooldown Over");
-            } else {
-              // Serial.println("IDLE: In early cutoff cooldown. Skipping heating checks.");
-              break; // Exit IDLE state logic for this loop iteration
-            }
-          }
-          // --- End Early Cutoff Cooldown Check ---
-
-          // --- Machine Presumed Off Logic ---
-          if (machineIsPresumedOff) {
-            digitalWrite(RELAY_PIN, LOW); // Keep relay ON (LOW) in standby
-            isRelayOn = true;
-            web_isRelayOn = true;
-
-            if (currentMillis - lastRateCheckTime >= RATE_CHECK_INTERVAL_MS) {
-              float deltaTimeSeconds = (float)(currentMillis - lastRateCheckTime) / 1000.0f;
-              if (deltaTimeSeconds > 0) {
-                float rateOfChange = (smoothedTempC - previousTempForRateCheck) / deltaTimeSeconds;
-                previousTempForRateCheck = smoothedTempC; // Update for next check
-                lastRateCheckTime = currentMillis;
-
-                if (rateOfChange > 0.1) { // If temp rises by more than 0.1 C/sec (e.g. machine turned on)
-                  machineIsPresumedOff = false;
-                  isMonitoringForMachineOff = false; // Reset monitoring flag
-                  if (consecutiveFailedHeatingAttempts > 0) {
-                    Serial.println("Machine power detected, consecutive heating failures reset.");
-                  }
-                  consecutiveFailedHeatingAttempts = 0; // Reset on machine power detection
-                  Serial.println("Machine power detected (temp rise rate). Exiting standby, resuming normal control.");
-                  updateOledStatus("Machine On");
-                  // Fall through to normal IDLE logic below in the same cycle or next
-                }
-              }
-            }
-            break; // In presumed off mode, skip normal IDLE heating logic
-          }
-          // --- End Machine Presumed Off Logic ---
-
-
-          // Normal IDLE state operation (not in cooldown, not in presumed off)
-          // --- New Machine Presumed Off Monitoring Logic ---
-          if (!machineIsPresumedOff) { // Only monitor if not already presumed off
-            // Start/Continue Monitoring Condition:
-            // Monitor if current temp is below threshold AND system is trying to maintain a temp at or above threshold
-            if (smoothedTempC < PRESUMED_OFF_TEMP_THRESHOLD_C && desiredTemperatureC >= PRESUMED_OFF_TEMP_THRESHOLD_C) {
-              if (!isMonitoringForMachineOff) { // Start of monitoring
-                isMonitoringForMachineOff = true;
-                machineOffMonitorStartTime = currentMillis;
-                lastTempDuringMachineOffMonitoring = smoothedTempC;
-                lastMachineOffCheckTimestamp = currentMillis;
-                Serial.println("Temp < THRESHOLD & desired is high. Starting to monitor for presumed machine off.");
-                updateOledStatus("Monitoring Power..."); // Plan's message
-              } else { // Continue monitoring
-                if (currentMillis - lastMachineOffCheckTimestamp >= PRESUMED_OFF_CHECK_INTERVAL_MS) {
-                  if (smoothedTempC <= lastTempDuringMachineOffMonitoring) { // Temp is decreasing or stable
-                    lastTempDuringMachineOffMonitoring = smoothedTempC; // Update with current temp
-                    bool tempLowForDuration = (currentMillis - machineOffMonitorStartTime >= PRESUMED_OFF_DURATION_MS);
-                    bool maxFailuresReached = (consecutiveFailedHeatingAttempts >= MAX_CONSECUTIVE_HEATING_FAILURES);
-
-                    if (tempLowForDuration || maxFailuresReached) {
-                      machineIsPresumedOff = true;
-                      web_early_cutoff_signal = true; // Signal client for plot reset
-                      isMonitoringForMachineOff = false; // Stop monitoring once presumed off
-                      previousTempForRateCheck = smoothedTempC; // Init for power-on detection
-                      lastRateCheckTime = currentMillis;      // Init for power-on detection
-
-                      if (maxFailuresReached) {
-                        Serial.println("Max heating failures reached. Machine presumed off due to heating issues.");
-                        // web_early_cutoff_signal is already set above if this block is reached
-                        updateOledStatus("Err: Heat Fail");
-                      } else { // tempLowForDuration must be true
-                        Serial.println("Temp consistently low for PRESUMED_OFF_DURATION_MS. Machine presumed off.");
-                        updateOledStatus("Machine Off. Relay On");
-                      }
-
-                      // Ensure heater is ON when machine is presumed off
-                      digitalWrite(RELAY_PIN, LOW); // Heater ON (Relay is Active LOW)
-                      isRelayOn = true;
-                      web_isRelayOn = true;
-                      Serial.println(F("IDLE: Heater activated for presumed machine off state."));
-                      // Built-in LED will be turned OFF by the logic at the beginning of loop() for machineIsPresumedOff.
-                    }
-                    // else, still waiting for PRESUMED_OFF_DURATION_MS to elapse
-                  } else { // Temp has increased while monitoring below threshold (smoothedTempC > lastTempDuringMachineOffMonitoring)
-                    isMonitoringForMachineOff = false; // Machine activity detected, stop monitoring
-                    Serial.println("Temp increased while monitoring for presumed off. Resetting monitoring.");
-                    updateOledStatus("Monitoring Halted"); // Plan's message
-                  }
-                  lastMachineOffCheckTimestamp = currentMillis; // Reset check interval timestamp
-                }
-              }
-            } else { // Start/Continue Monitoring Condition NOT met (e.g., temp rose above threshold, or desired temp was lowered below threshold)
-              if (isMonitoringForMachineOff) { // If we were monitoring
-                isMonitoringForMachineOff = false; // Stop monitoring
-                Serial.println("Monitoring condition (temp < THRESHOLD or desired >= THRESHOLD) no longer met. Stopped monitoring.");
-                updateOledStatus("Monitoring Stopped"); // Plan's message
-              }
-            }
-          }
-          // --- End New Machine Presumed Off Monitoring Logic ---
-
-          // If not presumed off AND not currently monitoring for it, then proceed with normal heating logic
-          if (!machineIsPresumedOff) { // Allow heating even if monitoring, as long as not yet presumed off
-            // Check if temperature has dropped enough below desired to start heating
-            // The -1.0 acts as a hysteresis or deadband.
-            double tempDifferenceToDesired = desiredTemperatureC - smoothedTempC;
-            if (tempDifferenceToDesired >= .5) {
-              Serial.print("IDLE: Triggering heat. Current T: "); Serial.print(smoothedTempC, 1);
-              Serial.print("C, Desired T: "); Serial.print(desiredTemperatureC, 1); Serial.println("C.");
-              updateOledStatus("Heating...");
-
-              unsigned long calculatedHeatDurationMs = (unsigned long)(tempDifferenceToDesired * HEATER_SECONDS_PER_DEGREE_C * 1000.0f);
-              
-              if (calculatedHeatDurationMs > MAX_HEATER_ON_DURATION_MS) {
-                calculatedHeatDurationMs = MAX_HEATER_ON_DURATION_MS;
-                Serial.println("Heater duration capped by MAX_HEATER_ON_DURATION_MS");
-                
-              }
-              if (calculatedHeatDurationMs < 2000 && tempDifferenceToDesired > 0.1) { // Min 2 sec heating if meaningfully below
-                  calculatedHeatDurationMs = 2000;
-              }
+// --- Network Task Helpers ---
+// Updates the OLED fields from the latest snapshots and sends what changed. Only the
+// network task touches the display.
+void updateOledDisplay(const ControlSnapshot& control, const PressureSnapshot& pressure, unsigned long currentMillis) {
+  char text[OledView::MAX_TEXT];
 
-              if (calculatedHeatDurationMs >= 2000) { // Only heat if duration is meaningful
-                digitalWrite(RELAY_PIN, LOW); // Heater ON
-                isRelayOn = true;
-                web_isRelayOn = true;
-                currentHeaterState = HEATING;
-                heaterStopTimeMs = currentMillis + calculatedHeatDurationMs;
-                lastCalculatedHeatDurationMs = calculatedHeatDurationMs; // Store for early cutoff logic
-                Serial.print("Calculated heat duration: ");
-                Serial.print(calculatedHeatDurationMs / 1000.0f, 1);
-                Serial.println("s. State: HEATING");
-                // updateOledStatus("Heating..."); // Already set
-              }
-            }
-          }
-          break;
+  if (isnan(control.smoothedTempC)) {
+    oledView.setText(oledTemperatureField, "--.-");
+  } else {
+    snprintf(text, sizeof(text), "%.1f", control.smoothedTempC);
+    oledView.setText(oledTemperatureField, text);
+  }
 
-        case HEATING:
-          // Early cutoff for long heating cycles if temp reaches EARLY_CUTOFF_TEMP_C
-          if (lastCalculatedHeatDurationMs > 30000 && smoothedTempC >= EARLY_CUTOFF_TEMP_C) {
-            digitalWrite(RELAY_PIN, HIGH); // Heater OFF
-            isRelayOn = false;
-            web_isRelayOn = false;
-            inEarlyCutoffCooldown = true; // Activate cooldown
-            earlyCutoffCooldownEndTime = currentMillis + EARLY_CUTOFF_COOLDOWN_DURATION_MS;
-            currentHeaterState = SETTLING;
-            settlingCheckStartTimeMs = currentMillis;
-            tempAtSettlingCheckStartC = smoothedTempC;
-            Serial.print("HEATING: Early cutoff for long heat cycle. Trigger: ");
-            Serial.print(EARLY_CUTOFF_TEMP_C, 1); Serial.print("C. Current Temp: ");
-            Serial.print(smoothedTempC, 1);
-            Serial.println("C. State: SETTLING.");
-            updateOledStatus("EarlyCutoffSetlng");
-          }
-          // Original timer-based logic
-          else if (currentMillis >= heaterStopTimeMs) { // Time to check if we should stop or continue
-            bool shouldContinueHeating = false;
-            // If timer is up, check if we are still below the early cutoff threshold AND below desired temp
-            if (smoothedTempC < EARLY_CUTOFF_TEMP_C) { 
-              double tempDifferenceToDesired = desiredTemperatureC - smoothedTempC;
-              // Only continue heating if we are meaningfully below desired temp
-              if (tempDifferenceToDesired > 0.1) { 
-                unsigned long remainingHeatDurationMs = (unsigned long)(tempDifferenceToDesired * HEATER_SECONDS_PER_DEGREE_C * 1000.0f);
-                
-                if (remainingHeatDurationMs > MAX_HEATER_ON_DURATION_MS) remainingHeatDurationMs = MAX_HEATER_ON_DURATION_MS;
-                
-                if (remainingHeatDurationMs < 1000 && tempDifferenceToDesired > 0.1) { // Min 1 sec more if needed
-                    remainingHeatDurationMs = 1000;
-                }
+  snprintf(text, sizeof(text), "S:%.1fC", control.desiredTempC);
+  oledView.setText(oledSetPointField, text);
 
-                if (remainingHeatDurationMs >= 1000) {
-                    heaterStopTimeMs = currentMillis + remainingHeatDurationMs; // Extend heating time
-                    lastCalculatedHeatDurationMs = remainingHeatDurationMs; // Update for next potential early cutoff check
-                    shouldContinueHeating = true;
-                    Serial.print("HEATING: Timer up, but <EARLY_CUTOFF_TEMP_C & <desired. Continuing for ");
-                    Serial.print(remainingHeatDurationMs / 1000.0f, 1);
-                    Serial.println("s more.");
-                    updateOledStatus("Heating Cont.");
-                }
-              }
-            }
+  if (isnan(pressure.pressureBar)) {
+    oledView.setText(oledPressureField, "--.-");
+  } else {
+    snprintf(text, sizeof(text), "%.1f", pressure.pressureBar);
+    oledView.setText(oledPressureField, text);
+  }
 
-            if (!shouldContinueHeating) {
-              digitalWrite(RELAY_PIN, HIGH); // Heater OFF
-              isRelayOn = false;
-              web_isRelayOn = false;
-              // After heating, always go to SETTLING to observe temperature behavior
-              currentHeaterState = SETTLING;
-              settlingCheckStartTimeMs = currentMillis;
-              tempAtSettlingCheckStartC = smoothedTempC;
-              Serial.println("State: SETTLING. Starting observation.");
-              updateOledStatus("Settling...");
-            }
-          }
-          break;
+  if (isnan(pressure.maxObservedPressure) || pressure.maxObservedPressure < 0.01) {
+    oledView.setText(oledMaxPressureField, "MxP:--.-");
+  } else {
+    snprintf(text, sizeof(text), "MxP:%.1f", pressure.maxObservedPressure);
+    oledView.setText(oledMaxPressureField, text);
+  }
 
-        case SETTLING:
-          if (currentMillis - settlingCheckStartTimeMs >= SETTLED_OBSERVATION_PERIOD_MS) {
-            // Observation period ended, check temperature rise
-            double tempRiseDuringObservation = smoothedTempC - tempAtSettlingCheckStartC;
-            if (tempRiseDuringObservation <= SETTLED_TEMP_RISE_MAX_C) {
-              // Temperature is considered settled
-              currentHeaterState = IDLE;
-              isMonitoringForMachineOff = false; // Reset monitoring flag
-              Serial.print("Temp rise: "); Serial.print(tempRiseDuringObservation, 2);
-              Serial.println("C. Settled. State: IDLE");
-
-              // Check if heating was successful or if it's a failed attempt
-              if (smoothedTempC < (desiredTemperatureC - TEMP_DIFF_THRESHOLD_FOR_HEATING_FAILURE)) {
-                consecutiveFailedHeatingAttempts++;
-                Serial.print("Heating attempt considered failed. Consecutive failures: ");
-                Serial.println(consecutiveFailedHeatingAttempts);
-                if (consecutiveFailedHeatingAttempts >= MAX_CONSECUTIVE_HEATING_FAILURES) {
-                  Serial.println("Max heating failures reached. Machine will enter presumed off state.");
-                  updateOledStatus("Max Heat Fails");
-                } else {
-                  updateOledStatus("Heat Fail #" + String(consecutiveFailedHeatingAttempts));
-                }
-              } else {
-                if (consecutiveFailedHeatingAttempts > 0) { // If there were failures, log the reset
-                    Serial.println("Heating successful or temp acceptable, consecutive failures reset.");
-                }
-                consecutiveFailedHeatingAttempts = 0; // Reset on successful/acceptable heating outcome
-                updateOledStatus("Idle (Settled)");
-              }
-            } else {
-              // Temperature still rising too much, restart observation window
-              settlingCheckStartTimeMs = currentMillis;
-              tempAtSettlingCheckStartC = smoothedTempC;
-              Serial.print("Temp rise: "); Serial.print(tempRiseDuringObservation, 2);
-              Serial.println("C. Not settled. Restarting observation.");
-              updateOledStatus("Temp rise.Resettle CHK");
-            }
-          }
-          // If still in settling period, do nothing, just wait. Heater is already off.
-          break;
-    }
+  if (pressure.isShotRunning || pressure.shotDuration_ms > 0) {
+    snprintf(text, sizeof(text), "%.1f", pressure.shotDuration_ms / 1000.0);
+    oledView.setText(oledShotTimeField, text);
+  } else {
+    oledView.setText(oledShotTimeField, "--.-");
   }
 
+  char statusText[OLED_STATUS_MAX_LEN];
+  oledStatusMailbox.read(statusText);
+  oledView.setText(oledStatusField, statusText); // Cut to the field width by the view
 
-  // --- OLED Display Update ---
-  // Only update display if it's time (e.g., every 500ms or 1s) to avoid flicker and save CPU
-  // This timing is implicitly handled by the tempReadInterval for now, which is 500ms.
-  // If tempReadInterval becomes very short, add a separate display update timer.
-  if (currentMillis - lastTempReadTime < tempReadInterval) { // Use the same timing as temp reading for now
-    display.clearDisplay();
+#ifdef ENABLE_DATETIME_WEATHER_FEATURE
+  time_t now = time(NULL);
+  struct tm localNow;
+  if (now >= MIN_VALID_EPOCH && localtime_r(&now, &localNow)) {
+    strftime(text, sizeof(text), "%H:%M:%S", &localNow);
+    oledView.setText(oledClockField, text);
+  } else {
+    oledView.setText(oledClockField, "--:--:--");
+  }
+
+  WeatherReading weather = weatherSnapshot.read();
+  if (!weather.valid) {
+    oledView.setText(oledWeatherField, "  E:--C");
+  } else {
+    bool stale = currentMillis - weather.fetchedAtMs > WeatherFetcherConfig().staleAfterMs;
+    snprintf(text, sizeof(text), "  E:%.0fC%s", weather.temperatureC, stale ? "?" : ""); // "?": last good value is old
+    oledView.setText(oledWeatherField, text);
+  }
+#endif
 
-    int current_y = 0;
-    const int gap = 6; // Consistent gap between major items
-    const int small_gap = 4; // Smaller gap for related items like time/weather or status lines
+  oledView.render(currentMillis);
+}
 
-    // Line 1: Current Temperature
-    display.setTextSize(2);
-    display.setCursor(0, current_y);
-    if (isnan(smoothedTempC)) {
-      display.print(F("--.-"));
-    } else {
-      display.print(smoothedTempC, 1);
+// One job per periodic duty, in the order they ran in the former polling loop. Each reads
+// the snapshots it needs itself.
+void webJob(uint32_t nowMs) {
+  {
+    StageTimer timer(stageMetrics, STAGE_WIFI);
+    handleWiFiConnection();
+  }
+  if (currentWiFiState == WIFI_CONNECTED) {
+    {
+      StageTimer timer(stageMetrics, STAGE_OTA);
+      ArduinoOTA.handle();
     }
-    display.setTextSize(1); // Smaller for unit
-    display.print(F("C"));
-    current_y += 16; // Height of TextSize 2
-
-    // Line 2: Desired Temperature
-    current_y += gap;
-    display.setTextSize(1);
-    display.setCursor(0, current_y);
-    display.print(F("S:"));
-    display.print(desiredTemperatureC, 1);
-    display.print(F("C"));
-    current_y += 8; // Height of TextSize 1
-
-    // Line 3: Current Pressure
-    current_y += gap;
-    display.setTextSize(2);
-    display.setCursor(0, current_y);
-    if (isnan(web_pressureBar)) {
-      display.print(F("--.-"));
-    } else {
-      display.print(web_pressureBar, 1);
+    {
+      StageTimer timer(stageMetrics, STAGE_HTTP);
+      server.handleClient(); // Handle web server requests
     }
-    display.setTextSize(1); // Smaller for unit
-    display.print(F("bar"));
-    current_y += 16; // Height of TextSize 2
-
-    // Line 4: Max Pressure
-    current_y += gap;
-    display.setTextSize(1);
-    display.setCursor(0, current_y);
-    display.print(F("MxP:"));
-    if (isnan(maxObservedPressure) || maxObservedPressure < 0.01) {
-      display.print(F("--.-"));
-    } else {
-      display.print(maxObservedPressure, 1);
+    StageTimer timer(stageMetrics, STAGE_TELEMETRY);
+    serviceTelemetryStream(controlSnapshot.read(), pressureSnapshot.read(), nowMs);
+    if (telemetryHub.clientCount() > 0) {
+      wakeFromStandby(); // A live page
     }
-    current_y += 8; // Height of TextSize 1
-
-    // Line 5: Shot Timer
-    current_y += gap;
-    display.setTextSize(2);
-    display.setCursor(0, current_y);
-    if (isShotRunning || web_shotDuration_ms > 0) {
-        display.print(web_shotDuration_ms / 1000.0, 1);
-    } else {
-        display.print(F("--.-"));
+  }
+}
+
+void commandJob(uint32_t nowMs) {
+  if (thermalModelSaveRequested.exchange(false)) {
+    saveThermalModel(thermalModelSnapshot.read().model);
+  }
+}
+
+void historyJob(uint32_t nowMs) {
+  StageTimer timer(stageMetrics, STAGE_HISTORY);
+  if (historyClearRequested.exchange(false)) {
+    clearHistory();
+  }
+  ControlSnapshot control = controlSnapshot.read();
+  PressureSnapshot pressure = pressureSnapshot.read();
+  if (!control.isTempPlotPaused) {
+    tempHistory.add(nowMs, (float)control.smoothedTempC); // NaN is skipped
+  }
+  if (!pressure.isPressurePlotPaused) {
+    pressureHistory.add(nowMs, pressure.pressureBar);
+  }
+}
+
+void shotLogJob(uint32_t nowMs) {
+  StageTimer timer(stageMetrics, STAGE_SHOT_LOG);
+  recordShots(controlSnapshot.read(), pressureSnapshot.read(), nowMs);
+}
+
+void ledJob(uint32_t nowMs) {
+  ControlSnapshot control = controlSnapshot.read();
+  // --- Built-in LED Blinking Logic ---
+  // LED_BUILTIN: HIGH = ON, LOW = OFF (as per user feedback)
+  if (control.machineIsPresumedOff) {
+    // Machine is presumed off: LED OFF
+    digitalWrite(LED_BUILTIN, LOW); // LED OFF (LOW = OFF)
+  } else if (!isnan(control.smoothedTempC) && control.smoothedTempC > 103.0) {
+    // 5. Temperature above 103°C: Very rapid blinking
+    if (nowMs - lastBlinkTimeLed >= blinkIntervalVeryRapid) {
+      lastBlinkTimeLed = nowMs;
+      digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN)); // Toggle LED
     }
-    display.setTextSize(1);
-    display.print(F("s"));
-    current_y += 16; // Height of TextSize 2
-
-    // Line 6: Status Message (single line)
-    current_y += gap;
-    display.setTextSize(1);
-    display.setCursor(0, current_y);
-    String statusMsg = oledStatusMessage;
-    int maxCharsPerLine = display.width() / 6;
-    if (maxCharsPerLine == 0) maxCharsPerLine = 10;
-    if (statusMsg.length() > maxCharsPerLine) {
-        statusMsg = statusMsg.substring(0, maxCharsPerLine);
+  } else if ((control.heaterState == HEATING || (control.heaterState == REGULATING && control.heaterDuty >= 0.5f)) &&
+             control.smoothedTempC > 80.0) {
+    // 2. Heating (burst, or mostly-on duty windows): Fast blinking
+    if (nowMs - lastBlinkTimeLed >= blinkIntervalRapid) {
+      lastBlinkTimeLed = nowMs;
+      digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN)); // Toggle LED
     }
-    display.print(statusMsg);
-    current_y += 8;
-
-#ifdef ENABLE_DATETIME_WEATHER_FEATURE
-    // Line 7: Time and External Weather Temperature
-    current_y += small_gap;
-    display.setCursor(0, current_y);
-    display.print(currentTimeStr.substring(0, 8)); // HH:MM
-    
-    String weatherStr = " E:--C";
-    if (!isnan(currentWeatherDataTemp)) {
-        weatherStr = "    E:" + String(currentWeatherDataTemp, 0) + "C";
+  } else if (!isnan(control.smoothedTempC) && (control.smoothedTempC >= control.desiredTempC - 1.0 && control.smoothedTempC <= control.desiredTempC + 1.0)) {
+    // 3. Temperature in +/-1 of set temperature: Steady on
+    digitalWrite(LED_BUILTIN, HIGH); // LED ON (HIGH = ON)
+  } else if (control.heaterState == SETTLING) {
+    // 4. Temperature not in +/-1 of set temperature and settle check is going on: Slow blinking
+    // This condition is met if the previous "steady on" condition was false.
+    if (nowMs - lastBlinkTimeLed >= blinkIntervalSlow) {
+      lastBlinkTimeLed = nowMs;
+      digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN)); // Toggle LED
     }
-    display.print(weatherStr);
-    current_y += 8;
-#endif
+  } else {
+    // 1. Default led state (when not presumed off and no other condition met): light off
+    // This includes IDLE state when not meeting other conditions.
+    digitalWrite(LED_BUILTIN, LOW); // LED OFF (LOW = OFF)
+  }
+}
+
+void statusLedJob(uint32_t nowMs) {
+  digitalWrite(STATUS_LED_PIN, !digitalRead(STATUS_LED_PIN)); // Toggle Status LED
+}
+
+// Frame-capped by the job period; each frame sends only the changed glyphs, within
+// OLED_MAX_BYTES_PER_FRAME
+void oledJob(uint32_t nowMs) {
+  StageTimer timer(stageMetrics, STAGE_OLED);
+  updateOledDisplay(controlSnapshot.read(), pressureSnapshot.read(), nowMs);
+}
+
+// Network side of the low-power level: slower polling, CPU clock, WiFi power save and OLED
+// brightness. The clock change keeps the 80 MHz APB, so I2S, I2C and the UART run on.
+void applyPowerLevel(bool lowPower) {
+  networkStandby = lowPower;
+  networkJobs.setPeriod(webJobId, lowPower ? WEB_JOB_STANDBY_MS : WEB_JOB_MS);
+  networkJobs.setPeriod(ledJobId, lowPower ? LED_JOB_STANDBY_MS : LED_JOB_MS);
+  networkJobs.setPeriod(oledJobId, lowPower ? OLED_JOB_STANDBY_MS : OLED_FRAME_INTERVAL_MS);
+  setCpuFrequencyMhz(lowPower ? STANDBY_CPU_MHZ : FULL_CPU_MHZ);
+  stageMetrics.changeClock(getCpuFrequencyMhz()); // CCOUNT follows the CPU clock
+  WiFi.setSleep(lowPower ? WIFI_PS_MAX_MODEM : WIFI_PS_MIN_MODEM); // MIN_MODEM is the core's default
+  display.dim(lowPower);
+  Serial.printf("Power: %s, CPU %lu MHz.\n", lowPower ? "low-power standby" : "full rate",
+                (unsigned long)getCpuFrequencyMhz());
+}
 
-    display.display();
+// Follows the control task's StandbyPolicy decision within a second.
+void standbyJob(uint32_t nowMs) {
+  bool lowPower = standbyPolicy.isLowPower();
+  if (lowPower != networkStandby) applyPowerLevel(lowPower);
+}
+
+// Web requests end low-power standby at once; the other tasks see it on their next pass.
+// Only called on the network task (handlers run inside the web job).
+void wakeFromStandby() {
+  standbyPolicy.wake(millis());
+  if (networkStandby) applyPowerLevel(false);
+}
+
+void networkTask(void* parameter) {
+  webJobId = networkJobs.add("web", WEB_JOB_MS, webJob);
+  networkJobs.add("commands", COMMAND_JOB_MS, commandJob);
+  networkJobs.add("history", historySampleInterval, historyJob);
+  networkJobs.add("shot_log", SHOT_LOG_JOB_MS, shotLogJob);
+  ledJobId = networkJobs.add("led", LED_JOB_MS, ledJob);
+  networkJobs.add("status_led", statusLedToggleInterval, statusLedJob);
+  oledJobId = networkJobs.add("oled", OLED_FRAME_INTERVAL_MS, oledJob);
+  networkJobs.add("standby", STANDBY_JOB_MS, standbyJob);
+
+  if (METRICS_SERIAL_INTERVAL_MS > 0) networkJobs.add("metrics", METRICS_SERIAL_INTERVAL_MS, metricsSerialJob);
+
+  for (;;) {
+    {
+      StageTimer timer(stageMetrics, STAGE_NETWORK_LOOP);
+      networkJobs.runDue(millis());
+    }
+    // Sleep until the next deadline; at least one tick so the idle task always gets to run
+    TickType_t waitTicks = pdMS_TO_TICKS(networkJobs.msUntilNext(millis()));
+    vTaskDelay(waitTicks > 0 ? waitTicks : 1);
   }
-}
\ No newline at end of file
+}
+
+void loop() {
+  // All work runs in the control, sensing and network tasks started from setup().
+  vTaskDelete(NULL);
+}
@@ -0,0 +1,20 @@
+#include "bench_report.h"
+
+#include <stdio.h>
+#include <string.h>
+
+bool scenarioSelected(const char* filter, const char* name) {
+  return strcmp(filter, "all") == 0 || strcmp(filter, name) == 0;
+}
+
+bool benchCheck(bool condition, const char* what, const char* scenario) {
+  if (condition) return true;
+  if (scenario) printf("  %s: FAILED: %s\n", scenario, what);
+  else printf("  FAILED: %s\n", what);
+  return false;
+}
+
+int benchResult(const char* bench, bool ok) {
+  printf("%s: %s\n", bench, ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,16 @@
+#ifndef BENCH_REPORT_H
+#define BENCH_REPORT_H
+
+// Scenario selection and pass/fail reporting shared by the simulator subcommands.
+
+// True when a --scenario value selects the named scenario ("all" selects every one).
+bool scenarioSelected(const char* filter, const char* name);
+
+// Prints "  FAILED: <what>", after the scenario name when one is given, unless the condition
+// holds; returns the condition so checks can be chained with &=.
+bool benchCheck(bool condition, const char* what, const char* scenario = nullptr);
+
+// Prints the closing "<bench>: ok" or "<bench>: FAILED" line; returns the subcommand's exit code.
+int benchResult(const char* bench, bool ok);
+
+#endif // BENCH_REPORT_H
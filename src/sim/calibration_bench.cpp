@@ -0,0 +1,334 @@
+// Checks and micro-benchmark for the N-point sensor calibration (lib/SensorCalibration).
+//
+// Every calibration in the firmware is a CalibrationCurve fitted in double and sampled into a
+// BasicCalibrationTable. This runs the tables in float and Q16.16 against the fitted curve
+// and against the two-point formulas they replaced (thermocouple line, linear pressure
+// transducer), recovers a known cubic with the polynomial fit, and feeds the parser and the
+// fit malformed input that must be rejected. Any check outside its bound is printed and makes
+// the program exit non-zero. Typical use:
+//
+//   .pio/build/native/program calibration
+//   .pio/build/native/program calibration --samples 2000000 --seed 3
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "CalibrationCurve.h"
+#include "CalibrationTable.h"
+#include "FixedPoint.h"
+#include "PressureScale.h"
+#include "SensorScalar.h"
+#include "TemperatureCalibration.h"
+#include "bench_report.h"
+#include "calibration_bench.h"
+
+namespace {
+
+// Firmware defaults (src/main.cpp)
+const double RAW_TEMPS_C[2] = {99.0, 115.0};
+const double ACTUAL_TEMPS_C[2] = {85.0, 97.8};
+const double VOLTS_AT_0_BAR = 0.34;
+const double VOLTS_AT_16_BAR = 4.34;
+const double PRESSURE_MAX_BAR = 16.0;
+const double ADC_MAX_VOLTAGE = 3.3;
+const double ADC_MAX_VALUE = 4095.0;
+
+// Allowed deviation (same bounds as `program fixed` for the two-point replacements)
+const double TEMPERATURE_BOUND_C = 0.005;
+const double PRESSURE_BOUND_BAR = 0.002;
+const double PIECEWISE_OFF_GRID_BOUND_C = 0.05; // Breakpoints between 1 C table samples
+const double POLYNOMIAL_TABLE_BOUND_C = 0.005;  // Curvature across one 1 C segment
+const double POLYNOMIAL_FIT_BOUND_C = 1e-4;     // Exact points of a cubic, stored as float
+
+// A thermocouple reading low and bending at the top, with breakpoints off the table grid
+const char* PIECEWISE_POINTS = "20.5:21.0,60.3:57.9,99:85,115:97.8,150.7:124.6";
+
+struct BenchOptions {
+  unsigned long samples = 500000;
+  unsigned seed = 1;
+};
+
+void printUsage() {
+  printf("usage: program calibration [options]\n"
+         "  --samples N        inputs per check and benchmark (default 500000)\n"
+         "  --seed N           input seed (default 1)\n");
+}
+
+bool parseOptions(int argc, char** argv, BenchOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--samples") == 0) options.samples = strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--seed") == 0) options.seed = (unsigned)atoi(value);
+    else return false;
+    i++;
+  }
+  return options.samples > 0;
+}
+
+// --- The replaced two-point formulas ---
+template <typename Scalar>
+struct TwoPointTemperature {
+  Scalar x1, y1, slope;
+  TwoPointTemperature()
+      : x1(RAW_TEMPS_C[0]), y1(ACTUAL_TEMPS_C[0]),
+        slope((ACTUAL_TEMPS_C[1] - ACTUAL_TEMPS_C[0]) / (RAW_TEMPS_C[1] - RAW_TEMPS_C[0])) {}
+  Scalar apply(Scalar raw) const { return y1 + (raw - x1) * slope; }
+};
+
+template <typename Scalar>
+struct LinearPressure {
+  Scalar countsAtZeroBar, countsSpan, maxBar;
+  LinearPressure()
+      : countsAtZeroBar(VOLTS_AT_0_BAR / ADC_MAX_VOLTAGE * ADC_MAX_VALUE),
+        countsSpan((VOLTS_AT_16_BAR - VOLTS_AT_0_BAR) / ADC_MAX_VOLTAGE * ADC_MAX_VALUE), maxBar(PRESSURE_MAX_BAR) {}
+  Scalar toBar(Scalar counts) const {
+    Scalar bar = (counts - countsAtZeroBar) / countsSpan * maxBar;
+    return bar < Scalar(0) ? Scalar(0) : bar;
+  }
+};
+
+// --- Inputs ---
+// Raw thermocouple readings in 0.25 C steps across the table and a little past it.
+std::vector<double> makeTemperatures(unsigned long count) {
+  std::vector<double> temps(count);
+  for (unsigned long i = 0; i < count; i++) temps[i] = (rand() % 1160) * 0.25; // 0..290 C
+  return temps;
+}
+
+std::vector<double> makeCounts(unsigned long count) {
+  std::vector<double> counts(count);
+  for (unsigned long i = 0; i < count; i++) counts[i] = (rand() % 40960) / 10.0; // 0..4095.9
+  return counts;
+}
+
+// --- Error bounds ---
+struct ErrorBound {
+  const char* name;
+  double bound;
+  double worst = 0.0;
+
+  ErrorBound(const char* checkName, double limit) : name(checkName), bound(limit) {}
+  void add(double error) {
+    if (!(fabs(error) <= worst)) worst = fabs(error); // NaN counts as unbounded
+  }
+  bool report(const char* type) const {
+    bool ok = worst <= bound;
+    printf("  %-8s %-40s worst %.6f (bound %.4f) %s\n", type, name, worst, bound, ok ? "ok" : "EXCEEDED");
+    return ok;
+  }
+};
+
+CalibrationCurve parseCurve(const char* points, CalibrationFit fit, int degree) {
+  CalibrationCurve curve;
+  curve.fit = fit;
+  curve.degree = degree;
+  curve.pointCount = 0;
+  parseCalibrationPoints(points, curve);
+  return curve;
+}
+
+// Known cubic, sampled at eight points across the thermocouple range
+double cubic(double raw) { return 2.0 + 0.9 * raw + 4e-4 * raw * raw - 1.5e-6 * raw * raw * raw; }
+
+CalibrationCurve cubicCurve() {
+  CalibrationCurve curve;
+  curve.fit = CALIBRATION_POLYNOMIAL;
+  curve.degree = 3;
+  curve.pointCount = 8;
+  for (int i = 0; i < curve.pointCount; i++) {
+    double raw = 20.0 + 20.0 * i;
+    curve.points[i].raw = (float)raw;
+    curve.points[i].actual = (float)cubic(raw);
+  }
+  return curve;
+}
+
+template <typename Scalar>
+bool checkTables(const char* type, const std::vector<double>& temps, const std::vector<double>& counts) {
+  ErrorBound twoPoint("two-point temperature vs former line", TEMPERATURE_BOUND_C);
+  ErrorBound piecewise("5-point piecewise vs curve", PIECEWISE_OFF_GRID_BOUND_C);
+  ErrorBound polynomial("cubic fit vs true cubic", POLYNOMIAL_TABLE_BOUND_C);
+  ErrorBound pressure("linear pressure vs former scale", PRESSURE_BOUND_BAR);
+
+  BasicTemperatureCalibration<Scalar> defaultCalibration(RAW_TEMPS_C, ACTUAL_TEMPS_C, 2);
+  TwoPointTemperature<double> formerLine;
+  CalibrationCurve piecewiseCurve = parseCurve(PIECEWISE_POINTS, CALIBRATION_PIECEWISE, 1);
+  CalibrationFunction piecewiseFunction;
+  piecewiseFunction.fit(piecewiseCurve);
+  BasicTemperatureCalibration<Scalar> piecewiseCalibration(piecewiseCurve);
+  BasicTemperatureCalibration<Scalar> cubicCalibration(cubicCurve());
+  for (size_t i = 0; i < temps.size(); i++) {
+    double raw = temps[i];
+    twoPoint.add((double)defaultCalibration.apply(Scalar(raw)) - formerLine.apply(raw));
+    piecewise.add((double)piecewiseCalibration.apply(Scalar(raw)) - piecewiseFunction.evaluate(raw));
+    if (raw >= 20.0 && raw <= 160.0) {
+      polynomial.add((double)cubicCalibration.apply(Scalar(raw)) - cubic(raw)); // Inside the points
+    }
+  }
+
+  BasicPressureScale<Scalar> scale(VOLTS_AT_0_BAR, VOLTS_AT_16_BAR, PRESSURE_MAX_BAR, ADC_MAX_VOLTAGE, ADC_MAX_VALUE);
+  LinearPressure<double> formerScale;
+  for (size_t i = 0; i < counts.size(); i++) {
+    pressure.add((double)scale.toBar(Scalar(counts[i])) - formerScale.toBar(counts[i]));
+  }
+
+  bool ok = twoPoint.report(type);
+  ok = piecewise.report(type) && ok;
+  ok = polynomial.report(type) && ok;
+  ok = pressure.report(type) && ok;
+  return ok;
+}
+
+// --- Fit and parser checks ---
+struct CheckCount {
+  int failed = 0;
+
+  void expect(bool condition, const char* what) {
+    if (!benchCheck(condition, what)) failed++;
+  }
+};
+
+bool rejectsPoints(const char* text) {
+  CalibrationCurve curve;
+  curve.pointCount = 0;
+  return !parseCalibrationPoints(text, curve) && curve.pointCount == 0;
+}
+
+bool rejectsFit(const char* points, CalibrationFit fit, int degree) {
+  CalibrationCurve curve = parseCurve(points, fit, degree);
+  CalibrationFunction function;
+  return !function.fit(curve) && function.error() != nullptr;
+}
+
+int checkFits() {
+  CheckCount checks;
+
+  CalibrationCurve curve;
+  curve.pointCount = 0;
+  checks.expect(parseCalibrationPoints("115:97.8, 99:85", curve) && curve.pointCount == 2 &&
+                    curve.points[0].raw == 99.0f && curve.points[1].actual == 97.8f,
+                "points are parsed and sorted by raw value");
+  checks.expect(rejectsPoints(""), "empty point list");
+  checks.expect(rejectsPoints("99:85,99:86"), "repeated raw value");
+  checks.expect(rejectsPoints("99;85"), "missing colon");
+  checks.expect(rejectsPoints("99:85,abc:1"), "non-numeric raw value");
+  checks.expect(rejectsPoints("99:85 115:97.8"), "missing separator");
+  checks.expect(rejectsPoints("1:1,2:2,3:3,4:4,5:5,6:6,7:7,8:8,9:9,10:10,11:11,12:12,13:13,14:14,15:15,16:16,17:17"),
+                "more than 16 points");
+
+  checks.expect(rejectsFit("99:85", CALIBRATION_PIECEWISE, 1), "a single point");
+  checks.expect(rejectsFit("10:20,20:10", CALIBRATION_PIECEWISE, 1), "falling curve");
+  checks.expect(rejectsFit("10:10,20:20,30:20", CALIBRATION_PIECEWISE, 1), "flat segment");
+  checks.expect(rejectsFit("10:10,20:20,30:30", CALIBRATION_POLYNOMIAL, 3), "cubic through 3 points");
+  checks.expect(rejectsFit("10:10,20:20,30:30,40:40,50:50", CALIBRATION_POLYNOMIAL, 4), "degree above 3");
+  checks.expect(rejectsFit("10:10,20:30,30:31,40:20", CALIBRATION_POLYNOMIAL, 2), "parabola turning back");
+
+  CalibrationFunction function;
+  checks.expect(function.fit(cubicCurve()) && function.maxResidual() < POLYNOMIAL_FIT_BOUND_C, "cubic recovered at its points");
+  double worst = 0.0;
+  for (double raw = 20.0; raw <= 160.0; raw += 0.1) {
+    double error = fabs(function.evaluate(raw) - cubic(raw));
+    if (error > worst) worst = error;
+  }
+  checks.expect(worst < POLYNOMIAL_FIT_BOUND_C, "cubic recovered between its points");
+
+  // A line fitted as a quadratic through noisy points keeps a residual; piecewise hits every point
+  CalibrationCurve noisy = parseCurve("20:21,60:58.2,100:96.1,140:135.4", CALIBRATION_POLYNOMIAL, 1);
+  checks.expect(function.fit(noisy) && function.maxResidual() > 0.1, "least-squares line leaves residuals");
+  noisy.fit = CALIBRATION_PIECEWISE;
+  checks.expect(function.fit(noisy) && function.maxResidual() < 1e-9, "piecewise passes through the points");
+
+  // A rejected curve leaves the previous table in place
+  TemperatureCalibration calibration(RAW_TEMPS_C, ACTUAL_TEMPS_C, 2);
+  SensorScalar before = calibration.apply(SensorScalar(107.0f));
+  checks.expect(!calibration.load(parseCurve("10:20,20:10", CALIBRATION_PIECEWISE, 1)) &&
+                    calibration.isValid() && (double)calibration.apply(SensorScalar(107.0f)) == (double)before,
+                "rejected curve keeps the previous calibration");
+  TemperatureCalibration unusable(RAW_TEMPS_C, ACTUAL_TEMPS_C, 1);
+  checks.expect(!unusable.isValid() && (double)unusable.apply(SensorScalar(107.0f)) == 107.0,
+                "no usable curve: raw readings pass through");
+
+  printf("  %d fit and parser checks failed\n", checks.failed);
+  return checks.failed;
+}
+
+// --- Benchmark ---
+volatile double benchSink; // Keeps results observable so loops are not optimised away
+
+template <typename Body>
+void measure(const char* name, unsigned long samples, Body body) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  benchSink = body();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("  %-44s %8.2f ns/sample\n", name, seconds * 1e9 / samples);
+}
+
+template <typename Scalar, typename Converter>
+double runPressure(const Converter& converter, const std::vector<Scalar>& counts) {
+  Scalar sum(0);
+  for (size_t i = 0; i < counts.size(); i++) sum = sum + converter.toBar(counts[i]) * Scalar(0.001);
+  return (double)sum;
+}
+
+template <typename Scalar, typename Calibration>
+double runTemperature(const Calibration& calibration, const std::vector<Scalar>& temps) {
+  Scalar sum(0);
+  for (size_t i = 0; i < temps.size(); i++) sum = sum + calibration.apply(temps[i]) * Scalar(0.001);
+  return (double)sum;
+}
+
+template <typename Scalar>
+void benchmark(const char* type, const std::vector<double>& temps, const std::vector<double>& counts) {
+  std::vector<Scalar> scalarTemps(temps.size());
+  std::vector<Scalar> scalarCounts(counts.size());
+  for (size_t i = 0; i < temps.size(); i++) scalarTemps[i] = Scalar(temps[i]);
+  for (size_t i = 0; i < counts.size(); i++) scalarCounts[i] = Scalar(counts[i]);
+
+  char name[64];
+  TwoPointTemperature<Scalar> formerLine;
+  BasicTemperatureCalibration<Scalar> table(parseCurve(PIECEWISE_POINTS, CALIBRATION_PIECEWISE, 1));
+  LinearPressure<Scalar> formerScale;
+  BasicPressureScale<Scalar> scale(VOLTS_AT_0_BAR, VOLTS_AT_16_BAR, PRESSURE_MAX_BAR, ADC_MAX_VOLTAGE, ADC_MAX_VALUE);
+  snprintf(name, sizeof(name), "%s temperature, former 2-point line", type);
+  measure(name, temps.size(), [&]() { return runTemperature<Scalar>(formerLine, scalarTemps); });
+  snprintf(name, sizeof(name), "%s temperature, 5-point table", type);
+  measure(name, temps.size(), [&]() { return runTemperature<Scalar>(table, scalarTemps); });
+  snprintf(name, sizeof(name), "%s pressure, former divide", type);
+  measure(name, counts.size(), [&]() { return runPressure<Scalar>(formerScale, scalarCounts); });
+  snprintf(name, sizeof(name), "%s pressure, table", type);
+  measure(name, counts.size(), [&]() { return runPressure<Scalar>(scale, scalarCounts); });
+}
+
+} // namespace
+
+int runCalibrationBench(int argc, char** argv) {
+  BenchOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+  srand(options.seed);
+  const std::vector<double> temps = makeTemperatures(options.samples);
+  const std::vector<double> counts = makeCounts(options.samples);
+
+  printf("lookup tables over %lu samples:\n", options.samples);
+  bool ok = checkTables<float>("float", temps, counts);
+  ok = checkTables<Q16_16>("Q16.16", temps, counts) && ok;
+
+  printf("fits and parser:\n");
+  ok = checkFits() == 0 && ok;
+
+  // The host divides in hardware and caches the whole table, so the former formulas win here.
+  // On the ESP32 a float divide is an expanded reciprocal sequence and a Q16.16 divide a 64-bit
+  // library call, while the table costs the same for any number of points or degree.
+  printf("per-sample cost (host):\n");
+  benchmark<float>("float", temps, counts);
+  benchmark<Q16_16>("Q16.16", temps, counts);
+
+  return benchResult("calibration", ok);
+}
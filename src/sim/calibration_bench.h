@@ -0,0 +1,9 @@
+#ifndef CALIBRATION_BENCH_H
+#define CALIBRATION_BENCH_H
+
+// `program calibration [options]`: N-point calibration curves through their lookup tables
+// (error against the fitted curve and the former two-point formulas, fit and parser checks,
+// cost per sample).
+int runCalibrationBench(int argc, char** argv);
+
+#endif // CALIBRATION_BENCH_H
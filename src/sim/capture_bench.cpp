@@ -0,0 +1,245 @@
+// Host checks for the high-rate shot capture (lib/PressureCapture/src/ShotCapture.h).
+//
+// Synthetic shots are fed at the sensing rate (50 Hz) through the same trigger logic as
+// processPressureBlock() in the firmware: 100 ms SMA, shot start at 2.0 bar while the plot
+// is not paused, stop when the pressure falls through 1.7 bar, resume at 2.0 bar. Every
+// completed capture is compared sample by sample against the fed values, with the
+// pre-trigger window, gaps from capture overruns, truncation of an overlong shot and a
+// completed capture staying intact while the next shot records.
+//
+//   .pio/build/native/program capture
+//   .pio/build/native/program capture --csv capture.csv   # last capture, as /capture.csv
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "MovingAverage.h"
+#include "ShotCapture.h"
+#include "bench_report.h"
+#include "capture_bench.h"
+
+namespace {
+
+// Same budget as the firmware (SHOT_CAPTURE_* in src/main.cpp)
+const uint32_t PERIOD_MS = 20;
+const size_t CAPTURE_SAMPLES = 4000;
+const size_t PRE_TRIGGER_SAMPLES = 100;
+typedef ShotCapture<CAPTURE_SAMPLES, PRE_TRIGGER_SAMPLES> Capture;
+
+struct CaptureOptions {
+  unsigned seed = 1;
+  const char* csvPath = nullptr;
+};
+
+void printUsage() {
+  printf("usage: program capture [options]\n"
+         "  --seed N           noise seed (default 1)\n"
+         "  --csv PATH         write the last capture like GET /capture.csv\n");
+}
+
+bool parseOptions(int argc, char** argv, CaptureOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--seed") == 0) options.seed = (unsigned)strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--csv") == 0) options.csvPath = value;
+    else return false;
+    i++;
+  }
+  return true;
+}
+
+// Pressure of a shot `t` seconds after the pump starts: pre-infusion ramp to 3 bar, hold,
+// ramp to 9 bar, extraction with a slow decline, then the pump stops.
+float shotProfileBar(double t, double lengthS) {
+  if (t < 0.0 || t > lengthS) return 0.0f;
+  if (t < 1.0) return (float)(3.0 * t);
+  if (t < 5.0) return 3.0f;
+  if (t < 6.5) return (float)(3.0 + 6.0 * (t - 5.0) / 1.5);
+  if (t < lengthS - 0.5) return (float)(9.0 - 0.03 * (t - 6.5));
+  return (float)((9.0 - 0.03 * (lengthS - 7.0)) * (lengthS - t) / 0.5);
+}
+
+// Feeds values at PERIOD_MS through the capture and the firmware's shot timer logic, and
+// keeps what the capture should contain: every fed value, and the previous one held for
+// each period lost to a gap.
+struct Machine {
+  Capture capture;
+  MovingAverage<float, 5, double> smoothing;
+  bool shotRunning = false;
+  bool plotPaused = false;
+  float lastPressure = 0.0f;
+  uint32_t nowMs = 0;
+  std::vector<int16_t> expected; // Index: time / PERIOD_MS
+  std::vector<uint32_t> triggerTimes;
+  std::vector<uint32_t> stopTimes;
+  std::mt19937 random;
+  std::normal_distribution<float> noise;
+  // Completed capture that must stay untouched until the next one completes
+  ShotCaptureTrace watched;
+  std::vector<int16_t> watchedCopy;
+  bool watchedChanged = false;
+
+  explicit Machine(unsigned seed) : capture(PERIOD_MS), random(seed), noise(0.0f, 0.02f) {}
+
+  void feed(float bar) {
+    bar = fmaxf(0.0f, bar + noise(random));
+    capture.push(nowMs, bar);
+    int16_t centibar = (int16_t)lroundf(bar * 100.0f);
+    while (expected.size() < nowMs / PERIOD_MS) expected.push_back(expected.empty() ? 0 : expected.back());
+    expected.push_back(centibar);
+
+    float smoothed = (float)smoothing.update(bar);
+    if (smoothed >= 2.0f && !shotRunning && !plotPaused) {
+      shotRunning = true;
+      triggerTimes.push_back(nowMs);
+      capture.trigger();
+    }
+    if (smoothed < 1.7f && lastPressure >= 1.7f) {
+      if (!plotPaused) {
+        plotPaused = true;
+        if (shotRunning) {
+          shotRunning = false;
+          stopTimes.push_back(nowMs);
+          capture.stop();
+        }
+      }
+    } else if (smoothed >= 2.0f) {
+      plotPaused = false;
+    }
+    lastPressure = smoothed;
+    nowMs += PERIOD_MS;
+
+    if (!watchedCopy.empty() && capture.completed().generation == watched.generation &&
+        memcmp(watchedCopy.data(), watched.centibar, watchedCopy.size() * sizeof(int16_t)) != 0) {
+      watchedChanged = true;
+    }
+  }
+
+  void watchCompleted() {
+    watched = capture.completed();
+    watchedCopy.assign(watched.centibar, watched.centibar + watched.count);
+    watchedChanged = false;
+  }
+
+  void idle(double seconds) {
+    for (double t = 0.0; t < seconds; t += PERIOD_MS / 1000.0) feed(0.0f);
+  }
+
+  void shot(double lengthS, double gapAtS = -1.0, uint32_t gapPeriods = 0) {
+    for (double t = 0.0; t < lengthS + 1.0; t += PERIOD_MS / 1000.0) {
+      if (gapAtS >= 0.0 && fabs(t - gapAtS) < PERIOD_MS / 2000.0) nowMs += gapPeriods * PERIOD_MS; // Overrun
+      feed(shotProfileBar(t, lengthS));
+    }
+  }
+};
+
+// Compares the last completed capture against the fed values; prints the first mismatch.
+bool checkTrace(const Machine& machine, const ShotCaptureTrace& trace, const char* name, size_t expectedPreTrigger,
+                uint32_t expectedHeld, bool expectTruncated) {
+  bool ok = trace.generation == machine.triggerTimes.size();
+  ok = ok && trace.preTriggerCount == expectedPreTrigger && trace.heldSamples == expectedHeld;
+  ok = ok && trace.truncated == expectTruncated && trace.triggerTimeMs == machine.triggerTimes.back();
+  if (!ok) {
+    printf("  %s: generation %u, %u pre-trigger, %u held, truncated %d, trigger %u ms (expected %zu, %zu, %u, %d, %u)\n",
+           name, trace.generation, trace.preTriggerCount, trace.heldSamples, trace.truncated, trace.triggerTimeMs,
+           machine.triggerTimes.size(), expectedPreTrigger, expectedHeld, expectTruncated, machine.triggerTimes.back());
+    return false;
+  }
+  size_t first = trace.triggerTimeMs / PERIOD_MS - trace.preTriggerCount;
+  for (uint32_t i = 0; i < trace.count; i++) {
+    if (trace.centibar[i] != machine.expected[first + i]) {
+      printf("  %s: sample %u (%ld ms) is %d, expected %d\n", name, i,
+             ((long)i - (long)trace.preTriggerCount) * (long)PERIOD_MS, trace.centibar[i], machine.expected[first + i]);
+      return false;
+    }
+  }
+  // The capture ends with the sample that stopped the shot timer
+  uint32_t endMs = trace.triggerTimeMs + (trace.count - 1 - trace.preTriggerCount) * PERIOD_MS;
+  if (!trace.truncated && endMs != machine.stopTimes.back()) {
+    printf("  %s: capture ends at %u ms, shot timer stopped at %u ms\n", name, endMs, machine.stopTimes.back());
+    return false;
+  }
+  return true;
+}
+
+bool report(const char* name, bool ok, const ShotCaptureTrace& trace) {
+  printf("  %-34s %5u samples (%u before trigger, %u held%s): %s\n", name, trace.count, trace.preTriggerCount,
+         trace.heldSamples, trace.truncated ? ", truncated" : "", ok ? "ok" : "FAILED");
+  return ok;
+}
+
+void writeCsv(const ShotCaptureTrace& trace, const char* path) {
+  FILE* file = fopen(path, "w");
+  if (!file) return;
+  fprintf(file, "# capture %u: %u ms per sample, %u before the trigger, %u held, truncated: %s\n", trace.generation,
+          trace.samplePeriodMs, trace.preTriggerCount, trace.heldSamples, trace.truncated ? "yes" : "no");
+  fprintf(file, "time_ms,pressure_bar\n");
+  for (uint32_t i = 0; i < trace.count; i++) {
+    fprintf(file, "%ld,%.2f\n", ((long)i - (long)trace.preTriggerCount) * (long)trace.samplePeriodMs,
+            trace.centibar[i] / 100.0f);
+  }
+  fclose(file);
+  printf("capture written to %s\n", path);
+}
+
+} // namespace
+
+int runCaptureBench(int argc, char** argv) {
+  CaptureOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+
+  Machine* machine = new Machine(options.seed); // 16 KB of banks, keep it off the stack
+  bool ok = true;
+  printf("shot capture: %u ms period, %zu samples per capture, %zu pre-trigger, %zu bytes\n", PERIOD_MS,
+         CAPTURE_SAMPLES, PRE_TRIGGER_SAMPLES, Capture::BYTES);
+
+  // Shot right after boot: only what was fed so far before the trigger
+  machine->idle(0.6);
+  machine->shot(25.0);
+  ShotCaptureTrace first = machine->capture.completed();
+  size_t bootPreTrigger = machine->triggerTimes[0] / PERIOD_MS;
+  ok &= report("shot after boot (short pre-trigger)", checkTrace(*machine, first, "boot", bootPreTrigger, 0, false), first);
+
+  // Regular shot with a full pre-trigger window; the first capture must stay intact (for a
+  // download) until this one completes
+  machine->watchCompleted();
+  machine->idle(30.0);
+  machine->shot(12.0);
+  ShotCaptureTrace regular = machine->capture.completed();
+  ok &= report("12 s shot", checkTrace(*machine, regular, "regular", PRE_TRIGGER_SAMPLES, 0, false), regular);
+  ok &= report("previous capture while recording", !machine->watchedChanged && regular.generation == 2, first);
+
+  // Resolution of the pre-infusion ramp (first second, 0 -> 3 bar)
+  unsigned rampSamples = 0;
+  for (uint32_t i = 0; i < regular.count; i++) {
+    if (regular.centibar[i] > 10 && regular.centibar[i] < 290) rampSamples++;
+  }
+
+  // Capture overrun in the middle of the shot: held values keep the sample times exact
+  machine->idle(20.0);
+  machine->shot(28.0, 10.0, 12);
+  ShotCaptureTrace gap = machine->capture.completed();
+  ok &= report("28 s shot, 240 ms overrun", checkTrace(*machine, gap, "gap", PRE_TRIGGER_SAMPLES, 12, false), gap);
+
+  // Shot longer than the budget
+  machine->idle(20.0);
+  machine->shot(95.0);
+  ShotCaptureTrace longShot = machine->capture.completed();
+  ok &= report("95 s shot", checkTrace(*machine, longShot, "long", PRE_TRIGGER_SAMPLES, 0, true) &&
+                                  longShot.count == CAPTURE_SAMPLES, longShot);
+
+  printf("pre-infusion ramp (0.1-2.9 bar): %u samples at %u ms, %u with the 250 ms shot log trace, %u with the former 1 s history\n",
+         rampSamples, PERIOD_MS, rampSamples * PERIOD_MS / 250, rampSamples * PERIOD_MS / 1000);
+
+  if (options.csvPath) writeCsv(machine->capture.completed(), options.csvPath);
+  delete machine;
+  return benchResult("capture", ok);
+}
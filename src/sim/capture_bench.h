@@ -0,0 +1,8 @@
+#ifndef CAPTURE_BENCH_H
+#define CAPTURE_BENCH_H
+
+// `program capture [options]`: high-rate shot capture fed with synthetic shots through the
+// firmware's shot timer logic, checked sample by sample.
+int runCaptureBench(int argc, char** argv);
+
+#endif // CAPTURE_BENCH_H
@@ -0,0 +1,415 @@
+// Control-loop benchmark suite: the heater control core (lib/HeaterControl) against the
+// thermoblock model (lib/BoilerSim) in four scripted scenarios.
+//
+//   cold_start           22 C to the set point, no shots
+//   back_to_back_shots   at the set point, three 25 s shots 40 s apart
+//   presumed_off_entry   at the set point, main switch off at 5 min
+//   power_on_detection   main switch off at 1 min (presumed off), on again at 25 min
+//
+// Per scenario: sensor-to-relay-decision latency (burst mode: the thermocouple node
+// crossing the heat trigger until the relay switches on, and crossing the early cutoff
+// temperature until a long burst is cut; main switch to presumed-off entry and to power-on
+// detection), relay toggles per hour, overshoot, time within +/-0.5 C of the set point and
+// host CPU time per control step. Safety invariants (PID/MPC relay on-time inside the
+// envelope, standby entered and left, set point reached) fail the run. Results go to stdout as a table
+// and, with --json, to a file for tracking between builds; only cpu_* depends on the host.
+//
+//   .pio/build/native/program control
+//   .pio/build/native/program control --mode all --json control.json
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "BoilerModel.h"
+#include "HeaterController.h"
+#include "JsonWriter.h"
+#include "SimPlatform.h"
+#include "bench_report.h"
+#include "control_bench.h"
+
+namespace {
+
+const unsigned long CONTROL_PERIOD_MS = 100; // Firmware control task period
+const unsigned long PLANT_STEP_MS = 10;
+const double BAND_C = 0.5;
+
+struct ControlBenchOptions {
+  double desiredTempC = 90.0;
+  bool allModes = false;
+  ControlMode mode = CONTROL_MODE_BURST;
+  TemperatureEstimator estimator = HeaterControllerConfig().temperatureEstimator;
+  unsigned seed = 1;
+  const char* jsonPath = nullptr;
+};
+
+void printUsage() {
+  printf("usage: program control [options]\n"
+         "  --set C            desired temperature (default 90)\n"
+         "  --mode M           burst, pid, mpc or all (default burst)\n"
+         "  --estimator E      ema or kalman (default kalman)\n"
+         "  --seed N           sensor noise seed (default 1)\n"
+         "  --json PATH        write the results as JSON (- for stdout)\n");
+}
+
+bool parseOptions(int argc, char** argv, ControlBenchOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--set") == 0) options.desiredTempC = atof(value);
+    else if (strcmp(arg, "--mode") == 0) {
+      options.allModes = strcmp(value, "all") == 0;
+      if (!options.allModes && !parseControlMode(value, options.mode)) return false;
+    }
+    else if (strcmp(arg, "--estimator") == 0) { if (!parseTemperatureEstimator(value, options.estimator)) return false; }
+    else if (strcmp(arg, "--seed") == 0) options.seed = (unsigned)strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--json") == 0) options.jsonPath = value;
+    else return false;
+    i++;
+  }
+  return true;
+}
+
+// --- Scenarios ---
+struct Scenario {
+  const char* name;
+  double durationS;
+  double startTempC;   // NAN: at the set point
+  int shots;
+  double firstShotS;
+  double shotIntervalS;
+  double shotDurationS;
+  double powerOffS;    // Main switch off from here (-1: never)
+  double powerOnS;     // Main switch on again from here (-1: never)
+};
+
+const Scenario SCENARIOS[] = {
+    {"cold_start", 1800.0, 22.0, 0, 0.0, 0.0, 0.0, -1.0, -1.0},
+    {"back_to_back_shots", 1500.0, NAN, 3, 600.0, 40.0, 25.0, -1.0, -1.0},
+    {"presumed_off_entry", 2400.0, NAN, 0, 0.0, 0.0, 0.0, 300.0, -1.0},
+    {"power_on_detection", 3000.0, NAN, 0, 0.0, 0.0, 0.0, 60.0, 1500.0},
+};
+const size_t SCENARIO_COUNT = sizeof(SCENARIOS) / sizeof(SCENARIOS[0]);
+
+const double SHOT_FLOW_ML_PER_S = 2.0;
+
+// Mean/max of one kind of latency event.
+struct Latency {
+  unsigned long count = 0;
+  double sumS = 0.0;
+  double maxS = NAN;
+
+  void add(double s) {
+    count++;
+    sumS += s;
+    if (isnan(maxS) || s > maxS) maxS = s;
+  }
+  double meanS() const { return count ? sumS / count : NAN; }
+};
+
+struct ScenarioResult {
+  const char* scenario;
+  ControlMode mode;
+  Latency heatTrigger;   // Sensor node below set point - heatTriggerBelowDesiredC -> relay on
+  Latency earlyCutoff;   // Sensor node at the early cutoff temperature -> relay off
+  double presumedOffDetectS = NAN; // Main switch off -> presumed off
+  double powerOnDetectS = NAN;     // Main switch on -> presumed off left
+  double warmupS = NAN;            // First time within the band (while powered)
+  double maxOvershootC = 0.0;      // After warm-up
+  double inBandPercent = NAN;      // After warm-up, while powered
+  double worstShotDropC = NAN;     // Deepest dip below the set point from the first shot on
+  unsigned long relayToggles = 0;
+  double relayTogglesPerHour = 0.0;
+  double maxContinuousOnS = 0.0;   // Outside presumed-off standby
+  bool failuresIgnored = false;    // Monitoring for machine off with the heating failures at the maximum
+  unsigned long steps = 0;
+  double cpuMeanNs = 0.0;
+  double cpuMaxNs = 0.0;
+  bool ok = true;
+  const char* failure = "";
+};
+
+bool isShotActive(const Scenario& scenario, double tS) {
+  for (int shot = 0; shot < scenario.shots; shot++) {
+    double start = scenario.firstShotS + shot * scenario.shotIntervalS;
+    if (tS >= start && tS < start + scenario.shotDurationS) return true;
+  }
+  return false;
+}
+
+bool isPowered(const Scenario& scenario, double tS) {
+  if (scenario.powerOffS < 0 || tS < scenario.powerOffS) return true;
+  return scenario.powerOnS >= 0 && tS >= scenario.powerOnS;
+}
+
+ScenarioResult runScenario(const Scenario& scenario, ControlMode mode, const ControlBenchOptions& options) {
+  srand(options.seed);
+  static const double rawTempsC[2] = {0.0, 100.0}; // Identity: the model node is the actual temperature
+  static const double actualTempsC[2] = {0.0, 100.0};
+  TemperatureCalibration calibration(rawTempsC, actualTempsC, 2);
+  HeaterControllerConfig config;
+  config.controlMode = mode;
+  config.temperatureEstimator = options.estimator;
+
+  BoilerModel boiler;
+  boiler.reset(isnan(scenario.startTempC) ? options.desiredTempC : scenario.startTempC);
+  SimClock clock;
+  SimThermocouple thermocouple(boiler);
+  SimRelay relay(boiler);
+  SimEvents events(clock, false);
+  HeaterController controller(clock, thermocouple, relay, events, calibration, config);
+  controller.begin();
+  controller.setDesiredTemperature(options.desiredTempC);
+
+  ScenarioResult result;
+  result.scenario = scenario.name;
+  result.mode = mode;
+  const double dtS = PLANT_STEP_MS / 1000.0;
+  const double triggerC = options.desiredTempC - config.heatTriggerBelowDesiredC;
+  double belowTriggerSinceS = NAN;  // Controller free to heat and the node below the trigger
+  double aboveCutoffSinceS = NAN;   // Long burst running and the node at the cutoff temperature
+  double relayOnSinceS = NAN;
+  double poweredInBandS = 0.0, poweredAfterWarmupS = 0.0;
+  double cpuTotalNs = 0.0;
+  bool shotsStarted = false;
+
+  const unsigned long durationMs = (unsigned long)(scenario.durationS * 1000.0);
+  for (unsigned long t = 0; t < durationMs; t += PLANT_STEP_MS) {
+    double tS = t / 1000.0;
+    bool powered = isPowered(scenario, tS);
+    boiler.setMachinePowered(powered);
+    boiler.setWaterFlowMlPerS(isShotActive(scenario, tS) ? SHOT_FLOW_ML_PER_S : 0.0);
+
+    if (t % CONTROL_PERIOD_MS == 0) {
+      // Thresholds the next decision acts on, as the thermocouple node sees them
+      double nodeC = boiler.sensorTempC();
+      bool freeToHeat = mode == CONTROL_MODE_BURST && controller.state() == IDLE && !relay.isOn() &&
+                        !controller.inEarlyCutoffCooldown() && !controller.isPresumedOff();
+      if (freeToHeat && nodeC < triggerC) {
+        if (isnan(belowTriggerSinceS)) belowTriggerSinceS = tS;
+      } else {
+        belowTriggerSinceS = NAN;
+      }
+      bool longBurst = controller.state() == HEATING &&
+                       controller.lastCalculatedHeatDurationMs() > config.earlyCutoffMinBurstMs;
+      if (longBurst && nodeC >= controller.earlyCutoffTemperature()) {
+        if (isnan(aboveCutoffSinceS)) aboveCutoffSinceS = tS;
+      } else if (!longBurst) {
+        aboveCutoffSinceS = NAN;
+      }
+
+      bool wasOn = relay.isOn();
+      bool wasPresumedOff = controller.isPresumedOff();
+      auto start = std::chrono::steady_clock::now();
+      controller.update();
+      double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+      cpuTotalNs += ns;
+      if (ns > result.cpuMaxNs) result.cpuMaxNs = ns;
+      result.steps++;
+
+      if (!wasOn && relay.isOn() && controller.state() == HEATING && !isnan(belowTriggerSinceS)) {
+        result.heatTrigger.add(tS - belowTriggerSinceS);
+        belowTriggerSinceS = NAN;
+      }
+      if (wasOn && !relay.isOn() && controller.inEarlyCutoffCooldown() && !isnan(aboveCutoffSinceS)) {
+        result.earlyCutoff.add(tS - aboveCutoffSinceS);
+        aboveCutoffSinceS = NAN;
+      }
+      if (controller.isMonitoringForMachineOff() && !controller.isPresumedOff() &&
+          controller.consecutiveFailedHeatingAttempts() >= config.maxConsecutiveHeatingFailures) {
+        result.failuresIgnored = true;
+      }
+      if (!wasPresumedOff && controller.isPresumedOff() && isnan(result.presumedOffDetectS) && !powered) {
+        result.presumedOffDetectS = tS - scenario.powerOffS;
+      }
+      if (wasPresumedOff && !controller.isPresumedOff() && scenario.powerOnS >= 0 && tS >= scenario.powerOnS) {
+        result.powerOnDetectS = tS - scenario.powerOnS;
+      }
+    }
+    boiler.step(dtS);
+    clock.advance(PLANT_STEP_MS);
+
+    // Relay on-time outside standby (the safety envelope caps bursts at maxHeaterOnDurationMs)
+    if (relay.isOn() && !controller.isPresumedOff()) {
+      if (isnan(relayOnSinceS)) relayOnSinceS = tS;
+      if (tS - relayOnSinceS > result.maxContinuousOnS) result.maxContinuousOnS = tS - relayOnSinceS;
+    } else {
+      relayOnSinceS = NAN;
+    }
+
+    if (!powered) continue;
+    double errorC = boiler.blockTempC() - options.desiredTempC;
+    if (isnan(result.warmupS) && fabs(errorC) <= BAND_C) result.warmupS = tS;
+    if (!isnan(result.warmupS)) {
+      poweredAfterWarmupS += dtS;
+      if (fabs(errorC) <= BAND_C) poweredInBandS += dtS;
+      if (errorC > result.maxOvershootC) result.maxOvershootC = errorC;
+    }
+    if (isShotActive(scenario, tS)) shotsStarted = true;
+    if (shotsStarted && (isnan(result.worstShotDropC) || -errorC > result.worstShotDropC)) {
+      result.worstShotDropC = -errorC;
+    }
+  }
+
+  if (poweredAfterWarmupS > 0) result.inBandPercent = 100.0 * poweredInBandS / poweredAfterWarmupS;
+  result.relayToggles = relay.toggles();
+  result.relayTogglesPerHour = relay.toggles() * 3600.0 / scenario.durationS;
+  result.cpuMeanNs = result.steps ? cpuTotalNs / result.steps : 0.0;
+
+  // --- Invariants ---
+  // Every mode, including a burst extended below the early cutoff temperature
+  if (result.maxContinuousOnS > config.maxHeaterOnDurationMs / 1000.0 + CONTROL_PERIOD_MS / 1000.0) {
+    result.ok = false;
+    result.failure = "relay on longer than maxHeaterOnDurationMs";
+  } else if (result.failuresIgnored) {
+    result.ok = false;
+    result.failure = "heating failures at the maximum without presumed off";
+  } else if (scenario.powerOffS >= 0 && isnan(result.presumedOffDetectS)) {
+    result.ok = false;
+    result.failure = "presumed off never entered";
+  } else if (scenario.powerOnS >= 0 && (isnan(result.powerOnDetectS) || controller.isPresumedOff())) {
+    result.ok = false;
+    result.failure = "power-on never detected";
+  } else if (isPowered(scenario, scenario.durationS) && isnan(result.warmupS)) {
+    result.ok = false;
+    result.failure = "set point never reached";
+  }
+  return result;
+}
+
+// --- Output ---
+void printHeader() {
+  printf("%-19s %-5s %9s %9s %9s %9s %8s %9s %8s %9s %8s %9s %9s\n", "scenario", "mode", "trig_lat", "cut_lat",
+         "off_det", "on_det", "warmup", "overshoot", "in_band", "toggles/h", "max_on", "cpu_mean", "cpu_max");
+}
+
+// One table cell, "-" when not applicable.
+void printCell(double value, int decimals, const char* unit, int width = 9) {
+  char text[32];
+  if (isnan(value)) snprintf(text, sizeof(text), "-");
+  else snprintf(text, sizeof(text), "%.*f%s", decimals, value, unit);
+  printf(" %*s", width, text);
+}
+
+void printResult(const ScenarioResult& r) {
+  printf("%-19s %-5s", r.scenario, controlModeName(r.mode));
+  printCell(r.heatTrigger.meanS(), 1, "s");
+  printCell(r.earlyCutoff.meanS(), 1, "s");
+  printCell(r.presumedOffDetectS, 0, "s");
+  printCell(r.powerOnDetectS, 0, "s");
+  printCell(r.warmupS, 0, "s", 8);
+  printCell(r.maxOvershootC, 2, "C");
+  printCell(r.inBandPercent, 1, "%", 8);
+  printCell(r.relayTogglesPerHour, 1, "");
+  printCell(r.maxContinuousOnS, 0, "s", 8);
+  printCell(r.cpuMeanNs, 0, "ns");
+  printCell(r.cpuMaxNs, 0, "ns");
+  printf("%s%s\n", r.ok ? "" : "  FAILED: ", r.failure);
+}
+
+class FileSink : public JsonSink {
+public:
+  explicit FileSink(FILE* file) : _file(file) {}
+  void write(const char* data, size_t length, bool final) override {
+    fwrite(data, 1, length, _file);
+    if (final) fputc('\n', _file);
+  }
+
+private:
+  FILE* _file;
+};
+
+void writeLatency(JsonWriter& json, const Latency& latency) {
+  json.field("count", latency.count);
+  json.field("mean_s", latency.meanS(), 2);
+  json.field("max_s", latency.maxS, 2);
+}
+
+// One object per scenario and mode; NaN (not applicable) is written as null.
+void writeJson(FILE* file, const ControlBenchOptions& options, const ScenarioResult* results, size_t count, bool ok) {
+  char buffer[512];
+  FileSink sink(file);
+  JsonWriter json(buffer, sizeof(buffer), sink);
+  json.beginObject();
+  json.field("bench", "control");
+  json.field("set_c", options.desiredTempC, 1);
+  json.field("seed", options.seed);
+  json.field("estimator", temperatureEstimatorName(options.estimator));
+  json.field("control_period_ms", CONTROL_PERIOD_MS);
+  json.field("ok", ok);
+  json.beginArray("results");
+  for (size_t i = 0; i < count; i++) {
+    const ScenarioResult& r = results[i];
+    json.beginObject();
+    json.field("scenario", r.scenario);
+    json.field("mode", controlModeName(r.mode));
+    json.beginObject("heat_trigger_latency");
+    writeLatency(json, r.heatTrigger);
+    json.endObject();
+    json.beginObject("early_cutoff_latency");
+    writeLatency(json, r.earlyCutoff);
+    json.endObject();
+    json.field("presumed_off_detect_s", r.presumedOffDetectS, 1);
+    json.field("power_on_detect_s", r.powerOnDetectS, 1);
+    json.field("warmup_s", r.warmupS, 1);
+    json.field("max_overshoot_c", r.maxOvershootC, 2);
+    json.field("in_band_percent", r.inBandPercent, 2);
+    json.field("worst_shot_drop_c", r.worstShotDropC, 2);
+    json.field("relay_toggles", r.relayToggles);
+    json.field("relay_toggles_per_hour", r.relayTogglesPerHour, 1);
+    json.field("max_continuous_on_s", r.maxContinuousOnS, 1);
+    json.field("control_steps", r.steps);
+    json.field("cpu_mean_ns", r.cpuMeanNs, 0);
+    json.field("cpu_max_ns", r.cpuMaxNs, 0);
+    json.field("ok", r.ok);
+    if (!r.ok) json.field("failure", r.failure);
+    json.endObject();
+  }
+  json.endArray();
+  json.endObject();
+  json.finish();
+}
+
+} // namespace
+
+int runControlBench(int argc, char** argv) {
+  ControlBenchOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+  static const ControlMode ALL_MODES[] = {CONTROL_MODE_BURST, CONTROL_MODE_PID, CONTROL_MODE_MPC};
+  const ControlMode* modes = options.allModes ? ALL_MODES : &options.mode;
+  size_t modeCount = options.allModes ? 3 : 1;
+
+  ScenarioResult results[SCENARIO_COUNT * 3];
+  size_t count = 0;
+  bool ok = true;
+  bool table = !(options.jsonPath && strcmp(options.jsonPath, "-") == 0);
+  if (table) printHeader();
+  for (size_t m = 0; m < modeCount; m++) {
+    for (size_t s = 0; s < SCENARIO_COUNT; s++) {
+      results[count] = runScenario(SCENARIOS[s], modes[m], options);
+      ok &= results[count].ok;
+      if (table) printResult(results[count]);
+      count++;
+    }
+  }
+
+  if (options.jsonPath) {
+    FILE* file = table ? fopen(options.jsonPath, "w") : stdout;
+    if (!file) {
+      printf("cannot write %s\n", options.jsonPath);
+      return 1;
+    }
+    writeJson(file, options, results, count, ok);
+    if (file != stdout) {
+      fclose(file);
+      printf("results written to %s\n", options.jsonPath);
+    }
+  }
+  if (!table) return ok ? 0 : 1; // JSON on stdout only
+  return benchResult("control", ok);
+}
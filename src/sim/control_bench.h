@@ -0,0 +1,9 @@
+#ifndef CONTROL_BENCH_H
+#define CONTROL_BENCH_H
+
+// `program control [options]`: scripted control-loop scenarios (cold start, back-to-back
+// shots, presumed-off entry, power-on detection) with latency, toggles, overshoot, time in
+// band and CPU per step; --json for machine-readable results.
+int runControlBench(int argc, char** argv);
+
+#endif // CONTROL_BENCH_H
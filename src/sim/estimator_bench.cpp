@@ -0,0 +1,512 @@
+// Temperature estimator comparison: the firmware EMA and its 5 s rise-rate check against the
+// two-state Kalman filter (lib/HeaterControl/TemperatureKalmanFilter) on recorded traces.
+//
+// Traces are recorded from the thermoblock model (lib/BoilerSim) under the heater controller
+// in its original EMA configuration, one sample per thermocouple read:
+//
+//   cold_start   22 C to the set point
+//   shots        at the set point, three 25 s shots 40 s apart
+//   standby      main switch off at 1 min (presumed off), on again at 25 min
+//
+// Each trace is replayed through both estimators. Against the noise-free thermocouple node:
+// lag (delay that best aligns the estimate with the node), noise (RMS left after removing
+// that delay), rms (plain error, what the state machine sees) and the RMS error of the
+// rate. In standby: how long after the main switch goes on each rate check detects power,
+// and how many times it fired while the machine was still off. The Kalman filter has to
+// lag less than the EMA without being noisier, detect power-on no later, and never fire
+// falsely, otherwise the program exits non-zero.
+//
+// --trace replays a logged trace (CSV: seconds,raw_c,heater_duty,standby[,truth_c]);
+// without a truth column a centred 5 s moving average of the readings is the reference.
+// --write-traces PREFIX saves the recorded traces in that format.
+//
+//   .pio/build/native/program estimator
+//   .pio/build/native/program estimator --trace shot_log.csv
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "BoilerModel.h"
+#include "EmaFilter.h"
+#include "HeaterController.h"
+#include "SimPlatform.h"
+#include "TemperatureKalmanFilter.h"
+#include "bench_report.h"
+#include "estimator_bench.h"
+
+namespace {
+
+const unsigned long CONTROL_PERIOD_MS = 100; // Firmware control task period
+const unsigned long PLANT_STEP_MS = 10;
+const double FORMER_RATE_CHECK_S = 5.0;     // rateCheckIntervalMs of the EMA firmware
+const double MAX_LAG_S = 30.0;
+const double SETTLE_S = 20.0;               // Start-up samples left out of the statistics
+const double REFERENCE_WINDOW_S = 5.0;      // Centred moving average when a trace has no truth
+
+struct EstimatorBenchOptions {
+  double desiredTempC = 90.0;
+  unsigned seed = 1;
+  const char* tracePath = nullptr;
+  const char* writePrefix = nullptr;
+  KalmanTuning tuning = HeaterControllerConfig().kalmanTuning;
+};
+
+void printUsage() {
+  printf("usage: program estimator [options]\n"
+         "  --set C               desired temperature of the recorded traces (default 90)\n"
+         "  --seed N              sensor noise seed (default 1)\n"
+         "  --trace PATH          replay a logged trace instead (seconds,raw_c,heater_duty,standby[,truth_c])\n"
+         "  --write-traces PREFIX write the recorded traces to PREFIX_<name>.csv\n"
+         "  --r C                 Kalman measurement noise std dev (default from HeaterControllerConfig)\n"
+         "  --q-temp X            Kalman temperature process noise, C^2/s\n"
+         "  --q-load X            Kalman unmodelled-rate process noise, (C/s)^2/s\n");
+}
+
+bool parseOptions(int argc, char** argv, EstimatorBenchOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--set") == 0) options.desiredTempC = atof(value);
+    else if (strcmp(arg, "--seed") == 0) options.seed = (unsigned)atoi(value);
+    else if (strcmp(arg, "--trace") == 0) options.tracePath = value;
+    else if (strcmp(arg, "--write-traces") == 0) options.writePrefix = value;
+    else if (strcmp(arg, "--r") == 0) options.tuning.measurementNoiseC = (float)atof(value);
+    else if (strcmp(arg, "--q-temp") == 0) options.tuning.temperatureProcessNoise = (float)atof(value);
+    else if (strcmp(arg, "--q-load") == 0) options.tuning.loadProcessNoise = (float)atof(value);
+    else return false;
+    i++;
+  }
+  return true;
+}
+
+// --- Traces ---
+
+struct TraceSample {
+  double seconds;
+  double rawC;       // Thermocouple reading (NAN: failed read)
+  float heaterDuty;  // Heat delivered since the previous sample, 0..1
+  bool standby;      // Controller in presumed-off standby
+  double truthC;     // Noise-free thermocouple node (or the reference)
+  double truthRateCPerS;
+};
+
+struct Trace {
+  const char* name;
+  std::vector<TraceSample> samples;
+  double powerOnS; // Main switch on again (standby trace), -1 if not part of the trace
+  bool hasTruth;
+};
+
+struct TraceScenario {
+  const char* name;
+  double durationS;
+  double startOffsetC; // Initial temperature relative to the set point (cold start: ambient)
+  bool coldStart;
+  int shots;
+  double firstShotS;
+  double shotIntervalS;
+  double powerOffS;
+  double powerOnS;
+};
+
+const TraceScenario SCENARIOS[] = {
+    {"cold_start", 1200.0, 0.0, true, 0, 0.0, 0.0, -1.0, -1.0},
+    {"shots", 900.0, 0.0, false, 3, 300.0, 40.0, -1.0, -1.0},
+    {"standby", 2400.0, 0.0, false, 0, 0.0, 0.0, 60.0, 1500.0},
+};
+const double SHOT_DURATION_S = 25.0;
+const double SHOT_FLOW_ML_PER_S = 2.0;
+const size_t SCENARIO_COUNT = sizeof(SCENARIOS) / sizeof(SCENARIOS[0]);
+
+// Passes readings through and remembers the last one, so the trace holds exactly what
+// the controller read
+class RecordingSensor : public TemperatureSensor {
+public:
+  explicit RecordingSensor(TemperatureSensor& sensor) : _sensor(sensor), _read(false), _lastC(NAN) {}
+  double readCelsius() override {
+    _lastC = _sensor.readCelsius();
+    _read = true;
+    return _lastC;
+  }
+  bool takeReading(double& tempC) {
+    bool read = _read;
+    _read = false;
+    tempC = _lastC;
+    return read;
+  }
+
+private:
+  TemperatureSensor& _sensor;
+  bool _read;
+  double _lastC;
+};
+
+// Truth rate: centred difference over +/-1 s of the noise-free node
+void fillTruthRates(Trace& trace) {
+  std::vector<TraceSample>& samples = trace.samples;
+  for (size_t i = 0; i < samples.size(); i++) {
+    size_t lo = i, hi = i;
+    while (lo > 0 && samples[i].seconds - samples[lo].seconds < 1.0) lo--;
+    while (hi + 1 < samples.size() && samples[hi].seconds - samples[i].seconds < 1.0) hi++;
+    double dt = samples[hi].seconds - samples[lo].seconds;
+    samples[i].truthRateCPerS = dt > 0 ? (samples[hi].truthC - samples[lo].truthC) / dt : 0.0;
+  }
+}
+
+Trace recordTrace(const TraceScenario& scenario, const EstimatorBenchOptions& options) {
+  srand(options.seed);
+  static const double rawTempsC[2] = {0.0, 100.0}; // Identity: the node is the actual temperature
+  static const double actualTempsC[2] = {0.0, 100.0};
+  TemperatureCalibration calibration(rawTempsC, actualTempsC, 2);
+
+  HeaterControllerConfig config;
+  config.temperatureEstimator = TEMP_ESTIMATOR_EMA; // The firmware the traces were logged with
+  BoilerModel boiler;
+  boiler.reset(scenario.coldStart ? boiler.params().ambientTempC : options.desiredTempC + scenario.startOffsetC);
+  SimClock clock;
+  SimThermocouple thermocouple(boiler);
+  RecordingSensor sensor(thermocouple);
+  SimRelay relay(boiler);
+  SimEvents events(clock, false);
+  HeaterController controller(clock, sensor, relay, events, calibration, config);
+  controller.begin();
+  controller.setDesiredTemperature(options.desiredTempC);
+
+  Trace trace;
+  trace.name = scenario.name;
+  trace.powerOnS = scenario.powerOnS;
+  trace.hasTruth = true;
+  double heaterOnS = 0.0;
+  double lastSampleS = 0.0;
+  const double dtS = PLANT_STEP_MS / 1000.0;
+  const unsigned long durationMs = (unsigned long)(scenario.durationS * 1000.0);
+  for (unsigned long t = 0; t < durationMs; t += PLANT_STEP_MS) {
+    double tS = t / 1000.0;
+    bool powered = !(scenario.powerOffS >= 0 && tS >= scenario.powerOffS && tS < scenario.powerOnS);
+    boiler.setMachinePowered(powered);
+    bool shot = false;
+    for (int i = 0; i < scenario.shots; i++) {
+      double startS = scenario.firstShotS + i * scenario.shotIntervalS;
+      if (tS >= startS && tS < startS + SHOT_DURATION_S) shot = true;
+    }
+    boiler.setWaterFlowMlPerS(shot ? SHOT_FLOW_ML_PER_S : 0.0);
+
+    if (t % CONTROL_PERIOD_MS == 0) {
+      bool standby = controller.isPresumedOff(); // What the reading is checked against
+      controller.update();
+      double rawC;
+      if (sensor.takeReading(rawC)) {
+        TraceSample sample;
+        sample.seconds = tS;
+        sample.rawC = rawC;
+        sample.heaterDuty = tS > lastSampleS ? (float)(heaterOnS / (tS - lastSampleS)) : 0.0f;
+        sample.standby = standby;
+        sample.truthC = boiler.sensorTempC();
+        sample.truthRateCPerS = 0.0;
+        trace.samples.push_back(sample);
+        heaterOnS = 0.0;
+        lastSampleS = tS;
+      }
+    }
+    // Heat the estimator is told about: relay on, and not in presumed-off standby
+    if (relay.isOn() && !controller.isPresumedOff()) heaterOnS += dtS;
+    boiler.step(dtS);
+    clock.advance(PLANT_STEP_MS);
+  }
+  fillTruthRates(trace);
+  return trace;
+}
+
+bool writeTrace(const Trace& trace, const char* prefix) {
+  char path[256];
+  snprintf(path, sizeof(path), "%s_%s.csv", prefix, trace.name);
+  FILE* file = fopen(path, "w");
+  if (!file) {
+    printf("cannot write %s\n", path);
+    return false;
+  }
+  fprintf(file, "seconds,raw_c,heater_duty,standby,truth_c\n");
+  for (size_t i = 0; i < trace.samples.size(); i++) {
+    const TraceSample& s = trace.samples[i];
+    fprintf(file, "%.1f,%.2f,%.3f,%d,%.3f\n", s.seconds, s.rawC, s.heaterDuty, s.standby ? 1 : 0, s.truthC);
+  }
+  fclose(file);
+  printf("trace written to %s\n", path);
+  return true;
+}
+
+// Reference for a logged trace without truth: centred (zero-lag) moving average
+void fillReference(Trace& trace) {
+  std::vector<TraceSample>& samples = trace.samples;
+  for (size_t i = 0; i < samples.size(); i++) {
+    double sum = 0.0;
+    int count = 0;
+    for (size_t j = i; j < samples.size() && samples[j].seconds - samples[i].seconds <= REFERENCE_WINDOW_S / 2; j++) {
+      if (!isnan(samples[j].rawC)) { sum += samples[j].rawC; count++; }
+    }
+    for (size_t j = i; j > 0 && samples[i].seconds - samples[j - 1].seconds <= REFERENCE_WINDOW_S / 2; j--) {
+      if (!isnan(samples[j - 1].rawC)) { sum += samples[j - 1].rawC; count++; }
+    }
+    samples[i].truthC = count > 0 ? sum / count : NAN;
+  }
+  fillTruthRates(trace);
+}
+
+bool loadTrace(const char* path, Trace& trace) {
+  FILE* file = fopen(path, "r");
+  if (!file) {
+    printf("cannot read %s\n", path);
+    return false;
+  }
+  trace.name = "logged";
+  trace.powerOnS = -1.0;
+  trace.hasTruth = true;
+  char line[160];
+  while (fgets(line, sizeof(line), file)) {
+    TraceSample s;
+    int standby = 0;
+    s.truthC = NAN;
+    int fields = sscanf(line, "%lf,%lf,%f,%d,%lf", &s.seconds, &s.rawC, &s.heaterDuty, &standby, &s.truthC);
+    if (fields < 4) continue; // Header, blank line
+    if (fields < 5) trace.hasTruth = false;
+    s.standby = standby != 0;
+    s.truthRateCPerS = 0.0;
+    // Main switch on: standby ends in the log
+    if (!trace.samples.empty() && trace.samples.back().standby && !s.standby && trace.powerOnS < 0) {
+      trace.powerOnS = s.seconds;
+    }
+    trace.samples.push_back(s);
+  }
+  fclose(file);
+  if (trace.samples.size() < 10) {
+    printf("%s: too few samples\n", path);
+    return false;
+  }
+  if (trace.hasTruth) fillTruthRates(trace);
+  else fillReference(trace);
+  return true;
+}
+
+// --- Replay ---
+
+struct EstimateSeries {
+  std::vector<double> tempC;
+  std::vector<double> rateCPerS;
+  double powerOnDetectS = NAN; // After the main switch went on
+  int falseDetections = 0;     // Rate check fired in standby before power came back
+  double nsPerUpdate = 0.0;
+};
+
+struct EstimateStats {
+  double lagS = NAN;
+  double noiseC = NAN;
+  double rmsC = NAN;
+  double rateRmsCPerS = NAN;
+};
+
+// The standby rate check: fires while in standby, detection when power is back on. The
+// recorded controller left standby on its own detection; for the replay standby lasts
+// from power-on until each estimator's first detection.
+void checkPowerOn(const Trace& trace, size_t i, double rateCPerS, float thresholdCPerS, EstimateSeries& series) {
+  const TraceSample& s = trace.samples[i];
+  bool poweredOn = trace.powerOnS >= 0 && s.seconds >= trace.powerOnS;
+  if (!(s.standby || poweredOn) || isnan(rateCPerS) || rateCPerS <= thresholdCPerS) {
+    return;
+  }
+  if (poweredOn) {
+    if (isnan(series.powerOnDetectS)) series.powerOnDetectS = s.seconds - trace.powerOnS;
+  } else {
+    series.falseDetections++;
+  }
+}
+
+EstimateSeries replayEma(const Trace& trace, const HeaterControllerConfig& config) {
+  EstimateSeries series;
+  EmaFilter ema(config.tempEmaAlpha);
+  double lastCheckS = NAN;
+  double lastCheckC = NAN;
+  double heldRate = NAN;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < trace.samples.size(); i++) {
+    const TraceSample& s = trace.samples[i];
+    if (!isnan(s.rawC)) ema.update(SensorScalar(s.rawC));
+    double tempC = ema.value();
+    // Former firmware: rise rate of the EMA over rateCheckIntervalMs, restarted on entering standby
+    if (isnan(lastCheckS) || (s.standby && i > 0 && !trace.samples[i - 1].standby)) {
+      lastCheckS = s.seconds;
+      lastCheckC = tempC;
+    } else if (s.seconds - lastCheckS >= FORMER_RATE_CHECK_S) {
+      heldRate = (tempC - lastCheckC) / (s.seconds - lastCheckS);
+      lastCheckS = s.seconds;
+      lastCheckC = tempC;
+      checkPowerOn(trace, i, heldRate, config.powerOnRateThresholdCPerS, series);
+    }
+    series.tempC.push_back(tempC);
+    series.rateCPerS.push_back(heldRate);
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  series.nsPerUpdate = elapsed.count() / trace.samples.size();
+  return series;
+}
+
+EstimateSeries replayKalman(const Trace& trace, const HeaterControllerConfig& config) {
+  EstimateSeries series;
+  TemperatureKalmanFilter kalman(config.thermalModel, config.tempReadIntervalMs / 1000.0f, config.kalmanTuning);
+  double lastValidS = 0.0;
+  double heaterOnS = 0.0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < trace.samples.size(); i++) {
+    const TraceSample& s = trace.samples[i];
+    double intervalS = i > 0 ? s.seconds - trace.samples[i - 1].seconds : 0.0;
+    heaterOnS += s.heaterDuty * intervalS;
+    if (!isnan(s.rawC)) { // A failed read folds its time into the next one, as in the controller
+      double dtS = s.seconds - lastValidS;
+      kalman.update((float)s.rawC, dtS > 0 ? (float)(heaterOnS / dtS) : 0.0f, (float)dtS);
+      lastValidS = s.seconds;
+      heaterOnS = 0.0;
+    }
+    checkPowerOn(trace, i, kalman.rate(), config.powerOnRateThresholdCPerS, series);
+    series.tempC.push_back(kalman.value());
+    series.rateCPerS.push_back(kalman.rate());
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  series.nsPerUpdate = elapsed.count() / trace.samples.size();
+  return series;
+}
+
+double rmsShifted(const Trace& trace, const std::vector<double>& estimate, size_t shift) {
+  double sum = 0.0;
+  size_t count = 0;
+  for (size_t i = shift; i < estimate.size(); i++) {
+    if (trace.samples[i].seconds < SETTLE_S || isnan(estimate[i]) || isnan(trace.samples[i - shift].truthC)) continue;
+    double error = estimate[i] - trace.samples[i - shift].truthC;
+    sum += error * error;
+    count++;
+  }
+  return count > 0 ? sqrt(sum / count) : NAN;
+}
+
+EstimateStats analyse(const Trace& trace, const EstimateSeries& series) {
+  EstimateStats stats;
+  double intervalS = (trace.samples.back().seconds - trace.samples.front().seconds) / (trace.samples.size() - 1);
+  size_t maxShift = (size_t)(MAX_LAG_S / intervalS);
+  double best = INFINITY;
+  for (size_t shift = 0; shift <= maxShift && shift < trace.samples.size(); shift++) {
+    double rms = rmsShifted(trace, series.tempC, shift);
+    if (rms < best) {
+      best = rms;
+      stats.lagS = shift * intervalS;
+      stats.noiseC = rms;
+    }
+  }
+  stats.rmsC = rmsShifted(trace, series.tempC, 0);
+
+  double sum = 0.0;
+  size_t count = 0;
+  for (size_t i = 0; i < series.rateCPerS.size(); i++) {
+    if (trace.samples[i].seconds < SETTLE_S || isnan(series.rateCPerS[i])) continue;
+    double error = series.rateCPerS[i] - trace.samples[i].truthRateCPerS;
+    sum += error * error;
+    count++;
+  }
+  if (count > 0) stats.rateRmsCPerS = sqrt(sum / count);
+  return stats;
+}
+
+// --- Report ---
+
+void printCell(double value, int decimals, const char* unit, int width = 9) {
+  char text[32];
+  if (isnan(value)) snprintf(text, sizeof(text), "-");
+  else snprintf(text, sizeof(text), "%.*f%s", decimals, value, unit);
+  printf(" %*s", width, text);
+}
+
+void printRow(const Trace& trace, const char* estimator, const EstimateStats& stats, const EstimateSeries& series) {
+  printf("%-11s %-7s", trace.name, estimator);
+  printCell(stats.lagS, 1, "s", 7);
+  printCell(stats.noiseC, 3, "C");
+  printCell(stats.rmsC, 3, "C");
+  printCell(stats.rateRmsCPerS, 3, "C/s", 10);
+  printCell(series.powerOnDetectS, 1, "s", 8);
+  printf(" %6d", series.falseDetections);
+  printCell(series.nsPerUpdate, 0, "ns", 8);
+  printf("\n");
+}
+
+bool compare(const Trace& trace, const HeaterControllerConfig& config) {
+  EstimateSeries ema = replayEma(trace, config);
+  EstimateSeries kalman = replayKalman(trace, config);
+  EstimateStats emaStats = analyse(trace, ema);
+  EstimateStats kalmanStats = analyse(trace, kalman);
+  printRow(trace, "ema", emaStats, ema);
+  printRow(trace, "kalman", kalmanStats, kalman);
+
+  bool ok = true;
+  if (!(kalmanStats.lagS < emaStats.lagS || kalmanStats.lagS == 0.0)) {
+    printf("  %s: Kalman lag %.1fs not below EMA lag %.1fs\n", trace.name, kalmanStats.lagS, emaStats.lagS);
+    ok = false;
+  }
+  if (!(kalmanStats.rmsC <= emaStats.rmsC)) {
+    printf("  %s: Kalman error %.3fC above EMA error %.3fC\n", trace.name, kalmanStats.rmsC, emaStats.rmsC);
+    ok = false;
+  }
+  if (trace.hasTruth && !(kalmanStats.noiseC <= emaStats.noiseC * 1.5)) {
+    printf("  %s: Kalman noise %.3fC more than 1.5x the EMA's %.3fC\n", trace.name, kalmanStats.noiseC,
+           emaStats.noiseC);
+    ok = false;
+  }
+  if (kalman.falseDetections > 0) {
+    printf("  %s: Kalman rate detected power-on %d times while the machine was off\n", trace.name,
+           kalman.falseDetections);
+    ok = false;
+  }
+  if (trace.powerOnS >= 0 && !(kalman.powerOnDetectS <= ema.powerOnDetectS || isnan(ema.powerOnDetectS))) {
+    printf("  %s: Kalman power-on detection %.1fs later than the EMA's %.1fs\n", trace.name,
+           kalman.powerOnDetectS, ema.powerOnDetectS);
+    ok = false;
+  }
+  if (trace.powerOnS >= 0 && isnan(kalman.powerOnDetectS)) {
+    printf("  %s: Kalman rate never detected power-on\n", trace.name);
+    ok = false;
+  }
+  return ok;
+}
+
+} // namespace
+
+int runEstimatorBench(int argc, char** argv) {
+  EstimatorBenchOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+  HeaterControllerConfig config;
+  config.kalmanTuning = options.tuning;
+
+  std::vector<Trace> traces;
+  if (options.tracePath) {
+    Trace trace;
+    if (!loadTrace(options.tracePath, trace)) return 1;
+    if (!trace.hasTruth) printf("%s: no truth column, reference is a centred %.0fs average\n", options.tracePath,
+                                REFERENCE_WINDOW_S);
+    traces.push_back(trace);
+  } else {
+    for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+      traces.push_back(recordTrace(SCENARIOS[i], options));
+      if (options.writePrefix && !writeTrace(traces.back(), options.writePrefix)) return 1;
+    }
+  }
+
+  printf("%-11s %-7s %7s %9s %9s %10s %8s %6s %8s\n", "trace", "filter", "lag", "noise", "rms", "rate_rms",
+         "on_det", "false", "cpu");
+  bool ok = true;
+  for (size_t i = 0; i < traces.size(); i++) {
+    ok = compare(traces[i], config) && ok;
+  }
+  return benchResult("estimator", ok);
+}
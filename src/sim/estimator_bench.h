@@ -0,0 +1,8 @@
+#ifndef ESTIMATOR_BENCH_H
+#define ESTIMATOR_BENCH_H
+
+// `program estimator [options]`: EMA vs Kalman temperature estimate on recorded traces (lag,
+// noise, rate error, power-on detection); --trace replays a logged trace.
+int runEstimatorBench(int argc, char** argv);
+
+#endif // ESTIMATOR_BENCH_H
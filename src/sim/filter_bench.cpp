@@ -0,0 +1,337 @@
+// Property checks and micro-benchmark for the pressure filters (lib/SignalFilters).
+//
+// Every filter is compared sample by sample against a brute-force reference (copy the
+// window, qsort, average) on random, constant, ramp and spike-heavy inputs; any mismatch
+// is printed and makes the program exit non-zero. The benchmark then reports the cost per
+// sample next to the former qsort trimmed mean and hand-rolled SMA. Typical use:
+//
+//   .pio/build/native/program filters
+//   .pio/build/native/program filters --samples 5000000 --seed 7
+#include <chrono>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define FILTER_BENCH_HAS_TSC 1
+#endif
+
+#include "MovingAverage.h"
+#include "SlidingMedian.h"
+#include "SlidingTrimmedMean.h"
+#include "SortingNetwork.h"
+#include "filter_bench.h"
+
+namespace {
+
+const int RAW_SAMPLES = 7;      // Former PRESSURE_RAW_SAMPLES_COUNT
+const int RAW_TRIM = 1;         // Former PRESSURE_SAMPLES_TO_DISCARD_EACH_END
+const int SMOOTHING_SAMPLES = 5; // Former PRESSURE_SMOOTHING_SAMPLES
+
+struct BenchOptions {
+  unsigned long samples = 1000000;
+  unsigned long propertySamples = 20000;
+  unsigned seed = 1;
+};
+
+void printUsage() {
+  printf("usage: program filters [options]\n"
+         "  --samples N        samples per benchmark (default 1000000)\n"
+         "  --checks N         samples per property check and input pattern (default 20000)\n"
+         "  --seed N           input seed (default 1)\n");
+}
+
+bool parseOptions(int argc, char** argv, BenchOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--samples") == 0) options.samples = strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--checks") == 0) options.propertySamples = strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--seed") == 0) options.seed = (unsigned)atoi(value);
+    else return false;
+    i++;
+  }
+  return options.samples > 0 && options.propertySamples > 0;
+}
+
+// --- Former firmware path (getStableAdcValue() and the SMA in runSensingCycle()) ---
+int compareIntegers(const void* a, const void* b) { return (*(const int*)a - *(const int*)b); }
+
+int qsortTrimmedMean(int* readings) {
+  qsort(readings, RAW_SAMPLES, sizeof(int), compareIntegers);
+  long sum = 0;
+  int samplesToAverage = 0;
+  for (int i = RAW_TRIM; i < RAW_SAMPLES - RAW_TRIM; i++) {
+    sum += readings[i];
+    samplesToAverage++;
+  }
+  return sum / samplesToAverage;
+}
+
+struct LegacySma {
+  double buffer[SMOOTHING_SAMPLES];
+  int index = 0;
+  double sum = 0;
+  int stored = 0;
+
+  double update(double value) {
+    if (stored == SMOOTHING_SAMPLES) sum -= buffer[index];
+    buffer[index] = value;
+    sum += value;
+    index = (index + 1) % SMOOTHING_SAMPLES;
+    if (stored < SMOOTHING_SAMPLES) stored++;
+    return sum / stored;
+  }
+};
+
+// --- Inputs ---
+enum Pattern { PATTERN_RANDOM, PATTERN_CONSTANT, PATTERN_RAMP, PATTERN_SPIKES, PATTERN_FEW_VALUES, PATTERN_COUNT };
+const char* PATTERN_NAMES[PATTERN_COUNT] = {"random", "constant", "ramp", "spikes", "few-values"};
+
+std::vector<int> makeInput(Pattern pattern, unsigned long count) {
+  std::vector<int> input(count);
+  for (unsigned long i = 0; i < count; i++) {
+    switch (pattern) {
+      case PATTERN_RANDOM: input[i] = rand() % 4096; break;
+      case PATTERN_CONSTANT: input[i] = 1234; break;
+      case PATTERN_RAMP: input[i] = (int)(i % 4096); break;
+      case PATTERN_SPIKES: input[i] = 1500 + rand() % 16 + ((rand() % 50 == 0) ? 2000 : 0); break;
+      default: input[i] = rand() % 3; break; // Many duplicates
+    }
+  }
+  return input;
+}
+
+// --- Brute-force references over the last `window` samples ---
+void sortedWindow(const std::vector<int>& input, unsigned long end, size_t window, std::vector<int>& out) {
+  size_t count = end + 1 < window ? end + 1 : window;
+  out.assign(input.begin() + (end + 1 - count), input.begin() + end + 1);
+  qsort(out.data(), out.size(), sizeof(int), compareIntegers);
+}
+
+int failures = 0;
+
+void reportMismatch(const char* check, Pattern pattern, unsigned long index, double expected, double actual) {
+  if (failures++ < 10) {
+    printf("MISMATCH %-22s %-10s sample %lu: expected %.6f got %.6f\n", check, PATTERN_NAMES[pattern], index,
+           expected, actual);
+  }
+}
+
+template <size_t N>
+void checkSortingNetwork() {
+  // 0-1 principle: a network sorts every input iff it sorts every binary input.
+  for (unsigned bits = 0; bits < (1u << N); bits++) {
+    int values[N];
+    int ones = 0;
+    for (size_t i = 0; i < N; i++) {
+      values[i] = (bits >> i) & 1;
+      ones += values[i];
+    }
+    sortSmall(values);
+    for (size_t i = 0; i < N; i++) {
+      if (values[i] != (i >= N - ones ? 1 : 0)) {
+        reportMismatch("sorting network", PATTERN_RANDOM, bits, (double)N, (double)i);
+        return;
+      }
+    }
+  }
+}
+
+void runPropertyChecks(const BenchOptions& options) {
+  checkSortingNetwork<2>();
+  checkSortingNetwork<3>();
+  checkSortingNetwork<4>();
+  checkSortingNetwork<5>();
+  checkSortingNetwork<6>();
+  checkSortingNetwork<7>();
+  checkSortingNetwork<8>();
+  checkSortingNetwork<11>(); // Insertion sort fallback
+
+  std::vector<int> reference;
+  for (int p = 0; p < PATTERN_COUNT; p++) {
+    Pattern pattern = (Pattern)p;
+    srand(options.seed + p);
+    std::vector<int> input = makeInput(pattern, options.propertySamples);
+
+    // Block trimmed mean: sorting network vs the former qsort path, identical integers.
+    for (unsigned long i = 0; i + RAW_SAMPLES <= input.size(); i += RAW_SAMPLES) {
+      int legacy[RAW_SAMPLES];
+      int network[RAW_SAMPLES];
+      memcpy(legacy, &input[i], sizeof(legacy));
+      memcpy(network, &input[i], sizeof(network));
+      int expected = qsortTrimmedMean(legacy);
+      int actual = trimmedMean<RAW_TRIM>(network);
+      if (expected != actual) reportMismatch("block trimmed mean", pattern, i, expected, actual);
+    }
+
+    MovingAverage<double, SMOOTHING_SAMPLES> movingAverage;
+    LegacySma legacySma;
+    SlidingMedian<double, 5> median5;
+    SlidingMedian<double, 8> median8;
+    SlidingTrimmedMean<int, RAW_SAMPLES, RAW_TRIM> trimmed;
+    for (unsigned long i = 0; i < input.size(); i++) {
+      double expected = legacySma.update(input[i]);
+      double actual = movingAverage.update(input[i]);
+      if (expected != actual) reportMismatch("moving average", pattern, i, expected, actual);
+
+      sortedWindow(input, i, SMOOTHING_SAMPLES, reference);
+      if (movingAverage.minimum() != reference.front() || movingAverage.maximum() != reference.back()) {
+        reportMismatch("moving average min/max", pattern, i, reference.front(), movingAverage.minimum());
+      }
+
+      size_t n = reference.size();
+      expected = (n & 1) ? reference[n / 2] : (reference[n / 2 - 1] + (double)reference[n / 2]) / 2;
+      actual = median5.update(input[i]);
+      if (expected != actual) reportMismatch("sliding median (5)", pattern, i, expected, actual);
+
+      sortedWindow(input, i, 8, reference);
+      n = reference.size();
+      expected = (n & 1) ? reference[n / 2] : (reference[n / 2 - 1] + (double)reference[n / 2]) / 2;
+      actual = median8.update(input[i]);
+      if (expected != actual) reportMismatch("sliding median (8)", pattern, i, expected, actual);
+
+      sortedWindow(input, i, RAW_SAMPLES, reference);
+      n = reference.size();
+      size_t trim = n > 2 * RAW_TRIM ? RAW_TRIM : 0;
+      double sum = 0;
+      for (size_t k = trim; k < n - trim; k++) sum += reference[k];
+      expected = sum / (double)(n - 2 * trim);
+      actual = trimmed.update(input[i]);
+      if (fabs(expected - actual) > 1e-9) reportMismatch("sliding trimmed mean", pattern, i, expected, actual);
+    }
+  }
+}
+
+// --- Benchmark ---
+struct Cost {
+  double nsPerSample;
+  double cyclesPerSample; // NAN without a cycle counter
+};
+
+uint64_t readCycles() {
+#ifdef FILTER_BENCH_HAS_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+volatile double benchSink; // Keeps results observable so loops are not optimised away
+
+template <typename Body>
+Cost measure(unsigned long samples, Body body) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  uint64_t startCycles = readCycles();
+  double sink = body();
+  uint64_t cycles = readCycles() - startCycles;
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  benchSink = sink;
+  Cost cost;
+  cost.nsPerSample = seconds * 1e9 / samples;
+#ifdef FILTER_BENCH_HAS_TSC
+  cost.cyclesPerSample = (double)cycles / samples;
+#else
+  (void)cycles;
+  cost.cyclesPerSample = NAN;
+#endif
+  return cost;
+}
+
+void printCost(const char* name, const Cost& cost) {
+  if (isnan(cost.cyclesPerSample)) {
+    printf("  %-36s %8.2f ns/sample\n", name, cost.nsPerSample);
+  } else {
+    printf("  %-36s %8.2f ns/sample %8.1f cycles/sample\n", name, cost.nsPerSample, cost.cyclesPerSample);
+  }
+}
+
+void runBenchmark(const BenchOptions& options) {
+  srand(options.seed);
+  const std::vector<int> input = makeInput(PATTERN_SPIKES, options.samples);
+  const unsigned long blockSamples = options.samples / RAW_SAMPLES * RAW_SAMPLES;
+
+  printf("per-sample cost over %lu samples:\n", options.samples);
+  printCost("qsort trimmed mean (7, former)", measure(blockSamples, [&]() {
+    double sum = 0;
+    int readings[RAW_SAMPLES];
+    for (unsigned long i = 0; i < blockSamples; i += RAW_SAMPLES) {
+      memcpy(readings, &input[i], sizeof(readings));
+      sum += qsortTrimmedMean(readings);
+    }
+    return sum;
+  }));
+  printCost("sorting network trimmed mean (7)", measure(blockSamples, [&]() {
+    double sum = 0;
+    int readings[RAW_SAMPLES];
+    for (unsigned long i = 0; i < blockSamples; i += RAW_SAMPLES) {
+      memcpy(readings, &input[i], sizeof(readings));
+      sum += trimmedMean<RAW_TRIM>(readings);
+    }
+    return sum;
+  }));
+  printCost("SMA (5, former)", measure(options.samples, [&]() {
+    LegacySma sma;
+    double sum = 0;
+    for (unsigned long i = 0; i < options.samples; i++) sum += sma.update(input[i]);
+    return sum;
+  }));
+  printCost("MovingAverage<5>", measure(options.samples, [&]() {
+    MovingAverage<double, SMOOTHING_SAMPLES> sma;
+    double sum = 0;
+    for (unsigned long i = 0; i < options.samples; i++) sum += sma.update(input[i]);
+    return sum;
+  }));
+  printCost("sliding qsort trimmed mean (7)", measure(options.samples, [&]() {
+    double sum = 0;
+    int window[RAW_SAMPLES] = {0};
+    int readings[RAW_SAMPLES];
+    for (unsigned long i = 0; i < options.samples; i++) {
+      window[i % RAW_SAMPLES] = input[i];
+      memcpy(readings, window, sizeof(readings));
+      sum += qsortTrimmedMean(readings);
+    }
+    return sum;
+  }));
+  printCost("SlidingTrimmedMean<7,1>", measure(options.samples, [&]() {
+    SlidingTrimmedMean<int, RAW_SAMPLES, RAW_TRIM> filter;
+    double sum = 0;
+    for (unsigned long i = 0; i < options.samples; i++) sum += filter.update(input[i]);
+    return sum;
+  }));
+  printCost("SlidingMedian<7>", measure(options.samples, [&]() {
+    SlidingMedian<int, RAW_SAMPLES> filter;
+    double sum = 0;
+    for (unsigned long i = 0; i < options.samples; i++) sum += filter.update(input[i]);
+    return sum;
+  }));
+  printCost("SlidingMedian<31>", measure(options.samples, [&]() {
+    SlidingMedian<int, 31> filter;
+    double sum = 0;
+    for (unsigned long i = 0; i < options.samples; i++) sum += filter.update(input[i]);
+    return sum;
+  }));
+}
+
+} // namespace
+
+int runFilterBench(int argc, char** argv) {
+  BenchOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+  runPropertyChecks(options);
+  if (failures) {
+    printf("property checks: %d mismatches\n", failures);
+    return 1;
+  }
+  printf("property checks: all filters match the brute-force references\n");
+  runBenchmark(options);
+  return 0;
+}
@@ -0,0 +1,7 @@
+#ifndef FILTER_BENCH_H
+#define FILTER_BENCH_H
+
+// `program filters [options]`: property checks and per-sample cost of lib/SignalFilters.
+int runFilterBench(int argc, char** argv);
+
+#endif // FILTER_BENCH_H
@@ -0,0 +1,278 @@
+// Error bounds and micro-benchmark for the fixed-point sensor pipeline (SENSOR_FIXED_POINT).
+//
+// Runs the firmware's sensor math -- thermocouple calibration, temperature EMAs, ADC counts
+// to bar with its SMA, and the max-pressure stability check -- in double (reference), float
+// and Q16.16 side by side on the same inputs. Each Q16.16 and float result must stay within
+// the bound below; a violation is printed and makes the program exit non-zero. The cost per
+// sample is measured on the host, which has a hardware double unit; on the ESP32 double is
+// emulated in software and the gap to float/Q16.16 is far wider. Typical use:
+//
+//   .pio/build/native/program fixed
+//   .pio/build/native/program fixed --samples 2000000 --seed 3
+#include <chrono>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define FIXED_BENCH_HAS_TSC 1
+#endif
+
+#include "EmaFilter.h"
+#include "FixedPoint.h"
+#include "MovingAverage.h"
+#include "PressureScale.h"
+#include "SensorScalar.h"
+#include "TemperatureCalibration.h"
+#include "fixed_bench.h"
+
+namespace {
+
+// Firmware constants (src/main.cpp, HeaterControllerConfig)
+const double RAW_TEMPS_C[2] = {99.0, 115.0};
+const double ACTUAL_TEMPS_C[2] = {85.0, 97.8};
+const float TEMP_EMA_ALPHA = 0.07f;
+const float REGULATION_EMA_ALPHA = 0.3f;
+const double VOLTS_AT_0_BAR = 0.34;
+const double VOLTS_AT_16_BAR = 4.34;
+const double PRESSURE_MAX_BAR = 16.0;
+const double ADC_MAX_VOLTAGE = 3.3;
+const double ADC_MAX_VALUE = 4095.0;
+const int DECIMATED_BLOCK_SAMPLES = 38; // 40-sample block without its min and max
+const double STABILITY_THRESHOLD_BAR = 0.2;
+
+// Allowed deviation from the double reference
+const double TEMPERATURE_BOUND_C = 0.005;
+const double PRESSURE_BOUND_BAR = 0.002;
+
+struct BenchOptions {
+  unsigned long samples = 500000;
+  unsigned seed = 1;
+};
+
+void printUsage() {
+  printf("usage: program fixed [options]\n"
+         "  --samples N        samples per check and benchmark (default 500000)\n"
+         "  --seed N           input seed (default 1)\n");
+}
+
+bool parseOptions(int argc, char** argv, BenchOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--samples") == 0) options.samples = strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--seed") == 0) options.seed = (unsigned)atoi(value);
+    else return false;
+    i++;
+  }
+  return options.samples > 0;
+}
+
+// --- The firmware's sensor math, for any scalar type ---
+template <typename Scalar>
+struct TemperaturePath {
+  BasicTemperatureCalibration<Scalar> calibration;
+  BasicEmaFilter<Scalar> ema;
+  BasicEmaFilter<Scalar> regulationEma;
+
+  TemperaturePath()
+      : calibration(RAW_TEMPS_C, ACTUAL_TEMPS_C, 2), ema(TEMP_EMA_ALPHA), regulationEma(REGULATION_EMA_ALPHA) {}
+
+  void step(double rawTempC) {
+    Scalar calibrated = calibration.apply(Scalar(rawTempC));
+    ema.update(calibrated);
+    regulationEma.update(calibrated);
+  }
+};
+
+template <typename Scalar, typename Accumulator>
+struct PressurePath {
+  BasicPressureScale<Scalar> scale;
+  MovingAverage<Scalar, 5, Accumulator> smoothing;
+  MovingAverage<Scalar, 5, Accumulator> stabilityWindow;
+  Scalar threshold;
+  Scalar bar;
+  bool stable;
+  Scalar stableMean;
+
+  PressurePath()
+      : scale(VOLTS_AT_0_BAR, VOLTS_AT_16_BAR, PRESSURE_MAX_BAR, ADC_MAX_VOLTAGE, ADC_MAX_VALUE),
+        threshold(STABILITY_THRESHOLD_BAR), bar(0), stable(false), stableMean(0) {}
+
+  // One decimated block: trimmed sum of raw counts over DECIMATED_BLOCK_SAMPLES.
+  void step(int64_t trimmedSum) {
+    Scalar adc = scalarRatio<Scalar>(trimmedSum, DECIMATED_BLOCK_SAMPLES);
+    bar = scale.toBar(Scalar(smoothing.update(adc)));
+    stabilityWindow.update(bar);
+    stable = stabilityWindow.full() && stabilityWindow.maximum() - stabilityWindow.minimum() <= threshold;
+    if (stable) stableMean = Scalar(stabilityWindow.mean());
+  }
+};
+
+// --- Inputs ---
+// MAX6675-like readings (0.25 C steps) wandering between ambient and overheated.
+std::vector<double> makeTemperatures(unsigned long count) {
+  std::vector<double> temps(count);
+  double t = 90.0;
+  for (unsigned long i = 0; i < count; i++) {
+    t += (rand() % 21 - 10) * 0.05;
+    if (t < 20.0) t = 20.0;
+    if (t > 160.0) t = 160.0;
+    temps[i] = floor(t * 4.0) / 4.0;
+  }
+  return temps;
+}
+
+// Trimmed block sums: pressure plateaus with noise, ramps and occasional jumps.
+std::vector<int64_t> makeBlockSums(unsigned long count) {
+  std::vector<int64_t> sums(count);
+  double counts = 600.0;
+  double target = 600.0;
+  for (unsigned long i = 0; i < count; i++) {
+    if (rand() % 200 == 0) target = 420.0 + rand() % 3600;
+    counts += (target - counts) * 0.05;
+    double noisy = counts + (rand() % 13 - 6);
+    if (noisy < 0.0) noisy = 0.0;
+    if (noisy > ADC_MAX_VALUE) noisy = ADC_MAX_VALUE;
+    sums[i] = (int64_t)(noisy * DECIMATED_BLOCK_SAMPLES) + rand() % DECIMATED_BLOCK_SAMPLES;
+  }
+  return sums;
+}
+
+// --- Error bounds ---
+struct ErrorBound {
+  const char* name;
+  double bound;
+  double worst = 0.0;
+
+  ErrorBound(const char* checkName, double limit) : name(checkName), bound(limit) {}
+  void add(double error) {
+    if (fabs(error) > worst) worst = fabs(error);
+  }
+  bool report(const char* type) const {
+    bool ok = worst <= bound;
+    printf("  %-8s %-32s worst %.6f (bound %.4f) %s\n", type, name, worst, bound, ok ? "ok" : "EXCEEDED");
+    return ok;
+  }
+};
+
+template <typename Scalar, typename Accumulator>
+bool checkAgainstDouble(const char* type, const std::vector<double>& temps, const std::vector<int64_t>& sums) {
+  ErrorBound calibration("calibration", TEMPERATURE_BOUND_C);
+  ErrorBound ema("temperature EMA (0.07)", TEMPERATURE_BOUND_C);
+  ErrorBound regulationEma("regulation EMA (0.3)", TEMPERATURE_BOUND_C);
+  ErrorBound bar("ADC counts to bar (with SMA)", PRESSURE_BOUND_BAR);
+  ErrorBound stableMean("stability window mean", PRESSURE_BOUND_BAR);
+
+  TemperaturePath<double> referenceTemp;
+  TemperaturePath<Scalar> testTemp;
+  for (size_t i = 0; i < temps.size(); i++) {
+    referenceTemp.step(temps[i]);
+    testTemp.step(temps[i]);
+    calibration.add((double)testTemp.calibration.apply(Scalar(temps[i])) - referenceTemp.calibration.apply(temps[i]));
+    ema.add(testTemp.ema.value() - referenceTemp.ema.value());
+    regulationEma.add(testTemp.regulationEma.value() - referenceTemp.regulationEma.value());
+  }
+
+  PressurePath<double, double> referencePressure;
+  PressurePath<Scalar, Accumulator> testPressure;
+  unsigned long decisionMismatches = 0;
+  unsigned long unexplainedMismatches = 0;
+  for (size_t i = 0; i < sums.size(); i++) {
+    referencePressure.step(sums[i]);
+    testPressure.step(sums[i]);
+    bar.add((double)testPressure.bar - referencePressure.bar);
+    if (testPressure.stable != referencePressure.stable) {
+      // Only acceptable when the window range sits on the threshold within the error bound.
+      decisionMismatches++;
+      double range = referencePressure.stabilityWindow.maximum() - referencePressure.stabilityWindow.minimum();
+      if (fabs(range - STABILITY_THRESHOLD_BAR) > 2 * PRESSURE_BOUND_BAR) unexplainedMismatches++;
+    } else if (testPressure.stable) {
+      stableMean.add((double)testPressure.stableMean - referencePressure.stableMean);
+    }
+  }
+
+  bool ok = calibration.report(type);
+  ok = ema.report(type) && ok;
+  ok = regulationEma.report(type) && ok;
+  ok = bar.report(type) && ok;
+  ok = stableMean.report(type) && ok;
+  printf("  %-8s %-32s %lu differ, all at the threshold: %s\n", type, "stability decisions", decisionMismatches,
+         unexplainedMismatches == 0 ? "ok" : "NO");
+  return ok && unexplainedMismatches == 0;
+}
+
+// --- Benchmark ---
+uint64_t readCycles() {
+#ifdef FIXED_BENCH_HAS_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+volatile double benchSink; // Keeps results observable so loops are not optimised away
+
+template <typename Body>
+void measure(const char* name, unsigned long samples, Body body) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  uint64_t startCycles = readCycles();
+  benchSink = body();
+  uint64_t cycles = readCycles() - startCycles;
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+#ifdef FIXED_BENCH_HAS_TSC
+  printf("  %-36s %8.2f ns/sample %8.1f cycles/sample\n", name, seconds * 1e9 / samples, (double)cycles / samples);
+#else
+  (void)cycles;
+  printf("  %-36s %8.2f ns/sample\n", name, seconds * 1e9 / samples);
+#endif
+}
+
+template <typename Scalar>
+double runTemperature(const std::vector<double>& temps) {
+  TemperaturePath<Scalar> path;
+  for (size_t i = 0; i < temps.size(); i++) path.step(temps[i]);
+  return path.ema.value();
+}
+
+template <typename Scalar, typename Accumulator>
+double runPressure(const std::vector<int64_t>& sums) {
+  PressurePath<Scalar, Accumulator> path;
+  double stableCount = 0;
+  for (size_t i = 0; i < sums.size(); i++) {
+    path.step(sums[i]);
+    stableCount += path.stable;
+  }
+  return stableCount + (double)path.bar;
+}
+
+} // namespace
+
+int runFixedBench(int argc, char** argv) {
+  BenchOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+  srand(options.seed);
+  const std::vector<double> temps = makeTemperatures(options.samples);
+  const std::vector<int64_t> sums = makeBlockSums(options.samples);
+
+  printf("deviation from double over %lu samples:\n", options.samples);
+  bool ok = checkAgainstDouble<float, double>("float", temps, sums);
+  ok = checkAgainstDouble<Q16_16, Q16_16>("Q16.16", temps, sums) && ok;
+
+  printf("per-sample cost (host):\n");
+  measure("temperature path, double", temps.size(), [&]() { return runTemperature<double>(temps); });
+  measure("temperature path, float", temps.size(), [&]() { return runTemperature<float>(temps); });
+  measure("temperature path, Q16.16", temps.size(), [&]() { return runTemperature<Q16_16>(temps); });
+  measure("pressure path, double", sums.size(), [&]() { return runPressure<double, double>(sums); });
+  measure("pressure path, float", sums.size(), [&]() { return runPressure<float, double>(sums); });
+  measure("pressure path, Q16.16", sums.size(), [&]() { return runPressure<Q16_16, Q16_16>(sums); });
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,7 @@
+#ifndef FIXED_BENCH_H
+#define FIXED_BENCH_H
+
+// `program fixed [options]`: Q16.16 sensor math error bounds and cost against float/double.
+int runFixedBench(int argc, char** argv);
+
+#endif // FIXED_BENCH_H
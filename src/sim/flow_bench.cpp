@@ -0,0 +1,306 @@
+// Flow and yield estimation benchmark: the flow estimator (lib/PressureProfile) against the
+// pump/puck hydraulic model (lib/BoilerSim), which knows the true flow through the puck.
+//
+// Same firmware pressure path as `program profile`: 2 kHz ADC samples with the pump ripple
+// and noise, the trimmed-mean decimator, the ADC-to-bar scale and the 5-block SMA. The
+// brew switch goes on at 0 s, the shot timer starts at 2 bar and stops when the pressure
+// falls below 1.7 bar after the switch goes off. Scenarios:
+//
+//   stock        full pump power, nominal puck, switch off at 30 s
+//   fine         puck resistance x1.4
+//   coarse       puck resistance x0.8
+//   channeling   resistance drops 25% at 15 s
+//   profile      default pressure profile through the pump controller
+//   early-off    switch off at 12 s, the pressure decays through the puck for longer
+//   stop36       volumetric stop at 36 ml (the switch stays on until 45 s)
+//   worn         pump with 15% less flow than the estimator's curve: one shot with the
+//                default flowScale, then one with the scale flowScaleFor() derives from
+//                the first shot's weighed yield
+//
+// Against the model: the estimated shot volume at the timer stop vs the water that went
+// through the puck meanwhile, the RMS flow error from 2 s into the shot, and for stop36 the
+// cup after the drips end vs the target. Every scenario must stay within the bounds below
+// (worn: its calibrated shot), or the run fails. Typical use:
+//
+//   .pio/build/native/program flow
+//   .pio/build/native/program flow --scenario early-off --csv early-off.csv
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FlowEstimator.h"
+#include "HydraulicModel.h"
+#include "MovingAverage.h"
+#include "PressureDecimator.h"
+#include "PressureScale.h"
+#include "PumpController.h"
+#include "SensorScalar.h"
+#include "bench_report.h"
+#include "flow_bench.h"
+
+namespace {
+
+// Firmware pressure path (src/main.cpp)
+const uint32_t SAMPLE_RATE_HZ = 2000;
+const uint16_t DECIMATION_FACTOR = 40;
+const double VOLTS_AT_0_BAR = 0.34;
+const double VOLTS_AT_16_BAR = 4.34;
+const double PRESSURE_MAX_BAR = 16.0;
+const double ADC_MAX_VOLTAGE = 3.3;
+const double ADC_MAX_VALUE = 4095.0;
+const float SHOT_START_BAR = 2.0f;
+const float SHOT_STOP_BAR = 1.7f;
+const double SENSOR_NOISE_BAR = 0.03;
+
+const double MAX_SIM_S = 60.0;
+const double DRIP_S = 10.0;     // Run on after the timer stops (stop36: the cup settles)
+const double FLOW_SETTLE_S = 2.0; // Flow is scored from here
+
+// Bounds against the model
+const double VOLUME_BOUND_ML = 1.5;
+const double VOLUME_BOUND_FRACTION = 0.05; // Whichever is larger
+const double FLOW_RMS_BOUND_MLPS = 0.35;
+const double STOP_BOUND_ML = 2.0;
+
+struct FlowBenchOptions {
+  const char* scenario = "all";
+  unsigned seed = 1;
+  const char* csvPath = nullptr;
+  FlowEstimatorConfig config;
+};
+
+void printUsage() {
+  printf("usage: program flow [options]\n"
+         "  --scenario NAME    stock, fine, coarse, channeling, profile, early-off, stop36, worn or all (default all)\n"
+         "  --seed N           sensor noise seed (default 1)\n"
+         "  --csv PATH         trace of the (first) scenario: time, pressure, power, true and estimated flow and volume\n"
+         "  --compliance X     estimator ml per bar (default from FlowEstimatorConfig)\n"
+         "  --slope-tc X       estimator dP/dt smoothing, seconds\n");
+}
+
+bool parseOptions(int argc, char** argv, FlowBenchOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--scenario") == 0) options.scenario = value;
+    else if (strcmp(arg, "--seed") == 0) options.seed = (unsigned)strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--csv") == 0) options.csvPath = value;
+    else if (strcmp(arg, "--compliance") == 0) options.config.complianceMlPerBar = (float)atof(value);
+    else if (strcmp(arg, "--slope-tc") == 0) options.config.slopeTimeConstantS = (float)atof(value);
+    else return false;
+    i++;
+  }
+  return true;
+}
+
+// --- Scenarios ---
+struct Scenario {
+  const char* name;
+  double puckScale;
+  double channelAtS;    // < 0: none
+  double channelScale;
+  bool profiled;
+  double switchOffS;    // Brew switch off
+  float targetMl;       // Volumetric stop, 0: off
+  double pumpFlowScale; // Model pump against the estimator's curve
+};
+
+const Scenario SCENARIOS[] = {
+    {"stock", 1.0, -1.0, 1.0, false, 30.0, 0.0f, 1.0},
+    {"fine", 1.4, -1.0, 1.0, false, 30.0, 0.0f, 1.0},
+    {"coarse", 0.8, -1.0, 1.0, false, 30.0, 0.0f, 1.0},
+    {"channeling", 1.0, 15.0, 0.75, false, 30.0, 0.0f, 1.0},
+    {"profile", 1.0, -1.0, 1.0, true, 36.0, 0.0f, 1.0},
+    {"early-off", 1.0, -1.0, 1.0, false, 12.0, 0.0f, 1.0},
+    {"stop36", 1.0, -1.0, 1.0, false, 45.0, 36.0f, 1.0},
+    {"worn", 1.0, -1.0, 1.0, false, 30.0, 0.0f, 0.85},
+};
+
+struct ShotResult {
+  double durationS = NAN;
+  double trueVolumeMl = NAN;      // Through the puck while the timer ran
+  double estimatedVolumeMl = NAN;
+  double cupMl = NAN;             // After the drips
+  double flowRmsMlPerS = NAN;
+  double pumpOffS = 0.0;          // Time attributed to a stopped pump
+  FlowShotTotals totals;
+  double cpuNsPerUpdate = 0.0;
+};
+
+// --- One shot through the firmware's pressure path ---
+ShotResult runShot(const Scenario& scenario, float flowScale, const FlowBenchOptions& options, FILE* csv) {
+  FlowEstimator estimator(options.config);
+  estimator.setFlowScale(flowScale);
+  estimator.setTargetVolume(scenario.targetMl);
+  PumpController controller;
+  controller.setEnabled(scenario.profiled);
+
+  HydraulicModelParams params;
+  params.freeFlowMlPerS *= scenario.pumpFlowScale;
+  HydraulicModel model(params);
+  model.scalePuckResistance(scenario.puckScale);
+  model.setPumpRunning(true);
+  model.setPowerPercent(controller.power());
+
+  PressureDecimator decimator(SAMPLE_RATE_HZ, DECIMATION_FACTOR);
+  PressureScale scale(VOLTS_AT_0_BAR, VOLTS_AT_16_BAR, PRESSURE_MAX_BAR, ADC_MAX_VOLTAGE, ADC_MAX_VALUE);
+  MovingAverage<SensorScalar, 5, SensorAccumulator> smoothing;
+  std::mt19937 random(options.seed);
+  std::normal_distribution<double> noise(0.0, SENSOR_NOISE_BAR);
+
+  ShotResult result;
+  bool shotRunning = false;
+  bool shotDone = false;
+  bool channeled = false;
+  bool stopped = false; // Volumetric stop holds the pump off
+  double startS = NAN, stopS = NAN, startCupMl = 0.0;
+  float power = controller.power();
+  double previousS = 0.0;
+  double squaredError = 0.0, cpuNs = 0.0;
+  unsigned long scored = 0, updates = 0;
+  const double dt = 1.0 / SAMPLE_RATE_HZ;
+  const unsigned long steps = (unsigned long)(MAX_SIM_S * SAMPLE_RATE_HZ);
+  for (unsigned long i = 0; i < steps; i++) {
+    double timeS = i * dt;
+    if (shotDone && timeS - stopS >= DRIP_S) break;
+    model.setPumpRunning(timeS < scenario.switchOffS);
+    model.step(dt);
+    double volts = VOLTS_AT_0_BAR + (model.sensorPressureBar() + noise(random)) / PRESSURE_MAX_BAR * (VOLTS_AT_16_BAR - VOLTS_AT_0_BAR);
+    long counts = lround(volts / ADC_MAX_VOLTAGE * ADC_MAX_VALUE);
+    if (counts < 0) counts = 0;
+    if (counts > (long)ADC_MAX_VALUE) counts = (long)ADC_MAX_VALUE;
+
+    DecimatedSample block;
+    if (!decimator.push((uint16_t)counts, block)) continue;
+
+    // One decimated block, as processPressureBlock() handles it
+    double nowS = (double)decimator.sampleTimeMs(block.sampleIndex + DECIMATION_FACTOR) / 1000.0;
+    float pressureBar = (float)scale.toBar(SensorScalar(smoothing.update(block.adcValue)));
+    if (!shotRunning && !shotDone && pressureBar >= SHOT_START_BAR) {
+      shotRunning = true;
+      startS = nowS;
+      startCupMl = model.cupVolumeMl();
+      controller.start();
+      estimator.start();
+    } else if (shotRunning && pressureBar < SHOT_STOP_BAR) {
+      shotRunning = false;
+      shotDone = true;
+      stopS = nowS;
+      controller.stop();
+      estimator.stop();
+      result.durationS = stopS - startS;
+      result.trueVolumeMl = model.cupVolumeMl() - startCupMl;
+      result.estimatedVolumeMl = estimator.volumeMl();
+      result.totals = estimator.totals();
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    estimator.update((float)(nowS - previousS), power, pressureBar); // Power of the block just ended
+    cpuNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    updates++;
+    previousS = nowS;
+
+    float shotSeconds = shotRunning ? (float)(nowS - startS) : 0.0f;
+    power = controller.update(shotSeconds, pressureBar);
+    if (estimator.targetReached()) stopped = true;
+    if (stopped) power = 0.0f;
+    model.setPowerPercent(power);
+
+    if (scenario.channelAtS >= 0 && shotRunning && !channeled && shotSeconds >= scenario.channelAtS) {
+      model.scalePuckResistance(scenario.channelScale);
+      channeled = true;
+    }
+
+    if (!shotRunning) continue;
+    double error = estimator.flowMlPerS() - model.puckFlowMlPerS();
+    if (!estimator.pumpRunning()) result.pumpOffS += 1.0 / decimator.outputRateHz();
+    if (csv) {
+      fprintf(csv, "%.2f,%.3f,%.0f,%.3f,%.3f,%.2f,%.2f,%d\n", nowS, pressureBar, power, model.puckFlowMlPerS(),
+              estimator.flowMlPerS(), model.cupVolumeMl() - startCupMl, estimator.volumeMl(), estimator.pumpRunning() ? 1 : 0);
+    }
+    if (shotSeconds < FLOW_SETTLE_S) continue;
+    squaredError += error * error;
+    scored++;
+  }
+  result.cupMl = model.cupVolumeMl();
+  result.flowRmsMlPerS = scored > 0 ? sqrt(squaredError / scored) : NAN;
+  result.cpuNsPerUpdate = updates > 0 ? cpuNs / updates : 0.0;
+  return result;
+}
+
+bool checkShot(const Scenario& scenario, const ShotResult& r) {
+  bool ok = true;
+  double volumeBound = fmax(VOLUME_BOUND_ML, VOLUME_BOUND_FRACTION * r.trueVolumeMl);
+  if (!(fabs(r.estimatedVolumeMl - r.trueVolumeMl) <= volumeBound)) {
+    printf("  %s: volume off by more than %.1f ml\n", scenario.name, volumeBound);
+    ok = false;
+  }
+  if (!(r.flowRmsMlPerS <= FLOW_RMS_BOUND_MLPS)) {
+    printf("  %s: flow RMS error above %.2f ml/s\n", scenario.name, FLOW_RMS_BOUND_MLPS);
+    ok = false;
+  }
+  if (scenario.targetMl > 0.0f && !(fabs(r.cupMl - scenario.targetMl) <= STOP_BOUND_ML)) {
+    printf("  %s: cup %.1f ml, more than %.1f ml from the target\n", scenario.name, r.cupMl, STOP_BOUND_ML);
+    ok = false;
+  }
+  return ok;
+}
+
+void printShot(const char* name, float flowScale, const ShotResult& r) {
+  printf("%-11s %6.3f %7.1f %8.1f %8.1f %7.1f %8.1f %8.3f %7.1f %7.0f\n", name, flowScale, r.durationS, r.trueVolumeMl,
+         r.estimatedVolumeMl, r.estimatedVolumeMl - r.trueVolumeMl, r.cupMl, r.flowRmsMlPerS, r.pumpOffS,
+         r.cpuNsPerUpdate);
+}
+
+} // namespace
+
+int runFlowBench(int argc, char** argv) {
+  FlowBenchOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+
+  FILE* csv = nullptr;
+  if (options.csvPath) {
+    csv = fopen(options.csvPath, "w");
+    if (!csv) {
+      fprintf(stderr, "cannot write %s\n", options.csvPath);
+      return 1;
+    }
+    fprintf(csv, "time_s,pressure_bar,pump_power,true_flow,est_flow,true_volume,est_volume,pump_running\n");
+  }
+
+  bool ok = true;
+  bool any = false;
+  printf("%-11s %6s %7s %8s %8s %7s %8s %8s %7s %7s\n", "scenario", "scale", "shot_s", "true_ml", "est_ml", "err_ml",
+         "cup_ml", "flow_rms", "off_s", "cpu_ns");
+  for (size_t s = 0; s < sizeof(SCENARIOS) / sizeof(SCENARIOS[0]); s++) {
+    const Scenario& scenario = SCENARIOS[s];
+    if (!scenarioSelected(options.scenario, scenario.name)) continue;
+    any = true;
+    ShotResult result = runShot(scenario, 1.0f, options, csv);
+    printShot(scenario.name, 1.0f, result);
+    if (csv) {
+      fclose(csv);
+      csv = nullptr;
+    }
+    if (scenario.pumpFlowScale != 1.0) {
+      // Weigh the first shot's cup, calibrate, pull another
+      float flowScale = flowScaleFor(result.totals, (float)result.trueVolumeMl);
+      result = runShot(scenario, flowScale, options, nullptr);
+      printShot(scenario.name, flowScale, result);
+    }
+    if (!checkShot(scenario, result)) ok = false;
+  }
+  if (csv) fclose(csv);
+  if (!any) {
+    printUsage();
+    return 1;
+  }
+  return benchResult("flow", ok);
+}
@@ -0,0 +1,8 @@
+#ifndef FLOW_BENCH_H
+#define FLOW_BENCH_H
+
+// `program flow [options]`: flow and shot volume estimated from pressure and pump power
+// against the pump/puck hydraulic model, through the firmware's pressure path.
+int runFlowBench(int argc, char** argv);
+
+#endif // FLOW_BENCH_H
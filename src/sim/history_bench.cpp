@@ -0,0 +1,288 @@
+// Host checks for the tiered min/max/mean history (lib/TieredHistory).
+//
+// A synthetic session (heat-up, idle ripple, shots with pressure pulses, paused plots and a
+// long gap with no samples, one history clear) is fed at the firmware's 10 Hz. At regular
+// checkpoints every tier is compared against a brute-force reference over the raw samples:
+// same non-empty buckets at the same times, means within half a quantization step, and a
+// stored min/max band that contains the real one by at most one spread step.
+// Also reports the RAM against the former 90-point rings, the /history.bin frame size per
+// tier, and the cost per sample.
+//
+//   .pio/build/native/program history
+//   .pio/build/native/program history --hours 6 --seed 2
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "TelemetryFrame.h"
+#include "TieredHistory.h"
+#include "bench_report.h"
+#include "history_bench.h"
+
+namespace {
+
+const unsigned long SAMPLE_INTERVAL_MS = 100;  // historySampleInterval in the firmware
+const size_t FORMER_HISTORY_SIZE = 90;         // Former rings: 90 x {unsigned long, float}
+const unsigned long CHECK_INTERVAL_MS = 437000; // Odd, so checkpoints land inside buckets
+
+struct HistoryOptions {
+  double hours = 3.0;
+  unsigned seed = 1;
+};
+
+void printUsage() {
+  printf("usage: program history [options]\n"
+         "  --hours H          simulated session length (default 3)\n"
+         "  --seed N           noise and shot timing seed (default 1)\n");
+}
+
+bool parseOptions(int argc, char** argv, HistoryOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--hours") == 0) options.hours = atof(value);
+    else if (strcmp(arg, "--seed") == 0) options.seed = (unsigned)strtoul(value, nullptr, 10);
+    else return false;
+    i++;
+  }
+  return options.hours > 0.0;
+}
+
+struct Sample {
+  uint32_t timeMs;
+  float value;
+};
+
+// Raw samples of one signal since the last clear, in time order.
+struct Reference {
+  std::vector<Sample> samples;
+  float scale;
+  float spreadStep;
+};
+
+// Compares one tier against the raw samples; prints the first mismatch.
+bool checkTier(const HistoryTier& tier, const Reference& reference, const char* name) {
+  std::vector<HistoryPoint> actual;
+  HistoryPoint point;
+  for (size_t i = 0; i < tier.size(); i++) {
+    if (tier.point(i, point)) actual.push_back(point);
+  }
+
+  // Expected: every bucket with samples from the oldest one the ring can still hold up to
+  // the open bucket (the one of the newest sample)
+  std::vector<HistoryPoint> expected;
+  std::vector<bool> open;
+  if (!reference.samples.empty()) {
+    uint32_t bucketMs = tier.bucketMs();
+    uint32_t lastMs = reference.samples.back().timeMs;
+    uint32_t openStartMs = lastMs - lastMs % bucketMs;
+    uint32_t oldestStartMs = openStartMs >= tier.spanMs() ? openStartMs - tier.spanMs() : 0;
+    for (size_t i = 0; i < reference.samples.size();) {
+      uint32_t startMs = reference.samples[i].timeMs - reference.samples[i].timeMs % bucketMs;
+      double sum = 0.0;
+      float low = INFINITY;
+      float high = -INFINITY;
+      size_t count = 0;
+      for (; i < reference.samples.size() && reference.samples[i].timeMs - startMs < bucketMs; i++, count++) {
+        sum += reference.samples[i].value;
+        low = std::min(low, reference.samples[i].value);
+        high = std::max(high, reference.samples[i].value);
+      }
+      if (startMs < oldestStartMs) continue;
+      HistoryPoint bucket = {startMs, (float)(sum / count), low, high};
+      expected.push_back(bucket);
+      open.push_back(startMs == openStartMs);
+    }
+  }
+
+  if (actual.size() != expected.size()) {
+    printf("  %s %u ms tier: %zu buckets, expected %zu\n", name, tier.bucketMs(), actual.size(), expected.size());
+    return false;
+  }
+  const float tolerance = 1e-3f;
+  for (size_t i = 0; i < expected.size(); i++) {
+    const HistoryPoint& a = actual[i];
+    const HistoryPoint& e = expected[i];
+    bool ok = a.timeMs == e.timeMs;
+    if (open[i]) {
+      ok = ok && fabsf(a.mean - e.mean) <= tolerance && a.min == e.min && a.max == e.max;
+    } else {
+      float step = reference.spreadStep;
+      bool saturatedLow = a.mean - a.min >= 255 * step - tolerance;
+      bool saturatedHigh = a.max - a.mean >= 255 * step - tolerance;
+      ok = ok && fabsf(a.mean - e.mean) <= 0.5f / reference.scale + tolerance;
+      ok = ok && (saturatedLow || (a.min <= e.min + tolerance && a.min >= e.min - step - tolerance));
+      ok = ok && (saturatedHigh || (a.max >= e.max - tolerance && a.max <= e.max + step + tolerance));
+    }
+    if (!ok) {
+      printf("  %s %u ms tier, bucket at %u ms: mean %.3f min %.3f max %.3f, expected %.3f %.3f %.3f\n", name,
+             tier.bucketMs(), a.timeMs, a.mean, a.min, a.max, e.mean, e.min, e.max);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool checkAll(const TieredHistory& history, const Reference& reference, const char* name) {
+  for (size_t t = 0; t < TieredHistory::TIER_COUNT; t++) {
+    if (!checkTier(history.tier(t), reference, name)) return false;
+  }
+  return true;
+}
+
+// Synthetic boiler: heat-up to 92 C with a thermostat ripple, shots every few minutes that
+// pull the temperature down while the pump holds ~9 bar, noise on both.
+struct Session {
+  std::mt19937 random;
+  std::normal_distribution<float> noise;
+  uint32_t nextShotMs;
+  uint32_t shotEndMs;
+
+  explicit Session(unsigned seed) : random(seed), noise(0.0f, 1.0f), nextShotMs(240000), shotEndMs(0) {}
+
+  void sample(uint32_t timeMs, float& temperatureC, float& pressureBar) {
+    if (timeMs >= nextShotMs) {
+      shotEndMs = timeMs + 20000 + random() % 15000;
+      nextShotMs = timeMs + 180000 + random() % 600000;
+    }
+    double t = timeMs / 1000.0;
+    double base = 22.0 + 70.0 * (1.0 - exp(-t / 300.0)) + 1.5 * sin(t / 45.0);
+    bool shot = timeMs < shotEndMs;
+    temperatureC = (float)(base - (shot ? 6.0 : 0.0) + 0.15 * noise(random));
+    pressureBar = shot ? (float)(9.0 + 0.4 * sin(t * 40.0) + 0.1 * noise(random)) : (float)fabs(0.03 * noise(random));
+  }
+};
+
+// Frame as handleHistoryBinary() builds it: means, then minimum and maximum per signal.
+size_t encodeTierFrame(const HistoryTier& temperature, const HistoryTier& pressure, uint32_t nowMs, uint8_t* buffer,
+                       size_t capacity, bool& overflow) {
+  TelemetryFrameEncoder frame(buffer, capacity, nowMs, 6);
+  const HistoryTier* tiers[] = {&temperature, &pressure, &temperature, &temperature, &pressure, &pressure};
+  const uint8_t ids[] = {TelemetryFrame::SERIES_TEMPERATURE, TelemetryFrame::SERIES_PRESSURE,
+                         TelemetryFrame::SERIES_TEMPERATURE_MIN, TelemetryFrame::SERIES_TEMPERATURE_MAX,
+                         TelemetryFrame::SERIES_PRESSURE_MIN, TelemetryFrame::SERIES_PRESSURE_MAX};
+  const uint8_t decimals[] = {1, 2, 1, 1, 2, 2}; // HISTORY_TEMPERATURE/PRESSURE_DECIMALS
+  const int fields[] = {0, 0, 1, 2, 1, 2};
+  for (size_t s = 0; s < 6; s++) {
+    const HistoryTier& tier = *tiers[s];
+    HistoryPoint point;
+    uint32_t count = 0;
+    for (size_t i = 0; i < tier.size(); i++) count += tier.point(i, point) ? 1 : 0;
+    frame.beginSeries(ids[s], decimals[s], count);
+    for (size_t i = 0; i < tier.size(); i++) {
+      if (tier.point(i, point)) frame.time(point.timeMs);
+    }
+    for (size_t i = 0; i < tier.size(); i++) {
+      if (tier.point(i, point)) frame.value(fields[s] == 0 ? point.mean : (fields[s] == 1 ? point.min : point.max));
+    }
+  }
+  overflow = frame.overflow();
+  return frame.length();
+}
+
+volatile float benchSink;
+
+} // namespace
+
+int runHistoryBench(int argc, char** argv) {
+  HistoryOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+
+  TieredHistory temperatureHistory(10.0f, 0.1f); // Same settings as the firmware
+  TieredHistory pressureHistory(100.0f, 0.05f);
+  Reference temperatureReference = {std::vector<Sample>(), 10.0f, 0.1f};
+  Reference pressureReference = {std::vector<Sample>(), 100.0f, 0.05f};
+  Session session(options.seed);
+
+  const uint32_t durationMs = (uint32_t)(options.hours * 3600000.0);
+  const uint32_t startMs = 1234; // Not aligned to any bucket
+  const uint32_t clearAtMs = startMs + durationMs / 3;
+  const uint32_t pauseStartMs = startMs + durationMs / 2; // Temperature plot paused for 45 s
+  const uint32_t gapStartMs = startMs + durationMs * 2 / 3; // No samples at all for 20 min
+  bool cleared = false;
+  int checkpoints = 0;
+  bool ok = true;
+
+  for (uint32_t nowMs = startMs; nowMs - startMs < durationMs && ok; nowMs += SAMPLE_INTERVAL_MS) {
+    if (!cleared && nowMs >= clearAtMs) {
+      cleared = true;
+      temperatureHistory.clear();
+      pressureHistory.clear();
+      temperatureReference.samples.clear();
+      pressureReference.samples.clear();
+    }
+    float temperatureC, pressureBar;
+    session.sample(nowMs, temperatureC, pressureBar);
+    if (nowMs - gapStartMs >= 1200000u) { // Outside the gap (wraps for times before it)
+      if (nowMs - pauseStartMs >= 45000u) {
+        temperatureHistory.add(nowMs, temperatureC);
+        temperatureReference.samples.push_back({nowMs, temperatureC});
+      }
+      pressureHistory.add(nowMs, pressureBar);
+      pressureReference.samples.push_back({nowMs, pressureBar});
+    }
+    if ((nowMs - startMs) % CHECK_INTERVAL_MS < SAMPLE_INTERVAL_MS && nowMs != startMs) {
+      ok = checkAll(temperatureHistory, temperatureReference, "temperature") &&
+           checkAll(pressureHistory, pressureReference, "pressure");
+      checkpoints++;
+    }
+  }
+  if (ok) {
+    ok = checkAll(temperatureHistory, temperatureReference, "temperature") &&
+         checkAll(pressureHistory, pressureReference, "pressure");
+    checkpoints++;
+  }
+  printf("tiers vs reference: %.1f h at %lu ms, %d checkpoints, clear, pause, %u min gap: %s\n", options.hours,
+         SAMPLE_INTERVAL_MS, checkpoints, 20u, ok ? "ok" : "FAILED");
+
+  // Tier selection as /history?span= uses it
+  bool selection = &temperatureHistory.tierFor(1) == &temperatureHistory.tier(0) &&
+                   &temperatureHistory.tierFor(60000) == &temperatureHistory.tier(0) &&
+                   &temperatureHistory.tierFor(60001) == &temperatureHistory.tier(1) &&
+                   &temperatureHistory.tierFor(300000) == &temperatureHistory.tier(1) &&
+                   &temperatureHistory.tierFor(5400000) == &temperatureHistory.tier(2) &&
+                   &temperatureHistory.tierFor(86400000) == &temperatureHistory.tier(2);
+  printf("span -> tier selection: %s\n", selection ? "ok" : "FAILED");
+  ok = ok && selection;
+
+  size_t formerBytes = 2 * FORMER_HISTORY_SIZE * (sizeof(uint32_t) + sizeof(float)); // unsigned long is 32-bit on the ESP32
+  size_t bucketBytes = 2 * TieredHistory::TOTAL_BUCKETS * sizeof(HistoryBucket);
+  printf("RAM: %zu bytes of buckets (+%zu bytes of tier state) vs %zu bytes for the former rings\n", bucketBytes,
+         2 * sizeof(TieredHistory) - bucketBytes, formerBytes);
+  printf("  coverage: %u s, %u s, %u s vs %zu s\n", temperatureHistory.tier(0).spanMs() / 1000,
+         temperatureHistory.tier(1).spanMs() / 1000, temperatureHistory.tier(2).spanMs() / 1000,
+         FORMER_HISTORY_SIZE);
+
+  // /history.bin per tier (the firmware buffer holds six series of the largest tier)
+  const size_t frameCapacity = TelemetryFrame::maxEncodedSize(6, 6 * (TieredHistory::MINUTE_BUCKETS + 1));
+  std::vector<uint8_t> frame(frameCapacity);
+  for (size_t t = 0; t < TieredHistory::TIER_COUNT; t++) {
+    bool overflow;
+    size_t length = encodeTierFrame(temperatureHistory.tier(t), pressureHistory.tier(t), temperatureReference.samples.back().timeMs,
+                                    frame.data(), frame.size(), overflow);
+    printf("  /history.bin, %5u ms buckets: %4zu bytes (buffer %zu)%s\n", temperatureHistory.tier(t).bucketMs(), length,
+           frameCapacity, overflow ? " OVERFLOW" : "");
+    ok = ok && !overflow;
+  }
+
+  typedef std::chrono::steady_clock SteadyClock;
+  const int adds = 2000000;
+  TieredHistory timed(10.0f, 0.1f);
+  SteadyClock::time_point start = SteadyClock::now();
+  for (int i = 0; i < adds; i++) timed.add((uint32_t)i * SAMPLE_INTERVAL_MS, 90.0f + (i % 17) * 0.1f);
+  double seconds = std::chrono::duration<double>(SteadyClock::now() - start).count();
+  HistoryPoint point;
+  benchSink = timed.tier(2).point(0, point) ? point.mean : 0.0f;
+  printf("add(): %.1f ns per sample (three tiers)\n", seconds * 1e9 / adds);
+
+  return benchResult("history", ok);
+}
@@ -0,0 +1,8 @@
+#ifndef HISTORY_BENCH_H
+#define HISTORY_BENCH_H
+
+// `program history [options]`: tiered min/max/mean history against a brute-force reference,
+// RAM and /history.bin size per tier.
+int runHistoryBench(int argc, char** argv);
+
+#endif // HISTORY_BENCH_H
@@ -0,0 +1,266 @@
+// Host checks for the network task's job scheduler (lib/JobScheduler) on a virtual clock.
+//
+// The firmware's network jobs (periods from src/main.cpp) run with simulated runtimes:
+// mostly short, with occasional slow web responses and OLED frames, one long stall, and a
+// standby phase with the stretched periods. Checked: no job starts before its deadline,
+// jobs stay on their fixed-rate grid (run count per period), lateness is bounded by what
+// else ran in the same pass, a stall skips periods instead of bursting, and setPeriod()
+// applies at once. The former loop (every check polled on a 2 ms delay, `last = now`) is
+// replayed on the same workload for wake-ups and timing.
+//
+//   .pio/build/native/program jobs
+//   .pio/build/native/program jobs --minutes 30 --seed 2
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "JobScheduler.h"
+#include "bench_report.h"
+#include "jobs_bench.h"
+
+namespace {
+
+// Network job periods (src/main.cpp)
+const uint32_t WEB_JOB_MS = 5;
+const uint32_t WEB_JOB_STANDBY_MS = 100;
+const uint32_t COMMAND_JOB_MS = 100;
+const uint32_t HISTORY_JOB_MS = 100;
+const uint32_t SHOT_LOG_JOB_MS = 50;
+const uint32_t LED_JOB_MS = 50;
+const uint32_t LED_JOB_STANDBY_MS = 500;
+const uint32_t STATUS_LED_JOB_MS = 5000;
+const uint32_t OLED_JOB_MS = 100;
+const uint32_t OLED_JOB_STANDBY_MS = 1000;
+const uint32_t STANDBY_JOB_MS = 1000;
+const uint32_t FORMER_IDLE_DELAY_MS = 2; // NETWORK_TASK_IDLE_DELAY_MS before the scheduler
+const uint32_t TICK_MS = 1;              // vTaskDelay granularity
+
+struct JobsOptions {
+  double minutes = 10.0;
+  unsigned seed = 1;
+};
+
+void printUsage() {
+  printf("usage: program jobs [options]\n"
+         "  --minutes M        simulated time per phase (default 10)\n"
+         "  --seed N           runtime jitter seed (default 1)\n");
+}
+
+bool parseOptions(int argc, char** argv, JobsOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--minutes") == 0) options.minutes = atof(value);
+    else if (strcmp(arg, "--seed") == 0) options.seed = (unsigned)strtoul(value, nullptr, 10);
+    else return false;
+    i++;
+  }
+  return options.minutes > 0.0;
+}
+
+// --- Virtual clock and workload ---
+uint64_t virtualUs = 0;
+std::mt19937 workloadRandom;
+bool presumedOff = false;
+uint32_t stallUs = 0; // Next web job run takes this long (one-off stall)
+
+uint32_t virtualMicros() { return (uint32_t)virtualUs; }
+uint32_t virtualMillis() { return (uint32_t)(virtualUs / 1000); }
+
+void spend(uint32_t us) { virtualUs += us; }
+
+enum JobIndex { WEB, COMMANDS, HISTORY, SHOT_LOG, LED, STATUS_LED, OLED, STANDBY, JOB_COUNT };
+const char* const JOB_NAMES[JOB_COUNT] = {"web", "commands", "history", "shot_log", "led", "status_led", "oled", "standby"};
+
+// Start times of every run, for the grid and early-start checks.
+std::vector<uint32_t> runTimes[JOB_COUNT];
+
+void record(int job, uint32_t nowMs) { runTimes[job].push_back(nowMs); }
+
+void webJob(uint32_t nowMs) {
+  record(WEB, nowMs);
+  if (stallUs) {
+    spend(stallUs);
+    stallUs = 0;
+  } else {
+    // Mostly an idle handleClient(); now and then a page, /history or /capture.csv
+    spend(workloadRandom() % 1000 < 5 ? 20000 + workloadRandom() % 30000 : 40 + workloadRandom() % 40);
+  }
+}
+void commandJob(uint32_t nowMs) { record(COMMANDS, nowMs); spend(5); }
+void historyJob(uint32_t nowMs) { record(HISTORY, nowMs); spend(60); }
+void shotLogJob(uint32_t nowMs) { record(SHOT_LOG, nowMs); spend(20); }
+void ledJob(uint32_t nowMs) { record(LED, nowMs); spend(10); }
+void statusLedJob(uint32_t nowMs) { record(STATUS_LED, nowMs); spend(5); }
+void oledJob(uint32_t nowMs) { record(OLED, nowMs); spend(presumedOff ? 300 : 1500 + workloadRandom() % 1500); } // I2C
+
+JobScheduler* scheduler = nullptr;
+uint8_t jobIds[JOB_COUNT];
+bool standby = false;
+
+void standbyJob(uint32_t nowMs) {
+  record(STANDBY, nowMs);
+  spend(5);
+  if (presumedOff == standby) return;
+  standby = presumedOff;
+  scheduler->setPeriod(jobIds[WEB], standby ? WEB_JOB_STANDBY_MS : WEB_JOB_MS);
+  scheduler->setPeriod(jobIds[LED], standby ? LED_JOB_STANDBY_MS : LED_JOB_MS);
+  scheduler->setPeriod(jobIds[OLED], standby ? OLED_JOB_STANDBY_MS : OLED_JOB_MS);
+}
+
+const JobFunction JOB_FUNCTIONS[JOB_COUNT] = {webJob, commandJob, historyJob, shotLogJob, ledJob, statusLedJob, oledJob, standbyJob};
+const uint32_t JOB_PERIODS[JOB_COUNT] = {WEB_JOB_MS, COMMAND_JOB_MS, HISTORY_JOB_MS, SHOT_LOG_JOB_MS, LED_JOB_MS,
+                                         STATUS_LED_JOB_MS, OLED_JOB_MS, STANDBY_JOB_MS};
+
+void resetRuns() {
+  for (int j = 0; j < JOB_COUNT; j++) runTimes[j].clear();
+}
+
+// The network task loop: run what is due, sleep until the next deadline (at least a tick).
+unsigned long runScheduled(uint32_t untilMs) {
+  unsigned long wakeups = 0;
+  while (virtualMillis() < untilMs) {
+    scheduler->runDue(virtualMillis());
+    uint32_t waitMs = scheduler->msUntilNext(virtualMillis());
+    virtualUs = (virtualUs / 1000 + (waitMs > TICK_MS ? waitMs : TICK_MS)) * 1000; // Wake on a tick
+    wakeups++;
+  }
+  return wakeups;
+}
+
+// Jobs may start late but never early, and not more often than their grid allows; periods
+// lost behind a slow run are counted as skipped.
+bool checkRuns(int job, uint32_t periodMs, uint32_t fromMs, uint32_t untilMs, uint32_t lateBoundMs, const char* phase) {
+  const std::vector<uint32_t>& runs = runTimes[job];
+  uint32_t expected = (untilMs - fromMs) / periodMs;
+  uint32_t skipped = scheduler->stats(jobIds[job]).skipped;
+  if (runs.size() + skipped + 1 < expected || runs.size() + skipped > expected + 1) {
+    printf("  %s, %s: %zu runs + %u skipped, expected %u\n", phase, JOB_NAMES[job], runs.size(), skipped, expected);
+    return false;
+  }
+  for (size_t i = 1; i < runs.size(); i++) {
+    // Fixed-rate grid: consecutive starts are a period apart, give or take how late either
+    // of them was (a skipped period shows up in the run count above, not here)
+    uint32_t gap = runs[i] - runs[i - 1];
+    if (gap > periodMs + lateBoundMs || gap + lateBoundMs < periodMs) {
+      printf("  %s, %s: runs at %u and %u ms (period %u)\n", phase, JOB_NAMES[job], runs[i - 1], runs[i], periodMs);
+      return false;
+    }
+  }
+  return true;
+}
+
+void printStats(const char* phase, unsigned long wakeups, double seconds) {
+  printf("%s: %.0f wake-ups/s\n", phase, wakeups / seconds);
+  printf("  %-11s %7s %7s %8s %8s %9s %9s\n", "job", "period", "runs", "late max", "late avg", "run max", "run avg");
+  for (size_t i = 0; i < scheduler->jobCount(); i++) {
+    const JobStats& stats = scheduler->stats((uint8_t)i);
+    printf("  %-11s %5u ms %7u %5u ms %5.2f ms %6u us %6.0f us\n", scheduler->name((uint8_t)i), scheduler->period((uint8_t)i),
+           stats.runs, stats.maxLatenessMs, stats.runs ? (double)stats.totalLatenessMs / stats.runs : 0.0,
+           stats.maxRuntimeUs, stats.runs ? (double)stats.totalRuntimeUs / stats.runs : 0.0);
+  }
+}
+
+// Former loop: every check polled each pass, `last = now` on a hit, 2 ms delay per pass.
+void runFormerLoop(uint32_t untilMs, unsigned long& wakeups, double& meanPeriodErrorMs) {
+  uint32_t last[JOB_COUNT] = {0};
+  double periodErrorSum = 0.0;
+  unsigned long hits = 0;
+  while (virtualMillis() < untilMs) {
+    uint32_t nowMs = virtualMillis();
+    for (int j = 0; j < JOB_COUNT; j++) {
+      if (j == WEB || nowMs - last[j] >= JOB_PERIODS[j]) { // The web part ran on every pass
+        if (j != WEB && last[j] != 0) {
+          periodErrorSum += (double)(nowMs - last[j]) - JOB_PERIODS[j];
+          hits++;
+        }
+        last[j] = nowMs;
+        JOB_FUNCTIONS[j](nowMs);
+      }
+    }
+    virtualUs = (virtualUs / 1000 + FORMER_IDLE_DELAY_MS) * 1000;
+    wakeups++;
+  }
+  meanPeriodErrorMs = hits ? periodErrorSum / hits : 0.0;
+}
+
+} // namespace
+
+int runJobsBench(int argc, char** argv) {
+  JobsOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+  workloadRandom.seed(options.seed);
+  bool ok = true;
+  const uint32_t phaseMs = (uint32_t)(options.minutes * 60000.0);
+  const double phaseS = phaseMs / 1000.0;
+  const uint32_t lateBoundMs = 50 + 3 + 2 * TICK_MS; // Slowest web response + an OLED frame + tick rounding
+
+  JobScheduler jobs(virtualMicros);
+  scheduler = &jobs;
+  for (int j = 0; j < JOB_COUNT; j++) jobIds[j] = jobs.add(JOB_NAMES[j], JOB_PERIODS[j], JOB_FUNCTIONS[j]);
+
+  // Phase 1: machine on
+  virtualUs = 1000000;
+  uint32_t fromMs = virtualMillis();
+  unsigned long wakeups = runScheduled(fromMs + phaseMs);
+  bool phaseOk = true;
+  for (int j = 0; j < JOB_COUNT; j++) {
+    phaseOk &= checkRuns(j, JOB_PERIODS[j], fromMs, virtualMillis(), lateBoundMs, "on");
+  }
+  for (size_t i = 0; i < jobs.jobCount(); i++) phaseOk &= jobs.stats((uint8_t)i).maxLatenessMs <= lateBoundMs;
+  printStats("machine on", wakeups, phaseS);
+  printf("  grid, lateness <= %u ms: %s\n", lateBoundMs, phaseOk ? "ok" : "FAILED");
+  ok &= phaseOk;
+
+  // Stall: one 250 ms web response; the 5-100 ms jobs skip the missed periods
+  jobs.resetStats();
+  stallUs = 250000;
+  uint32_t stallFromMs = virtualMillis();
+  runScheduled(stallFromMs + 2000);
+  bool stallOk = jobs.stats(jobIds[HISTORY]).skipped >= 1 && jobs.stats(jobIds[SHOT_LOG]).skipped >= 3;
+  uint32_t historyRuns = jobs.stats(jobIds[HISTORY]).runs;
+  stallOk &= historyRuns >= 2000 / HISTORY_JOB_MS - 3 && historyRuns <= 2000 / HISTORY_JOB_MS; // No burst to catch up
+  printf("250 ms stall: history skipped %u, shot_log skipped %u, history runs %u in 2 s: %s\n",
+         jobs.stats(jobIds[HISTORY]).skipped, jobs.stats(jobIds[SHOT_LOG]).skipped, historyRuns, stallOk ? "ok" : "FAILED");
+  ok &= stallOk;
+
+  // Phase 2: presumed off; the standby job stretches the periods within a second
+  jobs.resetStats();
+  presumedOff = true;
+  runScheduled(virtualMillis() + STANDBY_JOB_MS + 100);
+  bool switched = jobs.period(jobIds[WEB]) == WEB_JOB_STANDBY_MS && jobs.period(jobIds[OLED]) == OLED_JOB_STANDBY_MS;
+  jobs.resetStats();
+  resetRuns();
+  fromMs = virtualMillis();
+  wakeups = runScheduled(fromMs + phaseMs);
+  bool standbyOk = switched && checkRuns(WEB, WEB_JOB_STANDBY_MS, fromMs, virtualMillis(), lateBoundMs, "standby") &&
+                   checkRuns(OLED, OLED_JOB_STANDBY_MS, fromMs, virtualMillis(), lateBoundMs, "standby");
+  printStats("presumed off", wakeups, phaseS);
+  printf("  standby periods applied: %s\n", standbyOk ? "ok" : "FAILED");
+  ok &= standbyOk;
+
+  // Back on: normal periods again
+  presumedOff = false;
+  runScheduled(virtualMillis() + STANDBY_JOB_MS + 100);
+  bool restored = jobs.period(jobIds[WEB]) == WEB_JOB_MS && jobs.period(jobIds[LED]) == LED_JOB_MS;
+  printf("normal periods restored: %s\n", restored ? "ok" : "FAILED");
+  ok &= restored;
+
+  // Former polling loop on the same workload
+  resetRuns();
+  unsigned long formerWakeups = 0;
+  double periodErrorMs = 0.0;
+  fromMs = virtualMillis();
+  runFormerLoop(fromMs + phaseMs, formerWakeups, periodErrorMs);
+  printf("former 2 ms polling loop, machine on: %.0f wake-ups/s (any state), periodic checks late by %.2f ms on average "
+         "and drifting by that much per period\n", formerWakeups / phaseS, periodErrorMs);
+
+  return benchResult("jobs", ok);
+}
@@ -0,0 +1,8 @@
+#ifndef JOBS_BENCH_H
+#define JOBS_BENCH_H
+
+// `program jobs [options]`: network task job scheduler on a virtual clock - grid, lateness,
+// stalls, standby periods, and wake-ups against the former polling loop.
+int runJobsBench(int argc, char** argv);
+
+#endif // JOBS_BENCH_H
@@ -0,0 +1,343 @@
+// Host benchmark for the streaming JSON responses (lib/JsonStream).
+//
+// Builds the /data and /history responses twice: with JsonWriter into a 1 KB buffer, as the
+// firmware now does, and with a model of the former Arduino String concatenation (every
+// String(x) and "..." + String(x) allocates, every += reallocates to the exact new length,
+// as in the Arduino core). Both outputs are compared token by token, then allocations per
+// response and throughput are reported. Typical use:
+//
+//   .pio/build/native/program json
+//   .pio/build/native/program json --history 180 --iterations 20000
+#include <chrono>
+#include <ctype.h>
+#include <math.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "JsonWriter.h"
+#include "json_bench.h"
+
+// --- Allocation counting (global, this program is single-threaded) ---
+static unsigned long allocationCount = 0;
+
+void* operator new(size_t size) {
+  allocationCount++;
+  void* p = malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+namespace {
+
+const size_t RESPONSE_BUFFER_SIZE = 1024; // Same as JSON_RESPONSE_BUFFER_SIZE in the firmware
+
+struct BenchOptions {
+  int historySize = 90; // Entries per history ring (firmware HISTORY_SIZE)
+  unsigned long iterations = 5000;
+};
+
+void printUsage() {
+  printf("usage: program json [options]\n"
+         "  --history N        entries per history ring (default 90)\n"
+         "  --iterations N     responses per measurement (default 5000)\n");
+}
+
+bool parseOptions(int argc, char** argv, BenchOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--history") == 0) options.historySize = atoi(value);
+    else if (strcmp(arg, "--iterations") == 0) options.iterations = strtoul(value, nullptr, 10);
+    else return false;
+    i++;
+  }
+  return options.historySize > 0 && options.iterations > 0;
+}
+
+// --- Model of the Arduino String the former handlers used ---
+class LegacyString {
+public:
+  LegacyString() : _buffer(nullptr), _length(0) {}
+  LegacyString(const char* text) : _buffer(nullptr), _length(0) { append(text, strlen(text)); }
+  LegacyString(const LegacyString& other) : _buffer(nullptr), _length(0) { append(other._buffer, other._length); }
+  explicit LegacyString(long value) : _buffer(nullptr), _length(0) {
+    char text[24];
+    append(text, snprintf(text, sizeof(text), "%ld", value));
+  }
+  explicit LegacyString(unsigned long value) : _buffer(nullptr), _length(0) {
+    char text[24];
+    append(text, snprintf(text, sizeof(text), "%lu", value));
+  }
+  LegacyString(double value, int decimals) : _buffer(nullptr), _length(0) {
+    char text[48];
+    append(text, snprintf(text, sizeof(text), "%*.*f", decimals + 2, decimals, value)); // dtostrf(width = decimals + 2)
+  }
+  ~LegacyString() { delete[] _buffer; }
+
+  LegacyString& operator+=(const LegacyString& other) { append(other._buffer, other._length); return *this; }
+  LegacyString& operator+=(const char* text) { append(text, strlen(text)); return *this; }
+  friend LegacyString operator+(const LegacyString& a, const LegacyString& b) { LegacyString sum(a); sum += b; return sum; }
+  friend LegacyString operator+(const LegacyString& a, const char* b) { LegacyString sum(a); sum += b; return sum; }
+  friend LegacyString operator+(const char* a, const LegacyString& b) { LegacyString sum(a); sum += b; return sum; }
+
+  const char* data() const { return _buffer; }
+  size_t length() const { return _length; }
+
+private:
+  LegacyString& operator=(const LegacyString&);
+
+  // Arduino String::concat() reserves exactly the new length (realloc of the buffer).
+  void append(const char* text, size_t length) {
+    char* grown = new char[_length + length + 1];
+    if (_length) memcpy(grown, _buffer, _length);
+    memcpy(grown + _length, text, length);
+    grown[_length + length] = '\0';
+    delete[] _buffer;
+    _buffer = grown;
+    _length += length;
+  }
+
+  char* _buffer;
+  size_t _length;
+};
+
+// --- Response data (a mid-shot snapshot) ---
+struct DataPoint {
+  unsigned long time_ms;
+  float value;
+};
+
+struct ResponseData {
+  double smoothedTempC = 93.37;
+  float pressureBar = 8.84f;
+  float maxObservedPressure = 9.12f;
+  bool isRelayOn = true;
+  double desiredTempC = 94.0;
+  float heaterDuty = 0.35f;
+  unsigned long shotDuration_ms = 17340;
+  unsigned long captureOverruns = 0;
+  float presumedOffThreshold = 70.0f;
+  bool tempPlotPaused = false;
+  bool pressurePlotPaused = false;
+  std::vector<DataPoint> tempHistory;
+  std::vector<DataPoint> pressureHistory;
+  unsigned long now_ms = 3600000;
+};
+
+ResponseData makeData(int historySize) {
+  ResponseData data;
+  for (int i = 0; i < historySize; i++) {
+    unsigned long t = data.now_ms - (unsigned long)(historySize - i) * 1000;
+    data.tempHistory.push_back({t, (float)(92.0 + 2.0 * sin(i * 0.1))});
+    data.pressureHistory.push_back({t, (float)(i < historySize / 2 ? 0.0 : 9.0 - 0.01 * i)});
+  }
+  return data;
+}
+
+// --- Former handlers (String concatenation, as in handleData()/handleHistory()) ---
+LegacyString legacyData(const ResponseData& d) {
+  LegacyString json = "{";
+  json += "\"temperature\":" + LegacyString(d.smoothedTempC, 1) + ",";
+  json += "\"pressure\":" + LegacyString(d.pressureBar, 1) + ",";
+  json += "\"max_observed_pressure\":" + LegacyString(d.maxObservedPressure, 1) + ",";
+  json += "\"relay_status\":\"" + LegacyString(d.isRelayOn ? "ON" : "OFF") + "\",";
+  json += "\"desired_temp\":" + LegacyString(d.desiredTempC, 1) + ",";
+  json += "\"controller_mode\":\"" + LegacyString("burst") + "\",";
+  json += "\"heater_duty\":" + LegacyString(d.heaterDuty, 2) + ",";
+  json += "\"autotune_status\":\"" + LegacyString("off") + "\",";
+  json += "\"shot_duration\":" + LegacyString(d.shotDuration_ms) + ",";
+  json += "\"pressure_capture_overruns\":" + LegacyString(d.captureOverruns) + ",";
+  json += "\"presumed_off_threshold\":" + LegacyString(d.presumedOffThreshold, 1) + ",";
+  json += "\"is_temp_plot_paused\":" + LegacyString(d.tempPlotPaused ? "true" : "false") + ",";
+  json += "\"is_pressure_plot_paused\":" + LegacyString(d.pressurePlotPaused ? "true" : "false") + ",";
+  json += "\"early_cutoff_event\":" + LegacyString("false");
+  json += "}";
+  return json;
+}
+
+LegacyString legacyHistory(const ResponseData& d) {
+  LegacyString json = "{\"temp_history\":[";
+  for (size_t i = 0; i < d.tempHistory.size(); i++) {
+    long time_offset = (long)d.tempHistory[i].time_ms - (long)d.now_ms;
+    json += "{\"time\":" + LegacyString(time_offset) + ",\"value\":" + LegacyString(d.tempHistory[i].value, 1) + "}";
+    if (i < d.tempHistory.size() - 1) json += ",";
+  }
+  json += "],\"pressure_history\":[";
+  for (size_t i = 0; i < d.pressureHistory.size(); i++) {
+    long time_offset = (long)d.pressureHistory[i].time_ms - (long)d.now_ms;
+    json += "{\"time\":" + LegacyString(time_offset) + ",\"value\":" + LegacyString(d.pressureHistory[i].value, 1) + "}";
+    if (i < d.pressureHistory.size() - 1) json += ",";
+  }
+  json += "]}";
+  return json;
+}
+
+// --- Streaming handlers (same code shape as the firmware) ---
+class CaptureSink : public JsonSink {
+public:
+  explicit CaptureSink(std::string* out) : _out(out), _pieces(0) {}
+  void write(const char* data, size_t length, bool final) override {
+    (void)final;
+    if (_out) _out->append(data, length);
+    _pieces++;
+  }
+  unsigned long pieces() const { return _pieces; }
+
+private:
+  std::string* _out;
+  unsigned long _pieces;
+};
+
+char responseBuffer[RESPONSE_BUFFER_SIZE];
+
+size_t streamData(const ResponseData& d, JsonSink& sink) {
+  JsonWriter json(responseBuffer, sizeof(responseBuffer), sink);
+  json.beginObject();
+  json.field("temperature", d.smoothedTempC, 1);
+  json.field("pressure", d.pressureBar, 1);
+  json.field("max_observed_pressure", d.maxObservedPressure, 1);
+  json.field("relay_status", d.isRelayOn ? "ON" : "OFF");
+  json.field("desired_temp", d.desiredTempC, 1);
+  json.field("controller_mode", "burst");
+  json.field("heater_duty", d.heaterDuty, 2);
+  json.field("autotune_status", "off");
+  json.field("shot_duration", d.shotDuration_ms);
+  json.field("pressure_capture_overruns", d.captureOverruns);
+  json.field("presumed_off_threshold", d.presumedOffThreshold, 1);
+  json.field("is_temp_plot_paused", d.tempPlotPaused);
+  json.field("is_pressure_plot_paused", d.pressurePlotPaused);
+  json.field("early_cutoff_event", false);
+  json.endObject();
+  return json.finish();
+}
+
+void streamHistoryRing(JsonWriter& json, const std::vector<DataPoint>& history, unsigned long now_ms) {
+  for (size_t i = 0; i < history.size(); i++) {
+    json.beginObject();
+    json.field("time", (long)history[i].time_ms - (long)now_ms);
+    json.field("value", history[i].value, 1);
+    json.endObject();
+  }
+}
+
+size_t streamHistory(const ResponseData& d, JsonSink& sink) {
+  JsonWriter json(responseBuffer, sizeof(responseBuffer), sink);
+  json.beginObject();
+  json.beginArray("temp_history");
+  streamHistoryRing(json, d.tempHistory, d.now_ms);
+  json.endArray();
+  json.beginArray("pressure_history");
+  streamHistoryRing(json, d.pressureHistory, d.now_ms);
+  json.endArray();
+  json.endObject();
+  return json.finish();
+}
+
+// --- Output comparison: same tokens, numbers equal within one printed decimal ---
+std::vector<std::string> tokenize(const std::string& text) {
+  std::vector<std::string> tokens;
+  std::string current;
+  for (size_t i = 0; i < text.size(); i++) {
+    char c = text[i];
+    if (c == ' ') continue; // dtostrf() width padding
+    if (strchr("{}[]:,", c)) {
+      if (!current.empty()) tokens.push_back(current);
+      current.clear();
+      tokens.push_back(std::string(1, c));
+    } else {
+      current += c;
+    }
+  }
+  if (!current.empty()) tokens.push_back(current);
+  return tokens;
+}
+
+bool sameJson(const std::string& a, const std::string& b) {
+  std::vector<std::string> ta = tokenize(a);
+  std::vector<std::string> tb = tokenize(b);
+  if (ta.size() != tb.size()) return false;
+  for (size_t i = 0; i < ta.size(); i++) {
+    if (ta[i] == tb[i]) continue;
+    bool numeric = (isdigit((unsigned char)ta[i][0]) || ta[i][0] == '-') && (isdigit((unsigned char)tb[i][0]) || tb[i][0] == '-');
+    if (!numeric || fabs(atof(ta[i].c_str()) - atof(tb[i].c_str())) > 0.1 + 1e-9) { // Rounding of exact ties
+      printf("  token %zu differs: %s vs %s\n", i, ta[i].c_str(), tb[i].c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+volatile size_t benchSink; // Keeps results observable so loops are not optimised away
+char discard[64 * 1024];   // Stands in for the socket
+
+template <typename Body>
+void measure(const char* name, unsigned long iterations, Body body) {
+  unsigned long allocationsBefore = allocationCount;
+  size_t bytes = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < iterations; i++) bytes += body();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  benchSink = bytes;
+  printf("  %-28s %7.1f MB/s %9.2f us/response %8.1f allocations/response\n", name,
+         seconds > 0 ? bytes / seconds / 1e6 : 0.0, seconds * 1e6 / iterations,
+         (double)(allocationCount - allocationsBefore) / iterations);
+}
+
+class DiscardSink : public JsonSink {
+public:
+  void write(const char* data, size_t length, bool final) override {
+    (void)final;
+    memcpy(discard, data, length);
+  }
+};
+
+} // namespace
+
+int runJsonBench(int argc, char** argv) {
+  BenchOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+  const ResponseData data = makeData(options.historySize);
+
+  std::string streamedData;
+  std::string streamedHistory;
+  CaptureSink dataSink(&streamedData);
+  CaptureSink historySink(&streamedHistory);
+  streamData(data, dataSink);
+  streamHistory(data, historySink);
+  LegacyString legacyDataText = legacyData(data);
+  LegacyString legacyHistoryText = legacyHistory(data);
+  bool same = sameJson(streamedData, std::string(legacyDataText.data(), legacyDataText.length())) &&
+              sameJson(streamedHistory, std::string(legacyHistoryText.data(), legacyHistoryText.length()));
+  printf("output: /data %zu bytes in %lu piece(s), /history %zu bytes in %lu piece(s), %s the String version\n",
+         streamedData.size(), dataSink.pieces(), streamedHistory.size(), historySink.pieces(),
+         same ? "same content as" : "DIFFERENT from");
+
+  DiscardSink discardSink;
+  printf("per response (%d history entries per ring):\n", options.historySize);
+  measure("/data, String", options.iterations, [&]() {
+    LegacyString json = legacyData(data);
+    memcpy(discard, json.data(), json.length());
+    return json.length();
+  });
+  measure("/data, JsonWriter", options.iterations, [&]() { return streamData(data, discardSink); });
+  measure("/history, String", options.iterations, [&]() {
+    LegacyString json = legacyHistory(data);
+    memcpy(discard, json.data(), json.length());
+    return json.length();
+  });
+  measure("/history, JsonWriter", options.iterations, [&]() { return streamHistory(data, discardSink); });
+  return same ? 0 : 1;
+}
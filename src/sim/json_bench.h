@@ -0,0 +1,7 @@
+#ifndef JSON_BENCH_H
+#define JSON_BENCH_H
+
+// `program json [options]`: streaming JsonWriter against the former String concatenation.
+int runJsonBench(int argc, char** argv);
+
+#endif // JSON_BENCH_H
@@ -0,0 +1,300 @@
+// Host checks for the stage metrics (lib/StageMetrics) on a stubbed cycle counter.
+//
+// Random stage durations (log-uniform, 1 us to 0.5 s at the ESP32's 240 cycles/us, with
+// starts across the 32-bit counter wrap) are recorded through StageTimer and compared
+// against a reference: count, sum, max, every histogram bucket (Prometheus `le`, bounds
+// inclusive), loop intervals and the p99 bound. A reset request must read as cleared at
+// once and restart each stage at its next record, and so must a CPU clock change, after
+// which the buckets follow the new rate. The /metrics text is parsed back: every
+// family has HELP and TYPE before its samples, samples of a family are contiguous, buckets
+// are cumulative and end at the count. Also reports the cost of one StageTimer on the host.
+//
+//   .pio/build/native/program metrics
+//   .pio/build/native/program metrics --samples 1000000 --seed 2
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "StageMetrics.h"
+#include "bench_report.h"
+#include "metrics_bench.h"
+
+namespace {
+
+const uint32_t CYCLES_PER_US = 240;         // ESP32 at 240 MHz
+const uint32_t STANDBY_CYCLES_PER_US = 80;  // Low-power standby
+
+struct MetricsOptions {
+  unsigned long samples = 200000;
+  unsigned seed = 1;
+};
+
+void printUsage() {
+  printf("usage: program metrics [options]\n"
+         "  --samples N        recorded durations per stage (default 200000)\n"
+         "  --seed N           duration seed (default 1)\n");
+}
+
+bool parseOptions(int argc, char** argv, MetricsOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--samples") == 0) options.samples = strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--seed") == 0) options.seed = (unsigned)strtoul(value, nullptr, 10);
+    else return false;
+    i++;
+  }
+  return options.samples > 0;
+}
+
+// --- Stubbed cycle counter ---
+uint32_t virtualCycles = 0;
+uint32_t virtualCycleClock() { return virtualCycles; }
+
+uint32_t hostCycleClock() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// What one stage should report.
+struct Reference {
+  uint32_t count = 0;
+  uint64_t totalCycles = 0;
+  uint32_t maxCycles = 0;
+  uint32_t maxIntervalCycles = 0;
+  uint32_t buckets[StageStats::BUCKETS] = {0};
+};
+
+void referenceAdd(Reference& reference, uint32_t cycles, uint32_t cyclesPerUs) {
+  reference.count++;
+  reference.totalCycles += cycles;
+  if (cycles > reference.maxCycles) reference.maxCycles = cycles;
+  size_t bucket = StageStats::BUCKETS - 1;
+  for (size_t i = 0; i < StageStats::BUCKETS - 1; i++) {
+    if ((uint64_t)cycles <= (uint64_t)StageMetrics::BUCKET_BOUNDS_US[i] * cyclesPerUs) {
+      bucket = i;
+      break;
+    }
+  }
+  reference.buckets[bucket]++;
+}
+
+bool compare(const StageMetrics& metrics, uint8_t stage, const Reference& reference, const char* name) {
+  StageStats stats;
+  metrics.read(stage, stats);
+  bool ok = stats.count == reference.count && stats.totalCycles == reference.totalCycles &&
+            stats.maxCycles == reference.maxCycles && stats.maxIntervalCycles == reference.maxIntervalCycles;
+  for (size_t i = 0; i < StageStats::BUCKETS; i++) ok = ok && stats.buckets[i] == reference.buckets[i];
+  if (!ok) {
+    printf("  %s: count %u/%u, total %llu/%llu, max %u/%u, interval %u/%u\n", name, stats.count, reference.count,
+           (unsigned long long)stats.totalCycles, (unsigned long long)reference.totalCycles, stats.maxCycles,
+           reference.maxCycles, stats.maxIntervalCycles, reference.maxIntervalCycles);
+    for (size_t i = 0; i < StageStats::BUCKETS; i++) printf("    bucket %zu: %u/%u\n", i, stats.buckets[i], reference.buckets[i]);
+  }
+  return ok;
+}
+
+// Duration of one run: log-uniform from 1 us to 0.5 s, plus every bucket bound and its
+// neighbours now and then.
+uint32_t randomDurationCycles(std::mt19937& random, uint32_t cyclesPerUs) {
+  if (random() % 50 == 0) {
+    uint32_t bound = StageMetrics::BUCKET_BOUNDS_US[random() % (StageStats::BUCKETS - 1)] * cyclesPerUs;
+    return bound - 1 + random() % 3;
+  }
+  std::uniform_real_distribution<double> exponent(0.0, log(500000.0));
+  return (uint32_t)(exp(exponent(random)) * cyclesPerUs);
+}
+
+// Records `samples` runs of a plain and a loop stage on the virtual clock.
+void runRecording(StageMetrics& metrics, uint8_t plain, uint8_t loop, unsigned long samples, std::mt19937& random,
+                  Reference& plainReference, Reference& loopReference, uint32_t cyclesPerUs = CYCLES_PER_US) {
+  bool loopStarted = false;
+  uint32_t lastLoopStart = 0;
+  for (unsigned long i = 0; i < samples; i++) {
+    uint32_t loopStart = virtualCycles;
+    if (loopStarted && loopStart - lastLoopStart > loopReference.maxIntervalCycles) {
+      loopReference.maxIntervalCycles = loopStart - lastLoopStart;
+    }
+    loopStarted = true;
+    lastLoopStart = loopStart;
+    uint32_t plainCycles = randomDurationCycles(random, cyclesPerUs);
+    {
+      StageTimer loopTimer(metrics, loop);
+      virtualCycles += random() % 2000; // Loop work around the stage
+      StageTimer timer(metrics, plain);
+      virtualCycles += plainCycles;
+    }
+    referenceAdd(plainReference, plainCycles, cyclesPerUs);
+    referenceAdd(loopReference, virtualCycles - loopStart, cyclesPerUs);
+    virtualCycles += random() % (20 * 1000 * cyclesPerUs); // Sleep until the next pass
+  }
+}
+
+// Collects the /metrics text.
+class StringSink : public MetricsSink {
+public:
+  void write(const char* data, size_t length) override { text.append(data, length); }
+  std::string text;
+};
+
+// Parses the exposition text back; prints the first problem.
+bool checkExposition(const std::string& text, const StageMetrics& metrics) {
+  std::set<std::string> closedFamilies;
+  std::string family;
+  bool typed = false;
+  double lastCumulative = -1.0;
+  std::string lastStage;
+  size_t samples = 0;
+  size_t begin = 0;
+  while (begin < text.size()) {
+    size_t end = text.find('\n', begin);
+    if (end == std::string::npos) {
+      printf("  exposition: last line not terminated\n");
+      return false;
+    }
+    std::string line = text.substr(begin, end - begin);
+    begin = end + 1;
+    char name[96];
+    if (sscanf(line.c_str(), "# HELP %95s", name) == 1) {
+      if (!family.empty()) closedFamilies.insert(family);
+      family = name;
+      typed = false;
+      if (closedFamilies.count(family)) {
+        printf("  exposition: family %s repeated\n", name);
+        return false;
+      }
+      continue;
+    }
+    if (sscanf(line.c_str(), "# TYPE %95s", name) == 1) {
+      typed = family == name;
+      continue;
+    }
+    // Sample: name{labels} value, name within the current family
+    size_t nameEnd = line.find_first_of("{ ");
+    std::string sampleName = line.substr(0, nameEnd);
+    if (!typed || sampleName.compare(0, family.size(), family) != 0) {
+      printf("  exposition: sample outside its family: %s\n", line.c_str());
+      return false;
+    }
+    double value = atof(line.c_str() + line.rfind(' ') + 1);
+    size_t stageAt = line.find("stage=\"");
+    std::string stage = stageAt == std::string::npos ? "" : line.substr(stageAt + 7, line.find('"', stageAt + 7) - stageAt - 7);
+    if (sampleName == family + "_bucket") {
+      if (stage != lastStage) lastCumulative = -1.0;
+      if (value < lastCumulative) {
+        printf("  exposition: buckets not cumulative: %s\n", line.c_str());
+        return false;
+      }
+      lastCumulative = value;
+      lastStage = stage;
+    } else if (sampleName == family + "_count" && value != lastCumulative) {
+      printf("  exposition: count %g, +Inf bucket %g for %s\n", value, lastCumulative, stage.c_str());
+      return false;
+    }
+    samples++;
+  }
+  size_t loops = 0;
+  for (size_t i = 0; i < metrics.stageCount(); i++) loops += metrics.isLoop((uint8_t)i) ? 1 : 0;
+  size_t expected = metrics.stageCount() * (StageStats::BUCKETS + 2) + metrics.stageCount() + loops + 1;
+  if (samples != expected) {
+    printf("  exposition: %zu samples, expected %zu\n", samples, expected);
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+int runMetricsBench(int argc, char** argv) {
+  MetricsOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+  std::mt19937 random(options.seed);
+  bool ok = true;
+
+  StageMetrics metrics(virtualCycleClock);
+  metrics.begin(CYCLES_PER_US);
+  uint8_t loop = metrics.add("bench_loop", true);
+  uint8_t plain = metrics.add("bench_stage");
+  uint8_t idle = metrics.add("bench_idle");
+
+  // Starts just before the cycle counter wraps, as on the device every ~17.9 s
+  virtualCycles = UINT32_MAX - 1000 * CYCLES_PER_US;
+  Reference plainReference, loopReference;
+  runRecording(metrics, plain, loop, options.samples, random, plainReference, loopReference);
+  bool recordOk = compare(metrics, plain, plainReference, "bench_stage") && compare(metrics, loop, loopReference, "bench_loop");
+  printf("%lu runs per stage across the counter wrap, counts, sums, maxima, buckets, loop interval: %s\n",
+         options.samples, recordOk ? "ok" : "FAILED");
+  ok &= recordOk;
+
+  StageStats stats;
+  metrics.read(plain, stats);
+  uint32_t p99 = metrics.quantileBoundUs(stats, 0.99);
+  uint32_t reached = 0, expectedP99 = UINT32_MAX;
+  for (size_t i = 0; i < StageStats::BUCKETS - 1; i++) {
+    reached += plainReference.buckets[i];
+    if (reached >= 0.99 * plainReference.count) {
+      expectedP99 = StageMetrics::BUCKET_BOUNDS_US[i];
+      break;
+    }
+  }
+  StageStats empty;
+  metrics.read(idle, empty);
+  bool quantileOk = p99 == expectedP99 && metrics.quantileBoundUs(empty, 0.99) == 0;
+  printf("p99 bucket %s%u us, mean %.1f us, max %.1f us: %s\n", p99 == UINT32_MAX ? "above " : "<= ",
+         p99 == UINT32_MAX ? StageMetrics::BUCKET_BOUNDS_US[StageStats::BUCKETS - 2] : p99,
+         metrics.toMicros(stats.totalCycles) / stats.count, metrics.toMicros(stats.maxCycles), quantileOk ? "ok" : "FAILED");
+  ok &= quantileOk;
+
+  StringSink sink;
+  metrics.writePrometheus(sink, "espresso_");
+  writePrometheusMetric(sink, "espresso_", "heap_free_bytes", "gauge", "Free heap.", 123456);
+  bool expositionOk = checkExposition(sink.text, metrics);
+  printf("/metrics text: %zu bytes, families and cumulative buckets: %s\n", sink.text.size(), expositionOk ? "ok" : "FAILED");
+  ok &= expositionOk;
+
+  // Reset from "another task": reads as cleared right away, restarts on the next record
+  metrics.requestReset();
+  metrics.read(plain, stats);
+  bool resetOk = stats.count == 0 && stats.maxCycles == 0;
+  Reference afterReset, loopAfterReset;
+  runRecording(metrics, plain, loop, 1000, random, afterReset, loopAfterReset);
+  resetOk = resetOk && compare(metrics, plain, afterReset, "after reset") && compare(metrics, loop, loopAfterReset, "loop after reset");
+  printf("reset request: %s\n", resetOk ? "ok" : "FAILED");
+  ok &= resetOk;
+
+  // CPU clock change (standby): restarts like a reset, buckets and micros at the new rate
+  metrics.changeClock(STANDBY_CYCLES_PER_US);
+  metrics.read(plain, stats);
+  bool clockOk = stats.count == 0 && metrics.cyclesPerUs() == STANDBY_CYCLES_PER_US &&
+                 metrics.toMicros(STANDBY_CYCLES_PER_US * 1000) == 1000.0;
+  Reference afterClock, loopAfterClock;
+  runRecording(metrics, plain, loop, 1000, random, afterClock, loopAfterClock, STANDBY_CYCLES_PER_US);
+  clockOk = clockOk && compare(metrics, plain, afterClock, "after clock change") &&
+            compare(metrics, loop, loopAfterClock, "loop after clock change");
+  printf("clock change to %u MHz: %s\n", STANDBY_CYCLES_PER_US, clockOk ? "ok" : "FAILED");
+  ok &= clockOk;
+
+  // Cost of one StageTimer with a real clock (on the ESP32 the clock is a CCOUNT read)
+  StageMetrics hostMetrics(hostCycleClock);
+  hostMetrics.begin(1000);
+  uint8_t hostStage = hostMetrics.add("host");
+  const int timerRuns = 2000000;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < timerRuns; i++) {
+    StageTimer timer(hostMetrics, hostStage);
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / timerRuns;
+  printf("StageTimer on the host: %.1f ns per timed scope\n", ns);
+
+  return benchResult("metrics", ok);
+}
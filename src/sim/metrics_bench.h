@@ -0,0 +1,8 @@
+#ifndef METRICS_BENCH_H
+#define METRICS_BENCH_H
+
+// `program metrics [options]`: stage metrics on a stubbed cycle counter against a reference,
+// /metrics text format, reset, and the cost of a timed scope.
+int runMetricsBench(int argc, char** argv);
+
+#endif // METRICS_BENCH_H
@@ -0,0 +1,234 @@
+// Host check of the retained-mode OLED view (lib/OledView).
+//
+// A fake SSD1306 (framebuffer plus separate panel memory that only changes through
+// flushWindow(), with Adafruit_GFX's rotation rules and a stand-in 5x7 font) runs the
+// firmware's field layout through a simulated session: idle temperature wobble, clock ticks,
+// shots with a running timer and pressure. After every frame that leaves nothing dirty, the
+// panel must equal a fresh full redraw of the same texts. Reports I2C bytes per frame and
+// bus time against the former full 1 KB redraw every 500 ms.
+//
+//   .pio/build/native/program oled
+//   .pio/build/native/program oled --minutes 30 --budget 256
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "OledView.h"
+#include "oled_bench.h"
+
+namespace {
+
+const int PANEL_WIDTH = 128;
+const int PANEL_HEIGHT = 64;
+const int PANEL_PAGES = PANEL_HEIGHT / 8;
+const uint8_t ROTATION = 3; // As in the firmware
+const size_t I2C_CHUNK_BYTES = 64;         // Data bytes per transaction in the firmware canvas
+const size_t ADAFRUIT_CHUNK_BYTES = 127;   // Adafruit_SSD1306::display() on the ESP32
+const double I2C_US_PER_BYTE = 9.0 / 0.4;  // 400 kHz, 8 bits + ACK
+const unsigned long FORMER_REFRESH_MS = 500;
+
+struct OledOptions {
+  double minutes = 10.0;
+  unsigned long frameIntervalMs = 100; // OLED_FRAME_INTERVAL_MS
+  size_t budget = 384;                 // OLED_MAX_BYTES_PER_FRAME
+};
+
+void printUsage() {
+  printf("usage: program oled [options]\n"
+         "  --minutes M        simulated session length (default 10)\n"
+         "  --interval MS      frame interval (default 100)\n"
+         "  --budget BYTES     data bytes per frame (default 384)\n");
+}
+
+bool parseOptions(int argc, char** argv, OledOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--minutes") == 0) options.minutes = atof(value);
+    else if (strcmp(arg, "--interval") == 0) options.frameIntervalMs = strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--budget") == 0) options.budget = strtoul(value, nullptr, 10);
+    else return false;
+    i++;
+  }
+  return options.minutes > 0.0 && options.frameIntervalMs > 0;
+}
+
+// Bytes on the bus for a window transfer as the firmware canvas does it: one command
+// transaction (address, control, 6 bytes), then data in chunks (address, control, data).
+size_t windowBusBytes(size_t dataBytes, size_t chunk) {
+  return 8 + dataBytes + 2 * ((dataBytes + chunk - 1) / chunk);
+}
+
+// --- Fake SSD1306 ---
+class FakePanel : public OledCanvas {
+public:
+  FakePanel() : windows(0) {
+    memset(framebuffer, 0, sizeof(framebuffer));
+    memset(panel, 0xA5, sizeof(panel)); // Power-on garbage
+  }
+
+  void fillRect(int16_t x, int16_t y, int16_t width, int16_t height, bool on) override {
+    for (int16_t j = y; j < y + height; j++) {
+      for (int16_t i = x; i < x + width; i++) setPixel(i, j, on);
+    }
+  }
+
+  void drawChar(int16_t x, int16_t y, char c, uint8_t size) override {
+    for (int column = 0; column < 6; column++) {
+      uint8_t bits = glyphColumn(c, column);
+      for (int row = 0; row < 8; row++) {
+        fillRect((int16_t)(x + column * size), (int16_t)(y + row * size), size, size, (bits >> row) & 1);
+      }
+    }
+  }
+
+  size_t flushWindow(uint8_t column0, uint8_t column1, uint8_t page0, uint8_t page1) override {
+    size_t data = 0;
+    for (int page = page0; page <= page1; page++) {
+      for (int column = column0; column <= column1; column++) {
+        panel[page * PANEL_WIDTH + column] = framebuffer[page * PANEL_WIDTH + column];
+        data++;
+      }
+    }
+    windows++;
+    return windowBusBytes(data, I2C_CHUNK_BYTES);
+  }
+
+  uint8_t framebuffer[PANEL_WIDTH * PANEL_PAGES];
+  uint8_t panel[PANEL_WIDTH * PANEL_PAGES];
+  unsigned long windows;
+
+private:
+  // Stand-in font: 5 columns of 7 rows derived from the character, blank spacing column and
+  // bottom row like the classic font.
+  static uint8_t glyphColumn(char c, int column) {
+    if (column == 5 || c == ' ') return 0;
+    uint32_t h = (uint8_t)c * 2654435761u + (uint32_t)column * 40503u;
+    return (uint8_t)((h >> 13) & 0x7F) | 1;
+  }
+
+  // Adafruit_SSD1306::drawPixel() rotation
+  void setPixel(int16_t x, int16_t y, bool on) {
+    int16_t t;
+    switch (ROTATION) {
+      case 1: t = x; x = PANEL_WIDTH - y - 1; y = t; break;
+      case 2: x = PANEL_WIDTH - x - 1; y = PANEL_HEIGHT - y - 1; break;
+      case 3: t = x; x = y; y = PANEL_HEIGHT - t - 1; break;
+      default: break;
+    }
+    if (x < 0 || x >= PANEL_WIDTH || y < 0 || y >= PANEL_HEIGHT) return;
+    uint8_t& byte = framebuffer[(y / 8) * PANEL_WIDTH + x];
+    if (on) byte |= (uint8_t)(1 << (y & 7));
+    else byte &= (uint8_t)~(1 << (y & 7));
+  }
+};
+
+// --- Firmware layout (setupOledView() in main.cpp) ---
+enum { TEMPERATURE, SET_POINT, PRESSURE, MAX_PRESSURE, SHOT_TIME, STATUS, CLOCK, WEATHER, FIELD_COUNT };
+const OledFieldLayout LAYOUT[FIELD_COUNT] = {
+    {0, 0, 64, 16, 2, "C"},   {0, 22, 64, 8, 1, nullptr}, {0, 36, 64, 16, 2, "bar"}, {0, 58, 64, 8, 1, nullptr},
+    {0, 72, 64, 16, 2, "s"},  {0, 94, 64, 8, 1, nullptr}, {0, 106, 64, 8, 1, nullptr}, {0, 114, 64, 8, 1, nullptr}};
+
+void addFields(OledView& view) {
+  for (int i = 0; i < FIELD_COUNT; i++) view.addField(LAYOUT[i]);
+}
+
+struct Texts {
+  char field[FIELD_COUNT][OledView::MAX_TEXT];
+};
+
+void apply(OledView& view, const Texts& texts) {
+  for (int i = 0; i < FIELD_COUNT; i++) view.setText(i, texts.field[i]);
+}
+
+bool matchesFullRedraw(const FakePanel& panel, const Texts& texts, unsigned long frameIntervalMs) {
+  FakePanel reference;
+  OledView view(reference, PANEL_WIDTH, PANEL_HEIGHT, ROTATION, frameIntervalMs, 1024);
+  addFields(view);
+  apply(view, texts);
+  view.render(0);
+  return memcmp(reference.panel, panel.panel, sizeof(panel.panel)) == 0;
+}
+
+} // namespace
+
+int runOledBench(int argc, char** argv) {
+  OledOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+
+  FakePanel panel;
+  OledView view(panel, PANEL_WIDTH, PANEL_HEIGHT, ROTATION, options.frameIntervalMs, options.budget);
+  addFields(view);
+
+  std::mt19937 rng(5);
+  std::normal_distribution<double> noise(0.0, 1.0);
+  unsigned long durationMs = (unsigned long)(options.minutes * 60000.0);
+  const unsigned long loopMs = 2; // Network task iteration
+  double temperature = 93.0;
+  double maxPressure = 0.0;
+  const char* status = "WiFi Connected";
+  Texts texts;
+  unsigned long frames = 0, busyFrames = 0, checks = 0, mismatches = 0;
+  size_t maxFrameBytes = 0, maxIncrementalBytes = 0;
+  unsigned long long totalBytes = 0;
+
+  for (unsigned long nowMs = 0; nowMs <= durationMs; nowMs += loopMs) {
+    if (!view.frameDue(nowMs)) continue;
+
+    // Session: a 28 s shot every 3 minutes, temperature wobble, clock, rare status changes
+    unsigned long cycleMs = nowMs % 180000;
+    bool shotRunning = cycleMs >= 60000 && cycleMs < 88000;
+    double shotS = shotRunning ? (cycleMs - 60000) / 1000.0 : 0.0;
+    double pressure = shotRunning ? fmin(9.0, shotS * 1.5) + 0.05 * noise(rng) : 0.0;
+    if (pressure > maxPressure) maxPressure = pressure;
+    temperature += 0.01 * noise(rng) + (shotRunning ? -0.004 : 0.0) + (93.0 - temperature) * 0.001;
+    if (cycleMs == 88000) status = "Shot done";
+    if (cycleMs == 120000) status = "Heating";
+    unsigned long seconds = nowMs / 1000;
+
+    snprintf(texts.field[TEMPERATURE], OledView::MAX_TEXT, "%.1f", temperature);
+    snprintf(texts.field[SET_POINT], OledView::MAX_TEXT, "S:%.1fC", 93.0);
+    snprintf(texts.field[PRESSURE], OledView::MAX_TEXT, "%.1f", fabs(pressure));
+    snprintf(texts.field[MAX_PRESSURE], OledView::MAX_TEXT, maxPressure < 0.01 ? "MxP:--.-" : "MxP:%.1f", maxPressure);
+    if (shotRunning) snprintf(texts.field[SHOT_TIME], OledView::MAX_TEXT, "%.1f", shotS);
+    else if (nowMs < 60000) snprintf(texts.field[SHOT_TIME], OledView::MAX_TEXT, "--.-");
+    snprintf(texts.field[STATUS], OledView::MAX_TEXT, "%.10s", status);
+    snprintf(texts.field[CLOCK], OledView::MAX_TEXT, "%02lu:%02lu:%02lu", (seconds / 3600 + 8) % 24, seconds / 60 % 60, seconds % 60);
+    snprintf(texts.field[WEATHER], OledView::MAX_TEXT, "  E:%dC", 18 + (int)(nowMs / 900000) % 3);
+    apply(view, texts);
+
+    size_t bytes = view.render(nowMs);
+    frames++;
+    totalBytes += bytes;
+    if (bytes > 0) busyFrames++;
+    if (bytes > maxFrameBytes) maxFrameBytes = bytes;
+    if (frames > 1 && bytes > maxIncrementalBytes) maxIncrementalBytes = bytes;
+    if (!view.dirty()) {
+      checks++;
+      if (!matchesFullRedraw(panel, texts, options.frameIntervalMs)) mismatches++;
+    }
+  }
+
+  double seconds = durationMs / 1000.0;
+  double formerFrames = seconds * 1000.0 / FORMER_REFRESH_MS;
+  size_t formerFrameBytes = windowBusBytes(PANEL_WIDTH * PANEL_PAGES, ADAFRUIT_CHUNK_BYTES);
+  double formerBytesPerS = formerFrames * formerFrameBytes / seconds;
+  double bytesPerS = totalBytes / seconds;
+  printf("%.0f min session, %lu frames at %lu ms (%lu with changes), budget %zu bytes\n", options.minutes, frames,
+         options.frameIntervalMs, busyFrames, options.budget);
+  printf("  %-28s %8.0f B/s %6.1f ms/s bus %6zu B/frame\n", "full redraw every 500 ms", formerBytesPerS,
+         formerBytesPerS * I2C_US_PER_BYTE / 1000.0, formerFrameBytes);
+  printf("  %-28s %8.0f B/s %6.1f ms/s bus %6zu B/frame max (%.0f avg, first frame %zu)\n", "dirty regions", bytesPerS,
+         bytesPerS * I2C_US_PER_BYTE / 1000.0, maxIncrementalBytes, busyFrames ? (double)totalBytes / busyFrames : 0.0,
+         formerFrameBytes);
+  printf("  longest bus stall per frame: %.1f ms (was %.1f ms)\n", maxIncrementalBytes * I2C_US_PER_BYTE / 1000.0,
+         formerFrameBytes * I2C_US_PER_BYTE / 1000.0);
+  printf("panel vs full redraw: %lu checks, %lu mismatches: %s\n", checks, mismatches, mismatches ? "FAILED" : "ok");
+  return mismatches ? 1 : 0;
+}
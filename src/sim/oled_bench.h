@@ -0,0 +1,7 @@
+#ifndef OLED_BENCH_H
+#define OLED_BENCH_H
+
+// `program oled [options]`: dirty-region OLED view against full redraws on a fake panel.
+int runOledBench(int argc, char** argv);
+
+#endif // OLED_BENCH_H
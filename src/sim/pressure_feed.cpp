@@ -0,0 +1,229 @@
+// Synthetic pressure feed for the continuous capture pipeline (lib/PressureCapture).
+//
+// Generates the raw ADC stream the I2S DMA delivers on the machine -- a shot profile with
+// vibratory pump ripple, sensor noise and occasional spikes -- and runs it through the same
+// PressureDecimator the firmware uses. For comparison it also replays the former polled
+// path (7 back-to-back reads every 20 ms, sorted and trimmed). Typical use:
+//
+//   .pio/build/native/program pressure
+//   .pio/build/native/program pressure --mains 49.8 --spike-rate 0.01 --csv pressure.csv
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "PressureDecimator.h"
+#include "pressure_feed.h"
+
+namespace {
+
+// Same sensor calibration as the firmware (src/main.cpp)
+const double VOLTS_AT_0_BAR = 0.34;
+const double VOLTS_AT_16_BAR = 4.34;
+const double PRESSURE_MAX_BAR = 16.0;
+const double ADC_MAX_VOLTAGE = 3.3;
+const double ADC_MAX_VALUE = 4095.0;
+
+const int POLLED_READS = 7;            // Former getStableAdcValue(): 7 reads, drop 1 each end
+const double POLLED_READ_SPACING_S = 10e-6;
+const double POLLED_PERIOD_S = 0.020;  // Sensing task period
+
+struct FeedOptions {
+  unsigned long rateHz = 2000;
+  int factor = 40;
+  double mainsHz = 50.0;
+  double rippleBar = 0.4;     // Pump pulsation amplitude while the pump runs
+  double noiseCounts = 6.0;   // Gaussian sensor/ADC noise, 1 sigma
+  double spikeRate = 0.002;   // Probability of a spike per raw sample
+  double spikeCounts = 400.0;
+  unsigned seed = 1;
+  const char* csvPath = nullptr;
+  double ripplePhase = 0.0;   // Pump ripple is not synchronised with the sampling clock
+};
+
+void printUsage() {
+  printf("usage: program pressure [options]\n"
+         "  --rate HZ          raw ADC sample rate (default 2000)\n"
+         "  --factor N         decimation factor (default 40 -> 50 Hz)\n"
+         "  --mains HZ         pump ripple frequency (default 50)\n"
+         "  --ripple BAR       pump ripple amplitude (default 0.4)\n"
+         "  --noise COUNTS     ADC noise sigma (default 6)\n"
+         "  --spike-rate P     spike probability per raw sample (default 0.002)\n"
+         "  --seed N           noise seed (default 1)\n"
+         "  --csv PATH         write the decimated trace\n");
+}
+
+bool parseOptions(int argc, char** argv, FeedOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--rate") == 0) options.rateHz = strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--factor") == 0) options.factor = atoi(value);
+    else if (strcmp(arg, "--mains") == 0) options.mainsHz = atof(value);
+    else if (strcmp(arg, "--ripple") == 0) options.rippleBar = atof(value);
+    else if (strcmp(arg, "--noise") == 0) options.noiseCounts = atof(value);
+    else if (strcmp(arg, "--spike-rate") == 0) options.spikeRate = atof(value);
+    else if (strcmp(arg, "--seed") == 0) options.seed = (unsigned)atoi(value);
+    else if (strcmp(arg, "--csv") == 0) options.csvPath = value;
+    else return false;
+    i++;
+  }
+  return options.rateHz > 0 && options.factor >= 3;
+}
+
+// Shot profile: idle, 3 bar pre-infusion, ramp to 9 bar, hold, pump off, idle.
+double profileBar(double t) {
+  if (t < 2.0) return 0.0;
+  if (t < 3.0) return 3.0 * (t - 2.0);
+  if (t < 7.0) return 3.0;
+  if (t < 9.0) return 3.0 + 3.0 * (t - 7.0);
+  if (t < 30.0) return 9.0;
+  if (t < 31.0) return 9.0 * (31.0 - t);
+  return 0.0;
+}
+const double PROFILE_END_S = 34.0;
+
+bool pumpRunning(double t) { return t >= 2.0 && t < 31.0; }
+
+double barToCounts(double bar) {
+  double volts = VOLTS_AT_0_BAR + bar / PRESSURE_MAX_BAR * (VOLTS_AT_16_BAR - VOLTS_AT_0_BAR);
+  return volts / ADC_MAX_VOLTAGE * ADC_MAX_VALUE;
+}
+
+double countsToBar(double counts) {
+  double volts = counts / ADC_MAX_VALUE * ADC_MAX_VOLTAGE;
+  double bar = (volts - VOLTS_AT_0_BAR) / (VOLTS_AT_16_BAR - VOLTS_AT_0_BAR) * PRESSURE_MAX_BAR;
+  return bar < 0.0 ? 0.0 : bar;
+}
+
+double gaussian() {
+  // Box-Muller, deterministic through rand() so runs are reproducible with srand()
+  double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+  double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+  return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+// One raw ADC conversion at time t, including ripple, noise and spikes.
+uint16_t sampleAdc(const FeedOptions& options, double t) {
+  double bar = profileBar(t);
+  if (pumpRunning(t)) {
+    double phase = 2.0 * M_PI * options.mainsHz * t + options.ripplePhase;
+    bar += options.rippleBar * (sin(phase) + 0.3 * sin(2.0 * phase)); // Half-wave pump pulses
+  }
+  double counts = barToCounts(bar) + options.noiseCounts * gaussian();
+  if ((double)rand() / RAND_MAX < options.spikeRate) {
+    counts += (rand() & 1) ? options.spikeCounts : -options.spikeCounts;
+  }
+  if (counts < 0.0) counts = 0.0;
+  if (counts > ADC_MAX_VALUE) counts = ADC_MAX_VALUE;
+  return (uint16_t)lround(counts);
+}
+
+struct ErrorStats {
+  double squaredSum = 0.0;
+  double worst = 0.0;
+  unsigned long count = 0;
+
+  void add(double error) {
+    squaredSum += error * error;
+    if (fabs(error) > worst) worst = fabs(error);
+    count++;
+  }
+  double rms() const { return count ? sqrt(squaredSum / count) : 0.0; }
+};
+
+// Mean of the clean profile over [t0, t1): what an ideal sensor would report for the block.
+double profileMeanBar(double t0, double t1) {
+  const int steps = 64;
+  double sum = 0.0;
+  for (int i = 0; i < steps; i++) {
+    sum += profileBar(t0 + (t1 - t0) * (i + 0.5) / steps);
+  }
+  return sum / steps;
+}
+
+int compareCounts(const void* a, const void* b) { return *(const int*)a - *(const int*)b; }
+
+} // namespace
+
+int runPressureFeed(int argc, char** argv) {
+  FeedOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+  FILE* csv = nullptr;
+  if (options.csvPath) {
+    csv = fopen(options.csvPath, "w");
+    if (!csv) {
+      perror(options.csvPath);
+      return 1;
+    }
+    fprintf(csv, "time_ms,true_bar,decimated_bar,min_raw,max_raw\n");
+  }
+
+  // Generate the whole raw stream first so the decimator is timed on its own.
+  srand(options.seed);
+  options.ripplePhase = 2.0 * M_PI * rand() / RAND_MAX;
+  unsigned long totalSamples = (unsigned long)(PROFILE_END_S * options.rateHz);
+  uint16_t* raw = (uint16_t*)malloc(totalSamples * sizeof(uint16_t));
+  if (!raw) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  for (unsigned long i = 0; i < totalSamples; i++) {
+    raw[i] = sampleAdc(options, (double)i / options.rateHz);
+  }
+
+  PressureDecimator decimator(options.rateHz, (uint16_t)options.factor);
+  ErrorStats decimatedError;
+  unsigned long blocks = 0;
+  bool uniformTimestamps = true;
+  uint32_t lastTimeMs = 0;
+  uint32_t expectedStepMs = (uint32_t)(1000u * options.factor / options.rateHz);
+
+  std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < totalSamples; i++) {
+    DecimatedSample block;
+    if (!decimator.push(raw[i], block)) continue;
+    uint32_t timeMs = decimator.sampleTimeMs(block.sampleIndex);
+    if (blocks > 0 && timeMs - lastTimeMs != expectedStepMs) uniformTimestamps = false;
+    lastTimeMs = timeMs;
+
+    double t0 = (double)block.sampleIndex / options.rateHz;
+    double trueBar = profileMeanBar(t0, t0 + (double)options.factor / options.rateHz);
+    double measuredBar = countsToBar((double)block.adcValue);
+    decimatedError.add(measuredBar - trueBar);
+    blocks++;
+    if (csv) {
+      fprintf(csv, "%lu,%.3f,%.3f,%u,%u\n", (unsigned long)timeMs, trueBar, measuredBar, block.minRaw, block.maxRaw);
+    }
+  }
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  free(raw);
+  if (csv) fclose(csv);
+
+  // Former polled path: a burst of back-to-back reads every sensing period.
+  srand(options.seed + 1);
+  ErrorStats polledError;
+  for (double t = 0.0; t < PROFILE_END_S; t += POLLED_PERIOD_S) {
+    int reads[POLLED_READS];
+    for (int i = 0; i < POLLED_READS; i++) {
+      reads[i] = sampleAdc(options, t + i * POLLED_READ_SPACING_S);
+    }
+    qsort(reads, POLLED_READS, sizeof(int), compareCounts);
+    long sum = 0;
+    for (int i = 1; i < POLLED_READS - 1; i++) sum += reads[i];
+    polledError.add(countsToBar((double)sum / (POLLED_READS - 2)) - profileBar(t));
+  }
+
+  printf("raw samples:          %lu at %lu Hz\n", totalSamples, options.rateHz);
+  printf("decimated:            %lu blocks at %.1f Hz, timestamps %s\n", blocks, decimator.outputRateHz(),
+         uniformTimestamps ? "uniform" : "NOT uniform");
+  printf("decimator cost:       %.1f ns/sample\n", totalSamples ? wallS * 1e9 / totalSamples : 0.0);
+  printf("decimated error:      rms %.3f bar, worst %.3f bar\n", decimatedError.rms(), decimatedError.worst);
+  printf("polled (7 reads):     rms %.3f bar, worst %.3f bar\n", polledError.rms(), polledError.worst);
+  return uniformTimestamps ? 0 : 1;
+}
@@ -0,0 +1,7 @@
+#ifndef PRESSURE_FEED_H
+#define PRESSURE_FEED_H
+
+// `program pressure [options]`: synthetic shot pressure fed through the capture decimator.
+int runPressureFeed(int argc, char** argv);
+
+#endif // PRESSURE_FEED_H
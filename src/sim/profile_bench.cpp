@@ -0,0 +1,271 @@
+// Pressure profile tracking benchmark: the pump controller (lib/PressureProfile) against the
+// pump/puck hydraulic model (lib/BoilerSim).
+//
+// Runs the firmware's pressure path: 2 kHz ADC samples of the transducer (12 bit, with the
+// pump ripple and noise), the 40-sample trimmed-mean decimator, the ADC-to-bar scale and the
+// 5-block SMA. The shot timer starts at 2 bar, then the controller sets the dimmer power
+// once per block (50 Hz). Each scenario is a 40 s shot on a puck:
+//
+//   nominal      profile on the puck the defaults were tuned for
+//   fine         puck resistance x1.4 (finer grind, more dose)
+//   coarse       puck resistance x0.8
+//   channeling   nominal puck whose resistance drops 25% at 15 s
+//   flat9        flat 9 bar profile, nominal puck
+//
+// Each runs with the pump at full power as today ("stock"), with the feedforward alone and
+// with the closed loop. Against the model's true pressure: RMS tracking error from 1 s after
+// the shot start, RMS in the hold phase, largest overshoot, and the yield. The closed loop
+// must hold each profile within the bounds below and beat the feedforward alone, or the run
+// fails. Typical use:
+//
+//   .pio/build/native/program profile
+//   .pio/build/native/program profile --scenario channeling --csv channeling.csv
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "HydraulicModel.h"
+#include "MovingAverage.h"
+#include "PressureDecimator.h"
+#include "PressureScale.h"
+#include "PumpController.h"
+#include "SensorScalar.h"
+#include "bench_report.h"
+#include "profile_bench.h"
+
+namespace {
+
+// Firmware pressure path (src/main.cpp)
+const uint32_t SAMPLE_RATE_HZ = 2000;
+const uint16_t DECIMATION_FACTOR = 40;
+const double VOLTS_AT_0_BAR = 0.34;
+const double VOLTS_AT_16_BAR = 4.34;
+const double PRESSURE_MAX_BAR = 16.0;
+const double ADC_MAX_VOLTAGE = 3.3;
+const double ADC_MAX_VALUE = 4095.0;
+const float SHOT_START_BAR = 2.0f;
+const double SENSOR_NOISE_BAR = 0.03;
+
+const double SHOT_S = 40.0;
+const double SETTLE_S = 1.0; // Tracking is scored from here (headspace fill)
+
+// Closed-loop bounds against the true pressure
+const double RMS_BOUND_BAR = 0.2;
+const double HOLD_RMS_BOUND_BAR = 0.15;
+const double OVERSHOOT_BOUND_BAR = 0.6;
+
+struct ProfileBenchOptions {
+  const char* scenario = "all";
+  unsigned seed = 1;
+  const char* csvPath = nullptr;
+  PumpControllerConfig config;
+};
+
+void printUsage() {
+  printf("usage: program profile [options]\n"
+         "  --scenario NAME    nominal, fine, coarse, channeling, flat9 or all (default all)\n"
+         "  --seed N           sensor noise seed (default 1)\n"
+         "  --csv PATH         closed-loop trace of the (first) scenario: time, target, pressure, power\n"
+         "  --kp X             percent per bar (default from PumpControllerConfig)\n"
+         "  --ki X             percent per bar * second\n"
+         "  --ff X             feedforward percent per bar\n");
+}
+
+bool parseOptions(int argc, char** argv, ProfileBenchOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--scenario") == 0) options.scenario = value;
+    else if (strcmp(arg, "--seed") == 0) options.seed = (unsigned)strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--csv") == 0) options.csvPath = value;
+    else if (strcmp(arg, "--kp") == 0) options.config.kp = (float)atof(value);
+    else if (strcmp(arg, "--ki") == 0) options.config.ki = (float)atof(value);
+    else if (strcmp(arg, "--ff") == 0) options.config.feedforwardPercentPerBar = (float)atof(value);
+    else return false;
+    i++;
+  }
+  return true;
+}
+
+// --- Scenarios ---
+struct Scenario {
+  const char* name;
+  double puckScale;
+  double channelAtS;    // < 0: none
+  double channelScale;
+  bool flat;
+};
+
+const Scenario SCENARIOS[] = {
+    {"nominal", 1.0, -1.0, 1.0, false},
+    {"fine", 1.4, -1.0, 1.0, false},
+    {"coarse", 0.8, -1.0, 1.0, false},
+    {"channeling", 1.0, 15.0, 0.75, false},
+    {"flat9", 1.0, -1.0, 1.0, true},
+};
+
+PressureProfile scenarioProfile(const Scenario& scenario) {
+  if (!scenario.flat) return defaultPressureProfile();
+  PressureProfile profile = {9.0f, 0.0f, 0.0f, 9.0f, 60.0f, 0.0f, 9.0f};
+  return profile;
+}
+
+enum PumpMode { PUMP_STOCK, PUMP_FEEDFORWARD, PUMP_CLOSED_LOOP };
+const char* pumpModeName(PumpMode mode) {
+  return mode == PUMP_STOCK ? "stock" : mode == PUMP_FEEDFORWARD ? "ff" : "closed";
+}
+
+struct ShotResult {
+  double rmsErrorBar = 0.0;
+  double holdRmsErrorBar = 0.0;
+  double maxOvershootBar = 0.0;
+  double yieldMl = 0.0;
+  double startS = NAN; // Shot timer start after the brew switch
+  double cpuNsPerUpdate = 0.0;
+};
+
+// --- One shot through the firmware's pressure path ---
+ShotResult runShot(const Scenario& scenario, PumpMode mode, const ProfileBenchOptions& options, FILE* csv) {
+  PumpControllerConfig config = options.config;
+  if (mode == PUMP_FEEDFORWARD) {
+    config.kp = 0.0f;
+    config.ki = 0.0f;
+  }
+  PumpController controller(config);
+  controller.setProfile(scenarioProfile(scenario));
+  controller.setEnabled(mode != PUMP_STOCK);
+
+  HydraulicModel model;
+  model.scalePuckResistance(scenario.puckScale);
+  model.setPumpRunning(true);
+  model.setPowerPercent(controller.power());
+
+  PressureDecimator decimator(SAMPLE_RATE_HZ, DECIMATION_FACTOR);
+  PressureScale scale(VOLTS_AT_0_BAR, VOLTS_AT_16_BAR, PRESSURE_MAX_BAR, ADC_MAX_VOLTAGE, ADC_MAX_VALUE);
+  MovingAverage<SensorScalar, 5, SensorAccumulator> smoothing;
+  std::mt19937 random(options.seed);
+  std::normal_distribution<double> noise(0.0, SENSOR_NOISE_BAR);
+
+  ShotResult result;
+  bool shotRunning = false;
+  bool channeled = false;
+  double squaredError = 0.0, holdSquaredError = 0.0;
+  unsigned long scored = 0, holdScored = 0, updates = 0;
+  double cpuNs = 0.0;
+  const double dt = 1.0 / SAMPLE_RATE_HZ;
+  const unsigned long steps = (unsigned long)(SHOT_S * SAMPLE_RATE_HZ);
+  for (unsigned long i = 0; i < steps; i++) {
+    model.step(dt);
+    double volts = VOLTS_AT_0_BAR + (model.sensorPressureBar() + noise(random)) / PRESSURE_MAX_BAR * (VOLTS_AT_16_BAR - VOLTS_AT_0_BAR);
+    long counts = lround(volts / ADC_MAX_VOLTAGE * ADC_MAX_VALUE);
+    if (counts < 0) counts = 0;
+    if (counts > (long)ADC_MAX_VALUE) counts = (long)ADC_MAX_VALUE;
+
+    DecimatedSample block;
+    if (!decimator.push((uint16_t)counts, block)) continue;
+
+    // One decimated block, as processPressureBlock() handles it
+    double nowS = (double)decimator.sampleTimeMs(block.sampleIndex + DECIMATION_FACTOR) / 1000.0;
+    float pressureBar = (float)scale.toBar(SensorScalar(smoothing.update(block.adcValue)));
+    if (!shotRunning && pressureBar >= SHOT_START_BAR) {
+      shotRunning = true;
+      result.startS = nowS;
+      controller.start();
+    }
+    float shotSeconds = shotRunning ? (float)(nowS - result.startS) : 0.0f;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    float power = controller.update(shotSeconds, pressureBar);
+    cpuNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    updates++;
+    model.setPowerPercent(power);
+
+    if (scenario.channelAtS >= 0 && shotRunning && !channeled && shotSeconds >= scenario.channelAtS) {
+      model.scalePuckResistance(scenario.channelScale);
+      channeled = true;
+    }
+
+    if (!shotRunning) continue;
+    PressureProfile profile = controller.profile();
+    double targetBar = profileTargetBar(profile, shotSeconds);
+    double error = model.pressureBar() - targetBar;
+    if (csv) fprintf(csv, "%.2f,%.2f,%.3f,%.3f,%.1f\n", nowS, targetBar, model.pressureBar(), pressureBar, power);
+    if (shotSeconds < SETTLE_S) continue;
+    squaredError += error * error;
+    scored++;
+    if (profilePhaseAt(profile, shotSeconds) == PROFILE_HOLD) {
+      holdSquaredError += error * error;
+      holdScored++;
+    }
+    if (error > result.maxOvershootBar) result.maxOvershootBar = error;
+  }
+  result.rmsErrorBar = scored > 0 ? sqrt(squaredError / scored) : NAN;
+  result.holdRmsErrorBar = holdScored > 0 ? sqrt(holdSquaredError / holdScored) : NAN;
+  result.yieldMl = model.cupVolumeMl();
+  result.cpuNsPerUpdate = updates > 0 ? cpuNs / updates : 0.0;
+  return result;
+}
+
+} // namespace
+
+int runProfileBench(int argc, char** argv) {
+  ProfileBenchOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+
+  FILE* csv = nullptr;
+  if (options.csvPath) {
+    csv = fopen(options.csvPath, "w");
+    if (!csv) {
+      fprintf(stderr, "cannot write %s\n", options.csvPath);
+      return 1;
+    }
+    fprintf(csv, "time_s,target_bar,pressure_bar,sensor_bar,pump_power\n");
+  }
+
+  const PumpMode modes[] = {PUMP_STOCK, PUMP_FEEDFORWARD, PUMP_CLOSED_LOOP};
+  bool ok = true;
+  bool any = false;
+  printf("%-11s %-7s %8s %8s %10s %9s %8s %8s\n", "scenario", "pump", "start_s", "rms_bar", "hold_rms", "overshoot",
+         "yield_ml", "cpu_ns");
+  for (size_t s = 0; s < sizeof(SCENARIOS) / sizeof(SCENARIOS[0]); s++) {
+    const Scenario& scenario = SCENARIOS[s];
+    if (!scenarioSelected(options.scenario, scenario.name)) continue;
+    any = true;
+    ShotResult results[3];
+    for (int m = 0; m < 3; m++) {
+      results[m] = runShot(scenario, modes[m], options, modes[m] == PUMP_CLOSED_LOOP ? csv : nullptr);
+      const ShotResult& r = results[m];
+      printf("%-11s %-7s %8.2f %8.3f %10.3f %9.2f %8.1f %8.0f\n", scenario.name, pumpModeName(modes[m]), r.startS,
+             r.rmsErrorBar, r.holdRmsErrorBar, r.maxOvershootBar, r.yieldMl, r.cpuNsPerUpdate);
+    }
+    if (csv) {
+      fclose(csv);
+      csv = nullptr;
+    }
+
+    const ShotResult& closed = results[2];
+    const ShotResult& feedforward = results[1];
+    if (!(closed.rmsErrorBar <= RMS_BOUND_BAR) || !(closed.holdRmsErrorBar <= HOLD_RMS_BOUND_BAR) ||
+        !(closed.maxOvershootBar <= OVERSHOOT_BOUND_BAR)) {
+      printf("  %s: closed loop outside its bounds (rms %.2f, hold rms %.2f, overshoot %.1f bar)\n", scenario.name,
+             RMS_BOUND_BAR, HOLD_RMS_BOUND_BAR, OVERSHOOT_BOUND_BAR);
+      ok = false;
+    }
+    if (!(closed.rmsErrorBar < feedforward.rmsErrorBar)) {
+      printf("  %s: closed loop no better than the feedforward alone\n", scenario.name);
+      ok = false;
+    }
+  }
+  if (csv) fclose(csv);
+  if (!any) {
+    printUsage();
+    return 1;
+  }
+  return benchResult("profile", ok);
+}
@@ -0,0 +1,8 @@
+#ifndef PROFILE_BENCH_H
+#define PROFILE_BENCH_H
+
+// `program profile [options]`: pressure profile tracking of the pump controller against the
+// pump/puck hydraulic model, through the firmware's pressure path.
+int runProfileBench(int argc, char** argv);
+
+#endif // PROFILE_BENCH_H
@@ -0,0 +1,401 @@
+// Host checks for the shot log (lib/ShotLog) on a file-backed flash image.
+//
+// The image holds fixed slots, one per segment file, each with a small header (sequence,
+// length), and counts appends, 4 KB blocks programmed (an append rewrites the partly filled
+// tail block, as LittleFS does) and erases per slot. A workload of daily sessions - shots
+// with synthetic traces, occasional deletes - runs in virtual time against the store, which
+// is then checked against a reference: every listed shot matches, every trace reads back
+// byte for byte, after a reopen from the image too. A power cut in the middle of a batch
+// write must leave every earlier shot readable and the store appendable. Finally the
+// same workload with a flash write per shot shows what the batching saves.
+//
+//   .pio/build/native/program shots
+//   .pio/build/native/program shots --days 30 --image /tmp/shots.img
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "ShotRecorder.h"
+#include "ShotStore.h"
+#include "shot_store_bench.h"
+
+namespace {
+
+const unsigned long SHOT_TRACE_INTERVAL_MS = 250; // As in the firmware
+const unsigned long SERVICE_PERIOD_MS = 10000;    // Store service between shots (firmware: every network loop)
+const uint32_t FLASH_BLOCK_BYTES = 4096;
+const uint32_t START_TIME = 1760000000;           // Unix time of day 0
+
+struct ShotOptions {
+  int days = 365;
+  const char* imagePath = "/tmp/shot_store.img";
+  unsigned seed = 3;
+};
+
+void printUsage() {
+  printf("usage: program shots [options]\n"
+         "  --days N           simulated days of use (default 365)\n"
+         "  --image PATH       flash image file (default /tmp/shot_store.img, overwritten)\n"
+         "  --seed N           workload seed (default 3)\n");
+}
+
+bool parseOptions(int argc, char** argv, ShotOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--days") == 0) options.days = atoi(value);
+    else if (strcmp(arg, "--image") == 0) options.imagePath = value;
+    else if (strcmp(arg, "--seed") == 0) options.seed = (unsigned)atoi(value);
+    else return false;
+    i++;
+  }
+  return options.days > 0;
+}
+
+// --- Flash image ---
+// Slot i at i * (8 + slotBytes): sequence:u32 (0 = free), length:u32, data. Host byte
+// order, the image never leaves the machine that wrote it.
+class FlashImageStorage : public ShotSegmentStorage {
+public:
+  FlashImageStorage(const char* path, size_t slots, uint32_t slotBytes, bool format)
+      : _slots(slots), _slotBytes(slotBytes), _erases(slots, 0) {
+    _file = fopen(path, format ? "w+b" : "r+b");
+    if (_file != nullptr && format) {
+      std::vector<uint8_t> empty(8 + slotBytes, 0);
+      for (size_t i = 0; i < slots; i++) fwrite(empty.data(), 1, empty.size(), _file);
+      fflush(_file);
+    }
+  }
+  ~FlashImageStorage() {
+    if (_file != nullptr) fclose(_file);
+  }
+
+  bool ok() const { return _file != nullptr; }
+  // The next append stops after `bytes` and the device is dead until a new instance opens the image.
+  void cutPowerAfter(size_t bytes) { _cutAfter = (long)bytes; }
+
+  unsigned long appends() const { return _appends; }
+  unsigned long blocksProgrammed() const { return _blocksProgrammed; }
+  unsigned long maxSlotErases() const {
+    unsigned long most = 0;
+    for (unsigned long erases : _erases) most = erases > most ? erases : most;
+    return most;
+  }
+
+  size_t listSegments(uint32_t* sequences, size_t capacity) override {
+    size_t count = 0;
+    for (size_t slot = 0; slot < _slots && count < capacity; slot++) {
+      uint32_t header[2];
+      if (readHeader(slot, header) && header[0] != 0) sequences[count++] = header[0];
+    }
+    return count;
+  }
+
+  long segmentSize(uint32_t sequence) override {
+    uint32_t header[2];
+    long slot = find(sequence, header);
+    return slot < 0 ? -1 : (long)header[1];
+  }
+
+  bool read(uint32_t sequence, uint32_t offset, uint8_t* data, size_t length) override {
+    uint32_t header[2];
+    long slot = find(sequence, header);
+    if (slot < 0 || _dead || offset + length > header[1]) return false;
+    return fseek(_file, dataOffset(slot) + offset, SEEK_SET) == 0 && fread(data, 1, length, _file) == length;
+  }
+
+  bool append(uint32_t sequence, const uint8_t* data, size_t length) override {
+    if (_dead) return false;
+    uint32_t header[2];
+    long slot = find(sequence, header);
+    if (slot < 0) {
+      slot = find(0, header);
+      if (slot < 0) return false;
+      header[0] = sequence;
+      header[1] = 0;
+    }
+    if (header[1] + length > _slotBytes) return false;
+    size_t written = length;
+    if (_cutAfter >= 0) {
+      written = (size_t)_cutAfter < length ? (size_t)_cutAfter : length;
+      _dead = true;
+    }
+    fseek(_file, dataOffset(slot) + header[1], SEEK_SET);
+    fwrite(data, 1, written, _file);
+    _appends++;
+    _blocksProgrammed += (header[1] % FLASH_BLOCK_BYTES + written + FLASH_BLOCK_BYTES - 1) / FLASH_BLOCK_BYTES;
+    header[1] += (uint32_t)written;
+    writeHeader(slot, header);
+    fflush(_file);
+    return !_dead;
+  }
+
+  bool remove(uint32_t sequence) override {
+    uint32_t header[2];
+    long slot = find(sequence, header);
+    if (slot < 0 || _dead) return false;
+    header[0] = 0;
+    header[1] = 0;
+    writeHeader(slot, header);
+    _erases[slot]++;
+    return true;
+  }
+
+private:
+  long dataOffset(long slot) const { return slot * (long)(8 + _slotBytes) + 8; }
+  bool readHeader(size_t slot, uint32_t* header) {
+    return fseek(_file, (long)slot * (long)(8 + _slotBytes), SEEK_SET) == 0 && fread(header, 4, 2, _file) == 2;
+  }
+  void writeHeader(long slot, const uint32_t* header) {
+    fseek(_file, slot * (long)(8 + _slotBytes), SEEK_SET);
+    fwrite(header, 4, 2, _file);
+  }
+  long find(uint32_t sequence, uint32_t* header) {
+    for (size_t slot = 0; slot < _slots; slot++) {
+      if (readHeader(slot, header) && header[0] == sequence) return (long)slot;
+    }
+    return -1;
+  }
+
+  FILE* _file;
+  size_t _slots;
+  uint32_t _slotBytes;
+  std::vector<unsigned long> _erases;
+  long _cutAfter = -1;
+  bool _dead = false;
+  unsigned long _appends = 0;
+  unsigned long _blocksProgrammed = 0;
+};
+
+// --- Workload ---
+
+struct ExpectedShot {
+  ShotSummary summary;
+  std::vector<uint8_t> trace;
+  bool deleted;
+};
+
+struct Workload {
+  std::vector<ExpectedShot> shots;
+  unsigned long nowMs = 0;
+  std::vector<uint32_t> deletedIds;
+  unsigned long rejected = 0;
+};
+
+// One shot through the recorder: preinfusion ramp to ~9 bar, boiler temperature sagging,
+// flow following the pressure.
+ExpectedShot recordShot(std::mt19937& rng, unsigned long startMs, uint32_t startTime, double durationS) {
+  std::normal_distribution<double> noise(0.0, 1.0);
+  ShotRecorder recorder(SHOT_TRACE_INTERVAL_MS);
+  recorder.start(startMs);
+  double startTemp = 92.0 + noise(rng);
+  double peak = 8.5 + 0.5 * noise(rng);
+  float maxPressure = 0.0f;
+  double volume = 0.0;
+  for (unsigned long t = 0; t <= (unsigned long)(durationS * 1000.0); t += 20) {
+    double s = t / 1000.0;
+    double pressure = s < 6.0 ? 2.0 + s * (peak - 2.0) / 6.0 : peak - 0.04 * (s - 6.0);
+    pressure += 0.05 * noise(rng);
+    double temp = startTemp - 4.0 * (1.0 - exp(-s / 12.0)) + 0.05 * noise(rng);
+    double flow = 0.25 * pressure + 0.05 * noise(rng);
+    volume += flow * 0.02;
+    if (pressure > maxPressure) maxPressure = (float)pressure;
+    recorder.update(startMs + t, (float)temp, (float)pressure, (float)flow, (float)volume);
+  }
+
+  ExpectedShot shot;
+  std::vector<uint8_t> buffer(ShotStore::MAX_TRACE_BYTES);
+  shot.summary.startTime = startTime;
+  shot.summary.durationMs = (uint32_t)(durationS * 1000.0);
+  shot.summary.maxPressureBar = maxPressure;
+  shot.summary.startTempC = recorder.startTemperatureC();
+  shot.summary.traceBytes = (uint32_t)recorder.encode(buffer.data(), buffer.size());
+  shot.trace.assign(buffer.begin(), buffer.begin() + shot.summary.traceBytes);
+  shot.deleted = false;
+  return shot;
+}
+
+void serviceUntil(ShotStore& store, Workload& workload, unsigned long untilMs) {
+  while (workload.nowMs + SERVICE_PERIOD_MS < untilMs) {
+    workload.nowMs += SERVICE_PERIOD_MS;
+    store.service(workload.nowMs);
+  }
+  workload.nowMs = untilMs;
+  store.service(workload.nowMs);
+}
+
+// Two sessions a day (morning, afternoon) of 1-4 shots a few minutes apart; now and then a
+// shot is deleted from the list.
+void runDays(ShotStore& store, Workload& workload, int firstDay, int days, std::mt19937& rng) {
+  std::uniform_int_distribution<int> shotsPerSession(1, 4);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  for (int day = firstDay; day < firstDay + days; day++) {
+    for (int session = 0; session < 2; session++) {
+      unsigned long sessionS = (unsigned long)day * 86400UL + (session == 0 ? 7 * 3600 : 14 * 3600) + (unsigned long)(unit(rng) * 3600);
+      int shots = shotsPerSession(rng);
+      for (int i = 0; i < shots; i++) {
+        unsigned long startS = sessionS + (unsigned long)i * (120 + (unsigned long)(unit(rng) * 120));
+        serviceUntil(store, workload, startS * 1000UL);
+        double durationS = 22.0 + 16.0 * unit(rng);
+        ExpectedShot shot = recordShot(rng, workload.nowMs, START_TIME + (uint32_t)startS, durationS);
+        workload.nowMs += (unsigned long)(durationS * 1000.0);
+        if (store.add(shot.summary, shot.trace.data(), workload.nowMs)) {
+          workload.shots.push_back(shot);
+        } else {
+          workload.rejected++;
+        }
+      }
+      if (unit(rng) < 0.15 && !workload.shots.empty()) {
+        ExpectedShot& victim = workload.shots[(size_t)(unit(rng) * workload.shots.size())];
+        if (!victim.deleted && store.remove(victim.summary.id)) {
+          victim.deleted = true;
+          workload.deletedIds.push_back(victim.summary.id);
+        }
+      }
+    }
+  }
+}
+
+// Every listed shot matches its reference and reads back intact; every live reference shot
+// newer than the oldest listed one is listed.
+int verify(ShotStore& store, const Workload& workload, const char* label) {
+  int problems = 0;
+  std::vector<uint8_t> buffer(ShotStore::MAX_RECORD_BYTES);
+  uint32_t oldestId = 0;
+  size_t expected = 0;
+  for (size_t i = 0; i < store.count(); i++) {
+    ShotSummary listed;
+    store.summaryAt(i, listed);
+    if (i == 0) oldestId = listed.id;
+    const ExpectedShot* reference = nullptr;
+    for (const ExpectedShot& shot : workload.shots) {
+      if (shot.summary.id == listed.id) reference = &shot;
+    }
+    size_t traceBytes = store.readTrace(listed.id, buffer.data(), buffer.size());
+    if (reference == nullptr || reference->deleted || listed.startTime != reference->summary.startTime ||
+        listed.durationMs != reference->summary.durationMs ||
+        fabsf(listed.maxPressureBar - reference->summary.maxPressureBar) > 0.0051f ||
+        fabsf(listed.startTempC - reference->summary.startTempC) > 0.0051f || traceBytes != reference->trace.size() ||
+        memcmp(buffer.data(), reference->trace.data(), traceBytes) != 0) {
+      if (problems < 5) printf("  %s: shot %u does not match\n", label, listed.id);
+      problems++;
+    }
+  }
+  for (const ExpectedShot& shot : workload.shots) {
+    if (!shot.deleted && shot.summary.id >= oldestId) expected++;
+  }
+  if (expected != store.count()) {
+    printf("  %s: %zu shots listed, %zu expected\n", label, store.count(), expected);
+    problems++;
+  }
+  return problems;
+}
+
+} // namespace
+
+int runShotStoreBench(int argc, char** argv) {
+  ShotOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+  ShotStoreConfig config; // Firmware defaults
+  const size_t slots = config.maxSegments + 1;
+  int failures = 0;
+  std::mt19937 rng(options.seed);
+  Workload workload;
+  size_t deletesBeforeCut = 0;
+  unsigned long appends, blocks, erases, bytes;
+
+  {
+    FlashImageStorage image(options.imagePath, slots, config.segmentBytes, true);
+    if (!image.ok()) {
+      printf("cannot create %s\n", options.imagePath);
+      return 1;
+    }
+    ShotStore store(image, config);
+    store.begin();
+    runDays(store, workload, 0, options.days, rng);
+    serviceUntil(store, workload, workload.nowMs + config.flushIdleMs);
+    appends = image.appends();
+    blocks = image.blocksProgrammed();
+    erases = image.maxSlotErases();
+    bytes = store.bytesWritten();
+    int problems = verify(store, workload, "live");
+    printf("%d days: %zu shots recorded (%lu deleted, %lu rejected), %zu kept in %zu segments, %lu KB on flash\n",
+           options.days, workload.shots.size(), workload.deletedIds.size(), workload.rejected, store.count(), store.segmentCount(),
+           store.storedBytes() / 1024);
+    printf("  index %zu bytes RAM, write buffer %zu bytes\n", sizeof(ShotStore) - ShotStore::WRITE_BUFFER_BYTES,
+           ShotStore::WRITE_BUFFER_BYTES);
+    printf("  live store vs reference: %s\n", problems ? "FAILED" : "ok");
+    failures += problems;
+  }
+
+  {
+    FlashImageStorage image(options.imagePath, slots, config.segmentBytes, false);
+    ShotStore store(image, config);
+    store.begin();
+    int problems = verify(store, workload, "reopened");
+    printf("  reopened from the image: %zu shots, %lu damaged: %s\n", store.count(), store.damagedRecords(),
+           problems ? "FAILED" : "ok");
+    failures += problems;
+
+    // Power cut halfway through the next batch write
+    deletesBeforeCut = workload.deletedIds.size();
+    runDays(store, workload, options.days, 1, rng);
+    size_t pending = store.pendingBytes();
+    image.cutPowerAfter(pending / 2);
+    store.flush();
+  }
+
+  {
+    FlashImageStorage image(options.imagePath, slots, config.segmentBytes, false);
+    ShotStore store(image, config);
+    store.begin();
+    // Records of the torn batch (shots and deletes of the last day) are complete or gone
+    uint32_t cutDayStart = START_TIME + (uint32_t)options.days * 86400U;
+    for (ExpectedShot& shot : workload.shots) {
+      ShotSummary listed;
+      bool present = store.find(shot.summary.id, listed);
+      if (!shot.deleted && !present && shot.summary.startTime >= cutDayStart) shot.deleted = true;
+      for (size_t i = deletesBeforeCut; i < workload.deletedIds.size(); i++) {
+        if (workload.deletedIds[i] == shot.summary.id && present) shot.deleted = false;
+      }
+    }
+    int problems = verify(store, workload, "after power cut");
+    runDays(store, workload, options.days + 1, 1, rng);
+    store.flush();
+    FlashImageStorage reopened(options.imagePath, slots, config.segmentBytes, false);
+    ShotStore again(reopened, config);
+    again.begin();
+    problems += verify(again, workload, "appended after power cut");
+    printf("  power cut mid-batch: %lu damaged tail skipped, %zu shots readable, a day appended and reopened: %s\n",
+           store.damagedRecords(), again.count(), problems ? "FAILED" : "ok");
+    failures += problems;
+  }
+
+  {
+    // Same workload, one flash write per shot
+    ShotStoreConfig unbatched = config;
+    unbatched.flushThresholdBytes = 0;
+    FlashImageStorage image(options.imagePath, slots, config.segmentBytes, true);
+    ShotStore store(image, unbatched);
+    store.begin();
+    std::mt19937 sameRng(options.seed);
+    Workload same;
+    runDays(store, same, 0, options.days, sameRng);
+    store.flush();
+    printf("flash writes for %d days        appends  4K blocks programmed  KB written  max erases/slot\n", options.days);
+    printf("  %-28s %8lu %21lu %11lu %16lu\n", "write per shot", image.appends(), image.blocksProgrammed(),
+           store.bytesWritten() / 1024, image.maxSlotErases());
+    printf("  %-28s %8lu %21lu %11lu %16lu\n", "batched (ShotStore default)", appends, blocks, bytes / 1024, erases);
+  }
+
+  remove(options.imagePath);
+  printf("shot store: %s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
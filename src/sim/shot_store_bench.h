@@ -0,0 +1,8 @@
+#ifndef SHOT_STORE_BENCH_H
+#define SHOT_STORE_BENCH_H
+
+// `program shots [options]`: shot log on a file-backed flash image - a year of sessions,
+// reopen, power cut, retention, and flash writes with and without batching.
+int runShotStoreBench(int argc, char** argv);
+
+#endif // SHOT_STORE_BENCH_H
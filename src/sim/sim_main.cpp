@@ -0,0 +1,469 @@
+// Host-side boiler simulator for the heater control core (PlatformIO [env:native]).
+//
+// Runs the same HeaterController the firmware uses against a thermoblock model in
+// virtual time, so hours of heat-up/shot/standby sequences replay in well under a
+// second. Typical use:
+//
+//   pio run -e native && .pio/build/native/program --hours 8 --shots 20
+//   .pio/build/native/program --seconds-per-degree 1.6 --csv trace.csv
+//   .pio/build/native/program --compare --shots 5     # burst vs PID vs MPC on one scenario
+//   .pio/build/native/program pressure                # pressure capture feed (pressure_feed.cpp)
+//   .pio/build/native/program filters                 # filter checks and benchmark (filter_bench.cpp)
+//   .pio/build/native/program fixed                   # Q16.16 error bounds and benchmark (fixed_bench.cpp)
+//   .pio/build/native/program json                    # streaming JSON vs String responses (json_bench.cpp)
+//   .pio/build/native/program stream                  # telemetry stream viewers, or --connect HOST (stream_bench.cpp)
+//   .pio/build/native/program telemetry               # binary frame round trip, size vs JSON (telemetry_bench.cpp)
+//   .pio/build/native/program oled                    # dirty-region OLED view on a fake panel (oled_bench.cpp)
+//   .pio/build/native/program weather                 # weather fetcher vs a failing stand-in server (weather_bench.cpp)
+//   .pio/build/native/program shots                   # shot log on a flash image, power cut, wear (shot_store_bench.cpp)
+//   .pio/build/native/program history                 # tiered min/max/mean history vs raw samples (history_bench.cpp)
+//   .pio/build/native/program capture                 # 50 Hz shot capture with pre-trigger on synthetic shots (capture_bench.cpp)
+//   .pio/build/native/program jobs                    # network task job scheduler on a virtual clock (jobs_bench.cpp)
+//   .pio/build/native/program metrics                 # stage metrics and /metrics text on a stubbed cycle counter (metrics_bench.cpp)
+//   .pio/build/native/program control                 # control-loop benchmark scenarios, --json for tracking (control_bench.cpp)
+//   .pio/build/native/program estimator               # EMA vs Kalman temperature estimate on recorded traces (estimator_bench.cpp)
+//   .pio/build/native/program calibration             # N-point calibration curves and lookup tables (calibration_bench.cpp)
+//   .pio/build/native/program profile                 # pressure profile tracking on a pump/puck model (profile_bench.cpp)
+//   .pio/build/native/program flow                    # flow and shot volume estimate on a pump/puck model (flow_bench.cpp)
+//   .pio/build/native/program watchdog                # safety watchdog under injected faults (watchdog_bench.cpp)
+//   .pio/build/native/program thermocouple            # sensor fault detection and degraded mode (thermocouple_bench.cpp)
+//   .pio/build/native/program standby                 # task wake-ups in low-power standby, wake and power on (standby_bench.cpp)
+//   .pio/build/native/program tasks                   # task split on a simulated two-core scheduler under load (tasks_bench.cpp)
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "BoilerModel.h"
+#include "HeaterController.h"
+#include "SimPlatform.h"
+#include "calibration_bench.h"
+#include "capture_bench.h"
+#include "control_bench.h"
+#include "estimator_bench.h"
+#include "filter_bench.h"
+#include "fixed_bench.h"
+#include "flow_bench.h"
+#include "history_bench.h"
+#include "jobs_bench.h"
+#include "metrics_bench.h"
+#include "json_bench.h"
+#include "oled_bench.h"
+#include "pressure_feed.h"
+#include "profile_bench.h"
+#include "shot_store_bench.h"
+#include "standby_bench.h"
+#include "stream_bench.h"
+#include "tasks_bench.h"
+#include "telemetry_bench.h"
+#include "thermocouple_bench.h"
+#include "watchdog_bench.h"
+#include "weather_bench.h"
+
+namespace {
+
+const unsigned long CONTROL_PERIOD_MS = 100; // Same period as the firmware control task
+const unsigned long PLANT_STEP_MS = 10;
+
+struct SimOptions {
+  double hours = 1.0;
+  double desiredTempC = 90.0;
+  double startTempC = 22.0;
+  int shots = 3;
+  double firstShotS = 900.0;
+  double shotIntervalS = 90.0;
+  double shotDurationS = 25.0;
+  double shotFlowMlPerS = 2.0;
+  double powerOffAtS = -1.0; // Machine main switch off (presumed-off detection)
+  double powerOnAtS = -1.0;
+  float secondsPerDegree = NAN;
+  ControlMode mode = CONTROL_MODE_BURST;
+  TemperatureEstimator estimator = HeaterControllerConfig().temperatureEstimator;
+  bool compare = false;
+  float kp = NAN;
+  float ki = NAN;
+  float kd = NAN;
+  long windowMs = -1;
+  double heaterPowerW = NAN;   // Plant variation (the controller defaults assume 1100 W)
+  double autoTuneAtS = -1.0;   // Request auto-tune at this time
+  ThermalModel model = {0.0f, 0.0f, 0.0f, 22.0f}; // --model: start with a known model
+  unsigned seed = 1;
+  bool verbose = false;
+  const char* csvPath = nullptr;
+};
+
+struct SimResult {
+  double warmupS = -1.0;       // First time within the band
+  double maxOvershootC = 0.0;  // After warm-up
+  double inBandPercent = 0.0;
+  double meanAbsErrorC = 0.0;
+  double worstShotDropC = 0.0; // Deepest dip below the set point caused by a shot
+  double worstRecoveryS = -1.0; // Shot end until back within the band (-1: never)
+  double meanRecoveryS = -1.0;
+  unsigned long relayToggles = 0;
+  double heaterOnS = 0.0;
+  int failedHeatAttempts = 0;
+  bool presumedOffAtEnd = false;
+  AutoTuneStatus autoTuneStatus = AUTOTUNE_OFF;
+  double autoTuneDoneS = -1.0;
+  ThermalModel model = {0.0f, 0.0f, 0.0f, 0.0f};
+};
+
+void printUsage() {
+  printf("usage: program [options]\n"
+         "       program pressure [options]   (pressure capture feed, see --help)\n"
+         "       program filters [options]    (filter property checks and benchmark)\n"
+         "       program fixed [options]      (Q16.16 sensor math error bounds and benchmark)\n"
+         "       program json [options]       (streaming JSON vs String responses)\n"
+         "       program stream [options]     (telemetry stream fan-out, or --connect HOST to measure a device)\n"
+         "       program telemetry [options]  (binary telemetry frame round trip and size vs JSON)\n"
+         "       program oled [options]       (dirty-region OLED view bytes per frame on a fake panel)\n"
+         "       program weather [options]    (weather fetcher timeouts and backoff vs a stand-in server)\n"
+         "       program shots [options]      (shot log on a file-backed flash image: replay, power cut, wear)\n"
+         "       program history [options]    (tiered min/max/mean history vs a brute-force reference)\n"
+         "       program capture [options]    (50 Hz shot capture with pre-trigger on synthetic shots)\n"
+         "       program jobs [options]       (network task job scheduler on a virtual clock)\n"
+         "       program metrics [options]    (stage metrics and /metrics text on a stubbed cycle counter)\n"
+         "       program control [options]    (control-loop benchmark scenarios, machine-readable with --json)\n"
+         "       program estimator [options]  (EMA vs Kalman temperature estimate: lag, noise, power-on detection)\n"
+         "       program calibration [options] (N-point calibration: lookup table error, fit checks, cost)\n"
+         "       program profile [options]    (pressure profile tracking on a pump/puck hydraulic model)\n"
+         "       program flow [options]       (flow and shot volume estimate on a pump/puck hydraulic model)\n"
+         "       program watchdog [options]   (safety watchdog under injected faults)\n"
+         "       program thermocouple [options] (thermocouple fault detection and degraded mode)\n"
+         "       program standby [options]    (task wake-ups in low-power standby, web wake, power-on detection)\n"
+         "       program tasks [options]      (control, sensing and network tasks on a simulated scheduler under load)\n"
+         "  --hours H                simulated duration (default 1)\n"
+         "  --set C                  desired temperature (default 90)\n"
+         "  --start C                initial boiler temperature (default 22)\n"
+         "  --shots N                number of shots (default 3)\n"
+         "  --first-shot S           time of the first shot in seconds (default 900)\n"
+         "  --shot-interval S        seconds between shot starts (default 90)\n"
+         "  --shot-duration S        shot length in seconds (default 25)\n"
+         "  --shot-flow ML_S         water flow during a shot (default 2.0)\n"
+         "  --power-off S            switch the machine off at S seconds\n"
+         "  --power-on S             switch the machine back on at S seconds\n"
+         "  --seconds-per-degree X   override HEATER_SECONDS_PER_DEGREE_C\n"
+         "  --mode burst|pid|mpc     controller mode (default burst)\n"
+         "  --compare                run the scenario with every mode and print a table\n"
+         "  --estimator ema|kalman   smoothed temperature source (default kalman)\n"
+         "  --kp X / --ki X / --kd X override the PID gains\n"
+         "  --window MS              PID/MPC relay window (default 2000)\n"
+         "  --heater-power W         simulated element power (default 1100)\n"
+         "  --autotune-at S          request auto-tune at S seconds\n"
+         "  --model G,TAU,DEAD       start with this thermal model (gain C, seconds, seconds)\n"
+         "  --seed N                 noise seed (default 1)\n"
+         "  --csv PATH               write a 1 Hz trace\n"
+         "  --verbose                print controller log lines\n");
+}
+
+bool parseOptions(int argc, char** argv, SimOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--verbose") == 0) { options.verbose = true; continue; }
+    if (strcmp(arg, "--compare") == 0) { options.compare = true; continue; }
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--hours") == 0) options.hours = atof(value);
+    else if (strcmp(arg, "--set") == 0) options.desiredTempC = atof(value);
+    else if (strcmp(arg, "--start") == 0) options.startTempC = atof(value);
+    else if (strcmp(arg, "--shots") == 0) options.shots = atoi(value);
+    else if (strcmp(arg, "--first-shot") == 0) options.firstShotS = atof(value);
+    else if (strcmp(arg, "--shot-interval") == 0) options.shotIntervalS = atof(value);
+    else if (strcmp(arg, "--shot-duration") == 0) options.shotDurationS = atof(value);
+    else if (strcmp(arg, "--shot-flow") == 0) options.shotFlowMlPerS = atof(value);
+    else if (strcmp(arg, "--power-off") == 0) options.powerOffAtS = atof(value);
+    else if (strcmp(arg, "--power-on") == 0) options.powerOnAtS = atof(value);
+    else if (strcmp(arg, "--seconds-per-degree") == 0) options.secondsPerDegree = atof(value);
+    else if (strcmp(arg, "--mode") == 0) { if (!parseControlMode(value, options.mode)) return false; }
+    else if (strcmp(arg, "--estimator") == 0) { if (!parseTemperatureEstimator(value, options.estimator)) return false; }
+    else if (strcmp(arg, "--kp") == 0) options.kp = atof(value);
+    else if (strcmp(arg, "--ki") == 0) options.ki = atof(value);
+    else if (strcmp(arg, "--kd") == 0) options.kd = atof(value);
+    else if (strcmp(arg, "--window") == 0) options.windowMs = atol(value);
+    else if (strcmp(arg, "--heater-power") == 0) options.heaterPowerW = atof(value);
+    else if (strcmp(arg, "--autotune-at") == 0) options.autoTuneAtS = atof(value);
+    else if (strcmp(arg, "--model") == 0) {
+      if (sscanf(value, "%f,%f,%f", &options.model.gainC, &options.model.timeConstantS, &options.model.deadTimeS) != 3) {
+        return false;
+      }
+    }
+    else if (strcmp(arg, "--seed") == 0) options.seed = (unsigned)atoi(value);
+    else if (strcmp(arg, "--csv") == 0) options.csvPath = value;
+    else return false;
+    i++;
+  }
+  return true;
+}
+
+bool isShotActive(const SimOptions& options, double t) {
+  for (int shot = 0; shot < options.shots; shot++) {
+    double start = options.firstShotS + shot * options.shotIntervalS;
+    if (t >= start && t < start + options.shotDurationS) return true;
+  }
+  return false;
+}
+
+// Shot n ends at this time (seconds)
+double shotEndS(const SimOptions& options, int shot) {
+  return options.firstShotS + shot * options.shotIntervalS + options.shotDurationS;
+}
+
+SimResult runScenario(const SimOptions& options, ControlMode mode, FILE* csv) {
+  srand(options.seed);
+
+  // Identity calibration: the model's sensor node is already the actual temperature
+  static const double rawTempsC[2] = {0.0, 100.0};
+  static const double actualTempsC[2] = {0.0, 100.0};
+  TemperatureCalibration calibration(rawTempsC, actualTempsC, 2);
+
+  HeaterControllerConfig config;
+  config.controlMode = mode;
+  config.temperatureEstimator = options.estimator;
+  if (!isnan(options.secondsPerDegree)) config.heaterSecondsPerDegreeC = options.secondsPerDegree;
+  if (!isnan(options.kp)) config.pidGains.kp = options.kp;
+  if (!isnan(options.ki)) config.pidGains.ki = options.ki;
+  if (!isnan(options.kd)) config.pidGains.kd = options.kd;
+  if (options.windowMs > 0) config.controlWindowMs = (unsigned long)options.windowMs;
+
+  BoilerModelParams plant;
+  if (!isnan(options.heaterPowerW)) plant.heaterPowerW = options.heaterPowerW;
+  BoilerModel boiler(plant);
+  boiler.reset(options.startTempC);
+  SimClock clock;
+  SimThermocouple thermocouple(boiler);
+  SimRelay relay(boiler);
+  SimEvents events(clock, options.verbose);
+  HeaterController controller(clock, thermocouple, relay, events, calibration, config);
+  controller.begin();
+  controller.setDesiredTemperature(options.desiredTempC);
+  if (options.model.gainC > 0) {
+    controller.setThermalModel(options.model);
+  }
+
+  const unsigned long durationMs = (unsigned long)(options.hours * 3600.0 * 1000.0);
+  const double band = 0.5;
+  const double dtS = PLANT_STEP_MS / 1000.0;
+  SimResult result;
+  double inBandS = 0.0;
+  double afterWarmupS = 0.0;
+  double absErrorSum = 0.0;
+  int shotsRecovered = 0;
+  double recoverySumS = 0.0;
+  int pendingShot = -1; // Shot whose recovery is being timed
+
+  for (unsigned long t = 0; t < durationMs; t += PLANT_STEP_MS) {
+    double tS = t / 1000.0;
+    if (options.powerOffAtS >= 0 && tS >= options.powerOffAtS &&
+        (options.powerOnAtS < options.powerOffAtS || tS < options.powerOnAtS)) {
+      boiler.setMachinePowered(false);
+    } else {
+      boiler.setMachinePowered(true);
+    }
+    bool shotActive = isShotActive(options, tS);
+    boiler.setWaterFlowMlPerS(shotActive ? options.shotFlowMlPerS : 0.0);
+
+    if (options.autoTuneAtS >= 0 && tS >= options.autoTuneAtS && tS - dtS < options.autoTuneAtS) {
+      controller.startAutoTune();
+    }
+    if (t % CONTROL_PERIOD_MS == 0) {
+      controller.update();
+      ThermalModel identified;
+      if (controller.takeAutoTuneResult(identified)) {
+        result.autoTuneDoneS = tS;
+      }
+    }
+    boiler.step(dtS);
+    clock.advance(PLANT_STEP_MS);
+
+    double errorC = boiler.blockTempC() - options.desiredTempC;
+    if (boiler.isHeating()) result.heaterOnS += dtS;
+    if (result.warmupS < 0 && fabs(errorC) <= band) result.warmupS = tS;
+    if (result.warmupS >= 0) {
+      afterWarmupS += dtS;
+      absErrorSum += fabs(errorC) * dtS;
+      if (fabs(errorC) <= band) inBandS += dtS;
+      if (errorC > result.maxOvershootC) result.maxOvershootC = errorC;
+    }
+
+    // --- Shot recovery ---
+    for (int shot = 0; shot < options.shots; shot++) {
+      double startS = shotEndS(options, shot) - options.shotDurationS;
+      if (tS >= startS && tS - dtS < startS) pendingShot = shot;
+    }
+    if (pendingShot >= 0) {
+      if (-errorC > result.worstShotDropC) result.worstShotDropC = -errorC;
+      double sinceEndS = tS - shotEndS(options, pendingShot);
+      if (sinceEndS >= 0 && fabs(errorC) <= band) {
+        recoverySumS += sinceEndS;
+        shotsRecovered++;
+        if (sinceEndS > result.worstRecoveryS) result.worstRecoveryS = sinceEndS;
+        pendingShot = -1;
+      }
+    }
+
+    if (csv && t % 1000 == 0) {
+      fprintf(csv, "%.0f,%.2f,%.2f,%.2f,%d,%d,%d,%d,%.2f,%.3f\n", tS, boiler.blockTempC(), boiler.sensorTempC(),
+              controller.smoothedTemperature(), relay.isOn() ? 1 : 0, (int)controller.state(),
+              shotActive ? 1 : 0, controller.isPresumedOff() ? 1 : 0, controller.duty(), controller.temperatureRate());
+    }
+  }
+
+  if (afterWarmupS > 0) {
+    result.inBandPercent = 100.0 * inBandS / afterWarmupS;
+    result.meanAbsErrorC = absErrorSum / afterWarmupS;
+  }
+  if (shotsRecovered > 0) result.meanRecoveryS = recoverySumS / shotsRecovered;
+  if (pendingShot >= 0 || shotsRecovered < options.shots) result.worstRecoveryS = -1.0;
+  result.relayToggles = relay.toggles();
+  result.failedHeatAttempts = controller.consecutiveFailedHeatingAttempts();
+  result.presumedOffAtEnd = controller.isPresumedOff();
+  result.autoTuneStatus = controller.autoTuneStatus();
+  result.model = controller.thermalModel();
+  return result;
+}
+
+void printResult(const SimOptions& options, ControlMode mode, const SimResult& result) {
+  printf("controller:           %s\n", controlModeName(mode));
+  printf("estimator:            %s\n", temperatureEstimatorName(options.estimator));
+  if (result.warmupS >= 0) {
+    printf("warm-up (+/-0.5 C):   %.0f s\n", result.warmupS);
+    printf("max overshoot:        %.2f C\n", result.maxOvershootC);
+    printf("time in band:         %.1f %%\n", result.inBandPercent);
+    printf("mean abs error:       %.2f C\n", result.meanAbsErrorC);
+  } else {
+    printf("warm-up:              never reached +/-0.5 C\n");
+  }
+  if (options.shots > 0) {
+    printf("worst shot drop:      %.2f C\n", result.worstShotDropC);
+    if (result.worstRecoveryS >= 0) {
+      printf("shot recovery:        %.0f s mean, %.0f s worst\n", result.meanRecoveryS, result.worstRecoveryS);
+    } else {
+      printf("shot recovery:        not all shots recovered\n");
+    }
+  }
+  printf("relay toggles:        %lu (%.1f / h)\n", result.relayToggles, result.relayToggles / options.hours);
+  printf("heater on time:       %.0f s\n", result.heaterOnS);
+  printf("failed heat attempts: %d\n", result.failedHeatAttempts);
+  printf("presumed off at end:  %s\n", result.presumedOffAtEnd ? "yes" : "no");
+  if (options.autoTuneAtS >= 0) {
+    printf("auto-tune:            %s", autoTuneStatusName(result.autoTuneStatus));
+    if (result.autoTuneDoneS >= 0) printf(" at %.0f s", result.autoTuneDoneS);
+    printf("\n");
+  }
+  printf("thermal model:        gain %.0f C, tau %.0f s, dead time %.0f s (%.2f s/C)\n", result.model.gainC,
+         result.model.timeConstantS, result.model.deadTimeS, 1.0 / result.model.heatingSlopeCPerS());
+}
+
+void printComparison(const SimOptions& options) {
+  static const ControlMode modes[] = {CONTROL_MODE_BURST, CONTROL_MODE_PID, CONTROL_MODE_MPC};
+  printf("%-6s %9s %10s %8s %8s %9s %10s %10s %9s\n", "mode", "warmup_s", "overshoot", "in_band", "mae_c",
+         "shot_drop", "recovery_s", "worst_rec", "toggles");
+  for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+    SimResult result = runScenario(options, modes[i], nullptr);
+    printf("%-6s %9.0f %10.2f %7.1f%% %8.2f %9.2f %10.0f %10.0f %9lu\n", controlModeName(modes[i]), result.warmupS,
+           result.maxOvershootC, result.inBandPercent, result.meanAbsErrorC, result.worstShotDropC,
+           result.meanRecoveryS, result.worstRecoveryS, result.relayToggles);
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "pressure") == 0) {
+    return runPressureFeed(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "filters") == 0) {
+    return runFilterBench(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "fixed") == 0) {
+    return runFixedBench(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "json") == 0) {
+    return runJsonBench(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "stream") == 0) {
+    return runStreamBench(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "telemetry") == 0) {
+    return runTelemetryBench(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "oled") == 0) {
+    return runOledBench(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "weather") == 0) {
+    return runWeatherBench(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "shots") == 0) {
+    return runShotStoreBench(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "history") == 0) {
+    return runHistoryBench(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "capture") == 0) {
+    return runCaptureBench(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "jobs") == 0) {
+    return runJobsBench(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "metrics") == 0) {
+    return runMetricsBench(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "control") == 0) {
+    return runControlBench(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "estimator") == 0) {
+    return runEstimatorBench(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "calibration") == 0) {
+    return runCalibrationBench(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "profile") == 0) {
+    return runProfileBench(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "flow") == 0) {
+    return runFlowBench(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "watchdog") == 0) {
+    return runWatchdogBench(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "thermocouple") == 0) {
+    return runThermocoupleBench(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "standby") == 0) {
+    return runStandbyBench(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "tasks") == 0) {
+    return runTasksBench(argc - 1, argv + 1);
+  }
+  SimOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+  if (options.compare) {
+    printComparison(options);
+    return 0;
+  }
+
+  FILE* csv = nullptr;
+  if (options.csvPath) {
+    csv = fopen(options.csvPath, "w");
+    if (!csv) {
+      perror(options.csvPath);
+      return 1;
+    }
+    fprintf(csv, "time_s,block_c,sensor_c,smoothed_c,relay,state,shot,presumed_off,duty,rate_c_s\n");
+  }
+
+  std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+  SimResult result = runScenario(options, options.mode, csv);
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  if (csv) fclose(csv);
+
+  printf("simulated:            %.2f h (%.0fx real time)\n", options.hours,
+         wallS > 0 ? options.hours * 3600.0 / wallS : 0.0);
+  printResult(options, options.mode, result);
+  return 0;
+}
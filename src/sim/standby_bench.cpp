@@ -0,0 +1,367 @@
+// Low-power standby on a virtual clock: the firmware's four task loops (control, sensing,
+// watchdog, network jobs) replayed at 1 ms resolution around the heater controller, the
+// safety watchdog and the thermoblock model (lib/BoilerSim), with the task periods from
+// src/main.cpp. One timeline, run twice:
+//
+//   0-300 s     machine on at the set point
+//   300 s       main switch off; presumed off once the boiler has cooled (a few minutes)
+//   1800 s      a web request during standby
+//   2400 s      main switch on again, detected from the Kalman dT/dt
+//
+// "before" is the behaviour without StandbyPolicy: every task at its normal period, the
+// thermocouple read every 500 ms, only the network jobs stretched on presumed off (web
+// every 20 ms). "low power" follows StandbyPolicy (lib/PowerStandby) like the firmware.
+// Reported: wake-ups per minute of each task loop and thermocouple reads per minute in
+// standby (from presumed off to the web request) and with the machine on. Checked: low
+// power only while presumed off, at most a third of the wake-ups of "before", thermocouple
+// reads at standbyReadIntervalMs, the web request back at full rate within a standby
+// control period plus a web poll and low power again after the hold, the power-on
+// detected at most POWER_ON_SLACK_S later than with full-rate reads, no false power-on
+// detection and no watchdog trip. Typical use:
+//
+//   .pio/build/native/program standby
+//   .pio/build/native/program standby --seed 3 --verbose
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "BoilerModel.h"
+#include "HeaterController.h"
+#include "HeaterWatchdog.h"
+#include "JobScheduler.h"
+#include "SimPlatform.h"
+#include "StandbyPolicy.h"
+#include "bench_report.h"
+#include "standby_bench.h"
+
+namespace {
+
+// Task periods (src/main.cpp)
+const unsigned long CONTROL_TASK_PERIOD_MS = 100;
+const unsigned long SENSING_TASK_PERIOD_MS = 20;
+const unsigned long WATCHDOG_TASK_PERIOD_MS = 50;
+const unsigned long CONTROL_TASK_STANDBY_PERIOD_MS = 500;
+const unsigned long SENSING_TASK_STANDBY_PERIOD_MS = 200;
+const unsigned long WATCHDOG_TASK_STANDBY_PERIOD_MS = 250;
+// Network job periods (src/main.cpp)
+const uint32_t WEB_JOB_MS = 5;
+const uint32_t WEB_JOB_STANDBY_MS = 100;
+const uint32_t FORMER_WEB_JOB_STANDBY_MS = 20; // Presumed-off web period before StandbyPolicy
+const uint32_t COMMAND_JOB_MS = 100;
+const uint32_t HISTORY_JOB_MS = 100;
+const uint32_t SHOT_LOG_JOB_MS = 50;
+const uint32_t LED_JOB_MS = 50;
+const uint32_t LED_JOB_STANDBY_MS = 500;
+const uint32_t STATUS_LED_JOB_MS = 5000;
+const uint32_t OLED_JOB_MS = 100;
+const uint32_t OLED_JOB_STANDBY_MS = 1000;
+const uint32_t STANDBY_JOB_MS = 1000;
+
+const unsigned long PLANT_STEP_MS = 10;
+const double DESIRED_TEMP_C = 90.0;
+const double POWER_OFF_S = 300.0;
+const double WEB_REQUEST_S = 1800.0;
+const double POWER_ON_S = 2400.0;
+const double END_S = 2700.0;
+const double MACHINE_ON_FROM_S = 60.0;  // Machine-on window, after the warm-up
+const double POWER_ON_SLACK_S = 10.0;   // Detection delay allowed on top of full-rate reads
+const double STANDBY_WAKEUP_RATIO = 3.0; // "before" / "low power" standby wake-ups, at least
+
+struct StandbyBenchOptions {
+  unsigned seed = 1;
+  bool verbose = false;
+};
+
+void printUsage() {
+  printf("usage: program standby [options]\n"
+         "  --seed N           sensor noise seed (default 1)\n"
+         "  --verbose          print the controller and watchdog log\n");
+}
+
+bool parseOptions(int argc, char** argv, StandbyBenchOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (strcmp(arg, "--verbose") == 0) {
+      options.verbose = true;
+      continue;
+    }
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--seed") == 0) options.seed = (unsigned)strtoul(value, nullptr, 10);
+    else return false;
+    i++;
+  }
+  return true;
+}
+
+// Thermocouple reads, counted.
+class CountingSensor : public TemperatureSensor {
+public:
+  explicit CountingSensor(TemperatureSensor& sensor) : _sensor(sensor), _reads(0) {}
+
+  double readCelsius() override {
+    _reads++;
+    return _sensor.readCelsius();
+  }
+  unsigned long reads() const { return _reads; }
+
+private:
+  TemperatureSensor& _sensor;
+  unsigned long _reads;
+};
+
+enum TaskLoop { TASK_CONTROL, TASK_SENSING, TASK_WATCHDOG, TASK_NETWORK, TASK_COUNT };
+const char* const TASK_NAMES[TASK_COUNT] = {"control", "sensing", "watchdog", "network"};
+
+// --- Network task: the standby-relevant jobs, runtimes left out ---
+unsigned long virtualMs = 0;
+uint32_t virtualMicros() { return (uint32_t)(virtualMs * 1000); }
+
+enum JobIndex { WEB, COMMANDS, HISTORY, SHOT_LOG, LED, STATUS_LED, OLED, STANDBY, JOB_COUNT };
+const char* const JOB_NAMES[JOB_COUNT] = {"web", "commands", "history", "shot_log", "led", "status_led", "oled", "standby"};
+const uint32_t JOB_PERIODS[JOB_COUNT] = {WEB_JOB_MS, COMMAND_JOB_MS, HISTORY_JOB_MS, SHOT_LOG_JOB_MS, LED_JOB_MS,
+                                         STATUS_LED_JOB_MS, OLED_JOB_MS, STANDBY_JOB_MS};
+
+struct NetworkState {
+  JobScheduler* jobs = nullptr;
+  uint8_t jobIds[JOB_COUNT];
+  StandbyPolicy* policy = nullptr;
+  const HeaterController* controller = nullptr;
+  bool usePolicy = false;
+  bool standby = false;        // networkStandby
+  bool requestPending = false; // A web request waiting for the next web job
+  double requestHandledS = NAN;
+};
+NetworkState network;
+
+void applyPowerLevel(bool lowPower) {
+  network.standby = lowPower;
+  uint32_t webStandbyMs = network.usePolicy ? WEB_JOB_STANDBY_MS : FORMER_WEB_JOB_STANDBY_MS;
+  network.jobs->setPeriod(network.jobIds[WEB], lowPower ? webStandbyMs : WEB_JOB_MS);
+  network.jobs->setPeriod(network.jobIds[LED], lowPower ? LED_JOB_STANDBY_MS : LED_JOB_MS);
+  network.jobs->setPeriod(network.jobIds[OLED], lowPower ? OLED_JOB_STANDBY_MS : OLED_JOB_MS);
+}
+
+void webJob(uint32_t nowMs) {
+  if (!network.requestPending) return;
+  network.requestPending = false;
+  network.requestHandledS = nowMs / 1000.0;
+  if (network.usePolicy) {
+    network.policy->wake(nowMs); // wakeFromStandby()
+    if (network.standby) applyPowerLevel(false);
+  }
+}
+void idleJob(uint32_t nowMs) { (void)nowMs; }
+void standbyJob(uint32_t nowMs) {
+  (void)nowMs;
+  bool lowPower = network.usePolicy ? network.policy->isLowPower() : network.controller->isPresumedOff();
+  if (lowPower != network.standby) applyPowerLevel(lowPower);
+}
+const JobFunction JOB_FUNCTIONS[JOB_COUNT] = {webJob, idleJob, idleJob, idleJob, idleJob, idleJob, idleJob, standbyJob};
+
+// --- One run of the timeline ---
+struct WindowCounts {
+  double fromS = NAN;
+  double untilS = NAN;
+  unsigned long wakeups[TASK_COUNT] = {0, 0, 0, 0};
+  unsigned long reads = 0;
+
+  double minutes() const { return (untilS - fromS) / 60.0; }
+  double perMinute(unsigned long count) const { return minutes() > 0.0 ? count / minutes() : 0.0; }
+  unsigned long total() const { return wakeups[0] + wakeups[1] + wakeups[2] + wakeups[3]; }
+};
+
+struct RunResult {
+  WindowCounts machineOn;
+  WindowCounts standby;          // Presumed off to the web request
+  double presumedOffS = NAN;
+  double lowPowerS = NAN;        // First entry
+  bool lowPowerOutsideStandby = false;
+  double fullRateS = NAN;        // Web request to every task back at its normal period
+  double lowPowerAgainS = NAN;   // Web request handled to low power again
+  double powerOnDetectedS = NAN; // Main switch on to presumed off cleared
+  int falsePowerOns = 0;         // Presumed off cleared before the switch went on
+  uint32_t trips = 0;
+  uint32_t entries = 0;
+  uint32_t webWakes = 0;
+};
+
+RunResult runTimeline(bool usePolicy, const StandbyBenchOptions& options) {
+  srand(options.seed);
+  static const double rawTempsC[2] = {0.0, 100.0}; // Identity: the model node is the actual temperature
+  static const double actualTempsC[2] = {0.0, 100.0};
+  TemperatureCalibration calibration(rawTempsC, actualTempsC, 2);
+
+  BoilerModel boiler;
+  boiler.reset(DESIRED_TEMP_C);
+  SimClock clock;
+  SimThermocouple thermocouple(boiler);
+  CountingSensor sensor(thermocouple);
+  SimRelay relay(boiler);
+  SimEvents events(clock, options.verbose);
+  HeaterWatchdog watchdog(clock, relay, events);
+  InterlockedRelay interlockedRelay(watchdog);
+  WatchedSensor watchedSensor(watchdog, sensor);
+  HeaterController controller(clock, watchedSensor, interlockedRelay, events, calibration);
+  controller.begin();
+  controller.setDesiredTemperature(DESIRED_TEMP_C);
+  watchdog.begin();
+  StandbyPolicy policy;
+
+  virtualMs = 0;
+  JobScheduler jobs(virtualMicros);
+  network = NetworkState();
+  network.jobs = &jobs;
+  network.policy = &policy;
+  network.controller = &controller;
+  network.usePolicy = usePolicy;
+  for (int j = 0; j < JOB_COUNT; j++) network.jobIds[j] = jobs.add(JOB_NAMES[j], JOB_PERIODS[j], JOB_FUNCTIONS[j]);
+
+  RunResult result;
+  result.machineOn.fromS = MACHINE_ON_FROM_S;
+  result.machineOn.untilS = POWER_OFF_S;
+  unsigned long nextWakeMs[TASK_COUNT] = {0, 0, 0, 0};
+  bool wasPresumedOff = false;
+  bool webRequested = false;
+  const unsigned long endMs = (unsigned long)(END_S * 1000.0);
+  for (unsigned long t = 0; t < endMs; t++) {
+    double tS = t / 1000.0;
+    bool powered = tS < POWER_OFF_S || tS >= POWER_ON_S;
+    boiler.setMachinePowered(powered);
+    bool lowPower = policy.isLowPower();
+
+    if (!webRequested && tS >= WEB_REQUEST_S) {
+      webRequested = true;
+      network.requestPending = true;
+      result.standby.untilS = tS;
+    }
+
+    bool woke[TASK_COUNT] = {false, false, false, false};
+    unsigned long readsBefore = sensor.reads();
+    if (t >= nextWakeMs[TASK_WATCHDOG]) {
+      watchdog.tick();
+      nextWakeMs[TASK_WATCHDOG] += lowPower ? WATCHDOG_TASK_STANDBY_PERIOD_MS : WATCHDOG_TASK_PERIOD_MS;
+      woke[TASK_WATCHDOG] = true;
+    }
+    if (t >= nextWakeMs[TASK_CONTROL]) {
+      controller.update();
+      watchdog.setStandby(controller.isPresumedOff());
+      if (usePolicy) controller.setLowPower(policy.update(t, controller.isPresumedOff()));
+      nextWakeMs[TASK_CONTROL] += policy.isLowPower() ? CONTROL_TASK_STANDBY_PERIOD_MS : CONTROL_TASK_PERIOD_MS;
+      woke[TASK_CONTROL] = true;
+    }
+    if (t >= nextWakeMs[TASK_SENSING]) {
+      nextWakeMs[TASK_SENSING] += lowPower ? SENSING_TASK_STANDBY_PERIOD_MS : SENSING_TASK_PERIOD_MS;
+      woke[TASK_SENSING] = true;
+    }
+    if (t >= nextWakeMs[TASK_NETWORK]) {
+      jobs.runDue(t);
+      uint32_t waitMs = jobs.msUntilNext(t);
+      nextWakeMs[TASK_NETWORK] = t + (waitMs > 0 ? waitMs : 1);
+      woke[TASK_NETWORK] = true;
+    }
+
+    // Presumed off and low-power transitions
+    bool presumedOff = controller.isPresumedOff();
+    if (presumedOff && !wasPresumedOff && isnan(result.presumedOffS)) {
+      result.presumedOffS = tS;
+      result.standby.fromS = tS;
+    }
+    if (!presumedOff && wasPresumedOff) {
+      if (tS < POWER_ON_S) result.falsePowerOns++;
+      else if (isnan(result.powerOnDetectedS)) result.powerOnDetectedS = tS - POWER_ON_S;
+    }
+    wasPresumedOff = presumedOff;
+    if (policy.isLowPower()) {
+      if (isnan(result.lowPowerS)) result.lowPowerS = tS;
+      if (!presumedOff) result.lowPowerOutsideStandby = true;
+      if (!isnan(network.requestHandledS) && isnan(result.lowPowerAgainS)) {
+        result.lowPowerAgainS = tS - network.requestHandledS;
+      }
+    }
+    if (webRequested && isnan(result.fullRateS) && !policy.isLowPower() && !network.standby &&
+        nextWakeMs[TASK_CONTROL] - t <= CONTROL_TASK_PERIOD_MS && nextWakeMs[TASK_SENSING] - t <= SENSING_TASK_PERIOD_MS &&
+        nextWakeMs[TASK_WATCHDOG] - t <= WATCHDOG_TASK_PERIOD_MS) {
+      result.fullRateS = tS - WEB_REQUEST_S;
+    }
+
+    // Window counts
+    WindowCounts* window = nullptr;
+    if (tS >= result.machineOn.fromS && tS < result.machineOn.untilS) window = &result.machineOn;
+    else if (!isnan(result.standby.fromS) && !webRequested) window = &result.standby;
+    if (window) {
+      for (int k = 0; k < TASK_COUNT; k++) window->wakeups[k] += woke[k] ? 1 : 0;
+      window->reads += sensor.reads() - readsBefore;
+    }
+
+    if ((t + 1) % PLANT_STEP_MS == 0) boiler.step(PLANT_STEP_MS / 1000.0);
+    clock.advance(1);
+    virtualMs++;
+  }
+  result.trips = watchdog.totalTrips();
+  result.entries = policy.entries();
+  result.webWakes = policy.webWakes();
+  return result;
+}
+
+void printWindow(const char* label, const WindowCounts& window) {
+  printf("  %-22s", label);
+  for (int k = 0; k < TASK_COUNT; k++) printf(" %9.0f", window.perMinute(window.wakeups[k]));
+  printf(" %9.0f %9.1f\n", window.perMinute(window.total()), window.perMinute(window.reads));
+}
+
+} // namespace
+
+int runStandbyBench(int argc, char** argv) {
+  StandbyBenchOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+
+  RunResult before = runTimeline(false, options);
+  RunResult low = runTimeline(true, options);
+
+  printf("wake-ups per minute (thermocouple reads per minute in the last column)\n");
+  printf("  %-22s", "");
+  for (int k = 0; k < TASK_COUNT; k++) printf(" %9s", TASK_NAMES[k]);
+  printf(" %9s %9s\n", "total", "reads");
+  printWindow("machine on, before", before.machineOn);
+  printWindow("machine on, low power", low.machineOn);
+  printWindow("standby, before", before.standby);
+  printWindow("standby, low power", low.standby);
+  double beforeStandby = before.standby.perMinute(before.standby.total());
+  double lowStandby = low.standby.perMinute(low.standby.total());
+  printf("standby: %.1fx fewer wake-ups (%.0f s measured from presumed off at %.0f s)\n",
+         lowStandby > 0.0 ? beforeStandby / lowStandby : 0.0, low.standby.untilS - low.standby.fromS, low.presumedOffS);
+  printf("web request: full rate after %.3f s, low power again %.1f s after it was handled (hold %.0f s)\n",
+         low.fullRateS, low.lowPowerAgainS, StandbyPolicyConfig().wakeHoldMs / 1000.0);
+  printf("power on detected after %.1f s with low-power reads, %.1f s with full-rate reads\n", low.powerOnDetectedS,
+         before.powerOnDetectedS);
+  printf("low-power entries %u, web wakes %u, watchdog trips %u / %u (before)\n", (unsigned)low.entries,
+         (unsigned)low.webWakes, (unsigned)low.trips, (unsigned)before.trips);
+
+  bool ok = true;
+  ok &= benchCheck(!isnan(low.lowPowerS) && low.lowPowerS >= low.presumedOffS, "low power entered with presumed off");
+  ok &= benchCheck(!low.lowPowerOutsideStandby, "low power only while presumed off");
+  ok &= benchCheck(isnan(before.lowPowerS), "no low power without the policy");
+  ok &= benchCheck(low.standby.minutes() >= 5.0, "at least 5 minutes of standby measured");
+  ok &= benchCheck(beforeStandby >= STANDBY_WAKEUP_RATIO * lowStandby, "standby wake-ups reduced");
+  double standbyReadsPerMinute = 60000.0 / HeaterControllerConfig().standbyReadIntervalMs;
+  ok &= benchCheck(fabs(low.standby.perMinute(low.standby.reads) - standbyReadsPerMinute) <= 1.0,
+              "thermocouple read at the standby interval");
+  ok &= benchCheck(fabs(low.machineOn.total() - (double)before.machineOn.total()) <= TASK_COUNT,
+              "machine-on wake-ups unchanged");
+  ok &= benchCheck(low.fullRateS <= (CONTROL_TASK_STANDBY_PERIOD_MS + WEB_JOB_STANDBY_MS) / 1000.0,
+              "full rate within a standby control period and a web poll");
+  double holdS = StandbyPolicyConfig().wakeHoldMs / 1000.0;
+  ok &= benchCheck(low.lowPowerAgainS >= holdS && low.lowPowerAgainS <= holdS + CONTROL_TASK_PERIOD_MS / 1000.0,
+              "low power again after the hold");
+  ok &= benchCheck(low.entries == 2 && low.webWakes == 1, "two low-power entries, one web wake");
+  ok &= benchCheck(!isnan(before.powerOnDetectedS) && !isnan(low.powerOnDetectedS), "power on detected");
+  ok &= benchCheck(low.powerOnDetectedS <= before.powerOnDetectedS + POWER_ON_SLACK_S, "power-on detection delay");
+  ok &= benchCheck(low.falsePowerOns == 0 && before.falsePowerOns == 0, "no false power-on detection");
+  ok &= benchCheck(low.trips == 0 && before.trips == 0, "no watchdog trip");
+  return benchResult("standby", ok);
+}
@@ -0,0 +1,8 @@
+#ifndef STANDBY_BENCH_H
+#define STANDBY_BENCH_H
+
+// `program standby [options]`: task wake-ups in presumed-off standby with and without the
+// low-power level, web request wake and power-on detection on the slower reads.
+int runStandbyBench(int argc, char** argv);
+
+#endif // STANDBY_BENCH_H
@@ -0,0 +1,307 @@
+// Host tools for the Server-Sent Events telemetry stream (lib/EventStream).
+//
+// Simulation (default): the firmware's EventStreamHub serves viewers over simulated TCP
+// links (send buffer the size of lwIP's, drained at the link rate) in virtual time, with the
+// firmware's frame interval and network loop period. Reports per viewer the delivered frame
+// rate, latency from publish to arrival and skipped frames, and checks that a slow or
+// stalled viewer does not cost the others any frames.
+//
+// Live client (--connect): opens the stream on the device, parses the frames and reports
+// frame rate, gaps and latency. Latency is relative: the device clock ("t" in every frame)
+// is aligned on the fastest frame seen, so the figures are delay above the best case.
+//
+//   .pio/build/native/program stream
+//   .pio/build/native/program stream --connect 192.168.50.96 --seconds 30
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <errno.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#include "EventStreamHub.h"
+#include "stream_bench.h"
+
+namespace {
+
+// Same values as the firmware (TELEMETRY_* in main.cpp)
+const unsigned long FRAME_INTERVAL_MS = 50;
+const size_t MAX_CLIENTS = 4;
+const size_t FRAME_CAPACITY = 512;
+const unsigned long STALL_TIMEOUT_MS = 5000;
+const unsigned long NETWORK_LOOP_MS = 2; // Network task iteration (plus the work it does)
+const size_t TCP_SEND_BUFFER_BYTES = 5744; // lwIP TCP_SND_BUF in the Arduino-ESP32 build
+
+struct StreamOptions {
+  double seconds = 60.0;
+  const char* host = nullptr;
+  int port = 81;
+};
+
+void printUsage() {
+  printf("usage: program stream [options]\n"
+         "  --seconds S        simulated / measured duration (default 60)\n"
+         "  --connect HOST     measure the live stream of a device instead of simulating\n"
+         "  --port N           stream port for --connect (default 81)\n");
+}
+
+bool parseOptions(int argc, char** argv, StreamOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--seconds") == 0) options.seconds = atof(value);
+    else if (strcmp(arg, "--connect") == 0) options.host = value;
+    else if (strcmp(arg, "--port") == 0) options.port = atoi(value);
+    else return false;
+    i++;
+  }
+  return options.seconds > 0.0;
+}
+
+// Frame time ("t") of an SSE event, -1 if it has none (the HTTP header).
+long frameTime(const std::string& frame) {
+  size_t at = frame.find("\"t\":");
+  return at == std::string::npos ? -1 : atol(frame.c_str() + at + 4);
+}
+
+struct LatencyStats {
+  std::vector<double> samples;
+
+  void add(double value) { samples.push_back(value); }
+  double percentile(double p) {
+    if (samples.empty()) return 0.0;
+    std::sort(samples.begin(), samples.end());
+    return samples[std::min(samples.size() - 1, (size_t)(p * samples.size()))];
+  }
+  double mean() const {
+    double sum = 0.0;
+    for (size_t i = 0; i < samples.size(); i++) sum += samples[i];
+    return samples.empty() ? 0.0 : sum / samples.size();
+  }
+};
+
+// --- Simulated viewer link ---
+// The socket send buffer takes bytes while it has room and drains at bytesPerSecond; a frame
+// arrives when its last byte has left the buffer. stallAtMs stops the draining (a viewer
+// whose network vanished without closing the connection).
+struct SimLink {
+  const char* name;
+  double bytesPerSecond;
+  long stallAtMs;
+  bool closed = false;
+  size_t buffered = 0;
+  double drainCredit = 0.0;
+  unsigned long long accepted = 0;
+  unsigned long long delivered = 0;
+  std::string partial;                                   // Current frame, to read its time
+  std::deque<std::pair<unsigned long long, long>> ends;  // (byte offset of the frame end, frame time)
+  unsigned long framesDelivered = 0;
+  LatencyStats latencyMs;
+
+  SimLink(const char* n, double rate, long stall) : name(n), bytesPerSecond(rate), stallAtMs(stall) {}
+
+  void step(unsigned long nowMs, unsigned long dtMs) {
+    if (closed || (stallAtMs >= 0 && (long)nowMs >= stallAtMs)) return;
+    drainCredit += bytesPerSecond * dtMs / 1000.0;
+    size_t drained = std::min(buffered, (size_t)drainCredit);
+    drainCredit -= drained;
+    if (buffered == 0) drainCredit = 0.0;
+    buffered -= drained;
+    delivered += drained;
+    while (!ends.empty() && ends.front().first <= delivered) {
+      if (ends.front().second >= 0) {
+        framesDelivered++;
+        latencyMs.add((double)nowMs - ends.front().second);
+      }
+      ends.pop_front();
+    }
+  }
+};
+
+class SimTransport {
+public:
+  SimTransport() : _link(nullptr) {}
+  explicit SimTransport(SimLink* link) : _link(link) {}
+
+  int send(const char* data, size_t length) {
+    if (!_link || _link->closed) return -1;
+    size_t room = TCP_SEND_BUFFER_BYTES - _link->buffered;
+    size_t taken = std::min(room, length);
+    for (size_t i = 0; i < taken; i++) {
+      _link->partial += data[i];
+      if (data[i] == '\n' && _link->partial.size() >= 2 && _link->partial[_link->partial.size() - 2] == '\n') {
+        _link->ends.push_back(std::make_pair(_link->accepted + i + 1, frameTime(_link->partial)));
+        _link->partial.clear();
+      }
+    }
+    _link->buffered += taken;
+    _link->accepted += taken;
+    return (int)taken;
+  }
+  void close() {
+    if (_link) _link->closed = true;
+  }
+
+private:
+  SimLink* _link;
+};
+
+typedef EventStreamHub<SimTransport, MAX_CLIENTS, FRAME_CAPACITY> SimHub;
+
+// Frame with the same fields and size as publishTelemetryFrame() in main.cpp.
+size_t formatFrame(char* frame, unsigned long nowMs) {
+  double shotS = nowMs / 1000.0;
+  return (size_t)snprintf(frame, FRAME_CAPACITY,
+                          "data: {\"t\":%lu,\"temperature\":93.4,\"pressure\":%.2f,\"max_observed_pressure\":9.1,"
+                          "\"relay_status\":\"ON\",\"desired_temp\":94.0,\"controller_mode\":\"burst\",\"heater_duty\":0.00,"
+                          "\"autotune_status\":\"off\",\"shot_duration\":%lu,\"is_temp_plot_paused\":false,"
+                          "\"is_pressure_plot_paused\":false,\"early_cutoff_count\":0}\n\n",
+                          nowMs, 9.0 - 0.01 * (nowMs % 1000), (unsigned long)(shotS * 1000) % 30000);
+}
+
+int runSimulation(const StreamOptions& options) {
+  const char* header = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n\r\nretry: 2000\n\n";
+  // Frames are ~330 bytes, 20 Hz = ~6.6 KB/s per viewer.
+  std::vector<SimLink> links;
+  links.push_back(SimLink("lan", 1000000.0, -1));
+  links.push_back(SimLink("wifi", 50000.0, -1));
+  links.push_back(SimLink("slow (3 KB/s)", 3000.0, -1));
+  links.push_back(SimLink("stalls at 10 s", 50000.0, 10000));
+  SimHub hub(STALL_TIMEOUT_MS);
+  for (size_t i = 0; i < links.size(); i++) hub.accept(SimTransport(&links[i]), header, strlen(header), 0);
+  SimLink extra("fifth viewer", 50000.0, -1);
+  bool fifthRefused = !hub.accept(SimTransport(&extra), header, strlen(header), 0);
+
+  char frame[FRAME_CAPACITY];
+  unsigned long durationMs = (unsigned long)(options.seconds * 1000.0);
+  unsigned long published = 0;
+  unsigned long lastFrameMs = 0;
+  for (unsigned long nowMs = 0; nowMs <= durationMs; nowMs += NETWORK_LOOP_MS) {
+    for (size_t i = 0; i < links.size(); i++) links[i].step(nowMs, NETWORK_LOOP_MS);
+    hub.service(nowMs);
+    if (nowMs - lastFrameMs >= FRAME_INTERVAL_MS) {
+      lastFrameMs = nowMs;
+      hub.publish(frame, formatFrame(frame, nowMs), nowMs);
+      published++;
+    }
+  }
+
+  printf("%lu frames published in %.0f s (%.1f Hz), %zu viewers, fifth viewer %s\n", published, options.seconds,
+         published / options.seconds, links.size(), fifthRefused ? "refused" : "ACCEPTED");
+  printf("%-16s %8s %8s %9s %9s %9s %s\n", "viewer", "frames", "rate Hz", "skipped", "lat ms", "p95 ms", "state");
+  bool ok = fifthRefused;
+  for (size_t i = 0; i < links.size(); i++) {
+    SimHub::ClientStats stats = hub.stats(i);
+    SimLink& link = links[i];
+    printf("%-16s %8lu %8.1f %9lu %9.1f %9.1f %s\n", link.name, link.framesDelivered, link.framesDelivered / options.seconds,
+           stats.framesSkipped, link.latencyMs.mean(), link.latencyMs.percentile(0.95), stats.active ? "connected" : "disconnected");
+  }
+  // Viewers with enough bandwidth must get every frame no matter what the others do
+  for (size_t i = 0; i < 2; i++) ok = ok && links[i].framesDelivered + 1 >= published && hub.stats(i).framesSkipped == 0;
+  ok = ok && links[2].framesDelivered > 0 && hub.stats(2).active; // Slow viewer: fewer frames, still served
+  ok = ok && !hub.stats(3).active;                                  // Stalled viewer: dropped after the timeout
+  printf("back-pressure check: %s (disconnects: %lu)\n", ok ? "ok" : "FAILED", hub.disconnects());
+  return ok ? 0 : 1;
+}
+
+// --- Live client ---
+int connectTo(const char* host, int port) {
+  char service[16];
+  snprintf(service, sizeof(service), "%d", port);
+  addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* result = nullptr;
+  if (getaddrinfo(host, service, &hints, &result) != 0) return -1;
+  int fd = -1;
+  for (addrinfo* ai = result; ai && fd < 0; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+  freeaddrinfo(result);
+  return fd;
+}
+
+int runLiveClient(const StreamOptions& options) {
+  int fd = connectTo(options.host, options.port);
+  if (fd < 0) {
+    printf("cannot connect to %s:%d\n", options.host, options.port);
+    return 1;
+  }
+  std::string request = std::string("GET / HTTP/1.1\r\nHost: ") + options.host + "\r\nAccept: text/event-stream\r\n\r\n";
+  if (send(fd, request.data(), request.size(), 0) < 0) {
+    close(fd);
+    return 1;
+  }
+  timeval timeout = {1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  typedef std::chrono::steady_clock SteadyClock;
+  SteadyClock::time_point start = SteadyClock::now();
+  std::vector<std::pair<double, long>> arrivals; // (local ms, device ms)
+  std::string pending;
+  char buffer[2048];
+  double elapsedMs = 0.0;
+  while (elapsedMs < options.seconds * 1000.0) {
+    ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+    elapsedMs = std::chrono::duration<double, std::milli>(SteadyClock::now() - start).count();
+    if (received == 0) break; // Closed by the device
+    if (received < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) continue;
+      break;
+    }
+    pending.append(buffer, (size_t)received);
+    size_t end;
+    while ((end = pending.find("\n\n")) != std::string::npos) {
+      long t = frameTime(pending.substr(0, end));
+      if (t >= 0) arrivals.push_back(std::make_pair(elapsedMs, t));
+      pending.erase(0, end + 2);
+    }
+  }
+  close(fd);
+
+  if (arrivals.size() < 2) {
+    printf("%zu frames received, nothing to measure\n", arrivals.size());
+    return 1;
+  }
+  double bestOffset = arrivals[0].first - arrivals[0].second;
+  for (size_t i = 1; i < arrivals.size(); i++) bestOffset = std::min(bestOffset, arrivals[i].first - arrivals[i].second);
+  LatencyStats latency;
+  LatencyStats gaps;
+  unsigned long missing = 0;
+  for (size_t i = 0; i < arrivals.size(); i++) {
+    latency.add(arrivals[i].first - arrivals[i].second - bestOffset);
+    if (i == 0) continue;
+    gaps.add(arrivals[i].first - arrivals[i - 1].first);
+    long deviceGap = arrivals[i].second - arrivals[i - 1].second;
+    if (deviceGap > (long)(FRAME_INTERVAL_MS * 3 / 2)) missing += (unsigned long)(deviceGap / FRAME_INTERVAL_MS) - 1; // Skipped by back-pressure
+  }
+  double spanS = (arrivals.back().first - arrivals.front().first) / 1000.0;
+  printf("%zu frames in %.1f s: %.1f Hz, about %lu frames skipped by the device\n", arrivals.size(), spanS,
+         (arrivals.size() - 1) / spanS, missing);
+  printf("arrival gap ms: mean %.1f, p95 %.1f, max %.1f\n", gaps.mean(), gaps.percentile(0.95), gaps.percentile(1.0));
+  printf("latency above best ms: mean %.1f, p95 %.1f, max %.1f\n", latency.mean(), latency.percentile(0.95), latency.percentile(1.0));
+  return 0;
+}
+
+} // namespace
+
+int runStreamBench(int argc, char** argv) {
+  StreamOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+  return options.host ? runLiveClient(options) : runSimulation(options);
+}
@@ -0,0 +1,8 @@
+#ifndef STREAM_BENCH_H
+#define STREAM_BENCH_H
+
+// `program stream [options]`: telemetry stream fan-out with simulated viewers, or a live
+// client measuring frame rate and latency against the device (--connect).
+int runStreamBench(int argc, char** argv);
+
+#endif // STREAM_BENCH_H
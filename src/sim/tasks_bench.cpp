@@ -0,0 +1,657 @@
+// The task split on a simulated two-core FreeRTOS scheduler. The firmware's watchdog, control
+// and sensing tasks run on core 1, the network and weather tasks on core 0, with the cores,
+// priorities and periods from src/main.cpp: fixed-priority preemption, a 1 ms tick that
+// releases vTaskDelayUntil() and vTaskDelay() wake-ups and time-slices equal priorities,
+// interrupts on both cores and the WiFi driver's task on core 0. Every activation runs a
+// modelled runtime with random jitter. The control task steps the real heater controller, the
+// watchdog task the real safety watchdog and the network task the real job scheduler, so a
+// late control cycle reaches the boiler model (lib/BoilerSim) as well. Scenarios:
+//
+//   nominal   a web request about once a second, WiFi mostly idle
+//   flood     back-to-back 20-60 ms web responses, the WiFi driver and its interrupts at
+//             about a third of core 0, a 300 ms TLS weather fetch every 10 s
+//   stall     a weather request waiting out its 5 s timeout every 20 s
+//   flash     the flood plus a flash sector erase every 5 s, which stops the other core
+//             while the cache is off
+//
+// The former single loop() replays the same workload on core 1: WiFi, web, weather, the heater
+// update, the blocking ADC read and the full OLED redraw polled in turn (`last = now`).
+// Reported per cycle: the worst release-to-start latency, the worst deviation of the start
+// interval from the period and the deadline misses (control and watchdog: done by the next
+// release; sensing: within the pressure DMA's headroom), plus core 0's load, the web responses
+// served and the peak boiler temperature. Checked for the task split: no deadline miss,
+// control latency and period jitter within CONTROL_JITTER_BOUND_US (plus the erase in the
+// flash scenario), core 0 saturated by the flood, web responses still served and no watchdog
+// trip; and that the flood and the stall push the former loop past the bound, so the load is
+// heavy enough to matter. Runtimes are estimates for a 240 MHz ESP32; GET /metrics on the
+// device shows the real ones. Typical use:
+//
+//   pio run -e native && .pio/build/native/program tasks
+//   .pio/build/native/program tasks --scenario flood --seconds 600 --seed 2
+#include <math.h>
+#include <random>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "BoilerModel.h"
+#include "HeaterController.h"
+#include "HeaterWatchdog.h"
+#include "JobScheduler.h"
+#include "SimPlatform.h"
+#include "bench_report.h"
+#include "tasks_bench.h"
+
+namespace {
+
+// Cores, priorities and periods (src/main.cpp)
+const int CONTROL_TASK_CORE = 1;
+const int SENSING_TASK_CORE = 1;
+const int NETWORK_TASK_CORE = 0;
+const int WIFI_TASK_CORE = 0;       // ESP-IDF's WiFi driver task
+const int LOOP_TASK_CORE = 1;       // Arduino's loopTask, the former runtime
+const int WATCHDOG_TASK_CORE = 1;
+const int WEATHER_TASK_CORE = 0;
+const unsigned CONTROL_TASK_PRIORITY = 5;
+const unsigned SENSING_TASK_PRIORITY = 4;
+const unsigned NETWORK_TASK_PRIORITY = 1;
+const unsigned WIFI_TASK_PRIORITY = 23;
+const unsigned LOOP_TASK_PRIORITY = 1;
+const unsigned WATCHDOG_TASK_PRIORITY = 6;
+const unsigned WEATHER_TASK_PRIORITY = 1;
+const uint32_t CONTROL_TASK_PERIOD_MS = 100;
+const uint32_t SENSING_TASK_PERIOD_MS = 20;
+const uint32_t WATCHDOG_TASK_PERIOD_MS = 50;
+const uint32_t WEATHER_TASK_POLL_MS = 1000;
+const uint32_t SENSING_DEADLINE_MS = 500; // The pressure DMA buffer's headroom
+// Network job periods (src/main.cpp)
+const uint32_t WEB_JOB_MS = 5;
+const uint32_t COMMAND_JOB_MS = 100;
+const uint32_t HISTORY_JOB_MS = 100;
+const uint32_t SHOT_LOG_JOB_MS = 50;
+const uint32_t LED_JOB_MS = 50;
+const uint32_t STATUS_LED_JOB_MS = 5000;
+const uint32_t OLED_JOB_MS = 100;
+const uint32_t STANDBY_JOB_MS = 1000;
+
+const uint64_t TICK_US = 1000;                 // configTICK_RATE_HZ 1000
+const uint32_t TICK_ISR_US = 3;
+const uint32_t WEATHER_TIMEOUT_MS = 5000;      // The weather request's timeout
+const uint32_t FLASH_ERASE_US = 45000;         // 4 KB sector erase, typical
+const uint32_t FLASH_ERASE_INTERVAL_MS = 5000;
+const uint32_t FORMER_OLED_REDRAW_US = 23000;  // Full 1 KB frame at 400 kHz (program oled)
+const uint32_t FORMER_OLED_INTERVAL_MS = 500;
+const uint32_t FORMER_ADC_READ_US = 1500;      // getStableAdcValue()'s blocking sample burst
+
+const uint64_t CONTROL_JITTER_BOUND_US = 250; // Control latency and period jitter, task split
+const double FLOOD_CORE0_LOAD = 0.9;          // Core 0 busy at least this much in a flood
+const double DESIRED_TEMP_C = 90.0;
+const unsigned long PLANT_STEP_MS = 10;
+
+struct Scenario {
+  const char* name;
+  bool floodWeb;          // Every web job pass serves a response
+  bool heavyWifi;         // WiFi driver task and interrupts busy
+  uint32_t weatherEveryMs; // 0: no weather fetch during the run
+  uint32_t weatherBlockMs; // Waiting on the socket per fetch
+  uint32_t weatherCpuUs;   // TLS and JSON per fetch
+  bool flashErase;
+};
+
+const Scenario SCENARIOS[] = {
+    {"nominal", false, false, 0, 0, 0, false},
+    {"flood", true, true, 10000, 200, 300000, false},
+    {"stall", false, false, 20000, WEATHER_TIMEOUT_MS, 2000, false},
+    {"flash", true, true, 10000, 200, 300000, true},
+};
+const size_t SCENARIO_COUNT = sizeof(SCENARIOS) / sizeof(SCENARIOS[0]);
+
+struct TasksOptions {
+  const char* scenario = "all";
+  double seconds = 120.0;
+  unsigned seed = 1;
+};
+
+void printUsage() {
+  printf("usage: program tasks [options]\n"
+         "  --scenario NAME    nominal, flood, stall, flash or all (default all)\n"
+         "  --seconds S        simulated time per scenario and runtime (default 120)\n"
+         "  --seed N           runtime and interrupt jitter seed (default 1)\n");
+}
+
+bool parseOptions(int argc, char** argv, TasksOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--scenario") == 0) options.scenario = value;
+    else if (strcmp(arg, "--seconds") == 0) options.seconds = atof(value);
+    else if (strcmp(arg, "--seed") == 0) options.seed = (unsigned)strtoul(value, nullptr, 10);
+    else return false;
+    i++;
+  }
+  return options.seconds >= 1.0;
+}
+
+// --- Tasks, activations and measured cycles ---
+enum TaskId { TASK_WIFI, TASK_WATCHDOG, TASK_CONTROL, TASK_SENSING, TASK_NETWORK, TASK_WEATHER, TASK_LOOP, TASK_COUNT };
+
+struct TaskDef {
+  const char* name;
+  int core;
+  unsigned priority;
+};
+const TaskDef TASKS[TASK_COUNT] = {
+    {"wifi", WIFI_TASK_CORE, WIFI_TASK_PRIORITY},         {"watchdog", WATCHDOG_TASK_CORE, WATCHDOG_TASK_PRIORITY},
+    {"control", CONTROL_TASK_CORE, CONTROL_TASK_PRIORITY}, {"sensing", SENSING_TASK_CORE, SENSING_TASK_PRIORITY},
+    {"network", NETWORK_TASK_CORE, NETWORK_TASK_PRIORITY}, {"weather", WEATHER_TASK_CORE, WEATHER_TASK_PRIORITY},
+    {"loop", LOOP_TASK_CORE, LOOP_TASK_PRIORITY}};
+
+enum Cycle { CYCLE_NONE = -1, CYCLE_CONTROL, CYCLE_SENSING, CYCLE_WATCHDOG, CYCLE_COUNT };
+const uint32_t CYCLE_PERIODS_MS[CYCLE_COUNT] = {CONTROL_TASK_PERIOD_MS, SENSING_TASK_PERIOD_MS, WATCHDOG_TASK_PERIOD_MS};
+const uint32_t CYCLE_DEADLINES_MS[CYCLE_COUNT] = {CONTROL_TASK_PERIOD_MS, SENSING_DEADLINE_MS, WATCHDOG_TASK_PERIOD_MS};
+
+// An activation is a list of segments: CPU work, or a wait that blocks the task.
+enum SegmentKind { SEGMENT_WORK, SEGMENT_BLOCK, SEGMENT_CONTROL_STEP, SEGMENT_WATCHDOG_TICK, SEGMENT_FLASH_ERASE };
+
+struct Segment {
+  SegmentKind kind;
+  uint32_t us;
+  int cycle;          // Measured cycle this segment is, or CYCLE_NONE
+  uint64_t releaseUs; // When the cycle became due
+};
+
+struct TaskState {
+  bool enabled = false;
+  bool ready = false;
+  uint64_t wakeUs = 0;
+  std::vector<Segment> segments;
+  size_t next = 0;      // Current segment
+  uint32_t leftUs = 0;  // Of the current segment
+  bool started = false; // The current segment has had the CPU
+  uint64_t lastRanUs = 0;
+  uint64_t lastWakeTick = 0; // vTaskDelayUntil()'s reference
+};
+
+struct CycleStats {
+  unsigned long cycles = 0;
+  uint64_t maxLatencyUs = 0;
+  uint64_t maxJitterUs = 0; // |start interval - period|
+  unsigned long misses = 0;
+  uint64_t lastStartUs = 0;
+};
+
+struct Sim {
+  const Scenario* scenario = nullptr;
+  bool taskSplit = true;
+  uint64_t nowUs = 0;
+  std::mt19937 random;
+  TaskState tasks[TASK_COUNT];
+  int current[2] = {-1, -1};
+  bool sliceExpired[2] = {false, false};
+  uint32_t isrLeftUs[2] = {0, 0};
+  uint64_t nextIsrUs[2] = {0, 0};
+  uint64_t busyUs[2] = {0, 0};
+  CycleStats cycles[CYCLE_COUNT];
+  std::vector<Segment>* pending = nullptr; // Where the workload functions add segments
+  unsigned long webResponses = 0;
+  uint64_t nextRequestUs = 0;
+  uint64_t nextWeatherUs = 0;
+  uint64_t nextEraseUs = 0;
+  uint64_t loopOledDueUs = 0;
+  uint64_t loopDueUs[CYCLE_COUNT] = {0, 0, 0}; // Former loop: `last + interval`
+  // Plant
+  BoilerModel* boiler = nullptr;
+  SimClock* clock = nullptr;
+  HeaterController* controller = nullptr;
+  HeaterWatchdog* watchdog = nullptr;
+  JobScheduler* jobs = nullptr;
+  unsigned long plantMs = 0;
+  double maxC = -INFINITY;
+};
+Sim sim;
+
+uint32_t between(uint32_t lo, uint32_t hi) { return lo + sim.random() % (hi - lo + 1); }
+uint32_t simMicros() { return (uint32_t)sim.nowUs; }
+
+void addSegment(SegmentKind kind, uint32_t us, int cycle = CYCLE_NONE, uint64_t releaseUs = 0) {
+  Segment segment = {kind, us > 0 ? us : 1, cycle, releaseUs};
+  sim.pending->push_back(segment);
+}
+void addWork(uint32_t us) { addSegment(SEGMENT_WORK, us); }
+
+// --- Workload ---
+uint32_t controlRuntimeUs() {
+  // MAX6675 read and the heater update; now and then a Serial log line
+  return sim.random() % 500 == 0 ? 1500 : between(150, 400);
+}
+
+void addFlashEraseIfDue() {
+  if (!sim.scenario->flashErase || sim.nowUs < sim.nextEraseUs) return;
+  addSegment(SEGMENT_FLASH_ERASE, FLASH_ERASE_US);
+  sim.nextEraseUs += FLASH_ERASE_INTERVAL_MS * 1000ull;
+}
+
+// A due weather fetch waits on the socket, then runs TLS and JSON.
+void addWeatherIfDue() {
+  if (sim.scenario->weatherEveryMs == 0 || sim.nowUs < sim.nextWeatherUs) return;
+  if (sim.scenario->weatherBlockMs > 0) addSegment(SEGMENT_BLOCK, sim.scenario->weatherBlockMs * 1000);
+  addWork(sim.scenario->weatherCpuUs);
+  sim.nextWeatherUs += sim.scenario->weatherEveryMs * 1000ull;
+}
+
+// Requests arrive about once a second, or are always waiting in a flood.
+void webJob(uint32_t nowMs) {
+  (void)nowMs;
+  if (sim.scenario->floodWeb) {
+    addWork(between(20000, 60000)); // /history, /capture.csv, the page, back to back
+    sim.webResponses++;
+  } else if (sim.nowUs >= sim.nextRequestUs) {
+    addWork(between(20000, 50000));
+    sim.webResponses++;
+    sim.nextRequestUs = sim.nowUs + between(500000, 1500000);
+  } else {
+    addWork(between(40, 80)); // Idle handleClient()
+  }
+}
+void commandJob(uint32_t nowMs) { (void)nowMs; addWork(5); }
+void historyJob(uint32_t nowMs) { (void)nowMs; addWork(60); }
+void shotLogJob(uint32_t nowMs) {
+  (void)nowMs;
+  addWork(20);
+  addFlashEraseIfDue(); // Shot log and NVS writes
+}
+void ledJob(uint32_t nowMs) { (void)nowMs; addWork(10); }
+void statusLedJob(uint32_t nowMs) { (void)nowMs; addWork(5); }
+void oledJob(uint32_t nowMs) { (void)nowMs; addWork(between(1500, 3000)); } // Dirty regions over I2C
+void standbyJob(uint32_t nowMs) { (void)nowMs; addWork(5); }
+
+enum JobIndex { WEB, COMMANDS, HISTORY, SHOT_LOG, LED, STATUS_LED, OLED, STANDBY, JOB_COUNT };
+const char* const JOB_NAMES[JOB_COUNT] = {"web", "commands", "history", "shot_log", "led", "status_led", "oled", "standby"};
+const uint32_t JOB_PERIODS[JOB_COUNT] = {WEB_JOB_MS, COMMAND_JOB_MS, HISTORY_JOB_MS, SHOT_LOG_JOB_MS, LED_JOB_MS,
+                                         STATUS_LED_JOB_MS, OLED_JOB_MS, STANDBY_JOB_MS};
+const JobFunction JOB_FUNCTIONS[JOB_COUNT] = {webJob, commandJob, historyJob, shotLogJob, ledJob, statusLedJob, oledJob, standbyJob};
+
+// One pass of the former loop(): everything polled in turn.
+void addLoopPass() {
+  addWork(between(20, 40));                // WiFi state, OTA
+  webJob((uint32_t)(sim.nowUs / 1000));    // server.handleClient()
+  addWeatherIfDue();                       // getWeatherData(), blocking
+  addWork(70);                             // History, LEDs
+  addFlashEraseIfDue();                    // NVS writes
+  if (sim.nowUs >= sim.loopOledDueUs) {
+    addWork(FORMER_OLED_REDRAW_US);
+    sim.loopOledDueUs = sim.nowUs + FORMER_OLED_INTERVAL_MS * 1000ull;
+  }
+  if (sim.nowUs >= sim.loopDueUs[CYCLE_CONTROL]) {
+    addSegment(SEGMENT_CONTROL_STEP, controlRuntimeUs(), CYCLE_CONTROL, sim.loopDueUs[CYCLE_CONTROL]);
+  }
+  if (sim.nowUs >= sim.loopDueUs[CYCLE_SENSING]) {
+    addSegment(SEGMENT_WORK, FORMER_ADC_READ_US, CYCLE_SENSING, sim.loopDueUs[CYCLE_SENSING]);
+  }
+}
+
+// --- Plant ---
+void syncPlant() {
+  unsigned long nowMs = (unsigned long)(sim.nowUs / 1000);
+  while (sim.plantMs + PLANT_STEP_MS <= nowMs) {
+    sim.boiler->step(PLANT_STEP_MS / 1000.0);
+    sim.plantMs += PLANT_STEP_MS;
+  }
+  sim.clock->advance(nowMs - sim.clock->now());
+  if (sim.boiler->sensorTempC() > sim.maxC) sim.maxC = sim.boiler->sensorTempC();
+}
+
+// --- Scheduler ---
+Segment& currentSegment(int id) { return sim.tasks[id].segments[sim.tasks[id].next]; }
+
+void beginActivation(int id) {
+  TaskState& task = sim.tasks[id];
+  task.segments.clear();
+  task.next = 0;
+  sim.pending = &task.segments;
+  switch (id) {
+  case TASK_WIFI:
+    addWork(sim.scenario->heavyWifi ? between(100, 250) : between(20, 80));
+    break;
+  case TASK_WATCHDOG:
+    addSegment(SEGMENT_WATCHDOG_TICK, between(5, 15), CYCLE_WATCHDOG, task.wakeUs);
+    break;
+  case TASK_CONTROL:
+    addSegment(SEGMENT_CONTROL_STEP, controlRuntimeUs(), CYCLE_CONTROL, task.wakeUs);
+    break;
+  case TASK_SENSING:
+    addSegment(SEGMENT_WORK, between(150, 600), CYCLE_SENSING, task.wakeUs); // DMA drain, decimation
+    break;
+  case TASK_NETWORK:
+    addWork(5);
+    sim.jobs->runDue((uint32_t)(sim.nowUs / 1000));
+    break;
+  case TASK_WEATHER:
+    addWork(20);
+    addWeatherIfDue();
+    break;
+  case TASK_LOOP:
+    addLoopPass();
+    break;
+  }
+  task.leftUs = task.segments[0].us;
+  task.started = false;
+}
+
+// The activation is done: when the task runs next.
+void endActivation(int id) {
+  TaskState& task = sim.tasks[id];
+  task.ready = false;
+  uint64_t tick = sim.nowUs / TICK_US;
+  switch (id) {
+  case TASK_WIFI:
+    task.wakeUs = sim.nowUs + (sim.scenario->heavyWifi ? between(200, 600) : between(2000, 6000));
+    break;
+  case TASK_WATCHDOG:
+  case TASK_CONTROL:
+  case TASK_SENSING: {
+    // vTaskDelayUntil(): returns at once when the wake time has already passed
+    uint32_t periodMs = id == TASK_WATCHDOG ? WATCHDOG_TASK_PERIOD_MS
+                        : id == TASK_CONTROL ? CONTROL_TASK_PERIOD_MS
+                                             : SENSING_TASK_PERIOD_MS;
+    task.lastWakeTick += periodMs * 1000 / TICK_US;
+    task.wakeUs = task.lastWakeTick * TICK_US;
+    break;
+  }
+  case TASK_NETWORK: {
+    uint32_t waitMs = sim.jobs->msUntilNext((uint32_t)(sim.nowUs / 1000));
+    task.wakeUs = (tick + (waitMs > 0 ? waitMs : 1) * 1000 / TICK_US) * TICK_US;
+    break;
+  }
+  case TASK_WEATHER:
+    task.wakeUs = (tick + WEATHER_TASK_POLL_MS * 1000 / TICK_US) * TICK_US;
+    break;
+  case TASK_LOOP:
+    task.wakeUs = sim.nowUs; // loop() is called again at once
+    break;
+  }
+}
+
+void startSegment(int id) {
+  TaskState& task = sim.tasks[id];
+  Segment& segment = currentSegment(id);
+  task.started = true;
+  if (segment.cycle != CYCLE_NONE) {
+    CycleStats& stats = sim.cycles[segment.cycle];
+    uint64_t periodUs = CYCLE_PERIODS_MS[segment.cycle] * 1000ull;
+    uint64_t latencyUs = sim.nowUs - segment.releaseUs;
+    if (latencyUs > stats.maxLatencyUs) stats.maxLatencyUs = latencyUs;
+    if (stats.cycles > 0) {
+      uint64_t intervalUs = sim.nowUs - stats.lastStartUs;
+      uint64_t jitterUs = intervalUs > periodUs ? intervalUs - periodUs : periodUs - intervalUs;
+      if (jitterUs > stats.maxJitterUs) stats.maxJitterUs = jitterUs;
+    }
+    stats.cycles++;
+    stats.lastStartUs = sim.nowUs;
+    if (!sim.taskSplit) sim.loopDueUs[segment.cycle] = sim.nowUs + periodUs; // `last = now`
+  }
+  if (segment.kind == SEGMENT_CONTROL_STEP) {
+    syncPlant();
+    sim.controller->update();
+    sim.watchdog->setStandby(sim.controller->isPresumedOff());
+  } else if (segment.kind == SEGMENT_WATCHDOG_TICK) {
+    syncPlant();
+    sim.watchdog->tick();
+  }
+}
+
+void finishSegment(int id) {
+  TaskState& task = sim.tasks[id];
+  Segment& segment = currentSegment(id);
+  if (segment.cycle != CYCLE_NONE &&
+      sim.nowUs > segment.releaseUs + CYCLE_DEADLINES_MS[segment.cycle] * 1000ull) {
+    sim.cycles[segment.cycle].misses++;
+  }
+  task.next++;
+  if (task.next < task.segments.size()) {
+    task.leftUs = currentSegment(id).us;
+    task.started = false;
+  } else {
+    endActivation(id);
+  }
+}
+
+bool isErasing(int id) {
+  return id >= 0 && sim.tasks[id].started && currentSegment(id).kind == SEGMENT_FLASH_ERASE;
+}
+
+// Highest priority ready task on the core; equal priorities take turns on the tick.
+int dispatch(int core) {
+  for (;;) {
+    int current = sim.current[core];
+    if (isErasing(current)) return current; // The scheduler is suspended during the erase
+    int best = -1;
+    for (int id = 0; id < TASK_COUNT; id++) {
+      const TaskState& task = sim.tasks[id];
+      if (!task.enabled || !task.ready || TASKS[id].core != core) continue;
+      if (best < 0 || TASKS[id].priority > TASKS[best].priority) {
+        best = id;
+      } else if (TASKS[id].priority == TASKS[best].priority) {
+        bool keepBest = !sim.sliceExpired[core] && best == current;
+        bool takeId = (!sim.sliceExpired[core] && id == current) || sim.tasks[id].lastRanUs < sim.tasks[best].lastRanUs;
+        if (!keepBest && takeId) best = id;
+      }
+    }
+    sim.sliceExpired[core] = false;
+    sim.current[core] = best;
+    if (best < 0) return -1;
+    TaskState& task = sim.tasks[best];
+    if (currentSegment(best).kind == SEGMENT_BLOCK) {
+      // Waits on a socket: sleeps, then carries on with the next segment
+      task.ready = false;
+      task.wakeUs = sim.nowUs + currentSegment(best).us;
+      task.next++;
+      task.leftUs = currentSegment(best).us;
+      task.started = false;
+      continue;
+    }
+    return best;
+  }
+}
+
+uint32_t isrIntervalUs(int core) {
+  if (core == 1) return between(5000, 15000); // Pressure DMA, GPIO
+  return sim.scenario->heavyWifi ? between(100, 500) : between(1000, 5000);
+}
+uint32_t isrDurationUs(int core) {
+  if (core == 1) return between(10, 30);
+  return sim.scenario->heavyWifi ? between(5, 20) : between(5, 15);
+}
+
+struct RunResult {
+  CycleStats cycles[CYCLE_COUNT];
+  double coreLoad[2] = {0.0, 0.0};
+  unsigned long webResponses = 0;
+  uint32_t trips = 0;
+  double maxC = NAN;
+};
+
+RunResult runScenario(const Scenario& scenario, bool taskSplit, const TasksOptions& options) {
+  static const double rawTempsC[2] = {0.0, 100.0}; // Identity: the model node is the actual temperature
+  static const double actualTempsC[2] = {0.0, 100.0};
+  TemperatureCalibration calibration(rawTempsC, actualTempsC, 2);
+
+  BoilerModel boiler;
+  boiler.reset(DESIRED_TEMP_C);
+  SimClock clock;
+  SimThermocouple thermocouple(boiler);
+  SimRelay relay(boiler);
+  SimEvents events(clock, false);
+  HeaterWatchdog watchdog(clock, relay, events);
+  InterlockedRelay interlockedRelay(watchdog);
+  WatchedSensor watchedSensor(watchdog, thermocouple);
+  HeaterController controller(clock, watchedSensor, interlockedRelay, events, calibration);
+  controller.begin();
+  watchdog.begin();
+  controller.setDesiredTemperature(DESIRED_TEMP_C);
+
+  sim = Sim();
+  sim.scenario = &scenario;
+  sim.taskSplit = taskSplit;
+  sim.random.seed(options.seed);
+  srand(options.seed);
+  sim.boiler = &boiler;
+  sim.clock = &clock;
+  sim.controller = &controller;
+  sim.watchdog = &watchdog;
+  JobScheduler jobs(simMicros);
+  sim.jobs = &jobs;
+  for (int j = 0; j < JOB_COUNT; j++) jobs.add(JOB_NAMES[j], JOB_PERIODS[j], JOB_FUNCTIONS[j]);
+
+  // The former runtime had only loopTask next to the WiFi driver
+  sim.tasks[TASK_WIFI].enabled = true;
+  sim.tasks[TASK_LOOP].enabled = !taskSplit;
+  for (int id = TASK_WATCHDOG; id <= TASK_WEATHER; id++) sim.tasks[id].enabled = taskSplit;
+  for (int id = 0; id < TASK_COUNT; id++) sim.tasks[id].segments.reserve(16);
+  for (int core = 0; core < 2; core++) sim.nextIsrUs[core] = isrIntervalUs(core);
+
+  const uint64_t endUs = (uint64_t)(options.seconds * 1e6);
+  uint64_t nextTickUs = 0;
+  while (sim.nowUs < endUs) {
+    if (sim.nowUs >= nextTickUs) {
+      for (int core = 0; core < 2; core++) {
+        sim.isrLeftUs[core] += TICK_ISR_US;
+        sim.sliceExpired[core] = true;
+      }
+      nextTickUs += TICK_US;
+    }
+    for (int core = 0; core < 2; core++) {
+      if (sim.nowUs < sim.nextIsrUs[core]) continue;
+      sim.isrLeftUs[core] += isrDurationUs(core);
+      sim.nextIsrUs[core] = sim.nowUs + isrIntervalUs(core);
+    }
+    for (int id = 0; id < TASK_COUNT; id++) {
+      TaskState& task = sim.tasks[id];
+      if (!task.enabled || task.ready || task.wakeUs > sim.nowUs) continue;
+      task.ready = true;
+      if (task.next >= task.segments.size()) beginActivation(id);
+    }
+
+    int running[2];
+    for (int core = 0; core < 2; core++) running[core] = dispatch(core);
+    // A flash erase turns the cache off: the other core stalls, interrupts wait
+    int erasingCore = isErasing(running[0]) ? 0 : isErasing(running[1]) ? 1 : -1;
+    for (int core = 0; core < 2; core++) {
+      bool getsCpu = erasingCore < 0 ? sim.isrLeftUs[core] == 0 : core == erasingCore;
+      if (getsCpu && running[core] >= 0 && !sim.tasks[running[core]].started) startSegment(running[core]);
+    }
+    if (erasingCore < 0) erasingCore = isErasing(running[0]) ? 0 : isErasing(running[1]) ? 1 : -1;
+
+    uint64_t dt = endUs - sim.nowUs;
+    if (nextTickUs - sim.nowUs < dt) dt = nextTickUs - sim.nowUs;
+    for (int core = 0; core < 2; core++) {
+      if (sim.nextIsrUs[core] - sim.nowUs < dt) dt = sim.nextIsrUs[core] - sim.nowUs;
+    }
+    for (int id = 0; id < TASK_COUNT; id++) {
+      const TaskState& task = sim.tasks[id];
+      if (task.enabled && !task.ready && task.wakeUs - sim.nowUs < dt) dt = task.wakeUs - sim.nowUs;
+    }
+    bool inIsr[2];
+    for (int core = 0; core < 2; core++) {
+      inIsr[core] = erasingCore < 0 && sim.isrLeftUs[core] > 0;
+      if (erasingCore >= 0 && core != erasingCore) continue;
+      if (inIsr[core] && sim.isrLeftUs[core] < dt) dt = sim.isrLeftUs[core];
+      else if (!inIsr[core] && running[core] >= 0 && sim.tasks[running[core]].leftUs < dt) dt = sim.tasks[running[core]].leftUs;
+    }
+
+    bool consumed[2] = {false, false};
+    for (int core = 0; core < 2; core++) {
+      if (erasingCore >= 0 && core != erasingCore) continue;
+      if (inIsr[core]) {
+        sim.isrLeftUs[core] -= (uint32_t)dt;
+      } else if (running[core] >= 0) {
+        sim.tasks[running[core]].leftUs -= (uint32_t)dt;
+        consumed[core] = true;
+      } else {
+        continue;
+      }
+      sim.busyUs[core] += dt;
+    }
+    sim.nowUs += dt;
+    for (int core = 0; core < 2; core++) {
+      if (!consumed[core]) continue;
+      TaskState& task = sim.tasks[running[core]];
+      task.lastRanUs = sim.nowUs;
+      if (task.leftUs == 0) finishSegment(running[core]);
+    }
+  }
+  syncPlant();
+
+  RunResult result;
+  for (int c = 0; c < CYCLE_COUNT; c++) result.cycles[c] = sim.cycles[c];
+  for (int core = 0; core < 2; core++) result.coreLoad[core] = (double)sim.busyUs[core] / endUs;
+  result.webResponses = sim.webResponses;
+  result.trips = watchdog.totalTrips();
+  result.maxC = sim.maxC;
+  return result;
+}
+
+void printCycle(const CycleStats& stats) {
+  if (stats.cycles == 0) {
+    printf(" %9s %9s %6s", "-", "-", "-");
+    return;
+  }
+  printf(" %9llu %9llu %6lu", (unsigned long long)stats.maxLatencyUs, (unsigned long long)stats.maxJitterUs,
+         stats.misses);
+}
+
+} // namespace
+
+int runTasksBench(int argc, char** argv) {
+  TasksOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+
+  printf("worst latency and period jitter in us, deadline misses per cycle; core 0 load, web responses\n");
+  printf("%-8s %-7s %9s %9s %6s %9s %9s %6s %9s %9s %6s %6s %6s %6s\n", "scenario", "runtime", "ctl_lat", "ctl_jit",
+         "ctl_dl", "sns_lat", "sns_jit", "sns_dl", "wdg_lat", "wdg_jit", "wdg_dl", "core0", "web", "max_c");
+  bool ok = true;
+  bool any = false;
+  for (size_t s = 0; s < SCENARIO_COUNT; s++) {
+    const Scenario& scenario = SCENARIOS[s];
+    if (!scenarioSelected(options.scenario, scenario.name)) continue;
+    any = true;
+    RunResult results[2] = {runScenario(scenario, true, options), runScenario(scenario, false, options)};
+    for (int r = 0; r < 2; r++) {
+      const RunResult& result = results[r];
+      printf("%-8s %-7s", scenario.name, r == 0 ? "tasks" : "loop");
+      for (int c = 0; c < CYCLE_COUNT; c++) printCycle(result.cycles[c]);
+      printf(" %5.0f%% %6lu %6.1f\n", result.coreLoad[0] * 100.0, result.webResponses, result.maxC);
+    }
+
+    const RunResult& tasks = results[0];
+    const RunResult& former = results[1];
+    const CycleStats& control = tasks.cycles[CYCLE_CONTROL];
+    uint64_t boundUs = CONTROL_JITTER_BOUND_US + (scenario.flashErase ? FLASH_ERASE_US : 0);
+    unsigned long expectedCycles = (unsigned long)(options.seconds * 1000.0 / CONTROL_TASK_PERIOD_MS);
+    const char* name = scenario.name;
+    ok &= benchCheck(control.cycles + 1 >= expectedCycles, "control cycle every period", name);
+    ok &= benchCheck(control.misses == 0 && tasks.cycles[CYCLE_SENSING].misses == 0 &&
+                         tasks.cycles[CYCLE_WATCHDOG].misses == 0,
+                     "no deadline miss", name);
+    ok &= benchCheck(control.maxLatencyUs <= boundUs, "control latency bounded", name);
+    ok &= benchCheck(control.maxJitterUs <= boundUs, "control period jitter bounded", name);
+    ok &= benchCheck(tasks.webResponses > 0, "web responses served", name);
+    ok &= benchCheck(tasks.trips == 0, "no watchdog trip", name);
+    if (scenario.floodWeb) ok &= benchCheck(tasks.coreLoad[0] >= FLOOD_CORE0_LOAD, "core 0 saturated", name);
+    if (scenario.floodWeb || scenario.weatherBlockMs >= WEATHER_TIMEOUT_MS) {
+      ok &= benchCheck(former.cycles[CYCLE_CONTROL].maxLatencyUs > CONTROL_JITTER_BOUND_US,
+                       "the load delays the former loop", name);
+    }
+  }
+  if (!any) {
+    printUsage();
+    return 1;
+  }
+  return benchResult("tasks", ok);
+}
@@ -0,0 +1,8 @@
+#ifndef TASKS_BENCH_H
+#define TASKS_BENCH_H
+
+// `program tasks [options]`: control, sensing and network tasks on a simulated two-core
+// scheduler with injected load; deadlines and control jitter against the former loop().
+int runTasksBench(int argc, char** argv);
+
+#endif // TASKS_BENCH_H
@@ -0,0 +1,302 @@
+// Host checks for the binary telemetry frame (lib/TelemetryFrame).
+//
+// Round trip: random and edge-case series (empty, single point, large time jumps, millis()
+// wrap, negative and extreme values, every decimals setting) are encoded and decoded, and
+// every point must come back exactly (times) or within half a quantization step (values).
+// Comparison: a full history (2 x HISTORY_SIZE points, as /history and /history.bin send
+// it) encoded as JSON with JsonWriter and as a binary frame: size and encode throughput.
+//
+//   .pio/build/native/program telemetry
+//   .pio/build/native/program telemetry --write history.bin   # frame for decoder tests
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "JsonWriter.h"
+#include "TelemetryFrame.h"
+#include "telemetry_bench.h"
+
+namespace {
+
+const int HISTORY_SIZE = 90; // Points per series, as the former firmware rings
+const unsigned long HISTORY_SAMPLE_INTERVAL_MS = 1000;
+
+struct TelemetryOptions {
+  int rounds = 2000;
+  unsigned long iterations = 20000;
+  const char* writePath = nullptr;
+};
+
+void printUsage() {
+  printf("usage: program telemetry [options]\n"
+         "  --rounds N         random round-trip frames (default 2000)\n"
+         "  --iterations N     encodes per size/speed measurement (default 20000)\n"
+         "  --write FILE       also write the full-history frame to FILE\n");
+}
+
+bool parseOptions(int argc, char** argv, TelemetryOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--rounds") == 0) options.rounds = atoi(value);
+    else if (strcmp(arg, "--iterations") == 0) options.iterations = strtoul(value, nullptr, 10);
+    else if (strcmp(arg, "--write") == 0) options.writePath = value;
+    else return false;
+    i++;
+  }
+  return options.rounds >= 0 && options.iterations > 0;
+}
+
+struct Point {
+  uint32_t timeMs;
+  float value;
+};
+
+struct TestSeries {
+  uint8_t id;
+  uint8_t decimals;
+  std::vector<Point> points;
+};
+
+size_t encode(const std::vector<TestSeries>& series, uint32_t baseTimeMs, uint8_t* buffer, size_t capacity, bool& overflow) {
+  TelemetryFrameEncoder frame(buffer, capacity, baseTimeMs, (uint8_t)series.size());
+  for (size_t s = 0; s < series.size(); s++) {
+    frame.beginSeries(series[s].id, series[s].decimals, (uint32_t)series[s].points.size());
+    for (size_t i = 0; i < series[s].points.size(); i++) frame.time(series[s].points[i].timeMs);
+    for (size_t i = 0; i < series[s].points.size(); i++) frame.value(series[s].points[i].value);
+  }
+  overflow = frame.overflow();
+  return frame.length();
+}
+
+// Decodes and compares; prints the first mismatch.
+bool roundTrip(const std::vector<TestSeries>& series, uint32_t baseTimeMs) {
+  size_t totalPoints = 0;
+  for (size_t s = 0; s < series.size(); s++) totalPoints += series[s].points.size();
+  std::vector<uint8_t> buffer(TelemetryFrame::maxEncodedSize(series.size(), totalPoints));
+  bool overflow;
+  size_t length = encode(series, baseTimeMs, buffer.data(), buffer.size(), overflow);
+  if (overflow) {
+    printf("  overflow within maxEncodedSize (%zu bytes)\n", buffer.size());
+    return false;
+  }
+
+  TelemetryFrameDecoder decoder(buffer.data(), length);
+  if (!decoder.valid() || decoder.baseTimeMs() != baseTimeMs || decoder.seriesCount() != series.size()) {
+    printf("  bad header\n");
+    return false;
+  }
+  for (size_t s = 0; s < series.size(); s++) {
+    TelemetryFrameDecoder::Series info;
+    if (!decoder.nextSeries(info) || info.id != series[s].id || info.decimals != series[s].decimals ||
+        info.count != series[s].points.size()) {
+      printf("  series %zu header mismatch\n", s);
+      return false;
+    }
+    for (size_t i = 0; i < info.count; i++) {
+      uint32_t timeMs;
+      if (!decoder.time(timeMs) || timeMs != series[s].points[i].timeMs) {
+        printf("  series %zu time %zu: %u != %u\n", s, i, timeMs, series[s].points[i].timeMs);
+        return false;
+      }
+    }
+    double halfStep = 0.5 / pow(10.0, series[s].decimals);
+    for (size_t i = 0; i < info.count; i++) {
+      float value;
+      float expected = series[s].points[i].value;
+      if (!decoder.value(value) || fabs((double)value - expected) > halfStep + fabs(expected) * 1e-6) {
+        printf("  series %zu value %zu: %f != %f\n", s, i, value, expected);
+        return false;
+      }
+    }
+  }
+  if (!decoder.atEnd()) {
+    printf("  trailing bytes\n");
+    return false;
+  }
+  // Every truncation must be detected rather than read past the end
+  for (size_t cut = 0; cut < length; cut++) {
+    TelemetryFrameDecoder truncated(buffer.data(), cut);
+    bool complete = truncated.valid();
+    for (size_t s = 0; complete && s < series.size(); s++) {
+      TelemetryFrameDecoder::Series info;
+      complete = truncated.nextSeries(info);
+      uint32_t timeMs;
+      float value;
+      for (size_t i = 0; complete && i < info.count; i++) complete = truncated.time(timeMs);
+      for (size_t i = 0; complete && i < info.count; i++) complete = truncated.value(value);
+    }
+    if (complete) {
+      printf("  truncation to %zu of %zu bytes not detected\n", cut, length);
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<TestSeries> randomFrame(std::mt19937& rng, uint32_t& baseTimeMs) {
+  std::uniform_int_distribution<int> seriesCount(0, 3);
+  std::uniform_int_distribution<int> pointCount(0, 120);
+  std::uniform_int_distribution<int> decimals(0, TelemetryFrame::MAX_DECIMALS);
+  std::uniform_int_distribution<uint32_t> anyTime(0, 0xFFFFFFFFu);
+  std::uniform_int_distribution<int> gap(0, 5000);
+  std::normal_distribution<double> step(0.0, 2.0);
+  baseTimeMs = anyTime(rng); // Includes bases just after a millis() wrap
+  std::vector<TestSeries> frame(seriesCount(rng));
+  for (size_t s = 0; s < frame.size(); s++) {
+    frame[s].id = (uint8_t)(s + 1);
+    frame[s].decimals = (uint8_t)decimals(rng);
+    int count = pointCount(rng);
+    double limit = 200000.0 / pow(10.0, frame[s].decimals); // Quantized values up to +/-2e5
+    uint32_t timeMs = baseTimeMs - (uint32_t)count * 1000u - (uint32_t)gap(rng);
+    double value = (rng() % 2 ? 1.0 : -1.0) * (rng() % 1000) / 10.0;
+    for (int i = 0; i < count; i++) {
+      timeMs += (uint32_t)gap(rng) + (rng() % 50 == 0 ? 3600000u : 0u); // Occasional long pause
+      value += step(rng);
+      if (rng() % 40 == 0) value = -value;
+      value = fmax(-limit, fmin(limit, value));
+      frame[s].points.push_back({timeMs, (float)value});
+    }
+  }
+  return frame;
+}
+
+bool runRoundTrips(int rounds) {
+  // Edge cases first
+  std::vector<std::vector<TestSeries>> cases;
+  cases.push_back(std::vector<TestSeries>());                                  // No series
+  cases.push_back(std::vector<TestSeries>(1, TestSeries{1, 1, {}}));           // Empty series
+  cases.push_back(std::vector<TestSeries>(1, TestSeries{2, 2, {{5, 9.01f}}})); // One point before the base
+  cases.push_back(std::vector<TestSeries>(1, TestSeries{1, 0, {{0xFFFFFF00u, 2147483520.0f}, {0x00000100u, -2147483520.0f}}})); // Wrap, extremes
+  cases.push_back(std::vector<TestSeries>(1, TestSeries{1, 4, {{1000, -214748.0f}, {2000, 214748.0f}, {3000, 0.0001f}}}));
+  int failures = 0;
+  for (size_t c = 0; c < cases.size(); c++) {
+    if (!roundTrip(cases[c], 1000)) {
+      printf("  edge case %zu failed\n", c);
+      failures++;
+    }
+  }
+  std::mt19937 rng(7);
+  for (int r = 0; r < rounds; r++) {
+    uint32_t baseTimeMs;
+    std::vector<TestSeries> frame = randomFrame(rng, baseTimeMs);
+    if (!roundTrip(frame, baseTimeMs)) {
+      printf("  random frame %d failed\n", r);
+      failures++;
+    }
+  }
+  printf("round trip: %zu edge cases, %d random frames: %s\n", cases.size(), rounds, failures ? "FAILED" : "ok");
+  return failures == 0;
+}
+
+// --- Full history, JSON vs binary ---
+class CountingSink : public JsonSink {
+public:
+  CountingSink() : bytes(0) {}
+  void write(const char* data, size_t length, bool final) override {
+    (void)data;
+    (void)final;
+    bytes += length;
+  }
+  size_t bytes;
+};
+
+char jsonBuffer[1024]; // JSON_RESPONSE_BUFFER_SIZE
+
+size_t historyJson(const std::vector<TestSeries>& history, uint32_t nowMs, JsonSink& sink) {
+  JsonWriter json(jsonBuffer, sizeof(jsonBuffer), sink);
+  json.beginObject();
+  for (size_t s = 0; s < history.size(); s++) {
+    if (s == 0) json.beginArray("temp_history");
+    else json.beginArray("pressure_history");
+    for (size_t i = 0; i < history[s].points.size(); i++) {
+      json.beginObject();
+      json.field("time", (long)history[s].points[i].timeMs - (long)nowMs);
+      json.field("value", history[s].points[i].value, 1);
+      json.endObject();
+    }
+    json.endArray();
+  }
+  json.endObject();
+  return json.finish();
+}
+
+// A full history as the firmware holds it mid-session: temperature holding around the set
+// point, pressure with a shot in the window.
+std::vector<TestSeries> fullHistory(uint32_t nowMs) {
+  std::vector<TestSeries> history(2);
+  history[0].id = TelemetryFrame::SERIES_TEMPERATURE;
+  history[0].decimals = 1;
+  history[1].id = TelemetryFrame::SERIES_PRESSURE;
+  history[1].decimals = 2;
+  std::mt19937 rng(3);
+  std::normal_distribution<double> noise(0.0, 0.05);
+  for (int i = 0; i < HISTORY_SIZE; i++) {
+    uint32_t timeMs = nowMs - (uint32_t)(HISTORY_SIZE - i) * HISTORY_SAMPLE_INTERVAL_MS + (uint32_t)(rng() % 3); // Loop jitter
+    double shotS = i - 40.0;
+    double pressure = (shotS >= 0 && shotS < 28) ? fmin(9.0, shotS * 1.5) + noise(rng) : 0.0;
+    double temperature = 93.0 + 0.3 * sin(i * 0.07) - (shotS >= 0 && shotS < 40 ? 2.0 * sin(shotS / 40.0 * M_PI) : 0.0);
+    history[0].points.push_back({timeMs, (float)temperature});
+    history[1].points.push_back({timeMs, (float)fmax(0.0, pressure)});
+  }
+  return history;
+}
+
+volatile size_t benchSink;
+
+void compareWithJson(unsigned long iterations, const char* writePath) {
+  const uint32_t nowMs = 3600000;
+  std::vector<TestSeries> history = fullHistory(nowMs);
+  uint8_t frame[TelemetryFrame::maxEncodedSize(2, 2 * HISTORY_SIZE)];
+  bool overflow;
+  size_t binaryBytes = encode(history, nowMs, frame, sizeof(frame), overflow);
+  CountingSink counter;
+  size_t jsonBytes = historyJson(history, nowMs, counter);
+
+  typedef std::chrono::steady_clock SteadyClock;
+  SteadyClock::time_point start = SteadyClock::now();
+  size_t total = 0;
+  for (unsigned long i = 0; i < iterations; i++) {
+    CountingSink sink;
+    total += historyJson(history, nowMs, sink);
+  }
+  double jsonSeconds = std::chrono::duration<double>(SteadyClock::now() - start).count();
+  start = SteadyClock::now();
+  for (unsigned long i = 0; i < iterations; i++) total += encode(history, nowMs, frame, sizeof(frame), overflow);
+  double binarySeconds = std::chrono::duration<double>(SteadyClock::now() - start).count();
+  benchSink = total;
+
+  int points = 2 * HISTORY_SIZE;
+  printf("full history (%d points):\n", points);
+  printf("  %-22s %6zu bytes %5.1f bytes/point %8.2f us/encode\n", "JSON (/history)", jsonBytes, (double)jsonBytes / points,
+         jsonSeconds * 1e6 / iterations);
+  printf("  %-22s %6zu bytes %5.1f bytes/point %8.2f us/encode  (%.1fx smaller)\n", "binary (/history.bin)", binaryBytes,
+         (double)binaryBytes / points, binarySeconds * 1e6 / iterations, (double)jsonBytes / binaryBytes);
+
+  if (writePath) {
+    FILE* file = fopen(writePath, "wb");
+    if (file) {
+      fwrite(frame, 1, binaryBytes, file);
+      fclose(file);
+      printf("frame written to %s (base time %u ms)\n", writePath, nowMs);
+    }
+  }
+}
+
+} // namespace
+
+int runTelemetryBench(int argc, char** argv) {
+  TelemetryOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+  bool ok = runRoundTrips(options.rounds);
+  compareWithJson(options.iterations, options.writePath);
+  return ok ? 0 : 1;
+}
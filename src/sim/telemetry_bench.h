@@ -0,0 +1,7 @@
+#ifndef TELEMETRY_BENCH_H
+#define TELEMETRY_BENCH_H
+
+// `program telemetry [options]`: binary frame round trip and size/speed against /history JSON.
+int runTelemetryBench(int argc, char** argv);
+
+#endif // TELEMETRY_BENCH_H
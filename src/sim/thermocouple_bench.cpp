@@ -0,0 +1,345 @@
+// Thermocouple fault sequences: the heater controller (lib/HeaterControl) with its sensor
+// health checks against the thermoblock model (lib/BoilerSim), the simulated MAX6675
+// wrapped in a fault injector. At the set point from the start unless noted; faults start
+// at 10 min.
+//
+//   clean             cold start, three shots, power off and on again: no fault, nothing rejected
+//   off-cold          cold start with the machine switched off, on again at 20 min: no fault
+//                     (the relay heats nothing, which is not a frozen reading)
+//   off-burst         machine switched off 20 s into a cold start, on again at 40 min: the
+//                     reading stops rising under a running burst    -> stuck, cleared without heat
+//   dropouts          one failed read in ten for 2 min: rejected, no fault
+//   spikes            +40 C single-read spikes every 30 s for 5 min: rejected, no fault
+//   mid-spikes        single-read spikes of 6 to 14 C, up and down, every 7.5 s for 5 min: too
+//                     small for the jump check, a single rate violation each: rejected, no fault
+//   open              reads fail for 60 s during a burst                    -> open
+//   loose             4 failed reads, 4 good ones, over and over for 2 min  -> open, once
+//   zero              reads 0.0 C for 60 s (bad SPI transfer)               -> implausible
+//   stuck             reading frozen during the cold start for 5 min       -> stuck
+//   drift             reading ramps +6 C/s to +30 C and back over 40 s      -> rate
+//
+// Per scenario: time from the fault to the controller being DEGRADED, heater on-time while
+// the fault lasted, time from the fault clearing to control resuming, faults, failed and
+// rejected reads, and the boiler's deviation from the set point during the fault. Every
+// scenario must meet its expectations (fault kind, detection and recovery deadlines, no
+// heater while degraded, no flapping in and out of the degraded mode) or the run fails;
+// after a power cycle the boiler has to be back at the set point by the end.
+// Typical use:
+//
+//   .pio/build/native/program thermocouple
+//   .pio/build/native/program thermocouple --scenario stuck --verbose
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "BoilerModel.h"
+#include "HeaterController.h"
+#include "SimPlatform.h"
+#include "bench_report.h"
+#include "thermocouple_bench.h"
+
+namespace {
+
+const unsigned long CONTROL_PERIOD_MS = 100; // Firmware control task period
+const unsigned long PLANT_STEP_MS = 10;
+const double DESIRED_TEMP_C = 90.0;
+const double SHOT_FLOW_ML_PER_S = 2.0;
+const double FAULT_AT_S = 600.0;
+const double RECOVERY_BOUND_S = 8.0;   // recoveryReadings at 500 ms, plus a rejected first reading
+const double END_BAND_C = 2.0;         // After a power cycle: boiler within this of the set point at the end
+
+struct ThermocoupleBenchOptions {
+  const char* scenario = "all";
+  unsigned seed = 1;
+  bool verbose = false;
+};
+
+void printUsage() {
+  printf("usage: program thermocouple [options]\n"
+         "  --scenario NAME    clean, off-cold, off-burst, dropouts, spikes, mid-spikes, open, loose, zero,\n"
+         "                     stuck, drift or all (default all)\n"
+         "  --seed N           sensor noise seed (default 1)\n"
+         "  --verbose          print the controller log\n");
+}
+
+bool parseOptions(int argc, char** argv, ThermocoupleBenchOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (strcmp(arg, "--verbose") == 0) {
+      options.verbose = true;
+      continue;
+    }
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--scenario") == 0) options.scenario = value;
+    else if (strcmp(arg, "--seed") == 0) options.seed = (unsigned)strtoul(value, nullptr, 10);
+    else return false;
+    i++;
+  }
+  return true;
+}
+
+// --- Fault Injection ---
+enum Injection { INJECT_NONE, INJECT_DROPOUTS, INJECT_SPIKES, INJECT_MID_SPIKES, INJECT_OPEN, INJECT_LOOSE, INJECT_ZERO, INJECT_STUCK, INJECT_DRIFT };
+
+// The simulated MAX6675 with a fault sequence on top, timed from start().
+class FaultySensor : public TemperatureSensor {
+public:
+  FaultySensor(TemperatureSensor& sensor, const SimClock& clock, Injection injection)
+      : _sensor(sensor), _clock(clock), _injection(injection), _active(false), _startMs(0), _reads(0),
+        _frozenC(NAN) {}
+
+  void start() {
+    _active = true;
+    _startMs = _clock.now();
+  }
+  void stop() { _active = false; }
+  bool active() const { return _active; }
+
+  double readCelsius() override {
+    double readingC = _sensor.readCelsius();
+    if (!_active) {
+      _frozenC = NAN;
+      return readingC;
+    }
+    _reads++;
+    double sinceS = (_clock.now() - _startMs) / 1000.0;
+    switch (_injection) {
+      case INJECT_DROPOUTS: return _reads % 10 == 0 ? NAN : readingC;
+      case INJECT_SPIKES: return fmod(sinceS, 30.0) < 0.5 ? readingC + 40.0 : readingC;
+      case INJECT_MID_SPIKES: { // 6, 8, ... 14 C, alternating up and down
+        if (fmod(sinceS, 7.5) >= 0.5) return readingC;
+        long spike = (long)(sinceS / 7.5);
+        return readingC + (spike % 2 == 0 ? 1.0 : -1.0) * (6.0 + 2.0 * (spike % 5));
+      }
+      case INJECT_OPEN: return NAN;
+      case INJECT_LOOSE: return _reads % 8 < 4 ? NAN : readingC;
+      case INJECT_ZERO: return 0.0;
+      case INJECT_STUCK:
+        if (isnan(_frozenC)) _frozenC = readingC;
+        return _frozenC;
+      case INJECT_DRIFT: { // Up 5 s, hold 30 s, down 5 s
+        double offsetC = sinceS < 5.0 ? 6.0 * sinceS : sinceS < 35.0 ? 30.0 : sinceS < 40.0 ? 30.0 - 6.0 * (sinceS - 35.0) : 0.0;
+        return readingC + floor(offsetC * 4.0) / 4.0;
+      }
+      default: return readingC;
+    }
+  }
+
+private:
+  TemperatureSensor& _sensor;
+  const SimClock& _clock;
+  Injection _injection;
+  bool _active;
+  unsigned long _startMs;
+  unsigned long _reads;
+  double _frozenC;
+};
+
+// --- Scenarios ---
+struct Scenario {
+  const char* name;
+  Injection injection;
+  double startTempC;    // NAN: at the set point
+  double noiseC;        // Reading noise (std dev); a cold, unpowered boiler reads steady
+  double durationS;
+  double faultAtS;
+  double faultForS;     // INJECT_NONE with a fault expected: the power cut is the fault, nothing clears it
+  bool duringBurst;     // Inject at the first burst from faultAtS
+  int shots;            // 40 s apart from 5 min
+  double powerOffS;     // -1: never
+  double powerOnS;
+  SensorFault expected; // SENSOR_OK: no fault allowed
+  double detectBoundS;  // Fault to DEGRADED
+  uint32_t maxFaults;   // Entries into DEGRADED
+};
+
+const Scenario SCENARIOS[] = {
+    {"clean", INJECT_NONE, 22.0, 0.15, 3600.0, 0.0, 0.0, false, 3, 1800.0, 3000.0, SENSOR_OK, 0.0, 0},
+    {"off-cold", INJECT_NONE, 22.0, 0.05, 3600.0, 0.0, 0.0, false, 0, 1.0, 1200.0, SENSOR_OK, 0.0, 0},
+    {"off-burst", INJECT_NONE, 22.0, 0.05, 4800.0, 0.0, 0.0, false, 0, 20.0, 2400.0, SENSOR_STUCK, 90.0, 1},
+    {"dropouts", INJECT_DROPOUTS, NAN, 0.15, 1200.0, FAULT_AT_S, 120.0, false, 0, -1.0, -1.0, SENSOR_OK, 0.0, 0},
+    {"spikes", INJECT_SPIKES, NAN, 0.15, 1200.0, FAULT_AT_S, 300.0, false, 0, -1.0, -1.0, SENSOR_OK, 0.0, 0},
+    {"mid-spikes", INJECT_MID_SPIKES, NAN, 0.15, 1200.0, FAULT_AT_S, 300.0, false, 0, -1.0, -1.0, SENSOR_OK, 0.0, 0},
+    {"open", INJECT_OPEN, NAN, 0.15, 1200.0, FAULT_AT_S, 60.0, true, 0, -1.0, -1.0, SENSOR_OPEN, 2.0, 1},
+    {"loose", INJECT_LOOSE, NAN, 0.15, 1200.0, FAULT_AT_S, 120.0, false, 0, -1.0, -1.0, SENSOR_OPEN, 2.0, 1},
+    {"zero", INJECT_ZERO, NAN, 0.15, 1200.0, FAULT_AT_S, 60.0, false, 0, -1.0, -1.0, SENSOR_IMPLAUSIBLE, 2.0, 1},
+    {"stuck", INJECT_STUCK, 22.0, 0.15, 1200.0, 60.0, 300.0, true, 0, -1.0, -1.0, SENSOR_STUCK, 50.0, 1},
+    {"drift", INJECT_DRIFT, NAN, 0.15, 1200.0, FAULT_AT_S, 40.0, false, 0, -1.0, -1.0, SENSOR_RATE, 4.5, 2}, // Up and down
+};
+const size_t SCENARIO_COUNT = sizeof(SCENARIOS) / sizeof(SCENARIOS[0]);
+
+struct ScenarioResult {
+  double faultS = NAN;       // Injected
+  double detectS = NAN;      // Fault to DEGRADED
+  double recoverS = NAN;     // Fault cleared to leaving DEGRADED
+  double heaterOnS = 0.0;    // Relay on while the fault lasted (off-burst: while DEGRADED)
+  double minC = INFINITY;    // Boiler (thermocouple node) while the fault lasted
+  double maxC = -INFINITY;
+  SensorFault firstFault = SENSOR_OK;
+  uint32_t faults = 0;
+  uint32_t failedReads = 0;
+  uint32_t rejectedReads = 0;
+  bool degradedAtEnd = false;
+  double endC = NAN;
+};
+
+bool isShotActive(const Scenario& scenario, double tS) {
+  for (int i = 0; i < scenario.shots; i++) {
+    double startS = 300.0 + i * 40.0;
+    if (tS >= startS && tS < startS + 25.0) return true;
+  }
+  return false;
+}
+
+ScenarioResult runScenario(const Scenario& scenario, const ThermocoupleBenchOptions& options) {
+  srand(options.seed);
+  static const double rawTempsC[2] = {0.0, 100.0}; // Identity: the model node is the actual temperature
+  static const double actualTempsC[2] = {0.0, 100.0};
+  TemperatureCalibration calibration(rawTempsC, actualTempsC, 2);
+  HeaterControllerConfig config;
+
+  BoilerModel boiler;
+  boiler.reset(isnan(scenario.startTempC) ? DESIRED_TEMP_C : scenario.startTempC);
+  SimClock clock;
+  SimThermocouple thermocouple(boiler, scenario.noiseC);
+  FaultySensor sensor(thermocouple, clock, scenario.injection);
+  SimRelay relay(boiler);
+  SimEvents events(clock, options.verbose);
+  HeaterController controller(clock, sensor, relay, events, calibration, config);
+  controller.begin();
+  controller.setDesiredTemperature(DESIRED_TEMP_C);
+
+  ScenarioResult result;
+  double clearedS = NAN;
+  bool powerCutFault = scenario.injection == INJECT_NONE && scenario.expected != SENSOR_OK;
+  const double dtS = PLANT_STEP_MS / 1000.0;
+  const unsigned long durationMs = (unsigned long)(scenario.durationS * 1000.0);
+  for (unsigned long t = 0; t < durationMs; t += PLANT_STEP_MS) {
+    double tS = t / 1000.0;
+    bool powered = !(scenario.powerOffS >= 0 && tS >= scenario.powerOffS &&
+                     !(scenario.powerOnS >= 0 && tS >= scenario.powerOnS));
+    boiler.setMachinePowered(powered);
+    boiler.setWaterFlowMlPerS(isShotActive(scenario, tS) ? SHOT_FLOW_ML_PER_S : 0.0);
+
+    if (scenario.injection != INJECT_NONE && isnan(result.faultS) && tS >= scenario.faultAtS &&
+        (!scenario.duringBurst || (controller.state() == HEATING && relay.isOn()))) {
+      result.faultS = tS;
+      sensor.start();
+    }
+    if (powerCutFault && isnan(result.faultS) && tS >= scenario.powerOffS) {
+      result.faultS = tS;
+    }
+    if (sensor.active() && tS >= result.faultS + scenario.faultForS) {
+      sensor.stop();
+      clearedS = tS;
+    }
+
+    if (t % CONTROL_PERIOD_MS == 0) {
+      HeaterState before = controller.state();
+      controller.update();
+      if (before != DEGRADED && controller.state() == DEGRADED) {
+        if (isnan(result.detectS) && !isnan(result.faultS)) result.detectS = tS - result.faultS;
+        if (result.faults == 0) result.firstFault = controller.sensorHealth().fault();
+        result.faults++;
+        if (powerCutFault) clearedS = tS; // Recovery is measured from the fault: its retry
+      }
+      if (before == DEGRADED && controller.state() != DEGRADED && !isnan(clearedS) && isnan(result.recoverS)) {
+        result.recoverS = tS - clearedS;
+      }
+    }
+    boiler.step(dtS);
+    clock.advance(PLANT_STEP_MS);
+
+    if (sensor.active() || (powerCutFault && controller.state() == DEGRADED)) {
+      if (relay.isOn()) result.heaterOnS += dtS;
+      if (boiler.sensorTempC() < result.minC) result.minC = boiler.sensorTempC();
+      if (boiler.sensorTempC() > result.maxC) result.maxC = boiler.sensorTempC();
+    }
+  }
+  result.failedReads = controller.sensorHealth().failedReads();
+  result.rejectedReads = controller.sensorHealth().rejectedReads();
+  result.degradedAtEnd = controller.state() == DEGRADED;
+  result.endC = boiler.sensorTempC();
+  return result;
+}
+
+bool checkScenario(const Scenario& scenario, const ScenarioResult& r) {
+  bool ok = true;
+  if (scenario.powerOnS >= 0 && !(fabs(r.endC - DESIRED_TEMP_C) <= END_BAND_C)) {
+    printf("  %s: boiler at %.1f C at the end, not back at the set point\n", scenario.name, r.endC);
+    ok = false;
+  }
+  if (scenario.expected == SENSOR_OK) {
+    if (r.faults > 0) {
+      printf("  %s: false fault (%s)\n", scenario.name, sensorFaultName(r.firstFault));
+      ok = false;
+    }
+    if (scenario.injection == INJECT_NONE && (r.failedReads > 0 || r.rejectedReads > 0)) {
+      printf("  %s: clean readings rejected\n", scenario.name);
+      ok = false;
+    }
+    if (scenario.injection != INJECT_NONE && r.failedReads + r.rejectedReads == 0) {
+      printf("  %s: injected readings not rejected\n", scenario.name);
+      ok = false;
+    }
+    return ok;
+  }
+  if (r.faults == 0 || r.firstFault != scenario.expected) {
+    printf("  %s: expected %s, got %s\n", scenario.name, sensorFaultName(scenario.expected),
+           r.faults > 0 ? sensorFaultName(r.firstFault) : "no fault");
+    return false;
+  }
+  if (r.faults > scenario.maxFaults) {
+    printf("  %s: entered the degraded mode %lu times\n", scenario.name, (unsigned long)r.faults);
+    ok = false;
+  }
+  if (!(r.detectS <= scenario.detectBoundS)) {
+    printf("  %s: detected after %.1f s (bound %.1f s)\n", scenario.name, r.detectS, scenario.detectBoundS);
+    ok = false;
+  }
+  if (!(r.heaterOnS <= r.detectS + 0.2)) {
+    printf("  %s: heater on for %.1f s of the fault\n", scenario.name, r.heaterOnS);
+    ok = false;
+  }
+  // Nothing clears a power cut's stuck reading: the retry has to, with the relay off
+  double recoveryBoundS = RECOVERY_BOUND_S;
+  if (scenario.injection == INJECT_NONE) recoveryBoundS += SensorHealthConfig().stuckRetryMs / 1000.0;
+  if (r.degradedAtEnd || !(r.recoverS <= recoveryBoundS)) {
+    printf("  %s: no recovery within %.0f s of the fault clearing\n", scenario.name, recoveryBoundS);
+    ok = false;
+  }
+  return ok;
+}
+
+} // namespace
+
+int runThermocoupleBench(int argc, char** argv) {
+  ThermocoupleBenchOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+
+  printf("%-10s %-11s %7s %7s %8s %9s %6s %6s %8s %7s %7s\n", "scenario", "fault", "inj_s", "detect_s",
+         "heater_s", "recover_s", "faults", "failed", "rejected", "min_c", "max_c");
+  bool ok = true;
+  bool any = false;
+  for (size_t s = 0; s < SCENARIO_COUNT; s++) {
+    const Scenario& scenario = SCENARIOS[s];
+    if (!scenarioSelected(options.scenario, scenario.name)) continue;
+    any = true;
+    ScenarioResult r = runScenario(scenario, options);
+    printf("%-10s %-11s %7.1f %7.1f %8.1f %9.1f %6lu %6lu %8lu %7.1f %7.1f\n", scenario.name,
+           r.faults > 0 ? sensorFaultName(r.firstFault) : "-", r.faultS,
+           r.detectS, r.heaterOnS, r.recoverS, (unsigned long)r.faults, (unsigned long)r.failedReads,
+           (unsigned long)r.rejectedReads, isinf(r.minC) ? NAN : r.minC, isinf(r.maxC) ? NAN : r.maxC);
+    if (!checkScenario(scenario, r)) ok = false;
+  }
+  if (!any) {
+    printUsage();
+    return 1;
+  }
+  return benchResult("thermocouple", ok);
+}
@@ -0,0 +1,8 @@
+#ifndef THERMOCOUPLE_BENCH_H
+#define THERMOCOUPLE_BENCH_H
+
+// `program thermocouple [options]`: injected thermocouple fault sequences against the
+// controller's sensor health checks and degraded mode.
+int runThermocoupleBench(int argc, char** argv);
+
+#endif // THERMOCOUPLE_BENCH_H
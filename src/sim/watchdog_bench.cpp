@@ -0,0 +1,302 @@
+// Safety watchdog fault injection: the heater controller runs against the thermoblock model
+// (lib/BoilerSim) with the relay and the thermocouple behind the safety watchdog
+// (lib/HeaterControl/src/HeaterWatchdog.h), ticked every 50 ms like the firmware's watchdog
+// task. Scenarios:
+//
+//   shots             burst mode at the set point, three shots: no trip
+//   shots-pid         the same in PID mode
+//   cold-start        burst mode from 22 C, a burst extended below the early cutoff: no trip
+//   cold-start-pid    the same in PID mode
+//   standby           main switch off at 60 s (presumed off), on again at 25 min: no trip
+//   control-stall     the control task stops at 10 min while a burst runs, for 60 s
+//   open-thermocouple the thermocouple reads NAN from 10 min while a burst runs, for 60 s
+//   stuck-request     from 10 min the controller keeps requesting the relay on, for 200 s
+//   missed-power-on   standby as above with the power-on detection disabled: the element
+//                     heats a powered machine with the relay held on
+//
+// A fault scenario must trip with one of its expected reasons within its deadline from the
+// fault and no earlier (no trip before the fault), keep the thermocouple node below its
+// peak bound and, once the fault is gone, release the relay again. The fault-free ones must
+// not trip at all (and a cold start must reach the set point). Reported: time from the fault to the relay going off, the peak
+// thermocouple node, the trips and the host cost per tick. Typical use:
+//
+//   .pio/build/native/program watchdog
+//   .pio/build/native/program watchdog --scenario missed-power-on --verbose
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "BoilerModel.h"
+#include "HeaterController.h"
+#include "HeaterWatchdog.h"
+#include "SimPlatform.h"
+#include "bench_report.h"
+#include "watchdog_bench.h"
+
+namespace {
+
+const unsigned long CONTROL_PERIOD_MS = 100; // Firmware control task period
+const unsigned long WATCHDOG_PERIOD_MS = 50; // Firmware watchdog task period
+const unsigned long PLANT_STEP_MS = 10;
+const double DESIRED_TEMP_C = 90.0;
+const double SHOT_FLOW_ML_PER_S = 2.0;
+const double PEAK_MARGIN_C = 10.0; // Above maxTemperatureC, for the element's stored heat
+
+struct WatchdogBenchOptions {
+  const char* scenario = "all";
+  unsigned seed = 1;
+  bool verbose = false;
+};
+
+void printUsage() {
+  printf("usage: program watchdog [options]\n"
+         "  --scenario NAME    shots, shots-pid, cold-start, cold-start-pid, standby, control-stall,\n"
+         "                     open-thermocouple, stuck-request, missed-power-on or all (default all)\n"
+         "  --seed N           sensor noise seed (default 1)\n"
+         "  --verbose          print the controller and watchdog log\n");
+}
+
+bool parseOptions(int argc, char** argv, WatchdogBenchOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (strcmp(arg, "--verbose") == 0) {
+      options.verbose = true;
+      continue;
+    }
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--scenario") == 0) options.scenario = value;
+    else if (strcmp(arg, "--seed") == 0) options.seed = (unsigned)strtoul(value, nullptr, 10);
+    else return false;
+    i++;
+  }
+  return true;
+}
+
+// --- Scenarios ---
+enum Fault { FAULT_NONE, FAULT_CONTROL_STALL, FAULT_OPEN_THERMOCOUPLE, FAULT_STUCK_REQUEST, FAULT_MISSED_POWER_ON };
+
+struct Scenario {
+  const char* name;
+  ControlMode mode;
+  double durationS;
+  double startC;       // Boiler at the start
+  int shots;           // 40 s apart from 5 min, 25 s each
+  double powerOffS;    // Main switch off from here (-1: never)
+  double powerOnS;     // On again from here (-1: never)
+  Fault fault;
+  double faultAtS;     // Stall and open thermocouple: the first burst from here
+  double faultForS;    // -1: until the end
+  WatchdogTrip expected[2]; // WATCHDOG_OK: unused; both unused = no trip allowed
+  double deadlineS;    // Fault to relay off (missed-power-on: power on to relay off)
+};
+
+const Scenario SCENARIOS[] = {
+    {"shots", CONTROL_MODE_BURST, 900.0, DESIRED_TEMP_C, 3, -1.0, -1.0, FAULT_NONE, 0.0, 0.0,
+     {WATCHDOG_OK, WATCHDOG_OK}, 0.0},
+    {"shots-pid", CONTROL_MODE_PID, 900.0, DESIRED_TEMP_C, 3, -1.0, -1.0, FAULT_NONE, 0.0, 0.0,
+     {WATCHDOG_OK, WATCHDOG_OK}, 0.0},
+    {"cold-start", CONTROL_MODE_BURST, 900.0, 22.0, 0, -1.0, -1.0, FAULT_NONE, 0.0, 0.0, {WATCHDOG_OK, WATCHDOG_OK}, 0.0},
+    {"cold-start-pid", CONTROL_MODE_PID, 900.0, 22.0, 0, -1.0, -1.0, FAULT_NONE, 0.0, 0.0,
+     {WATCHDOG_OK, WATCHDOG_OK}, 0.0},
+    {"standby", CONTROL_MODE_BURST, 2400.0, DESIRED_TEMP_C, 0, 60.0, 1500.0, FAULT_NONE, 0.0, 0.0,
+     {WATCHDOG_OK, WATCHDOG_OK}, 0.0},
+    {"control-stall", CONTROL_MODE_BURST, 900.0, DESIRED_TEMP_C, 0, -1.0, -1.0, FAULT_CONTROL_STALL, 600.0, 60.0,
+     {WATCHDOG_SENSOR_STALE, WATCHDOG_OK}, 6.0},
+    {"open-thermocouple", CONTROL_MODE_BURST, 900.0, DESIRED_TEMP_C, 0, -1.0, -1.0, FAULT_OPEN_THERMOCOUPLE, 600.0,
+     60.0, {WATCHDOG_SENSOR_STALE, WATCHDOG_OK}, 6.0},
+    {"stuck-request", CONTROL_MODE_BURST, 1200.0, DESIRED_TEMP_C, 0, -1.0, -1.0, FAULT_STUCK_REQUEST, 600.0, 200.0,
+     {WATCHDOG_ON_TIME, WATCHDOG_OVER_TEMPERATURE}, 91.0},
+    {"missed-power-on", CONTROL_MODE_BURST, 2400.0, DESIRED_TEMP_C, 0, 60.0, 1500.0, FAULT_MISSED_POWER_ON, 1500.0,
+     -1.0, {WATCHDOG_ON_TIME, WATCHDOG_OVER_TEMPERATURE}, 300.0},
+};
+const size_t SCENARIO_COUNT = sizeof(SCENARIOS) / sizeof(SCENARIOS[0]);
+
+struct ScenarioResult {
+  double faultS = NAN;      // Fault injected (missed-power-on: power back on)
+  double relayOffS = NAN;   // Fault to the relay off
+  double peakSensorC = 0.0; // From the fault on (fault-free: whole run)
+  uint32_t trips = 0;
+  uint32_t earlyTrips = 0;  // Before the fault
+  WatchdogTrip firstTrip = WATCHDOG_OK;
+  bool released = true;    // Not latched at the end
+  unsigned long ticks = 0;
+  double tickNs = 0.0;
+  double tickMaxNs = 0.0;
+};
+
+bool isShotActive(const Scenario& scenario, double tS) {
+  for (int i = 0; i < scenario.shots; i++) {
+    double startS = 300.0 + i * 40.0;
+    if (tS >= startS && tS < startS + 25.0) return true;
+  }
+  return false;
+}
+
+ScenarioResult runScenario(const Scenario& scenario, const WatchdogBenchOptions& options) {
+  srand(options.seed);
+  static const double rawTempsC[2] = {0.0, 100.0}; // Identity: the model node is the actual temperature
+  static const double actualTempsC[2] = {0.0, 100.0};
+  TemperatureCalibration calibration(rawTempsC, actualTempsC, 2);
+  HeaterControllerConfig config;
+  config.controlMode = scenario.mode;
+  if (scenario.fault == FAULT_MISSED_POWER_ON) {
+    config.powerOnRateThresholdCPerS = 1e9f; // Never detected
+  }
+
+  BoilerModel boiler;
+  boiler.reset(scenario.startC);
+  SimClock clock;
+  SimThermocouple thermocouple(boiler);
+  SimRelay relay(boiler);
+  SimEvents events(clock, options.verbose);
+  HeaterWatchdog watchdog(clock, relay, events);
+  InterlockedRelay interlockedRelay(watchdog);
+  WatchedSensor watchedSensor(watchdog, thermocouple);
+  HeaterController controller(clock, watchedSensor, interlockedRelay, events, calibration, config);
+  controller.begin();
+  controller.setDesiredTemperature(DESIRED_TEMP_C);
+  watchdog.begin();
+
+  ScenarioResult result;
+  bool faultActive = false;
+  double tickTotalNs = 0.0;
+  const double dtS = PLANT_STEP_MS / 1000.0;
+  const unsigned long durationMs = (unsigned long)(scenario.durationS * 1000.0);
+  for (unsigned long t = 0; t < durationMs; t += PLANT_STEP_MS) {
+    double tS = t / 1000.0;
+    bool powered = !(scenario.powerOffS >= 0 && tS >= scenario.powerOffS &&
+                     !(scenario.powerOnS >= 0 && tS >= scenario.powerOnS));
+    boiler.setMachinePowered(powered);
+    boiler.setWaterFlowMlPerS(isShotActive(scenario, tS) ? SHOT_FLOW_ML_PER_S : 0.0);
+
+    // Fault injection
+    if (scenario.fault != FAULT_NONE && isnan(result.faultS) && tS >= scenario.faultAtS) {
+      bool burst = controller.state() == HEATING && relay.isOn();
+      bool waitsForBurst = scenario.fault == FAULT_CONTROL_STALL || scenario.fault == FAULT_OPEN_THERMOCOUPLE;
+      if (burst || !waitsForBurst) {
+        result.faultS = tS;
+        faultActive = true;
+        if (scenario.fault == FAULT_OPEN_THERMOCOUPLE) thermocouple.setFailed(true);
+      }
+    }
+    if (faultActive && scenario.faultForS >= 0 && tS >= result.faultS + scenario.faultForS) {
+      faultActive = false;
+      thermocouple.setFailed(false);
+      if (scenario.fault == FAULT_STUCK_REQUEST) {
+        interlockedRelay.set(controller.isRelayOn()); // Bug gone: the controller's own request
+      }
+    }
+
+    if (t % CONTROL_PERIOD_MS == 0 && !(faultActive && scenario.fault == FAULT_CONTROL_STALL)) {
+      controller.update();
+      watchdog.setStandby(controller.isPresumedOff());
+      if (faultActive && scenario.fault == FAULT_STUCK_REQUEST) {
+        interlockedRelay.set(true); // State machine bug: the relay request never goes off
+      }
+    }
+    if (t % WATCHDOG_PERIOD_MS == 0) {
+      uint32_t tripsBefore = watchdog.totalTrips();
+      auto start = std::chrono::steady_clock::now();
+      watchdog.tick();
+      double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+      tickTotalNs += ns;
+      if (ns > result.tickMaxNs) result.tickMaxNs = ns;
+      result.ticks++;
+      if (watchdog.totalTrips() != tripsBefore) {
+        if (result.trips == 0) result.firstTrip = watchdog.lastTrip();
+        result.trips++;
+        if (isnan(result.faultS)) result.earlyTrips++;
+      }
+    }
+    boiler.step(dtS);
+    clock.advance(PLANT_STEP_MS);
+
+    if (scenario.fault == FAULT_NONE || !isnan(result.faultS)) {
+      if (boiler.sensorTempC() > result.peakSensorC) result.peakSensorC = boiler.sensorTempC();
+    }
+    if (!isnan(result.faultS) && isnan(result.relayOffS) && !relay.isOn()) {
+      result.relayOffS = tS - result.faultS;
+    }
+  }
+  result.released = watchdog.trip() == WATCHDOG_OK;
+  result.tickNs = result.ticks > 0 ? tickTotalNs / result.ticks : 0.0;
+  return result;
+}
+
+bool checkScenario(const Scenario& scenario, const ScenarioResult& r, const HeaterWatchdogConfig& config) {
+  bool ok = true;
+  bool tripAllowed = scenario.expected[0] != WATCHDOG_OK;
+  if (!tripAllowed) {
+    if (r.trips > 0) {
+      printf("  %s: false trip (%s)\n", scenario.name, watchdogTripName(r.firstTrip));
+      ok = false;
+    }
+    if (scenario.startC < DESIRED_TEMP_C && r.peakSensorC < DESIRED_TEMP_C - 1.0) {
+      printf("  %s: set point never reached (%.1f C)\n", scenario.name, r.peakSensorC);
+      ok = false;
+    }
+    return ok;
+  }
+  if (isnan(r.faultS)) {
+    printf("  %s: fault never injected\n", scenario.name);
+    return false;
+  }
+  if (r.earlyTrips > 0) {
+    printf("  %s: tripped before the fault\n", scenario.name);
+    ok = false;
+  }
+  if (r.trips == 0 || (r.firstTrip != scenario.expected[0] && r.firstTrip != scenario.expected[1])) {
+    printf("  %s: missed trip (got %s)\n", scenario.name, watchdogTripName(r.firstTrip));
+    ok = false;
+  }
+  if (!(r.relayOffS <= scenario.deadlineS)) {
+    printf("  %s: relay still on %.0f s after the fault\n", scenario.name, scenario.deadlineS);
+    ok = false;
+  }
+  if (!(r.peakSensorC <= config.maxTemperatureC + PEAK_MARGIN_C)) {
+    printf("  %s: thermocouple node reached %.1f C\n", scenario.name, r.peakSensorC);
+    ok = false;
+  }
+  if (scenario.faultForS >= 0 && !r.released) {
+    printf("  %s: still latched after the fault ended\n", scenario.name);
+    ok = false;
+  }
+  return ok;
+}
+
+} // namespace
+
+int runWatchdogBench(int argc, char** argv) {
+  WatchdogBenchOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+
+  HeaterWatchdogConfig config;
+  printf("limits: on-time %.0f s, %.0f C (release %.0f C), sensor %.1f s, standby ceiling %.0f C; tick %lu ms\n",
+         config.maxOnTimeMs / 1000.0, config.maxTemperatureC, config.maxTemperatureC - config.temperatureHysteresisC,
+         config.sensorStaleMs / 1000.0, config.standbyCeilingC, WATCHDOG_PERIOD_MS);
+  printf("%-18s %-17s %8s %8s %7s %6s %8s %8s %8s\n", "scenario", "first_trip", "fault_s", "off_s", "peak_c",
+         "trips", "released", "tick_ns", "max_ns");
+  bool ok = true;
+  bool any = false;
+  for (size_t s = 0; s < SCENARIO_COUNT; s++) {
+    const Scenario& scenario = SCENARIOS[s];
+    if (!scenarioSelected(options.scenario, scenario.name)) continue;
+    any = true;
+    ScenarioResult r = runScenario(scenario, options);
+    printf("%-18s %-17s %8.1f %8.1f %7.1f %6lu %8s %8.0f %8.0f\n", scenario.name,
+           r.trips > 0 ? watchdogTripName(r.firstTrip) : "-", r.faultS, r.relayOffS, r.peakSensorC,
+           (unsigned long)r.trips, r.released ? "yes" : "no", r.tickNs, r.tickMaxNs);
+    if (!checkScenario(scenario, r, config)) ok = false;
+  }
+  if (!any) {
+    printUsage();
+    return 1;
+  }
+  return benchResult("watchdog", ok);
+}
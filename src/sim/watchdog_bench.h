@@ -0,0 +1,8 @@
+#ifndef WATCHDOG_BENCH_H
+#define WATCHDOG_BENCH_H
+
+// `program watchdog [options]`: fault injection against the safety watchdog, with the heater
+// controller and the thermoblock model behind it.
+int runWatchdogBench(int argc, char** argv);
+
+#endif // WATCHDOG_BENCH_H
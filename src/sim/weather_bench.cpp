@@ -0,0 +1,428 @@
+// Host check of the weather fetcher (lib/WeatherFetch) against a stand-in HTTP server.
+//
+// A forked local server answers each connection with the next behaviour of a script:
+// good responses, a response slower than the request timeout, a body that stalls halfway,
+// HTTP 500, an HTML error page, a truncated body and a body whose only "temp" sits in the
+// wrong "main". The fetcher runs in virtual time (requests are real), so the backoff and
+// staleness of a day of outages replay in a few seconds. Checks that every request returns
+// within the timeout, the retry delays double up to the cap, the last good value survives
+// every failure, goes stale after an hour and is replaced on recovery. Also runs the
+// filtered JSON lookup over edge cases.
+//
+//   .pio/build/native/program weather
+//   .pio/build/native/program weather --timeout-ms 200 --slow-ms 1000
+#include <arpa/inet.h>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "JsonPath.h"
+#include "WeatherFetcher.h"
+#include "weather_bench.h"
+
+namespace {
+
+const unsigned long TIMEOUT_MARGIN_MS = 200; // Scheduling slack on top of the request timeout
+
+struct WeatherOptions {
+  uint32_t timeoutMs = 500; // Firmware uses 5000; shorter here to keep the run quick
+  unsigned long slowMs = 1500;
+};
+
+void printUsage() {
+  printf("usage: program weather [options]\n"
+         "  --timeout-ms N     request timeout (default 500)\n"
+         "  --slow-ms N        delay of the slow and stalling responses (default 1500)\n");
+}
+
+bool parseOptions(int argc, char** argv, WeatherOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strcmp(arg, "--help") == 0 || value == nullptr) return false;
+    if (strcmp(arg, "--timeout-ms") == 0) options.timeoutMs = (uint32_t)atol(value);
+    else if (strcmp(arg, "--slow-ms") == 0) options.slowMs = (unsigned long)atol(value);
+    else return false;
+    i++;
+  }
+  return options.timeoutMs > 0 && options.slowMs > options.timeoutMs;
+}
+
+// --- Stand-in server ---
+
+enum Behaviour { OK, SLOW, STALL_BODY, SERVER_ERROR, HTML, TRUNCATED, DECOY, RECOVERED };
+
+const char* behaviourName(Behaviour behaviour) {
+  switch (behaviour) {
+    case OK: return "ok";
+    case SLOW: return "slow";
+    case STALL_BODY: return "stalled body";
+    case SERVER_ERROR: return "HTTP 500";
+    case HTML: return "HTML page";
+    case TRUNCATED: return "truncated";
+    case DECOY: return "no main.temp";
+    case RECOVERED: return "ok";
+  }
+  return "?";
+}
+
+// Shaped like OpenWeatherMap's current weather (about 500 bytes), "main" also appears as
+// a string inside "weather" before the real object.
+std::string weatherBody(double temperatureC) {
+  char body[640];
+  snprintf(body, sizeof(body),
+           "{\"coord\":{\"lon\":-79.42,\"lat\":43.7},\"weather\":[{\"id\":803,\"main\":\"Clouds\","
+           "\"description\":\"broken clouds\",\"icon\":\"04d\"}],\"base\":\"stations\",\"main\":{\"temp\":%.2f,"
+           "\"feels_like\":%.2f,\"temp_min\":%.2f,\"temp_max\":%.2f,\"pressure\":1015,\"humidity\":61},"
+           "\"visibility\":10000,\"wind\":{\"speed\":4.12,\"deg\":250},\"clouds\":{\"all\":75},\"dt\":1760612400,"
+           "\"sys\":{\"type\":2,\"id\":2099289,\"country\":\"CA\",\"sunrise\":1760614000,\"sunset\":1760653400},"
+           "\"timezone\":-14400,\"id\":6167865,\"name\":\"Toronto\",\"cod\":200}",
+           temperatureC, temperatureC - 0.4, temperatureC - 1.1, temperatureC + 0.8);
+  return body;
+}
+
+void sendAll(int fd, const std::string& data) {
+  size_t offset = 0;
+  while (offset < data.size()) {
+    ssize_t sent = send(fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+    if (sent <= 0) return;
+    offset += (size_t)sent;
+  }
+}
+
+std::string response(int status, const char* contentType, const std::string& body, size_t contentLength) {
+  char header[160];
+  snprintf(header, sizeof(header), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+           status, status == 200 ? "OK" : "Internal Server Error", contentType, contentLength);
+  return header + body;
+}
+
+void serveConnection(int fd, Behaviour behaviour, unsigned long slowMs) {
+  char request[1024];
+  recv(fd, request, sizeof(request), 0); // GET line and headers, not inspected
+  std::string good = weatherBody(21.5);
+  switch (behaviour) {
+    case OK:
+      sendAll(fd, response(200, "application/json", good, good.size()));
+      break;
+    case RECOVERED: {
+      std::string body = weatherBody(18.25);
+      sendAll(fd, response(200, "application/json", body, body.size()));
+      break;
+    }
+    case SLOW: {
+      usleep(slowMs * 1000);
+      std::string late = weatherBody(99.0); // Must never be taken
+      sendAll(fd, response(200, "application/json", late, late.size()));
+      break;
+    }
+    case STALL_BODY: {
+      std::string late = weatherBody(98.0);
+      std::string full = response(200, "application/json", late, late.size());
+      sendAll(fd, full.substr(0, full.size() - late.size() / 2));
+      usleep(slowMs * 1000);
+      sendAll(fd, full.substr(full.size() - late.size() / 2));
+      break;
+    }
+    case SERVER_ERROR: {
+      std::string body = "{\"cod\":500,\"message\":\"Internal error\"}";
+      sendAll(fd, response(500, "application/json", body, body.size()));
+      break;
+    }
+    case HTML: {
+      std::string page = "<html><body><h1>502 Bad Gateway</h1></body></html>";
+      sendAll(fd, response(200, "text/html", page, page.size()));
+      break;
+    }
+    case TRUNCATED: {
+      std::string body = weatherBody(97.0);
+      size_t cut = body.find("\"temp\":") + 9; // Closes in the middle of the number
+      sendAll(fd, response(200, "application/json", body.substr(0, cut), body.size()));
+      break;
+    }
+    case DECOY: {
+      std::string body = "{\"weather\":[{\"main\":\"Rain\",\"temp\":96}],\"sys\":{\"main\":{\"temp\":95}},"
+                         "\"main\":{\"humidity\":80},\"temp\":94}";
+      sendAll(fd, response(200, "application/json", body, body.size()));
+      break;
+    }
+  }
+  close(fd);
+}
+
+// Accepts connections until killed, one child per connection so a slow answer does not
+// hold up the next request.
+void runServer(int listenFd, const Behaviour* script, size_t scriptLength, unsigned long slowMs) {
+  signal(SIGCHLD, SIG_IGN);
+  for (size_t next = 0;; next++) {
+    int fd = accept(listenFd, nullptr, nullptr);
+    if (fd < 0) continue;
+    if (fork() == 0) {
+      close(listenFd);
+      serveConnection(fd, script[next < scriptLength ? next : scriptLength - 1], slowMs);
+      _exit(0);
+    }
+    close(fd);
+  }
+}
+
+// --- Client ---
+
+unsigned long elapsedMs(std::chrono::steady_clock::time_point start) {
+  return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Same contract as the firmware's ArduinoHttpGetter: the whole exchange is bounded by
+// timeoutMs, a body shorter than its Content-Length is an error.
+class PosixHttpGetter : public HttpGetter {
+public:
+  int get(const char* url, char* body, size_t capacity, size_t& length, uint32_t timeoutMs) override {
+    length = 0;
+    body[0] = '\0';
+    char host[64];
+    int port = 80;
+    const char* path = "/";
+    if (!parseUrl(url, host, sizeof(host), port, path)) return -1;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)port);
+    inet_pton(AF_INET, host, &address.sin_addr);
+    if (connect(fd, (sockaddr*)&address, sizeof(address)) != 0 && errno != EINPROGRESS) {
+      close(fd);
+      return -1;
+    }
+    if (!waitFor(fd, POLLOUT, start, timeoutMs)) {
+      close(fd);
+      return -2;
+    }
+
+    char request[256];
+    int requestLength = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n", path, host);
+    send(fd, request, (size_t)requestLength, MSG_NOSIGNAL);
+
+    std::string raw;
+    int status = -2;
+    for (;;) {
+      if (!waitFor(fd, POLLIN, start, timeoutMs)) break; // Timed out, status stays -2
+      char chunk[512];
+      ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+      if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+      if (received <= 0) {
+        status = -3; // Closed before the response was complete
+        break;
+      }
+      raw.append(chunk, (size_t)received);
+      if (responseComplete(raw, status)) break;
+    }
+    close(fd);
+    if (status < 0) return status;
+
+    size_t bodyStart = raw.find("\r\n\r\n") + 4;
+    length = raw.size() - bodyStart < capacity - 1 ? raw.size() - bodyStart : capacity - 1;
+    memcpy(body, raw.data() + bodyStart, length);
+    body[length] = '\0';
+    return status;
+  }
+
+private:
+  static bool parseUrl(const char* url, char* host, size_t hostCapacity, int& port, const char*& path) {
+    if (strncmp(url, "http://", 7) != 0) return false;
+    const char* start = url + 7;
+    const char* end = start + strcspn(start, ":/");
+    if ((size_t)(end - start) >= hostCapacity) return false;
+    memcpy(host, start, (size_t)(end - start));
+    host[end - start] = '\0';
+    if (*end == ':') port = atoi(end + 1);
+    const char* slash = strchr(end, '/');
+    path = slash ? slash : "/";
+    return true;
+  }
+
+  static bool waitFor(int fd, short events, std::chrono::steady_clock::time_point start, uint32_t timeoutMs) {
+    unsigned long spent = elapsedMs(start);
+    if (spent >= timeoutMs) return false;
+    pollfd entry = {fd, events, 0};
+    return poll(&entry, 1, (int)(timeoutMs - spent)) > 0;
+  }
+
+  // Headers in and Content-Length bytes of body received.
+  static bool responseComplete(const std::string& raw, int& status) {
+    size_t headerEnd = raw.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) return false;
+    const char* lengthField = strstr(raw.c_str(), "Content-Length: ");
+    if (lengthField == nullptr || raw.size() - headerEnd - 4 < strtoul(lengthField + 16, nullptr, 10)) return false;
+    status = atoi(raw.c_str() + 9); // "HTTP/1.1 200"
+    return true;
+  }
+};
+
+// --- Checks ---
+
+struct LookupCase {
+  const char* json;
+  bool found;
+  double value;
+};
+
+int runLookupCases() {
+  static const char* const PATH[] = {"main", "temp"};
+  std::string deep;
+  for (int i = 0; i < JSON_PATH_MAX_DEPTH + 2; i++) deep += "{\"a\":";
+  deep += "1";
+  for (int i = 0; i < JSON_PATH_MAX_DEPTH + 2; i++) deep += "}";
+  deep = "{\"x\":" + deep + ",\"main\":{\"temp\":3}}";
+  std::string real = weatherBody(21.5);
+  const LookupCase cases[] = {
+      {real.c_str(), true, 21.5},
+      {"{\"main\":{\"temp\":-3.5e1}}", true, -35.0},
+      {" { \"main\" : { \"humidity\" : 1 , \"temp\" : 0 } } ", true, 0.0},
+      {"{\"weather\":[{\"main\":\"Rain\"}],\"main\":{\"temp\":7}}", true, 7.0},
+      {"{\"sys\":{\"main\":{\"temp\":95}},\"main\":{\"temp\":8}}", true, 8.0},
+      {"{\"ma\\\"in\":{\"temp\":1},\"main\":{\"te\\u006dp\":2,\"temp\":9}}", true, 9.0},
+      {"{\"note\":\"}{\\\"main\\\":{\\\"temp\\\":5}\",\"main\":{\"temp\":10}}", true, 10.0},
+      {"{\"weather\":[{\"main\":\"Rain\",\"temp\":96}],\"main\":{\"humidity\":80},\"temp\":94}", false, 0.0},
+      {"{\"main\":{\"temp\":\"21\"}}", false, 0.0},
+      {"{\"main\":{\"temp\":null}}", false, 0.0},
+      {"{\"main\":[{\"temp\":4}]}", false, 0.0},
+      {"{\"main\":{\"temp\":", false, 0.0},
+      {"{\"main\":{\"temp\":-}}", false, 0.0},
+      {"<html>502</html>", false, 0.0},
+      {"", false, 0.0},
+      {deep.c_str(), false, 0.0},
+  };
+  int failures = 0;
+  size_t count = sizeof(cases) / sizeof(cases[0]);
+  for (size_t i = 0; i < count; i++) {
+    double value = NAN;
+    bool found = findJsonNumber(cases[i].json, strlen(cases[i].json), PATH, 2, value);
+    if (found != cases[i].found || (found && fabs(value - cases[i].value) > 1e-9)) {
+      printf("  lookup case %zu: found %d value %g, expected %d %g\n", i, found, value, cases[i].found, cases[i].value);
+      failures++;
+    }
+  }
+  printf("main.temp lookup: %zu cases: %s\n", count, failures ? "FAILED" : "ok");
+  return failures;
+}
+
+} // namespace
+
+int runWeatherBench(int argc, char** argv) {
+  WeatherOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+  int failures = runLookupCases();
+
+  // First answer good, a long outage of every failure kind, then recovery.
+  const Behaviour script[] = {OK, SLOW, STALL_BODY, SERVER_ERROR, HTML, TRUNCATED, DECOY, SLOW, SERVER_ERROR, RECOVERED};
+  const size_t scriptLength = sizeof(script) / sizeof(script[0]);
+
+  int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  int reuse = 1;
+  setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addressLength = sizeof(address);
+  if (bind(listenFd, (sockaddr*)&address, sizeof(address)) != 0 || listen(listenFd, 8) != 0 ||
+      getsockname(listenFd, (sockaddr*)&address, &addressLength) != 0) {
+    printf("cannot start the stand-in server: %s\n", strerror(errno));
+    return 1;
+  }
+  pid_t server = fork();
+  if (server == 0) {
+    runServer(listenFd, script, scriptLength, options.slowMs);
+    _exit(0);
+  }
+  close(listenFd);
+
+  char url[160];
+  snprintf(url, sizeof(url), "http://127.0.0.1:%d/data/2.5/weather?q=Toronto&appid=KEY&units=metric", ntohs(address.sin_port));
+  WeatherFetcherConfig config;
+  config.requestTimeoutMs = options.timeoutMs;
+  PosixHttpGetter http;
+  WeatherFetcher fetcher(http, config);
+  fetcher.setUrl(url);
+
+  printf("stand-in server on port %d, timeout %u ms, slow answers after %lu ms\n", ntohs(address.sin_port),
+         options.timeoutMs, options.slowMs);
+  printf("  %9s  %-13s %6s %8s %9s %10s %7s\n", "t (min)", "server", "status", "took ms", "failures", "retry (s)", "cached");
+
+  unsigned long nowMs = 0;
+  unsigned long expectedBackoffMs = config.initialBackoffMs;
+  unsigned long slowestMs = 0;
+  bool wentStale = false;
+  for (size_t attempt = 0; attempt < scriptLength; attempt++) {
+    Behaviour behaviour = script[attempt];
+    bool shouldSucceed = behaviour == OK || behaviour == RECOVERED;
+    WeatherReading before = fetcher.reading();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool requested = fetcher.update(nowMs);
+    unsigned long tookMs = elapsedMs(start);
+    if (tookMs > slowestMs) slowestMs = tookMs;
+    WeatherReading after = fetcher.reading();
+    unsigned long retryMs = fetcher.nextAttemptMs() - nowMs;
+    bool stale = fetcher.stale(nowMs);
+    wentStale = wentStale || (stale && after.valid);
+    char cached[16] = "--";
+    if (after.valid) snprintf(cached, sizeof(cached), "%.2f%s", after.temperatureC, stale ? "?" : "");
+    printf("  %9.1f  %-13s %6d %8lu %9d %10lu %7s\n", nowMs / 60000.0, behaviourName(behaviour), fetcher.lastStatus(),
+           tookMs, fetcher.consecutiveFailures(), retryMs / 1000, cached);
+
+    const char* problem = nullptr;
+    if (!requested) problem = "no request made";
+    else if (tookMs > options.timeoutMs + TIMEOUT_MARGIN_MS) problem = "request overran the timeout";
+    else if (shouldSucceed && (!after.valid || after.fetchedAtMs != nowMs || fetcher.consecutiveFailures() != 0))
+      problem = "good response not taken";
+    else if (shouldSucceed && retryMs != config.refreshIntervalMs) problem = "refresh interval not restored";
+    else if (!shouldSucceed && (after.valid != before.valid || after.temperatureC != before.temperatureC ||
+                                after.fetchedAtMs != before.fetchedAtMs))
+      problem = "failure changed the cached reading";
+    else if (!shouldSucceed && retryMs != expectedBackoffMs) problem = "unexpected retry delay";
+    if (problem != nullptr) {
+      printf("    %s\n", problem);
+      failures++;
+    }
+
+    if (shouldSucceed) {
+      expectedBackoffMs = config.initialBackoffMs;
+    } else {
+      expectedBackoffMs = expectedBackoffMs * 2 > config.maxBackoffMs ? config.maxBackoffMs : expectedBackoffMs * 2;
+    }
+    if (fetcher.due(nowMs)) {
+      printf("    due again before the retry time\n");
+      failures++;
+    }
+    nowMs = fetcher.nextAttemptMs();
+  }
+  WeatherReading last = fetcher.reading();
+  bool recovered = last.valid && fabsf(last.temperatureC - 18.25f) < 1e-4f && !fetcher.stale(nowMs);
+  if (!wentStale || !recovered) failures++;
+  printf("slowest request %lu ms, stale during the outage: %s, recovered: %s\n", slowestMs, wentStale ? "yes" : "no",
+         recovered ? "yes" : "no");
+
+  kill(server, SIGTERM);
+  waitpid(server, nullptr, 0);
+  printf("weather fetcher: %s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,8 @@
+#ifndef WEATHER_BENCH_H
+#define WEATHER_BENCH_H
+
+// `program weather [options]`: weather fetcher against a local stand-in HTTP server that
+// answers slowly, with errors and with malformed bodies (timeouts, backoff, cached value).
+int runWeatherBench(int argc, char** argv);
+
+#endif // WEATHER_BENCH_H